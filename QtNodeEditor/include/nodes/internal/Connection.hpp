@@ -119,14 +119,20 @@ public:
   void
   setTypeConverter(TypeConverter converter);
 
-  ConnectionStyle style() const
+  ConnectionStyle const& style() const
   {
-      return _style;
+      return *_style;
   }
 
-  void setStyle(ConnectionStyle style)
+  void setStyle(ConnectionStyle const& style)
   {
-      _style = style;
+      _style = std::make_shared<ConnectionStyle>(style);
+  }
+
+  /// Share an immutable style with other connections, without copying it.
+  void setStyle(std::shared_ptr<ConnectionStyle const> style)
+  {
+      _style = std::move(style);
   }
 
 public: // data propagation
@@ -140,7 +146,7 @@ public: // data propagation
 private:
 
   QUuid _uid;
-  ConnectionStyle _style;
+  std::shared_ptr<ConnectionStyle const> _style;
 
 private:
 
@@ -4,6 +4,7 @@
 
 #include <QtCore/QPointF>
 #include <QtCore/QRectF>
+#include <QtGui/QPainterPath>
 
 #include <iostream>
 
@@ -33,6 +34,15 @@ public:
   std::pair<QPointF, QPointF>
   pointsC1C2() const;
 
+  /// The cubic spline from source() to sink(). It is cached, as the
+  /// bounding rect, until an end point moves.
+  QPainterPath const&
+  cubicPath() const;
+
+  /// The area around the spline where the connection can be picked
+  QPainterPath const&
+  shape() const;
+
   QPointF
   source() const { return _out; }
   QPointF
@@ -60,5 +70,17 @@ private:
   bool _hovered;
 
   PortLayout _ports_layout;
+
+  mutable bool _pathValid;
+  mutable bool _shapeValid;
+  mutable QPainterPath _cubicPath;
+  mutable QPainterPath _shape;
+  mutable QRectF _boundingRect;
+
+  void
+  invalidate() { _pathValid = false; _shapeValid = false; }
+
+  void
+  updatePath() const;
 };
 }
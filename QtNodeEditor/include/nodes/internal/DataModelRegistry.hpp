@@ -72,6 +72,7 @@ public:
     _registeredItemCreators[name] = std::move(creator);
     _categories.insert(category);
     _registeredModelsCategory[name] = category;
+    _revision++;
   }
 
   void registerTypeConverter(TypeConverterId const & id,
@@ -84,8 +85,12 @@ public:
   {
       _registeredItemCreators.erase(name);
       _registeredModelsCategory.erase(name);
+      _revision++;
   }
 
+  /// Changed by every registration: the models created before may differ.
+  unsigned int revision() const { return _revision; }
+
   std::unique_ptr<NodeDataModel>create(QString const &modelName);
 
   RegisteredModelCreatorsMap const &registeredModelCreators() const;
@@ -108,6 +113,8 @@ private:
   RegisteredModelCreatorsMap _registeredItemCreators;
 
   RegisteredTypeConvertersMap _registeredTypeConverters;
+
+  unsigned int _revision = 0;
 };
 
 
@@ -127,7 +134,7 @@ DataModelRegistry::
   _registeredItemCreators[name] = std::move(creator);
   _categories.insert(category);
   _registeredModelsCategory[name] = category;
-
+  _revision++;
 }
 
 }
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <QtCore/QPointer>
+#include <QtGui/QImage>
+#include <QtGui/QRegion>
+#include <QtGui/QTransform>
+#include <QtWidgets/QWidget>
+
+#include "Export.hpp"
+
+namespace QtNodes
+{
+
+class FlowScene;
+class FlowView;
+
+/// The whole scene of a FlowView, at LevelOfDetail::Low, with the part
+/// shown by the view. Clicking or dragging recenters the view.
+///
+/// The scene is rendered once in an image, then only the regions changed
+/// by the items (QGraphicsScene::changed()) are rendered again, when the
+/// minimap is painted: nothing is done while it is hidden.
+class NODE_EDITOR_PUBLIC FlowMinimap
+  : public QWidget
+{
+  Q_OBJECT
+public:
+
+  FlowMinimap(QWidget *parent = Q_NULLPTR);
+
+  /// Null to show nothing.
+  void setView(FlowView* view);
+
+  FlowView* view() const { return _view; }
+
+  /// Pixels of the longest side of the image of the scene.
+  void setResolution(int pixels);
+
+  int resolution() const { return _resolution; }
+
+  QSize sizeHint() const override { return QSize(240, 180); }
+
+protected:
+
+  void paintEvent(QPaintEvent *event) override;
+
+  void mousePressEvent(QMouseEvent *event) override;
+
+  void mouseMoveEvent(QMouseEvent *event) override;
+
+  void showEvent(QShowEvent *event) override;
+
+  bool eventFilter(QObject *watched, QEvent *event) override;
+
+private:
+
+  void onSceneChanged(QList<QRectF> const& region);
+
+  /// A new image, for the current bounds of the items.
+  void rebuild();
+
+  void renderDirtyRegion();
+
+  /// Where the image is drawn in the widget.
+  QRectF imageTarget() const;
+
+  QTransform sceneToWidget() const;
+
+  QPointer<FlowView> _view;
+
+  QPointer<FlowScene> _scene;
+
+  int _resolution;
+
+  QImage _image;
+
+  /// The part of the scene in the image.
+  QRectF _bounds;
+
+  QTransform _sceneToImage;
+
+  bool _rebuildNeeded;
+
+  /// In the pixels of the image.
+  QRegion _dirty;
+
+  /// Of the view, when the minimap was painted.
+  QRectF _visibleRect;
+};
+}
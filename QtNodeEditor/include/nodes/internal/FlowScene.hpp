@@ -2,8 +2,11 @@
 
 #include <QtCore/QUuid>
 #include <QtWidgets/QGraphicsScene>
+#include <QtWidgets/QGraphicsProxyWidget>
 
 #include <unordered_map>
+#include <unordered_set>
+#include <vector>
 #include <tuple>
 #include <functional>
 
@@ -12,6 +15,8 @@
 #include "DataModelRegistry.hpp"
 #include "TypeConverter.hpp"
 #include "memory.hpp"
+#include "LevelOfDetail.hpp"
+#include "NodeIndex.hpp"
 
 namespace QtNodes
 {
@@ -58,8 +63,23 @@ public:
 
   Node& createNode(std::unique_ptr<NodeDataModel> && dataModel );
 
+  /// A node of a model of the registry. A node of the same model removed
+  /// from this scene is reused when possible, with its widget: see
+  /// NodeDataModel::resetForReuse(). Null if the model is not registered.
+  /// "setup" is called before the node is added and nodeCreated().
+  Node* createNodeOfModel(QString const& modelName,
+                          std::function<void(NodeDataModel&)> const& setup = nullptr);
+
+  /// The removed nodes kept for createNodeOfModel().
+  size_t pooledNodesCount() const { return _nodePoolSize; }
+
+  void clearNodePool();
+
   Node& restoreNode(QJsonObject const& nodeJson);
 
+  /// Of Node::saveContent(), with the given id.
+  Node& restoreNode(QJsonObject const& nodeJson, QUuid const& id);
+
   void removeNode(Node& node);
 
   DataModelRegistry&registry() const;
@@ -77,13 +97,35 @@ public:
   void setNodePosition(Node& node, const QPointF& pos) const;
 
   QSizeF getNodeSize(const Node& node) const;
+
+  /// Moves the movable selected nodes and "grabbed" by "delta", as
+  /// QGraphicsItem::mouseMoveEvent() does, then each of their connections
+  /// once: a connection between two moved nodes is not computed twice.
+  void moveNodes(Node& grabbed, QPointF const& delta);
+
+  /// The nodes moved since the last call, for the end of the drag.
+  std::vector<Node*> takeMovedNodes();
+
+  /// True during moveNodes(): the nodes do not move their connections.
+  bool isMovingNodes() const { return _movingNodes; }
+
+  /// Each connection of "nodes" once.
+  void moveConnections(std::vector<Node*> const& nodes) const;
 public:
 
   std::unordered_map<QUuid, std::unique_ptr<Node> > const &nodes() const;
 
   std::unordered_map<QUuid, std::shared_ptr<Connection> > const &connections() const;
 
-  std::vector<Node*>selectedNodes() const;
+  /// Kept up to date by NodeGraphicsObject::itemChange(), in no
+  /// particular order.
+  std::vector<Node*> const& selectedNodes() const;
+
+  /// For hit testing: the nodes only, without the scan of all the items.
+  NodeIndex& nodeIndex() { return _nodeIndex; }
+
+  /// Called by the NodeGraphicsObject of "node".
+  void nodeSelectionChanged(Node& node, bool selected);
 
 public:
 
@@ -101,6 +143,50 @@ public:
 
   QtNodes::PortLayout layout() const;
 
+  /// Set by the view when the zoom changes; see NodeGraphicsObject::setLevelOfDetail()
+  void setLevelOfDetail(LevelOfDetail lod);
+
+  LevelOfDetail levelOfDetail() const { return _levelOfDetail; }
+
+  /// For the scenes that are only watched: the nodes paint only
+  /// SceneLayer::Overlay and hide their widgets, the views draw the rest
+  /// from tiles cached until staticLayerInvalidated().
+  void setStaticLayer(bool enabled);
+
+  bool isStaticLayer() const { return _staticLayer; }
+
+  /// Called when the geometry or the content of a node changes.
+  void invalidateStaticLayer();
+
+  /// A proxy of the pool filled by recycleProxyWidget(), or a new one,
+  /// child of "node".
+  QGraphicsProxyWidget* takeProxyWidget(NodeGraphicsObject* node);
+
+  /// "proxy" holds no widget anymore: kept for the next takeProxyWidget().
+  void recycleProxyWidget(QGraphicsProxyWidget* proxy);
+
+  /// The nodes and the connections created between beginBatch() and
+  /// endBatch() do not emit nodeCreated() and connectionCreated(), and their
+  /// size is computed only once, by endBatch(), that emits sceneRebuilt()
+  /// instead. The batches can be nested.
+  void beginBatch();
+
+  void endBatch();
+
+  bool isBatching() const { return _batchDepth > 0; }
+
+  /// A batch open for the lifetime of the object.
+  class Batch
+  {
+  public:
+    explicit Batch(FlowScene& scene) : _scene(scene) { _scene.beginBatch(); }
+
+    ~Batch() { _scene.endBatch(); }
+
+  private:
+    FlowScene& _scene;
+  };
+
 signals:
 
   void nodeCreated(Node &n);
@@ -111,6 +197,9 @@ signals:
 
   void connectionDeleted(Connection &c);
 
+  /// The end of the connection at "n" is dragged away from the node.
+  void connectionDetached(Connection &c, Node &n);
+
   void connectionContextMenu(Connection& n, const QPointF& pos);
 
   void nodeMoved(Node& n, const QPointF& newLocation);
@@ -127,6 +216,12 @@ signals:
 
   void nodeContextMenu(Node& n, const QPointF& pos);
 
+  /// Emitted by endBatch() with the nodes created by the batch, before
+  /// their size is computed.
+  void sceneRebuilt(std::vector<Node*> const& nodes);
+
+  void staticLayerInvalidated();
+
 private:
 
   using SharedConnection = std::shared_ptr<Connection>;
@@ -138,6 +233,41 @@ private:
 
   QtNodes::PortLayout _layout;
 
+  LevelOfDetail _levelOfDetail;
+
+  bool _staticLayer;
+
+  int _batchDepth;
+  std::vector<Node*> _batchNodes;
+
+  /// Out of the scene, deleted with it.
+  std::vector<QGraphicsProxyWidget*> _proxyPool;
+
+  bool _movingNodes;
+  std::vector<Node*> _movedNodes;
+
+  std::unordered_set<Node*> _selectedNodes;
+
+  /// _selectedNodes, built again by selectedNodes() after a change.
+  mutable std::vector<Node*> _selectedNodesVector;
+  mutable bool _selectedNodesChanged;
+
+  NodeIndex _nodeIndex;
+
+  /// The removed nodes, by model, out of the scene.
+  std::unordered_map<QString, std::vector<UniqueNode>> _nodePool;
+  size_t _nodePoolSize;
+  unsigned int _nodePoolRevision;
+
+  /// Null if there is none to reuse.
+  UniqueNode takePooledNode(QString const& modelName);
+
+  /// Kept in the pool, or deleted.
+  void recycleNode(UniqueNode node);
+
+  /// For the new and the reused nodes.
+  Node& insertNode(UniqueNode node);
+
 };
 
 Node*
@@ -1,8 +1,12 @@
 #pragma once
 
+#include <QtCore/QCache>
+#include <QtCore/QElapsedTimer>
+#include <QtGui/QPixmap>
 #include <QtWidgets/QGraphicsView>
 
 #include "Export.hpp"
+#include "FrameStats.hpp"
 
 namespace QtNodes
 {
@@ -27,6 +31,27 @@ public:
 
   void setScene(FlowScene *scene);
 
+  /// Renders with OpenGL (QOpenGLWidget, multisampled) instead of the
+  /// raster engine. Does nothing if Qt was built without OpenGL.
+  void setOpenGLViewport(bool enabled, int samples = 4);
+
+  bool isOpenGLViewport() const;
+
+  /// The cost of the last frames, and the items of the scene.
+  FrameStats frameStats() const;
+
+  /// An overlay of frameStats(), in the top left corner.
+  void setPerformanceHudVisible(bool visible);
+
+  bool isPerformanceHudVisible() const { return _hudVisible; }
+
+  /// Pans the view, as the drag with the mouse does, to show "scenePos"
+  /// at its center.
+  void centerScene(QPointF const& scenePos);
+
+  /// The part of the scene shown.
+  QRectF visibleSceneRect() const;
+
 public slots:
 
   void scaleUp();
@@ -57,14 +82,25 @@ protected:
 
   void drawBackground(QPainter* painter, const QRectF& r) override;
 
+  void drawForeground(QPainter* painter, const QRectF& r) override;
+
   void showEvent(QShowEvent *event) override;
 
+  void paintEvent(QPaintEvent *event) override;
+
 protected:
 
   FlowScene * scene();
 
 private:
 
+  /// The tiles of FlowScene::setStaticLayer() that intersect "r".
+  void drawStaticLayer(QPainter* painter, QRectF const& r);
+
+  QPixmap renderStaticTile(QRectF const& tileRect, qreal zoom) const;
+
+  void invalidateStaticLayer();
+
   QAction* _clearSelectionAction;
 
   QAction* _deleteSelectionAction;
@@ -72,5 +108,16 @@ private:
   QPointF _clickPos;
 
   FlowScene* _scene;
+
+  FrameStats _frameStats;
+
+  QElapsedTimer _fpsClock;
+
+  int _fpsFrames;
+
+  bool _hudVisible;
+
+  /// Keyed by the zoom and the position of the tile, costs in KB.
+  QCache<QString, QPixmap> _staticTiles;
 };
 }
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <QtCore/QtGlobal>
+
+#include "Export.hpp"
+#include "LevelOfDetail.hpp"
+
+namespace QtNodes
+{
+
+/// What the last frames of a FlowView cost: shown by its HUD, and read by
+/// the benchmarks.
+struct FrameStats
+{
+  /// Frames painted in the last second.
+  double fps = 0;
+
+  /// Microseconds of the last FlowView::paintEvent().
+  qint64 paintUs = 0;
+
+  qint64 frames = 0;
+
+  int nodes = 0;
+
+  int connections = 0;
+
+  /// The nodes with an embedded widget, and those of them shown.
+  int widgets = 0;
+
+  int visibleWidgets = 0;
+
+  /// The items whose paint() was called by the last frame; the others were
+  /// either out of view or drawn from their cache.
+  int nodesRepainted = 0;
+
+  int connectionsRepainted = 0;
+
+  /// With FlowScene::setStaticLayer(): the tiles of the static layer
+  /// rendered by the last frame, instead of being taken from the cache.
+  bool staticLayer = false;
+
+  int tilesRendered = 0;
+
+  LevelOfDetail levelOfDetail = LevelOfDetail::Full;
+};
+
+
+/// Incremented by the paint() of the items, reset by the view before each
+/// frame. The GUI thread only.
+class NODE_EDITOR_PUBLIC PaintCounters
+{
+public:
+
+  static int nodes;
+
+  static int connections;
+
+  static void reset() { nodes = 0; connections = 0; }
+};
+}
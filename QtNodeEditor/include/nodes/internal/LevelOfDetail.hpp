@@ -0,0 +1,29 @@
+#pragma once
+
+namespace QtNodes
+{
+
+/// How much of the nodes and the connections is drawn, depending on the zoom.
+enum class LevelOfDetail
+{
+  Low,    ///< flat rectangles and straight connections
+  Medium, ///< captions only: no embedded widgets, port labels or shadows
+  Full
+};
+
+/// "scale" as given by QStyleOptionGraphicsItem::levelOfDetailFromTransform()
+inline
+LevelOfDetail
+levelOfDetail(double scale)
+{
+  if (scale < 0.25)
+  {
+    return LevelOfDetail::Low;
+  }
+  if (scale < 0.5)
+  {
+    return LevelOfDetail::Medium;
+  }
+  return LevelOfDetail::Full;
+}
+}
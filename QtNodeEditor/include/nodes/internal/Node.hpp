@@ -47,6 +47,15 @@ public:
   void
   restore(QJsonObject const &json) override;
 
+  /// save() without the id, for the copies already keyed by id(): the
+  /// snapshots of an undo history do not convert it to and from a string.
+  QJsonObject
+  saveContent() const;
+
+  /// restore() of saveContent(), or of save() ignoring its id.
+  void
+  restore(QJsonObject const &json, QUuid const& id);
+
 public:
 
   QUuid
@@ -59,6 +68,16 @@ public:
   void
   resetReactionToConnection();
 
+  /// For the pool of FlowScene: a new id and the state of a new node, see
+  /// NodeDataModel::resetForReuse(). False if the model can not be reused.
+  bool
+  resetForReuse();
+
+  /// Only this node stays connected to the signals of the model: the
+  /// receivers of a removed node do not see the next one.
+  void
+  disconnectModel();
+
 public:
 
   NodeGraphicsObject const &
@@ -103,6 +122,9 @@ public slots: // data propagation
 
 private:
 
+  void
+  connectModel();
+
   // addressing
 
   QUuid _uid;
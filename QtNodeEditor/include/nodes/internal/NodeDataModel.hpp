@@ -40,6 +40,10 @@ public:
   virtual QString
   name() const = 0;
 
+  /// Drawn at LevelOfDetail::Medium, in place of the embedded widget
+  virtual QString
+  caption() const { return name(); }
+
 public:
 
   QJsonObject
@@ -74,6 +78,10 @@ public:
   void
   setNodeStyle(NodeStyle const& style);
 
+  /// Share an immutable style with other models, without copying it.
+  void
+  setNodeStyle(std::shared_ptr<NodeStyle const> style);
+
 public:
 
   /// Triggers the algorithm
@@ -90,6 +98,12 @@ public:
   QWidget *
   embeddedWidget() = 0;
 
+  /// Size of the content drawn by the painterDelegate() in place of the
+  /// embedded widget, when embeddedWidget() is null.
+  virtual
+  QSize
+  embeddedSize() const { return QSize(); }
+
   virtual
   bool
   resizable() const { return false; }
@@ -105,6 +119,13 @@ public:
   virtual
   NodePainterDelegate* painterDelegate() const { return nullptr; }
 
+  /// Called when a node removed from a FlowScene is reused for a new node
+  /// of the same model: the state of a new model is restored. False if the
+  /// model can not be reused.
+  virtual
+  bool
+  resetForReuse() { return false; }
+
 signals:
 
   void
@@ -123,6 +144,6 @@ signals:
 
 private:
 
-  NodeStyle _nodeStyle;
+  std::shared_ptr<NodeStyle const> _nodeStyle;
 };
 }
@@ -89,6 +89,25 @@ public:
   void
   recalculateSize(QFont const &font) const;
 
+  /// The size must be computed again, because the model changed. Painting
+  /// never does it: the caller must also call
+  /// NodeGraphicsObject::setGeometryChanged().
+  void
+  setDirty() { _dirty = true; }
+
+  bool
+  isDirty() const { return _dirty; }
+
+  /// Updates size if set dirty since the last update
+  void
+  recalculateSizeIfDirty() const
+  {
+    if (_dirty)
+    {
+      recalculateSize();
+    }
+  }
+
   // TODO removed default QTransform()
   QPointF
   portScenePosition(PortIndex index,
@@ -151,5 +170,7 @@ private:
   mutable QFontMetrics _boldFontMetrics;
 
   PortLayout _ports_layout;
+
+  mutable bool _dirty;
 };
 }
@@ -7,6 +7,7 @@
 
 #include "NodeGeometry.hpp"
 #include "NodeState.hpp"
+#include "LevelOfDetail.hpp"
 
 class QGraphicsProxyWidget;
 
@@ -35,6 +36,9 @@ public:
   Node const&
   node() const;
 
+  FlowScene&
+  flowScene() const { return _scene; }
+
   QRectF
   boundingRect() const override;
 
@@ -57,6 +61,24 @@ public:
   void
   updateEmbeddedQWidget();
 
+  /// Hides the embedded widget below LevelOfDetail::Full.
+  void
+  setLevelOfDetail(LevelOfDetail lod);
+
+  /// Paints SceneLayer::Overlay only and hides the embedded widget: the
+  /// rest is drawn by the view; see FlowScene::setStaticLayer().
+  void
+  setStaticLayer(bool enabled);
+
+  /// Null if the model has no embedded widget.
+  QGraphicsProxyWidget*
+  proxyWidget() const { return _proxyWidget; }
+
+  /// Back in the scene, after Node::resetForReuse(), with the flags and
+  /// the state of a new node.
+  void
+  resetForReuse();
+
 protected:
   void
   paint(QPainter*                       painter,
@@ -103,5 +125,12 @@ private:
   // either nullptr or owned by parent QGraphicsItem
   QGraphicsProxyWidget * _proxyWidget;
   QPoint _press_pos;
+
+  LevelOfDetail _levelOfDetail;
+
+  bool _staticLayer;
+
+  bool
+  isWidgetShown() const;
 };
 }
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <QtCore/QPointF>
+#include <QtCore/QRectF>
+
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "Export.hpp"
+
+namespace QtNodes
+{
+
+class Node;
+
+/// The nodes of a FlowScene in a uniform grid of their scene bounding
+/// rectangles. The scene indexes no item (QGraphicsScene::NoIndex): its
+/// items() goes through every node and connection.
+///
+/// The rectangles are read again before the next query, for the nodes
+/// given to invalidate() when they moved or changed size.
+class NODE_EDITOR_PUBLIC NodeIndex
+{
+public:
+
+  explicit NodeIndex(qreal cellSize = 512);
+
+  void insert(Node& node);
+
+  void remove(Node& node);
+
+  void invalidate(Node& node);
+
+  void clear();
+
+  /// The visible node with the highest z value whose bounding rectangle
+  /// contains "point", or null.
+  Node* nodeAt(QPointF const& point);
+
+  /// The nodes whose bounding rectangle intersects "rect".
+  std::vector<Node*> nodesIn(QRectF const& rect);
+
+private:
+
+  using CellKey = quint64;
+
+  struct CellRange
+  {
+    int left, top, right, bottom;
+  };
+
+  CellRange cellRange(QRectF const& rect) const;
+
+  static CellKey cellKey(int x, int y);
+
+  void removeFromCells(Node* node, QRectF const& rect);
+
+  void refresh();
+
+  qreal _cellSize;
+
+  std::unordered_map<CellKey, std::vector<Node*>> _cells;
+
+  /// Where each node is in the cells.
+  std::unordered_map<Node*, QRectF> _rects;
+
+  std::unordered_set<Node*> _dirty;
+};
+}
@@ -20,6 +20,11 @@ public:
 
   static void setNodeStyle(QString jsonText);
 
+  /// Global switch of the shadows drawn below the nodes; enabled by default.
+  static void setShadowsEnabled(bool enabled);
+
+  static bool shadowsEnabled();
+
 private:
 
   void loadJsonText(QString jsonText) override;
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <QtCore/QRectF>
+
+#include "Export.hpp"
+#include "LevelOfDetail.hpp"
+
+class QPainter;
+
+namespace QtNodes
+{
+
+class FlowScene;
+
+/// The parts of the scene painted by renderScene() and by the items.
+enum class SceneLayer
+{
+  /// Everything, as in the editor.
+  All,
+  /// What does not change once the scene is locked: the bodies of the
+  /// nodes, their text and their widgets. Cached by FlowView.
+  Static,
+  /// What the status of the nodes changes: their borders, shadows and
+  /// ports, and the connections.
+  Overlay
+};
+
+/// Draws the connections and the nodes of "scene" that intersect
+/// "sceneRect", in their stacking order, with their painters directly:
+/// neither the pixmap caches of the items nor QGraphicsScene::render() are
+/// used, so the painter can be a tile of a huge image or an SVG generator.
+/// The embedded widgets are drawn at LevelOfDetail::Full only, and the
+/// connections are not part of SceneLayer::Static.
+///
+/// The painter must map the scene coordinates to its device.
+NODE_EDITOR_PUBLIC
+void
+renderScene(FlowScene& scene,
+            QPainter& painter,
+            QRectF const& sceneRect,
+            LevelOfDetail lod = LevelOfDetail::Full,
+            SceneLayer layer = SceneLayer::All);
+}
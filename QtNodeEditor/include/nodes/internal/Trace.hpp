@@ -0,0 +1,79 @@
+#pragma once
+
+#include <atomic>
+
+#include <QtCore/QString>
+
+#include "Export.hpp"
+
+namespace QtNodes
+{
+
+/// Timeline of the scopes marked with NODE_TRACE_SCOPE(), on any thread,
+/// written as Chrome trace events (chrome://tracing, Perfetto).
+///
+/// Disabled by default: a disabled scope costs a relaxed atomic load.
+class NODE_EDITOR_PUBLIC Trace
+{
+public:
+
+  /// Starts recording; the events are written to "path" by stop().
+  static void start(QString const& path);
+
+  /// Writes the recorded events and disables the trace. False if the file
+  /// could not be written.
+  static bool stop();
+
+  static bool enabled()
+  { return _enabled.load(std::memory_order_relaxed); }
+
+  /// Microseconds of a monotonic clock.
+  static qint64 now();
+
+  /// "name" must outlive the trace: a string literal.
+  static void complete(const char* name, qint64 begin_us, qint64 duration_us);
+
+  /// A point in time, as the first paint.
+  static void instant(const char* name);
+
+private:
+
+  static std::atomic<bool> _enabled;
+};
+
+
+/// Records its lifetime as an event, if the trace is enabled when created.
+class TraceScope
+{
+public:
+
+  explicit
+  TraceScope(const char* name)
+    : _name(name)
+    , _begin(Trace::enabled() ? Trace::now() : -1)
+  {}
+
+  ~TraceScope()
+  {
+    if (_begin >= 0)
+    {
+      Trace::complete(_name, _begin, Trace::now() - _begin);
+    }
+  }
+
+  TraceScope(TraceScope const&) = delete;
+  TraceScope& operator=(TraceScope const&) = delete;
+
+private:
+
+  const char* _name;
+  qint64 _begin;
+};
+}
+
+#define NODE_TRACE_CONCAT_(a, b) a ## b
+#define NODE_TRACE_CONCAT(a, b) NODE_TRACE_CONCAT_(a, b)
+
+/// Traces the rest of the enclosing scope as "name", a string literal.
+#define NODE_TRACE_SCOPE(name) \
+  QtNodes::TraceScope NODE_TRACE_CONCAT(node_trace_scope_, __LINE__)(name)
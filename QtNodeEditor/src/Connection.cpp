@@ -18,6 +18,7 @@
 #include "ConnectionGeometry.hpp"
 #include "ConnectionGraphicsObject.hpp"
 #include "StyleCollection.hpp"
+#include "Uuid.hpp"
 
 using QtNodes::Connection;
 using QtNodes::PortType;
@@ -34,8 +35,8 @@ Connection::
 Connection(PortType portType,
            Node& node,
            PortIndex portIndex)
-  : _uid(QUuid::createUuid())
-  , _style(QtNodes::StyleCollection::connectionStyle())
+  : _uid(detail::createUuid())
+  , _style(std::make_shared<QtNodes::ConnectionStyle>(QtNodes::StyleCollection::connectionStyle()))
   , _outPortIndex(INVALID)
   , _inPortIndex(INVALID)
   , _connectionState()
@@ -52,7 +53,8 @@ Connection(Node& nodeIn,
            Node& nodeOut,
            PortIndex portIndexOut,
            TypeConverter typeConverter)
-  : _uid(QUuid::createUuid())
+  : _uid(detail::createUuid())
+  , _style(std::make_shared<QtNodes::ConnectionStyle>(QtNodes::StyleCollection::connectionStyle()))
   , _outNode(&nodeOut)
   , _inNode(&nodeIn)
   , _outPortIndex(portIndexOut)
@@ -16,6 +16,8 @@ ConnectionGeometry()
   , _lineWidth(3.0)
   , _hovered(false)
   , _ports_layout( PortLayout::Horizontal )
+  , _pathValid(false)
+  , _shapeValid(false)
 { }
 
 QPointF const&
@@ -45,8 +47,9 @@ setEndPoint(PortType portType, QPointF const& point)
       break;
 
     default:
-      break;
+      return;
   }
+  invalidate();
 }
 
 
@@ -65,8 +68,9 @@ moveEndPoint(PortType portType, QPointF const &offset)
       break;
 
     default:
-      break;
+      return;
   }
+  invalidate();
 }
 
 
@@ -74,8 +78,61 @@ QRectF
 ConnectionGeometry::
 boundingRect() const
 {
+  updatePath();
+  return _boundingRect;
+}
+
+
+QPainterPath const&
+ConnectionGeometry::
+cubicPath() const
+{
+  updatePath();
+  return _cubicPath;
+}
+
+
+QPainterPath const&
+ConnectionGeometry::
+shape() const
+{
+  if (!_shapeValid)
+  {
+    QPainterPath const& cubic = cubicPath();
+
+    QPainterPath result(_out);
+
+    unsigned segments = 20;
+
+    for (auto i = 0ul; i < segments; ++i)
+    {
+      double ratio = double(i + 1) / segments;
+      result.lineTo(cubic.pointAtPercent(ratio));
+    }
+
+    QPainterPathStroker stroker; stroker.setWidth(10.0);
+
+    _shape = stroker.createStroke(result);
+    _shapeValid = true;
+  }
+  return _shape;
+}
+
+
+void
+ConnectionGeometry::
+updatePath() const
+{
+  if (_pathValid)
+  {
+    return;
+  }
   auto points = pointsC1C2();
 
+  // cubic spline
+  _cubicPath = QPainterPath(_out);
+  _cubicPath.cubicTo(points.first, points.second, _in);
+
   QRectF basicRect = QRectF(_out, _in).normalized();
 
   QRectF c1c2Rect = QRectF(points.first, points.second).normalized();
@@ -92,7 +149,8 @@ boundingRect() const
   commonRect.setTopLeft(commonRect.topLeft() - cornerOffset);
   commonRect.setBottomRight(commonRect.bottomRight() + 2 * cornerOffset);
 
-  return commonRect;
+  _boundingRect = commonRect;
+  _pathValid = true;
 }
 
 
@@ -139,4 +197,5 @@ pointsC1C2() const
 void ConnectionGeometry::setPortLayout(QtNodes::PortLayout layout)
 {
   _ports_layout = layout;
+  invalidate();
 }
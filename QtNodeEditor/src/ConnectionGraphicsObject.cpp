@@ -19,6 +19,7 @@
 #include "NodeConnectionInteraction.hpp"
 
 #include "Node.hpp"
+#include "FrameStats.hpp"
 
 using QtNodes::ConnectionGraphicsObject;
 using QtNodes::Connection;
@@ -143,8 +144,13 @@ paint(QPainter* painter,
 {
     painter->setClipRect(option->exposedRect);
 
+  LevelOfDetail const lod =
+    levelOfDetail(option->levelOfDetailFromTransform(painter->worldTransform()));
+
+  PaintCounters::connections++;
   ConnectionPainter::paint(painter,
-                           _connection);
+                           _connection,
+                           lod);
 }
 
 
@@ -17,44 +17,11 @@ using QtNodes::ConnectionGeometry;
 using QtNodes::Connection;
 
 
-static
-QPainterPath
-cubicPath(ConnectionGeometry const& geom)
-{
-  QPointF const& source = geom.source();
-  QPointF const& sink   = geom.sink();
-
-  auto c1c2 = geom.pointsC1C2();
-
-  // cubic spline
-  QPainterPath cubic(source);
-
-  cubic.cubicTo(c1c2.first, c1c2.second, sink);
-
-  return cubic;
-}
-
-
 QPainterPath
 ConnectionPainter::
 getPainterStroke(ConnectionGeometry const& geom)
 {
-  auto cubic = cubicPath(geom);
-
-  QPointF const& source = geom.source();
-  QPainterPath result(source);
-
-  unsigned segments = 20;
-
-  for (auto i = 0ul; i < segments; ++i)
-  {
-    double ratio = double(i + 1) / segments;
-    result.lineTo(cubic.pointAtPercent(ratio));
-  }
-
-  QPainterPathStroker stroker; stroker.setWidth(10.0);
-
-  return stroker.createStroke(result);
+  return geom.shape();
 }
 
 
@@ -86,7 +53,7 @@ debugDrawing(QPainter * painter,
 
     painter->setBrush(Qt::NoBrush);
 
-    painter->drawPath(cubicPath(geom));
+    painter->drawPath(geom.cubicPath());
   }
 
   {
@@ -122,7 +89,7 @@ drawSketchLine(QPainter * painter,
     using QtNodes::ConnectionGeometry;
     ConnectionGeometry const& geom = connection.connectionGeometry();
 
-    auto cubic = cubicPath(geom);
+    QPainterPath const& cubic = geom.cubicPath();
     // cubic spline
     painter->drawPath(cubic);
   }
@@ -160,7 +127,7 @@ drawHoveredOrSelected(QPainter * painter,
     painter->setBrush(Qt::NoBrush);
 
     // cubic spline
-    auto cubic = cubicPath(geom);
+    QPainterPath const& cubic = geom.cubicPath();
     painter->drawPath(cubic);
   }
 }
@@ -218,7 +185,7 @@ drawNormalLine(QPainter * painter,
   bool const selected = graphicsObject.isSelected();
 
 
-  auto cubic = cubicPath(geom);
+  QPainterPath const& cubic = geom.cubicPath();
   if (gradientColor)
   {
     painter->setBrush(Qt::NoBrush);
@@ -276,11 +243,39 @@ drawNormalLine(QPainter * painter,
 }
 
 
+static
+void
+drawStraightLine(QPainter * painter,
+                 Connection const & connection)
+{
+  if (connection.connectionState().requiresPort())
+    return;
+
+  auto const & connectionStyle = connection.style();
+  bool const selected = connection.connectionGraphicsObject().isSelected();
+
+  QPen p(selected ? connectionStyle.selectedColor() : connectionStyle.normalColor(),
+         connectionStyle.lineWidth());
+  p.setCosmetic(true);
+  painter->setPen(p);
+
+  ConnectionGeometry const& geom = connection.connectionGeometry();
+  painter->drawLine(geom.source(), geom.sink());
+}
+
+
 void
 ConnectionPainter::
 paint(QPainter* painter,
-      Connection const &connection)
+      Connection const &connection,
+      LevelOfDetail lod)
 {
+  if (lod == LevelOfDetail::Low)
+  {
+    drawStraightLine(painter, connection);
+    return;
+  }
+
   drawHoveredOrSelected(painter, connection);
 
   drawSketchLine(painter, connection);
@@ -2,6 +2,8 @@
 
 #include <QtGui/QPainter>
 
+#include "LevelOfDetail.hpp"
+
 namespace QtNodes
 {
 
@@ -16,7 +18,8 @@ public:
   static
   void
   paint(QPainter* painter,
-        Connection const& connection);
+        Connection const& connection,
+        LevelOfDetail lod = LevelOfDetail::Full);
 
   static
   QPainterPath
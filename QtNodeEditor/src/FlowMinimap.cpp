@@ -0,0 +1,289 @@
+#include "FlowMinimap.hpp"
+
+#include <QtGui/QMouseEvent>
+#include <QtGui/QPainter>
+
+#include <algorithm>
+#include <cmath>
+
+#include "FlowScene.hpp"
+#include "FlowView.hpp"
+#include "SceneRender.hpp"
+#include "StyleCollection.hpp"
+#include "Trace.hpp"
+
+using QtNodes::FlowMinimap;
+using QtNodes::FlowScene;
+using QtNodes::FlowView;
+
+namespace
+{
+
+// beyond it, the region is rendered as its bounding rectangle
+const int MAX_DIRTY_RECTS = 64;
+
+}
+
+FlowMinimap::
+FlowMinimap(QWidget *parent)
+  : QWidget(parent)
+  , _resolution(512)
+  , _rebuildNeeded(true)
+{
+  setMinimumSize(80, 60);
+  setCursor(Qt::PointingHandCursor);
+}
+
+
+void
+FlowMinimap::
+setView(FlowView* view)
+{
+  if (view == _view)
+  {
+    return;
+  }
+  if (_view)
+  {
+    _view->removeEventFilter(this);
+    _view->viewport()->removeEventFilter(this);
+  }
+  if (_scene)
+  {
+    disconnect(_scene, &QGraphicsScene::changed, this, &FlowMinimap::onSceneChanged);
+  }
+
+  _view  = view;
+  _scene = nullptr;
+  if (_view)
+  {
+    // FlowView::scene() is protected
+    _scene = qobject_cast<FlowScene*>(static_cast<QGraphicsView*>(view)->scene());
+
+    // the view is painted when it is panned or zoomed; the viewport is
+    // replaced by FlowView::setOpenGLViewport()
+    _view->installEventFilter(this);
+    _view->viewport()->installEventFilter(this);
+  }
+  if (_scene)
+  {
+    connect(_scene, &QGraphicsScene::changed, this, &FlowMinimap::onSceneChanged);
+  }
+
+  _rebuildNeeded = true;
+  update();
+}
+
+
+void
+FlowMinimap::
+setResolution(int pixels)
+{
+  _resolution = std::max(64, pixels);
+  _rebuildNeeded = true;
+  update();
+}
+
+
+void
+FlowMinimap::
+onSceneChanged(QList<QRectF> const& region)
+{
+  // rebuilt by showEvent()
+  if (_rebuildNeeded || !isVisible())
+  {
+    return;
+  }
+  for (QRectF const& rect : region)
+  {
+    if (rect.isEmpty())
+    {
+      continue;
+    }
+    if (!_bounds.contains(rect))
+    {
+      // an item out of the image: the bounds grew
+      _rebuildNeeded = true;
+      break;
+    }
+    // the cosmetic pens go past the items
+    _dirty += _sceneToImage.mapRect(rect).toAlignedRect().adjusted(-2, -2, 2, 2);
+    if (_dirty.rectCount() > MAX_DIRTY_RECTS)
+    {
+      _dirty = _dirty.boundingRect();
+    }
+  }
+  update();
+}
+
+
+void
+FlowMinimap::
+rebuild()
+{
+  NODE_TRACE_SCOPE("FlowMinimap::rebuild");
+
+  _rebuildNeeded = false;
+  _image = QImage();
+  _dirty = QRegion();
+  if (!_scene)
+  {
+    return;
+  }
+
+  _bounds = _scene->itemsBoundingRect();
+  if (_bounds.isEmpty())
+  {
+    return;
+  }
+  // some room for the nodes moved or added at the borders
+  qreal const side  = std::max(_bounds.width(), _bounds.height());
+  _bounds.adjust(-0.05 * side, -0.05 * side, 0.05 * side, 0.05 * side);
+  qreal const scale = _resolution / (1.1 * side);
+
+  _sceneToImage = QTransform();
+  _sceneToImage.scale(scale, scale);
+  _sceneToImage.translate(-_bounds.left(), -_bounds.top());
+
+  _image = QImage(std::max(1, int(std::ceil(_bounds.width() * scale))),
+                  std::max(1, int(std::ceil(_bounds.height() * scale))),
+                  QImage::Format_ARGB32_Premultiplied);
+  _dirty = QRegion(_image.rect());
+}
+
+
+void
+FlowMinimap::
+renderDirtyRegion()
+{
+  _dirty &= QRegion(_image.rect());
+  if (_dirty.isEmpty() || !_scene)
+  {
+    return;
+  }
+  NODE_TRACE_SCOPE("FlowMinimap::renderDirtyRegion");
+
+  QRect const dirtyRect = _dirty.boundingRect();
+
+  QPainter painter(&_image);
+  painter.setClipRegion(_dirty);
+  painter.setCompositionMode(QPainter::CompositionMode_Source);
+  painter.fillRect(dirtyRect, StyleCollection::flowViewStyle().BackgroundColor);
+  painter.setCompositionMode(QPainter::CompositionMode_SourceOver);
+
+  // a single query of the scene for the whole region
+  painter.setTransform(_sceneToImage);
+  renderScene(*_scene, painter,
+              _sceneToImage.inverted().mapRect(QRectF(dirtyRect)),
+              LevelOfDetail::Low);
+
+  _dirty = QRegion();
+}
+
+
+QRectF
+FlowMinimap::
+imageTarget() const
+{
+  QSizeF const size = QSizeF(_image.size()).scaled(QSizeF(this->size()), Qt::KeepAspectRatio);
+  QRectF target(QPointF(0, 0), size);
+  target.moveCenter(QRectF(rect()).center());
+  return target;
+}
+
+
+QTransform
+FlowMinimap::
+sceneToWidget() const
+{
+  QRectF const target = imageTarget();
+
+  QTransform imageToWidget;
+  imageToWidget.translate(target.left(), target.top());
+  imageToWidget.scale(target.width() / _image.width(),
+                      target.height() / _image.height());
+
+  return _sceneToImage * imageToWidget;
+}
+
+
+void
+FlowMinimap::
+paintEvent(QPaintEvent*)
+{
+  QPainter painter(this);
+  painter.fillRect(rect(), palette().dark());
+
+  if (!_view || !_scene)
+  {
+    return;
+  }
+  if (_rebuildNeeded)
+  {
+    rebuild();
+  }
+  if (_image.isNull())
+  {
+    return;
+  }
+  renderDirtyRegion();
+
+  QRectF const target = imageTarget();
+  painter.setRenderHint(QPainter::SmoothPixmapTransform);
+  painter.drawImage(target, _image);
+
+  _visibleRect = _view->visibleSceneRect();
+
+  painter.setClipRect(target);
+  painter.setPen(QPen(QColor(255, 255, 255, 200), 1.0));
+  painter.setBrush(QColor(255, 255, 255, 40));
+  painter.drawRect(sceneToWidget().mapRect(_visibleRect));
+}
+
+
+void
+FlowMinimap::
+mousePressEvent(QMouseEvent *event)
+{
+  mouseMoveEvent(event);
+}
+
+
+void
+FlowMinimap::
+mouseMoveEvent(QMouseEvent *event)
+{
+  if (!_view || _image.isNull() || !(event->buttons() & Qt::LeftButton))
+  {
+    return;
+  }
+  _view->centerScene(sceneToWidget().inverted().map(QPointF(event->pos())));
+  update();
+}
+
+
+void
+FlowMinimap::
+showEvent(QShowEvent *event)
+{
+  // the changes are not followed while hidden
+  _rebuildNeeded = true;
+  QWidget::showEvent(event);
+}
+
+
+bool
+FlowMinimap::
+eventFilter(QObject *watched, QEvent *event)
+{
+  if (_view && watched == _view && event->type() == QEvent::ChildAdded)
+  {
+    _view->viewport()->installEventFilter(this);
+  }
+  else if (_view && watched == _view->viewport() && event->type() == QEvent::Paint &&
+           isVisible() && _view->visibleSceneRect() != _visibleRect)
+  {
+    update();
+  }
+  return QWidget::eventFilter(watched, event);
+}
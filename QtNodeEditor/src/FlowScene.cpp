@@ -1,6 +1,8 @@
 #include "FlowScene.hpp"
 
+#include <algorithm>
 #include <stdexcept>
+#include <unordered_set>
 #include <utility>
 
 #include <QtWidgets/QGraphicsSceneMoveEvent>
@@ -26,6 +28,7 @@
 
 #include "FlowView.hpp"
 #include "DataModelRegistry.hpp"
+#include "Trace.hpp"
 
 using QtNodes::FlowScene;
 using QtNodes::Node;
@@ -37,12 +40,27 @@ using QtNodes::PortType;
 using QtNodes::PortIndex;
 using QtNodes::TypeConverter;
 
+namespace
+{
+
+// the removed nodes kept for createNodeOfModel(), all the models together
+const size_t MAX_POOLED_NODES = 4096;
+
+}
+
 
 FlowScene::
 FlowScene(std::shared_ptr<DataModelRegistry> registry,
           QObject * parent)
   : QGraphicsScene(parent)
   , _registry(std::move(registry))
+  , _levelOfDetail(LevelOfDetail::Full)
+  , _staticLayer(false)
+  , _batchDepth(0)
+  , _movingNodes(false)
+  , _selectedNodesChanged(false)
+  , _nodePoolSize(0)
+  , _nodePoolRevision(0)
 {
   setItemIndexMethod(QGraphicsScene::NoIndex);
 }
@@ -57,7 +75,15 @@ FlowScene(QObject * parent)
 FlowScene::
 ~FlowScene()
 {
+  // nothing to invalidate for the views
+  _staticLayer = false;
   clearScene();
+  clearNodePool();
+
+  for (QGraphicsProxyWidget* proxy : _proxyPool)
+  {
+    delete proxy;
+  }
 }
 
 
@@ -126,7 +152,10 @@ createConnection(Node& nodeIn,
 
   _connections[connection->id()] = connection;
 
-  connectionCreated(*connection);
+  if( !isBatching() )
+  {
+    connectionCreated(*connection);
+  }
 
   return connection;
 }
@@ -182,8 +211,6 @@ restoreConnection(QJsonObject const &connectionJson)
                      *nodeOut, portIndexOut,
                      getConverter());
 
-  connectionCreated(*connection);
-
   connection->connectionGeometry().setPortLayout( layout() );
   return connection;
 }
@@ -208,46 +235,151 @@ createNode(std::unique_ptr<NodeDataModel> && dataModel)
 
   node->setGraphicsObject(std::move(ngo));
 
+  return insertNode(std::move(node));
+}
+
+
+Node*
+FlowScene::
+createNodeOfModel(QString const& modelName,
+                  std::function<void(NodeDataModel&)> const& setup)
+{
+  if (UniqueNode node = takePooledNode(modelName))
+  {
+    if (setup)
+    {
+      setup(*node->nodeDataModel());
+    }
+    return &insertNode(std::move(node));
+  }
+  auto dataModel = registry().create(modelName);
+  if (!dataModel)
+  {
+    return nullptr;
+  }
+  if (setup)
+  {
+    setup(*dataModel);
+  }
+  return &createNode(std::move(dataModel));
+}
+
+
+Node&
+FlowScene::
+insertNode(UniqueNode node)
+{
   auto nodePtr = node.get();
   nodePtr->nodeGeometry().setPortLayout( layout() );
   auto id = node->id();
   _nodes[id] = std::move(node);
+  _nodeIndex.insert(*nodePtr);
 
-  nodeCreated(*nodePtr);
+  if( isBatching() )
+  {
+    _batchNodes.push_back(nodePtr);
+  }
+  else
+  {
+    nodeCreated(*nodePtr);
+  }
   return *nodePtr;
 }
 
 
+FlowScene::UniqueNode
+FlowScene::
+takePooledNode(QString const& modelName)
+{
+  if (_nodePoolRevision != _registry->revision())
+  {
+    // the models may have changed
+    clearNodePool();
+  }
+  auto it = _nodePool.find(modelName);
+  while (it != _nodePool.end() && !it->second.empty())
+  {
+    UniqueNode node = std::move(it->second.back());
+    it->second.pop_back();
+    _nodePoolSize--;
+
+    if (node->resetForReuse())
+    {
+      node->nodeGraphicsObject().resetForReuse();
+      return node;
+    }
+  }
+  return UniqueNode();
+}
+
+
+void
+FlowScene::
+recycleNode(UniqueNode node)
+{
+  if (_nodePoolRevision != _registry->revision())
+  {
+    clearNodePool();
+  }
+  if (_nodePoolSize >= MAX_POOLED_NODES)
+  {
+    return;
+  }
+  NodeGraphicsObject& ngo = node->nodeGraphicsObject();
+  ngo.setSelected(false);
+  removeItem(&ngo);
+  node->disconnectModel();
+
+  _nodePool[node->nodeDataModel()->name()].push_back(std::move(node));
+  _nodePoolSize++;
+}
+
+
+void
+FlowScene::
+clearNodePool()
+{
+  _nodePool.clear();
+  _nodePoolSize = 0;
+  _nodePoolRevision = _registry->revision();
+}
+
+
 Node&
 FlowScene::
 restoreNode(QJsonObject const& nodeJson)
 {
-  QString modelName = nodeJson["model"].toObject()["name"].toString();
+  return restoreNode(nodeJson, QUuid(nodeJson["id"].toString()));
+}
 
-  auto dataModel = registry().create(modelName);
 
-  if (!dataModel)
+Node&
+FlowScene::
+restoreNode(QJsonObject const& nodeJson, QUuid const& id)
+{
+  QString modelName = nodeJson["model"].toObject()["name"].toString();
+
+  UniqueNode node = takePooledNode(modelName);
+  if (!node)
   {
-    throw std::logic_error(std::string("No registered model with name ") +
-                           modelName.toLocal8Bit().data());
-  }
+    auto dataModel = registry().create(modelName);
 
-  auto node = detail::make_unique<Node>(std::move(dataModel));
-  auto ngo  = detail::make_unique<NodeGraphicsObject>(*this, *node);
-  node->setGraphicsObject(std::move(ngo));
+    if (!dataModel)
+    {
+      throw std::logic_error(std::string("No registered model with name ") +
+                             modelName.toLocal8Bit().data());
+    }
+    node = detail::make_unique<Node>(std::move(dataModel));
+    auto ngo = detail::make_unique<NodeGraphicsObject>(*this, *node);
+    node->setGraphicsObject(std::move(ngo));
+  }
 
-  node->restore(nodeJson);
+  node->restore(nodeJson, id);
 
   node->nodeState().getEntries(PortType::In).resize( node->nodeDataModel()->nPorts(PortType::In));
   node->nodeState().getEntries(PortType::Out).resize( node->nodeDataModel()->nPorts(PortType::Out));
 
-  auto nodePtr = node.get();
-  nodePtr->nodeGeometry().setPortLayout( layout() );
-  auto id = node->id();
-  _nodes[ id ] = std::move(node);
-
-  nodeCreated(*nodePtr);
-  return *nodePtr;
+  return insertNode(std::move(node));
 }
 
 
@@ -258,6 +390,19 @@ removeNode(Node& node)
   // call signal
   nodeDeleted(node);
 
+  if( isBatching() )
+  {
+    _batchNodes.erase(std::remove(_batchNodes.begin(), _batchNodes.end(), &node),
+                      _batchNodes.end());
+  }
+  _movedNodes.erase(std::remove(_movedNodes.begin(), _movedNodes.end(), &node),
+                    _movedNodes.end());
+  if (_selectedNodes.erase(&node))
+  {
+    _selectedNodesChanged = true;
+  }
+  _nodeIndex.remove(node);
+
   for(auto portType: {PortType::In,PortType::Out})
   {
     auto nodeState = node.nodeState();
@@ -270,7 +415,10 @@ removeNode(Node& node)
     }
   }
 
-  _nodes.erase(node.id());
+  auto it = _nodes.find(node.id());
+  UniqueNode removed = std::move(it->second);
+  _nodes.erase(it);
+  recycleNode(std::move(removed));
 }
 
 
@@ -287,6 +435,7 @@ FlowScene::
 setRegistry(std::shared_ptr<DataModelRegistry> registry)
 {
   _registry = std::move(registry);
+  clearNodePool();
 }
 
 
@@ -404,6 +553,72 @@ setNodePosition(Node& node, const QPointF& pos) const
 }
 
 
+void
+FlowScene::
+moveNodes(Node& grabbed, QPointF const& delta)
+{
+  NODE_TRACE_SCOPE("FlowScene::moveNodes");
+
+  _movedNodes = selectedNodes();
+  if (std::find(_movedNodes.begin(), _movedNodes.end(), &grabbed) == _movedNodes.end())
+  {
+    _movedNodes.push_back(&grabbed);
+  }
+  _movedNodes.erase(std::remove_if(_movedNodes.begin(), _movedNodes.end(),
+                                   [](Node* node)
+                                   {
+                                     return !(node->nodeGraphicsObject().flags() &
+                                              QGraphicsItem::ItemIsMovable);
+                                   }),
+                    _movedNodes.end());
+
+  _movingNodes = true;
+  for (Node* node : _movedNodes)
+  {
+    NodeGraphicsObject& ngo = node->nodeGraphicsObject();
+    ngo.setPos(ngo.pos() + delta);
+  }
+  _movingNodes = false;
+
+  moveConnections(_movedNodes);
+  invalidateStaticLayer();
+}
+
+
+std::vector<Node*>
+FlowScene::
+takeMovedNodes()
+{
+  std::vector<Node*> nodes;
+  nodes.swap(_movedNodes);
+  return nodes;
+}
+
+
+void
+FlowScene::
+moveConnections(std::vector<Node*> const& nodes) const
+{
+  std::unordered_set<Connection*> connections;
+  for (Node* node : nodes)
+  {
+    for (PortType portType : {PortType::In, PortType::Out})
+    {
+      for (auto const & entry : node->nodeState().getEntries(portType))
+      {
+        for (auto const & con : entry)
+        {
+          if (connections.insert(con.second).second)
+          {
+            con.second->connectionGraphicsObject().move();
+          }
+        }
+      }
+    }
+  }
+}
+
+
 QSizeF
 FlowScene::
 getNodeSize(const Node& node) const
@@ -429,26 +644,32 @@ connections() const
 }
 
 
-std::vector<Node*>
+std::vector<Node*> const&
 FlowScene::
 selectedNodes() const
 {
-  QList<QGraphicsItem*> graphicsItems = selectedItems();
+  if (_selectedNodesChanged)
+  {
+    _selectedNodesVector.assign(_selectedNodes.begin(), _selectedNodes.end());
+    _selectedNodesChanged = false;
+  }
+  return _selectedNodesVector;
+}
 
-  std::vector<Node*> ret;
-  ret.reserve(graphicsItems.size());
 
-  for (QGraphicsItem* item : graphicsItems)
+void
+FlowScene::
+nodeSelectionChanged(Node& node, bool selected)
+{
+  if (selected)
   {
-    auto ngo = qgraphicsitem_cast<NodeGraphicsObject*>(item);
-
-    if (ngo != nullptr)
-    {
-      ret.push_back(&ngo->node());
-    }
+    _selectedNodes.insert(&node);
   }
-
-  return ret;
+  else
+  {
+    _selectedNodes.erase(&node);
+  }
+  _selectedNodesChanged = true;
 }
 
 
@@ -458,6 +679,8 @@ void
 FlowScene::
 clearScene()
 {
+  NODE_TRACE_SCOPE("FlowScene::clearScene");
+
   //Manual node cleanup. Simply clearing the holding datastructures doesn't work, the code crashes when
   // there are both nodes and connections in the scene. (The data propagation internal logic tries to propagate
   // data through already freed connections.)
@@ -595,9 +818,11 @@ loadFromMemory(const QByteArray& data)
 
 void FlowScene::setLayout( QtNodes::PortLayout layout)
 {
+  NODE_TRACE_SCOPE("FlowScene::setLayout");
   _layout = layout;
   for(auto& node: nodes() )
   {
+    node.second->nodeGraphicsObject().setGeometryChanged();
     node.second->nodeGeometry().setPortLayout(layout);
   }
   for(auto& conn: connections() )
@@ -611,42 +836,130 @@ QtNodes::PortLayout FlowScene::layout() const
   return _layout;
 }
 
-//------------------------------------------------------------------------------
-namespace QtNodes
+void FlowScene::setLevelOfDetail(LevelOfDetail lod)
 {
+  if( lod == _levelOfDetail )
+  {
+    return;
+  }
+  NODE_TRACE_SCOPE("FlowScene::setLevelOfDetail");
+  _levelOfDetail = lod;
+  for(auto& node: nodes() )
+  {
+    node.second->nodeGraphicsObject().setLevelOfDetail(lod);
+  }
+}
 
-Node*
-locateNodeAt(QPointF scenePoint, FlowScene &scene,
-             QTransform const & viewTransform)
+void FlowScene::setStaticLayer(bool enabled)
 {
-  // items under cursor
-  QList<QGraphicsItem*> items =
-    scene.items(scenePoint,
-                Qt::IntersectsItemShape,
-                Qt::DescendingOrder,
-                viewTransform);
+  if( enabled == _staticLayer )
+  {
+    return;
+  }
+  _staticLayer = enabled;
+  for(auto& node: nodes() )
+  {
+    node.second->nodeGraphicsObject().setStaticLayer(enabled);
+  }
+  emit staticLayerInvalidated();
+}
 
-  //// items convertable to NodeGraphicsObject
-  std::vector<QGraphicsItem*> filteredItems;
+void FlowScene::invalidateStaticLayer()
+{
+  if( _staticLayer )
+  {
+    emit staticLayerInvalidated();
+  }
+}
 
-  std::copy_if(items.begin(),
-               items.end(),
-               std::back_inserter(filteredItems),
-               [] (QGraphicsItem * item)
-    {
-      return (dynamic_cast<NodeGraphicsObject*>(item) != nullptr);
-    });
 
-  Node* resultNode = nullptr;
+QGraphicsProxyWidget*
+FlowScene::
+takeProxyWidget(NodeGraphicsObject* node)
+{
+  if (_proxyPool.empty())
+  {
+    return new QGraphicsProxyWidget(node);
+  }
+  QGraphicsProxyWidget* proxy = _proxyPool.back();
+  _proxyPool.pop_back();
+  // added to the scene with its parent
+  proxy->setParentItem(node);
+  proxy->setVisible(true);
+  return proxy;
+}
+
+
+void
+FlowScene::
+recycleProxyWidget(QGraphicsProxyWidget* proxy)
+{
+  // as many as the widgets released at once by a scroll
+  const size_t maxPooled = 64;
+
+  removeItem(proxy);
+  if (_proxyPool.size() < maxPooled)
+  {
+    proxy->setVisible(false);
+    _proxyPool.push_back(proxy);
+  }
+  else
+  {
+    proxy->deleteLater();
+  }
+}
+
+
+void
+FlowScene::
+beginBatch()
+{
+  _batchDepth++;
+}
+
 
-  if (!filteredItems.empty())
+void
+FlowScene::
+endBatch()
+{
+  if( _batchDepth > 1 )
   {
-    QGraphicsItem* graphicsItem = filteredItems.front();
-    auto ngo = dynamic_cast<NodeGraphicsObject*>(graphicsItem);
+    _batchDepth--;
+    return;
+  }
+  NODE_TRACE_SCOPE("FlowScene::endBatch");
+
+  std::vector<Node*> nodes;
+  std::swap(nodes, _batchNodes);
 
-    resultNode = &ngo->node();
+  // still batching: the receivers resize the nodes for free
+  sceneRebuilt(nodes);
+  _batchDepth = 0;
+
+  for(Node* node: nodes)
+  {
+    if( auto widget = node->nodeDataModel()->embeddedWidget() )
+    {
+      widget->adjustSize();
+    }
+    node->nodeGeometry().recalculateSizeIfDirty();
+  }
+  for(Node* node: nodes)
+  {
+    node->nodeGraphicsObject().moveConnections();
   }
+}
+
+//------------------------------------------------------------------------------
+namespace QtNodes
+{
+
+Node*
+locateNodeAt(QPointF scenePoint, FlowScene &scene,
+             QTransform const & viewTransform)
+{
+  Q_UNUSED(viewTransform);
 
-  return resultNode;
+  return scene.nodeIndex().nodeAt(scenePoint);
 }
 }
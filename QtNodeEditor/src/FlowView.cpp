@@ -10,10 +10,14 @@
 #include <QtCore/QPointF>
 
 #include <QtWidgets>
+#ifndef QT_NO_OPENGL
+#include <QtWidgets/QOpenGLWidget>
+#endif
 
 #include <QDebug>
 #include <iostream>
 #include <cmath>
+#include <algorithm>
 
 #include "FlowScene.hpp"
 #include "DataModelRegistry.hpp"
@@ -21,9 +25,26 @@
 #include "NodeGraphicsObject.hpp"
 #include "ConnectionGraphicsObject.hpp"
 #include "StyleCollection.hpp"
+#include "SceneRender.hpp"
+#include "Trace.hpp"
 
 using QtNodes::FlowView;
 using QtNodes::FlowScene;
+using QtNodes::FrameStats;
+using QtNodes::PaintCounters;
+
+int PaintCounters::nodes = 0;
+int PaintCounters::connections = 0;
+
+namespace
+{
+
+// in device pixels
+const int STATIC_TILE_SIZE = 512;
+// 64 tiles of 1 MB
+const int STATIC_TILES_CACHE_KB = 64 * 1024;
+
+}
 
 FlowView::
 FlowView(QWidget *parent)
@@ -31,6 +52,9 @@ FlowView(QWidget *parent)
   , _clearSelectionAction(Q_NULLPTR)
   , _deleteSelectionAction(Q_NULLPTR)
   , _scene(Q_NULLPTR)
+  , _fpsFrames(0)
+  , _hudVisible(false)
+  , _staticTiles(STATIC_TILES_CACHE_KB)
 {
   setDragMode(QGraphicsView::ScrollHandDrag);
   setRenderHint(QPainter::Antialiasing);
@@ -48,8 +72,6 @@ FlowView(QWidget *parent)
   setTransformationAnchor(QGraphicsView::AnchorUnderMouse);
 
   setCacheMode(QGraphicsView::CacheBackground);
-
-  //setViewport(new QGLWidget(QGLFormat(QGL::SampleBuffers)));
 }
 
 
@@ -80,9 +102,18 @@ deleteSelectionAction() const
 void
 FlowView::setScene(FlowScene *scene)
 {
+  if (_scene)
+  {
+    disconnect(_scene, &FlowScene::staticLayerInvalidated,
+               this, &FlowView::invalidateStaticLayer);
+  }
   _scene = scene;
   QGraphicsView::setScene(_scene);
 
+  connect(_scene, &FlowScene::staticLayerInvalidated,
+          this, &FlowView::invalidateStaticLayer);
+  _staticTiles.clear();
+
   // setup actions
   delete _clearSelectionAction;
   _clearSelectionAction = new QAction(QStringLiteral("Clear Selection"), this);
@@ -266,10 +297,11 @@ deleteSelectedNodes()
   // Selected connections were already deleted prior to this loop, otherwise
   // qgraphicsitem_cast<NodeGraphicsObject*>(item) could be a use-after-free
   // when a selected connection is deleted by deleting the node.
-  for (QGraphicsItem * item : _scene->selectedItems())
+  // a copy: removeNode() changes the selection
+  std::vector<QtNodes::Node*> const nodes = _scene->selectedNodes();
+  for (QtNodes::Node* node : nodes)
   {
-    if (auto n = qgraphicsitem_cast<NodeGraphicsObject*>(item))
-      _scene->removeNode(n->node());
+    _scene->removeNode(*node);
   }
 
   finishNodeDelete();
@@ -340,6 +372,23 @@ mouseMoveEvent(QMouseEvent *event)
 }
 
 
+void
+FlowView::
+centerScene(QPointF const& scenePos)
+{
+  QPointF const difference = scenePos - visibleSceneRect().center();
+  setSceneRect(sceneRect().translated(difference.x(), difference.y()));
+}
+
+
+QRectF
+FlowView::
+visibleSceneRect() const
+{
+  return mapToScene(viewport()->rect()).boundingRect();
+}
+
+
 void
 FlowView::
 drawBackground(QPainter* painter, const QRectF& r)
@@ -392,6 +441,152 @@ drawBackground(QPainter* painter, const QRectF& r)
 
   painter->setPen(p);
   //drawGrid(150);
+
+  if (_scene && _scene->isStaticLayer())
+  {
+    drawStaticLayer(painter, r);
+  }
+}
+
+
+void
+FlowView::
+drawStaticLayer(QPainter* painter, QRectF const& r)
+{
+  NODE_TRACE_SCOPE("FlowView::drawStaticLayer");
+
+  // rounded, to find the same tiles when zooming back
+  int const zoomKey = qRound(transform().m11() * 1000.0);
+  if (zoomKey <= 0)
+  {
+    return;
+  }
+  qreal const zoom     = zoomKey / 1000.0;
+  qreal const tileSide = STATIC_TILE_SIZE / zoom;
+  qreal const ratio    = devicePixelRatioF();
+  int const   cost     = int(STATIC_TILE_SIZE * STATIC_TILE_SIZE * 4 * ratio * ratio / 1024);
+
+  int const left   = int(std::floor(r.left() / tileSide));
+  int const right  = int(std::floor(r.right() / tileSide));
+  int const top    = int(std::floor(r.top() / tileSide));
+  int const bottom = int(std::floor(r.bottom() / tileSide));
+
+  for (int y = top; y <= bottom; ++y)
+  {
+    for (int x = left; x <= right; ++x)
+    {
+      QRectF const tileRect(x * tileSide, y * tileSide, tileSide, tileSide);
+      QString const key = QString("%1:%2:%3").arg(zoomKey).arg(x).arg(y);
+
+      QPixmap* tile = _staticTiles.object(key);
+      if (!tile)
+      {
+        tile = new QPixmap(renderStaticTile(tileRect, zoom));
+        _staticTiles.insert(key, tile, cost);
+        _frameStats.tilesRendered++;
+      }
+      painter->drawPixmap(tileRect, *tile, QRectF(tile->rect()));
+    }
+  }
+}
+
+
+QPixmap
+FlowView::
+renderStaticTile(QRectF const& tileRect, qreal zoom) const
+{
+  qreal const ratio = devicePixelRatioF();
+
+  QPixmap tile(QSize(STATIC_TILE_SIZE, STATIC_TILE_SIZE) * ratio);
+  tile.setDevicePixelRatio(ratio);
+  tile.fill(Qt::transparent);
+
+  QPainter painter(&tile);
+  painter.setRenderHints(renderHints());
+  painter.scale(zoom, zoom);
+  painter.translate(-tileRect.topLeft());
+  renderScene(*_scene, painter, tileRect, levelOfDetail(zoom), SceneLayer::Static);
+  return tile;
+}
+
+
+void
+FlowView::
+invalidateStaticLayer()
+{
+  _staticTiles.clear();
+  // the tiles are drawn in the background
+  resetCachedContent();
+  viewport()->update();
+}
+
+
+void
+FlowView::
+drawForeground(QPainter* painter, const QRectF& r)
+{
+  QGraphicsView::drawForeground(painter, r);
+
+  if (!_hudVisible)
+  {
+    return;
+  }
+
+  // the counts of the previous frame: this one is not over
+  FrameStats const stats = frameStats();
+
+  static const char* lodNames[] = { "low", "medium", "full" };
+
+  QStringList lines = {
+    QString("%1 fps, %2 ms")
+      .arg(stats.fps, 0, 'f', 1)
+      .arg(stats.paintUs * 0.001, 0, 'f', 1),
+    QString("nodes: %1, connections: %2")
+      .arg(stats.nodes)
+      .arg(stats.connections),
+    QString("widgets: %1 shown of %2")
+      .arg(stats.visibleWidgets)
+      .arg(stats.widgets),
+    QString("repainted: %1 nodes, %2 connections")
+      .arg(stats.nodesRepainted)
+      .arg(stats.connectionsRepainted),
+    QString("detail: %1").arg(lodNames[int(stats.levelOfDetail)])
+  };
+  if (stats.staticLayer)
+  {
+    lines.push_back(QString("static layer: %1 tiles rendered").arg(stats.tilesRendered));
+  }
+
+  painter->save();
+  painter->resetTransform();
+  painter->setClipping(false);
+  painter->setRenderHint(QPainter::Antialiasing, false);
+
+  QFont font = painter->font();
+  font.setStyleHint(QFont::Monospace);
+  font.setFamily("monospace");
+  painter->setFont(font);
+
+  QFontMetrics const metrics(font);
+  int width = 0;
+  for (auto const& line : lines)
+  {
+    width = std::max(width, metrics.width(line));
+  }
+  int const margin = 6;
+  QRect const box(margin, margin,
+                  width + 2 * margin,
+                  lines.size() * metrics.height() + 2 * margin);
+
+  painter->fillRect(box, QColor(0, 0, 0, 170));
+  painter->setPen(Qt::white);
+  for (int i = 0; i < lines.size(); ++i)
+  {
+    painter->drawText(box.left() + margin,
+                      box.top() + margin + i * metrics.height() + metrics.ascent(),
+                      lines[i]);
+  }
+  painter->restore();
 }
 
 
@@ -404,6 +599,125 @@ showEvent(QShowEvent *event)
 }
 
 
+void
+FlowView::
+setOpenGLViewport(bool enabled, int samples)
+{
+#ifndef QT_NO_OPENGL
+  if (enabled == isOpenGLViewport())
+  {
+    return;
+  }
+  if (enabled)
+  {
+    auto glWidget = new QOpenGLWidget();
+    QSurfaceFormat format = QSurfaceFormat::defaultFormat();
+    format.setSamples(samples);
+    glWidget->setFormat(format);
+    setViewport(glWidget);
+  }
+  else
+  {
+    setViewport(new QWidget());
+  }
+  // OpenGL can not update a part of the viewport: it is always redrawn
+  // entirely, the raster viewport too since the connections span it all
+  setViewportUpdateMode(QGraphicsView::FullViewportUpdate);
+#else
+  Q_UNUSED(enabled);
+  Q_UNUSED(samples);
+#endif
+}
+
+
+FrameStats
+FlowView::
+frameStats() const
+{
+  FrameStats stats = _frameStats;
+  if (_scene)
+  {
+    stats.nodes = int(_scene->nodes().size());
+    stats.connections = int(_scene->connections().size());
+    for (auto const& node : _scene->nodes())
+    {
+      if (auto proxy = node.second->nodeGraphicsObject().proxyWidget())
+      {
+        stats.widgets++;
+        stats.visibleWidgets += proxy->isVisible() ? 1 : 0;
+      }
+    }
+    stats.levelOfDetail = _scene->levelOfDetail();
+    stats.staticLayer = _scene->isStaticLayer();
+  }
+  return stats;
+}
+
+
+void
+FlowView::
+setPerformanceHudVisible(bool visible)
+{
+  _hudVisible = visible;
+  viewport()->update();
+}
+
+
+bool
+FlowView::
+isOpenGLViewport() const
+{
+#ifndef QT_NO_OPENGL
+  return qobject_cast<QOpenGLWidget*>(viewport()) != nullptr;
+#else
+  return false;
+#endif
+}
+
+
+void
+FlowView::
+paintEvent(QPaintEvent *event)
+{
+  NODE_TRACE_SCOPE("FlowView::paintEvent");
+
+  // the embedded widgets are not drawn by the nodes: they are switched
+  // here, before painting
+  if (_scene)
+  {
+    QStyleOptionGraphicsItem option;
+    _scene->setLevelOfDetail(
+      levelOfDetail(option.levelOfDetailFromTransform(transform())));
+  }
+
+  QElapsedTimer paintClock;
+  paintClock.start();
+  PaintCounters::reset();
+  _frameStats.tilesRendered = 0;
+
+  QGraphicsView::paintEvent(event);
+
+  _frameStats.paintUs = paintClock.nsecsElapsed() / 1000;
+  _frameStats.nodesRepainted = PaintCounters::nodes;
+  _frameStats.connectionsRepainted = PaintCounters::connections;
+  _frameStats.frames++;
+
+  // the frames of the last second
+  if (!_fpsClock.isValid())
+  {
+    _fpsClock.start();
+  }
+  _fpsFrames++;
+  qint64 const elapsed = _fpsClock.elapsed();
+  if (elapsed >= 1000)
+  {
+    _frameStats.fps = _fpsFrames * 1000.0 / elapsed;
+    _fpsFrames = 0;
+    _fpsClock.restart();
+  }
+}
+
+
 FlowScene *
 FlowView::
 scene()
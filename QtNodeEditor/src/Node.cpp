@@ -12,6 +12,7 @@
 
 #include "ConnectionGraphicsObject.hpp"
 #include "ConnectionState.hpp"
+#include "Uuid.hpp"
 
 using QtNodes::Node;
 using QtNodes::NodeGeometry;
@@ -25,7 +26,7 @@ using QtNodes::PortType;
 
 Node::
 Node(std::unique_ptr<NodeDataModel> && dataModel)
-  : _uid(QUuid::createUuid())
+  : _uid(detail::createUuid())
   , _nodeDataModel(std::move(dataModel))
   , _nodeState(_nodeDataModel)
   , _nodeGeometry(_nodeDataModel)
@@ -33,6 +34,14 @@ Node(std::unique_ptr<NodeDataModel> && dataModel)
 {
   _nodeGeometry.recalculateSize();
 
+  connectModel();
+}
+
+
+void
+Node::
+connectModel()
+{
   // propagate data: model => node
   connect(_nodeDataModel.get(), &NodeDataModel::dataUpdated,
           this, &Node::onDataUpdated);
@@ -42,6 +51,32 @@ Node(std::unique_ptr<NodeDataModel> && dataModel)
 }
 
 
+void
+Node::
+disconnectModel()
+{
+  QObject::disconnect(_nodeDataModel.get(), nullptr, nullptr, nullptr);
+  connectModel();
+}
+
+
+bool
+Node::
+resetForReuse()
+{
+  if (!_nodeDataModel->resetForReuse())
+  {
+    return false;
+  }
+  _uid = detail::createUuid();
+  _nodeState.setReaction(NodeState::NOT_REACTING);
+  _nodeState.setResizing(false);
+  _nodeGeometry.setHovered(false);
+  _nodeGeometry.setDirty();
+  return true;
+}
+
+
 Node::
 ~Node() = default;
 
@@ -49,10 +84,20 @@ QJsonObject
 Node::
 save() const
 {
-  QJsonObject nodeJson;
+  QJsonObject nodeJson = saveContent();
 
   nodeJson["id"] = _uid.toString();
 
+  return nodeJson;
+}
+
+
+QJsonObject
+Node::
+saveContent() const
+{
+  QJsonObject nodeJson;
+
   nodeJson["model"] = _nodeDataModel->save();
 
   double width = _nodeGraphicsObject->boundingRect().width();
@@ -70,7 +115,15 @@ void
 Node::
 restore(QJsonObject const& json)
 {
-  _uid = QUuid(json["id"].toString());
+  restore(json, QUuid(json["id"].toString()));
+}
+
+
+void
+Node::
+restore(QJsonObject const& json, QUuid const& id)
+{
+  _uid = id;
   _nodeDataModel->restore(json["model"].toObject());
 
   double width = _nodeGraphicsObject->boundingRect().width();
@@ -218,11 +271,21 @@ void
 Node::
 onNodeSizeUpdated()
 {
+    if( _nodeGraphicsObject && _nodeGraphicsObject->flowScene().isBatching() )
+    {
+        // FlowScene::endBatch() computes the size
+        _nodeGraphicsObject->setGeometryChanged();
+        return;
+    }
     int prev_width = nodeGeometry().width();
     if( nodeDataModel()->embeddedWidget() )
     {
         nodeDataModel()->embeddedWidget()->adjustSize();
     }
+    if( _nodeGraphicsObject )
+    {
+        _nodeGraphicsObject->setGeometryChanged();
+    }
     nodeGeometry().recalculateSize();
     int new_width = nodeGeometry().width();
 
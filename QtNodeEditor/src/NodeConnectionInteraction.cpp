@@ -157,6 +157,8 @@ disconnect(PortType portToDisconnect) const
   // clear Connection side
   _connection->clearNode(portToDisconnect);
 
+  _scene->connectionDetached(*_connection, *_node);
+
   _connection->setRequiredPort(portToDisconnect);
 
   _connection->connectionGraphicsObject().grabMouse();
@@ -19,6 +19,20 @@ using QtNodes::PortType;
 using QtNodes::PortLayout;
 using QtNodes::Node;
 
+namespace
+{
+// the embedded widget, or what the model paints in its place
+QSize
+embeddedSize(NodeDataModel & model)
+{
+  if (auto w = model.embeddedWidget())
+  {
+    return w->size();
+  }
+  return model.embeddedSize();
+}
+}
+
 NodeGeometry::
 NodeGeometry(std::unique_ptr<NodeDataModel> const &dataModel)
   : _width(50)
@@ -33,6 +47,7 @@ NodeGeometry(std::unique_ptr<NodeDataModel> const &dataModel)
   , _fontMetrics(QFont())
   , _boldFontMetrics(QFont())
   , _ports_layout(PortLayout::Vertical  )
+  , _dirty(true)
 {
   QFont f;
   f.setPointSize(12);
@@ -68,6 +83,8 @@ QRectF
 NodeGeometry::
 boundingRect() const
 {
+  recalculateSizeIfDirty();
+
   auto const &nodeStyle = StyleCollection::nodeStyle();
 
   double addon = 2 * nodeStyle.ConnectionPointDiameter;
@@ -83,6 +100,7 @@ void
 NodeGeometry::
 recalculateSize() const
 {
+  _dirty = false;
   _entryHeight = _fontMetrics.height();
 
   {
@@ -91,9 +109,10 @@ recalculateSize() const
     _height = step * maxNumOfEntries;
   }
 
-  if (auto w = _dataModel->embeddedWidget())
+  QSize const embedded = embeddedSize(*_dataModel);
+  if (embedded.isValid())
   {
-    _height = std::max(_height, w->height());
+    _height = std::max(_height, embedded.height());
   }
 
   _inputPortWidth  = portWidth(PortType::In);
@@ -103,9 +122,9 @@ recalculateSize() const
            _outputPortWidth +
            2 * _spacing;
 
-  if (auto w = _dataModel->embeddedWidget())
+  if (embedded.isValid())
   {
-    _width += w->width();
+    _width += embedded.width();
   }
 
   if (_dataModel->validationState() != NodeValidationState::Valid)
@@ -218,16 +237,17 @@ QPointF
 NodeGeometry::
 widgetPosition() const
 {
-  if (auto w = _dataModel->embeddedWidget())
+  QSize const embedded = embeddedSize(*_dataModel);
+  if (embedded.isValid())
   {
     if (_dataModel->validationState() != NodeValidationState::Valid)
     {
       return QPointF(_spacing + portWidth(PortType::In),
-                     ( _height - validationHeight() - _spacing - w->height()) / 2.0);
+                     ( _height - validationHeight() - _spacing - embedded.height()) / 2.0);
     }
 
     return QPointF(_spacing + portWidth(PortType::In),
-                   ( _height - w->height()) / 2.0);
+                   ( _height - embedded.height()) / 2.0);
   }
 
   return QPointF();
@@ -270,7 +290,11 @@ calculateNodePositionBetweenNodePorts(PortIndex targetPortIndex, PortType target
 
 void NodeGeometry::setPortLayout(QtNodes::PortLayout layout)
 {
-    _ports_layout = layout;
+    if( layout != _ports_layout )
+    {
+        _ports_layout = layout;
+        _dirty = true;
+    }
 }
 
 
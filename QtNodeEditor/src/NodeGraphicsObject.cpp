@@ -4,7 +4,6 @@
 #include <cstdlib>
 
 #include <QtWidgets/QtWidgets>
-#include <QtWidgets/QGraphicsEffect>
 
 #include "ConnectionGraphicsObject.hpp"
 #include "ConnectionState.hpp"
@@ -17,6 +16,7 @@
 #include "NodeConnectionInteraction.hpp"
 
 #include "StyleCollection.hpp"
+#include "FrameStats.hpp"
 
 using QtNodes::NodeGraphicsObject;
 using QtNodes::Node;
@@ -30,6 +30,8 @@ NodeGraphicsObject(FlowScene &scene,
   , _locked(false)
   , _double_clicked(false)
   , _proxyWidget(nullptr)
+  , _levelOfDetail(LevelOfDetail::Full)
+  , _staticLayer(false)
 {
   _scene.addItem(this);
 
@@ -43,14 +45,7 @@ NodeGraphicsObject(FlowScene &scene,
 
   auto const &nodeStyle = node.nodeDataModel()->nodeStyle();
 
-  {
-    auto effect = new QGraphicsDropShadowEffect;
-    effect->setOffset(2, 2);
-    effect->setBlurRadius(5);
-    effect->setColor(nodeStyle.ShadowColor);
-
-    setGraphicsEffect(effect);
-  }
+  // the shadow is drawn by NodePainter
 
   setOpacity(nodeStyle.Opacity);
 
@@ -60,13 +55,40 @@ NodeGraphicsObject(FlowScene &scene,
 
   updateEmbeddedQWidget();
 
+  setLevelOfDetail(scene.levelOfDetail());
+
+  setStaticLayer(scene.isStaticLayer());
+  _scene.invalidateStaticLayer();
 }
 
 
 NodeGraphicsObject::
 ~NodeGraphicsObject()
 {
-  _scene.removeItem(this);
+  // out of the scene while pooled
+  if (scene() == &_scene)
+  {
+    _scene.removeItem(this);
+  }
+  _scene.invalidateStaticLayer();
+}
+
+
+void
+NodeGraphicsObject::
+resetForReuse()
+{
+  _scene.addItem(this);
+
+  lock(false);
+  _double_clicked = false;
+  setZValue(0);
+  setOpacity(_node.nodeDataModel()->nodeStyle().Opacity);
+
+  updateEmbeddedQWidget();
+  setLevelOfDetail(_scene.levelOfDetail());
+  setStaticLayer(_scene.isStaticLayer());
+  setGeometryChanged();
 }
 
 
@@ -90,16 +112,36 @@ NodeGraphicsObject::
 updateEmbeddedQWidget()
 {
   NodeGeometry & geom = _node.nodeGeometry();
+  QWidget* w = _node.nodeDataModel()->embeddedWidget();
 
+  if (_proxyWidget && _proxyWidget->widget() == w)
+  {
+    // only resized
+    geom.recalculateSize();
+    _scene.nodeIndex().invalidate(_node);
+    _proxyWidget->setPos(geom.widgetPosition());
+    update();
+    _scene.invalidateStaticLayer();
+    return;
+  }
+
+  bool const released = (_proxyWidget != nullptr);
   if( _proxyWidget )
   {
-    _scene.removeItem(_proxyWidget);
-    _proxyWidget->deleteLater();
+    // the widget was released by the model, that still owns it
+    QWidget* old = _proxyWidget->widget();
+    _proxyWidget->setWidget(nullptr);
+    if (old)
+    {
+      old->hide();
+    }
+    _scene.recycleProxyWidget(_proxyWidget);
+    _proxyWidget = nullptr;
   }
 
-  if (auto w = _node.nodeDataModel()->embeddedWidget())
+  if (w)
   {
-    _proxyWidget = new QGraphicsProxyWidget(this);
+    _proxyWidget = _scene.takeProxyWidget(this);
 
     _proxyWidget->setWidget(w);
 
@@ -113,7 +155,60 @@ updateEmbeddedQWidget()
 
     _proxyWidget->setOpacity(1.0);
     _proxyWidget->setFlag(QGraphicsItem::ItemIgnoresParentOpacity);
+    _proxyWidget->setVisible(isWidgetShown());
   }
+  else if (released)
+  {
+    // painted by the model from now on
+    setGeometryChanged();
+    geom.recalculateSize();
+    update();
+  }
+  _scene.invalidateStaticLayer();
+}
+
+
+void
+NodeGraphicsObject::
+setLevelOfDetail(LevelOfDetail lod)
+{
+  if (lod == _levelOfDetail)
+  {
+    return;
+  }
+  _levelOfDetail = lod;
+
+  if (_proxyWidget)
+  {
+    _proxyWidget->setVisible(isWidgetShown());
+  }
+  update();
+}
+
+
+void
+NodeGraphicsObject::
+setStaticLayer(bool enabled)
+{
+  if (enabled == _staticLayer)
+  {
+    return;
+  }
+  _staticLayer = enabled;
+
+  if (_proxyWidget)
+  {
+    _proxyWidget->setVisible(isWidgetShown());
+  }
+  update();
+}
+
+
+bool
+NodeGraphicsObject::
+isWidgetShown() const
+{
+  return _levelOfDetail == LevelOfDetail::Full && !_staticLayer;
 }
 
 
@@ -130,6 +225,9 @@ NodeGraphicsObject::
 setGeometryChanged()
 {
   prepareGeometryChange();
+  _node.nodeGeometry().setDirty();
+  _scene.invalidateStaticLayer();
+  _scene.nodeIndex().invalidate(_node);
 }
 
 
@@ -169,7 +267,12 @@ paint(QPainter * painter,
 {
   painter->setClipRect(option->exposedRect);
 
-  NodePainter::paint(painter, _node, _scene);
+  LevelOfDetail const lod =
+    levelOfDetail(option->levelOfDetailFromTransform(painter->worldTransform()));
+
+  PaintCounters::nodes++;
+  NodePainter::paint(painter, _node, _scene, lod,
+                     _staticLayer ? SceneLayer::Overlay : SceneLayer::All);
 }
 
 
@@ -177,10 +280,23 @@ QVariant
 NodeGraphicsObject::
 itemChange(GraphicsItemChange change, const QVariant &value)
 {
-  if (change == ItemPositionChange && scene())
+  // FlowScene::moveNodes() moves the connections and invalidates once
+  if (change == ItemPositionChange && scene() && !_scene.isMovingNodes())
   {
     moveConnections();
   }
+  else if (change == ItemScenePositionHasChanged)
+  {
+    _scene.nodeIndex().invalidate(_node);
+    if (!_scene.isMovingNodes())
+    {
+      _scene.invalidateStaticLayer();
+    }
+  }
+  else if (change == ItemSelectedHasChanged)
+  {
+    _scene.nodeSelectionChanged(_node, value.toBool());
+  }
 
   return QGraphicsItem::itemChange(change, value);
 }
@@ -289,6 +405,7 @@ mouseMoveEvent(QGraphicsSceneMouseEvent * event)
       _proxyWidget->setPos(geom.widgetPosition());
 
       geom.recalculateSize();
+      _scene.nodeIndex().invalidate(_node);
       update();
 
       moveConnections();
@@ -296,13 +413,18 @@ mouseMoveEvent(QGraphicsSceneMouseEvent * event)
       event->accept();
     }
   }
+  else if ((event->buttons() & Qt::LeftButton) && (flags() & ItemIsMovable))
+  {
+    // the whole selection, in a single pass
+    QPointF const delta = event->scenePos() - event->lastScenePos();
+    if (!delta.isNull())
+      _scene.moveNodes(_node, delta);
+
+    event->ignore();
+  }
   else
   {
     QGraphicsObject::mouseMoveEvent(event);
-
-    if (event->lastPos() != event->pos())
-      moveConnections();
-
     event->ignore();
   }
 
@@ -340,7 +462,15 @@ mouseReleaseEvent(QGraphicsSceneMouseEvent* event)
   QGraphicsObject::mouseReleaseEvent(event);
 
   // position connections precisely after fast node move
-  moveConnections();
+  std::vector<Node*> const movedNodes = _scene.takeMovedNodes();
+  if (movedNodes.empty())
+  {
+    moveConnections();
+  }
+  else
+  {
+    _scene.moveConnections(movedNodes);
+  }
 
   if( (event->screenPos() - _press_pos).manhattanLength() > 20 )
   {
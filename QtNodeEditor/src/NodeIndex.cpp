@@ -0,0 +1,203 @@
+#include "NodeIndex.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "Node.hpp"
+#include "Trace.hpp"
+
+using QtNodes::Node;
+using QtNodes::NodeIndex;
+
+NodeIndex::
+NodeIndex(qreal cellSize)
+  : _cellSize(cellSize)
+{}
+
+
+void
+NodeIndex::
+insert(Node& node)
+{
+  _rects.insert({&node, QRectF()});
+  _dirty.insert(&node);
+}
+
+
+void
+NodeIndex::
+remove(Node& node)
+{
+  auto it = _rects.find(&node);
+  if (it == _rects.end())
+  {
+    return;
+  }
+  removeFromCells(&node, it->second);
+  _rects.erase(it);
+  _dirty.erase(&node);
+}
+
+
+void
+NodeIndex::
+invalidate(Node& node)
+{
+  if (_rects.count(&node))
+  {
+    _dirty.insert(&node);
+  }
+}
+
+
+void
+NodeIndex::
+clear()
+{
+  _cells.clear();
+  _rects.clear();
+  _dirty.clear();
+}
+
+
+NodeIndex::CellKey
+NodeIndex::
+cellKey(int x, int y)
+{
+  return (CellKey(quint32(x)) << 32) | CellKey(quint32(y));
+}
+
+
+NodeIndex::CellRange
+NodeIndex::
+cellRange(QRectF const& rect) const
+{
+  return { int(std::floor(rect.left() / _cellSize)),
+           int(std::floor(rect.top() / _cellSize)),
+           int(std::floor(rect.right() / _cellSize)),
+           int(std::floor(rect.bottom() / _cellSize)) };
+}
+
+
+void
+NodeIndex::
+removeFromCells(Node* node, QRectF const& rect)
+{
+  if (rect.isNull())
+  {
+    return;
+  }
+  CellRange const range = cellRange(rect);
+  for (int x = range.left; x <= range.right; ++x)
+  {
+    for (int y = range.top; y <= range.bottom; ++y)
+    {
+      auto it = _cells.find(cellKey(x, y));
+      if (it == _cells.end())
+      {
+        continue;
+      }
+      auto& nodes = it->second;
+      nodes.erase(std::remove(nodes.begin(), nodes.end(), node), nodes.end());
+      if (nodes.empty())
+      {
+        _cells.erase(it);
+      }
+    }
+  }
+}
+
+
+void
+NodeIndex::
+refresh()
+{
+  if (_dirty.empty())
+  {
+    return;
+  }
+  NODE_TRACE_SCOPE("NodeIndex::refresh");
+
+  for (Node* node : _dirty)
+  {
+    QRectF& rect = _rects[node];
+    QRectF const newRect = node->nodeGraphicsObject().sceneBoundingRect();
+    if (newRect == rect)
+    {
+      continue;
+    }
+    removeFromCells(node, rect);
+    rect = newRect;
+
+    CellRange const range = cellRange(rect);
+    for (int x = range.left; x <= range.right; ++x)
+    {
+      for (int y = range.top; y <= range.bottom; ++y)
+      {
+        _cells[cellKey(x, y)].push_back(node);
+      }
+    }
+  }
+  _dirty.clear();
+}
+
+
+Node*
+NodeIndex::
+nodeAt(QPointF const& point)
+{
+  refresh();
+
+  CellRange const range = cellRange(QRectF(point, point));
+  auto it = _cells.find(cellKey(range.left, range.top));
+  if (it == _cells.end())
+  {
+    return nullptr;
+  }
+
+  Node* result = nullptr;
+  for (Node* node : it->second)
+  {
+    auto const& ngo = node->nodeGraphicsObject();
+    if (!_rects[node].contains(point) || !ngo.isVisible())
+    {
+      continue;
+    }
+    if (!result || ngo.zValue() > result->nodeGraphicsObject().zValue())
+    {
+      result = node;
+    }
+  }
+  return result;
+}
+
+
+std::vector<Node*>
+NodeIndex::
+nodesIn(QRectF const& rect)
+{
+  refresh();
+
+  std::unordered_set<Node*> found;
+  std::vector<Node*> nodes;
+  CellRange const range = cellRange(rect);
+  for (int x = range.left; x <= range.right; ++x)
+  {
+    for (int y = range.top; y <= range.bottom; ++y)
+    {
+      auto it = _cells.find(cellKey(x, y));
+      if (it == _cells.end())
+      {
+        continue;
+      }
+      for (Node* node : it->second)
+      {
+        if (_rects[node].intersects(rect) && found.insert(node).second)
+        {
+          nodes.push_back(node);
+        }
+      }
+    }
+  }
+  return nodes;
+}
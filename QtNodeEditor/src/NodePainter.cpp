@@ -1,8 +1,16 @@
 #include "NodePainter.hpp"
 
 #include <cmath>
+#include <algorithm>
+#include <vector>
 
 #include <QtCore/QMargins>
+#include <QtCore/QHash>
+#include <QtGui/QImage>
+#include <QtGui/QPainterPath>
+#include <QtGui/QPixmap>
+#include <QtGui/QStaticText>
+#include <QtWidgets/qdrawutil.h>
 
 #include "StyleCollection.hpp"
 #include "PortType.hpp"
@@ -22,11 +30,157 @@ using QtNodes::NodeState;
 using QtNodes::NodeDataModel;
 using QtNodes::FlowScene;
 
+namespace
+{
+
+// same as the QGraphicsDropShadowEffect used before
+const int SHADOW_OFFSET = 2;
+const int SHADOW_BLUR   = 5;
+// the corners and the borders of the nine-patch
+const int SHADOW_MARGIN = 2 * SHADOW_BLUR;
+
+// three box blurs are close enough to a gaussian one
+void
+blurImage(QImage& image, int radius)
+{
+  int const width  = image.width();
+  int const height = image.height();
+  std::vector<QRgb> line(std::max(width, height));
+
+  for (int pass = 0; pass < 3; ++pass)
+  {
+    for (int horizontal = 1; horizontal >= 0; --horizontal)
+    {
+      int const length = horizontal ? width : height;
+      int const lines  = horizontal ? height : width;
+
+      for (int l = 0; l < lines; ++l)
+      {
+        auto pixel = [&](int i) -> QRgb&
+        {
+          return horizontal ? reinterpret_cast<QRgb*>(image.scanLine(l))[i]
+                            : reinterpret_cast<QRgb*>(image.scanLine(i))[l];
+        };
+        for (int i = 0; i < length; ++i)
+        {
+          line[i] = pixel(i);
+        }
+        for (int i = 0; i < length; ++i)
+        {
+          int sum[4] = {0, 0, 0, 0};
+          for (int k = i - radius; k <= i + radius; ++k)
+          {
+            QRgb const c = (k >= 0 && k < length) ? line[k] : 0;
+            sum[0] += qRed(c);
+            sum[1] += qGreen(c);
+            sum[2] += qBlue(c);
+            sum[3] += qAlpha(c);
+          }
+          int const n = 2 * radius + 1;
+          pixel(i) = qRgba(sum[0] / n, sum[1] / n, sum[2] / n, sum[3] / n);
+        }
+      }
+    }
+  }
+}
+
+// The caption of the nodes far away, laid out once for all the nodes of the
+// same caption, size and font.
+struct CaptionText
+{
+  QSizeF      nodeSize;
+  QFont       baseFont;
+  QFont       font;
+  QStaticText text;
+};
+
+CaptionText const&
+captionText(QString const& caption, QSizeF const& nodeSize, QFont const& baseFont)
+{
+  static QHash<QString, std::vector<CaptionText>> cache;
+  int const MAX_CAPTIONS = 4096;
+
+  auto it = cache.find(caption);
+  if (it != cache.end())
+  {
+    for (CaptionText const& entry : it.value())
+    {
+      if (entry.nodeSize == nodeSize && entry.baseFont == baseFont)
+      {
+        return entry;
+      }
+    }
+  }
+  else
+  {
+    if (cache.size() >= MAX_CAPTIONS)
+    {
+      cache.clear();
+    }
+    it = cache.insert(caption, std::vector<CaptionText>());
+  }
+
+  QFont f = baseFont;
+  f.setBold(true);
+  f.setPointSize(12);
+
+  // as large as the node allows, to be readable from afar
+  QFontMetrics const metrics(f);
+  double const factor = std::min(nodeSize.width() * 0.9 / std::max(1, metrics.width(caption)),
+                                 nodeSize.height() * 0.6 / metrics.height());
+  f.setPointSizeF(12.0 * std::max(1.0, std::min(factor, 3.0)));
+
+  CaptionText entry;
+  entry.nodeSize = nodeSize;
+  entry.baseFont = baseFont;
+  entry.font     = f;
+  entry.text     = QStaticText(caption);
+  entry.text.setTextFormat(Qt::PlainText);
+  entry.text.prepare(QTransform(), f);
+  it.value().push_back(entry);
+  return it.value().back();
+}
+
+
+// A blurred rounded rectangle, shared by all the nodes with the same shadow
+// color: only its borders are stretched to the size of the node.
+QPixmap const&
+shadowPixmap(QColor const& color)
+{
+  static QHash<QRgb, QPixmap> cache;
+
+  auto it = cache.find(color.rgba());
+  if (it != cache.end())
+  {
+    return it.value();
+  }
+
+  int const side = 2 * SHADOW_MARGIN + 1;
+  QImage image(side, side, QImage::Format_ARGB32_Premultiplied);
+  image.fill(Qt::transparent);
+  {
+    QPainter p(&image);
+    p.setRenderHint(QPainter::Antialiasing);
+    p.setPen(Qt::NoPen);
+    p.setBrush(color);
+    p.drawRoundedRect(QRectF(SHADOW_BLUR, SHADOW_BLUR,
+                             side - 2 * SHADOW_BLUR, side - 2 * SHADOW_BLUR),
+                      3.0, 3.0);
+  }
+  blurImage(image, SHADOW_BLUR / 3 + 1);
+
+  return cache.insert(color.rgba(), QPixmap::fromImage(image)).value();
+}
+
+}
+
 void
 NodePainter::
 paint(QPainter* painter,
       Node & node,
-      FlowScene const& scene)
+      FlowScene const& scene,
+      LevelOfDetail lod,
+      SceneLayer layer)
 {
   NodeGeometry const& geom = node.nodeGeometry();
 
@@ -34,16 +188,46 @@ paint(QPainter* painter,
 
   NodeGraphicsObject const & graphicsObject = node.nodeGraphicsObject();
 
-  geom.recalculateSize(painter->font());
+  // computed when the model changes, not at every paint
+  geom.recalculateSizeIfDirty();
 
   //--------------------------------------------
   NodeDataModel const * model = node.nodeDataModel();
 
-  drawNodeRect(painter, geom, model, graphicsObject);
+  bool const drawStatic  = (layer != SceneLayer::Overlay);
+  bool const drawOverlay = (layer != SceneLayer::Static);
+
+  if (lod == LevelOfDetail::Low)
+  {
+    drawFlatRect(painter, geom, model, graphicsObject, layer);
+    return;
+  }
+
+  if (lod == LevelOfDetail::Full && drawOverlay)
+  {
+    drawShadow(painter, geom, model, layer);
+  }
+
+  drawNodeRect(painter, geom, model, graphicsObject, layer);
+
+  // above the border, that is in the overlay
+  if (drawOverlay)
+  {
+    drawConnectionPoints(painter, geom, state, model, scene);
 
-  drawConnectionPoints(painter, geom, state, model, scene);
+    drawFilledConnectionPoints(painter, geom, state, model);
+  }
 
-  drawFilledConnectionPoints(painter, geom, state, model);
+  if (!drawStatic)
+  {
+    return;
+  }
+
+  if (lod == LevelOfDetail::Medium)
+  {
+    drawCaption(painter, geom, model);
+    return;
+  }
 
   drawEntryLabels(painter, geom, state, model);
 
@@ -64,7 +248,8 @@ NodePainter::
 drawNodeRect(QPainter* painter,
              NodeGeometry const& geom,
              NodeDataModel const* model,
-             NodeGraphicsObject const & graphicsObject)
+             NodeGraphicsObject const & graphicsObject,
+             SceneLayer layer)
 {
   NodeStyle const& nodeStyle = model->nodeStyle();
 
@@ -72,7 +257,11 @@ drawNodeRect(QPainter* painter,
                ? nodeStyle.SelectedBoundaryColor
                : nodeStyle.NormalBoundaryColor;
 
-  if (geom.hovered())
+  if (layer == SceneLayer::Static)
+  {
+    painter->setPen(Qt::NoPen);
+  }
+  else if (geom.hovered())
   {
     QPen p(color, nodeStyle.HoveredPenWidth);
     painter->setPen(p);
@@ -83,15 +272,22 @@ drawNodeRect(QPainter* painter,
     painter->setPen(p);
   }
 
-  QLinearGradient gradient(QPointF(0.0, 0.0),
-                           QPointF(2.0, geom.height()));
+  if (layer == SceneLayer::Overlay)
+  {
+    painter->setBrush(Qt::NoBrush);
+  }
+  else
+  {
+    QLinearGradient gradient(QPointF(0.0, 0.0),
+                             QPointF(2.0, geom.height()));
 
-  gradient.setColorAt(0.0, nodeStyle.GradientColor0);
-  gradient.setColorAt(0.03, nodeStyle.GradientColor1);
-  gradient.setColorAt(0.97, nodeStyle.GradientColor2);
-  gradient.setColorAt(1.0, nodeStyle.GradientColor3);
+    gradient.setColorAt(0.0, nodeStyle.GradientColor0);
+    gradient.setColorAt(0.03, nodeStyle.GradientColor1);
+    gradient.setColorAt(0.97, nodeStyle.GradientColor2);
+    gradient.setColorAt(1.0, nodeStyle.GradientColor3);
 
-  painter->setBrush(gradient);
+    painter->setBrush(gradient);
+  }
 
   float diam = nodeStyle.ConnectionPointDiameter;
 
@@ -103,6 +299,94 @@ drawNodeRect(QPainter* painter,
 }
 
 
+void
+NodePainter::
+drawShadow(QPainter* painter,
+           NodeGeometry const& geom,
+           NodeDataModel const* model,
+           SceneLayer layer)
+{
+  if (!NodeStyle::shadowsEnabled())
+  {
+    return;
+  }
+  NodeStyle const& nodeStyle = model->nodeStyle();
+
+  // below the boundary of drawNodeRect()
+  int const diam = int(nodeStyle.ConnectionPointDiameter);
+  QRect target(-diam, -diam, geom.width() + 2 * diam, geom.height() + 2 * diam);
+  target.translate(SHADOW_OFFSET, SHADOW_OFFSET);
+  target.adjust(-SHADOW_BLUR, -SHADOW_BLUR, SHADOW_BLUR, SHADOW_BLUR);
+
+  painter->save();
+  if (layer == SceneLayer::Overlay)
+  {
+    // drawn above the cached body of the node: around it only
+    QPainterPath around;
+    around.setFillRule(Qt::OddEvenFill);
+    around.addRect(target);
+    around.addRoundedRect(QRectF(-diam, -diam, geom.width() + 2 * diam, geom.height() + 2 * diam),
+                          3.0, 3.0);
+    painter->setClipPath(around, Qt::IntersectClip);
+  }
+
+  qDrawBorderPixmap(painter, target,
+                    QMargins(SHADOW_MARGIN, SHADOW_MARGIN, SHADOW_MARGIN, SHADOW_MARGIN),
+                    shadowPixmap(nodeStyle.ShadowColor));
+  painter->restore();
+}
+
+
+void
+NodePainter::
+drawFlatRect(QPainter* painter,
+             NodeGeometry const& geom,
+             NodeDataModel const* model,
+             NodeGraphicsObject const & graphicsObject,
+             SceneLayer layer)
+{
+  NodeStyle const& nodeStyle = model->nodeStyle();
+
+  auto color = graphicsObject.isSelected()
+               ? nodeStyle.SelectedBoundaryColor
+               : nodeStyle.NormalBoundaryColor;
+
+  // a few pixels wide whatever the zoom, to keep the status visible
+  QPen p(color, 2.0);
+  p.setCosmetic(true);
+  painter->setPen(layer == SceneLayer::Static ? QPen(Qt::NoPen) : p);
+  painter->setBrush(layer == SceneLayer::Overlay ? QBrush(Qt::NoBrush)
+                                                 : QBrush(nodeStyle.GradientColor1));
+
+  painter->drawRect(QRectF(0, 0, geom.width(), geom.height()));
+}
+
+
+void
+NodePainter::
+drawCaption(QPainter* painter,
+            NodeGeometry const& geom,
+            NodeDataModel const* model)
+{
+  QString const caption = model->caption();
+  if (caption.isEmpty())
+  {
+    return;
+  }
+  NodeStyle const& nodeStyle = model->nodeStyle();
+
+  CaptionText const& text = captionText(caption, QSizeF(geom.width(), geom.height()),
+                                        painter->font());
+  QSizeF const textSize = text.text.size();
+
+  painter->setFont(text.font);
+  painter->setPen(nodeStyle.FontColor);
+  painter->drawStaticText(QPointF((geom.width() - textSize.width()) / 2,
+                                  (geom.height() - textSize.height()) / 2),
+                          text.text);
+}
+
+
 void
 NodePainter::
 drawConnectionPoints(QPainter* painter,
@@ -258,6 +542,10 @@ drawEntryLabels(QPainter * painter,
         painter->setPen(nodeStyle.FontColor);
 
       QString s = model->dataType(portType, i).name;
+      if (s.isEmpty())
+      {
+        continue;
+      }
 
       auto rect = metrics.boundingRect(s);
 
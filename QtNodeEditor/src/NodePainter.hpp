@@ -2,6 +2,9 @@
 
 #include <QtGui/QPainter>
 
+#include "LevelOfDetail.hpp"
+#include "SceneRender.hpp"
+
 namespace QtNodes
 {
 
@@ -25,14 +28,38 @@ public:
   void
   paint(QPainter* painter,
         Node& node,
-        FlowScene const& scene);
+        FlowScene const& scene,
+        LevelOfDetail lod = LevelOfDetail::Full,
+        SceneLayer layer = SceneLayer::All);
+
+  static
+  void
+  drawShadow(QPainter* painter,
+             NodeGeometry const& geom,
+             NodeDataModel const* model,
+             SceneLayer layer = SceneLayer::All);
+
+  static
+  void
+  drawFlatRect(QPainter* painter,
+               NodeGeometry const& geom,
+               NodeDataModel const* model,
+               NodeGraphicsObject const & graphicsObject,
+               SceneLayer layer = SceneLayer::All);
+
+  static
+  void
+  drawCaption(QPainter* painter,
+              NodeGeometry const& geom,
+              NodeDataModel const* model);
 
   static
   void
   drawNodeRect(QPainter* painter,
                NodeGeometry const& geom,
                NodeDataModel const* model,
-               NodeGraphicsObject const & graphicsObject);
+               NodeGraphicsObject const & graphicsObject,
+               SceneLayer layer = SceneLayer::All);
 
   static
   void
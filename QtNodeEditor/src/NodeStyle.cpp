@@ -16,6 +16,8 @@ using QtNodes::NodeStyle;
 
 inline void initResources() { Q_INIT_RESOURCE(resources); }
 
+static bool shadows_enabled = true;
+
 NodeStyle::
 NodeStyle()
 {
@@ -46,6 +48,22 @@ setNodeStyle(QString jsonText)
 }
 
 
+void
+NodeStyle::
+setShadowsEnabled(bool enabled)
+{
+  shadows_enabled = enabled;
+}
+
+
+bool
+NodeStyle::
+shadowsEnabled()
+{
+  return shadows_enabled;
+}
+
+
 #ifdef STYLE_DEBUG
   #define NODE_STYLE_CHECK_UNDEFINED_VALUE(v, variable) { \
       if (v.type() == QJsonValue::Undefined || \
@@ -0,0 +1,70 @@
+#include "SceneRender.hpp"
+
+#include <QtGui/QPainter>
+#include <QtWidgets/QGraphicsProxyWidget>
+#include <QtWidgets/QWidget>
+
+#include "FlowScene.hpp"
+#include "Node.hpp"
+#include "NodeGraphicsObject.hpp"
+#include "NodePainter.hpp"
+#include "ConnectionGraphicsObject.hpp"
+#include "ConnectionPainter.hpp"
+#include "Trace.hpp"
+
+void
+QtNodes::
+renderScene(FlowScene& scene,
+            QPainter& painter,
+            QRectF const& sceneRect,
+            LevelOfDetail lod,
+            SceneLayer layer)
+{
+  NODE_TRACE_SCOPE("renderScene");
+
+  QTransform const baseTransform = painter.worldTransform();
+
+  // found by the index of the scene: the cost depends on the items in the
+  // rectangle, not on the size of the scene
+  auto const items = scene.items(sceneRect,
+                                 Qt::IntersectsItemBoundingRect,
+                                 Qt::AscendingOrder);
+
+  for (QGraphicsItem* item : items)
+  {
+    if (!item->isVisible())
+    {
+      continue;
+    }
+
+    if (auto connection = qgraphicsitem_cast<ConnectionGraphicsObject*>(item))
+    {
+      if (layer == SceneLayer::Static)
+      {
+        continue;
+      }
+      painter.save();
+      painter.setWorldTransform(item->sceneTransform() * baseTransform);
+      ConnectionPainter::paint(&painter, connection->connection(), lod);
+      painter.restore();
+    }
+    else if (auto nodeObject = qgraphicsitem_cast<NodeGraphicsObject*>(item))
+    {
+      painter.save();
+      painter.setWorldTransform(item->sceneTransform() * baseTransform);
+      NodePainter::paint(&painter, nodeObject->node(), scene, lod, layer);
+
+      // the proxy is a child of the node: at its position in the node
+      QGraphicsProxyWidget* proxy = nodeObject->proxyWidget();
+      if (lod == LevelOfDetail::Full && layer != SceneLayer::Overlay &&
+          proxy && proxy->widget())
+      {
+        proxy->widget()->render(&painter,
+                                proxy->pos().toPoint(),
+                                QRegion(),
+                                QWidget::DrawChildren);
+      }
+      painter.restore();
+    }
+  }
+}
@@ -0,0 +1,154 @@
+#include "Trace.hpp"
+
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QJsonObject>
+#include <QtCore/QSaveFile>
+
+using QtNodes::Trace;
+
+std::atomic<bool> Trace::_enabled(false);
+
+namespace
+{
+
+struct TraceEvent
+{
+  const char* name;
+  qint64 begin;
+  // negative for an instant event
+  qint64 duration;
+  int thread;
+};
+
+std::mutex trace_mutex;
+std::vector<TraceEvent> trace_events;
+QString trace_path;
+
+// small numbers, in order of the first event of each thread
+int
+threadNumber()
+{
+  static std::atomic<int> threads_count(0);
+  thread_local int number = ++threads_count;
+  return number;
+}
+
+
+void
+record(TraceEvent const& event)
+{
+  std::lock_guard<std::mutex> lock(trace_mutex);
+  if (Trace::enabled())
+  {
+    trace_events.push_back(event);
+  }
+}
+}
+
+
+void
+Trace::
+start(QString const& path)
+{
+  std::lock_guard<std::mutex> lock(trace_mutex);
+  trace_path = path;
+  trace_events.clear();
+  // enough not to reallocate during the startup
+  trace_events.reserve(16 * 1024);
+  _enabled = true;
+}
+
+
+bool
+Trace::
+stop()
+{
+  std::vector<TraceEvent> events;
+  QString path;
+  {
+    std::lock_guard<std::mutex> lock(trace_mutex);
+    if (!_enabled)
+    {
+      return false;
+    }
+    _enabled = false;
+    events.swap(trace_events);
+    path = trace_path;
+  }
+
+  const qint64 pid = QCoreApplication::applicationPid();
+
+  QJsonArray json_events;
+  for (auto const& event : events)
+  {
+    QJsonObject json;
+    json["name"] = QString::fromUtf8(event.name);
+    json["ts"]   = double(event.begin);
+    json["pid"]  = double(pid);
+    json["tid"]  = event.thread;
+    if (event.duration >= 0)
+    {
+      json["ph"]  = "X";
+      json["dur"] = double(event.duration);
+    }
+    else
+    {
+      json["ph"] = "i";
+      json["s"]  = "p";
+    }
+    json_events.append(json);
+  }
+
+  QJsonObject process_name;
+  process_name["name"] = "process_name";
+  process_name["ph"]   = "M";
+  process_name["pid"]  = double(pid);
+  process_name["args"] = QJsonObject{ { "name", QCoreApplication::applicationName() } };
+  json_events.append(process_name);
+
+  QJsonObject document;
+  document["traceEvents"]     = json_events;
+  document["displayTimeUnit"] = "ms";
+
+  QSaveFile file(path);
+  if (!file.open(QIODevice::WriteOnly))
+  {
+    return false;
+  }
+  file.write(QJsonDocument(document).toJson(QJsonDocument::Compact));
+  return file.commit();
+}
+
+
+qint64
+Trace::
+now()
+{
+  using namespace std::chrono;
+  return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+
+void
+Trace::
+complete(const char* name, qint64 begin_us, qint64 duration_us)
+{
+  record({ name, begin_us, duration_us, threadNumber() });
+}
+
+
+void
+Trace::
+instant(const char* name)
+{
+  if (enabled())
+  {
+    record({ name, now(), -1, threadNumber() });
+  }
+}
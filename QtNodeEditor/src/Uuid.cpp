@@ -0,0 +1,18 @@
+#include "Uuid.hpp"
+
+#include <atomic>
+
+QUuid
+QtNodes::detail::
+createUuid()
+{
+  static QUuid const base = QUuid::createUuid();
+  static std::atomic<quint64> counter(0);
+
+  quint64 const count = counter.fetch_add(1, std::memory_order_relaxed);
+
+  QUuid uuid = base;
+  uuid.data1 ^= static_cast<uint>(count);
+  uuid.data2 ^= static_cast<ushort>(count >> 32);
+  return uuid;
+}
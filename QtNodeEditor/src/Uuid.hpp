@@ -0,0 +1,18 @@
+#pragma once
+
+#include <QtCore/QUuid>
+
+namespace QtNodes
+{
+namespace detail
+{
+
+/// The ids of the nodes and of the connections, without drawing from the
+/// random source of the system each time: a random QUuid, created once,
+/// with a counter in its first 48 bits. The version and the variant stay
+/// the ones of a random QUuid, the ids still unique across the sessions.
+QUuid
+createUuid();
+
+}
+}
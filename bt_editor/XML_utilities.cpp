@@ -3,9 +3,24 @@
 
 #include "models/SubtreeNodeModel.hpp"
 #include <behaviortree_cpp_v3/xml_parsing.h>
-#include <QMessageBox>
+#include <nodes/Trace>
 #include <QtDebug>
 #include <QLineEdit>
+#include <QXmlStreamReader>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QThread>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QHash>
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QDateTime>
+#include <QCryptographicHash>
+#include <deque>
+#include <memory>
+#include <set>
 
 using namespace QtNodes;
 
@@ -79,6 +94,596 @@ NodeModel buildTreeNodeModelFromXML(const QDomElement& node)
 
 //------------------------------------------------------------------
 
+namespace
+{
+
+void throwErrorAtLine(qint64 line, const QString& text)
+{
+    throw std::runtime_error( QString("Error at line %1: -> %2").arg(line).arg(text).toStdString() );
+}
+
+const QString BEHAVIOR_TREE = "BehaviorTree";
+
+// as buildTreeNodeModelFromXML(), for the current element of the reader
+NodeModel readNodeModel(const QString& tag_name, const QXmlStreamAttributes& attributes)
+{
+    const auto node_type = BT::convertFromString<BT::NodeType>(tag_name.toStdString());
+    if( node_type == BT::NodeType::UNDEFINED )
+    {
+        return {};
+    }
+    QString ID = tag_name;
+    PortModels ports_list;
+    for (const auto& attr: attributes)
+    {
+        if( attr.name() == "ID" )
+        {
+            ID = attr.value().toString();
+        }
+        else if( attr.name() != "name" )
+        {
+            PortModel port_model;
+            port_model.direction = PortDirection::INOUT;
+            ports_list.insert( { attr.name().toString(), std::move(port_model)} );
+        }
+    }
+    return { node_type, ID, ports_list };
+}
+
+// the children of <TreeNodesModel>
+void readTreeNodesModel(QXmlStreamReader& xml, NodeModels& models)
+{
+    while( xml.readNextStartElement() )
+    {
+        NodeModel model = readNodeModel( xml.name().toString(), xml.attributes() );
+        while( xml.readNextStartElement() )
+        {
+            PortModel port_model;
+            if( xml.name() == "input_port" )
+            {
+                port_model.direction = PortDirection::INPUT;
+            }
+            else if( xml.name() == "output_port" )
+            {
+                port_model.direction = PortDirection::OUTPUT;
+            }
+            else if( xml.name() == "inout_port" )
+            {
+                port_model.direction = PortDirection::INOUT;
+            }
+            else{
+                xml.skipCurrentElement();
+                continue;
+            }
+            const auto attributes = xml.attributes();
+            port_model.type_name = attributes.value("type").toString();
+            port_model.default_value = attributes.value("default").toString();
+            const QString port_name = attributes.value("name").toString();
+            port_model.description = xml.readElementText();
+
+            if( !port_name.isEmpty() )
+            {
+                model.ports.insert( { port_name, std::move(port_model)} );
+            }
+        }
+        if( model.type != NodeType::UNDEFINED )
+        {
+            models.insert( {model.registration_ID, model} );
+        }
+    }
+}
+
+// a node of a <BehaviorTree> and its children; "used_models" are the
+// models of the nodes with a type as tag
+void readTreeNode(QXmlStreamReader& xml, XMLTree& xml_tree,
+                  AbstractTreeNode* parent, NodeModels& used_models,
+                  qint64 line_offset)
+{
+    const qint64 line = xml.lineNumber() + line_offset;
+    const QString tag_name = xml.name().toString();
+    const QXmlStreamAttributes attributes = xml.attributes();
+    const bool has_ID = attributes.hasAttribute("ID");
+
+    AbstractTreeNode tree_node;
+    tree_node.model.registration_ID = has_ID ? attributes.value("ID").toString() : tag_name;
+    tree_node.instance_name = attributes.hasAttribute("name") ?
+                attributes.value("name").toString() : tree_node.model.registration_ID;
+    for (const auto& attr: attributes)
+    {
+        if( attr.name() != "ID" && attr.name() != "name")
+        {
+            tree_node.ports_mapping.insert( { attr.name().toString(), attr.value().toString() } );
+        }
+    }
+    NodeModel model = readNodeModel( tag_name, attributes );
+    if( model.type != NodeType::UNDEFINED && !model.registration_ID.isEmpty() )
+    {
+        used_models.insert( {model.registration_ID, model} );
+    }
+    AbstractTreeNode* added_node = xml_tree.tree.addNode( parent, std::move(tree_node) );
+    xml_tree.lines.push_back( line );
+
+    int children = 0;
+    while( xml.readNextStartElement() )
+    {
+        if( tag_name == "SubTree" )
+        {
+            throwErrorAtLine( line, xml.name() == "remap" ? "<remap> was deprecated" :
+                                                            "<SubTree> should not have any child" );
+        }
+        children++;
+        readTreeNode( xml, xml_tree, added_node, used_models, line_offset );
+    }
+    if( xml.hasError() )
+    {
+        return;
+    }
+
+    // the checks of BT::VerifyXML
+    auto requireID = [&]()
+    {
+        if( !has_ID )
+        {
+            throwErrorAtLine( line, QString("The node <%1> must have the attribute [ID]").arg(tag_name) );
+        }
+    };
+    if( tag_name == "Decorator" )
+    {
+        if( children != 1 )
+        {
+            throwErrorAtLine( line, "The node <Decorator> must have exactly 1 child" );
+        }
+        requireID();
+    }
+    else if( tag_name == "Action" || tag_name == "Condition" )
+    {
+        if( children != 0 )
+        {
+            throwErrorAtLine( line, QString("The node <%1> must not have any child").arg(tag_name) );
+        }
+        requireID();
+    }
+    else if( tag_name == "Control" )
+    {
+        if( children == 0 )
+        {
+            throwErrorAtLine( line, "The node <Control> must have at least 1 child" );
+        }
+        requireID();
+    }
+    else if( tag_name == "Sequence" || tag_name == "SequenceStar" || tag_name == "Fallback" )
+    {
+        if( children == 0 )
+        {
+            throwErrorAtLine( line, "A Control node must have at least 1 child" );
+        }
+    }
+    else if( tag_name == "SubTree" )
+    {
+        requireID();
+    }
+}
+
+// the children of a <BehaviorTree>, the reader on its start; "line_offset"
+// is added to the lines of the reader, when it reads a part of the file
+void readBehaviorTree(QXmlStreamReader& xml, XMLTree& xml_tree,
+                      NodeModels& used_models, qint64 line_offset)
+{
+    xml_tree.has_ID = xml.attributes().hasAttribute("ID");
+    xml_tree.name = xml_tree.has_ID ? xml.attributes().value("ID").toString() : BEHAVIOR_TREE;
+    const qint64 line = xml.lineNumber() + line_offset;
+    int children = 0;
+    while( xml.readNextStartElement() )
+    {
+        children++;
+        if( xml.name() != "Root" )
+        {
+            readTreeNode( xml, xml_tree, nullptr, used_models, line_offset );
+            continue;
+        }
+        // its first child is the root of the tree
+        xml_tree.has_root_tag = true;
+        if( xml.readNextStartElement() )
+        {
+            readTreeNode( xml, xml_tree, nullptr, used_models, line_offset );
+            xml.skipCurrentElement();
+        }
+    }
+    if( !xml.hasError() && children != 1 )
+    {
+        throwErrorAtLine( line, "The node <BehaviorTree> must have exactly 1 child" );
+    }
+}
+
+std::runtime_error parseError(const QXmlStreamReader& xml, qint64 line_offset = 0)
+{
+    return std::runtime_error( QString("Error parsing XML (line %1): %2")
+                               .arg( xml.lineNumber() + line_offset )
+                               .arg( xml.errorString() ).toStdString() );
+}
+
+// a <BehaviorTree> copied from the file, read by a thread of the pool
+struct TreeText
+{
+    QString text;
+    qint64 line_offset;
+
+    XMLTree tree;
+    NodeModels used_models;
+    std::string error;
+};
+
+class TreeParseTask : public QRunnable
+{
+public:
+    TreeParseTask(TreeText& tree_text): _tree_text(tree_text) {}
+
+    void run() override
+    {
+        try {
+            QXmlStreamReader xml( _tree_text.text );
+            xml.readNextStartElement();
+            readBehaviorTree( xml, _tree_text.tree, _tree_text.used_models, _tree_text.line_offset );
+            if( xml.hasError() )
+            {
+                throw parseError( xml, _tree_text.line_offset );
+            }
+        }
+        catch( std::exception& err )
+        {
+            _tree_text.error = err.what();
+        }
+        // not needed anymore
+        _tree_text.text.clear();
+    }
+
+private:
+    TreeText& _tree_text;
+};
+
+// below, the trees are read as they come
+const int PARALLEL_PARSE_CHARS = 1024*1024;
+
+}
+
+XMLDocumentContent ReadXMLDocument(const QString &xml_text)
+{
+    NODE_TRACE_SCOPE("ReadXMLDocument");
+
+    XMLDocumentContent content;
+    QXmlStreamReader xml( xml_text );
+
+    if( xml.readNextStartElement() && xml.name() != "root" )
+    {
+        throw std::runtime_error( "The XML must have a root node called <root>" );
+    }
+    content.main_tree = xml.attributes().value("main_tree_to_execute").toString();
+
+    // The trees of a large file are only tokenized by this pass, then read
+    // again in parallel: each from its own copy of the text.
+    const bool parallel = xml_text.size() > PARALLEL_PARSE_CHARS &&
+                          QThread::idealThreadCount() > 1 &&
+                          xml_text.count("<BehaviorTree") > 1;
+    std::deque<TreeText> tree_texts;
+
+    // the models declared in <TreeNodesModel> come first, wherever it is
+    NodeModels used_models;
+    bool models_read = false;
+    while( xml.readNextStartElement() )
+    {
+        if( xml.name() == "TreeNodesModel" )
+        {
+            if( models_read )
+            {
+                throwErrorAtLine( xml.lineNumber(), "Only a single node <TreeNodesModel> is supported" );
+            }
+            models_read = true;
+            readTreeNodesModel( xml, content.models );
+        }
+        else if( xml.name() == BEHAVIOR_TREE && parallel )
+        {
+            // the start tag was just read
+            const qint64 end_of_tag = xml.characterOffset();
+            const int start = xml_text.lastIndexOf( "<BehaviorTree", int(end_of_tag) - 1 );
+            const qint64 line = xml.lineNumber() - xml_text.midRef( start, int(end_of_tag) - start ).count('\n');
+            xml.skipCurrentElement();
+
+            TreeText tree_text;
+            tree_text.text = xml_text.mid( start, int(xml.characterOffset()) - start );
+            tree_text.line_offset = line - 1;
+            tree_texts.push_back( std::move(tree_text) );
+        }
+        else if( xml.name() == BEHAVIOR_TREE )
+        {
+            XMLTree xml_tree;
+            readBehaviorTree( xml, xml_tree, used_models, 0 );
+            content.trees.push_back( std::move(xml_tree) );
+        }
+        else if( xml.name() == "include" )
+        {
+            XMLInclude include;
+            include.line = xml.lineNumber();
+            include.path = xml.attributes().value("path").toString();
+            if( xml.attributes().hasAttribute("ros_pkg") )
+            {
+                throwErrorAtLine( include.line, "<include ros_pkg> is not supported" );
+            }
+            if( include.path.isEmpty() )
+            {
+                throwErrorAtLine( include.line, "The node <include> must have the attribute [path]" );
+            }
+            content.includes.push_back( std::move(include) );
+            xml.skipCurrentElement();
+        }
+        else{
+            xml.skipCurrentElement();
+        }
+    }
+
+    if( xml.hasError() )
+    {
+        throw parseError( xml );
+    }
+
+    if( !tree_texts.empty() )
+    {
+        QThreadPool pool;
+        for (auto& tree_text: tree_texts)
+        {
+            // the pool deletes the task
+            pool.start( new TreeParseTask( tree_text ) );
+        }
+        pool.waitForDone();
+
+        // in the order of the file, as if read by this thread
+        for (auto& tree_text: tree_texts)
+        {
+            if( !tree_text.error.empty() )
+            {
+                throw std::runtime_error( tree_text.error );
+            }
+            for (auto& it: tree_text.used_models)
+            {
+                used_models.insert( std::move(it) );
+            }
+            content.trees.push_back( std::move(tree_text.tree) );
+        }
+    }
+
+    for (auto& it: used_models)
+    {
+        content.models.insert( std::move(it) );
+    }
+    return content;
+}
+
+namespace
+{
+
+struct CachedFile
+{
+    QDateTime modified;
+    qint64 size = 0;
+    QByteArray hash;
+    std::shared_ptr<const XMLDocumentContent> content;
+};
+
+QMutex included_files_mutex;
+// by absolute path
+QHash<QString, CachedFile> included_files;
+
+std::shared_ptr<const XMLDocumentContent> readIncludedFile(const QString& path)
+{
+    const QFileInfo info( path );
+    {
+        QMutexLocker lock( &included_files_mutex );
+        auto it = included_files.find( path );
+        if( it != included_files.end() &&
+            it->modified == info.lastModified() && it->size == info.size() )
+        {
+            return it->content;
+        }
+    }
+
+    QFile file( path );
+    if( !file.open( QIODevice::ReadOnly ) )
+    {
+        throw std::runtime_error( QString("Can't open the included file %1").arg( path ).toStdString() );
+    }
+    const QByteArray data = file.readAll();
+    const QByteArray hash = QCryptographicHash::hash( data, QCryptographicHash::Sha1 );
+    {
+        // touched, but not modified
+        QMutexLocker lock( &included_files_mutex );
+        auto it = included_files.find( path );
+        if( it != included_files.end() && it->hash == hash )
+        {
+            it->modified = info.lastModified();
+            it->size = info.size();
+            return it->content;
+        }
+    }
+
+    std::shared_ptr<const XMLDocumentContent> content;
+    try {
+        content = std::make_shared<XMLDocumentContent>( ReadXMLDocument( QString::fromUtf8( data ) ) );
+    }
+    catch( std::exception& err )
+    {
+        throw std::runtime_error( QString("%1: %2").arg( path ).arg( err.what() ).toStdString() );
+    }
+
+    QMutexLocker lock( &included_files_mutex );
+    CachedFile cached;
+    cached.modified = info.lastModified();
+    cached.size = info.size();
+    cached.hash = hash;
+    cached.content = content;
+    included_files.insert( path, std::move(cached) );
+    return content;
+}
+
+// an included file, read by a thread of the pool
+struct IncludedFile
+{
+    QString path;
+    std::shared_ptr<const XMLDocumentContent> content;
+    std::string error;
+};
+
+class IncludeReadTask : public QRunnable
+{
+public:
+    IncludeReadTask(IncludedFile& included): _included(included) {}
+
+    void run() override
+    {
+        try {
+            _included.content = readIncludedFile( _included.path );
+        }
+        catch( std::exception& err )
+        {
+            _included.error = err.what();
+        }
+    }
+
+private:
+    IncludedFile& _included;
+};
+
+void appendIncludes(const std::vector<XMLInclude>& includes, const QString& directory,
+                    std::set<QString>& seen, std::deque<IncludedFile>& files)
+{
+    for (const auto& include: includes)
+    {
+        IncludedFile included;
+        included.path = QDir::cleanPath( QDir( directory ).absoluteFilePath( include.path ) );
+        // a file included twice, or by itself, is read once
+        if( seen.insert( included.path ).second )
+        {
+            files.push_back( std::move(included) );
+        }
+    }
+}
+
+}
+
+XMLDocumentContent ReadXMLProject(const QString &xml_text, const QString &directory)
+{
+    NODE_TRACE_SCOPE("ReadXMLProject");
+
+    XMLDocumentContent project = ReadXMLDocument( xml_text );
+
+    std::set<QString> tree_names;
+    for (const auto& xml_tree: project.trees)
+    {
+        tree_names.insert( xml_tree.name );
+    }
+    std::set<QString> seen;
+    std::deque<IncludedFile> files;
+    appendIncludes( project.includes, directory, seen, files );
+
+    // one level of includes at a time: they are all read together
+    while( !files.empty() )
+    {
+        QThreadPool pool;
+        for (auto& included: files)
+        {
+            // the pool deletes the task
+            pool.start( new IncludeReadTask( included ) );
+        }
+        pool.waitForDone();
+
+        std::deque<IncludedFile> next_files;
+        for (const auto& included: files)
+        {
+            if( !included.error.empty() )
+            {
+                throw std::runtime_error( included.error );
+            }
+            project.included_files.push_back( included.path );
+            for (const auto& xml_tree: included.content->trees)
+            {
+                if( !tree_names.insert( xml_tree.name ).second )
+                {
+                    throw std::runtime_error( QString("%1: the tree %2 is defined twice")
+                                              .arg( included.path ).arg( xml_tree.name ).toStdString() );
+                }
+                project.trees.push_back( xml_tree );
+                project.trees.back().file = included.path;
+            }
+            // the including file wins
+            for (const auto& it: included.content->models)
+            {
+                project.models.insert( it );
+            }
+            appendIncludes( included.content->includes, QFileInfo( included.path ).absolutePath(),
+                            seen, next_files );
+        }
+        files = std::move(next_files);
+    }
+    return project;
+}
+
+void IncludedFilesCacheUsage(int &files, qint64 &text_bytes)
+{
+    QMutexLocker lock( &included_files_mutex );
+    files = included_files.size();
+    text_bytes = 0;
+    for(const CachedFile& cached: included_files)
+    {
+        text_bytes += cached.size;
+    }
+}
+
+NodeModels ReadTreeNodesModel(const QString &xml_text)
+{
+    QXmlStreamReader xml( xml_text );
+    if( xml.readNextStartElement() && xml.name() != "root" )
+    {
+        throw std::runtime_error( "The XML must have a root node called <root>" );
+    }
+    NodeModels models;
+    bool found = false;
+    while( xml.readNextStartElement() )
+    {
+        if( xml.name() == "TreeNodesModel" )
+        {
+            found = true;
+            readTreeNodesModel( xml, models );
+        }
+        else{
+            xml.skipCurrentElement();
+        }
+    }
+    if( xml.hasError() )
+    {
+        throw parseError( xml );
+    }
+    if( !found )
+    {
+        throw std::runtime_error( "Expecting <TreeNodesModel> under <root>" );
+    }
+    return models;
+}
+
+void ResolveTreeModels(XMLTree &xml_tree, const NodeModels &models)
+{
+    auto& nodes = xml_tree.tree.nodes();
+    for (size_t index = 0; index < nodes.size(); index++)
+    {
+        auto& node = nodes[index];
+        auto model_it = models.find( node.model.registration_ID );
+        if( model_it == models.end() )
+        {
+            const QString error = QString("Error at line %1: -> This model has not been registered: %2")
+                    .arg( xml_tree.lines[index] ).arg( node.model.registration_ID );
+            throw std::runtime_error( ( xml_tree.file.isEmpty() ? error : xml_tree.file + ": " + error ).toStdString() );
+        }
+        node.model = model_it->second;
+    }
+}
+
 NodeModels ReadTreeNodesModel(const QDomElement &root)
 {
     NodeModels models;
@@ -132,54 +737,171 @@ NodeModels ReadTreeNodesModel(const QDomElement &root)
 
 
 
-void RecursivelyCreateXml(const FlowScene &scene, QDomDocument &doc, QDomElement& parent_element, const Node *node)
+namespace
 {
 
-    const QtNodes::NodeDataModel* node_model = node->nodeDataModel();
-    const std::string model_name = node_model->name().toStdString();
-
-    const auto* bt_node = dynamic_cast<const BehaviorTreeDataModel*>(node_model);
-
-    QString registration_name = bt_node->registrationName();
-    QDomElement element;
+// the start of the element of a node, with its attributes
+void writeNodeStart(QXmlStreamWriter& stream,
+                    const QString& registration_ID,
+                    NodeType type,
+                    const QString& instance_name,
+                    const PortsMapping& port_mapping)
+{
+    // sorted, a later one replaces an earlier with the same name
+    std::map<QString, QString> attributes;
 
-    if( BuiltinNodeModels().count(registration_name) != 0)
+    if( BuiltinNodeModels().count(registration_ID) != 0)
     {
-        element = doc.createElement( registration_name.toStdString().c_str() );
+        stream.writeStartElement( registration_ID );
     }
     else{
-        element = doc.createElement( QString::fromStdString(toStr(bt_node->nodeType())) );
-        element.setAttribute("ID", registration_name.toStdString().c_str() );
+        stream.writeStartElement( QString::fromStdString(toStr(type)) );
+        attributes["ID"] = registration_ID;
+    }
+    if( instance_name != registration_ID )
+    {
+        attributes["name"] = instance_name;
     }
+    for(const auto& port_it: port_mapping)
+    {
+        attributes[port_it.first] = port_it.second;
+    }
+    for(const auto& it: attributes)
+    {
+        stream.writeAttribute( it.first, it.second );
+    }
+}
+
+}
+
+void WriteTreeXML(QXmlStreamWriter &stream, const FlowScene &scene, const Node *node)
+{
+    const auto* bt_node = dynamic_cast<const BehaviorTreeDataModel*>( node->nodeDataModel() );
 
+    writeNodeStart( stream, bt_node->registrationName(), bt_node->nodeType(),
+                    bt_node->instanceName(), bt_node->getCurrentPortMapping() );
 
     bool is_subtree_expanded = false;
-    if( auto subtree = dynamic_cast<const SubtreeNodeModel*>(node_model)  )
+    if( auto subtree = dynamic_cast<const SubtreeNodeModel*>( bt_node ) )
     {
         is_subtree_expanded = subtree->expanded();
     }
+    if( auto branch = bt_node->collapsedBranch() )
+    {
+        for(int child_index: branch->rootNode()->children_index)
+        {
+            WriteTreeXML( stream, *branch, branch->node( child_index ), NodeModels() );
+        }
+    }
+    if( !is_subtree_expanded )
+    {
+        for(const QtNodes::Node* child : getChildren(scene, *node, true ))
+        {
+            WriteTreeXML( stream, scene, child );
+        }
+    }
+    stream.writeEndElement();
+}
 
-    if( bt_node->instanceName() != registration_name )
+void WriteTreeXML(QXmlStreamWriter &stream, const AbsBehaviorTree &tree,
+                  const AbstractTreeNode *node, const NodeModels &models)
+{
+    // created from the registered model, see GraphicContainer::recursiveLoadStep()
+    auto model_it = models.find( node->model.registration_ID );
+    const NodeModel& model = ( model_it != models.end() ) ? model_it->second : node->model;
+
+    // every port of the model, with its default value when not set
+    PortsMapping port_mapping;
+    for(const auto& port_it: model.ports)
     {
-        element.setAttribute("name", bt_node->instanceName().toStdString().c_str() );
+        auto value_it = node->ports_mapping.find( port_it.first );
+        port_mapping[ port_it.first ] = ( value_it != node->ports_mapping.end() ) ?
+                    value_it->second : port_it.second.default_value;
     }
 
-    auto port_mapping = bt_node->getCurrentPortMapping();
-    for(const auto& port_it: port_mapping)
+    writeNodeStart( stream, model.registration_ID, model.type,
+                    node->instance_name, port_mapping );
+
+    // the subtrees of a tree not built yet are never expanded
+    if( model.type != NodeType::SUBTREE )
     {
-        element.setAttribute( port_it.first, port_it.second );
+        for(int child_index: node->children_index)
+        {
+            WriteTreeXML( stream, tree, tree.node( child_index ), models );
+        }
     }
+    stream.writeEndElement();
+}
 
-    parent_element.appendChild( element );
+void WriteBehaviorTreeXML(QXmlStreamWriter &stream, const QString &ID,
+                          const AbsBehaviorTree &tree, const NodeModels &models)
+{
+    stream.writeStartElement("BehaviorTree");
+    stream.writeAttribute("ID", ID);
+    if( tree.nodesCount() > 0 )
+    {
+        auto abs_root = tree.rootNode();
+        if( abs_root->children_index.size() == 1 &&
+            abs_root->model.registration_ID == "Root"  )
+        {
+            abs_root = tree.node( abs_root->children_index.front() );
+        }
+        WriteTreeXML( stream, tree, abs_root, models );
+    }
+    stream.writeEndElement();
+}
 
-    if( !is_subtree_expanded )
+void WriteXMLDocument(QXmlStreamWriter &stream, const QString &main_tree,
+                      const std::map<QString, const AbsBehaviorTree *> &trees,
+                      const NodeModels &models)
+{
+    const char* COMMENT_SEPARATOR = " ////////// ";
+
+    // as MainWindow::writeXML()
+    stream.setAutoFormatting(true);
+    stream.setAutoFormattingIndent(4);
+
+    stream.writeStartElement("root");
+    if( !main_tree.isEmpty() )
+    {
+        stream.writeAttribute("main_tree_to_execute", main_tree);
+    }
+    for (const auto& it: trees)
+    {
+        stream.writeComment(COMMENT_SEPARATOR);
+        WriteBehaviorTreeXML( stream, it.first, *it.second, models );
+    }
+    stream.writeComment(COMMENT_SEPARATOR);
+
+    WriteTreeNodesModel( stream, models );
+    stream.writeComment(COMMENT_SEPARATOR);
+
+    stream.writeEndElement();
+    stream.writeEndDocument();
+}
+
+void WriteTreeNodesModel(QXmlStreamWriter &stream, const NodeModels &models)
+{
+    stream.writeStartElement("TreeNodesModel");
+    for(const auto& tree_it: models)
     {
-        auto node_children = getChildren(scene, *node, true );
-        for(const QtNodes::Node* child : node_children)
+        const auto& ID    = tree_it.first;
+        const auto& model = tree_it.second;
+
+        if( BuiltinNodeModels().count(ID) != 0 )
+        {
+            continue;
+        }
+
+        stream.writeStartElement( QString::fromStdString(toStr(model.type)) );
+        stream.writeAttribute("ID", ID);
+        for(const auto& port_it: model.ports)
         {
-            RecursivelyCreateXml(scene, doc, element, child );
+            writePortModel(stream, port_it.first, port_it.second);
         }
+        stream.writeEndElement();
     }
+    stream.writeEndElement();
 }
 
 bool VerifyXML(QDomDocument &doc,
@@ -206,6 +928,38 @@ bool VerifyXML(QDomDocument &doc,
 
 
 
+void writePortModel(QXmlStreamWriter &stream, const QString &port_name, const PortModel &port)
+{
+  switch (port.direction)
+  {
+    case PortDirection::INPUT:
+      stream.writeStartElement("input_port");
+      break;
+    case PortDirection::OUTPUT:
+      stream.writeStartElement("output_port");
+      break;
+    case PortDirection::INOUT:
+      stream.writeStartElement("inout_port");
+      break;
+  }
+
+  // sorted by name, as the canonical output
+  if (!port.default_value.isEmpty())
+  {
+    stream.writeAttribute("default", port.default_value);
+  }
+  stream.writeAttribute("name", port_name);
+  if (!port.type_name.isEmpty())
+  {
+    stream.writeAttribute("type", port.type_name);
+  }
+  if (!port.description.isEmpty())
+  {
+    stream.writeCharacters(port.description);
+  }
+  stream.writeEndElement();
+}
+
 QDomElement writePortModel(const QString& port_name, const PortModel& port, QDomDocument& doc)
 {
   QDomElement port_element;
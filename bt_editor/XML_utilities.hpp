@@ -2,6 +2,8 @@
 #define XMLPARSERS_HPP
 
 #include <QDomDocument>
+#include <QXmlStreamWriter>
+#include <vector>
 #include "bt_editor_base.h"
 
 #include <nodes/Node>
@@ -12,10 +14,31 @@
 
 NodeModels ReadTreeNodesModel(const QDomElement& root);
 
-void RecursivelyCreateXml(const QtNodes::FlowScene &scene,
-                          QDomDocument& doc,
-                          QDomElement& parent_element,
-                          const QtNodes::Node* node);
+// Canonical XML of a node and its children, as saved by Groot: the
+// attributes sorted by name, the expanded subtrees without their children.
+void WriteTreeXML(QXmlStreamWriter& stream,
+                  const QtNodes::FlowScene &scene,
+                  const QtNodes::Node* node);
+
+// Same XML, for a tree not built in a scene: the nodes have the ports of
+// their model in "models", as if they were.
+void WriteTreeXML(QXmlStreamWriter& stream,
+                  const AbsBehaviorTree& tree,
+                  const AbstractTreeNode* node,
+                  const NodeModels& models);
+
+// A whole <BehaviorTree> not built in a scene, without its node Root.
+void WriteBehaviorTreeXML(QXmlStreamWriter& stream, const QString& ID,
+                          const AbsBehaviorTree& tree, const NodeModels& models);
+
+// The <TreeNodesModel> of a saved file: the models that are not builtin.
+void WriteTreeNodesModel(QXmlStreamWriter& stream, const NodeModels& models);
+
+// A whole file as saved by Groot, from trees not built in a scene, by
+// name. The XML declaration is not written.
+void WriteXMLDocument(QXmlStreamWriter& stream, const QString& main_tree,
+                      const std::map<QString, const AbsBehaviorTree*>& trees,
+                      const NodeModels& models);
 
 bool VerifyXML(QDomDocument& doc,
                const std::vector<QString> &registered_ID,
@@ -23,7 +46,68 @@ bool VerifyXML(QDomDocument& doc,
 
 NodeModel buildTreeNodeModelFromXML(const QDomElement &node);
 
+// A <BehaviorTree>, as read by ReadXMLDocument()
+struct XMLTree
+{
+    QString name;   // "BehaviorTree" when it has no ID
+    bool has_ID = false;
+    // with the deprecated <Root> around its first node
+    bool has_root_tag = false;
+    // the models of the nodes have only their ID, see ResolveTreeModels()
+    AbsBehaviorTree tree;
+    // line of each node in the file, by index
+    std::vector<qint64> lines;
+    // the included file it comes from, empty for the main one
+    QString file;
+};
+
+// <include path="..."/>
+struct XMLInclude
+{
+    QString path;   // as written, maybe relative
+    qint64 line = 0;
+};
+
+struct XMLDocumentContent
+{
+    QString main_tree;  // main_tree_to_execute, if any
+    // the models of <TreeNodesModel>, then the ones used in the trees,
+    // as ReadTreeNodesModel()
+    NodeModels models;
+    std::vector<XMLTree> trees;
+    std::vector<XMLInclude> includes;
+    // absolute paths of all the files included, by ReadXMLProject()
+    std::vector<QString> included_files;
+};
+
+// Reads a whole file with a single QXmlStreamReader pass, without building
+// a QDomDocument, checking the structure of the trees as BT::VerifyXML.
+// The <BehaviorTree> of a large file are read on a thread pool.
+// The errors are thrown as std::runtime_error, with their line.
+// The <include> are listed, not read.
+XMLDocumentContent ReadXMLDocument(const QString& xml_text);
+
+// Same document, with the trees and models of the files it includes, and of
+// the ones they include, after its own; the relative paths of xml_text are
+// relative to "directory". The included files are read on a thread pool and
+// parsed again only when their time of modification and their hash change.
+XMLDocumentContent ReadXMLProject(const QString& xml_text, const QString& directory);
+
+// The included files kept parsed by ReadXMLProject(), and the size of their
+// text.
+void IncludedFilesCacheUsage(int& files, qint64& text_bytes);
+
+// Only the models declared in the <TreeNodesModel> of a file, as imported
+// in the palette. Throws std::runtime_error.
+NodeModels ReadTreeNodesModel(const QString& xml_text);
+
+// Gives its model to every node of the tree.
+// Throws if one is not in "models".
+void ResolveTreeModels(XMLTree& xml_tree, const NodeModels& models);
+
 QDomElement writePortModel(const QString &port_name, const PortModel &port, QDomDocument &doc);
 
+void writePortModel(QXmlStreamWriter& stream, const QString &port_name, const PortModel &port);
+
 
 #endif // XMLPARSERS_HPP
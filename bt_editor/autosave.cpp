@@ -0,0 +1,58 @@
+#include "autosave.h"
+#include "XML_utilities.hpp"
+#include <nodes/Trace>
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QXmlStreamWriter>
+
+QString AutosavePath()
+{
+    return QStandardPaths::writableLocation( QStandardPaths::AppDataLocation ) + "/autosave.xml";
+}
+
+AutosaveWriter::AutosaveWriter(AutosaveSnapshot snapshot, QObject *parent):
+    QThread(parent),
+    _snapshot( std::move(snapshot) ),
+    _succeeded( false )
+{
+}
+
+void AutosaveWriter::run()
+{
+    NODE_TRACE_SCOPE("AutosaveWriter::run");
+
+    const QString path = AutosavePath();
+    QDir().mkpath( QFileInfo( path ).absolutePath() );
+
+    // renamed only by commit()
+    QSaveFile file( path );
+    if( !file.open( QIODevice::WriteOnly ) )
+    {
+        _error = file.errorString();
+        return;
+    }
+    file.write( "<?xml version=\"1.0\"?>" );
+
+    // the same XML as MainWindow::saveToXML()
+    std::map<QString, const AbsBehaviorTree*> trees;
+    for (const auto& it: _snapshot.trees)
+    {
+        trees.insert( { it.first, it.second.get() } );
+    }
+    QXmlStreamWriter stream( &file );
+    WriteXMLDocument( stream, _snapshot.main_tree, trees, _snapshot.models );
+
+    if( stream.hasError() )
+    {
+        _error = file.errorString();
+        file.cancelWriting();
+        return;
+    }
+    _succeeded = file.commit();
+    if( !_succeeded )
+    {
+        _error = file.errorString();
+    }
+}
@@ -0,0 +1,47 @@
+#ifndef AUTOSAVE_H
+#define AUTOSAVE_H
+
+#include <QThread>
+#include <map>
+#include <memory>
+#include "bt_editor_base.h"
+
+// What the autosave writes: a copy of the trees that the GUI can keep
+// editing. The trees not modified since the previous autosave are shared
+// with it.
+struct AutosaveSnapshot
+{
+    QString main_tree;
+    // by tab name
+    std::map<QString, std::shared_ptr<const AbsBehaviorTree>> trees;
+    NodeModels models;
+};
+
+// The file written by the autosave, in the data directory of the user.
+QString AutosavePath();
+
+// Writes a snapshot as a saved file, on its own thread: to a temporary file
+// renamed over the previous autosave, a crash never leaves a partial one.
+class AutosaveWriter : public QThread
+{
+    Q_OBJECT
+
+public:
+    AutosaveWriter(AutosaveSnapshot snapshot, QObject* parent = nullptr);
+
+    // when the thread has finished
+    bool succeeded() const { return _succeeded; }
+
+    // why it did not succeed, when the thread has finished
+    const QString& errorString() const { return _error; }
+
+protected:
+    void run() override;
+
+private:
+    AutosaveSnapshot _snapshot;
+    bool _succeeded;
+    QString _error;
+};
+
+#endif // AUTOSAVE_H
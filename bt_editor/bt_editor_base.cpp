@@ -1,6 +1,7 @@
 #include "bt_editor_base.h"
 #include <behaviortree_cpp_v3/decorators/subtree_node.h>
 #include <QDebug>
+#include <set>
 
 void AbsBehaviorTree::clear()
 {
@@ -101,6 +102,34 @@ void AbsBehaviorTree::debugPrint() const
 
 }
 
+size_t AbsBehaviorTree::memoryUsage() const
+{
+    size_t bytes = sizeof(AbsBehaviorTree) + _nodes.size() * sizeof(AbstractTreeNode);
+    std::set<QString> models;
+    for (const auto& node: _nodes)
+    {
+        bytes += StringMemoryUsage( node.instance_name );
+        bytes += node.children_index.capacity() * sizeof(int);
+        for (const auto& port_it: node.ports_mapping)
+        {
+            bytes += MAP_NODE_OVERHEAD + sizeof(port_it) +
+                     StringMemoryUsage( port_it.first ) + StringMemoryUsage( port_it.second );
+        }
+        if( models.insert( node.model.registration_ID ).second )
+        {
+            bytes += StringMemoryUsage( node.model.registration_ID );
+            for (const auto& port_it: node.model.ports)
+            {
+                const PortModel& port = port_it.second;
+                bytes += MAP_NODE_OVERHEAD + sizeof(port_it) + StringMemoryUsage( port_it.first ) +
+                         StringMemoryUsage( port.type_name ) + StringMemoryUsage( port.description ) +
+                         StringMemoryUsage( port.default_value );
+            }
+        }
+    }
+    return bytes;
+}
+
 bool AbsBehaviorTree::operator ==(const AbsBehaviorTree &other) const
 {
     if( _nodes.size() != other._nodes.size() ) return false;
@@ -142,12 +171,37 @@ bool AbstractTreeNode::operator ==(const AbstractTreeNode &other) const
             instance_name == other.instance_name;
 }
 
+PortModels::PortModels():
+    _ports( [](){ static const auto no_ports = std::make_shared<Map>(); return no_ports; }() )
+{
+}
+
+std::pair<PortModels::Map::iterator, bool> PortModels::insert(value_type &&port)
+{
+    return detach().insert( std::move(port) );
+}
+
+std::pair<PortModels::Map::iterator, bool> PortModels::insert(const value_type &port)
+{
+    return detach().insert( port );
+}
+
+PortModels::Map &PortModels::detach()
+{
+    if( _ports.use_count() > 1 )
+    {
+        _ports = std::make_shared<Map>( *_ports );
+    }
+    return *_ports;
+}
+
 bool NodeModel::operator ==(const NodeModel &other) const
 {
     bool is_same = ( type == other.type &&
                     ports.size() == other.ports.size() &&
                     registration_ID == other.registration_ID);
     if( ! is_same ) return false;
+    if( ports.isSharedWith( other.ports ) ) return true;
 
     auto other_it = other.ports.begin();
     for (const auto& port_it: ports)
@@ -5,6 +5,7 @@
 #include <QPointF>
 #include <QSizeF>
 #include <map>
+#include <memory>
 #include <unordered_map>
 #include <nodes/Node>
 #include <deque>
@@ -16,6 +17,15 @@ using BT::PortDirection;
 
 typedef std::map<QString, QString> PortsMapping;
 
+// The heap bytes of a string and of a node of std::map, for the estimates
+// of the memory used.
+inline size_t StringMemoryUsage(const QString& str)
+{
+    return str.capacity() > 0 ? size_t( str.capacity() + 1 ) * sizeof(QChar) + 24 : 0;
+}
+
+const size_t MAP_NODE_OVERHEAD = 32;
+
 // alternative type, similar to BT::PortInfo
 struct PortModel
 {
@@ -29,7 +39,38 @@ struct PortModel
     PortModel& operator = (const BT::PortInfo& src);
 };
 
-typedef std::map<QString, PortModel> PortModels;
+// The ports of a model, shared by all its copies until one is modified: the
+// trees copy the model in every node, this costs a reference count.
+class PortModels
+{
+public:
+    typedef std::map<QString, PortModel> Map;
+    typedef Map::value_type value_type;
+    typedef Map::const_iterator const_iterator;
+
+    PortModels();
+
+    size_t size() const { return _ports->size(); }
+    bool empty() const { return _ports->empty(); }
+
+    const_iterator begin() const { return _ports->begin(); }
+    const_iterator end() const { return _ports->end(); }
+
+    const_iterator find(const QString& name) const { return _ports->find(name); }
+    size_t count(const QString& name) const { return _ports->count(name); }
+    const PortModel& at(const QString& name) const { return _ports->at(name); }
+
+    std::pair<Map::iterator, bool> insert(value_type&& port);
+    std::pair<Map::iterator, bool> insert(const value_type& port);
+
+    // same ports, without comparing them
+    bool isSharedWith(const PortModels& other) const { return _ports == other._ports; }
+
+private:
+    std::shared_ptr<Map> _ports;
+
+    Map& detach();
+};
 
 struct  NodeModel
 {
@@ -120,6 +161,10 @@ public:
 
     void debugPrint() const;
 
+    // Bytes of the nodes, an estimate. The ports of a model are counted once:
+    // its copies share them.
+    size_t memoryUsage() const;
+
     bool operator ==(const AbsBehaviorTree &other) const;
 
     bool operator !=(const AbsBehaviorTree &other) const{
@@ -132,6 +177,17 @@ private:
     NodesVector _nodes;
 };
 
+// A status change of a node, as stored in a log or in the monitor history.
+struct Transition
+{
+    int16_t index;
+    double timestamp;
+    NodeStatus prev_status;
+    NodeStatus status;
+    bool is_tree_restart;
+    int nearest_restart_transition_index;
+};
+
 static int GetUID()
 {
     static int uid = 1000;
@@ -6,36 +6,138 @@
 #include <QKeyEvent>
 #include <QCursor>
 #include <QApplication>
+#include <QClipboard>
+#include <functional>
 #include "models/BehaviorTreeNodeModel.hpp"
+#include "tree_clipboard.h"
+#include "utils.h"
+#include "models/SubtreeNodeModel.hpp"
 #include <QGraphicsView>
+#include <QGraphicsProxyWidget>
+#include <QLineEdit>
 
 #include <nodes/Node>
+#include <nodes/Connection>
 
 EditorFlowScene::EditorFlowScene(std::shared_ptr<QtNodes::DataModelRegistry> registry,
                                  QObject * parent):
     FlowScene(registry,parent),
     _editor_locked(false)
 {
+    // connected first: the other receivers see the topology up to date
+    connect( this, &FlowScene::nodeCreated,
+             this, [this](QtNodes::Node& node)
+    {
+        _topology.nodeCreated( node );
+        addToModelIndex( node );
+        addToSearchIndexes( node );
+    });
+
+    connect( this, &FlowScene::nodeDeleted,
+             this, [this](QtNodes::Node& node)
+    {
+        _topology.nodeDeleted( node );
+        _search_index.remove( node );
+        _port_value_index.remove( node );
+        auto it = _nodes_by_model.find( node.nodeDataModel()->name() );
+        if( it != _nodes_by_model.end() )
+        {
+            it->erase( &node );
+            if( it->empty() )
+            {
+                _nodes_by_model.erase( it );
+            }
+        }
+    });
+
+    connect( this, &FlowScene::sceneRebuilt,
+             this, [this](const std::vector<QtNodes::Node*>& nodes)
+    {
+        _topology.rebuild( nodes );
+        for(auto node: nodes)
+        {
+            addToModelIndex( *node );
+            addToSearchIndexes( *node );
+        }
+    });
 
+    auto connection_changed = [this](QtNodes::Connection& connection)
+    {
+        for(auto type: {QtNodes::PortType::In, QtNodes::PortType::Out})
+        {
+            if( auto node = connection.getNode( type ) )
+            {
+                _topology.connectionsChanged( *node );
+            }
+        }
+    };
+    connect( this, &FlowScene::connectionCreated, this, connection_changed );
+    connect( this, &FlowScene::connectionDeleted, this, connection_changed );
+
+    connect( this, &FlowScene::connectionDetached,
+             this, [this](QtNodes::Connection&, QtNodes::Node& node) { _topology.connectionsChanged( node ); } );
+}
+
+EditorFlowScene::~EditorFlowScene()
+{
+    // while _topology can still be notified
+    clearScene();
+}
+
+const std::set<QtNodes::Node *> &EditorFlowScene::nodesOfModel(const QString &registration_ID) const
+{
+    static const std::set<QtNodes::Node*> no_nodes;
+    auto it = _nodes_by_model.find( registration_ID );
+    return ( it == _nodes_by_model.end() ) ? no_nodes : *it;
+}
+
+void EditorFlowScene::addToModelIndex(QtNodes::Node &node)
+{
+    _nodes_by_model[ node.nodeDataModel()->name() ].insert( &node );
+}
+
+void EditorFlowScene::nodeChanged(QtNodes::Node &node)
+{
+    _search_index.update( node );
+    _port_value_index.update( node );
+}
+
+void EditorFlowScene::addToSearchIndexes(QtNodes::Node &node)
+{
+    nodeChanged( node );
+
+    auto bt_model = dynamic_cast<BehaviorTreeDataModel*>( node.nodeDataModel() );
+    if( !bt_model )
+    {
+        return;
+    }
+    // edited by the user in the widgets of the node
+    auto node_ptr = &node;
+    connect( bt_model, &BehaviorTreeDataModel::instanceNameChanged,
+             this, [this, node_ptr]() { _search_index.update( *node_ptr ); } );
+    connect( bt_model, &BehaviorTreeDataModel::parameterUpdated,
+             this, [this, node_ptr]() { nodeChanged( *node_ptr ); } );
 }
 
 QtNodes::Node &EditorFlowScene::createNodeAtPos(const QString &ID, const QString &instance_name, QPointF scene_pos)
 {
-    auto node_model = registry().create(ID);
-    if( !node_model )
+    // a node removed before is reused when possible
+    QtNodes::Node* node_qt = createNodeOfModel( ID, [&instance_name](QtNodes::NodeDataModel& model)
+    {
+        auto bt_model = dynamic_cast<BehaviorTreeDataModel*>( &model );
+        bt_model->setInstanceName( instance_name );
+        bt_model->initWidget();
+    });
+    if( !node_qt )
     {
         char buffer[250];
         sprintf(buffer, "No registered model with ID: [%s]",
                 ID.toStdString().c_str() );
         throw std::runtime_error( buffer );
     }
-    auto bt_model = dynamic_cast<BehaviorTreeDataModel*>( node_model.get() );
-    bt_model->setInstanceName( instance_name );
-    bt_model->initWidget();
-    auto& node_qt = createNode(std::move(node_model));
-    setNodePosition(node_qt, scene_pos);
+    setNodePosition(*node_qt, scene_pos);
 
-    return node_qt;
+    return *node_qt;
 }
 
 void EditorFlowScene::dragEnterEvent(QGraphicsSceneDragDropEvent *event)
@@ -58,57 +160,264 @@ void EditorFlowScene::dragMoveEvent(QGraphicsSceneDragDropEvent* event)
 
 void EditorFlowScene::keyPressEvent(QKeyEvent *event)
 {
-
-    for( const auto& it: nodes())
+    // the embedded widgets are in proxies: the focus item is the proxy of
+    // the line edit being edited, whatever the number of nodes
+    if( auto proxy = dynamic_cast<QGraphicsProxyWidget*>( focusItem() ) )
     {
-        const auto& node = it.second;
-        auto line_edits = node->nodeDataModel()->embeddedWidget()->findChildren<QLineEdit*>();
-        for(auto line_edit: line_edits )
+        auto line_edit = proxy->widget() ? qobject_cast<QLineEdit*>( proxy->widget()->focusWidget() ) : nullptr;
+        if( line_edit && line_edit->hasFocus() )
         {
-            if( line_edit->hasFocus() )
-            {
-                // Do not swallow the keyPressEvent, you are editing a QLineEdit
-                QGraphicsScene::keyPressEvent(event);
-                return;
-            }
+            // Do not swallow the keyPressEvent, you are editing a QLineEdit
+            QGraphicsScene::keyPressEvent(event);
+            return;
         }
     }
 
-    const QString& registration_ID = _clipboard_node.model.registration_ID;
-
-    auto selected_items = selectedItems();
-    if( selected_items.size() == 1 &&
-        event->key() == Qt::Key_C &&
+    if( event->key() == Qt::Key_C &&
         event->modifiers() == Qt::ControlModifier)
     {
-        auto node_item = dynamic_cast<QtNodes::NodeGraphicsObject*>( selected_items.front() );
-        if( !node_item ) return;
-
-        QtNodes::Node& selected_node = node_item->node();
-        auto node_model = dynamic_cast<BehaviorTreeDataModel*>( selected_node.nodeDataModel() );
-        if( !node_model ) return;
-
-        _clipboard_node.model = node_model->model();
-        _clipboard_node.instance_name  = node_model->instanceName();
+        copySelection();
     }
     else if( event->key() == Qt::Key_V &&
              event->modifiers() == Qt::ControlModifier &&
-             registry().isRegistered( registration_ID  ) )
+             !_editor_locked && !views().empty() )
     {
-        auto views_ = views();
-        QGraphicsView* view = views_.front();
+        QGraphicsView* view = views().front();
         auto mouse_pos = view->viewport()->mapFromGlobal( QCursor::pos() );
-        auto scene_pos = view->mapToScene( mouse_pos );
-
-        createNodeAtPos( registration_ID,
-                        _clipboard_node.instance_name,
-                        scene_pos );
+        pasteNodes( view->mapToScene( mouse_pos ) );
     }
     else{
         QGraphicsScene::keyPressEvent(event);
     }
 }
 
+void EditorFlowScene::copySelection()
+{
+    const ClipboardContent content = CopyNodes( *this, selectedNodes() );
+    if( content.empty() )
+    {
+        return;
+    }
+    auto mime_data = new QMimeData;
+    mime_data->setData( NODES_MIME_TYPE, EncodeClipboard( content ) );
+    QApplication::clipboard()->setMimeData( mime_data );
+}
+
+bool EditorFlowScene::pasteNodes(QPointF scene_pos)
+{
+    const QMimeData* mime_data = QApplication::clipboard()->mimeData();
+    ClipboardContent content;
+    if( !mime_data || !mime_data->hasFormat( NODES_MIME_TYPE ) ||
+        !DecodeClipboard( mime_data->data( NODES_MIME_TYPE ), content ) )
+    {
+        return false;
+    }
+
+    for (const auto& it: content.models)
+    {
+        if( !registry().isRegistered( it.first ) && _unknown_model_handler )
+        {
+            _unknown_model_handler( it.second );
+        }
+    }
+
+    std::vector<QtNodes::Node*> pasted;
+    {
+        FlowScene::Batch batch( *this );
+        for (const auto& tree: content.trees)
+        {
+            createBranch( tree, *tree.rootNode(), nullptr, scene_pos, pasted );
+        }
+    }
+
+    clearSelection();
+    for (auto node: pasted)
+    {
+        node->nodeGraphicsObject().setSelected( true );
+    }
+    return !pasted.empty();
+}
+
+void EditorFlowScene::createBranch(const AbsBehaviorTree& tree,
+                                   const AbstractTreeNode& abs_node,
+                                   QtNodes::Node* parent, QPointF offset,
+                                   std::vector<QtNodes::Node*>& created)
+{
+    // with its children
+    if( !registry().isRegistered( abs_node.model.registration_ID ) )
+    {
+        return;
+    }
+    QtNodes::Node& node = createNodeAtPos( abs_node.model.registration_ID,
+                                           abs_node.instance_name,
+                                           offset + abs_node.pos );
+    auto bt_model = dynamic_cast<BehaviorTreeDataModel*>( node.nodeDataModel() );
+    for (const auto& port_it: abs_node.ports_mapping)
+    {
+        bt_model->setPortMapping( port_it.first, port_it.second );
+    }
+    if( parent )
+    {
+        createConnection( node, 0, *parent, 0 );
+    }
+    created.push_back( &node );
+
+    for (int child: abs_node.children_index)
+    {
+        createBranch( tree, *tree.node( size_t(child) ), &node, offset, created );
+    }
+}
+
+bool EditorFlowScene::canCollapse(QtNodes::Node& node) const
+{
+    auto bt_model = dynamic_cast<BehaviorTreeDataModel*>( node.nodeDataModel() );
+    if( _editor_locked || !bt_model || bt_model->collapsedBranch() )
+    {
+        return false;
+    }
+    const NodeType type = bt_model->nodeType();
+    return ( type == NodeType::CONTROL || type == NodeType::DECORATOR ) &&
+           !_topology.children( node ).empty();
+}
+
+bool EditorFlowScene::collapseBranch(QtNodes::Node& node)
+{
+    if( !canCollapse( node ) )
+    {
+        return false;
+    }
+    auto bt_model = dynamic_cast<BehaviorTreeDataModel*>( node.nodeDataModel() );
+    const QPointF origin = getNodePosition( node );
+
+    auto branch = std::make_shared<AbsBehaviorTree>();
+    std::vector<QtNodes::Node*> hidden;
+
+    // "parent" is null for the nodes of an expanded SubTree: removed, not copied
+    std::function<void(AbstractTreeNode*, QtNodes::Node*)> copyRecursively;
+    copyRecursively = [&](AbstractTreeNode* parent, QtNodes::Node* child)
+    {
+        auto child_model = dynamic_cast<BehaviorTreeDataModel*>( child->nodeDataModel() );
+        AbstractTreeNode* added_node = nullptr;
+        if( parent || child == &node )
+        {
+            AbstractTreeNode abs_node;
+            abs_node.model = child_model->model();
+            abs_node.instance_name = child_model->instanceName();
+            abs_node.ports_mapping = child_model->getCurrentPortMapping();
+            abs_node.pos = getNodePosition( *child ) - origin;
+            abs_node.size = getNodeSize( *child );
+            added_node = branch->addNode( parent, std::move(abs_node) );
+
+            if( auto nested = child_model->collapsedBranch() )
+            {
+                AppendBranch( *branch, added_node, *nested, *nested->rootNode(), added_node->pos );
+            }
+        }
+        if( child != &node )
+        {
+            hidden.push_back( child );
+        }
+        auto subtree = dynamic_cast<SubtreeNodeModel*>( child_model );
+        if( subtree && subtree->expanded() )
+        {
+            added_node = nullptr;
+        }
+        for (auto grandchild: getChildren( *this, *child, true ))
+        {
+            copyRecursively( added_node, grandchild );
+        }
+    };
+    copyRecursively( nullptr, &node );
+
+    for (auto hidden_node: hidden)
+    {
+        removeNode( *hidden_node );
+    }
+    bt_model->setCollapsedBranch( std::move(branch) );
+    return true;
+}
+
+bool EditorFlowScene::expandBranch(QtNodes::Node& node)
+{
+    auto bt_model = dynamic_cast<BehaviorTreeDataModel*>( node.nodeDataModel() );
+    if( _editor_locked || !bt_model || !bt_model->collapsedBranch() )
+    {
+        return false;
+    }
+    // never dropped: the models of another instance of Groot are registered
+    for (const auto& abs_node: bt_model->collapsedBranch()->nodes())
+    {
+        if( !registry().isRegistered( abs_node.model.registration_ID ) && _unknown_model_handler )
+        {
+            _unknown_model_handler( abs_node.model );
+        }
+        if( !registry().isRegistered( abs_node.model.registration_ID ) )
+        {
+            return false;
+        }
+    }
+    // the badge is removed before the children are seen by the receivers
+    const AbsBehaviorTree branch = *bt_model->collapsedBranch();
+    bt_model->setCollapsedBranch( nullptr );
+
+    std::vector<QtNodes::Node*> created;
+    {
+        FlowScene::Batch batch( *this );
+        const QPointF origin = getNodePosition( node );
+        for (int child: branch.rootNode()->children_index)
+        {
+            createBranch( branch, *branch.node( size_t(child) ), &node, origin, created );
+        }
+    }
+    return true;
+}
+
+std::vector<QtNodes::Node*> EditorFlowScene::collapsedUsages(const QString &registration_ID) const
+{
+    std::vector<QtNodes::Node*> usages;
+    for (const auto& it: nodes())
+    {
+        auto bt_model = dynamic_cast<BehaviorTreeDataModel*>( it.second->nodeDataModel() );
+        const AbsBehaviorTree* branch = bt_model ? bt_model->collapsedBranch() : nullptr;
+        if( !branch )
+        {
+            continue;
+        }
+        for (const auto& abs_node: branch->nodes())
+        {
+            if( abs_node.model.registration_ID == registration_ID )
+            {
+                usages.push_back( it.second.get() );
+                break;
+            }
+        }
+    }
+    return usages;
+}
+
+std::vector<QtNodes::Node*> EditorFlowScene::renameCollapsedModel(const QString &prev_ID,
+                                                                  const NodeModel &model)
+{
+    std::vector<QtNodes::Node*> renamed = collapsedUsages( prev_ID );
+    for (auto node: renamed)
+    {
+        auto bt_model = dynamic_cast<BehaviorTreeDataModel*>( node->nodeDataModel() );
+        auto branch = std::make_shared<AbsBehaviorTree>( *bt_model->collapsedBranch() );
+        for (auto& abs_node: branch->nodes())
+        {
+            if( abs_node.model.registration_ID == prev_ID )
+            {
+                abs_node.model = model;
+                if( abs_node.instance_name == prev_ID || model.type == NodeType::SUBTREE )
+                {
+                    abs_node.instance_name = model.registration_ID;
+                }
+            }
+        }
+        bt_model->setCollapsedBranch( std::move(branch) );
+    }
+    return renamed;
+}
 
 void EditorFlowScene::dropEvent(QGraphicsSceneDragDropEvent *event)
 {
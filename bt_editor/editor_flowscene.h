@@ -3,7 +3,12 @@
 
 #include <nodes/FlowScene>
 #include <nodes/DataModelRegistry>
+#include <QHash>
+#include <set>
+#include <functional>
 #include "bt_editor/bt_editor_base.h"
+#include "bt_editor/tree_topology.h"
+#include "bt_editor/node_search.h"
 
 class EditorFlowScene : public QtNodes::FlowScene
 {
@@ -11,13 +16,74 @@ public:
     EditorFlowScene(std::shared_ptr<QtNodes::DataModelRegistry> registry,
                     QObject * parent = Q_NULLPTR);
 
+    ~EditorFlowScene();
+
     bool isLocked() const { return _editor_locked; }
     void lock(bool lock_editor) { _editor_locked = lock_editor; }
 
     QtNodes::Node& createNodeAtPos(const QString& ID, const QString& instance_name, QPointF scene_pos);
 
+    const TreeTopology& topology() const { return _topology; }
+
+    // after the ports of the node changed (a SubTree expanded or collapsed)
+    void portsChanged(QtNodes::Node& node) { _topology.connectionsChanged( node ); }
+
+    // the nodes of a model, by registration_ID
+    const std::set<QtNodes::Node*>& nodesOfModel(const QString& registration_ID) const;
+
+    const NodeSearchIndex& searchIndex() const { return _search_index; }
+
+    // the nodes with a port set to "value"
+    const std::set<QtNodes::Node*>& nodesWithPortValue(const QString& value) const
+    {
+        return _port_value_index.nodesWithValue( value );
+    }
+
+    // after the name or the ports of the node were changed by the code
+    void nodeChanged(QtNodes::Node& node);
+
+    // Ctrl+C: the selected nodes, their connections and their ports, in
+    // the system clipboard, read by the other instances of Groot too
+    void copySelection();
+
+    // Ctrl+V: the nodes of the clipboard at "scene_pos", as a single batch,
+    // then selected. Returns false if the clipboard has no nodes.
+    bool pasteNodes(QPointF scene_pos);
+
+    // called by pasteNodes() with the models of the clipboard that are not
+    // registered; the nodes still not registered after it are not pasted
+    void setUnknownModelHandler(std::function<void(const NodeModel&)> handler)
+    {
+        _unknown_model_handler = std::move(handler);
+    }
+
+    // A CONTROL or DECORATOR with children, in an unlocked scene
+    bool canCollapse(QtNodes::Node& node) const;
+
+    // The descendants of the node are removed from the scene and kept by its
+    // model, as an AbsBehaviorTree (BehaviorTreeDataModel::collapsedBranch()).
+    // The expanded SubTrees of the branch are kept collapsed.
+    bool collapseBranch(QtNodes::Node& node);
+
+    // The reverse, the hidden nodes are created as a single batch. Their
+    // models are registered by the handler of setUnknownModelHandler(): if
+    // one is still unknown, the branch stays collapsed and false is returned.
+    bool expandBranch(QtNodes::Node& node);
+
+    // the nodes whose collapsed branch has a node of the model
+    std::vector<QtNodes::Node*> collapsedUsages(const QString& registration_ID) const;
+
+    // The nodes of "prev_ID" hidden in the collapsed branches take "model"
+    // instead. Returns the nodes whose branch changed.
+    std::vector<QtNodes::Node*> renameCollapsedModel(const QString& prev_ID, const NodeModel& model);
+
 private:
 
+    // "abs_node" and its descendants, moved by "offset", the children of "parent"
+    void createBranch(const AbsBehaviorTree& tree, const AbstractTreeNode& abs_node,
+                      QtNodes::Node* parent, QPointF offset,
+                      std::vector<QtNodes::Node*>& created);
+
     void dragEnterEvent(QGraphicsSceneDragDropEvent *event) override;
     void dragLeaveEvent(QGraphicsSceneDragDropEvent *event) override;
     void dropEvent(QGraphicsSceneDragDropEvent *event) override;
@@ -26,7 +92,14 @@ private:
     void keyPressEvent( QKeyEvent * event ) override;
 
     bool _editor_locked;
-    AbstractTreeNode _clipboard_node;
+    std::function<void(const NodeModel&)> _unknown_model_handler;
+    TreeTopology _topology;
+    QHash<QString, std::set<QtNodes::Node*>> _nodes_by_model;
+    NodeSearchIndex _search_index;
+    PortValueIndex _port_value_index;
+
+    void addToModelIndex(QtNodes::Node& node);
+    void addToSearchIndexes(QtNodes::Node& node);
 };
 
 #endif // EDITOR_FLOWSCENE_H
@@ -1,5 +1,6 @@
 #include "graphic_container.h"
 #include "utils.h"
+#include "tree_layout.h"
 #include "mainwindow.h"
 
 #include "models/SubtreeNodeModel.hpp"
@@ -11,17 +12,109 @@
 #include <QMessageBox>
 #include <QApplication>
 #include <QInputDialog>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <nodes/Trace>
 
 using namespace QtNodes;
 
+namespace
+{
+// vertical distance of the nodes placed by recursiveLoadStep()
+const qreal LOAD_STEP_SPACING = 50;
+
+const int LAYOUT_ANIMATION_MSEC = 250;
+
+bool animated_layout = false;
+
+// trees this large are laid out by a LayoutWorker
+const size_t ASYNC_LAYOUT_NODES = 2000;
+
+// nodes moved per event loop iteration
+const size_t LAYOUT_APPLY_CHUNK = 500;
+
+// trees this large are built by loadSceneProgressively() a slice at a time
+const size_t PROGRESSIVE_BUILD_NODES = 1000;
+
+// per event loop iteration, so that the window stays responsive
+const int BUILD_SLICE_MS = 8;
+
+// where the nodes wait for the layout, when the build ends
+const qreal BUILD_LEVEL_SPACING = 150;
+const qreal BUILD_NODE_SPACING = 220;
+}
+
+namespace
+{
+class PaintedModeScope
+{
+public:
+    explicit PaintedModeScope(bool painted):
+        _previous( BehaviorTreeDataModel::paintedMode() )
+    {
+        BehaviorTreeDataModel::setPaintedMode( painted );
+    }
+    ~PaintedModeScope()
+    {
+        BehaviorTreeDataModel::setPaintedMode( _previous );
+    }
+private:
+    bool _previous;
+};
+}
+
+struct GraphicContainer::PendingLayout
+{
+    int generation;
+    std::vector<QUuid> ids;
+    std::vector<QPointF> positions;
+    size_t next;
+};
+
+struct GraphicContainer::PendingBuild
+{
+    AbsBehaviorTree tree;
+    // the indices in "tree", parents before children, a level after the other
+    std::vector<int> queue;
+    size_t next;
+    // the nodes already placed at each level
+    std::vector<int> level_count;
+    std::vector<int> level;
+    // -1 for the children of the Root created by the build
+    std::vector<int> parent;
+    // the index in nodesByIndex() of each node of "tree"
+    std::vector<int> scene_index;
+};
+
 GraphicContainer::GraphicContainer(std::shared_ptr<DataModelRegistry> model_registry,
                                    QWidget *parent) :
     QObject(parent),
     _model_registry( std::move(model_registry) ),
-    _signal_was_blocked(true)
+    _signal_was_blocked(true),
+    _nodes_index_valid(false),
+    _deferred(false),
+    _deferred_locked(false),
+    _connections_changed(false),
+    _undo_taken(false),
+    _layout_generation(0),
+    _revision(1)
 {
     _scene = new EditorFlowScene( _model_registry, parent );
     _view  = new QtNodes::FlowView( _scene, parent );
+    _virtualizer = new WidgetVirtualizer( _scene, _view, this );
+
+    // the nodes pasted from another instance of Groot
+    _scene->setUnknownModelHandler( [this](const NodeModel& model) { emit addNewModel( model ); } );
+
+    // what the undo history has to compare; connected before undoableChange()
+    connect( _scene, &QtNodes::FlowScene::nodeDeleted,
+             this, &GraphicContainer::markNodeChanged );
+
+    connect( _scene, &QtNodes::FlowScene::connectionCreated,
+             this, [this]() { _connections_changed = true; } );
+
+    connect( _scene, &QtNodes::FlowScene::connectionDeleted,
+             this, [this]() { _connections_changed = true; } );
 
     connect( _scene, &QtNodes::FlowScene::nodeDoubleClicked,
              this, &GraphicContainer::onNodeDoubleClicked);
@@ -29,6 +122,9 @@ GraphicContainer::GraphicContainer(std::shared_ptr<DataModelRegistry> model_regi
     connect( _scene, &QtNodes::FlowScene::nodeCreated,
              this,   &GraphicContainer::onNodeCreated  );
 
+    connect( _scene, &QtNodes::FlowScene::sceneRebuilt,
+             this,   &GraphicContainer::onSceneRebuilt  );
+
     connect( _scene, &QtNodes::FlowScene::nodeContextMenu,
              this, &GraphicContainer::onNodeContextMenu );
 
@@ -67,10 +163,82 @@ GraphicContainer::GraphicContainer(std::shared_ptr<DataModelRegistry> model_regi
         }
     });
 
+    // anything that may change the order used by BuildTreeFromScene()
+    connect( _scene, &QtNodes::FlowScene::nodeCreated,
+             this, &GraphicContainer::invalidateNodesIndex );
+
+    connect( _scene, &QtNodes::FlowScene::nodeDeleted,
+             this, &GraphicContainer::invalidateNodesIndex );
+
+    connect( _scene, &QtNodes::FlowScene::nodeMoved,
+             this, &GraphicContainer::invalidateNodesIndex );
+
+    connect( _scene, &QtNodes::FlowScene::connectionCreated,
+             this, &GraphicContainer::invalidateNodesIndex );
+
+    connect( _scene, &QtNodes::FlowScene::connectionDeleted,
+             this, &GraphicContainer::invalidateNodesIndex );
+
+}
+
+bool GraphicContainer::takeUndoChanges(std::set<QUuid> &nodes, bool &connections_changed)
+{
+    nodes.clear();
+    nodes.swap( _changed_nodes );
+    connections_changed = _connections_changed;
+    _connections_changed = false;
+
+    const bool compare_all = !_undo_taken;
+    _undo_taken = true;
+    return compare_all;
+}
+
+const std::vector<QtNodes::Node*>& GraphicContainer::nodesByIndex()
+{
+    if( isBuilding() )
+    {
+        // null where the node is not built yet
+        return _nodes_by_index;
+    }
+    materialize();
+    if( !_nodes_index_valid )
+    {
+        auto tree = BuildTreeFromScene( _scene );
+        _nodes_by_index.resize( tree.nodesCount() );
+        for(size_t index = 0; index < tree.nodesCount(); index++ )
+        {
+            _nodes_by_index[index] = tree.nodes()[index].graphic_node;
+        }
+        _nodes_index_valid = true;
+    }
+    return _nodes_by_index;
 }
 
 void GraphicContainer::lockEditing(bool locked)
 {
+    if( _deferred )
+    {
+        _deferred_locked = locked;
+        return;
+    }
+    // the copies of the expanded subtrees stay read-only, see appendTreeToNode()
+    std::set<QtNodes::Node*> subtree_copies;
+    if( !locked )
+    {
+        for (auto& nodes_it: _scene->nodes() )
+        {
+            auto subtree = dynamic_cast<SubtreeNodeModel*>( nodes_it.second->nodeDataModel() );
+            if( subtree && subtree->expanded() )
+            {
+                for (auto child: getChildren( *_scene, *nodes_it.second, false ) )
+                {
+                    auto copies = getSubtreeNodesRecursively( *child );
+                    subtree_copies.insert( copies.begin(), copies.end() );
+                }
+            }
+        }
+    }
+
     std::vector<QtNodes::Node*> subtrees_expanded;
     for (auto& nodes_it: _scene->nodes() )
     {
@@ -78,6 +246,14 @@ void GraphicContainer::lockEditing(bool locked)
         QtNodes::Node* node = nodes_it.second.get();
         auto bt_model = dynamic_cast<BehaviorTreeDataModel*>( node->nodeDataModel() );
 
+        if( !locked && !bt_model->hasWidgets() && subtree_copies.count( node ) == 0 &&
+            !_virtualizer->isActive() )
+        {
+            // created in painted mode, the editor needs the widgets
+            bt_model->createWidgets();
+            node->nodeGraphicsObject().updateEmbeddedQWidget();
+        }
+
         if(bt_model->registrationName() == "Root")
         {
             bt_model->lock( locked );
@@ -98,8 +274,7 @@ void GraphicContainer::lockEditing(bool locked)
         if( !locked )
         {
             node->nodeGraphicsObject().setGeometryChanged();
-            QtNodes::NodeStyle style;
-            node->nodeDataModel()->setNodeStyle( style );
+            node->nodeDataModel()->setNodeStyle( getDefaultStyle().first );
             node->nodeGraphicsObject().update();
         }
     }
@@ -114,6 +289,12 @@ void GraphicContainer::lockEditing(bool locked)
         QtNodes::Connection* conn = conn_it.second.get();
         conn->connectionGraphicsObject().lock( locked );
     }
+
+    // the geometry is frozen: the status changes repaint the borders only
+    _scene->setStaticLayer( locked );
+
+    // the widgets of the visible nodes, created in painted mode
+    _virtualizer->schedule();
 }
 
 void GraphicContainer::lockSubtreeEditing(Node &root_node, bool locked, bool change_style)
@@ -153,15 +334,147 @@ void GraphicContainer::lockSubtreeEditing(Node &root_node, bool locked, bool cha
 
 void GraphicContainer::nodeReorder()
 {
+    if( isBuilding() )
+    {
+        // done when the build ends
+        return;
+    }
+    materialize();
+    if( _layout_animation )
+    {
+        // the new layout starts from where the nodes are now
+        _layout_animation->stop();
+    }
+    // a layout still computed or applied is outdated
+    _layout_generation++;
+
+    auto abstract_tree = BuildTreeFromScene( _scene );
+
+    if( abstract_tree.nodesCount() >= ASYNC_LAYOUT_NODES )
+    {
+        startLayoutWorker( abstract_tree );
+        return;
+    }
+
+    if( !animated_layout )
+    {
+        {
+            const QSignalBlocker blocker(this);
+            NodeReorder( *_scene, abstract_tree );
+            zoomHomeView();
+        }
+        emit undoableChange();
+        return;
+    }
+
+    struct Move
+    {
+        QUuid id;
+        QPointF from;
+        QPointF to;
+    };
+    std::vector<Move> moves;
+    std::vector<QPointF> start_pos;
+    for (const auto& abs_node: abstract_tree.nodes())
+    {
+        start_pos.push_back( abs_node.pos );
+    }
+    ComputeTreeLayout( abstract_tree, _scene->layout() );
+    for (const auto& abs_node: abstract_tree.nodes())
+    {
+        if( abs_node.pos != start_pos[abs_node.index] )
+        {
+            moves.push_back( { abs_node.graphic_node->id(), start_pos[abs_node.index], abs_node.pos } );
+        }
+    }
+
+    auto animation = new QVariantAnimation( this );
+    animation->setDuration( LAYOUT_ANIMATION_MSEC );
+    animation->setStartValue( 0.0 );
+    animation->setEndValue( 1.0 );
+    animation->setEasingCurve( QEasingCurve::OutCubic );
+
+    connect( animation, &QVariantAnimation::valueChanged,
+             this, [this, moves](const QVariant& value)
+    {
+        const qreal t = value.toReal();
+        for (const Move& move: moves)
+        {
+            // the node may have been removed in the meantime
+            auto it = _scene->nodes().find( move.id );
+            if( it != _scene->nodes().end() )
+            {
+                _scene->setNodePosition( *it->second, move.from + (move.to - move.from)*t );
+            }
+        }
+    });
+
+    connect( animation, &QVariantAnimation::finished,
+             this, [this]()
     {
-        const QSignalBlocker blocker(this);
-        auto abstract_tree = BuildTreeFromScene( _scene );
-        NodeReorder( *_scene, abstract_tree );
         zoomHomeView();
+        emit undoableChange();
+    });
+
+    _layout_animation = animation;
+    animation->start( QAbstractAnimation::DeleteWhenStopped );
+}
+
+void GraphicContainer::startLayoutWorker(const AbsBehaviorTree &tree)
+{
+    auto layout = std::make_shared<PendingLayout>();
+    layout->generation = _layout_generation;
+    layout->next = 0;
+    for (const auto& abs_node: tree.nodes())
+    {
+        layout->ids.push_back( abs_node.graphic_node->id() );
     }
+
+    // not owned by the container: it may be destroyed before the thread ends
+    auto worker = new LayoutWorker( LayoutSnapshot::fromTree( tree, _scene->layout() ) );
+    connect( worker, &QThread::finished,
+             this, [this, worker, layout]()
+    {
+        layout->positions = worker->positions();
+        applyLayoutChunk( layout );
+    });
+    connect( worker, &QThread::finished, worker, &QObject::deleteLater );
+    worker->start();
+}
+
+void GraphicContainer::applyLayoutChunk(std::shared_ptr<PendingLayout> layout)
+{
+    if( layout->generation != _layout_generation )
+    {
+        return;
+    }
+    const size_t end = std::min( layout->next + LAYOUT_APPLY_CHUNK, layout->ids.size() );
+    for (size_t i = layout->next; i < end; i++)
+    {
+        // the node may have been removed in the meantime
+        auto it = _scene->nodes().find( layout->ids[i] );
+        if( it != _scene->nodes().end() &&
+            _scene->getNodePosition( *it->second ) != layout->positions[i] )
+        {
+            _scene->setNodePosition( *it->second, layout->positions[i] );
+        }
+    }
+    layout->next = end;
+
+    if( end < layout->ids.size() )
+    {
+        QTimer::singleShot( 0, this, [this, layout]() { applyLayoutChunk( layout ); } );
+        return;
+    }
+    zoomHomeView();
     emit undoableChange();
 }
 
+void GraphicContainer::setAnimatedLayout(bool animated)
+{
+    animated_layout = animated;
+}
+
 void GraphicContainer::zoomHomeView()
 {
     QRectF rect = _scene->itemsBoundingRect();
@@ -180,52 +493,24 @@ void GraphicContainer::zoomHomeView()
 
 bool GraphicContainer::containsValidTree() const
 {
-    if( _scene->nodes().empty())
+    if( _deferred )
     {
-        return false;
+        // built from a valid XML
+        return _deferred_tree && _deferred_tree->nodesCount() > 0;
     }
-
-    auto connections =  _scene->connections();
-
-    std::set<const QtNodes::Node*> nodes_with_input;
-    std::set<const QtNodes::Node*> nodes_with_output;
-
-    for (const auto& it: _scene->connections())
+    if( _scene->nodes().empty())
     {
-        const QtNodes::Connection* connection = it.second.get();
-        auto node = connection->getNode( QtNodes::PortType::In);
-        if( node ){
-            nodes_with_input.insert( node );
-        }
-        node = connection->getNode( QtNodes::PortType::Out);
-        if( node ){
-            nodes_with_output.insert( node );
-        }
+        return false;
     }
 
-    for (const auto& it: _scene->nodes())
-    {
-        const QtNodes::Node* node = it.second.get();
-        if( node->nodeDataModel()->nPorts(QtNodes::PortType::In) == 1 )
-        {
-            if( nodes_with_input.find(node) == nodes_with_input.end() )
-            {
-                return false;
-            }
-        }
-        if( node->nodeDataModel()->nPorts(QtNodes::PortType::Out) == 1 )
-        {
-            if( nodes_with_output.find(node) == nodes_with_output.end() )
-            {
-                return false;
-            }
-        }
-    }
-    return true;
+    return _scene->topology().isComplete();
 }
 
 void GraphicContainer::clearScene()
 {
+    _pending_build.reset();
+    _deferred = false;
+    _deferred_tree.reset();
     const QSignalBlocker blocker( this );
     _scene->clearScene();
 }
@@ -280,11 +565,12 @@ void GraphicContainer::createSubtree(Node &root_node, QString subtree_name )
     addNewModel( { NodeType::SUBTREE, subtree_name, {}} );
     QApplication::processEvents();
 
-    auto sub_tree = BuildTreeFromScene(_scene, &root_node);
+    auto sub_tree = BuildTreeFromScene(_scene, &root_node, true);
 
     for(auto& abs_node: sub_tree.nodes())
     {
-        if( &abs_node == sub_tree.rootNode() )
+        // or hidden by a collapsed branch
+        if( &abs_node == sub_tree.rootNode() || !abs_node.graphic_node )
         {
             continue;
         }
@@ -309,18 +595,74 @@ void GraphicContainer::onNodeDoubleClicked(Node &root_node)
 
 void GraphicContainer::onPortValueDoubleClicked(QLineEdit *edit_value)
 {
-    for (const auto& it: _scene->nodes())
+    const QString value = edit_value ?  edit_value->text() : QString();
+
+    auto highlight = [](Node& node, const QString& value)
+    {
+        auto node_model = dynamic_cast<BehaviorTreeDataModel*>( node.nodeDataModel() );
+        node_model->onHighlightPortValue( value );
+        if( !node_model->hasWidgets() )
+        {
+            node.nodeGraphicsObject().update();
+        }
+    };
+
+    // only the nodes highlighted before and the ones using the value
+    const auto& scene_nodes = _scene->nodes();
+    for (const QUuid& id: _highlighted_nodes)
     {
-        auto node_model = dynamic_cast<BehaviorTreeDataModel*>( it.second->nodeDataModel() );
-        QString val = edit_value ?  edit_value->text() : QString();
-        node_model->onHighlightPortValue( val );
+        auto it = scene_nodes.find( id );
+        if( it != scene_nodes.end() )
+        {
+            highlight( *it->second, QString() );
+        }
     }
+    _highlighted_nodes.clear();
+
+    if( !value.isEmpty() )
+    {
+        for (Node* node: _scene->nodesWithPortValue( value ))
+        {
+            highlight( *node, value );
+            _highlighted_nodes.push_back( node->id() );
+        }
+    }
+    emit portValueHighlighted( value );
 }
 
 void GraphicContainer::onNodeCreated(Node &node)
+{
+    markNodeChanged( node );
+    connectNodeModel( node );
+    undoableChange();
+}
+
+void GraphicContainer::onSceneRebuilt(const std::vector<Node*>& nodes)
+{
+    for(Node* node: nodes)
+    {
+        markNodeChanged( *node );
+        connectNodeModel( *node );
+    }
+    _connections_changed = true;
+    invalidateNodesIndex();
+    _virtualizer->schedule();
+    undoableChange();
+}
+
+void GraphicContainer::connectNodeModel(Node &node)
 {
     if( auto bt_node = dynamic_cast<BehaviorTreeDataModel*>( node.nodeDataModel() ) )
     {
+        const QUuid id = node.id();
+        auto mark_changed = [this, id]() { _changed_nodes.insert( id ); _revision++; };
+
+        connect( bt_node, &BehaviorTreeDataModel::parameterUpdated,
+                 this, mark_changed );
+
+        connect( bt_node, &BehaviorTreeDataModel::instanceNameChanged,
+                 this, mark_changed );
+
         connect( bt_node, &BehaviorTreeDataModel::parameterUpdated,
                  this, &GraphicContainer::undoableChange );
 
@@ -346,7 +688,6 @@ void GraphicContainer::onNodeCreated(Node &node)
 
         bt_node->initWidget();
     }
-    undoableChange();
 }
 
 void GraphicContainer::onNodeContextMenu(Node &node, const QPointF &)
@@ -386,6 +727,41 @@ void GraphicContainer::onNodeContextMenu(Node &node, const QPointF &)
         {
             createSubtree(node);
         });
+
+        // the hidden nodes are in the model of the node: a single undo step
+        if( bt_node->collapsedBranch() )
+        {
+            auto expand = node_menu->addAction("Expand branch");
+            connect( expand, &QAction::triggered, this, [this, &node]()
+            {
+                markNodeChanged( node );
+                bool expanded = false;
+                {
+                    const QSignalBlocker blocker(this);
+                    expanded = scene()->expandBranch( node );
+                }
+                if( !expanded )
+                {
+                    QMessageBox::warning( nullptr, tr("Expand branch"),
+                                          tr("The branch uses a model that is not registered.") );
+                    return;
+                }
+                emit undoableChange();
+            });
+        }
+        else{
+            auto collapse = node_menu->addAction("Collapse branch");
+            collapse->setEnabled( scene()->canCollapse( node ) );
+            connect( collapse, &QAction::triggered, this, [this, &node]()
+            {
+                markNodeChanged( node );
+                {
+                    const QSignalBlocker blocker(this);
+                    scene()->collapseBranch( node );
+                }
+                emit undoableChange();
+            });
+        }
     }
     //--------------------------------
     node_menu->exec( QCursor::pos() );
@@ -419,6 +795,12 @@ QtNodes::Node* GraphicContainer::substituteNode(Node *old_node, const QString& n
                 bt_new_node->setPortMapping( old_it.first, old_it.second );
             }
         }
+        if( bt_old_node->collapsedBranch() && new_node.nodeDataModel()->nPorts( PortType::Out ) == 1 )
+        {
+            bt_new_node->setCollapsedBranch(
+                        std::make_shared<const AbsBehaviorTree>( *bt_old_node->collapsedBranch() ) );
+        }
+        _scene->nodeChanged( new_node );
     }
 
     QPointF new_pos = prev_pos;
@@ -613,22 +995,33 @@ void GraphicContainer::recursiveLoadStep(QPointF& cursor,
                                          AbsBehaviorTree& tree,
                                          AbstractTreeNode* abs_node,
                                          Node* parent_node, int nest_level)
+{
+    createLoadedNode( abs_node, parent_node, cursor );
+
+    // the final position is given by NodeReorder()
+    for ( int index: abs_node->children_index)
+    {
+        cursor.setY( cursor.y() + LOAD_STEP_SPACING );
+        AbstractTreeNode* child = tree.node(index);
+        recursiveLoadStep(cursor, tree, child, abs_node->graphic_node, nest_level+1 );
+    }
+}
+
+Node& GraphicContainer::createLoadedNode(AbstractTreeNode* abs_node, Node* parent_node,
+                                         QPointF pos)
 {
     Node& new_node = _scene->createNodeAtPos( abs_node->model.registration_ID,
                                               abs_node->instance_name,
-                                              cursor);
+                                              pos);
     BehaviorTreeDataModel* bt_node = dynamic_cast<BehaviorTreeDataModel*>( new_node.nodeDataModel() );
 
     for (auto& port_it: abs_node->ports_mapping)
     {
         bt_node->setPortMapping( port_it.first, port_it.second );
     }
-    bt_node->initWidget();
 
-    new_node.nodeGeometry().recalculateSize();
-
-    abs_node->pos = cursor;
-    abs_node->size = _scene->getNodeSize( new_node );
+    // the size is computed when the batch ends, see onSceneRebuilt()
+    abs_node->pos = pos;
     abs_node->graphic_node = &new_node;
 
     // Special case for node Subtree. Expand if necessary
@@ -646,42 +1039,296 @@ void GraphicContainer::recursiveLoadStep(QPointF& cursor,
 
     _scene->createConnection( *abs_node->graphic_node, 0,
                               *parent_node, 0 );
+    return new_node;
+}
 
-    for ( int index: abs_node->children_index)
+
+void GraphicContainer::setDeferredTree(const AbsBehaviorTree &tree)
+{
+    clearScene();
+    _deferred_tree = std::make_shared<const AbsBehaviorTree>( tree );
+    _deferred = true;
+    _deferred_locked = false;
+}
+
+const AbsBehaviorTree &GraphicContainer::deferredTree() const
+{
+    static const AbsBehaviorTree empty_tree;
+    return _deferred_tree ? *_deferred_tree : empty_tree;
+}
+
+bool GraphicContainer::usesModel(const QString &ID) const
+{
+    if( !_deferred )
     {
-        cursor.setX( cursor.x() + abs_node->size.width() );
-        cursor.setY( cursor.y() + abs_node->size.height() );
-        AbstractTreeNode* child = tree.node(index);
-        recursiveLoadStep(cursor, tree, child, abs_node->graphic_node, nest_level+1 );
+        return !_scene->nodesOfModel( ID ).empty() || !_scene->collapsedUsages( ID ).empty();
+    }
+    for (const auto& abs_node: deferredTree().nodes())
+    {
+        if( abs_node.model.registration_ID == ID )
+        {
+            return true;
+        }
     }
+    return false;
 }
 
+void GraphicContainer::materialize()
+{
+    if( !_deferred )
+    {
+        return;
+    }
+    if( _pending_build )
+    {
+        buildStep( _pending_build, true );
+        return;
+    }
+    _deferred = false;
+    const std::shared_ptr<const AbsBehaviorTree> tree = std::move( _deferred_tree );
+    {
+        const QSignalBlocker blocker( this );
+        loadSceneFromTree( tree ? *tree : AbsBehaviorTree() );
+        auto abstract_tree = BuildTreeFromScene( _scene );
+        NodeReorder( *_scene, abstract_tree );
+    }
+    // the undo history compares the whole scene
+    _changed_nodes.clear();
+    _undo_taken = false;
+
+    if( _deferred_locked )
+    {
+        lockEditing( true );
+    }
+    zoomHomeView();
+}
 
 void GraphicContainer::loadSceneFromTree(const AbsBehaviorTree &tree)
 {
+    _pending_build.reset();
+    _deferred = false;
+    _deferred_tree.reset();
     AbsBehaviorTree abs_tree = tree;
     _scene->clearScene();
 
-    auto& first_qt_node = _scene->createNodeAtPos( "Root", "Root", QPointF(0,0) );
+    {
+        // the widgets are created later, by _virtualizer, for the visible nodes only
+        PaintedModeScope painted( BehaviorTreeDataModel::paintedMode() ||
+                                  WidgetVirtualizer::isActive( tree.nodesCount() ) );
 
-    QPointF cursor( - first_qt_node.nodeGeometry().width()*0.5,
-                    - first_qt_node.nodeGeometry().height()*0.5);
+        // nodes and connections are notified once, by onSceneRebuilt()
+        QtNodes::FlowScene::Batch batch( *_scene );
 
-    _scene->setNodePosition( first_qt_node, cursor );
+        auto& first_qt_node = _scene->createNodeAtPos( "Root", "Root", QPointF(0,0) );
+        first_qt_node.nodeGeometry().recalculateSizeIfDirty();
 
-    auto root_node = abs_tree.rootNode();
+        QPointF cursor( - first_qt_node.nodeGeometry().width()*0.5,
+                        - first_qt_node.nodeGeometry().height()*0.5);
 
-    if( root_node->model.registration_ID == "Root" )
-    {
-        root_node->graphic_node = &first_qt_node;
-        int root_child_index = root_node->children_index.front();
-        root_node = abs_tree.node(root_child_index);
+        _scene->setNodePosition( first_qt_node, cursor );
+
+        auto root_node = abs_tree.rootNode();
+
+        if( root_node->model.registration_ID == "Root" )
+        {
+            root_node->graphic_node = &first_qt_node;
+            int root_child_index = root_node->children_index.front();
+            root_node = abs_tree.node(root_child_index);
+        }
+
+        recursiveLoadStep(cursor, abs_tree, root_node, &first_qt_node, 1 );
     }
 
-    recursiveLoadStep(cursor, abs_tree, root_node, &first_qt_node, 1 );
+    for (auto& abs_node: abs_tree.nodes() )
+    {
+        if( abs_node.graphic_node )
+        {
+            abs_node.size = _scene->getNodeSize( *abs_node.graphic_node );
+        }
+    }
     NodeReorder( *_scene, abs_tree );
 }
 
+void GraphicContainer::loadSceneProgressively(const AbsBehaviorTree &tree)
+{
+    if( tree.nodesCount() < PROGRESSIVE_BUILD_NODES || !tree.rootNode() )
+    {
+        loadSceneFromTree( tree );
+        return;
+    }
+    NODE_TRACE_SCOPE("GraphicContainer::loadSceneProgressively");
+
+    clearScene();
+    // saved, searched and recorded in the undo history as a deferred tree
+    _deferred_tree = std::make_shared<const AbsBehaviorTree>( tree );
+    _deferred = true;
+
+    auto build = std::make_shared<PendingBuild>();
+    build->tree = tree;
+    build->next = 0;
+    build->level.resize( tree.nodesCount(), 0 );
+    build->parent.resize( tree.nodesCount(), -1 );
+    build->scene_index.resize( tree.nodesCount(), 0 );
+
+    // the order of BuildTreeFromScene(), with the Root created here first
+    const AbstractTreeNode* root_node = build->tree.rootNode();
+    const bool has_root = ( root_node->model.registration_ID == "Root" );
+    int scene_index = has_root ? 0 : 1;
+    std::function<void(const AbstractTreeNode*)> indexRecursively;
+    indexRecursively = [&](const AbstractTreeNode* abs_node)
+    {
+        build->scene_index[abs_node->index] = scene_index++;
+        for (int child: abs_node->children_index)
+        {
+            indexRecursively( build->tree.node(child) );
+        }
+    };
+    indexRecursively( root_node );
+    _nodes_by_index.assign( size_t( scene_index ), nullptr );
+
+    {
+        const QSignalBlocker blocker( this );
+        QtNodes::FlowScene::Batch batch( *_scene );
+        auto& first_qt_node = _scene->createNodeAtPos( "Root", "Root", QPointF(0,0) );
+        first_qt_node.nodeGraphicsObject().lock( true );
+        _nodes_by_index[0] = &first_qt_node;
+        if( has_root )
+        {
+            build->tree.rootNode()->graphic_node = &first_qt_node;
+            for (int child: root_node->children_index)
+            {
+                build->queue.push_back( child );
+            }
+        }
+        else{
+            build->queue.push_back( root_node->index );
+        }
+    }
+    // a level after the other
+    for (size_t i = 0; i < build->queue.size(); i++)
+    {
+        auto abs_node = build->tree.node( build->queue[i] );
+        for (int child: abs_node->children_index)
+        {
+            build->level[child] = build->level[abs_node->index] + 1;
+            build->parent[child] = abs_node->index;
+            build->queue.push_back( child );
+        }
+    }
+    _pending_build = build;
+
+    // the top levels are shown at once
+    buildStep( build, false );
+    zoomHomeView();
+}
+
+void GraphicContainer::cancelBuild()
+{
+    if( isBuilding() )
+    {
+        clearScene();
+        {
+            const QSignalBlocker blocker( this );
+            _scene->createNodeAtPos( "Root", "Root", QPointF(-30,-30) );
+        }
+        endBuild();
+        zoomHomeView();
+        emit buildFinished();
+        // the nodes removed
+        emit undoableChange();
+    }
+}
+
+void GraphicContainer::buildStep(std::shared_ptr<PendingBuild> build, bool whole)
+{
+    if( build != _pending_build )
+    {
+        // cancelled, or replaced by another tree
+        return;
+    }
+    NODE_TRACE_SCOPE("GraphicContainer::buildStep");
+
+    QElapsedTimer timer;
+    timer.start();
+    // check the clock every few nodes only
+    const size_t check_period = 16;
+    const bool horizontal = ( _scene->layout() == QtNodes::PortLayout::Horizontal );
+    {
+        const QSignalBlocker blocker( this );
+        // the widgets of the large trees are created by _virtualizer
+        PaintedModeScope painted( BehaviorTreeDataModel::paintedMode() ||
+                                  WidgetVirtualizer::isActive( build->tree.nodesCount() ) );
+        QtNodes::FlowScene::Batch batch( *_scene );
+
+        size_t count = 0;
+        while( build->next < build->queue.size() )
+        {
+            AbstractTreeNode* abs_node = build->tree.node( build->queue[build->next++] );
+            const int level = build->level[abs_node->index];
+            if( level >= int( build->level_count.size() ) )
+            {
+                build->level_count.resize( size_t( level + 1 ), 0 );
+            }
+            const qreal across = BUILD_NODE_SPACING * build->level_count[level]++;
+            const qreal along = BUILD_LEVEL_SPACING * ( level + 1 );
+            const QPointF pos = horizontal ? QPointF( along, across ) : QPointF( across, along );
+
+            const int parent = build->parent[abs_node->index];
+            Node* parent_node = parent >= 0 ? build->tree.node( size_t(parent) )->graphic_node :
+                                              _nodes_by_index[0];
+            Node& new_node = createLoadedNode( abs_node, parent_node, pos );
+            _nodes_by_index[ size_t( build->scene_index[abs_node->index] ) ] = &new_node;
+
+            // read-only until the build ends
+            new_node.nodeGraphicsObject().lock( true );
+            dynamic_cast<BehaviorTreeDataModel*>( new_node.nodeDataModel() )->lock( true );
+            for (auto& conn_it: new_node.nodeState().connections( PortType::In, 0 ))
+            {
+                conn_it.second->connectionGraphicsObject().lock( true );
+            }
+
+            if( !whole && ++count % check_period == 0 && timer.elapsed() >= BUILD_SLICE_MS )
+            {
+                break;
+            }
+        }
+    }
+    emit buildProgress( int( build->next ) + 1, int( build->queue.size() ) + 1 );
+
+    if( build->next < build->queue.size() )
+    {
+        QTimer::singleShot( 0, this, [this, build]() { buildStep( build, false ); } );
+        return;
+    }
+    finishBuild();
+}
+
+void GraphicContainer::endBuild()
+{
+    _pending_build.reset();
+    _deferred = false;
+    _deferred_tree.reset();
+    invalidateNodesIndex();
+
+    // the undo history compares the whole scene
+    _changed_nodes.clear();
+    _undo_taken = false;
+
+    const QSignalBlocker blocker( this );
+    lockEditing( _deferred_locked );
+}
+
+void GraphicContainer::finishBuild()
+{
+    endBuild();
+    {
+        const QSignalBlocker blocker( this );
+        nodeReorder();
+    }
+    zoomHomeView();
+    emit buildFinished();
+}
+
 void GraphicContainer::appendTreeToNode(Node &node, AbsBehaviorTree& subtree)
 {
     const QSignalBlocker blocker( this );
@@ -711,6 +1358,9 @@ void GraphicContainer::appendTreeToNode(Node &node, AbsBehaviorTree& subtree)
         }
     }
 
+    // the copy is read-only: painted, without widgets
+    PaintedModeScope painted( true );
+    QtNodes::FlowScene::Batch batch( *_scene );
     recursiveLoadStep(cursor, subtree, root_node , &node, 1 );
 }
 
@@ -4,9 +4,12 @@
 #include <QObject>
 #include <QWidget>
 #include <QLineEdit>
+#include <QPointer>
+#include <QVariantAnimation>
 
 #include "bt_editor_base.h"
 #include "editor_flowscene.h"
+#include "widget_virtualizer.h"
 
 #include <nodes/Node>
 #include <nodes/NodeData>
@@ -21,9 +24,13 @@ public:
     explicit GraphicContainer(std::shared_ptr<QtNodes::DataModelRegistry> registry,
                               QWidget *parent = nullptr);
 
-    EditorFlowScene* scene() { return _scene; }
+    // builds the deferred tree, if any
+    EditorFlowScene* scene() { materialize(); return _scene; }
     QtNodes::FlowView*  view() { return _view; }
 
+    WidgetVirtualizer* widgetVirtualizer() { return _virtualizer; }
+
+    // the deferred tree is not built: the scene may be empty
     const EditorFlowScene* scene()  const{ return _scene; }
     const QtNodes::FlowView* view() const { return _view; }
 
@@ -33,6 +40,9 @@ public:
 
     void nodeReorder();
 
+    // nodeReorder() moves the nodes to their new position in a short animation
+    static void setAnimatedLayout(bool animated);
+
     void zoomHomeView();
 
     bool containsValidTree() const;
@@ -43,6 +53,37 @@ public:
 
     void loadSceneFromTree(const AbsBehaviorTree &tree);
 
+    // Like loadSceneFromTree(), but the scene, with the widgets of all its
+    // nodes, is built only when needed: the first time scene() is called.
+    void setDeferredTree(const AbsBehaviorTree &tree);
+
+    bool isMaterialized() const { return !_deferred; }
+
+    // the tree that materialize() builds, empty when materialized
+    const AbsBehaviorTree& deferredTree() const;
+
+    // the same, shared with the undo history; null when materialized
+    std::shared_ptr<const AbsBehaviorTree> sharedDeferredTree() const { return _deferred_tree; }
+
+    // if any node uses the model, without building a deferred tree
+    bool usesModel(const QString& ID) const;
+
+    // the layout used when the deferred tree is built
+    void setDeferredLayout(QtNodes::PortLayout layout) { _scene->setLayout( layout ); }
+
+    void materialize();
+
+    // Like loadSceneFromTree(), but the large trees are built a level at a
+    // time, in slices of BUILD_SLICE_MS per event loop iteration. Until
+    // buildFinished(), the container behaves as a deferred one, its nodes
+    // are locked, and materialize() completes the build at once.
+    void loadSceneProgressively(const AbsBehaviorTree &tree);
+
+    bool isBuilding() const { return _pending_build != nullptr; }
+
+    // the nodes built so far are removed, only the Root is left
+    void cancelBuild();
+
     void appendTreeToNode(QtNodes::Node& node, AbsBehaviorTree &subtree);
 
     void loadFromJson(const QByteArray& data);
@@ -55,6 +96,23 @@ public:
 
     void createSubtree(QtNodes::Node& root_node, QString subtree_name = QString());
 
+    // Graphic nodes, indexed as the nodes returned by BuildTreeFromScene().
+    // Built on demand and invalidated only when the scene changes.
+    const std::vector<QtNodes::Node*>& nodesByIndex();
+
+    void invalidateNodesIndex() { _nodes_index_valid = false; _revision++; }
+
+    // changes every time the tree changes
+    unsigned revision() const { return _revision; }
+
+    // The nodes created, removed or modified since the last call, for the
+    // undo history. Returns true if the whole scene must be compared instead,
+    // the first time it is called.
+    bool takeUndoChanges(std::set<QUuid>& nodes, bool& connections_changed);
+
+    // for the changes of a node that are not notified by its model
+    void markNodeChanged(const QtNodes::Node& node) { _changed_nodes.insert( node.id() ); _revision++; }
+
 public slots:
 
     void onNodeDoubleClicked(QtNodes::Node& root_node);
@@ -63,6 +121,9 @@ public slots:
 
     void onNodeCreated(QtNodes::Node &node);
 
+    // the nodes created by a batch of the scene, see loadSceneFromTree()
+    void onSceneRebuilt(const std::vector<QtNodes::Node*>& nodes);
+
     void onNodeContextMenu(QtNodes::Node& node, const QPointF& pos);
 
     void onConnectionContextMenu(QtNodes::Connection &connection, const QPointF&);
@@ -80,24 +141,80 @@ signals:
 
     void requestSubTreeCreate(AbsBehaviorTree tree, QString name);
 
+    // empty when nothing is highlighted
+    void portValueHighlighted(QString value);
+
+    // the nodes created by loadSceneProgressively(), Root included
+    void buildProgress(int built, int total);
+
+    void buildFinished();
+
 private:
     EditorFlowScene* _scene;
     QtNodes::FlowView*  _view;
 
+    // only the nodes around the view have widgets, in the large trees
+    WidgetVirtualizer* _virtualizer;
+
     void createMorphSubMenu(QtNodes::Node &node, QMenu *nodeMenu);
 
    void createSmartRemoveAction(QtNodes::Node &node, QMenu *nodeMenu);
 
    void insertNodeInConnection(QtNodes::Connection &connection, QString node_name);
 
+   void connectNodeModel(QtNodes::Node& node);
+
    void recursiveLoadStep(QPointF &cursor, AbsBehaviorTree &tree,
                           AbstractTreeNode *abs_node,
                           QtNodes::Node* parent_node, int nest_level);
 
+   QtNodes::Node& createLoadedNode(AbstractTreeNode *abs_node, QtNodes::Node* parent_node,
+                                   QPointF pos);
+
+   // a progressive build of loadSceneProgressively()
+   struct PendingBuild;
+
+   std::shared_ptr<PendingBuild> _pending_build;
+
+   // a slice of the build, or all of it
+   void buildStep(std::shared_ptr<PendingBuild> build, bool whole);
+
+   // the state of a tab built, after finishBuild() or cancelBuild()
+   void endBuild();
+
+   void finishBuild();
+
    std::shared_ptr<QtNodes::DataModelRegistry> _model_registry;
 
    bool _signal_was_blocked;
 
+   std::vector<QtNodes::Node*> _nodes_by_index;
+   bool _nodes_index_valid;
+
+   bool _deferred;
+   std::shared_ptr<const AbsBehaviorTree> _deferred_tree;
+   bool _deferred_locked;
+
+   std::set<QUuid> _changed_nodes;
+   bool _connections_changed;
+   bool _undo_taken;
+
+   QPointer<QVariantAnimation> _layout_animation;
+
+   // the nodes with a highlighted port, see onPortValueDoubleClicked()
+   std::vector<QUuid> _highlighted_nodes;
+
+   // a layout computed by a LayoutWorker, applied a chunk at a time
+   struct PendingLayout;
+
+   int _layout_generation;
+
+   unsigned _revision;
+
+   void startLayoutWorker(const AbsBehaviorTree& tree);
+
+   void applyLayoutChunk(std::shared_ptr<PendingLayout> layout);
+
 };
 
 #endif // GRAPHIC_CONTAINER_H
@@ -0,0 +1,326 @@
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRunnable>
+#include <QSaveFile>
+#include <QThreadPool>
+#include <QWidget>
+#include <algorithm>
+#include <iostream>
+
+#include "tree_files.h"
+#include "scene_export.h"
+#include "graphic_container.h"
+
+// Headless validation and conversion of tree files, many at once:
+//
+//   groot_cli validate --palette models.xml trees/*.xml
+//   groot_cli format trees/*.xml                 (rewritten in place)
+//   groot_cli convert -o logs/ trees/*.xml       (XML to .fbl, .fbl to XML)
+//   groot_cli export --format png -o images/ trees/*.xml
+//
+// A JSON report of every file is written to the standard output, or to
+// --report; the exit code is 1 if one of the files failed.
+
+namespace
+{
+
+enum class Command { VALIDATE, FORMAT, CONVERT, EXPORT };
+
+struct FileResult
+{
+    QString file;
+    QString output;
+    // the images of "export"
+    QStringList images;
+    QString error;
+    size_t trees = 0;
+    size_t nodes = 0;
+};
+
+class FileTask : public QRunnable
+{
+public:
+    FileTask(Command command, const NodeModels& palette, const QString& output_dir,
+             FileResult& result):
+        _command(command), _palette(palette), _output_dir(output_dir), _result(result)
+    {}
+
+    void run() override
+    {
+        try {
+            const TreeFileContent content = ReadTreeFile( _result.file, _palette );
+            _result.trees = content.trees.size();
+            _result.nodes = content.nodesCount();
+
+            if( _command == Command::VALIDATE )
+            {
+                return;
+            }
+            const QFileInfo info( _result.file );
+            const bool to_log = ( _command == Command::CONVERT && info.suffix() != "fbl" );
+            QString name = info.fileName();
+            if( _command == Command::CONVERT )
+            {
+                name = info.completeBaseName() + ( to_log ? ".fbl" : ".xml" );
+            }
+            _result.output = _output_dir.isEmpty() ? info.dir().filePath( name ) :
+                                                     QDir( _output_dir ).filePath( name );
+            write( to_log ? WriteTreeFileLog( content ) : WriteTreeFileXML( content ) );
+        }
+        catch( std::exception& err )
+        {
+            _result.error = err.what();
+        }
+    }
+
+private:
+    Command _command;
+    const NodeModels& _palette;
+    const QString& _output_dir;
+    FileResult& _result;
+
+    void write(const QByteArray& data)
+    {
+        // never a half written file, even in place
+        QSaveFile file( _result.output );
+        if( !file.open( QIODevice::WriteOnly ) || file.write( data ) != data.size() || !file.commit() )
+        {
+            throw std::runtime_error( QString("%1: %2").arg( _result.output, file.errorString() ).toStdString() );
+        }
+    }
+};
+
+struct ExportOptions
+{
+    bool png = false;
+    double scale = 1.0;
+    int tile_size = 4096;
+};
+
+// An image of each tree, "<file>_<tree>.svg". The scenes need the GUI
+// thread: the files are exported one after the other.
+void exportImages(const ExportOptions& options, const NodeModels& palette,
+                  const QString& output_dir, FileResult& result)
+{
+    try {
+        const TreeFileContent content = ReadTreeFile( result.file, palette );
+        result.trees = content.trees.size();
+        result.nodes = content.nodesCount();
+
+        const QFileInfo info( result.file );
+        const QDir dir = output_dir.isEmpty() ? info.dir() : QDir( output_dir );
+        const auto registry = CreateModelRegistry( content.models );
+        for (const auto& tree_it: content.trees)
+        {
+            // the scene and the view are children of the holder
+            QWidget holder;
+            GraphicContainer container( registry, &holder );
+            container.loadSceneFromTree( tree_it.second );
+
+            const QString image = dir.filePath( QString("%1_%2.%3").arg( info.completeBaseName(), tree_it.first,
+                                                                         options.png ? "png" : "svg" ) );
+            const QColor background = container.view()->backgroundBrush().color();
+            if( options.png )
+            {
+                result.images += ExportScenePNG( *container.scene(), image, background,
+                                                 options.scale, options.tile_size );
+            }
+            else{
+                ExportSceneSVG( *container.scene(), image, background, tree_it.first );
+                result.images.push_back( image );
+            }
+        }
+    }
+    catch( std::exception& err )
+    {
+        result.error = err.what();
+    }
+}
+
+QJsonObject toJson(const FileResult& result)
+{
+    QJsonObject object;
+    object["file"] = result.file;
+    object["ok"] = result.error.isEmpty();
+    if( !result.error.isEmpty() )
+    {
+        object["error"] = result.error;
+    }
+    if( !result.output.isEmpty() && result.error.isEmpty() )
+    {
+        object["output"] = result.output;
+    }
+    if( !result.images.isEmpty() )
+    {
+        object["images"] = QJsonArray::fromStringList( result.images );
+    }
+    object["trees"] = double( result.trees );
+    object["nodes"] = double( result.nodes );
+    return object;
+}
+
+}
+
+int
+main(int argc, char *argv[])
+{
+    // the scenes of "export" are rendered without any display
+    if( qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM") )
+    {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QApplication app(argc, argv);
+    app.setApplicationName("groot_cli");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Validate, format, convert or export as images BehaviorTree "
+                                     "files, in parallel, as Groot loads and saves them.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("command", "validate, format, convert or export.");
+    parser.addPositionalArgument("files", "The .xml or .fbl files.", "files...");
+
+    QCommandLineOption palette_option(QStringList() << "p" << "palette",
+                                      "Models of the nodes, as <TreeNodesModel> or .skills.json. "
+                                      "Can be repeated.", "file");
+    parser.addOption(palette_option);
+
+    QCommandLineOption output_option(QStringList() << "o" << "output",
+                                     "Directory of the formatted, converted or exported files. By "
+                                     "default, next to each file: format rewrites it.", "directory");
+    parser.addOption(output_option);
+
+    QCommandLineOption report_option(QStringList() << "r" << "report",
+                                     "JSON report; \"-\", the default, for the standard output.",
+                                     "file");
+    parser.addOption(report_option);
+
+    QCommandLineOption jobs_option(QStringList() << "j" << "jobs",
+                                   "Files processed at the same time. By default, one per core.",
+                                   "count");
+    parser.addOption(jobs_option);
+
+    QCommandLineOption format_option("format", "Images of export: svg, the default, or png.", "format");
+    parser.addOption(format_option);
+
+    QCommandLineOption scale_option("scale", "Pixels per unit of the scene, for png.", "scale", "1");
+    parser.addOption(scale_option);
+
+    QCommandLineOption tile_option("tile", "Largest side of a png: a larger image is "
+                                   "split in tiles <file>_<tree>_<row>_<column>.png.", "pixels", "4096");
+    parser.addOption(tile_option);
+    parser.process( app );
+
+    QStringList arguments = parser.positionalArguments();
+    if( arguments.size() < 2 )
+    {
+        parser.showHelp(1);
+    }
+    const QString command_name = arguments.takeFirst();
+    Command command;
+    if( command_name == "validate" )     command = Command::VALIDATE;
+    else if( command_name == "format" )  command = Command::FORMAT;
+    else if( command_name == "convert" ) command = Command::CONVERT;
+    else if( command_name == "export" )  command = Command::EXPORT;
+    else{
+        std::cerr << "wrong command. Use one of these: validate / format / convert / export" << std::endl;
+        return 1;
+    }
+
+    ExportOptions export_options;
+    export_options.png = parser.value(format_option).toLower() == "png";
+    export_options.scale = parser.value(scale_option).toDouble();
+    export_options.tile_size = parser.value(tile_option).toInt();
+    if( parser.isSet(format_option) && !export_options.png && parser.value(format_option).toLower() != "svg" )
+    {
+        std::cerr << "wrong format. Use svg or png" << std::endl;
+        return 1;
+    }
+
+    NodeModels palette;
+    for (const QString& palette_file: parser.values(palette_option))
+    {
+        try {
+            for (auto& it: ReadPaletteFile( palette_file ))
+            {
+                palette.insert( std::move(it) );
+            }
+        }
+        catch( std::exception& err )
+        {
+            std::cerr << err.what() << std::endl;
+            return 1;
+        }
+    }
+
+    const QString output_dir = parser.value(output_option);
+    if( !output_dir.isEmpty() && !QDir().mkpath( output_dir ) )
+    {
+        std::cerr << output_dir.toStdString() << ": can't create the directory" << std::endl;
+        return 1;
+    }
+
+    std::vector<FileResult> results( size_t( arguments.size() ) );
+    QThreadPool pool;
+    if( parser.isSet(jobs_option) )
+    {
+        pool.setMaxThreadCount( std::max( 1, parser.value(jobs_option).toInt() ) );
+    }
+    for (int i = 0; i < arguments.size(); i++)
+    {
+        results[i].file = arguments[i];
+        if( command == Command::EXPORT )
+        {
+            exportImages( export_options, palette, output_dir, results[i] );
+            continue;
+        }
+        // the pool deletes the task
+        pool.start( new FileTask( command, palette, output_dir, results[i] ) );
+    }
+    pool.waitForDone();
+
+    QJsonArray files;
+    int failed = 0;
+    for (const auto& result: results)
+    {
+        files.append( toJson( result ) );
+        if( !result.error.isEmpty() )
+        {
+            failed++;
+            std::cerr << result.error.toStdString() << std::endl;
+        }
+    }
+    QJsonObject report;
+    report["command"] = command_name;
+    report["files"] = files;
+    report["failed"] = failed;
+
+    QFile output;
+    const QString report_name = parser.value(report_option);
+    bool opened = false;
+    if( report_name.isEmpty() || report_name == "-" )
+    {
+        opened = output.open( stdout, QIODevice::WriteOnly );
+    }
+    else{
+        output.setFileName( report_name );
+        opened = output.open( QIODevice::WriteOnly | QIODevice::Truncate );
+    }
+    if( !opened )
+    {
+        std::cerr << report_name.toStdString() << ": "
+                  << output.errorString().toStdString() << std::endl;
+        return 1;
+    }
+    output.write( QJsonDocument( report ).toJson() );
+    output.close();
+
+    std::cerr << results.size() - size_t(failed) << " of " << results.size() << " files "
+              << ( command == Command::VALIDATE ? "valid" : "written" ) << std::endl;
+    return failed == 0 ? 0 : 1;
+}
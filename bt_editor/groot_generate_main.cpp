@@ -0,0 +1,124 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <iostream>
+
+#include "synthetic_trees.h"
+
+// Synthetic trees and logs, to load Groot with more than the samples:
+//
+//   groot_generate --depth 8 --subtrees 20 big.xml big.fbl
+//   groot_generate --transitions 5000000 --halt-ratio 0.1 restarts.fbl
+//
+// A .xml output gets the trees, a .fbl output a log of their main tree.
+
+namespace
+{
+
+bool writeFile(const QString& path, const QByteArray& data)
+{
+    QSaveFile file( path );
+    if( !file.open( QIODevice::WriteOnly ) || file.write( data ) != data.size() || !file.commit() )
+    {
+        std::cerr << path.toStdString() << ": " << file.errorString().toStdString() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+}
+
+int
+main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    app.setApplicationName("groot_generate");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Generate BehaviorTree files and logs of any size. "
+                                     "The same options give the same files.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("outputs", "The .xml and .fbl files to write.", "outputs...");
+
+    const SyntheticTreeOptions tree_defaults;
+    const SyntheticLogOptions log_defaults;
+
+    QCommandLineOption depth_option("depth", "Levels of the main tree.", "levels",
+                                    QString::number( tree_defaults.depth ));
+    QCommandLineOption branching_option("branching", "Children of each control node.", "count",
+                                        QString::number( tree_defaults.branching ));
+    QCommandLineOption subtrees_option("subtrees", "Trees called by SubTree nodes.", "count",
+                                       QString::number( tree_defaults.subtrees ));
+    QCommandLineOption subtree_ratio_option("subtree-ratio",
+                                            "Share of the leaves of the main tree calling a subtree.",
+                                            "ratio", QString::number( tree_defaults.subtree_ratio ));
+    QCommandLineOption models_option("models", "Models of the actions and conditions.", "count",
+                                     QString::number( tree_defaults.models ));
+    QCommandLineOption ports_option("ports", "Input ports of each model.", "count",
+                                    QString::number( tree_defaults.ports ));
+    QCommandLineOption transitions_option("transitions", "Transitions of the log.", "count",
+                                          QString::number( log_defaults.transitions ));
+    QCommandLineOption failure_option("failure-ratio", "Share of the leaves that fail.", "ratio",
+                                      QString::number( log_defaults.failure_ratio ));
+    QCommandLineOption running_option("running-ratio",
+                                      "Share of the actions still running at the end of a tick.",
+                                      "ratio", QString::number( log_defaults.running_ratio ));
+    QCommandLineOption halt_option("halt-ratio",
+                                   "Share of the ticks after which the tree is halted and restarted.",
+                                   "ratio", QString::number( log_defaults.halt_ratio ));
+    QCommandLineOption period_option("tick-period", "Seconds between two ticks.", "seconds",
+                                     QString::number( log_defaults.tick_period ));
+    QCommandLineOption seed_option("seed", "Seed of the random choices.", "number",
+                                   QString::number( tree_defaults.seed ));
+
+    parser.addOptions( { depth_option, branching_option, subtrees_option, subtree_ratio_option,
+                         models_option, ports_option, transitions_option, failure_option,
+                         running_option, halt_option, period_option, seed_option } );
+    parser.process( app );
+
+    const QStringList outputs = parser.positionalArguments();
+    if( outputs.isEmpty() )
+    {
+        parser.showHelp(1);
+    }
+
+    SyntheticTreeOptions tree_options;
+    tree_options.depth         = parser.value(depth_option).toInt();
+    tree_options.branching     = parser.value(branching_option).toInt();
+    tree_options.subtrees      = parser.value(subtrees_option).toInt();
+    tree_options.subtree_ratio = parser.value(subtree_ratio_option).toDouble();
+    tree_options.models        = parser.value(models_option).toInt();
+    tree_options.ports         = parser.value(ports_option).toInt();
+    tree_options.seed          = parser.value(seed_option).toUInt();
+
+    SyntheticLogOptions log_options;
+    log_options.transitions   = size_t( parser.value(transitions_option).toULongLong() );
+    log_options.failure_ratio = parser.value(failure_option).toDouble();
+    log_options.running_ratio = parser.value(running_option).toDouble();
+    log_options.halt_ratio    = parser.value(halt_option).toDouble();
+    log_options.tick_period   = parser.value(period_option).toDouble();
+    log_options.seed          = tree_options.seed;
+
+    try {
+        const TreeFileContent content = GenerateSyntheticTrees( tree_options );
+        std::cerr << content.trees.size() << " trees, " << content.nodesCount() << " nodes" << std::endl;
+
+        for (const QString& output: outputs)
+        {
+            const bool is_log = QFileInfo( output ).suffix() == "fbl";
+            const QByteArray data = is_log ? GenerateSyntheticLog( content, log_options ) :
+                                             WriteTreeFileXML( content );
+            if( !writeFile( output, data ) )
+            {
+                return 1;
+            }
+        }
+    }
+    catch( std::exception& err )
+    {
+        std::cerr << err.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
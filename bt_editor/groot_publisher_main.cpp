@@ -0,0 +1,336 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QtEndian>
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <random>
+#include <zmq.hpp>
+
+#include "monitor_receiver.h"
+#include "synthetic_trees.h"
+#include "utils.h"
+
+// A fake BT server, to load the monitor without a robot:
+//
+//   groot_publisher --depth 7 --rate 500 --changes 50 --burst 10
+//   GROOT_MONITOR_STATS=/tmp/stats.json Groot --mode monitor
+//   groot_publisher --tree my_tree.xml --stats /tmp/stats.json
+//   groot_publisher --depth 9 --topics
+//   groot_publisher --ipc /tmp/bt      (address of the monitor: ipc:///tmp/bt)
+//
+// As BT::PublisherZMQ, the tree is served on the REQ port and the statuses
+// are published on the PUB port. The timestamps are the wall clock, so the
+// lag measured by the monitor on the same computer is end to end.
+// With --topics, the statuses are published by blocks of nodes, with a
+// keyframe every second, see MonitorBlockTopic().
+
+namespace
+{
+
+struct PublisherNode
+{
+    uint16_t uid;
+    NodeStatus status;
+};
+
+void appendLE32(QByteArray& buffer, quint32 value)
+{
+    uchar bytes[4];
+    qToLittleEndian<quint32>( value, bytes );
+    buffer.append( reinterpret_cast<const char*>( bytes ), 4 );
+}
+
+// u32 header_size | (u16 uid | u8 status) per node | u32 count | transitions
+class StatusMessage
+{
+public:
+    StatusMessage(size_t nodes_count)
+    {
+        _buffer.reserve( int( 8 + nodes_count * 3 ) );
+    }
+
+    // "count" nodes from "nodes"
+    const QByteArray& build(const PublisherNode* nodes, size_t count,
+                            const QByteArray& transitions, int transitions_count)
+    {
+        _buffer.resize( 0 );
+        appendLE32( _buffer, quint32( count * 3 ) );
+        for (size_t n = 0; n < count; n++)
+        {
+            uchar bytes[3];
+            qToLittleEndian<quint16>( nodes[n].uid, bytes );
+            bytes[2] = uchar( nodes[n].status );
+            _buffer.append( reinterpret_cast<const char*>( bytes ), 3 );
+        }
+        appendLE32( _buffer, quint32( transitions_count ) );
+        _buffer.append( transitions );
+        return _buffer;
+    }
+
+private:
+    QByteArray _buffer;
+};
+
+void appendTransition(QByteArray& buffer, double timestamp, const PublisherNode& node,
+                      NodeStatus prev_status)
+{
+    uchar transition[12];
+    const quint32 t_sec = quint32( timestamp );
+    qToLittleEndian<quint32>( t_sec, transition );
+    qToLittleEndian<quint32>( quint32( ( timestamp - t_sec ) * 1e6 ), transition + 4 );
+    qToLittleEndian<quint16>( node.uid, transition + 8 );
+    transition[10] = uchar( prev_status );
+    transition[11] = uchar( node.status );
+    buffer.append( reinterpret_cast<const char*>( transition ), 12 );
+}
+
+void sendTopic(zmq::socket_t& publisher, const std::string& topic, const QByteArray& buffer)
+{
+    zmq::message_t topic_msg( topic.data(), topic.size() );
+    publisher.send( topic_msg, ZMQ_SNDMORE );
+    zmq::message_t msg( buffer.constData(), size_t( buffer.size() ) );
+    publisher.send( msg );
+}
+
+// the first session of the statistics written by the monitor
+void printMonitorStats(const QString& path)
+{
+    QFile file( path );
+    if( !file.open( QIODevice::ReadOnly ) )
+    {
+        return;
+    }
+    const QJsonArray sessions = QJsonDocument::fromJson( file.readAll() ).object()["sessions"].toArray();
+    if( sessions.isEmpty() )
+    {
+        return;
+    }
+    const QJsonObject stats = sessions.first().toObject();
+    std::cerr << "  monitor: " << stats["messages_per_sec"].toDouble() << " msg/s, lag "
+              << stats["lag_ms"].toDouble() << " ms, draw "
+              << stats["apply_us_per_frame"].toDouble() << " us/frame, dropped "
+              << stats["dropped"].toInt() << ", coalesced "
+              << qint64( stats["coalesced"].toDouble() ) << std::endl;
+}
+
+}
+
+int
+main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    app.setApplicationName("groot_publisher");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Serve a tree and publish the status of its nodes, "
+                                     "as BT::PublisherZMQ does, to load the monitor of Groot.");
+    parser.addHelpOption();
+
+    const SyntheticTreeOptions tree_defaults;
+
+    QCommandLineOption tree_option("tree", "The tree to publish; a synthetic one by default.", "file");
+    QCommandLineOption depth_option("depth", "Levels of the synthetic tree.", "levels",
+                                    QString::number( tree_defaults.depth ));
+    QCommandLineOption branching_option("branching", "Children of its control nodes.", "count",
+                                        QString::number( tree_defaults.branching ));
+    QCommandLineOption publisher_option("publisher-port", "Port of the statuses.", "port", "1666");
+    QCommandLineOption server_option("server-port", "Port of the tree.", "port", "1667");
+    QCommandLineOption rate_option("rate", "Messages per second.", "count", "100");
+    QCommandLineOption changes_option("changes", "Nodes changing status in each message.",
+                                      "count", "10");
+    QCommandLineOption burst_option("burst", "Messages sent back to back, the same rate on "
+                                    "average: 1 for a steady flow.", "count", "1");
+    QCommandLineOption duration_option("duration", "Seconds, 0 to run until killed.", "seconds", "0");
+    QCommandLineOption stats_option("stats", "Statistics written by the monitor, with "
+                                    "GROOT_MONITOR_STATS, to print with ours.", "file");
+    QCommandLineOption ipc_option("ipc", "Bind ipc://path.port instead of TCP, to "
+                                  "monitor on the same computer.", "path");
+    QCommandLineOption topics_option("topics", "Publish by blocks of nodes, for the monitors "
+                                     "that subscribe to the visible nodes only.");
+
+    parser.addOptions( { tree_option, depth_option, branching_option, publisher_option,
+                         server_option, rate_option, changes_option, burst_option,
+                         duration_option, stats_option, topics_option, ipc_option } );
+    parser.process( app );
+
+    std::vector<uint8_t> tree_buffer;
+    try {
+        TreeFileContent content;
+        if( parser.isSet(tree_option) )
+        {
+            content = ReadTreeFile( parser.value(tree_option) );
+        }
+        else{
+            SyntheticTreeOptions tree_options;
+            tree_options.depth = parser.value(depth_option).toInt();
+            tree_options.branching = parser.value(branching_option).toInt();
+            content = GenerateSyntheticTrees( tree_options );
+        }
+        std::map<QString, const AbsBehaviorTree*> subtrees;
+        for (const auto& it: content.trees)
+        {
+            subtrees.insert( { it.first, &it.second } );
+        }
+        auto main_it = content.trees.find( content.main_tree );
+        if( main_it == content.trees.end() )
+        {
+            main_it = content.trees.begin();
+        }
+        if( main_it == content.trees.end() )
+        {
+            throw std::runtime_error( "there is no tree" );
+        }
+        tree_buffer = BuildFlatbuffersFromTree( main_it->second, subtrees );
+    }
+    catch( std::exception& err )
+    {
+        std::cerr << err.what() << std::endl;
+        return 1;
+    }
+
+    // the uids of BuildFlatbuffersFromTree() are 1, 2, 3...
+    std::vector<PublisherNode> nodes;
+    for (const auto* node: *Serialization::GetBehaviorTree( tree_buffer.data() )->nodes())
+    {
+        nodes.push_back( { node->uid(), NodeStatus::IDLE } );
+    }
+
+    const double rate = std::max( 0.1, parser.value(rate_option).toDouble() );
+    const int changes = std::max( 1, parser.value(changes_option).toInt() );
+    const int burst = std::max( 1, parser.value(burst_option).toInt() );
+    const double duration = parser.value(duration_option).toDouble();
+    const QString stats_path = parser.value(stats_option);
+    const bool topics = parser.isSet(topics_option);
+
+    zmq::context_t context(1);
+    zmq::socket_t publisher( context, ZMQ_PUB );
+    zmq::socket_t server( context, ZMQ_REP );
+    try {
+        // the endpoints that the monitor connects to, see MonitorEndpoint()
+        const QString address = parser.isSet(ipc_option) ? "ipc://" + parser.value(ipc_option) : "*";
+        publisher.bind( MonitorEndpoint( address, parser.value(publisher_option) ).c_str() );
+        server.bind( MonitorEndpoint( address, parser.value(server_option) ).c_str() );
+    }
+    catch( zmq::error_t& err )
+    {
+        std::cerr << err.what() << std::endl;
+        return 1;
+    }
+    std::cerr << "publishing " << nodes.size() << " nodes, " << rate << " msg/s" << std::endl;
+
+    std::mt19937 random( tree_defaults.seed );
+    std::uniform_int_distribution<size_t> pick_node( 0, nodes.size() - 1 );
+    StatusMessage message( nodes.size() );
+    QByteArray transitions;
+    // with --topics, by block
+    std::map<int, std::pair<QByteArray, int>> block_transitions;
+    qint64 next_keyframe_ms = 0;
+
+    QElapsedTimer clock;
+    clock.start();
+    // a burst every burst / rate seconds
+    const qint64 burst_period_us = qint64( 1e6 * burst / rate );
+    qint64 next_burst_us = 0;
+    qint64 next_report_ms = 1000;
+    long long sent = 0, sent_transitions = 0, sent_bytes = 0;
+    long long reported = 0, reported_transitions = 0, reported_bytes = 0;
+
+    while( duration <= 0 || clock.elapsed() < qint64( duration * 1000 ) )
+    {
+        // the tree requests are served while waiting for the next burst
+        const qint64 wait_ms = std::max<qint64>( 0, ( next_burst_us - clock.nsecsElapsed() / 1000 ) / 1000 );
+        zmq::pollitem_t items[] = { { static_cast<void*>(server), 0, ZMQ_POLLIN, 0 } };
+        zmq::poll( items, 1, long( wait_ms ) );
+        if( items[0].revents & ZMQ_POLLIN )
+        {
+            zmq::message_t request;
+            server.recv( &request );
+            zmq::message_t reply( tree_buffer.data(), tree_buffer.size() );
+            server.send( reply );
+            std::cerr << "tree sent" << std::endl;
+            continue;
+        }
+        if( clock.nsecsElapsed() / 1000 < next_burst_us )
+        {
+            continue;
+        }
+        next_burst_us += burst_period_us;
+
+        if( topics && clock.elapsed() >= next_keyframe_ms )
+        {
+            const QByteArray& buffer = message.build( nodes.data(), nodes.size(), QByteArray(), 0 );
+            sendTopic( publisher, MONITOR_KEYFRAME_TOPIC, buffer );
+            sent++;
+            sent_bytes += buffer.size();
+            next_keyframe_ms += 1000;
+        }
+
+        for (int b = 0; b < burst; b++)
+        {
+            transitions.resize( 0 );
+            block_transitions.clear();
+            const double now = QDateTime::currentMSecsSinceEpoch() * 0.001;
+            for (int c = 0; c < changes; c++)
+            {
+                PublisherNode& node = nodes[ pick_node( random ) ];
+                const NodeStatus prev_status = node.status;
+                // IDLE -> RUNNING -> SUCCESS -> IDLE
+                node.status = NodeStatus( ( int( prev_status ) + 1 ) % 3 );
+                if( topics )
+                {
+                    auto& block = block_transitions[ node.uid / MONITOR_BLOCK_SIZE ];
+                    appendTransition( block.first, now, node, prev_status );
+                    block.second++;
+                }
+                else{
+                    appendTransition( transitions, now, node, prev_status );
+                }
+            }
+            if( topics )
+            {
+                // the uids are 1, 2, 3...: the nodes of a block are consecutive
+                for (const auto& it: block_transitions)
+                {
+                    const size_t first = std::max<size_t>( 1, size_t( it.first * MONITOR_BLOCK_SIZE ) ) - 1;
+                    const size_t last = std::min( nodes.size(), size_t( ( it.first + 1 ) * MONITOR_BLOCK_SIZE ) - 1 );
+                    const QByteArray& buffer = message.build( nodes.data() + first, last - first,
+                                                              it.second.first, it.second.second );
+                    sendTopic( publisher, MonitorBlockTopic( it.first ), buffer );
+                    sent++;
+                    sent_bytes += buffer.size();
+                }
+            }
+            else{
+                const QByteArray& buffer = message.build( nodes.data(), nodes.size(), transitions, changes );
+                zmq::message_t msg( buffer.constData(), size_t( buffer.size() ) );
+                publisher.send( msg );
+                sent++;
+                sent_bytes += buffer.size();
+            }
+            sent_transitions += changes;
+        }
+
+        if( clock.elapsed() >= next_report_ms )
+        {
+            std::cerr << "sent: " << ( sent - reported ) << " msg/s, "
+                      << ( sent_transitions - reported_transitions ) << " transitions/s, "
+                      << ( sent_bytes - reported_bytes ) / 1024 << " KB/s" << std::endl;
+            reported = sent;
+            reported_transitions = sent_transitions;
+            reported_bytes = sent_bytes;
+            next_report_ms += 1000;
+            if( !stats_path.isEmpty() )
+            {
+                printMonitorStats( stats_path );
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,245 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <vector>
+#include <zmq.hpp>
+
+#include "monitor_receiver.h"
+
+// One connection to a BT server, shared by many monitors:
+//
+//   groot_relay --robot 192.168.1.10
+//   Groot --mode monitor    (connected to the computer of the relay, port 1676)
+//
+// The statuses are subscribed once and republished as they are, with their
+// topics: the subscriptions of the monitors are forwarded to the robot, that
+// sees a single subscriber. The tree is requested once for all the monitors
+// that ask for it, and cached for --tree-refresh milliseconds.
+
+namespace
+{
+
+// the identity of a REQ client of the ROUTER socket, and the empty delimiter
+struct PendingRequest
+{
+    std::vector<zmq::message_t> envelope;
+};
+
+bool receiveMultipart(zmq::socket_t& socket, std::vector<zmq::message_t>& parts)
+{
+    parts.clear();
+    do{
+        parts.emplace_back();
+        if( !socket.recv( &parts.back(), ZMQ_DONTWAIT ) )
+        {
+            parts.pop_back();
+            return !parts.empty();
+        }
+    }
+    while( parts.back().more() );
+    return true;
+}
+
+void sendMultipart(zmq::socket_t& socket, std::vector<zmq::message_t>& parts)
+{
+    for (size_t i = 0; i < parts.size(); i++)
+    {
+        socket.send( parts[i], ( i + 1 < parts.size() ) ? ZMQ_SNDMORE : 0 );
+    }
+}
+
+void replyTree(zmq::socket_t& server, PendingRequest& request, const std::vector<char>& tree)
+{
+    for (auto& part: request.envelope)
+    {
+        server.send( part, ZMQ_SNDMORE );
+    }
+    zmq::message_t reply( tree.data(), tree.size() );
+    server.send( reply );
+}
+
+// the REQ socket is stuck after a request without reply: a new one is used
+std::unique_ptr<zmq::socket_t> connectRobotServer(zmq::context_t& context, const std::string& address)
+{
+    std::unique_ptr<zmq::socket_t> socket( new zmq::socket_t( context, ZMQ_REQ ) );
+    int linger_ms = 0;
+    socket->setsockopt( ZMQ_LINGER, &linger_ms, sizeof(int) );
+    socket->connect( address.c_str() );
+    return socket;
+}
+
+}
+
+int
+main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    app.setApplicationName("groot_relay");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Share the connection to a BT server between many "
+                                     "instances of Groot in monitor mode.");
+    parser.addHelpOption();
+
+    QCommandLineOption robot_option("robot", "Address of the BT server, or ipc://path.",
+                                    "host", "localhost");
+    QCommandLineOption robot_publisher_option("robot-publisher-port", "Port of its statuses.",
+                                              "port", "1666");
+    QCommandLineOption robot_server_option("robot-server-port", "Port of its tree.", "port", "1667");
+    QCommandLineOption publisher_option("publisher-port", "Port of the statuses, for the monitors.",
+                                        "port", "1676");
+    QCommandLineOption server_option("server-port", "Port of the tree, for the monitors.",
+                                     "port", "1677");
+    QCommandLineOption refresh_option("tree-refresh", "Milliseconds the tree is served from the "
+                                      "cache, before it is requested again.", "ms", "2000");
+    QCommandLineOption timeout_option("tree-timeout", "Milliseconds to wait for the tree.",
+                                      "ms", "3000");
+
+    parser.addOptions( { robot_option, robot_publisher_option, robot_server_option,
+                         publisher_option, server_option, refresh_option, timeout_option } );
+    parser.process( app );
+
+    const std::string robot = parser.value(robot_option).toStdString();
+    const std::string robot_server_address =
+            MonitorEndpoint( parser.value(robot_option), parser.value(robot_server_option) );
+    const qint64 refresh_ms = std::max( 0, parser.value(refresh_option).toInt() );
+    const qint64 timeout_ms = std::max( 100, parser.value(timeout_option).toInt() );
+
+    zmq::context_t context(1);
+    zmq::socket_t robot_publisher( context, ZMQ_XSUB );
+    zmq::socket_t publisher( context, ZMQ_XPUB );
+    zmq::socket_t server( context, ZMQ_ROUTER );
+    std::unique_ptr<zmq::socket_t> robot_server;
+    try {
+        robot_publisher.connect( MonitorEndpoint( parser.value(robot_option),
+                                                  parser.value(robot_publisher_option) ).c_str() );
+        publisher.bind( ( "tcp://*:" + parser.value(publisher_option) ).toStdString().c_str() );
+        server.bind( ( "tcp://*:" + parser.value(server_option) ).toStdString().c_str() );
+        robot_server = connectRobotServer( context, robot_server_address );
+    }
+    catch( zmq::error_t& err )
+    {
+        std::cerr << err.what() << std::endl;
+        return 1;
+    }
+    std::cerr << "relaying " << robot << std::endl;
+
+    std::vector<char> tree;
+    QElapsedTimer tree_age;
+    QElapsedTimer request_time;
+    bool requesting = false;
+    std::vector<PendingRequest> pending;
+
+    QElapsedTimer clock;
+    clock.start();
+    qint64 next_report_ms = 1000;
+    long long relayed = 0, relayed_bytes = 0, served = 0, fetched = 0;
+    long long reported = 0, reported_bytes = 0;
+
+    std::vector<zmq::message_t> parts;
+    while( true )
+    {
+        zmq::pollitem_t items[] = {
+            { static_cast<void*>(robot_publisher), 0, ZMQ_POLLIN, 0 },
+            { static_cast<void*>(publisher), 0, ZMQ_POLLIN, 0 },
+            { static_cast<void*>(server), 0, ZMQ_POLLIN, 0 },
+            { static_cast<void*>(*robot_server), 0, ZMQ_POLLIN, 0 } };
+        try {
+            zmq::poll( items, requesting ? 4 : 3, 100 );
+
+            // the statuses, as they are
+            if( items[0].revents & ZMQ_POLLIN )
+            {
+                while( receiveMultipart( robot_publisher, parts ) )
+                {
+                    relayed++;
+                    relayed_bytes += parts.back().size();
+                    sendMultipart( publisher, parts );
+                }
+            }
+            // the subscriptions of the monitors
+            if( items[1].revents & ZMQ_POLLIN )
+            {
+                while( receiveMultipart( publisher, parts ) )
+                {
+                    sendMultipart( robot_publisher, parts );
+                }
+            }
+            if( items[2].revents & ZMQ_POLLIN )
+            {
+                while( receiveMultipart( server, parts ) )
+                {
+                    // identity | empty | request
+                    PendingRequest request;
+                    for (size_t i = 0; i + 1 < parts.size(); i++)
+                    {
+                        request.envelope.push_back( std::move( parts[i] ) );
+                    }
+                    if( !tree.empty() && tree_age.isValid() && tree_age.elapsed() < refresh_ms )
+                    {
+                        replyTree( server, request, tree );
+                        served++;
+                    }
+                    else{
+                        pending.push_back( std::move(request) );
+                    }
+                }
+            }
+            if( requesting && ( items[3].revents & ZMQ_POLLIN ) )
+            {
+                zmq::message_t reply;
+                if( robot_server->recv( &reply, ZMQ_DONTWAIT ) )
+                {
+                    requesting = false;
+                    const char* data = static_cast<const char*>( reply.data() );
+                    tree.assign( data, data + reply.size() );
+                    tree_age.start();
+                    fetched++;
+                    for (auto& request: pending)
+                    {
+                        replyTree( server, request, tree );
+                        served++;
+                    }
+                    pending.clear();
+                }
+            }
+            if( requesting && request_time.elapsed() >= timeout_ms )
+            {
+                std::cerr << "no tree from " << robot_server_address << std::endl;
+                requesting = false;
+                robot_server = connectRobotServer( context, robot_server_address );
+                // the monitors try again after their own timeout
+                pending.clear();
+            }
+            if( !requesting && !pending.empty() )
+            {
+                zmq::message_t request(0);
+                robot_server->send( request );
+                request_time.start();
+                requesting = true;
+            }
+        }
+        catch( zmq::error_t& err )
+        {
+            if( err.num() == ETERM ) break;
+            std::cerr << err.what() << std::endl;
+        }
+
+        if( clock.elapsed() >= next_report_ms )
+        {
+            if( relayed != reported )
+            {
+                std::cerr << "relayed: " << ( relayed - reported ) << " msg/s, "
+                          << ( relayed_bytes - reported_bytes ) / 1024 << " KB/s, trees served "
+                          << served << ", fetched " << fetched << std::endl;
+            }
+            reported = relayed;
+            reported_bytes = relayed_bytes;
+            next_report_ms += 1000;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,376 @@
+#include "log_diff.h"
+#include <QFile>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include "log_format.h"
+#include "log_parser.h"
+#include "utils.h"
+
+namespace {
+
+// timing differences smaller than these are ignored: seconds, and fraction
+// of the longest of the two times
+const double TIMING_TOLERANCE = 0.001;
+const double TIMING_RELATIVE_TOLERANCE = 0.2;
+
+bool isOutcome(NodeStatus status)
+{
+    return status == NodeStatus::SUCCESS || status == NodeStatus::FAILURE;
+}
+
+} // end anonymous namespace
+
+LogDiff::Segmenter::Segmenter(int nodes_count, Alignment alignment, double window):
+    _alignment(alignment),
+    _window( std::max(1e-6, window) ),
+    _has_origin(false),
+    _origin(0),
+    _restarts(0),
+    _id(0),
+    _has_data(false),
+    _last_timestamp(0),
+    _current( size_t(nodes_count) ),
+    _running_since( size_t(nodes_count), -1 ),
+    _completed_id(-1)
+{
+}
+
+void LogDiff::Segmenter::complete(double timestamp)
+{
+    // the nodes still RUNNING continue in the next segment
+    for(size_t index = 0; index < _current.size(); index++)
+    {
+        if( _running_since[index] >= 0 )
+        {
+            _current[index].running_time += timestamp - _running_since[index];
+            _running_since[index] = timestamp;
+        }
+    }
+    _completed_id = _id;
+    _completed.swap( _current );
+    _current.assign( _completed.size(), NodeSummary() );
+    _has_data = false;
+}
+
+bool LogDiff::Segmenter::add(double timestamp, int index, NodeStatus status,
+                             NodeStatus prev_status, bool is_tree_restart)
+{
+    if( !_has_origin )
+    {
+        _origin = timestamp;
+        _has_origin = true;
+    }
+    if( is_tree_restart )
+    {
+        _restarts++;
+    }
+    const int64_t id = ( _alignment == BY_RESTART ) ?
+                _restarts : int64_t( std::floor( (timestamp - _origin) / _window ) );
+
+    bool new_segment = false;
+    if( id != _id )
+    {
+        if( _has_data )
+        {
+            complete( timestamp );
+            new_segment = true;
+        }
+        _id = id;
+    }
+    if( is_tree_restart )
+    {
+        // all the nodes are IDLE again
+        std::fill( _running_since.begin(), _running_since.end(), -1 );
+    }
+
+    _has_data = true;
+    _last_timestamp = timestamp;
+    if( index < 0 || size_t(index) >= _current.size() )
+    {
+        return new_segment;
+    }
+
+    if( isOutcome( status ) )
+    {
+        _current[index].outcome = status;
+    }
+    if( status == NodeStatus::RUNNING && prev_status != NodeStatus::RUNNING )
+    {
+        _running_since[index] = timestamp;
+    }
+    else if( prev_status == NodeStatus::RUNNING && status != NodeStatus::RUNNING &&
+             _running_since[index] >= 0 )
+    {
+        _current[index].running_time += timestamp - _running_since[index];
+        _running_since[index] = -1;
+    }
+    return new_segment;
+}
+
+bool LogDiff::Segmenter::flush()
+{
+    if( !_has_data )
+    {
+        return false;
+    }
+    complete( _last_timestamp );
+    return true;
+}
+
+LogDiff::LogDiff(const TransitionStore &a, int nodes_count,
+                 Alignment alignment, double window):
+    _a(a),
+    _a_row(0),
+    _segmenter_a(nodes_count, alignment, window),
+    _segmenter_b(nodes_count, alignment, window),
+    _a_pending(false),
+    _a_finished(false),
+    _a_pending_id(-1),
+    _empty( size_t(nodes_count) ),
+    _nodes( size_t(nodes_count) ),
+    _segments(0)
+{
+}
+
+bool LogDiff::readSegmentA()
+{
+    while( _a_row < _a.size() )
+    {
+        const size_t row = _a_row++;
+        if( _segmenter_a.add( _a.timestamp(row), _a.index(row), _a.status(row),
+                              _a.prevStatus(row), _a.isTreeRestart(row) ) )
+        {
+            return true;
+        }
+    }
+    if( !_a_finished )
+    {
+        _a_finished = true;
+        return _segmenter_a.flush();
+    }
+    return false;
+}
+
+void LogDiff::add(const Transition &b)
+{
+    if( _segmenter_b.add( b.timestamp, b.index, b.status, b.prev_status, b.is_tree_restart ) )
+    {
+        onSegmentB( _segmenter_b.completedId(), _segmenter_b.completed() );
+    }
+}
+
+void LogDiff::onSegmentB(int64_t id, const std::vector<NodeSummary> &summary_b)
+{
+    while( true )
+    {
+        if( !_a_pending )
+        {
+            if( !readSegmentA() )
+            {
+                // "a" is shorter
+                compare( id, _empty, summary_b );
+                return;
+            }
+            _a_pending = true;
+            _a_pending_id = _segmenter_a.completedId();
+            _a_pending_summary = _segmenter_a.completed();
+        }
+        if( _a_pending_id < id )
+        {
+            compare( _a_pending_id, _a_pending_summary, _empty );
+            _a_pending = false;
+        }
+        else if( _a_pending_id == id )
+        {
+            compare( id, _a_pending_summary, summary_b );
+            _a_pending = false;
+            return;
+        }
+        else{
+            compare( id, _empty, summary_b );
+            return;
+        }
+    }
+}
+
+void LogDiff::finish()
+{
+    if( _segmenter_b.flush() )
+    {
+        onSegmentB( _segmenter_b.completedId(), _segmenter_b.completed() );
+    }
+    // "b" is shorter
+    if( _a_pending )
+    {
+        compare( _a_pending_id, _a_pending_summary, _empty );
+        _a_pending = false;
+    }
+    while( readSegmentA() )
+    {
+        compare( _segmenter_a.completedId(), _segmenter_a.completed(), _empty );
+    }
+}
+
+void LogDiff::compare(int64_t id, const std::vector<NodeSummary> &summary_a,
+                      const std::vector<NodeSummary> &summary_b)
+{
+    _segments++;
+    for(size_t index = 0; index < _nodes.size(); index++)
+    {
+        const NodeSummary& a = summary_a[index];
+        const NodeSummary& b = summary_b[index];
+        NodeDiff& diff = _nodes[index];
+        diff.running_time_a += a.running_time;
+        diff.running_time_b += b.running_time;
+
+        bool different = false;
+        if( a.outcome != b.outcome )
+        {
+            diff.outcome_differences++;
+            different = true;
+        }
+        const double longest = std::max( a.running_time, b.running_time );
+        if( std::abs( a.running_time - b.running_time ) >
+            std::max( TIMING_TOLERANCE, TIMING_RELATIVE_TOLERANCE * longest ) )
+        {
+            diff.timing_differences++;
+            different = true;
+        }
+        if( different && diff.first_different_segment < 0 )
+        {
+            diff.first_different_segment = id;
+        }
+    }
+}
+
+LogDiffWorker::LogDiffWorker(const QString &filename,
+                             const TransitionStore &loaded,
+                             const AbsBehaviorTree &loaded_tree,
+                             LogDiff::Alignment alignment,
+                             double window,
+                             int request_id,
+                             QObject *parent):
+    QThread(parent),
+    _filename(filename),
+    _loaded(loaded),
+    _loaded_tree(loaded_tree),
+    _alignment(alignment),
+    _window(window),
+    _request_id(request_id),
+    _cancelled(false)
+{
+    qRegisterMetaType<NodeDiffsPtr>();
+}
+
+LogDiffWorker::~LogDiffWorker()
+{
+    cancel();
+    wait();
+}
+
+void LogDiffWorker::cancel()
+{
+    _cancelled.store(true);
+}
+
+void LogDiffWorker::run()
+{
+    QFile file( _filename );
+    if( !file.open(QIODevice::ReadOnly) )
+    {
+        emit diffFailed( _request_id, file.errorString() );
+        return;
+    }
+    const size_t file_size = size_t( file.size() );
+    uchar* mapped = file.map( 0, file.size() );
+    if( !mapped )
+    {
+        emit diffFailed( _request_id, file.errorString() );
+        return;
+    }
+    const char* buffer = reinterpret_cast<const char*>(mapped);
+
+    LogLayout layout;
+    if( !readLogLayout( buffer, file_size, layout ) )
+    {
+        file.unmap( mapped );
+        emit diffFailed( _request_id, tr("The log is corrupted or truncated") );
+        return;
+    }
+    flatbuffers::Verifier verifier( reinterpret_cast<const uint8_t*>(buffer + layout.tree_offset),
+                                    layout.transitions_begin - layout.tree_offset );
+    if( !Serialization::VerifyBehaviorTreeBuffer(verifier) )
+    {
+        file.unmap( mapped );
+        emit diffFailed( _request_id, tr("The format of the log is not compatible") );
+        return;
+    }
+    auto res_pair = BuildTreeFromFlatbuffers(
+                Serialization::GetBehaviorTree( buffer + layout.tree_offset ) );
+    const AbsBehaviorTree& tree = res_pair.first;
+
+    bool same_tree = tree.nodesCount() == _loaded_tree.nodesCount();
+    for(size_t index = 0; same_tree && index < tree.nodesCount(); index++)
+    {
+        same_tree = tree.node(index)->instance_name == _loaded_tree.node(index)->instance_name &&
+                    tree.node(index)->model.registration_ID == _loaded_tree.node(index)->model.registration_ID;
+    }
+    if( !same_tree )
+    {
+        file.unmap( mapped );
+        emit diffFailed( _request_id, tr("The two logs were not recorded with the same tree") );
+        return;
+    }
+
+    const int nodes_count = int( tree.nodesCount() );
+    LogDiff diff( _loaded, nodes_count, _alignment, _window );
+    LogParser::State state( nodes_count );
+    const size_t end = layout.transitions_end;
+
+    try{
+        // parsed and compared one chunk at a time: the second log is never
+        // entirely in memory
+        size_t begin = layout.transitions_begin;
+        bool valid = true;
+        while( begin < end && valid && !_cancelled.load() )
+        {
+            LogParser::Chunk chunk;
+            const size_t previous = begin;
+            if( layout.hasBlocks() )
+            {
+                valid = LogParser::parseBlocks( buffer, begin, end, LogParser::CHUNK_TRANSITIONS,
+                                                layout.isCompressed(), res_pair.second, state, chunk );
+            }
+            else{
+                const size_t chunk_end = std::min( begin + LogParser::CHUNK_TRANSITIONS * 12, end );
+                LogParser::parse( buffer, begin, chunk_end, res_pair.second, state, chunk );
+                begin = chunk_end;
+            }
+            for(const Transition& transition: chunk.transitions)
+            {
+                diff.add( transition );
+            }
+            if( begin == previous )
+            {
+                break;
+            }
+        }
+    }
+    catch( std::out_of_range& )
+    {
+        file.unmap( mapped );
+        emit diffFailed( _request_id, tr("The log contains a node that is not in the tree") );
+        return;
+    }
+    file.unmap( mapped );
+
+    if( _cancelled.load() )
+    {
+        return;
+    }
+    diff.finish();
+    emit diffReady( _request_id, std::make_shared<std::vector<NodeDiff>>( diff.nodes() ),
+                    quint64( diff.segmentsCompared() ) );
+}
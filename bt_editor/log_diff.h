@@ -0,0 +1,160 @@
+#ifndef LOG_DIFF_H
+#define LOG_DIFF_H
+
+#include <QThread>
+#include <QMetaType>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <cstdint>
+
+#include "bt_editor_base.h"
+#include "transition_store.h"
+
+// Comparison of two logs of the same tree: the logs are split in segments,
+// either at each restart of the tree or in windows of fixed duration since
+// their first transition, and the segments with the same number are
+// compared node by node.
+struct NodeDiff
+{
+    // segments where the last SUCCESS/FAILURE of the node is not the same
+    uint64_t outcome_differences = 0;
+    // segments where the time spent RUNNING differs
+    uint64_t timing_differences = 0;
+    // -1 if none
+    int64_t first_different_segment = -1;
+    double running_time_a = 0;
+    double running_time_b = 0;
+
+    bool differs() const { return outcome_differences > 0 || timing_differences > 0; }
+};
+
+class LogDiff
+{
+public:
+    enum Alignment { BY_RESTART, BY_TIME };
+
+    struct NodeSummary
+    {
+        // IDLE if the node did not complete in the segment
+        NodeStatus outcome = NodeStatus::IDLE;
+        double running_time = 0;
+    };
+
+    // "a" is read while the transitions of the other log are added, so
+    // that both logs are read once, in a single merge pass.
+    LogDiff(const TransitionStore& a, int nodes_count,
+            Alignment alignment, double window = 1.0);
+
+    // the transitions of the second log, in order
+    void add(const Transition& b);
+
+    // compares the last segments
+    void finish();
+
+    const std::vector<NodeDiff>& nodes() const { return _nodes; }
+
+    uint64_t segmentsCompared() const { return _segments; }
+
+    // splits a sequence of transitions in segments
+    class Segmenter
+    {
+    public:
+        Segmenter(int nodes_count, Alignment alignment, double window);
+
+        // True if the transition starts a new segment: the previous one is
+        // then available in completedId() and completed().
+        bool add(double timestamp, int index, NodeStatus status,
+                 NodeStatus prev_status, bool is_tree_restart);
+
+        // completes the current segment at the end of the log; false if empty
+        bool flush();
+
+        int64_t completedId() const { return _completed_id; }
+
+        const std::vector<NodeSummary>& completed() const { return _completed; }
+
+    private:
+        Alignment _alignment;
+        double _window;
+        bool _has_origin;
+        double _origin;
+        int64_t _restarts;
+        int64_t _id;
+        bool _has_data;
+        double _last_timestamp;
+        std::vector<NodeSummary> _current;
+        std::vector<double> _running_since;
+        int64_t _completed_id;
+        std::vector<NodeSummary> _completed;
+
+        void complete(double timestamp);
+    };
+
+private:
+    const TransitionStore& _a;
+    size_t _a_row;
+    Segmenter _segmenter_a;
+    Segmenter _segmenter_b;
+    // a segment of "a" read ahead; valid if _a_pending
+    bool _a_pending;
+    bool _a_finished;
+    int64_t _a_pending_id;
+    std::vector<NodeSummary> _a_pending_summary;
+
+    std::vector<NodeSummary> _empty;
+    std::vector<NodeDiff> _nodes;
+    uint64_t _segments;
+
+    // read "a" until the next segment is complete; false at the end
+    bool readSegmentA();
+
+    void onSegmentB(int64_t id, const std::vector<NodeSummary>& summary_b);
+
+    void compare(int64_t id, const std::vector<NodeSummary>& summary_a,
+                 const std::vector<NodeSummary>& summary_b);
+};
+
+typedef std::shared_ptr<std::vector<NodeDiff>> NodeDiffsPtr;
+
+// Reads a second log and compares it with the loaded one, on its own thread.
+// The tree of the second log must be the same. The loaded transitions must
+// not be modified until the thread is finished.
+class LogDiffWorker : public QThread
+{
+    Q_OBJECT
+
+public:
+    LogDiffWorker(const QString& filename,
+                  const TransitionStore& loaded,
+                  const AbsBehaviorTree& loaded_tree,
+                  LogDiff::Alignment alignment,
+                  double window,
+                  int request_id,
+                  QObject* parent = nullptr);
+
+    ~LogDiffWorker() override;
+
+    void cancel();
+
+signals:
+    void diffReady(int request_id, NodeDiffsPtr nodes, quint64 segments);
+
+    void diffFailed(int request_id, QString error);
+
+protected:
+    void run() override;
+
+private:
+    QString _filename;
+    const TransitionStore& _loaded;
+    AbsBehaviorTree _loaded_tree;
+    LogDiff::Alignment _alignment;
+    double _window;
+    int _request_id;
+    std::atomic<bool> _cancelled;
+};
+
+Q_DECLARE_METATYPE(NodeDiffsPtr)
+
+#endif // LOG_DIFF_H
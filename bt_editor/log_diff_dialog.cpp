@@ -0,0 +1,113 @@
+#include "log_diff_dialog.h"
+#include <QVBoxLayout>
+#include <QTableView>
+#include <QHeaderView>
+#include <QLabel>
+#include <QFileInfo>
+#include <QSortFilterProxyModel>
+#include <QDialogButtonBox>
+
+namespace {
+
+enum Column { NAME, ID, OUTCOME, TIMING, FIRST_SEGMENT, RUNNING_TIME_A, RUNNING_TIME_B };
+
+QStandardItem* numberItem(double value)
+{
+    auto item = new QStandardItem();
+    // the proxy sorts by number, not by text
+    item->setData( value, Qt::DisplayRole );
+    item->setTextAlignment( Qt::AlignRight | Qt::AlignVCenter );
+    return item;
+}
+
+} // end anonymous namespace
+
+LogDiffDialog::LogDiffDialog(const std::vector<NodeDiff> &nodes,
+                             uint64_t segments,
+                             const QString &other_filename,
+                             const AbsBehaviorTree &tree,
+                             QWidget *parent):
+    QDialog(parent),
+    _nodes(nodes)
+{
+    setWindowTitle( tr("Comparison with %1").arg( QFileInfo(other_filename).fileName() ) );
+    resize( 750, 500 );
+
+    _model = new QStandardItemModel( 0, 7, this );
+    _model->setHorizontalHeaderLabels( { tr("Node"), tr("ID"), tr("Outcome diff."),
+                                         tr("Timing diff."), tr("First diff."),
+                                         tr("Running [s] loaded"), tr("Running [s] other") } );
+
+    int different_nodes = 0;
+    for (size_t index = 0; index < nodes.size() && index < tree.nodesCount(); index++)
+    {
+        const NodeDiff& diff = nodes[index];
+        const AbstractTreeNode* node = tree.node( index );
+        QList<QStandardItem*> row;
+        row.push_back( new QStandardItem( node->instance_name ) );
+        row.push_back( new QStandardItem( node->model.registration_ID ) );
+        row.push_back( numberItem( double(diff.outcome_differences) ) );
+        row.push_back( numberItem( double(diff.timing_differences) ) );
+        if( diff.first_different_segment >= 0 )
+        {
+            row.push_back( numberItem( double(diff.first_different_segment) ) );
+        }
+        else{
+            row.push_back( new QStandardItem() );
+        }
+        row.push_back( numberItem( diff.running_time_a ) );
+        row.push_back( numberItem( diff.running_time_b ) );
+        _model->appendRow( row );
+
+        if( diff.differs() ) different_nodes++;
+    }
+
+    auto proxy = new QSortFilterProxyModel( this );
+    proxy->setSourceModel( _model );
+
+    auto table = new QTableView( this );
+    table->setModel( proxy );
+    table->setSortingEnabled( true );
+    table->setEditTriggers( QAbstractItemView::NoEditTriggers );
+    table->setSelectionBehavior( QAbstractItemView::SelectRows );
+    table->verticalHeader()->setVisible( false );
+    table->horizontalHeader()->setSectionResizeMode( NAME, QHeaderView::Stretch );
+    table->sortByColumn( OUTCOME, Qt::DescendingOrder );
+
+    const QString summary = tr("%1 segments compared, %2 nodes differ")
+            .arg( segments ).arg( different_nodes );
+
+    _highlight_check = new QCheckBox( tr("Highlight the differences on the tree"), this );
+    _highlight_check->setChecked( true );
+    connect( _highlight_check, &QCheckBox::toggled, this, [this](bool checked)
+    {
+        emit heatmapChanged( checked ? highlightValues() : std::vector<double>() );
+    } );
+
+    auto buttons = new QDialogButtonBox( QDialogButtonBox::Close, this );
+    connect( buttons, &QDialogButtonBox::rejected, this, &QDialog::reject );
+
+    auto layout = new QVBoxLayout( this );
+    layout->addWidget( new QLabel( summary, this ) );
+    layout->addWidget( table );
+    layout->addWidget( _highlight_check );
+    layout->addWidget( buttons );
+
+    connect( this, &QDialog::finished, this, [this]()
+    {
+        emit heatmapChanged( std::vector<double>() );
+    } );
+}
+
+std::vector<double> LogDiffDialog::highlightValues() const
+{
+    std::vector<double> values;
+    values.reserve( _nodes.size() );
+    for (const NodeDiff& diff: _nodes)
+    {
+        if( diff.outcome_differences > 0 )     values.push_back( 1.0 );
+        else if( diff.timing_differences > 0 ) values.push_back( 0.6 );
+        else                                   values.push_back( 0.0 );
+    }
+    return values;
+}
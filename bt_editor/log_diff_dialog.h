@@ -0,0 +1,38 @@
+#ifndef LOG_DIFF_DIALOG_H
+#define LOG_DIFF_DIALOG_H
+
+#include <QDialog>
+#include <QStandardItemModel>
+#include <QCheckBox>
+
+#include "bt_editor_base.h"
+#include "log_diff.h"
+
+// Table of the differences of each node between the loaded log and a second
+// one. The nodes that differ can be highlighted on the tree.
+class LogDiffDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    LogDiffDialog(const std::vector<NodeDiff>& nodes,
+                  uint64_t segments,
+                  const QString& other_filename,
+                  const AbsBehaviorTree& tree,
+                  QWidget* parent = nullptr);
+
+    // one value in [0, 1] per node index: 1 if the outcome differs, lower
+    // if only the timing does
+    std::vector<double> highlightValues() const;
+
+signals:
+    // empty to show the status again
+    void heatmapChanged(const std::vector<double>& values);
+
+private:
+    std::vector<NodeDiff> _nodes;
+    QStandardItemModel* _model;
+    QCheckBox* _highlight_check;
+};
+
+#endif // LOG_DIFF_DIALOG_H
@@ -0,0 +1,487 @@
+#include "log_export.h"
+#include <QFile>
+#include <QFileInfo>
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
+
+#include "log_format.h"
+#include "log_parser.h"
+#include "utils.h"
+
+namespace {
+
+const char* STATUS_NAMES[4] = { "IDLE", "RUNNING", "SUCCESS", "FAILURE" };
+
+QByteArray csvField(const QString& text)
+{
+    QByteArray field = text.toUtf8();
+    if( field.contains(',') || field.contains('"') || field.contains('\n') )
+    {
+        field.replace( "\"", "\"\"" );
+        field = "\"" + field + "\"";
+    }
+    return field;
+}
+
+// The Arrow IPC stream format, written with the flatbuffers builder because
+// the generated code of the Arrow schema is not available: the field numbers
+// below are the ones of Schema.fbs and Message.fbs. The values are in the
+// byte order of the host, which is little endian on all our platforms.
+
+struct ArrowFieldNode
+{
+    int64_t length;
+    int64_t null_count;
+};
+
+struct ArrowBuffer
+{
+    int64_t offset;
+    int64_t length;
+};
+
+inline flatbuffers::voffset_t fieldOffset(int id)
+{
+    return flatbuffers::voffset_t( 4 + 2 * id );
+}
+
+enum ArrowType : uint8_t { ARROW_INT = 2, ARROW_FLOATING_POINT = 3, ARROW_UTF8 = 5 };
+enum ArrowHeader : uint8_t { ARROW_SCHEMA = 1, ARROW_RECORD_BATCH = 3 };
+const int16_t ARROW_METADATA_V5 = 4;
+
+void pad8(QByteArray& buffer)
+{
+    while( buffer.size() % 8 != 0 )
+    {
+        buffer.append( '\0' );
+    }
+}
+
+// continuation marker | metadata size | Message | body
+QByteArray encapsulate(flatbuffers::FlatBufferBuilder& fbb, uint8_t header_type,
+                       flatbuffers::Offset<void> header, const QByteArray& body)
+{
+    const auto start = fbb.StartTable();
+    fbb.AddElement<int64_t>( fieldOffset(3), int64_t(body.size()), 0 );
+    fbb.AddOffset( fieldOffset(2), header );
+    fbb.AddElement<int16_t>( fieldOffset(0), ARROW_METADATA_V5, 0 );
+    fbb.AddElement<uint8_t>( fieldOffset(1), header_type, 0 );
+    fbb.Finish( flatbuffers::Offset<void>( fbb.EndTable(start) ) );
+
+    QByteArray metadata( reinterpret_cast<const char*>(fbb.GetBufferPointer()), int(fbb.GetSize()) );
+    pad8( metadata );
+
+    QByteArray message;
+    message.reserve( 8 + metadata.size() + body.size() );
+    const uint32_t continuation = 0xFFFFFFFF;
+    const int32_t metadata_size = metadata.size();
+    message.append( reinterpret_cast<const char*>(&continuation), 4 );
+    message.append( reinterpret_cast<const char*>(&metadata_size), 4 );
+    message.append( metadata );
+    message.append( body );
+    return message;
+}
+
+flatbuffers::Offset<void> arrowField(flatbuffers::FlatBufferBuilder& fbb, const char* name,
+                                     uint8_t type_type, flatbuffers::Offset<void> type)
+{
+    const auto name_offset = fbb.CreateString( name );
+    // some readers require the children, even if empty
+    const auto children = fbb.CreateVector( std::vector<flatbuffers::Offset<void>>() );
+    const auto start = fbb.StartTable();
+    fbb.AddOffset( fieldOffset(0), name_offset );
+    fbb.AddElement<uint8_t>( fieldOffset(2), type_type, 0 );
+    fbb.AddOffset( fieldOffset(3), type );
+    fbb.AddOffset( fieldOffset(5), children );
+    return flatbuffers::Offset<void>( fbb.EndTable(start) );
+}
+
+flatbuffers::Offset<void> arrowInt32(flatbuffers::FlatBufferBuilder& fbb)
+{
+    const auto start = fbb.StartTable();
+    fbb.AddElement<int32_t>( fieldOffset(0), 32, 0 );
+    fbb.AddElement<uint8_t>( fieldOffset(1), 1, 0 );
+    return flatbuffers::Offset<void>( fbb.EndTable(start) );
+}
+
+flatbuffers::Offset<void> arrowDouble(flatbuffers::FlatBufferBuilder& fbb)
+{
+    const auto start = fbb.StartTable();
+    fbb.AddElement<int16_t>( fieldOffset(0), 2, 0 );
+    return flatbuffers::Offset<void>( fbb.EndTable(start) );
+}
+
+flatbuffers::Offset<void> arrowUtf8(flatbuffers::FlatBufferBuilder& fbb)
+{
+    return flatbuffers::Offset<void>( fbb.EndTable( fbb.StartTable() ) );
+}
+
+} // end anonymous namespace
+
+LogExporter::Format LogExporter::formatOf(const QString &filename)
+{
+    const QString suffix = QFileInfo( filename ).suffix().toLower();
+    return ( suffix == "arrow" || suffix == "arrows" ) ? ARROW : CSV;
+}
+
+LogExporter::LogExporter(QIODevice &output, Format format):
+    _output(output),
+    _format(format),
+    _header_written(false),
+    _rows(0)
+{
+}
+
+bool LogExporter::write(const QByteArray &data)
+{
+    if( _output.write( data ) != data.size() )
+    {
+        _error = _output.errorString();
+        return false;
+    }
+    return true;
+}
+
+bool LogExporter::exportFile(const QString &filename,
+                             const std::function<void(double)> &progress,
+                             const std::atomic<bool> *cancelled)
+{
+    const QString name = QFileInfo( filename ).fileName();
+    QFile file( filename );
+    if( !file.open(QIODevice::ReadOnly) )
+    {
+        _error = QString("%1: %2").arg( name, file.errorString() );
+        return false;
+    }
+    const size_t file_size = size_t( file.size() );
+    uchar* mapped = file.map( 0, file.size() );
+    if( !mapped )
+    {
+        _error = QString("%1: %2").arg( name, file.errorString() );
+        return false;
+    }
+    const char* buffer = reinterpret_cast<const char*>(mapped);
+
+    LogLayout layout;
+    if( !readLogLayout( buffer, file_size, layout ) )
+    {
+        file.unmap( mapped );
+        _error = QString("%1: the log is corrupted or truncated").arg( name );
+        return false;
+    }
+    const QByteArray tree_buffer = QByteArray::fromRawData( buffer + layout.tree_offset,
+                                                            int(layout.transitions_begin - layout.tree_offset) );
+    if( !_header_written )
+    {
+        flatbuffers::Verifier verifier( reinterpret_cast<const uint8_t*>(tree_buffer.constData()),
+                                        size_t(tree_buffer.size()) );
+        if( !Serialization::VerifyBehaviorTreeBuffer(verifier) )
+        {
+            file.unmap( mapped );
+            _error = QString("%1: the format of the log is not compatible").arg( name );
+            return false;
+        }
+    }
+    else if( tree_buffer != _tree_buffer )
+    {
+        file.unmap( mapped );
+        _error = QString("%1: the tree is not the same as in the first log").arg( name );
+        return false;
+    }
+
+    auto res_pair = BuildTreeFromFlatbuffers(
+                Serialization::GetBehaviorTree( buffer + layout.tree_offset ) );
+    const AbsBehaviorTree& tree = res_pair.first;
+
+    if( !_header_written )
+    {
+        // a deep copy: the file is unmapped at the end
+        _tree_buffer = QByteArray( tree_buffer.constData(), tree_buffer.size() );
+        for (const auto& node: tree.nodes())
+        {
+            if( _format == CSV )
+            {
+                _names.push_back( csvField( node.instance_name ) );
+                _ids.push_back( csvField( node.model.registration_ID ) );
+            }
+            else{
+                _names.push_back( node.instance_name.toUtf8() );
+                _ids.push_back( node.model.registration_ID.toUtf8() );
+            }
+        }
+        if( !writeHeader() )
+        {
+            file.unmap( mapped );
+            return false;
+        }
+        _header_written = true;
+    }
+
+    LogParser::State state( int(tree.nodesCount()) );
+    const size_t end = std::min( layout.transitions_end, file_size );
+    const size_t total = std::max<size_t>( 1, end - layout.transitions_begin );
+    bool success = true;
+
+    try{
+        size_t begin = layout.transitions_begin;
+        bool valid = true;
+        while( begin < end && valid && success )
+        {
+            if( cancelled && cancelled->load() )
+            {
+                _error = QString("Cancelled");
+                success = false;
+                break;
+            }
+            LogParser::Chunk chunk;
+            const size_t previous = begin;
+            if( layout.hasBlocks() )
+            {
+                valid = LogParser::parseBlocks( buffer, begin, end, BATCH_ROWS,
+                                                layout.isCompressed(), res_pair.second, state, chunk );
+            }
+            else{
+                const size_t chunk_end = std::min( begin + BATCH_ROWS * 12, end );
+                LogParser::parse( buffer, begin, chunk_end, res_pair.second, state, chunk );
+                begin = chunk_end;
+            }
+            if( !chunk.transitions.empty() )
+            {
+                success = writeBatch( chunk.transitions );
+            }
+            if( progress )
+            {
+                progress( double(begin - layout.transitions_begin) / total );
+            }
+            if( begin == previous )
+            {
+                break;
+            }
+        }
+    }
+    catch( std::out_of_range& )
+    {
+        _error = QString("%1: the log contains a node that is not in the tree").arg( name );
+        success = false;
+    }
+    file.unmap( mapped );
+    return success;
+}
+
+bool LogExporter::writeHeader()
+{
+    if( _format == CSV )
+    {
+        return write( "timestamp,node_index,instance_name,model_id,prev_status,status\n" );
+    }
+    return write( arrowSchemaMessage() );
+}
+
+bool LogExporter::writeBatch(const std::vector<Transition> &transitions)
+{
+    _rows += transitions.size();
+    if( _format == CSV )
+    {
+        QByteArray buffer;
+        appendCsv( buffer, transitions );
+        return write( buffer );
+    }
+    return write( arrowBatchMessage( transitions ) );
+}
+
+bool LogExporter::finish()
+{
+    if( _format == ARROW && _header_written )
+    {
+        // end of stream
+        const uint32_t eos[2] = { 0xFFFFFFFF, 0 };
+        return write( QByteArray( reinterpret_cast<const char*>(eos), sizeof(eos) ) );
+    }
+    return true;
+}
+
+void LogExporter::appendCsv(QByteArray &buffer, const std::vector<Transition> &transitions) const
+{
+    buffer.reserve( int(transitions.size()) * 64 );
+    for (const Transition& transition: transitions)
+    {
+        const size_t index = size_t(transition.index);
+        buffer.append( QByteArray::number( transition.timestamp, 'f', 6 ) );
+        buffer.append( ',' );
+        buffer.append( QByteArray::number( transition.index ) );
+        buffer.append( ',' );
+        buffer.append( _names[index] );
+        buffer.append( ',' );
+        buffer.append( _ids[index] );
+        buffer.append( ',' );
+        buffer.append( STATUS_NAMES[ int(transition.prev_status) & 0x03 ] );
+        buffer.append( ',' );
+        buffer.append( STATUS_NAMES[ int(transition.status) & 0x03 ] );
+        buffer.append( '\n' );
+    }
+}
+
+QByteArray LogExporter::arrowSchemaMessage() const
+{
+    flatbuffers::FlatBufferBuilder fbb;
+    std::vector<flatbuffers::Offset<void>> fields;
+    fields.push_back( arrowField( fbb, "timestamp", ARROW_FLOATING_POINT, arrowDouble(fbb) ) );
+    fields.push_back( arrowField( fbb, "node_index", ARROW_INT, arrowInt32(fbb) ) );
+    fields.push_back( arrowField( fbb, "instance_name", ARROW_UTF8, arrowUtf8(fbb) ) );
+    fields.push_back( arrowField( fbb, "model_id", ARROW_UTF8, arrowUtf8(fbb) ) );
+    fields.push_back( arrowField( fbb, "prev_status", ARROW_UTF8, arrowUtf8(fbb) ) );
+    fields.push_back( arrowField( fbb, "status", ARROW_UTF8, arrowUtf8(fbb) ) );
+    const auto fields_offset = fbb.CreateVector( fields );
+
+    const auto start = fbb.StartTable();
+    fbb.AddOffset( fieldOffset(1), fields_offset );
+    const auto schema = flatbuffers::Offset<void>( fbb.EndTable(start) );
+    return encapsulate( fbb, ARROW_SCHEMA, schema, QByteArray() );
+}
+
+QByteArray LogExporter::arrowBatchMessage(const std::vector<Transition> &transitions) const
+{
+    const size_t rows = transitions.size();
+    QByteArray body;
+    std::vector<ArrowBuffer> buffers;
+    std::vector<ArrowFieldNode> field_nodes;
+
+    auto add_buffer = [&](const char* data, size_t size)
+    {
+        buffers.push_back( { int64_t(body.size()), int64_t(size) } );
+        body.append( data, int(size) );
+        pad8( body );
+    };
+    auto add_column = [&]()
+    {
+        field_nodes.push_back( { int64_t(rows), 0 } );
+        // no null values: the validity bitmap can be empty
+        buffers.push_back( { int64_t(body.size()), 0 } );
+    };
+    auto add_strings = [&](const std::function<const char*(const Transition&, int&)>& get)
+    {
+        add_column();
+        std::vector<int32_t> offsets;
+        offsets.reserve( rows + 1 );
+        QByteArray data;
+        offsets.push_back( 0 );
+        for (const Transition& transition: transitions)
+        {
+            int size = 0;
+            const char* text = get( transition, size );
+            data.append( text, size );
+            offsets.push_back( data.size() );
+        }
+        add_buffer( reinterpret_cast<const char*>(offsets.data()), offsets.size() * sizeof(int32_t) );
+        add_buffer( data.constData(), size_t(data.size()) );
+    };
+
+    {
+        std::vector<double> timestamps;
+        std::vector<int32_t> indexes;
+        timestamps.reserve( rows );
+        indexes.reserve( rows );
+        for (const Transition& transition: transitions)
+        {
+            timestamps.push_back( transition.timestamp );
+            indexes.push_back( transition.index );
+        }
+        add_column();
+        add_buffer( reinterpret_cast<const char*>(timestamps.data()), rows * sizeof(double) );
+        add_column();
+        add_buffer( reinterpret_cast<const char*>(indexes.data()), rows * sizeof(int32_t) );
+    }
+    add_strings( [this](const Transition& t, int& size) -> const char*
+    {
+        const QByteArray& name = _names[ size_t(t.index) ];
+        size = name.size();
+        return name.constData();
+    } );
+    add_strings( [this](const Transition& t, int& size) -> const char*
+    {
+        const QByteArray& id = _ids[ size_t(t.index) ];
+        size = id.size();
+        return id.constData();
+    } );
+    add_strings( [](const Transition& t, int& size) -> const char*
+    {
+        const char* name = STATUS_NAMES[ int(t.prev_status) & 0x03 ];
+        size = int( strlen(name) );
+        return name;
+    } );
+    add_strings( [](const Transition& t, int& size) -> const char*
+    {
+        const char* name = STATUS_NAMES[ int(t.status) & 0x03 ];
+        size = int( strlen(name) );
+        return name;
+    } );
+
+    flatbuffers::FlatBufferBuilder fbb;
+    const auto nodes_offset = fbb.CreateVectorOfStructs( field_nodes.data(), field_nodes.size() );
+    const auto buffers_offset = fbb.CreateVectorOfStructs( buffers.data(), buffers.size() );
+    const auto start = fbb.StartTable();
+    fbb.AddElement<int64_t>( fieldOffset(0), int64_t(rows), 0 );
+    fbb.AddOffset( fieldOffset(1), nodes_offset );
+    fbb.AddOffset( fieldOffset(2), buffers_offset );
+    const auto batch = flatbuffers::Offset<void>( fbb.EndTable(start) );
+    return encapsulate( fbb, ARROW_RECORD_BATCH, batch, body );
+}
+
+LogExportWorker::LogExportWorker(const QStringList &log_files,
+                                 const QString &output_filename,
+                                 QObject *parent):
+    QThread(parent),
+    _log_files(log_files),
+    _output_filename(output_filename),
+    _cancelled(false)
+{
+}
+
+LogExportWorker::~LogExportWorker()
+{
+    cancel();
+    wait();
+}
+
+void LogExportWorker::cancel()
+{
+    _cancelled.store(true);
+}
+
+void LogExportWorker::run()
+{
+    QFile output( _output_filename );
+    if( !output.open( QIODevice::WriteOnly | QIODevice::Truncate ) )
+    {
+        emit exportFinished( output.errorString(), 0 );
+        return;
+    }
+    LogExporter exporter( output, LogExporter::formatOf( _output_filename ) );
+
+    int last_percent = -1;
+    bool success = true;
+    for (int i = 0; i < _log_files.size() && success; i++)
+    {
+        const double files_count = _log_files.size();
+        success = exporter.exportFile( _log_files[i], [&](double fraction)
+        {
+            const int percent = int( 100 * (i + fraction) / files_count );
+            if( percent != last_percent )
+            {
+                last_percent = percent;
+                emit exportProgress( percent );
+            }
+        }, &_cancelled );
+    }
+    success = success && exporter.finish();
+    output.close();
+
+    if( !success )
+    {
+        output.remove();
+        emit exportFinished( _cancelled.load() ? QString() : exporter.errorString(), 0 );
+        return;
+    }
+    emit exportFinished( QString(), quint64( exporter.rowsWritten() ) );
+}
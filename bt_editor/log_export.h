@@ -0,0 +1,103 @@
+#ifndef LOG_EXPORT_H
+#define LOG_EXPORT_H
+
+#include <QIODevice>
+#include <QThread>
+#include <QStringList>
+#include <atomic>
+#include <functional>
+#include <vector>
+
+#include "bt_editor_base.h"
+
+// Streams the transitions of .fbl logs to a table with the columns
+//
+//   timestamp, node_index, instance_name, model_id, prev_status, status
+//
+// either as CSV or as an Arrow IPC stream (one record batch per chunk). The
+// logs are mapped and parsed BATCH_ROWS transitions at a time, so the memory
+// used does not depend on the size of the log.
+class LogExporter
+{
+public:
+    enum Format { CSV, ARROW };
+
+    // ARROW for ".arrow" and ".arrows", CSV otherwise
+    static Format formatOf(const QString& filename);
+
+    LogExporter(QIODevice& output, Format format);
+
+    // Appends the transitions of a log. The logs after the first one must
+    // have the same tree; they are exported as a single table.
+    // "progress" is called after each batch, with the fraction of the file
+    // done. Returns false on error, see errorString().
+    bool exportFile(const QString& filename,
+                    const std::function<void(double)>& progress = std::function<void(double)>(),
+                    const std::atomic<bool>* cancelled = nullptr);
+
+    // writes the end of the stream; the output is not closed
+    bool finish();
+
+    const QString& errorString() const { return _error; }
+
+    uint64_t rowsWritten() const { return _rows; }
+
+    static const size_t BATCH_ROWS = 64*1024;
+
+private:
+    QIODevice& _output;
+    Format _format;
+    QString _error;
+    QByteArray _tree_buffer;
+    // per node index, already encoded for the output
+    std::vector<QByteArray> _names;
+    std::vector<QByteArray> _ids;
+    bool _header_written;
+    uint64_t _rows;
+
+    bool write(const QByteArray& data);
+
+    bool writeHeader();
+
+    bool writeBatch(const std::vector<Transition>& transitions);
+
+    void appendCsv(QByteArray& buffer, const std::vector<Transition>& transitions) const;
+
+    QByteArray arrowSchemaMessage() const;
+
+    QByteArray arrowBatchMessage(const std::vector<Transition>& transitions) const;
+};
+
+// Exports the files of the loaded log on its own thread.
+class LogExportWorker : public QThread
+{
+    Q_OBJECT
+
+public:
+    LogExportWorker(const QStringList& log_files,
+                    const QString& output_filename,
+                    QObject* parent = nullptr);
+
+    ~LogExportWorker() override;
+
+    void cancel();
+
+    bool isCancelled() const { return _cancelled.load(); }
+
+signals:
+    void exportProgress(int percent);
+
+    // "error" is empty on success or if cancelled; the output is removed
+    // on error or cancel
+    void exportFinished(QString error, quint64 rows);
+
+protected:
+    void run() override;
+
+private:
+    QStringList _log_files;
+    QString _output_filename;
+    std::atomic<bool> _cancelled;
+};
+
+#endif // LOG_EXPORT_H
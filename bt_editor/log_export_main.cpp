@@ -0,0 +1,95 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QFile>
+#include <iostream>
+
+#include "log_export.h"
+
+// Headless export of .fbl logs, for instance:
+//
+//   groot_log_export -o trace.csv trace.fbl
+//   groot_log_export -o session.arrows part_0.fbl part_1.fbl part_2.fbl
+int
+main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    app.setApplicationName("groot_log_export");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Export the transitions of Groot logs to CSV or to an "
+                                     "Arrow IPC stream. Several logs of the same tree are "
+                                     "exported as a single table.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("logs", "The .fbl files to export, in order.", "logs...");
+
+    QCommandLineOption output_option(QStringList() << "o" << "output",
+                                     "Output file; \"-\" for the standard output.", "file");
+    parser.addOption(output_option);
+
+    QCommandLineOption format_option(QStringList() << "f" << "format",
+                                     "csv or arrow. By default, from the suffix of the output.",
+                                     "format");
+    parser.addOption(format_option);
+    parser.process( app );
+
+    const QStringList logs = parser.positionalArguments();
+    const QString output_name = parser.value(output_option);
+    if( logs.isEmpty() || output_name.isEmpty() )
+    {
+        parser.showHelp(1);
+    }
+
+    LogExporter::Format format = LogExporter::formatOf( output_name );
+    if( parser.isSet(format_option) )
+    {
+        const QString value = parser.value(format_option).toLower();
+        if( value == "csv" )        format = LogExporter::CSV;
+        else if( value == "arrow" ) format = LogExporter::ARROW;
+        else{
+            std::cerr << "wrong format passed to --format. Use one of these: csv / arrow" << std::endl;
+            return 1;
+        }
+    }
+
+    QFile output;
+    const bool to_stdout = ( output_name == "-" );
+    bool opened = false;
+    if( to_stdout )
+    {
+        opened = output.open( stdout, QIODevice::WriteOnly );
+    }
+    else{
+        output.setFileName( output_name );
+        opened = output.open( QIODevice::WriteOnly | QIODevice::Truncate );
+    }
+    if( !opened )
+    {
+        std::cerr << output_name.toStdString() << ": "
+                  << output.errorString().toStdString() << std::endl;
+        return 1;
+    }
+
+    LogExporter exporter( output, format );
+    for (const QString& log: logs)
+    {
+        if( !exporter.exportFile( log ) )
+        {
+            std::cerr << exporter.errorString().toStdString() << std::endl;
+            output.close();
+            if( !to_stdout ) output.remove();
+            return 1;
+        }
+    }
+    if( !exporter.finish() )
+    {
+        std::cerr << exporter.errorString().toStdString() << std::endl;
+        return 1;
+    }
+    output.close();
+
+    if( !to_stdout )
+    {
+        std::cerr << exporter.rowsWritten() << " transitions exported" << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,167 @@
+#include "log_format.h"
+#include <QtEndian>
+#include <cstring>
+
+static const char LOG_V2_MAGIC[4] = {'F','B','L','2'};
+static const char LOG_INDEX_MAGIC[4] = {'F','B','L','I'};
+
+template <typename T> static T readLE(const char* buffer)
+{
+    return qFromLittleEndian<T>( reinterpret_cast<const uchar*>(buffer) );
+}
+
+template <typename T> static void appendLE(QByteArray& out, T value)
+{
+    uchar buffer[sizeof(T)];
+    qToLittleEndian<T>( value, buffer );
+    out.append( reinterpret_cast<const char*>(buffer), sizeof(T) );
+}
+
+static void appendDouble(QByteArray& out, double value)
+{
+    quint64 bits;
+    std::memcpy( &bits, &value, sizeof(bits) );
+    appendLE<quint64>( out, bits );
+}
+
+static double readDouble(const char* buffer)
+{
+    const quint64 bits = readLE<quint64>( buffer );
+    double value;
+    std::memcpy( &value, &bits, sizeof(value) );
+    return value;
+}
+
+uint64_t LogIndex::transitionsCount() const
+{
+    return blocks.empty() ? 0 : blocks.back().first_row + blocks.back().count;
+}
+
+int logFormatVersion(const char *buffer, size_t size)
+{
+    if( size < 4 )
+    {
+        return 0;
+    }
+    if( std::memcmp( buffer, LOG_V2_MAGIC, 4 ) == 0 )
+    {
+        return ( size < LOG_V2_HEADER_SIZE ) ? 0 : int( readLE<quint32>( buffer + 4 ) );
+    }
+    return 1;
+}
+
+bool logTreeLocation(const char *buffer, size_t size, size_t &tree_offset, size_t &tree_size)
+{
+    switch( logFormatVersion( buffer, size ) )
+    {
+    case 1:
+        tree_offset = 4;
+        tree_size = readLE<quint32>( buffer );
+        break;
+    case 2:
+    case 3:
+        tree_offset = LOG_V2_HEADER_SIZE;
+        tree_size = readLE<quint32>( buffer + 8 );
+        break;
+    default:
+        return false;
+    }
+    return tree_size > 0 && tree_offset + tree_size <= size;
+}
+
+bool readLogIndex(const char *buffer, size_t size, LogIndex &index)
+{
+    index.blocks.clear();
+    if( logFormatVersion( buffer, size ) < 2 || size < LOG_V2_HEADER_SIZE + LOG_TRAILER_SIZE )
+    {
+        return false;
+    }
+    const char* trailer = buffer + size - LOG_TRAILER_SIZE;
+    if( std::memcmp( trailer + 12, LOG_INDEX_MAGIC, 4 ) != 0 )
+    {
+        return false;
+    }
+    const uint64_t footer_offset = readLE<quint64>( trailer );
+    const uint32_t block_count = readLE<quint32>( trailer + 8 );
+
+    // without additions that a corrupt trailer could overflow
+    if( footer_offset > size - LOG_TRAILER_SIZE )
+    {
+        return false;
+    }
+    const uint64_t index_size = size - LOG_TRAILER_SIZE - footer_offset;
+    if( index_size % LOG_BLOCK_INFO_SIZE != 0 || block_count != index_size / LOG_BLOCK_INFO_SIZE )
+    {
+        return false;
+    }
+
+    index.footer_offset = footer_offset;
+    index.blocks.resize( block_count );
+    for(uint32_t b = 0; b < block_count; b++)
+    {
+        const char* entry = buffer + footer_offset + b * LOG_BLOCK_INFO_SIZE;
+        LogBlockInfo& info = index.blocks[b];
+        info.offset          = readLE<quint64>( entry );
+        info.first_row       = readLE<quint64>( entry + 8 );
+        info.first_timestamp = readDouble( entry + 16 );
+        info.last_timestamp  = readDouble( entry + 24 );
+        info.count           = readLE<quint32>( entry + 32 );
+        info.restarts        = readLE<quint32>( entry + 36 );
+
+        if( info.offset > footer_offset || footer_offset - info.offset < LOG_BLOCK_HEADER_SIZE )
+        {
+            index.blocks.clear();
+            return false;
+        }
+    }
+    return true;
+}
+
+bool readLogLayout(const char *buffer, size_t size, LogLayout &layout)
+{
+    size_t tree_offset = 0;
+    size_t tree_size = 0;
+    if( !logTreeLocation( buffer, size, tree_offset, tree_size ) )
+    {
+        return false;
+    }
+    layout.version = logFormatVersion( buffer, size );
+    layout.tree_offset = tree_offset;
+    layout.transitions_begin = tree_offset + tree_size;
+    layout.transitions_end = size;
+    layout.index.blocks.clear();
+
+    if( layout.hasBlocks() && readLogIndex( buffer, size, layout.index ) )
+    {
+        layout.transitions_end = size_t( layout.index.footer_offset );
+    }
+    return layout.version >= 1 && layout.version <= 3;
+}
+
+QByteArray logV2Header(const QByteArray &tree_buffer, bool compressed)
+{
+    QByteArray header( LOG_V2_MAGIC, 4 );
+    appendLE<quint32>( header, compressed ? 3 : 2 );
+    appendLE<quint32>( header, quint32( tree_buffer.size() ) );
+    header.append( tree_buffer );
+    return header;
+}
+
+void appendLogBlockInfo(QByteArray &footer, const LogBlockInfo &info)
+{
+    appendLE<quint64>( footer, info.offset );
+    appendLE<quint64>( footer, info.first_row );
+    appendDouble( footer, info.first_timestamp );
+    appendDouble( footer, info.last_timestamp );
+    appendLE<quint32>( footer, info.count );
+    appendLE<quint32>( footer, info.restarts );
+}
+
+QByteArray logTrailer(uint64_t footer_offset, uint32_t block_count)
+{
+    QByteArray trailer;
+    appendLE<quint64>( trailer, footer_offset );
+    appendLE<quint32>( trailer, block_count );
+    trailer.append( LOG_INDEX_MAGIC, 4 );
+    return trailer;
+}
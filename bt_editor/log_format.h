@@ -0,0 +1,89 @@
+#ifndef LOG_FORMAT_H
+#define LOG_FORMAT_H
+
+#include <QByteArray>
+#include <vector>
+#include <cstdint>
+
+// Layout of the .fbl logs.
+//
+// Version 1 (BT::FileLogger):
+//   u32 tree_size | tree flatbuffer | transitions
+//
+// Version 2 (LogRecorder), made of blocks with an index at the end:
+//   "FBL2" | u32 version | u32 tree_size | tree flatbuffer
+//   blocks:  u32 count | u32 payload_size | u8 snapshot[nodes_count] | payload
+//   footer:  LogBlockInfo[block_count]
+//   trailer: u64 footer_offset | u32 block_count | "FBLI"
+//
+// Version 3 is version 2 with compressed payloads: payload_size is then the
+// size of the output of qCompress (zlib), that decompresses to count
+// transitions. The header, the snapshots and the footer are not compressed.
+//
+// A transition is always 12 bytes: u32 t_sec | u32 t_usec | u16 uid |
+// u8 prev_status | u8 status. The payload of a block is count transitions.
+// The snapshot is the status of the nodes before the first transition of the
+// block (see LogParser::encodeCheckpoint).
+// A version 2 log without trailer, for instance if the recorder crashed,
+// can still be read block by block.
+
+struct LogBlockInfo
+{
+    uint64_t offset;
+    uint64_t first_row;
+    double first_timestamp;
+    double last_timestamp;
+    uint32_t count;
+    uint32_t restarts;
+};
+
+struct LogIndex
+{
+    std::vector<LogBlockInfo> blocks;
+    // where the blocks end
+    uint64_t footer_offset = 0;
+
+    uint64_t transitionsCount() const;
+};
+
+// Where the transitions of a log are.
+struct LogLayout
+{
+    int version = 0;
+    size_t tree_offset = 0;
+    size_t transitions_begin = 0;
+    size_t transitions_end = 0;
+    // version 2 and 3 only; empty if the footer is missing
+    LogIndex index;
+
+    bool hasBlocks() const { return version >= 2; }
+
+    bool isCompressed() const { return version == 3; }
+};
+
+static const int LOG_BLOCK_TRANSITIONS = 4096;
+static const size_t LOG_V2_HEADER_SIZE = 12;
+static const size_t LOG_BLOCK_HEADER_SIZE = 8;
+static const size_t LOG_BLOCK_INFO_SIZE = 40;
+static const size_t LOG_TRAILER_SIZE = 16;
+
+// 1, 2, 3, or 0 if the buffer is too short to tell.
+int logFormatVersion(const char* buffer, size_t size);
+
+// Offset and size of the tree flatbuffer. False if out of bounds.
+bool logTreeLocation(const char* buffer, size_t size, size_t& tree_offset, size_t& tree_size);
+
+// Reads the footer of a version 2 log. False if there is no valid footer.
+bool readLogIndex(const char* buffer, size_t size, LogIndex& index);
+
+// False if the log is not valid.
+bool readLogLayout(const char* buffer, size_t size, LogLayout& layout);
+
+// Header of a version 2 log, or version 3 if "compressed".
+QByteArray logV2Header(const QByteArray& tree_buffer, bool compressed = false);
+
+void appendLogBlockInfo(QByteArray& footer, const LogBlockInfo& info);
+
+QByteArray logTrailer(uint64_t footer_offset, uint32_t block_count);
+
+#endif // LOG_FORMAT_H
@@ -0,0 +1,259 @@
+#include "log_parser.h"
+#include <QFile>
+#include <stdexcept>
+#include <algorithm>
+#include <limits>
+
+#include "utils.h"
+
+LogParser::State::State(int nodes_count):
+    total_nodes(nodes_count),
+    idle_counter(nodes_count),
+    nearest_restart_transition_index(0),
+    previous_timestamp(0),
+    last_timepoint_row(-1),
+    rows(0),
+    current_status( nodes_count, encodeCheckpoint(NodeStatus::IDLE, NodeStatus::IDLE) )
+{
+}
+
+LogParser::LogParser(const std::vector<LogSessionFile> &files,
+                     const std::unordered_map<int, int> &uid_to_index,
+                     int nodes_count,
+                     int request_id,
+                     QObject *parent):
+    QThread(parent),
+    _files(files),
+    _uid_to_index(uid_to_index),
+    _nodes_count(nodes_count),
+    _request_id(request_id),
+    _cancelled(false)
+{
+    qRegisterMetaType<LogParser::ChunkPtr>();
+}
+
+LogParser::~LogParser()
+{
+    cancel();
+    wait();
+}
+
+void LogParser::cancel()
+{
+    _cancelled.store(true);
+}
+
+void LogParser::parse(const char *buffer, size_t begin, size_t end,
+                      const std::unordered_map<int, int> &uid_to_index,
+                      State &state, Chunk &chunk)
+{
+    chunk.transitions.reserve( chunk.transitions.size() + (end - begin) / 12 );
+
+    for (size_t offset = begin; offset + 12 <= end; offset += 12)
+    {
+        if( state.rows % CHECKPOINT_INTERVAL == 0 )
+        {
+            chunk.checkpoints.insert( chunk.checkpoints.end(),
+                                      state.current_status.begin(), state.current_status.end() );
+        }
+
+        Transition transition;
+        const double t_sec  = flatbuffers::ReadScalar<uint32_t>( &buffer[offset] );
+        const double t_usec = flatbuffers::ReadScalar<uint32_t>( &buffer[offset+4] );
+        double timestamp = t_sec + t_usec* 0.000001;
+        transition.timestamp = timestamp;
+        const uint16_t uid = flatbuffers::ReadScalar<uint16_t>(&buffer[offset+8]);
+        transition.index = uid_to_index.at(uid);
+        transition.prev_status = convert(flatbuffers::ReadScalar<Serialization::NodeStatus>(&buffer[offset+10] ));
+        transition.status      = convert(flatbuffers::ReadScalar<Serialization::NodeStatus>(&buffer[offset+11] ));
+        transition.is_tree_restart = false;
+
+        if(transition.index == 1 &&
+                (transition.status == NodeStatus::RUNNING || transition.status == NodeStatus::IDLE) &&
+                state.idle_counter >= state.total_nodes - 1){
+            transition.is_tree_restart = true;
+            state.nearest_restart_transition_index = int(state.rows);
+        }
+
+        if(transition.prev_status != NodeStatus::IDLE && transition.status == NodeStatus::IDLE)
+            state.idle_counter++;
+        else if(transition.prev_status == NodeStatus::IDLE && transition.status != NodeStatus::IDLE)
+            state.idle_counter--;
+
+        transition.nearest_restart_transition_index = state.nearest_restart_transition_index;
+
+        // the replay shows only what happened since the latest restart
+        if( transition.is_tree_restart )
+        {
+            std::fill( state.current_status.begin(), state.current_status.end(),
+                       encodeCheckpoint(NodeStatus::IDLE, NodeStatus::IDLE) );
+        }
+        state.current_status[transition.index] = encodeCheckpoint( transition.status, transition.prev_status );
+
+        if( (timestamp - state.previous_timestamp) >= 0.001 )
+        {
+            chunk.timepoints.push_back( { timestamp, int(state.rows) } );
+            state.previous_timestamp = timestamp;
+            state.last_timepoint_row = int(state.rows);
+        }
+
+        chunk.transitions.push_back(transition);
+        state.rows++;
+    }
+}
+
+bool LogParser::parseBlocks(const char *buffer, size_t &offset, size_t end,
+                           size_t max_transitions, bool compressed,
+                           const std::unordered_map<int, int> &uid_to_index,
+                           State &state, Chunk &chunk)
+{
+    const size_t first_count = chunk.transitions.size();
+
+    while( offset + LOG_BLOCK_HEADER_SIZE <= end &&
+           chunk.transitions.size() - first_count < max_transitions )
+    {
+        const size_t count = flatbuffers::ReadScalar<uint32_t>( &buffer[offset] );
+        const size_t payload_size = flatbuffers::ReadScalar<uint32_t>( &buffer[offset+4] );
+        const size_t payload = offset + LOG_BLOCK_HEADER_SIZE + size_t(state.total_nodes);
+
+        if( payload + payload_size > end )
+        {
+            return false;
+        }
+        // the snapshot is not needed by a sequential read
+        if( compressed )
+        {
+            const QByteArray raw = qUncompress( reinterpret_cast<const uchar*>(buffer + payload),
+                                                int(payload_size) );
+            if( size_t(raw.size()) != count * 12 )
+            {
+                return false;
+            }
+            parse( raw.constData(), 0, size_t(raw.size()), uid_to_index, state, chunk );
+        }
+        else{
+            if( payload_size != count * 12 )
+            {
+                return false;
+            }
+            parse( buffer, payload, payload + payload_size, uid_to_index, state, chunk );
+        }
+        offset = payload + payload_size;
+    }
+    return true;
+}
+
+bool LogParser::parseLog(const char *buffer, const LogLayout &layout,
+                         const std::unordered_map<int, int> &uid_to_index,
+                         State &state, Chunk &chunk)
+{
+    if( layout.hasBlocks() )
+    {
+        size_t offset = layout.transitions_begin;
+        return parseBlocks( buffer, offset, layout.transitions_end,
+                            std::numeric_limits<size_t>::max(), layout.isCompressed(),
+                            uid_to_index, state, chunk );
+    }
+    parse( buffer, layout.transitions_begin, layout.transitions_end, uid_to_index, state, chunk );
+    return true;
+}
+
+void LogParser::finish(State &state, double last_timestamp, Chunk &chunk)
+{
+    const int last_row = int(state.rows) - 1;
+    if( last_row >= 0 && state.last_timepoint_row != last_row )
+    {
+        chunk.timepoints.push_back( { last_timestamp, last_row } );
+        state.last_timepoint_row = last_row;
+    }
+}
+
+void LogParser::run()
+{
+    State state( _nodes_count );
+
+    size_t total = 0;
+    for (const auto& file: _files)
+    {
+        total += file.layout.transitions_end - file.layout.transitions_begin;
+    }
+    total = std::max<size_t>( 1, total );
+
+    size_t parsed = 0;
+    for (int index = 0; index < int(_files.size()) && !_cancelled.load(); index++)
+    {
+        if( !parseFile( index, state, parsed, total ) )
+        {
+            return;
+        }
+    }
+    emit parsingFinished( _request_id );
+}
+
+bool LogParser::parseFile(int file_index, State &state, size_t &parsed, size_t total)
+{
+    const LogLayout& layout = _files[ size_t(file_index) ].layout;
+    QFile file( _files[ size_t(file_index) ].filename );
+    if( !file.open(QIODevice::ReadOnly) )
+    {
+        emit parsingFailed( _request_id, file.errorString() );
+        return false;
+    }
+    const size_t file_size = size_t( file.size() );
+    uchar* mapped = file.map( 0, file.size() );
+    if( !mapped )
+    {
+        emit parsingFailed( _request_id, file.errorString() );
+        return false;
+    }
+    const char* buffer = reinterpret_cast<const char*>(mapped);
+
+    const size_t end = std::min( layout.transitions_end, file_size );
+    const size_t chunk_bytes = CHUNK_TRANSITIONS * 12;
+    size_t begin = layout.transitions_begin;
+
+    try{
+        bool valid = true;
+        while( begin < end && valid && !_cancelled.load() )
+        {
+            auto chunk = std::make_shared<Chunk>();
+            const size_t previous = begin;
+            if( layout.hasBlocks() )
+            {
+                // a truncated block ends the log: the recorder did not
+                // complete it
+                valid = parseBlocks( buffer, begin, end, CHUNK_TRANSITIONS,
+                                     layout.isCompressed(), _uid_to_index, state, *chunk );
+                chunk->end_offset = begin;
+            }
+            else{
+                const size_t chunk_end = std::min( begin + chunk_bytes, end );
+                parse( buffer, begin, chunk_end, _uid_to_index, state, *chunk );
+                // a truncated record at the end is not parsed
+                chunk->end_offset = begin + ( (chunk_end - begin) / 12 ) * 12;
+                begin = chunk_end;
+            }
+            chunk->state = state;
+            chunk->file = file_index;
+            parsed += begin - previous;
+            const bool last = ( size_t(file_index) + 1 == _files.size() );
+            emit chunkParsed( _request_id, chunk,
+                              (valid || !last) ? int( 100 * std::min(parsed, total) / total ) : 100 );
+
+            if( begin + LOG_BLOCK_HEADER_SIZE > end && layout.hasBlocks() )
+            {
+                break;
+            }
+        }
+        // what was not parsed, for the progress of the next files
+        parsed += end - std::min( begin, end );
+    }
+    catch( std::out_of_range& )
+    {
+        file.unmap( mapped );
+        emit parsingFailed( _request_id, tr("The log contains a node that is not in the tree") );
+        return false;
+    }
+    file.unmap( mapped );
+    return true;
+}
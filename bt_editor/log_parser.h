@@ -0,0 +1,132 @@
+#ifndef LOG_PARSER_H
+#define LOG_PARSER_H
+
+#include <QThread>
+#include <QMetaType>
+#include <atomic>
+#include <memory>
+#include <unordered_map>
+
+#include "bt_editor_base.h"
+#include "log_format.h"
+#include "log_session.h"
+
+// Decodes the transitions of a .fbl log, including the detection of the
+// restarts of the tree and the time points used by the replay slider.
+// The file is parsed in chunks on a worker thread, so that the prefix
+// already parsed can be used while the rest is loading. The files of a
+// session are parsed one after the other, as a single log.
+class LogParser : public QThread
+{
+    Q_OBJECT
+
+public:
+    // the restart detection depends on all the previous transitions
+    struct State
+    {
+        State(int nodes_count = 0);
+
+        int total_nodes;
+        int idle_counter;
+        int nearest_restart_transition_index;
+        double previous_timestamp;
+        int last_timepoint_row;
+        size_t rows;
+        // since the latest restart
+        std::vector<uint8_t> current_status;
+    };
+
+    struct Chunk
+    {
+        std::vector<Transition> transitions;
+        // timestamp and row of the transitions that start a new time point
+        std::vector<std::pair<double,int>> timepoints;
+        // status of all the nodes before every CHECKPOINT_INTERVAL rows,
+        // one byte per node (see encodeCheckpoint)
+        std::vector<uint8_t> checkpoints;
+        // where the parsing stopped in the file, and the state at that
+        // point: enough to resume it if the file grows
+        size_t end_offset = 0;
+        State state;
+        // the file of the session the transitions come from
+        int file = 0;
+    };
+
+    typedef std::shared_ptr<Chunk> ChunkPtr;
+
+    LogParser(const std::vector<LogSessionFile>& files,
+              const std::unordered_map<int,int>& uid_to_index,
+              int nodes_count,
+              int request_id,
+              QObject* parent = nullptr);
+
+    ~LogParser() override;
+
+    void cancel();
+
+    int requestId() const { return _request_id; }
+
+    // Decodes the 12 bytes records in [begin, end) and appends them to chunk.
+    // Throws std::out_of_range if a UID is not part of the tree.
+    static void parse(const char* buffer, size_t begin, size_t end,
+                      const std::unordered_map<int,int>& uid_to_index,
+                      State& state, Chunk& chunk);
+
+    // Decodes the blocks of a version 2 or 3 log, starting at "offset",
+    // until at least max_transitions are added to the chunk or "end" is
+    // reached. "offset" is moved to the next block. Returns false if a block
+    // is truncated or malformed. Compressed blocks are inflated one at a time.
+    static bool parseBlocks(const char* buffer, size_t& offset, size_t end,
+                            size_t max_transitions, bool compressed,
+                            const std::unordered_map<int,int>& uid_to_index,
+                            State& state, Chunk& chunk);
+
+    // Decodes all the transitions of a log.
+    static bool parseLog(const char* buffer, const LogLayout& layout,
+                         const std::unordered_map<int,int>& uid_to_index,
+                         State& state, Chunk& chunk);
+
+    // The last transition is always a time point.
+    static void finish(State& state, double last_timestamp, Chunk& chunk);
+
+    static const size_t CHUNK_TRANSITIONS = 256*1024;
+
+    static const size_t CHECKPOINT_INTERVAL = 4*1024;
+
+    static uint8_t encodeCheckpoint(NodeStatus status, NodeStatus prev_status)
+    {
+        return uint8_t(status) | (uint8_t(prev_status) << 2);
+    }
+
+    static void decodeCheckpoint(uint8_t value, NodeStatus& status, NodeStatus& prev_status)
+    {
+        status = NodeStatus(value & 0x03);
+        prev_status = NodeStatus((value >> 2) & 0x03);
+    }
+
+signals:
+
+    void chunkParsed(int request_id, LogParser::ChunkPtr chunk, int percent);
+
+    // emitted also when cancelled
+    void parsingFinished(int request_id);
+
+    void parsingFailed(int request_id, QString error);
+
+protected:
+    void run() override;
+
+    // false if the thread must stop
+    bool parseFile(int file_index, State& state, size_t& parsed, size_t total);
+
+private:
+    std::vector<LogSessionFile> _files;
+    std::unordered_map<int,int> _uid_to_index;
+    int _nodes_count;
+    int _request_id;
+    std::atomic<bool> _cancelled;
+};
+
+Q_DECLARE_METATYPE(LogParser::ChunkPtr)
+
+#endif // LOG_PARSER_H
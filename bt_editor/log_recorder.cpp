@@ -0,0 +1,255 @@
+#include "log_recorder.h"
+#include "utils.h"
+#include <QMutexLocker>
+#include <QtEndian>
+#include <cmath>
+#include <algorithm>
+
+LogRecorder::LogRecorder(const QString &filename, QObject *parent):
+    QThread(parent),
+    _filename(filename),
+    _file(filename),
+    _stop_requested(false),
+    _failed(false),
+    _bytes_written(0),
+    _block_count(0),
+    _compressed(false),
+    _file_offset(0)
+{
+    _pending.reserve( 2*BATCH_SIZE );
+}
+
+LogRecorder::~LogRecorder()
+{
+    stop();
+    wait();
+}
+
+bool LogRecorder::open(const QByteArray &tree_buffer, bool compressed)
+{
+    try{
+        auto fb_behavior_tree = Serialization::GetBehaviorTree( tree_buffer.data() );
+        auto res_pair = BuildTreeFromFlatbuffers( fb_behavior_tree );
+        _uid_to_index = std::move( res_pair.second );
+        _state = LogParser::State( int(res_pair.first.nodesCount()) );
+    }
+    catch( std::exception& err )
+    {
+        _error = err.what();
+        return false;
+    }
+
+    if( !_file.open( QIODevice::WriteOnly | QIODevice::Truncate ) )
+    {
+        _error = _file.errorString();
+        return false;
+    }
+    _compressed = compressed;
+    const QByteArray header = logV2Header( tree_buffer, compressed );
+
+    if( _file.write( header ) != header.size() )
+    {
+        _error = _file.errorString();
+        _file.close();
+        return false;
+    }
+    _file_offset = uint64_t( header.size() );
+    _bytes_written = header.size();
+    _block.reserve( LOG_BLOCK_TRANSITIONS * 12 );
+    return true;
+}
+
+void LogRecorder::encodeTransition(QByteArray &batch, uint16_t uid, double timestamp,
+                                   NodeStatus prev_status, NodeStatus status)
+{
+    const double t_sec = std::floor( timestamp );
+
+    uchar buffer[12];
+    qToLittleEndian<quint32>( quint32(t_sec), buffer );
+    qToLittleEndian<quint32>( quint32( (timestamp - t_sec) * 1000000.0 ), buffer + 4 );
+    qToLittleEndian<quint16>( uid, buffer + 8 );
+    // Serialization::NodeStatus has the same values as BT::NodeStatus
+    buffer[10] = uchar( prev_status );
+    buffer[11] = uchar( status );
+    batch.append( reinterpret_cast<const char*>(buffer), 12 );
+}
+
+QString LogRecorder::errorString() const
+{
+    QMutexLocker lock(&_mutex);
+    return _error;
+}
+
+bool LogRecorder::hasFailed() const
+{
+    QMutexLocker lock(&_mutex);
+    return _failed;
+}
+
+void LogRecorder::append(const QByteArray &batch)
+{
+    QMutexLocker lock(&_mutex);
+    if( _failed )
+    {
+        // not written anyway
+        return;
+    }
+    _pending.append( batch );
+    if( _pending.size() >= BATCH_SIZE )
+    {
+        _wake_up.wakeOne();
+    }
+}
+
+void LogRecorder::stop()
+{
+    QMutexLocker lock(&_mutex);
+    _stop_requested = true;
+    _wake_up.wakeOne();
+}
+
+qint64 LogRecorder::bytesWritten() const
+{
+    QMutexLocker lock(&_mutex);
+    return _bytes_written;
+}
+
+bool LogRecorder::write(const QByteArray &data)
+{
+    const qint64 written = _file.write( data );
+    _file_offset += uint64_t( std::max<qint64>( written, 0 ) );
+
+    {
+        QMutexLocker lock(&_mutex);
+        _bytes_written = qint64( _file_offset );
+    }
+    if( written != data.size() )
+    {
+        // the log would have a hole: stop here
+        fail( _file.errorString() );
+        return false;
+    }
+    return true;
+}
+
+void LogRecorder::fail(const QString &error)
+{
+    {
+        QMutexLocker lock(&_mutex);
+        _error = error;
+        _failed = true;
+        _pending.clear();
+    }
+    emit writeFailed( error );
+}
+
+void LogRecorder::writeBlock(int count)
+{
+    const size_t raw_size = size_t(count) * 12;
+    const QByteArray compressed = _compressed ?
+                qCompress( reinterpret_cast<const uchar*>(_block.constData()), int(raw_size) ) :
+                QByteArray();
+    const size_t payload_size = _compressed ? size_t(compressed.size()) : raw_size;
+
+    LogBlockInfo info;
+    info.offset = _file_offset;
+    info.first_row = _state.rows;
+    info.count = uint32_t( count );
+    info.restarts = 0;
+
+    QByteArray block;
+    block.reserve( int( LOG_BLOCK_HEADER_SIZE + _state.current_status.size() + payload_size ) );
+    uchar header[LOG_BLOCK_HEADER_SIZE];
+    qToLittleEndian<quint32>( quint32(count), header );
+    qToLittleEndian<quint32>( quint32(payload_size), header + 4 );
+    block.append( reinterpret_cast<const char*>(header), int(LOG_BLOCK_HEADER_SIZE) );
+    // the snapshot is taken before the block is parsed
+    block.append( reinterpret_cast<const char*>(_state.current_status.data()),
+                  int(_state.current_status.size()) );
+    if( _compressed )
+    {
+        block.append( compressed );
+    }
+    else{
+        block.append( _block.constData(), int(raw_size) );
+    }
+
+    // parsed into a copy: the state is the one of the rows in the file,
+    // kept only if the block is written
+    LogParser::State state = _state;
+    LogParser::Chunk chunk;
+    try{
+        LogParser::parse( _block.constData(), 0, raw_size, _uid_to_index, state, chunk );
+    }
+    catch( std::out_of_range& )
+    {
+        // not written: the readers would reject the whole log
+        _block.remove( 0, int(raw_size) );
+        fail( tr("The log contains a node that is not in the tree") );
+        return;
+    }
+    _block.remove( 0, int(raw_size) );
+
+    info.first_timestamp = chunk.transitions.front().timestamp;
+    info.last_timestamp = chunk.transitions.back().timestamp;
+    for(const auto& transition: chunk.transitions)
+    {
+        if( transition.is_tree_restart ) info.restarts++;
+    }
+
+    if( write( block ) )
+    {
+        _state = std::move( state );
+        appendLogBlockInfo( _footer, info );
+        _block_count++;
+    }
+}
+
+void LogRecorder::run()
+{
+    // flush at least once per second, even if the batch is not full
+    const unsigned long flush_period_ms = 1000;
+    const int block_bytes = LOG_BLOCK_TRANSITIONS * 12;
+
+    QByteArray received;
+    received.reserve( 2*BATCH_SIZE );
+    bool stop = false;
+
+    while( !stop )
+    {
+        {
+            QMutexLocker lock(&_mutex);
+            if( !_stop_requested && _pending.size() < BATCH_SIZE )
+            {
+                _wake_up.wait( &_mutex, flush_period_ms );
+            }
+            stop = _stop_requested;
+            // swap, to keep the critical section short
+            received.swap( _pending );
+        }
+
+        _block.append( received );
+        while( _block.size() >= block_bytes && !_failed )
+        {
+            writeBlock( LOG_BLOCK_TRANSITIONS );
+        }
+        // keeps the capacity that was reserved
+        received.resize(0);
+        if( _failed )
+        {
+            _file.close();
+            return;
+        }
+    }
+
+    if( _block.size() >= 12 )
+    {
+        writeBlock( _block.size() / 12 );
+    }
+    if( !_failed )
+    {
+        const uint64_t footer_offset = _file_offset;
+        write( _footer + logTrailer( footer_offset, _block_count ) );
+    }
+    _file.close();
+}
@@ -0,0 +1,92 @@
+#ifndef LOG_RECORDER_H
+#define LOG_RECORDER_H
+
+#include <QThread>
+#include <QFile>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QByteArray>
+
+#include "bt_editor_base.h"
+#include "log_format.h"
+#include "log_parser.h"
+
+// Writes a version 2 .fbl file (see log_format.h) on its own thread.
+// The caller only appends to a memory buffer; the data is written to disk
+// one block at a time, and the index is written by stop().
+class LogRecorder : public QThread
+{
+    Q_OBJECT
+
+public:
+    LogRecorder(const QString& filename, QObject* parent = nullptr);
+
+    ~LogRecorder() override;
+
+    // Opens the file and writes the serialized tree. Call it before start().
+    // Fails if the tree can not be deserialized. Compressed logs (version 3)
+    // are usually 5-10 times smaller.
+    bool open(const QByteArray& tree_buffer, bool compressed = false);
+
+    QString errorString() const;
+
+    // True once a block could not be written: nothing more is recorded, and
+    // writeFailed() was emitted.
+    bool hasFailed() const;
+
+    const QString& fileName() const { return _filename; }
+
+    // Encodes a transition into "batch", using the 12 bytes layout of the log.
+    static void encodeTransition(QByteArray& batch, uint16_t uid, double timestamp,
+                                 NodeStatus prev_status, NodeStatus status);
+
+    // Never blocks on the disk.
+    void append(const QByteArray& batch);
+
+    // Writes what is still pending and closes the file.
+    void stop();
+
+    qint64 bytesWritten() const;
+
+signals:
+    // emitted by the writer thread, once: the file could not be written, or
+    // a transition was not of a node of the tree
+    void writeFailed(QString error);
+
+protected:
+    void run() override;
+
+private:
+    QString _filename;
+    QString _error;
+    QFile _file;
+
+    mutable QMutex _mutex;
+    QWaitCondition _wake_up;
+    QByteArray _pending;
+    bool _stop_requested;
+    bool _failed;
+    qint64 _bytes_written;
+
+    // used only by the writer thread, after open()
+    std::unordered_map<int,int> _uid_to_index;
+    LogParser::State _state;
+    QByteArray _block;
+    QByteArray _footer;
+    uint32_t _block_count;
+    bool _compressed;
+    uint64_t _file_offset;
+
+    // Writes the first "count" transitions of _block.
+    void writeBlock(int count);
+
+    // false, and the recorder failed, if not all the data was written
+    bool write(const QByteArray& data);
+
+    // nothing more is recorded; emits writeFailed()
+    void fail(const QString& error);
+
+    static const int BATCH_SIZE = 64*1024;
+};
+
+#endif // LOG_RECORDER_H
@@ -0,0 +1,112 @@
+#include "log_session.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QObject>
+#include <algorithm>
+
+QStringList LogSession::filesInDirectory(const QString &directory)
+{
+    QDir dir( directory );
+    QStringList files;
+    for (const QFileInfo& info: dir.entryInfoList( { "*.fbl" }, QDir::Files, QDir::Name ))
+    {
+        files.push_back( info.absoluteFilePath() );
+    }
+    return files;
+}
+
+void LogSession::clear()
+{
+    _files.clear();
+    _tree_buffer.clear();
+    _reached = 0;
+}
+
+void LogSession::setFirstFile(const QString &filename, const LogLayout &layout,
+                              const char *buffer)
+{
+    clear();
+    LogSessionFile file;
+    file.filename = filename;
+    file.layout = layout;
+    _files.push_back( file );
+    _tree_buffer = QByteArray( buffer + layout.tree_offset,
+                               int(layout.transitions_begin - layout.tree_offset) );
+}
+
+bool LogSession::appendFile(const QString &filename, QString &error)
+{
+    const QString name = QFileInfo( filename ).fileName();
+    QFile file( filename );
+    if( !file.open(QIODevice::ReadOnly) )
+    {
+        error = QObject::tr("%1: %2").arg( name, file.errorString() );
+        return false;
+    }
+    // mapped only to read the header and the footer
+    uchar* mapped = file.map( 0, file.size() );
+    if( !mapped )
+    {
+        error = QObject::tr("%1: %2").arg( name, file.errorString() );
+        return false;
+    }
+    const char* buffer = reinterpret_cast<const char*>(mapped);
+
+    LogSessionFile session_file;
+    session_file.filename = filename;
+    const bool valid = readLogLayout( buffer, size_t(file.size()), session_file.layout );
+    const bool same_tree = valid &&
+            QByteArray::fromRawData( buffer + session_file.layout.tree_offset,
+                                     int(session_file.layout.transitions_begin -
+                                         session_file.layout.tree_offset) ) == _tree_buffer;
+    file.unmap( mapped );
+
+    if( !valid )
+    {
+        error = QObject::tr("%1: the log is corrupted or truncated").arg( name );
+        return false;
+    }
+    if( !same_tree )
+    {
+        error = QObject::tr("%1: the tree is not the same as in the first file").arg( name );
+        return false;
+    }
+    _files.push_back( session_file );
+    return true;
+}
+
+QStringList LogSession::filenames() const
+{
+    QStringList names;
+    for (const auto& file: _files)
+    {
+        names.push_back( file.filename );
+    }
+    return names;
+}
+
+void LogSession::setFirstRow(int file, size_t row)
+{
+    // the files skipped are empty
+    while( _reached < file && size_t(_reached + 1) < _files.size() )
+    {
+        _files[ size_t(++_reached) ].first_row = row;
+    }
+}
+
+int LogSession::fileOfRow(size_t row) const
+{
+    if( _files.empty() )
+    {
+        return -1;
+    }
+    const auto begin = _files.begin();
+    const auto end = begin + _reached + 1;
+    auto it = std::upper_bound( begin, end, row,
+                                [](size_t value, const LogSessionFile& file)
+    {
+        return value < file.first_row;
+    } );
+    return std::max( 0, int(it - begin) - 1 );
+}
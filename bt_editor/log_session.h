@@ -0,0 +1,62 @@
+#ifndef LOG_SESSION_H
+#define LOG_SESSION_H
+
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+#include <vector>
+
+#include "log_format.h"
+
+struct LogSessionFile
+{
+    QString filename;
+    LogLayout layout;
+    // row of its first transition in the concatenated timeline; valid once
+    // the file is reached by the parser
+    size_t first_row = 0;
+};
+
+// The files of a rotated recording, replayed as a single timeline. All the
+// files must have the same tree in their header; their transitions are
+// concatenated in the order of the list. Only the header and the index of
+// each file are read when the session is opened: the transitions are mapped
+// one file at a time, when the parser reaches it.
+class LogSession
+{
+public:
+    // the .fbl files of a directory, sorted by name: rotated files are
+    // named by date or by sequence number
+    static QStringList filesInDirectory(const QString& directory);
+
+    void clear();
+
+    // the first file, whose tree was already loaded from "buffer"
+    void setFirstFile(const QString& filename, const LogLayout& layout,
+                      const char* buffer);
+
+    // false, with "error" set, if the file is not a valid log of the same tree
+    bool appendFile(const QString& filename, QString& error);
+
+    const std::vector<LogSessionFile>& files() const { return _files; }
+
+    size_t filesCount() const { return _files.size(); }
+
+    QStringList filenames() const;
+
+    // the rows of "file" start at "row"; the files are reached in order
+    void setFirstRow(int file, size_t row);
+
+    // index of the last file reached by the parser
+    int reachedFiles() const { return _reached; }
+
+    // the file containing a row of the timeline
+    int fileOfRow(size_t row) const;
+
+private:
+    std::vector<LogSessionFile> _files;
+    QByteArray _tree_buffer;
+    int _reached = 0;
+};
+
+#endif // LOG_SESSION_H
@@ -1,10 +1,14 @@
 #include <QCommandLineParser>
 #include <QApplication>
 #include <QDialog>
+#include <QFileInfo>
+#include <QTimer>
+#include <iostream>
 #include <nodes/NodeStyle>
 #include <nodes/FlowViewStyle>
 #include <nodes/ConnectionStyle>
 #include <nodes/DataModelRegistry>
+#include <nodes/Trace>
 
 #include "mainwindow.h"
 #include "XML_utilities.hpp"
@@ -15,10 +19,28 @@ using QtNodes::DataModelRegistry;
 using QtNodes::FlowViewStyle;
 using QtNodes::NodeStyle;
 using QtNodes::ConnectionStyle;
+using QtNodes::Trace;
+
+namespace
+{
+// the trace is written whatever the way out of main()
+struct TraceWriter
+{
+    ~TraceWriter()
+    {
+        if( Trace::enabled() && !Trace::stop() )
+        {
+            std::cerr << "the trace could not be written" << std::endl;
+        }
+    }
+};
+}
 
 int
 main(int argc, char *argv[])
 {
+    const qint64 main_begin = Trace::now();
+
     QApplication app(argc, argv);
     app.setApplicationName("Groot");
     app.setWindowIcon(QPixmap(":/icons/BT.png"));
@@ -39,12 +61,34 @@ main(int argc, char *argv[])
                                    "Start in one of these modes: [editor,monitor,replay]",
                                    "mode");
     parser.addOption(mode_option);
+
+    QCommandLineOption trace_option(QStringList() << "trace",
+                                    "Write a timeline of the startup and of the operations, as "
+                                    "Chrome trace events (chrome://tracing). GROOT_TRACE too.",
+                                    "file", QString::fromLocal8Bit( qgetenv("GROOT_TRACE") ) );
+    parser.addOption(trace_option);
+
+    parser.addPositionalArgument("file", "A tree to edit, or a log (or directory of logs) to replay.",
+                                 "[file]");
     parser.process( app );
 
-    QFile styleFile( ":/stylesheet.qss" );
-    styleFile.open( QFile::ReadOnly );
-    QString style( styleFile.readAll() );
-    app.setStyleSheet( style );
+    TraceWriter trace_writer;
+    if( !parser.value(trace_option).isEmpty() )
+    {
+        Trace::start( parser.value(trace_option) );
+        Trace::complete( "QApplication", main_begin, Trace::now() - main_begin );
+    }
+
+    const QStringList files = parser.positionalArguments();
+    const QString file_path = files.isEmpty() ? QString() : files.front();
+
+    {
+        NODE_TRACE_SCOPE("stylesheet");
+        QFile styleFile( ":/stylesheet.qss" );
+        styleFile.open( QFile::ReadOnly );
+        QString style( styleFile.readAll() );
+        app.setStyleSheet( style );
+    }
 
     if( parser.isSet(test_option) )
     {
@@ -78,6 +122,13 @@ main(int argc, char *argv[])
                 return 0;
             }
         }
+        else if( !file_path.isEmpty() )
+        {
+            // the mode of the file: no need to ask
+            const QFileInfo info( file_path );
+            mode = ( info.isDir() || info.suffix() == "fbl" ) ? GraphicMode::REPLAY :
+                                                                GraphicMode::EDITOR;
+        }
         else{
             StartupDialog dialog;
             dialog.setWindowFlags( Qt::FramelessWindowHint );
@@ -90,6 +141,15 @@ main(int argc, char *argv[])
 
         MainWindow win( mode );
         win.show();
+        QTimer::singleShot( 0, []() { Trace::instant("first frame"); } );
+        if( !file_path.isEmpty() && mode != GraphicMode::MONITOR )
+        {
+            // once the first frame is drawn
+            QTimer::singleShot( 0, &win, [&win, file_path]() { win.openFile( file_path ); } );
+        }
+        else{
+            win.recoverAutosave();
+        }
         return app.exec();
     }
 }
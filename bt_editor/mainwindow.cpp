@@ -18,14 +18,23 @@
 #include <QXmlStreamWriter>
 #include <QDesktopServices>
 #include <QInputDialog>
+#include <QApplication>
+#include <QDockWidget>
+#include <QProgressBar>
+#include <QStatusBar>
 #include <nodes/Node>
 #include <nodes/NodeData>
 #include <nodes/NodeStyle>
 #include <nodes/FlowView>
+#include <nodes/FlowMinimap>
+#include <nodes/Trace>
 
 #include "editor_flowscene.h"
 #include "utils.h"
 #include "XML_utilities.hpp"
+#include "project_cache.h"
+#include "tree_layout.h"
+#include "scene_export.h"
 
 #include "models/RootNodeModel.hpp"
 #include "models/SubtreeNodeModel.hpp"
@@ -34,20 +43,71 @@
 
 #include "ui_about_dialog.h"
 
+#include <algorithm>
+
 using QtNodes::DataModelRegistry;
 using QtNodes::FlowView;
 using QtNodes::FlowScene;
 using QtNodes::NodeGraphicsObject;
 using QtNodes::NodeState;
 
+// the undo steps more recent than this are not packed
+static const size_t UNPACKED_UNDO_STEPS = 16;
+
 MainWindow::MainWindow(GraphicMode initial_mode, QWidget *parent) :
                                                                     QMainWindow(parent),
                                                                     ui(new Ui::MainWindow),
                                                                     _current_mode(initial_mode),
-                                                                    _current_layout(QtNodes::PortLayout::Vertical)
+                                                                    _undo_layout(QtNodes::PortLayout::Vertical),
+                                                                    _undo_steps_recorded(0),
+                                                                    _undo_packed_bytes(0),
+                                                                    _applying_undo(false),
+                                                                    _current_layout(QtNodes::PortLayout::Vertical),
+                                                                    _find_next(0),
+                                                                    _autosave_writer(nullptr),
+                                                                    _autosave_needed(false),
+                                                                    _autosave_failed(false),
+                                                                    _editor_widget(nullptr),
+                                                                    _replay_widget(nullptr)
+#ifdef ZMQ_FOUND
+                                                                  , _monitor_widget(nullptr)
+#endif
 {
+    NODE_TRACE_SCOPE("MainWindow::MainWindow");
+
     ui->setupUi(this);
 
+    // before restoreState(): it shows the dock if it was
+    _minimap = new QtNodes::FlowMinimap(this);
+    auto minimap_dock = new QDockWidget( tr("Minimap"), this );
+    minimap_dock->setObjectName( "MinimapDock" );
+    minimap_dock->setWidget( _minimap );
+    addDockWidget( Qt::RightDockWidgetArea, minimap_dock );
+    minimap_dock->hide();
+    ui->menuMode->insertAction( ui->actionAnimateLayout, minimap_dock->toggleViewAction() );
+
+    _build_progress = new QProgressBar( this );
+    _build_progress->setMaximumWidth( 160 );
+    _build_progress->setFormat( tr("%v / %m nodes") );
+    _build_progress->hide();
+    _build_cancel = new QToolButton( this );
+    _build_cancel->setText( tr("Cancel") );
+    _build_cancel->setToolTip( tr("Stop building the tree") );
+    _build_cancel->hide();
+    if( auto top_layout = qobject_cast<QBoxLayout*>( ui->semaphoreFrame->parentWidget()->layout() ) )
+    {
+        const int index = top_layout->indexOf( ui->semaphoreFrame );
+        top_layout->insertWidget( index, _build_cancel );
+        top_layout->insertWidget( index, _build_progress );
+    }
+    connect( _build_cancel, &QToolButton::clicked, this, [this]()
+    {
+        for (auto& it: _tab_info)
+        {
+            it.second->cancelBuild();
+        }
+    });
+
     QSettings settings;
     restoreGeometry(settings.value("MainWindow/geometry").toByteArray());
     restoreState(settings.value("MainWindow/windowState").toByteArray());
@@ -60,9 +120,38 @@ MainWindow::MainWindow(GraphicMode initial_mode, QWidget *parent) :
     else{
         _current_layout = QtNodes::PortLayout::Vertical;
     }
+    _undo_layout = _current_layout;
 
     _model_registry = std::make_shared<QtNodes::DataModelRegistry>();
 
+    // repaints of the status changes are done once per frame
+    _repaint_scheduler = new RepaintScheduler(this);
+    _repaint_scheduler->setBudget( settings.value("MainWindow.repaintBudgetMs", 8).toInt() );
+
+    _undo_budget = size_t( std::max( 1, settings.value("MainWindow.undoBudgetMB", 64).toInt() ) ) * 1024 * 1024;
+
+    const bool node_shadows = settings.value("MainWindow.nodeShadows", true).toBool();
+    QtNodes::NodeStyle::setShadowsEnabled( node_shadows );
+    ui->actionNodeShadows->setChecked( node_shadows );
+
+    ui->actionOpenGLViewport->setChecked( settings.value("MainWindow.openGLViewport", false).toBool() );
+
+    ui->actionAnimateLayout->setChecked( settings.value("MainWindow.animateLayout", false).toBool() );
+    GraphicContainer::setAnimatedLayout( ui->actionAnimateLayout->isChecked() );
+
+    // a single instance writes the autosave
+    QDir().mkpath( QFileInfo( AutosavePath() ).absolutePath() );
+    _autosave_lock.reset( new QLockFile( AutosavePath() + ".lock" ) );
+    // held as long as Groot runs: stale only if its process is gone
+    _autosave_lock->setStaleLockTime( 0 );
+    if( !_autosave_lock->tryLock() )
+    {
+        _autosave_lock.reset();
+    }
+    _autosave_timer = new QTimer(this);
+    connect( _autosave_timer, &QTimer::timeout, this, &MainWindow::onAutosave );
+    setAutosaveInterval( settings.value("MainWindow.autosaveSeconds", 60).toInt() );
+
     //------------------------------------------------------
 
     auto registerModel = [this](const QString& ID, const NodeModel& model)
@@ -89,29 +178,12 @@ MainWindow::MainWindow(GraphicMode initial_mode, QWidget *parent) :
     }
     //------------------------------------------------------
 
-    _editor_widget = new SidepanelEditor(_model_registry.get(), _treenode_models, this);
-    _replay_widget = new SidepanelReplay(this);
-
-    ui->leftFrame->layout()->addWidget( _editor_widget );
-    ui->leftFrame->layout()->addWidget( _replay_widget );
-
-#ifdef ZMQ_FOUND
-    _monitor_widget = new SidepanelMonitor(this);
-    ui->leftFrame->layout()->addWidget( _monitor_widget );
-
-    connect( ui->toolButtonConnect, &QToolButton::clicked,
-            _monitor_widget, &SidepanelMonitor::on_Connect );
-
-    connect( _monitor_widget, &SidepanelMonitor::connectionUpdate,
-            this, &MainWindow::onConnectionUpdate );
-#else
+#ifndef ZMQ_FOUND
     ui->actionMonitor_mode->setVisible(false);
 #endif
 
     updateCurrentMode();
 
-    dynamic_cast<QVBoxLayout*>(ui->leftFrame->layout())->setStretch(1,1);
-
     auto arrange_shortcut = new QShortcut(QKeySequence(Qt::CTRL + Qt::Key_A), this);
 
     connect( arrange_shortcut, &QShortcut::activated,
@@ -128,73 +200,14 @@ MainWindow::MainWindow(GraphicMode initial_mode, QWidget *parent) :
 
     QShortcut* save_shortcut = new QShortcut(QKeySequence(Qt::CTRL + Qt::Key_S), this);
 
-    connect( _editor_widget, &SidepanelEditor::nodeModelEdited,
-            this, &MainWindow::onTreeNodeEdited);
-
-    connect( _editor_widget, &SidepanelEditor::addNewModel,
-            this, &MainWindow::onAddToModelRegistry);
-
-    connect( _editor_widget, &SidepanelEditor::destroySubtree,
-            this, &MainWindow::onDestroySubTree);
-
-    connect( _editor_widget, &SidepanelEditor::modelRemoveRequested,
-            this, &MainWindow::onModelRemoveRequested);
-
-    connect( _editor_widget, &SidepanelEditor::addSubtree,
-             this, [this](QString ID)
-    {
-        this->createTab(ID);
-    });
-
-    connect( _editor_widget, &SidepanelEditor::renameSubtree,
-             this, [this](QString prev_ID, QString new_ID)
-    {
-        if (prev_ID == new_ID)
-            return;
-
-        for (int index = 0; index < ui->tabWidget->count(); index++)
-        {
-            if( ui->tabWidget->tabText(index) == prev_ID)
-            {
-                ui->tabWidget->setTabText(index, new_ID);
-                _tab_info.insert( {new_ID, _tab_info.at(prev_ID)}  );
-                _tab_info.erase( prev_ID );
-                break;
-            }
-        }
-    });
-
-    auto createSingleTabBehaviorTree = [this](const AbsBehaviorTree &tree, const QString &bt_name)
-    {
-      onCreateAbsBehaviorTree(tree, bt_name, false);
-    };
-
-    connect( _replay_widget, &SidepanelReplay::loadBehaviorTree,
-            this, createSingleTabBehaviorTree);
-
-    connect( _replay_widget, &SidepanelReplay::addNewModel,
-            this, &MainWindow::onAddToModelRegistry);
+    QShortcut* find_shortcut = new QShortcut(QKeySequence(Qt::CTRL + Qt::Key_F), this);
+    connect( find_shortcut, &QShortcut::activated, this, &MainWindow::onFindNode );
 
     connect( ui->toolButtonSaveFile, &QToolButton::clicked,
             this, &MainWindow::on_actionSave_triggered );
 
     connect( save_shortcut, &QShortcut::activated, this, &MainWindow::on_actionSave_triggered );
 
-    connect( _replay_widget, &SidepanelReplay::changeNodeStyle,
-            this, &MainWindow::onChangeNodesStatus);
-
-#ifdef ZMQ_FOUND
-
-    connect( _monitor_widget, &SidepanelMonitor::addNewModel,
-            this, &MainWindow::onAddToModelRegistry);
-
-    connect( _monitor_widget, &SidepanelMonitor::changeNodeStyle,
-            this, &MainWindow::onChangeNodesStatus);
-
-    connect( _monitor_widget, &SidepanelMonitor::loadBehaviorTree,
-            this, createSingleTabBehaviorTree );
-#endif
-
     ui->tabWidget->tabBar()->setContextMenuPolicy(Qt::CustomContextMenu);
     connect( ui->tabWidget->tabBar(), &QTabBar::customContextMenuRequested,
             this, &MainWindow::onTabCustomContextMenuRequested);
@@ -202,7 +215,8 @@ MainWindow::MainWindow(GraphicMode initial_mode, QWidget *parent) :
     createTab("BehaviorTree");
     onTabSetMainTree(0);
     onSceneChanged();
-    _current_state = saveCurrentState();
+    // the initial state of the undo history
+    collectUndoStep();
 }
 
 
@@ -223,6 +237,21 @@ void MainWindow::closeEvent(QCloseEvent *event)
 
     settings.setValue("StartupDialog.Mode", toStr( _current_mode ) );
 
+    if( !_project_cache_key.isEmpty() )
+    {
+        WriteProjectLayouts( _project_cache_key );
+    }
+
+    // closed properly: nothing to recover
+    if( _autosave_writer )
+    {
+        _autosave_writer->wait();
+    }
+    if( _autosave_lock )
+    {
+        QFile::remove( AutosavePath() );
+    }
+
     QMainWindow::closeEvent(event);
 }
 
@@ -237,6 +266,8 @@ GraphicContainer* MainWindow::createTab(const QString &name)
     _tab_info.insert( {name, ti } );
 
     ti->scene()->setLayout( _current_layout );
+    ti->view()->setOpenGLViewport( ui->actionOpenGLViewport->isChecked() );
+    ti->view()->setPerformanceHudVisible( ui->actionPerformanceOverlay->isChecked() );
 
     ui->tabWidget->addTab( ti->view(), name );
 
@@ -263,41 +294,74 @@ GraphicContainer* MainWindow::createTab(const QString &name)
     connect( ti, &GraphicContainer::addNewModel,
             this, &MainWindow::onAddToModelRegistry);
 
+    connect( ti, &GraphicContainer::buildProgress,
+            this, [this](int built, int total)
+    {
+        _build_progress->setRange( 0, total );
+        _build_progress->setValue( built );
+        _build_progress->show();
+        _build_cancel->show();
+    });
+
+    connect( ti, &GraphicContainer::buildFinished,
+            this, [this]()
+    {
+        bool building = false;
+        for (const auto& it: _tab_info)
+        {
+            building = building || it.second->isBuilding();
+        }
+        _build_progress->setVisible( building );
+        _build_cancel->setVisible( building );
+        if( currentTabInfo() )
+        {
+            onSceneChanged();
+        }
+    });
+
+    connect( ti, &GraphicContainer::portValueHighlighted,
+            this, [this](QString value)
+    {
+        // kept when the highlight goes away, for the dialog of its users
+        if( !value.isEmpty() )
+        {
+            _last_highlighted_value = value;
+        }
+    });
+
     return ti;
 }
 
 MainWindow::~MainWindow()
 {
+    if( _autosave_writer )
+    {
+        _autosave_writer->wait();
+    }
     delete ui;
 }
 
-void MainWindow::loadFromXML(const QString& xml_text)
+void MainWindow::loadFromXML(const QString& xml_text, const QString& directory)
 {
-    QDomDocument document;
-    try{
-        QString errorMsg;
-        int errorLine;
-        if( ! document.setContent(xml_text, &errorMsg, &errorLine ) )
-        {
-            throw std::runtime_error( tr("Error parsing XML (line %1): %2").arg(errorLine).arg(errorMsg).toStdString() );
-        }
-        //---------------
-        std::vector<QString> registered_ID;
-        for (const auto& it: _treenode_models)
-        {
-            registered_ID.push_back( it.first );
-        }
-        std::vector<QString> error_messages;
-        bool done = VerifyXML(document, registered_ID, error_messages );
+    NODE_TRACE_SCOPE("MainWindow::loadFromXML");
+
+    // the layouts of the previous project, before they are replaced
+    if( !_project_cache_key.isEmpty() )
+    {
+        WriteProjectLayouts( _project_cache_key );
+    }
+    // only the files have a copy in the cache
+    const QByteArray cache_key = directory.isEmpty() ? QByteArray() : ProjectCacheKey( xml_text, directory );
 
-        if( !done )
+    XMLDocumentContent content;
+    try{
+        if( cache_key.isEmpty() || !ReadProjectCache( cache_key, content ) )
         {
-            QString merged_error;
-            for (const auto& err: error_messages)
+            content = ReadXMLProject( xml_text, directory.isEmpty() ? QDir::currentPath() : directory );
+            if( !cache_key.isEmpty() )
             {
-                merged_error += err + "\n";
+                WriteProjectCache( cache_key, content );
             }
-            throw std::runtime_error( merged_error.toStdString() );
         }
     }
     catch( std::runtime_error& err)
@@ -308,49 +372,53 @@ void MainWindow::loadFromXML(const QString& xml_text)
         return;
     }
 
+    for (const auto& xml_tree: content.trees)
+    {
+        if( xml_tree.has_root_tag )
+        {
+            QMessageBox::question(nullptr,
+                                  "Fix your file!",
+                                  "Please remove the node <Root> from your <BehaviorTree>",
+                                  QMessageBox::Ok );
+            break;
+        }
+    }
+
     //---------------
     bool error = false;
     QString err_message;
-    auto saved_state = _current_state;
+    const size_t undo_steps = _undo_steps_recorded;
     auto prev_tree_model = _treenode_models;
 
     try {
-        auto document_root = document.documentElement();
-
-        if( document_root.hasAttribute("main_tree_to_execute"))
+        if( !content.main_tree.isEmpty() )
         {
-            _main_tree = document_root.attribute("main_tree_to_execute");
+            _main_tree = content.main_tree;
         }
 
-        auto custom_models = ReadTreeNodesModel( document_root );
+        const NodeModels& custom_models = content.models;
 
-        for( const auto& model: custom_models)
+        onAddModelsToRegistry( custom_models );
+
+        // before anything is cleared
+        for (auto& xml_tree: content.trees)
         {
-            onAddToModelRegistry( model.second );
+            ResolveTreeModels( xml_tree, _treenode_models );
         }
 
-        _editor_widget->updateTreeView();
-
         onActionClearTriggered(false);
 
         const QSignalBlocker blocker( currentTabInfo() );
 
-        for (auto bt_root = document_root.firstChildElement("BehaviorTree");
-             !bt_root.isNull();
-             bt_root = bt_root.nextSiblingElement("BehaviorTree"))
+        for (const auto& xml_tree: content.trees)
         {
-            auto tree = BuildTreeFromXML( bt_root, _treenode_models );
-            QString tree_name("BehaviorTree");
-
-            if( bt_root.hasAttribute("ID") )
+            const QString& tree_name = xml_tree.name;
+            if( xml_tree.has_ID && _main_tree.isEmpty() )  // valid when there is only one
             {
-                tree_name = bt_root.attribute("ID");
-                if( _main_tree.isEmpty() )  // valid when there is only one
-                {
-                    _main_tree = tree_name;
-                }
+                _main_tree = tree_name;
             }
-            onCreateAbsBehaviorTree(tree, tree_name);
+            // only the main tree is built now, the others when shown
+            onCreateAbsBehaviorTree(xml_tree.tree, tree_name, true, tree_name != _main_tree);
         }
 
         if( !_main_tree.isEmpty() )
@@ -390,15 +458,23 @@ void MainWindow::loadFromXML(const QString& xml_text)
     if( error )
     {
         _treenode_models = prev_tree_model;
-        loadSavedStateFromJson( saved_state );
+        // back to the state before the loading
+        discardPendingChanges();
+        for(size_t i = undo_steps; i < _undo_steps_recorded && !_undo_stack.empty(); i++)
+        {
+            applyUndoStep( popUndoStep().reversed() );
+        }
         qDebug() << "R: Undo size: " << _undo_stack.size() << " Redo size: " << _redo_stack.size();
         QMessageBox::warning(this, tr("Exception!"),
                              tr("It was not possible to parse the file. Error:\n\n%1"). arg( err_message ),
                              QMessageBox::Ok);
     }
     else{
+        _project_cache_key = cache_key;
         onSceneChanged();
         onPushUndo();
+        // same as the file
+        _autosave_needed = false;
     }
 }
 
@@ -416,201 +492,101 @@ void MainWindow::on_actionLoad_triggered()
         return;
     }
 
-    QFile file(fileName);
-
-    if (!file.open(QIODevice::ReadOnly)){
-        return;
-    }
-
     directory_path = QFileInfo(fileName).absolutePath();
     settings.setValue("MainWindow.lastLoadDirectory", directory_path);
     settings.sync();
 
-    QString xml_text;
+    openFile(fileName);
+}
 
-    QTextStream in(&file);
-    while (!in.atEnd()) {
-        xml_text += in.readLine();
+void MainWindow::openFile(const QString &path)
+{
+    if( _current_mode == GraphicMode::REPLAY )
+    {
+        replayPanel()->loadLogFile( path );
+        return;
+    }
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)){
+        QMessageBox::warning(this, tr("Can't open the file"),
+                             QString("%1: %2").arg( path, file.errorString() ) );
+        return;
     }
 
-    loadFromXML(xml_text);
+    // with its new lines, for the lines of the errors
+    QTextStream in(&file);
+    const QString xml_text = in.readAll();
+
+    loadFromXML(xml_text, QFileInfo(path).absolutePath());
 }
 
 QString MainWindow::saveToXML() const
 {
-    QDomDocument doc;
+    QString output_string;
+    QXmlStreamWriter stream(&output_string);
+    // no encoding is written to a string
+    stream.writeStartDocument();
+    writeXML(stream);
+    return output_string;
+}
 
+void MainWindow::writeXML(QXmlStreamWriter &stream) const
+{
     const char* COMMENT_SEPARATOR = " ////////// ";
 
-    QDomElement root = doc.createElement( "root" );
-    doc.appendChild( root );
+    stream.setAutoFormatting(true);
+    stream.setAutoFormattingIndent(4);
 
+    stream.writeStartElement("root");
     if( _main_tree.isEmpty() == false)
     {
-        root.setAttribute("main_tree_to_execute", _main_tree.toStdString().c_str());
+        stream.writeAttribute("main_tree_to_execute", _main_tree);
     }
 
     for (auto& it: _tab_info)
     {
         auto& container = it.second;
-        auto  scene = container->scene();
-
-        auto abs_tree = BuildTreeFromScene(container->scene());
-        auto abs_root = abs_tree.rootNode();
-        if( abs_root->children_index.size() == 1 &&
-            abs_root->model.registration_ID == "Root"  )
-        {
-            // mofe to the child of ROOT
-            abs_root = abs_tree.node( abs_root->children_index.front() );
-        }
-
-        QtNodes::Node* root_node = abs_root->graphic_node;
-
-        root.appendChild( doc.createComment(COMMENT_SEPARATOR) );
-        QDomElement root_element = doc.createElement("BehaviorTree");
-
-        root_element.setAttribute("ID", it.first.toStdString().c_str());
-        root.appendChild(root_element);
-
-        RecursivelyCreateXml(*scene, doc, root_element, root_node );
-    }
-    root.appendChild( doc.createComment(COMMENT_SEPARATOR) );
-
-    QDomElement root_models = doc.createElement("TreeNodesModel");
 
-    for(const auto& tree_it: _treenode_models)
-    {
-        const auto& ID    = tree_it.first;
-        const auto& model = tree_it.second;
-
-        if( BuiltinNodeModels().count(ID) != 0 )
+        stream.writeComment(COMMENT_SEPARATOR);
+        if( !container->isMaterialized() && container->deferredTree().nodesCount() > 0 )
         {
+            // written as it would be once built
+            WriteBehaviorTreeXML( stream, it.first, container->deferredTree(), _treenode_models );
             continue;
         }
 
-        QDomElement node = doc.createElement( QString::fromStdString(toStr(model.type)) );
+        stream.writeStartElement("BehaviorTree");
+        stream.writeAttribute("ID", it.first);
 
-        if( !node.isNull() )
+        auto scene = container->scene();
+        QtNodes::Node* root_node = findRoot( *scene );
+        if( root_node )
         {
-            node.setAttribute("ID", ID);
-
-            for(const auto& port_it: model.ports)
+            auto root_children = getChildren( *scene, *root_node, true );
+            if( root_children.size() == 1 &&
+                dynamic_cast<const RootNodeModel*>( root_node->nodeDataModel() ) )
             {
-                const auto& port_name = port_it.first;
-                const auto& port = port_it.second;
-
-                QDomElement port_element = writePortModel(port_name, port, doc);
-                node.appendChild( port_element );
+                // move to the child of ROOT
+                root_node = root_children.front();
             }
+            WriteTreeXML( stream, *scene, root_node );
         }
-        root_models.appendChild(node);
-    }
-    root.appendChild(root_models);
-    root.appendChild( doc.createComment(COMMENT_SEPARATOR) );
-
-    return xmlDocumentToString(doc);
-}
-
-QString MainWindow::xmlDocumentToString(const QDomDocument &document) const
-{
-  QString output_string;
-
-  QXmlStreamWriter stream(&output_string);
-
-  stream.setAutoFormatting(true);
-  stream.setAutoFormattingIndent(4);
-
-  stream.writeStartDocument();
-
-  auto root_element = document.documentElement();
-
-  stream.writeStartElement(root_element.tagName());
-
-  streamElementAttributes(stream, root_element);
-
-  auto next_node = root_element.firstChild();
-
-  while ( !next_node.isNull() )
-  {
-    recursivelySaveNodeCanonically(stream, next_node);
-
-    if ( stream.hasError() )
-    {
-        break;
-    }
-    next_node = next_node.nextSibling();
-  }
-
-  stream.writeEndElement();
-  stream.writeEndDocument();
-
-  return output_string;
-}
-
-void MainWindow::streamElementAttributes(QXmlStreamWriter &stream, const QDomElement &element) const
-{
-    if (element.hasAttributes())
-    {
-        QMap<QString, QString> attributes;
-        const QDomNamedNodeMap attributes_map = element.attributes();
-
-        for (int i = 0; i < attributes_map.count(); ++i)
-        {
-           auto attribute = attributes_map.item(i);
-            attributes.insert(attribute.nodeName(), attribute.nodeValue());
-        }
-
-        auto i = attributes.constBegin();
-        while (i != attributes.constEnd())
-        {
-            stream.writeAttribute(i.key(), i.value());
-            ++i;
-        }
+        stream.writeEndElement();
     }
-}
-
-void MainWindow::recursivelySaveNodeCanonically(QXmlStreamWriter &stream, const QDomNode &parent_node) const
-{
-  if ( stream.hasError() )
-  {
-    return;
-  }
-
-  if ( parent_node.isElement() )
-  {
-    const QDomElement parent_element = parent_node.toElement();
-
-    if ( !parent_element.isNull() )
-    {
-        stream.writeStartElement(parent_element.tagName());
+    stream.writeComment(COMMENT_SEPARATOR);
 
-        streamElementAttributes(stream, parent_element);
+    WriteTreeNodesModel( stream, _treenode_models );
+    stream.writeComment(COMMENT_SEPARATOR);
 
-        if (parent_element.hasChildNodes())
-        {
-            auto child = parent_element.firstChild();
-            while ( !child.isNull() )
-            {
-                recursivelySaveNodeCanonically(stream, child);
-                child = child.nextSibling();
-            }
-        }
-
-        stream.writeEndElement();
-    }
-  }
-  else if (parent_node.isComment())
-  {
-    stream.writeComment(parent_node.nodeValue());
-  }
-  else if (parent_node.isText())
-  {
-    stream.writeCharacters(parent_node.nodeValue());
-  }
+    stream.writeEndElement();
+    stream.writeEndDocument();
 }
 
 void MainWindow::on_actionSave_triggered()
 {
+    NODE_TRACE_SCOPE("MainWindow::on_actionSave_triggered");
+
     for (auto& it: _tab_info)
     {
         auto& container = it.second;
@@ -642,12 +618,18 @@ void MainWindow::on_actionSave_triggered()
         fileName += ".xml";
     }
 
-    QString xml_text = saveToXML();
-
     QFile file(fileName);
     if (file.open(QIODevice::WriteOnly)) {
-        QTextStream stream(&file);
-        stream << xml_text;
+        // as saveToXML(): QXmlStreamWriter would add the encoding on a file
+        file.write("<?xml version=\"1.0\"?>");
+        QXmlStreamWriter stream(&file);
+        writeXML(stream);
+
+        if( !stream.hasError() && _autosave_lock && !_autosave_writer )
+        {
+            QFile::remove( AutosavePath() );
+            _autosave_needed = false;
+        }
     }
 
     directory_path = QFileInfo(fileName).absolutePath();
@@ -656,6 +638,8 @@ void MainWindow::on_actionSave_triggered()
 
 void MainWindow::onAutoArrange()
 {
+    NODE_TRACE_SCOPE("MainWindow::onAutoArrange");
+
     currentTabInfo()->nodeReorder();
 }
 
@@ -744,35 +728,119 @@ void MainWindow::on_splitter_splitterMoved(int , int )
     }
 }
 
-MainWindow::SavedState MainWindow::saveCurrentState()
+UndoStep MainWindow::collectUndoStep()
 {
-    SavedState saved;
-    int index = ui->tabWidget->currentIndex();
-    saved.main_tree = _main_tree;
-    saved.current_tab_name = ui->tabWidget->tabText(index);
-    auto current_view = getTabByName( saved.current_tab_name )->view();
-    saved.view_transform = current_view->transform();
-    saved.view_area = current_view->sceneRect();
-
+    UndoStep step;
+    step.main_tree_before   = _undo_main_tree;
+    step.main_tree_after    = _main_tree;
+    step.current_tab_before = _undo_current_tab;
+    step.current_tab_after  = ui->tabWidget->tabText( ui->tabWidget->currentIndex() );
+    step.layout_before      = _undo_layout;
+    step.layout_after       = _current_layout;
+
+    std::set<QUuid> changed_nodes;
     for (auto& it: _tab_info)
     {
-        saved.json_states[it.first] = it.second->scene()->saveToMemory();
+        const GraphicContainer* container = it.second;
+
+        QString renamed_from;
+        auto snapshot_it = _undo_tabs.find( it.first );
+        if( snapshot_it == _undo_tabs.end() )
+        {
+            // a renamed tab keeps its scene
+            for (auto other = _undo_tabs.begin(); other != _undo_tabs.end(); other++)
+            {
+                if( other->second.scene() == container->scene() &&
+                    _tab_info.count( other->first ) == 0 )
+                {
+                    renamed_from = other->first;
+                    snapshot_it = _undo_tabs.insert( {it.first, std::move(other->second)} ).first;
+                    _undo_tabs.erase( other );
+                    break;
+                }
+            }
+        }
+        const bool created = ( snapshot_it == _undo_tabs.end() );
+        if( created )
+        {
+            snapshot_it = _undo_tabs.insert( {it.first, TabSnapshot()} ).first;
+        }
+        if( !container->isMaterialized() )
+        {
+            // its nodes are recorded from the first time the tab is built
+            if( created || !renamed_from.isEmpty() )
+            {
+                TabChange change;
+                change.name = it.first;
+                change.created = created;
+                change.renamed_from = renamed_from;
+                change.layout_before = change.layout_after = container->scene()->layout();
+                if( created )
+                {
+                    change.deferred_tree = container->sharedDeferredTree();
+                }
+                step.tabs.push_back( std::move(change) );
+            }
+            snapshot_it->second.setDeferred( container->scene(), container->sharedDeferredTree() );
+            continue;
+        }
+        bool connections_changed = false;
+        bool compare_all = it.second->takeUndoChanges( changed_nodes, connections_changed ) || created;
+        if( snapshot_it->second.isDeferred() )
+        {
+            // built now, not by an edit
+            snapshot_it->second.update( it.first, *it.second->scene(), changed_nodes,
+                                        connections_changed, true );
+            continue;
+        }
+        TabChange change = snapshot_it->second.update( it.first, *it.second->scene(), changed_nodes,
+                                                       connections_changed, compare_all );
+        change.created = created;
+        change.renamed_from = renamed_from;
+        if( !change.empty() )
+        {
+            step.tabs.push_back( std::move(change) );
+        }
+    }
+
+    // the tabs removed or renamed
+    for (auto it = _undo_tabs.begin(); it != _undo_tabs.end(); )
+    {
+        if( _tab_info.count( it->first ) == 0 )
+        {
+            // a tab never built is restored with its tree
+            step.tabs.push_back( it->second.removal( it->first ) );
+            it = _undo_tabs.erase( it );
+        }
+        else{
+            it++;
+        }
     }
-    return saved;
+
+    _undo_main_tree   = step.main_tree_after;
+    _undo_current_tab = step.current_tab_after;
+    _undo_layout      = step.layout_after;
+    return step;
 }
 
 void MainWindow::onPushUndo()
 {
-    SavedState saved = saveCurrentState();
+    NODE_TRACE_SCOPE("MainWindow::onPushUndo");
 
-    if( _undo_stack.empty() || ( saved != _current_state &&  _undo_stack.back() != _current_state) )
+    if( _applying_undo )
     {
-        _undo_stack.push_back( std::move(_current_state) );
-        _redo_stack.clear();
+        return;
     }
-    _current_state = saved;
+    UndoStep step = collectUndoStep();
 
-    //qDebug() << "P: Undo size: " << _undo_stack.size() << " Redo size: " << _redo_stack.size();
+    if( !step.empty() )
+    {
+        pushUndoStep( std::move(step) );
+        _redo_stack.clear();
+        _undo_steps_recorded++;
+    }
+
+    //qDebug() << "P: Undo size: " << _undo_stack.size() << " Redo size: " << _redo_stack.size();
 }
 
 void MainWindow::onUndoInvoked()
@@ -781,11 +849,11 @@ void MainWindow::onUndoInvoked()
 
     if( _undo_stack.size() > 0)
     {
-        _redo_stack.push_back( std::move(_current_state) );
-        _current_state = _undo_stack.back();
-        _undo_stack.pop_back();
+        discardPendingChanges();
 
-        loadSavedStateFromJson(_current_state);
+        UndoStep step = popUndoStep();
+        applyUndoStep( step.reversed() );
+        _redo_stack.push_back( std::move(step) );
 
         // qDebug() << "U: Undo size: " << _undo_stack.size() << " Redo size: " << _redo_stack.size();
     }
@@ -797,46 +865,249 @@ void MainWindow::onRedoInvoked()
 
     if( _redo_stack.size() > 0)
     {
-        _undo_stack.push_back( _current_state );
-        _current_state = std::move( _redo_stack.back() );
-        _redo_stack.pop_back();
+        discardPendingChanges();
 
-        loadSavedStateFromJson(_current_state);
+        UndoStep step = std::move( _redo_stack.back() );
+        _redo_stack.pop_back();
+        applyUndoStep( step );
+        pushUndoStep( std::move(step) );
 
         // qDebug() << "R: Undo size: " << _undo_stack.size() << " Redo size: " << _redo_stack.size();
     }
 }
 
-void MainWindow::loadSavedStateFromJson(SavedState saved_state)
+void MainWindow::pushUndoStep(UndoStep step)
 {
-    // TODO crash if the name of the container (tab) changed
-    for (auto& it: _tab_info)
+    markTabsForAutosave( step );
+    _undo_stack.push_back( std::move(step) );
+
+    // the most recent steps are left as they are, for a fast undo
+    if( _undo_stack.size() > UNPACKED_UNDO_STEPS )
     {
-        it.second->clearScene();
-        it.second->deleteLater();
+        UndoStep& old_step = _undo_stack[ _undo_stack.size() - 1 - UNPACKED_UNDO_STEPS ];
+        if( !old_step.isPacked() )
+        {
+            old_step.pack();
+            _undo_packed_bytes += size_t( old_step.packed.size() );
+        }
     }
-    _tab_info.clear();
-    ui->tabWidget->clear();
+    while( _undo_packed_bytes > _undo_budget && _undo_stack.front().isPacked() )
+    {
+        _undo_packed_bytes -= size_t( _undo_stack.front().packed.size() );
+        _undo_stack.pop_front();
+    }
+}
+
+UndoStep MainWindow::popUndoStep()
+{
+    UndoStep step = std::move( _undo_stack.back() );
+    _undo_stack.pop_back();
+    if( step.isPacked() )
+    {
+        _undo_packed_bytes -= size_t( step.packed.size() );
+        step.unpack();
+    }
+    return step;
+}
+
+void MainWindow::markTabsForAutosave(const UndoStep &step)
+{
+    for (const TabChange& change: step.tabs)
+    {
+        _autosave_dirty_tabs.insert( change.name );
+    }
+    _autosave_needed = true;
+}
+
+void MainWindow::onAutosave()
+{
+    NODE_TRACE_SCOPE("MainWindow::onAutosave");
+
+    if( !_autosave_lock || _autosave_writer || !_autosave_needed ||
+        _current_mode != GraphicMode::EDITOR )
+    {
+        return;
+    }
+
+    // the removed and renamed tabs
+    auto& trees = _autosave_snapshot.trees;
+    for (auto it = trees.begin(); it != trees.end(); )
+    {
+        it = ( _tab_info.count( it->first ) == 0 ) ? trees.erase( it ) : std::next( it );
+    }
+    // only the modified trees are copied, on this thread
+    for (const auto& tab_it: _tab_info)
+    {
+        if( trees.count( tab_it.first ) != 0 && _autosave_dirty_tabs.count( tab_it.first ) == 0 )
+        {
+            continue;
+        }
+        GraphicContainer* container = tab_it.second;
+        trees[ tab_it.first ] = std::make_shared<AbsBehaviorTree>(
+                    container->isMaterialized() ? BuildTreeFromScene( container->scene(), nullptr, true ) :
+                                                  container->deferredTree() );
+    }
+    _autosave_snapshot.main_tree = _main_tree;
+    _autosave_snapshot.models = _treenode_models;
+    _autosave_dirty_tabs.clear();
+    _autosave_needed = false;
+
+    _autosave_writer = new AutosaveWriter( _autosave_snapshot, this );
+    connect( _autosave_writer, &QThread::finished, this, [this]()
+    {
+        if( !_autosave_writer->succeeded() )
+        {
+            // tried again at the next tick, but shown only once
+            _autosave_needed = true;
+            if( !_autosave_failed )
+            {
+                _autosave_failed = true;
+                statusBar()->showMessage( tr("Autosave to %1 failed: %2")
+                                          .arg( AutosavePath(), _autosave_writer->errorString() ) );
+            }
+        }
+        else if( _autosave_failed )
+        {
+            _autosave_failed = false;
+            statusBar()->clearMessage();
+        }
+        _autosave_writer->deleteLater();
+        _autosave_writer = nullptr;
+    });
+    _autosave_writer->start();
+}
+
+void MainWindow::setAutosaveInterval(int seconds)
+{
+    if( seconds > 0 )
+    {
+        _autosave_timer->start( seconds * 1000 );
+    }
+    else{
+        _autosave_timer->stop();
+    }
+}
+
+void MainWindow::on_actionAutosave_triggered()
+{
+    QSettings settings;
+    bool ok = false;
+    const int seconds = QInputDialog::getInt(
+        this, tr("Autosave"), tr("Seconds between two autosaves, 0 to disable them"),
+        settings.value("MainWindow.autosaveSeconds", 60).toInt(), 0, 3600, 10, &ok );
+    if( !ok )
+    {
+        return;
+    }
+    settings.setValue("MainWindow.autosaveSeconds", seconds);
+    setAutosaveInterval( seconds );
+}
 
-    _main_tree = saved_state.main_tree;
+void MainWindow::recoverAutosave()
+{
+    if( !_autosave_lock )
+    {
+        return;
+    }
+    QFile file( AutosavePath() );
+    if( !file.open( QIODevice::ReadOnly ) )
+    {
+        return;
+    }
+    const auto answer = QMessageBox::question(
+        this, tr("Recover"),
+        tr("Groot did not close properly.\nDo you want to load the trees saved automatically?"),
+        QMessageBox::Yes | QMessageBox::No );
+    if( answer == QMessageBox::Yes )
+    {
+        QTextStream in(&file);
+        loadFromXML( in.readAll() );
+    }
+    else{
+        file.remove();
+    }
+}
 
-    for(const auto& it: saved_state.json_states)
+void MainWindow::discardPendingChanges()
+{
+    UndoStep pending = collectUndoStep();
+    if( !pending.empty() )
     {
-        QString tab_name = it.first;
-        _tab_info.insert( {tab_name, createTab(tab_name)} );
+        applyUndoStep( pending.reversed() );
     }
-    for(const auto& it: saved_state.json_states)
+}
+
+void MainWindow::applyUndoStep(const UndoStep &step)
+{
+    NODE_TRACE_SCOPE("MainWindow::applyUndoStep");
+
+    markTabsForAutosave( step );
+    _applying_undo = true;
+
+    for (const TabChange& change: step.tabs)
     {
-        QString name = it.first;
-        auto container = getTabByName(name);
-        container->loadFromJson( it.second );
-        container->view()->setTransform( saved_state.view_transform );
-        container->view()->setSceneRect( saved_state.view_area );
+        if( change.removed )
+        {
+            for (int index = 0; index < ui->tabWidget->count(); index++)
+            {
+                if( ui->tabWidget->tabText(index) == change.name )
+                {
+                    auto container = getTabByName( change.name );
+                    container->clearScene();
+                    container->deleteLater();
+                    ui->tabWidget->removeTab( index );
+                    _tab_info.erase( change.name );
+                    break;
+                }
+            }
+            continue;
+        }
+
+        if( !change.renamed_from.isEmpty() )
+        {
+            for (int index = 0; index < ui->tabWidget->count(); index++)
+            {
+                if( ui->tabWidget->tabText(index) == change.renamed_from )
+                {
+                    ui->tabWidget->setTabText( index, change.name );
+                    _tab_info.insert( {change.name, _tab_info.at( change.renamed_from )} );
+                    _tab_info.erase( change.renamed_from );
+                    break;
+                }
+            }
+        }
+
+        auto container = getTabByName( change.name );
+        if( !container )
+        {
+            container = createTab( change.name );
+            if( change.deferred_tree )
+            {
+                // built when shown, as before its removal
+                const QSignalBlocker blocker( container );
+                container->setDeferredTree( *change.deferred_tree );
+                continue;
+            }
+            // without the default Root: it is in the change
+            container->clearScene();
+        }
+        if( !container->isMaterialized() && change.nodes.empty() &&
+            change.connections_created.empty() && change.connections_removed.empty() )
+        {
+            // renamed only: it stays deferred
+            continue;
+        }
+        const QSignalBlocker blocker( container );
+        ApplyTabChange( *container->scene(), change );
     }
+    // before the current tab changes: it is relayouted when shown
+    refreshNodesLayout( step.layout_after );
+
+    _main_tree = step.main_tree_after;
 
     for (int i=0; i< ui->tabWidget->count(); i++)
     {
-        if( ui->tabWidget->tabText( i ) == saved_state.current_tab_name)
+        if( ui->tabWidget->tabText( i ) == step.current_tab_after)
         {
             ui->tabWidget->setCurrentIndex(i);
             ui->tabWidget->widget(i)->setFocus();
@@ -850,6 +1121,11 @@ void MainWindow::loadSavedStateFromJson(SavedState saved_state)
     {
         onTabSetMainTree(0);
     }
+    _applying_undo = false;
+
+    // what was applied, and the reorder done when a tab becomes the
+    // current one, is the new state of the undo history
+    collectUndoStep();
     onSceneChanged();
 }
 
@@ -891,7 +1167,7 @@ void MainWindow::onRequestSubTreeExpand(GraphicContainer& container,
 }
 
 
-void MainWindow::onAddToModelRegistry(const NodeModel &model)
+void MainWindow::registerModel(const NodeModel &model)
 {
     namespace util = QtNodes::detail;
     const auto& ID = model.registration_ID;
@@ -908,7 +1184,27 @@ void MainWindow::onAddToModelRegistry(const NodeModel &model)
     _model_registry->registerModel( QString::fromStdString( toStr(model.type)), node_creator, ID);
 
     _treenode_models.insert( {ID, model } );
-    _editor_widget->updateTreeView();
+}
+
+void MainWindow::onAddToModelRegistry(const NodeModel &model)
+{
+    registerModel( model );
+    if( _editor_widget )
+    {
+        _editor_widget->updateTreeView();
+    }
+}
+
+void MainWindow::onAddModelsToRegistry(const NodeModels &models)
+{
+    for( const auto& it: models )
+    {
+        registerModel( it.second );
+    }
+    if( _editor_widget )
+    {
+        _editor_widget->updateTreeView();
+    }
 }
 
 void MainWindow::onDestroySubTree(const QString &ID)
@@ -922,23 +1218,42 @@ void MainWindow::onDestroySubTree(const QString &ID)
             continue;
         }
         auto container = it.second;
-        auto tree = BuildTreeFromScene(container->scene());
-        for( const auto& abs_node: tree.nodes())
+        // a tab never built is built only if it uses the SubTree
+        if( !container->usesModel( ID ) )
         {
-            auto qt_node = abs_node.graphic_node;
-            auto bt_node = dynamic_cast<BehaviorTreeDataModel*>(qt_node->nodeDataModel());
-            if(bt_node->nodeType() == NodeType::SUBTREE && bt_node->instanceName() == ID)
+            continue;
+        }
+        auto scene = container->scene();
+        // the SubTree replaces the usages hidden in the collapsed branches too
+        for( auto collapsed: scene->collapsedUsages( ID ) )
+        {
+            container->markNodeChanged( *collapsed );
+            scene->expandBranch( *collapsed );
+        }
+        const auto& usages = scene->nodesOfModel( ID );
+        // the scene changes while they are removed
+        std::vector<QUuid> usage_ids;
+        for( auto qt_node: usages )
+        {
+            usage_ids.push_back( qt_node->id() );
+        }
+        for( const QUuid& id: usage_ids )
+        {
+            auto node_it = scene->nodes().find( id );
+            if( node_it == scene->nodes().end() )
             {
-                auto new_node = qt_node;
-                auto subtree_model = dynamic_cast<SubtreeNodeModel*>(bt_node);
-                if( subtree_model && subtree_model->expanded() == false )
-                {
-                    new_node = subTreeExpand( *container, *qt_node,
-                                             SubtreeExpandOption::SUBTREE_EXPAND );
-                }
-                container->lockSubtreeEditing(*new_node, false, false);
-                container->onSmartRemove( new_node );
+                continue;
+            }
+            auto qt_node = node_it->second.get();
+            auto new_node = qt_node;
+            auto subtree_model = dynamic_cast<SubtreeNodeModel*>( qt_node->nodeDataModel() );
+            if( subtree_model && subtree_model->expanded() == false )
+            {
+                new_node = subTreeExpand( *container, *qt_node,
+                                         SubtreeExpandOption::SUBTREE_EXPAND );
             }
+            container->lockSubtreeEditing(*new_node, false, false);
+            container->onSmartRemove( new_node );
         }
         container->nodeReorder();
     }
@@ -947,7 +1262,7 @@ void MainWindow::onDestroySubTree(const QString &ID)
     {
         if( ui->tabWidget->tabText(index) == ID)
         {
-            sub_container->scene()->clearScene();
+            sub_container->clearScene();
             sub_container->deleteLater();
             ui->tabWidget->removeTab( index );
             _tab_info.erase(ID);
@@ -966,26 +1281,16 @@ void MainWindow::onDestroySubTree(const QString &ID)
 
 void MainWindow::onModelRemoveRequested(QString ID)
 {
-    BehaviorTreeDataModel* node_found = nullptr;
+    bool node_found = false;
     QString tab_containing_node;
 
+    // including the nodes hidden in the collapsed branches
     for (auto& it: _tab_info)
     {
-        auto container = it.second;
-        for(const auto& node_it: container->scene()->nodes() )
-        {
-            QtNodes::Node* graphic_node = node_it.second.get();
-            auto bt_node = dynamic_cast<BehaviorTreeDataModel*>( graphic_node->nodeDataModel() );
-
-            if( bt_node->model().registration_ID == ID )
-            {
-                node_found = bt_node;
-                tab_containing_node = it.first;
-                break;
-            }
-        }
-        if( node_found != nullptr )
+        if( it.second->usesModel( ID ) )
         {
+            node_found = true;
+            tab_containing_node = it.first;
             break;
         }
     }
@@ -1009,7 +1314,7 @@ void MainWindow::onModelRemoveRequested(QString ID)
     else
     {
         int ret = QMessageBox::Cancel;
-        if( node_found->model().type != NodeType::SUBTREE )
+        if( node_type != NodeType::SUBTREE )
         {
             ret = QMessageBox::warning(this,"Delete TreeNode Model?",
                                        "Are you sure? This action can't be undone.",
@@ -1037,6 +1342,8 @@ QtNodes::Node* MainWindow::subTreeExpand(GraphicContainer &container,
                                          QtNodes::Node &node,
                                          MainWindow::SubtreeExpandOption option)
 {
+    NODE_TRACE_SCOPE("MainWindow::subTreeExpand");
+
     bool is_editor_mode = (_current_mode == GraphicMode::EDITOR);
     const QSignalBlocker blocker( this );
     auto subtree_model = dynamic_cast<SubtreeNodeModel*>(node.nodeDataModel());
@@ -1055,11 +1362,16 @@ QtNodes::Node* MainWindow::subTreeExpand(GraphicContainer &container,
             return &node;
         }
 
-        auto abs_subtree = BuildTreeFromScene( subtree_container->scene() );
+        auto abs_subtree = BuildTreeFromScene( subtree_container->scene(), nullptr, true );
 
         subtree_model->setExpanded(true);
+        container.markNodeChanged( node );
         node.nodeState().getEntries(PortType::Out).resize(1);
+        node.nodeGraphicsObject().setGeometryChanged();
+        container.scene()->portsChanged( node );
         container.appendTreeToNode( node, abs_subtree );
+        subtree_model->setSourceRevision( subtree_container->revision() );
+        setNestedSourceRevisions( container, node );
         container.lockSubtreeEditing( node, true, is_editor_mode );
 
         if( abs_subtree.nodes().size() > 1 )
@@ -1090,7 +1402,10 @@ QtNodes::Node* MainWindow::subTreeExpand(GraphicContainer &container,
         }
 
         subtree_model->setExpanded(false);
+        container.markNodeChanged( node );
         node.nodeState().getEntries(PortType::Out).resize(0);
+        node.nodeGraphicsObject().setGeometryChanged();
+        container.scene()->portsChanged( node );
         container.lockSubtreeEditing( node, false, is_editor_mode );
         if( need_reorder )
         {
@@ -1111,10 +1426,12 @@ QtNodes::Node* MainWindow::subTreeExpand(GraphicContainer &container,
         QtNodes::Node* child_node = conn_out.begin()->second->getNode( PortType::In );
 
         auto subtree_container = getTabByName(subtree_name);
-        auto subtree = BuildTreeFromScene( subtree_container->scene() );
+        auto subtree = BuildTreeFromScene( subtree_container->scene(), nullptr, true );
 
         container.deleteSubTreeRecursively( *child_node );
         container.appendTreeToNode( node, subtree );
+        subtree_model->setSourceRevision( subtree_container->revision() );
+        setNestedSourceRevisions( container, node );
         container.nodeReorder();
         container.lockSubtreeEditing( node, true, is_editor_mode );
 
@@ -1134,26 +1451,208 @@ void MainWindow::on_toolButtonCenterView_pressed()
     currentTabInfo()->zoomHomeView();
 }
 
+bool MainWindow::showNode(const QString &tab_name, const QUuid &node_id)
+{
+    GraphicContainer* container = getTabByName( tab_name );
+    if( !container )
+    {
+        return false;
+    }
+    auto& nodes = container->scene()->nodes();
+    auto node_it = nodes.find( node_id );
+    if( node_it == nodes.end() )
+    {
+        return false;
+    }
+    for (int i=0; i< ui->tabWidget->count(); i++)
+    {
+        if( ui->tabWidget->tabText( i ) == tab_name )
+        {
+            ui->tabWidget->setCurrentIndex( i );
+            break;
+        }
+    }
+    auto& graphic_object = node_it->second->nodeGraphicsObject();
+    container->scene()->clearSelection();
+    graphic_object.setSelected( true );
+    container->view()->centerOn( &graphic_object );
+    return true;
+}
+
+std::vector<PortValueUser> MainWindow::findPortValueUsers(const QString &value)
+{
+    std::vector<PortValueUser> users;
+    for(auto& tab_it: _tab_info)
+    {
+        GraphicContainer* container = tab_it.second;
+        if( !container->isMaterialized() )
+        {
+            // built only if it uses the value
+            const auto& abs_nodes = container->deferredTree().nodes();
+            bool found = false;
+            for(auto node_it = abs_nodes.begin(); !found && node_it != abs_nodes.end(); ++node_it)
+            {
+                for(const auto& port_it: node_it->ports_mapping)
+                {
+                    found = found || ( port_it.second == value );
+                }
+            }
+            if( !found )
+            {
+                continue;
+            }
+        }
+        for(QtNodes::Node* node: container->scene()->nodesWithPortValue( value ))
+        {
+            auto bt_model = dynamic_cast<BehaviorTreeDataModel*>( node->nodeDataModel() );
+            const auto& ports = bt_model->model().ports;
+            for(const auto& port_it: bt_model->getCurrentPortMapping())
+            {
+                if( port_it.second != value )
+                {
+                    continue;
+                }
+                auto port_model = ports.find( port_it.first );
+                const PortDirection direction = ( port_model != ports.end() ) ?
+                            port_model->second.direction : PortDirection::INOUT;
+                users.push_back( { tab_it.first, node->id(), bt_model->instanceName(),
+                                   port_it.first, direction } );
+            }
+        }
+    }
+    return users;
+}
+
+void MainWindow::on_actionPortValueUsers_triggered()
+{
+    bool ok = false;
+    const QString value = QInputDialog::getText (
+        this, tr ("Readers and Writers"),
+        tr ("Blackboard key or port value, as {key}"),
+        QLineEdit::Normal, _last_highlighted_value, &ok).trimmed();
+    if( !ok || value.isEmpty() )
+    {
+        return;
+    }
+    _last_highlighted_value = value;
+
+    auto dialog = new PortValueDialog( value, findPortValueUsers( value ), this );
+    dialog->setAttribute( Qt::WA_DeleteOnClose );
+    connect( dialog, &PortValueDialog::nodeActivated,
+            this, [this](QString tab, QUuid node) { showNode( tab, node ); } );
+    dialog->show();
+}
+
+std::vector<std::pair<QString, QUuid>> MainWindow::findNodes(const QString &query)
+{
+    std::vector<std::pair<QString, QUuid>> matches;
+    for(auto& tab_it: _tab_info)
+    {
+        GraphicContainer* container = tab_it.second;
+        if( !container->isMaterialized() )
+        {
+            // built only if it contains a match
+            const QString needle = query.toLower();
+            bool found = false;
+            for(const auto& abs_node: container->deferredTree().nodes())
+            {
+                found = abs_node.instance_name.toLower().contains( needle ) ||
+                        abs_node.model.registration_ID.toLower().contains( needle );
+                for(auto port_it = abs_node.ports_mapping.begin();
+                    !found && port_it != abs_node.ports_mapping.end(); ++port_it)
+                {
+                    found = port_it->second.toLower().contains( needle );
+                }
+                if( found ) break;
+            }
+            if( !found )
+            {
+                continue;
+            }
+        }
+        std::vector<QtNodes::Node*> nodes = container->scene()->searchIndex().find( query );
+        // from the top left corner of the tree
+        std::sort( nodes.begin(), nodes.end(), [](QtNodes::Node* a, QtNodes::Node* b)
+        {
+            const QPointF pos_a = a->nodeGraphicsObject().pos();
+            const QPointF pos_b = b->nodeGraphicsObject().pos();
+            return pos_a.y() < pos_b.y() || ( pos_a.y() == pos_b.y() && pos_a.x() < pos_b.x() );
+        });
+        for(auto node: nodes)
+        {
+            matches.push_back( { tab_it.first, node->id() } );
+        }
+    }
+    return matches;
+}
+
+void MainWindow::onFindNode()
+{
+    bool ok = false;
+    const QString query = QInputDialog::getText (
+        this, tr ("Find Node"),
+        tr ("Name, ID or port value of the node"),
+        QLineEdit::Normal, _find_query, &ok).trimmed();
+    if( !ok || query.isEmpty() )
+    {
+        return;
+    }
+
+    // the same text again goes to the next match
+    if( query != _find_query || _find_matches.empty() )
+    {
+        _find_query = query;
+        _find_matches = findNodes( query );
+        _find_next = 0;
+    }
+
+    for(size_t attempt = 0; attempt < _find_matches.size(); attempt++)
+    {
+        const auto& match = _find_matches[ _find_next ];
+        _find_next = ( _find_next + 1 ) % _find_matches.size();
+
+        if( showNode( match.first, match.second ) )
+        {
+            return;
+        }
+    }
+
+    _find_matches.clear();
+    QMessageBox::information( this, tr("Find Node"),
+                              tr("No node contains \"%1\"").arg( query ) );
+}
+
 void MainWindow::clearUndoStacks()
 {
     _undo_stack.clear();
     _redo_stack.clear();
+    _undo_packed_bytes = 0;
     onSceneChanged();
     onPushUndo();
 }
 
 void MainWindow::onCreateAbsBehaviorTree(const AbsBehaviorTree &tree,
                                          const QString &bt_name,
-                                         bool secondary_tabs)
+                                         bool secondary_tabs,
+                                         bool deferred)
 {
+    NODE_TRACE_SCOPE("MainWindow::onCreateAbsBehaviorTree");
+
     auto container = getTabByName(bt_name);
     if( !container )
     {
         container = createTab(bt_name);
     }
     const QSignalBlocker blocker( container );
-    container->loadSceneFromTree( tree );
-    container->nodeReorder();
+    if( deferred )
+    {
+        container->setDeferredTree( tree );
+    }
+    else{
+        // the large trees are built a slice at a time, and laid out at the end
+        container->loadSceneProgressively( tree );
+        container->nodeReorder();
+    }
 
     if( secondary_tabs ){
       for(const auto& node: tree.nodes())
@@ -1180,24 +1679,13 @@ void MainWindow::onTreeNodeEdited(QString prev_ID, QString new_ID)
     for (auto& it: _tab_info)
     {
         auto container = it.second;
-        std::vector<QtNodes::Node*> nodes_to_rename;
-
-        for(const auto& node_it: container->scene()->nodes() )
+        if( !container->usesModel( prev_ID ) )
         {
-            QtNodes::Node* graphic_node = node_it.second.get();
-            if( !graphic_node )  {
-                continue;
-            }
-            auto bt_node = dynamic_cast<BehaviorTreeDataModel*>( graphic_node->nodeDataModel() );
-            if( !bt_node ) {
-                continue;
-            }
-
-            if( bt_node->model().registration_ID == prev_ID )
-            {
-                nodes_to_rename.push_back( graphic_node );
-            }
+            continue;
         }
+        // a copy: the index changes while the nodes are substituted
+        const auto& usages = container->scene()->nodesOfModel( prev_ID );
+        std::vector<QtNodes::Node*> nodes_to_rename( usages.begin(), usages.end() );
 
         for(auto& graphic_node: nodes_to_rename )
         {
@@ -1221,6 +1709,16 @@ void MainWindow::onTreeNodeEdited(QString prev_ID, QString new_ID)
                 subTreeExpand( *container, *new_node, SUBTREE_EXPAND);
             };
         }
+
+        // the nodes hidden in the collapsed branches
+        auto model_it = _treenode_models.find( new_ID );
+        if( model_it != _treenode_models.end() )
+        {
+            for(auto node: container->scene()->renameCollapsedModel( prev_ID, model_it->second ) )
+            {
+                container->markNodeChanged( *node );
+            }
+        }
     }
 }
 
@@ -1233,6 +1731,7 @@ void MainWindow::onActionClearTriggered(bool create_new)
         it.second->deleteLater();
     }
     _tab_info.clear();
+    _subtree_status.clear();
 
     ui->tabWidget->clear();
     if( create_new )
@@ -1240,10 +1739,19 @@ void MainWindow::onActionClearTriggered(bool create_new)
         createTab("BehaviorTree");
     }
 
-    _editor_widget->clear();
-    _replay_widget->clear();
+    if( _editor_widget )
+    {
+        _editor_widget->clear();
+    }
+    if( _replay_widget )
+    {
+        _replay_widget->clear();
+    }
 #ifdef ZMQ_FOUND
-    _monitor_widget->clear();
+    if( _monitor_widget )
+    {
+        _monitor_widget->clear();
+    }
 #endif
 
 }
@@ -1253,10 +1761,34 @@ void MainWindow::updateCurrentMode()
 {
     const bool NOT_EDITOR = _current_mode != GraphicMode::EDITOR;
 
-    _editor_widget->setHidden( NOT_EDITOR );
-    _replay_widget->setHidden( _current_mode != GraphicMode::REPLAY );
+    if( _current_mode == GraphicMode::EDITOR )
+    {
+        editorPanel();
+    }
+    else if( _current_mode == GraphicMode::REPLAY )
+    {
+        replayPanel();
+    }
+#ifdef ZMQ_FOUND
+    else if( _current_mode == GraphicMode::MONITOR )
+    {
+        monitorPanel();
+    }
+#endif
+
+    if( _editor_widget )
+    {
+        _editor_widget->setHidden( NOT_EDITOR );
+    }
+    if( _replay_widget )
+    {
+        _replay_widget->setHidden( _current_mode != GraphicMode::REPLAY );
+    }
 #ifdef ZMQ_FOUND
-    _monitor_widget->setHidden( _current_mode != GraphicMode::MONITOR );
+    if( _monitor_widget )
+    {
+        _monitor_widget->setHidden( _current_mode != GraphicMode::MONITOR );
+    }
 #endif
 
     ui->toolButtonLoadFile->setHidden( _current_mode == GraphicMode::MONITOR );
@@ -1276,12 +1808,18 @@ void MainWindow::updateCurrentMode()
     ui->toolButtonSaveFile->setHidden( NOT_EDITOR );
     ui->toolButtonReorder->setHidden( NOT_EDITOR );
 
+    // trees are not edited in the other modes: their nodes need no widgets
+    BehaviorTreeDataModel::setPaintedMode( NOT_EDITOR );
+
     if( _current_mode == GraphicMode::EDITOR )
     {
         connect( ui->toolButtonLoadFile, &QToolButton::clicked,
                 this, &MainWindow::on_actionLoad_triggered );
-        disconnect( ui->toolButtonLoadFile, &QToolButton::clicked,
-                   _replay_widget, &SidepanelReplay::on_LoadLog );
+        if( _replay_widget )
+        {
+            disconnect( ui->toolButtonLoadFile, &QToolButton::clicked,
+                       _replay_widget, &SidepanelReplay::on_LoadLog );
+        }
     }
     else if( _current_mode == GraphicMode::REPLAY )
     {
@@ -1303,10 +1841,128 @@ void MainWindow::updateCurrentMode()
     ui->actionReplay_mode->setEnabled( _current_mode != GraphicMode::REPLAY);
 }
 
+SidepanelEditor *MainWindow::editorPanel()
+{
+    if( _editor_widget )
+    {
+        return _editor_widget;
+    }
+    _editor_widget = new SidepanelEditor(_model_registry.get(), _treenode_models, this);
+    ui->leftFrame->layout()->addWidget( _editor_widget );
+
+    connect( _editor_widget, &SidepanelEditor::nodeModelEdited,
+            this, &MainWindow::onTreeNodeEdited);
+
+    connect( _editor_widget, &SidepanelEditor::addNewModel,
+            this, &MainWindow::onAddToModelRegistry);
+
+    connect( _editor_widget, &SidepanelEditor::addNewModels,
+            this, &MainWindow::onAddModelsToRegistry);
+
+    connect( _editor_widget, &SidepanelEditor::destroySubtree,
+            this, &MainWindow::onDestroySubTree);
+
+    connect( _editor_widget, &SidepanelEditor::modelRemoveRequested,
+            this, &MainWindow::onModelRemoveRequested);
+
+    connect( _editor_widget, &SidepanelEditor::addSubtree,
+             this, [this](QString ID)
+    {
+        this->createTab(ID);
+    });
+
+    connect( _editor_widget, &SidepanelEditor::renameSubtree,
+             this, [this](QString prev_ID, QString new_ID)
+    {
+        if (prev_ID == new_ID)
+            return;
+
+        for (int index = 0; index < ui->tabWidget->count(); index++)
+        {
+            if( ui->tabWidget->tabText(index) == prev_ID)
+            {
+                ui->tabWidget->setTabText(index, new_ID);
+                _tab_info.insert( {new_ID, _tab_info.at(prev_ID)}  );
+                _tab_info.erase( prev_ID );
+                break;
+            }
+        }
+    });
+    return _editor_widget;
+}
+
+SidepanelReplay *MainWindow::replayPanel()
+{
+    if( _replay_widget )
+    {
+        return _replay_widget;
+    }
+    _replay_widget = new SidepanelReplay(this);
+    ui->leftFrame->layout()->addWidget( _replay_widget );
+    dynamic_cast<QVBoxLayout*>(ui->leftFrame->layout())->setStretchFactor( _replay_widget, 1 );
+
+    connect( _replay_widget, &SidepanelReplay::loadBehaviorTree,
+            this, [this](const AbsBehaviorTree &tree, const QString &bt_name)
+    {
+        onCreateAbsBehaviorTree(tree, bt_name, false);
+    });
+
+    connect( _replay_widget, &SidepanelReplay::addNewModel,
+            this, &MainWindow::onAddToModelRegistry);
+
+    connect( _replay_widget, &SidepanelReplay::changeNodeStyle,
+            this, &MainWindow::onChangeNodesStatus);
+
+    connect( _replay_widget, &SidepanelReplay::showNodesHeatmap,
+            this, &MainWindow::onShowNodesHeatmap);
+    return _replay_widget;
+}
+
+#ifdef ZMQ_FOUND
+SidepanelMonitor *MainWindow::monitorPanel()
+{
+    if( _monitor_widget )
+    {
+        return _monitor_widget;
+    }
+    // its ZMQ context and sockets too
+    _monitor_widget = new SidepanelMonitor(this);
+    ui->leftFrame->layout()->addWidget( _monitor_widget );
+
+    connect( ui->toolButtonConnect, &QToolButton::clicked,
+            _monitor_widget, &SidepanelMonitor::on_Connect );
+
+    connect( _monitor_widget, &SidepanelMonitor::connectionUpdate,
+            this, &MainWindow::onConnectionUpdate );
+
+    connect( _monitor_widget, &SidepanelMonitor::addNewModel,
+            this, &MainWindow::onAddToModelRegistry);
+
+    connect( _monitor_widget, &SidepanelMonitor::changeNodeStyle,
+            this, &MainWindow::onChangeNodesStatus);
+
+    connect( _monitor_widget, &SidepanelMonitor::loadBehaviorTree,
+            this, [this](const AbsBehaviorTree &tree, const QString &bt_name)
+    {
+        onCreateAbsBehaviorTree(tree, bt_name, false);
+    });
+    return _monitor_widget;
+}
+#endif
+
+
+// the order of the children is read from the positions, in the old layout
+static void relayoutScene(EditorFlowScene* scene, QtNodes::PortLayout layout)
+{
+    auto abstract_tree = BuildTreeFromScene( scene );
+    scene->setLayout( layout );
+    NodeReorder( *scene, abstract_tree );
+}
 
 void MainWindow::refreshNodesLayout(QtNodes::PortLayout new_layout)
 {
-    if( new_layout != _current_layout)
+    const bool changed = ( new_layout != _current_layout );
+    if( changed )
     {
         QString icon_name = ( new_layout == QtNodes::PortLayout::Horizontal ) ?
                                                                             ":/icons/BT-horizontal.png" :
@@ -1317,36 +1973,78 @@ void MainWindow::refreshNodesLayout(QtNodes::PortLayout new_layout)
         ui->toolButtonLayout->update();
     }
 
-    bool refreshed = false;
+    // only the current tab: the others are relayouted when shown, see
+    // on_tabWidget_currentChanged(), and the deferred ones when built
+    for(auto& tab: _tab_info)
     {
-        const QSignalBlocker blocker( currentTabInfo() );
-        for(auto& tab: _tab_info)
+        if( !tab.second->isMaterialized() )
         {
-            auto scene = tab.second->scene();
-            if( scene->layout() != new_layout )
-            {
-                auto abstract_tree = BuildTreeFromScene( scene );
-                scene->setLayout( new_layout );
-                NodeReorder( *scene, abstract_tree );
-                refreshed = true;
-            }
+            tab.second->setDeferredLayout( new_layout );
         }
-        on_toolButtonCenterView_pressed();
     }
     _current_layout = new_layout;
-    if(refreshed)
+
+    bool refreshed = false;
+    auto container = currentTabInfo();
+    if( container && container->isMaterialized() && container->scene()->layout() != new_layout )
+    {
+        const QSignalBlocker blocker( container );
+        relayoutScene( container->scene(), new_layout );
+        on_toolButtonCenterView_pressed();
+        refreshed = true;
+    }
+    if( changed || refreshed )
     {
+        // a single step: the layout, and the nodes of this tab
         onPushUndo();
     }
 }
 
+void MainWindow::setNestedSourceRevisions(GraphicContainer &container, QtNodes::Node &node)
+{
+    for (auto child_node: getChildren( *container.scene(), node, false ))
+    {
+        auto subtree_model = dynamic_cast<SubtreeNodeModel*>(child_node->nodeDataModel());
+        if( subtree_model && subtree_model->expanded() )
+        {
+            if( auto subtree_container = getTabByName( subtree_model->registrationName() ) )
+            {
+                subtree_model->setSourceRevision( subtree_container->revision() );
+            }
+        }
+        setNestedSourceRevisions( container, *child_node );
+    }
+}
+
 void MainWindow::refreshExpandedSubtrees()
 {
     auto container = currentTabInfo();
-    if( !container){
+    if( !container || container->isBuilding() ){
+        // a tree being built is new: its subtrees too
         return;
     }
     auto scene = container->scene();
+
+    // nothing to do unless one of the subtrees used here changed
+    bool outdated = false;
+    for (const auto& tab_it: _tab_info)
+    {
+        for (auto node: scene->nodesOfModel( tab_it.first ) )
+        {
+            auto subtree_model = dynamic_cast<SubtreeNodeModel*>(node->nodeDataModel());
+            if( subtree_model && subtree_model->expanded() &&
+                subtree_model->sourceRevision() != tab_it.second->revision() )
+            {
+                outdated = true;
+                break;
+            }
+        }
+    }
+    if( !outdated )
+    {
+        return;
+    }
+
     auto root_node = findRoot( *scene );
     if( !root_node )
     {
@@ -1385,7 +2083,12 @@ void MainWindow::refreshExpandedSubtrees()
             subTreeExpand( *container, *subtree_node, SUBTREE_COLLAPSE );
         }
 
-        subTreeExpand( *container, *subtree_node, SUBTREE_REFRESH );
+        // copied again only if the subtree changed since
+        if( subtree_model->expanded() &&
+            subtree_model->sourceRevision() != subtree_container->revision() )
+        {
+            subTreeExpand( *container, *subtree_node, SUBTREE_REFRESH );
+        }
     }
 }
 
@@ -1406,10 +2109,16 @@ void MainWindow::on_actionEditor_mode_triggered()
     updateCurrentMode();
 
 #ifdef ZMQ_FOUND
-    _monitor_widget->clear();
+    if( _monitor_widget )
+    {
+        _monitor_widget->clear();
+    }
 #endif
 
-    _replay_widget->clear();
+    if( _replay_widget )
+    {
+        _replay_widget->clear();
+    }
 }
 
 void MainWindow::on_actionMonitor_mode_triggered()
@@ -1427,7 +2136,7 @@ void MainWindow::on_actionMonitor_mode_triggered()
     if( res == QMessageBox::Ok)
     {
         currentTabInfo()->clearScene();
-        _monitor_widget->clear();
+        monitorPanel()->clear();
         _current_mode = GraphicMode::MONITOR;
         updateCurrentMode();
     }
@@ -1448,7 +2157,7 @@ void MainWindow::on_actionReplay_mode_triggered()
     if( res == QMessageBox::Ok)
     {
         onActionClearTriggered(true);
-        _replay_widget->clear();
+        replayPanel()->clear();
         _current_mode = GraphicMode::REPLAY;
         updateCurrentMode();
     }
@@ -1458,61 +2167,128 @@ void MainWindow::on_tabWidget_currentChanged(int index)
 {
     if( ui->tabWidget->count() == 0 )
     {
+        _minimap->setView( nullptr );
         return;
     }
     QString tab_name = ui->tabWidget->tabText(index);
     auto tab = getTabByName(tab_name);
+    _minimap->setView( tab ? tab->view() : nullptr );
     if( tab )
     {
         const QSignalBlocker blocker( tab );
+        if( tab->isMaterialized() && tab->scene()->layout() != _current_layout )
+        {
+            // left behind by refreshNodesLayout()
+            relayoutScene( tab->scene(), _current_layout );
+        }
         tab->nodeReorder();
-        _current_state.current_tab_name = ui->tabWidget->tabText( index );
+        _undo_current_tab = tab_name;
         refreshExpandedSubtrees();
         tab->zoomHomeView();
+        if( _current_mode != GraphicMode::EDITOR )
+        {
+            showSubtreeStatus( tab_name );
+        }
     }
 }
 
-bool MainWindow::SavedState::operator ==(const MainWindow::SavedState &other) const
+static void applyStatusStyle(QtNodes::Node* gui_node, const SharedStyle& style,
+                             RepaintScheduler& scheduler)
 {
-    if( current_tab_name != other.current_tab_name ||
-        json_states.size() != other.json_states.size())
+    gui_node->nodeDataModel()->setNodeStyle( style.first );
+    scheduler.schedule( &gui_node->nodeGraphicsObject() );
+
+    const auto& conn_in = gui_node->nodeState().connections(PortType::In, 0 );
+    if(conn_in.size() == 1)
     {
-        return false;
+        auto conn = conn_in.begin()->second;
+        conn->setStyle( style.second );
+        scheduler.schedule( &conn->connectionGraphicsObject() );
     }
-    for(auto& it: json_states  )
+}
+
+void MainWindow::resetTreeStyle(const std::vector<QtNodes::Node*>& nodes)
+{
+    const SharedStyle& style = getDefaultStyle();
+
+    for(auto gui_node: nodes)
     {
-        auto other_it = other.json_states.find(it.first);
-        if( other_it == other.json_states.end() ||
-            it.second != other_it->second)
+        // null while the tree is built
+        if( gui_node )
         {
-            return false;
+            applyStatusStyle( gui_node, style, *_repaint_scheduler );
         }
     }
-    if( view_area != other.view_area ||
-        view_transform != other.view_transform)
-    {
-        return false;
-    }
-    return true;
 }
 
-void MainWindow::resetTreeStyle(AbsBehaviorTree &tree){
-    //printf("resetTreeStyle\n");
-    QtNodes::NodeStyle  node_style;
-    QtNodes::ConnectionStyle conn_style;
+MainWindow::SubtreeStatus& MainWindow::subtreeStatus(const QString& bt_name,
+                                                    GraphicContainer* container)
+{
+    SubtreeStatus& status = _subtree_status[bt_name];
 
-    for(auto abs_node: tree.nodes()){
-        auto gui_node = abs_node.graphic_node;
+    bool valid = ( status.tree_revision == container->revision() &&
+                   status.tabs_count == _tab_info.size() );
+    for (size_t t = 0; valid && t < status.tabs.size(); t++)
+    {
+        auto tab = getTabByName( status.tabs[t].first );
+        valid = ( tab && tab->revision() == status.tabs[t].second );
+    }
+    if( valid )
+    {
+        return status;
+    }
 
-        gui_node->nodeDataModel()->setNodeStyle( node_style );
-        gui_node->nodeGraphicsObject().update();
+    // once per tree loaded, not per message
+    std::vector<AbsBehaviorTree> trees;
+    trees.reserve( _tab_info.size() );
+    status.tabs.clear();
+    for (const auto& tab_it: _tab_info)
+    {
+        // a tab never built is not shown either
+        if( tab_it.first != bt_name && tab_it.second->isMaterialized() && !tab_it.second->isBuilding() )
+        {
+            trees.push_back( BuildTreeFromScene( tab_it.second->scene() ) );
+            status.tabs.push_back( { tab_it.first, tab_it.second->revision() } );
+        }
+    }
+    std::vector<std::pair<QString, const AbsBehaviorTree*>> subtrees;
+    for (size_t t = 0; t < trees.size(); t++)
+    {
+        subtrees.push_back( { status.tabs[t].first, &trees[t] } );
+    }
+    status.nodes = MapSubtreeNodes( BuildTreeFromScene( container->scene() ), subtrees );
+    status.styles.assign( status.nodes.size(), &getDefaultStyle() );
+    status.tree_revision = container->revision();
+    status.tabs_count = _tab_info.size();
+    return status;
+}
 
-        const auto& conn_in = gui_node->nodeState().connections(PortType::In, 0 );
-        if(conn_in.size() == 1)
+void MainWindow::showSubtreeStatus(const QString &tab_name)
+{
+    for (auto& it: _subtree_status)
+    {
+        auto container = getTabByName( it.first );
+        if( !container || it.first == tab_name )
         {
-            auto conn = conn_in.begin()->second;
-            conn->setStyle( conn_style );
-            conn->connectionGraphicsObject().update();
+            continue;
+        }
+        const SubtreeStatus& status = subtreeStatus( it.first, container );
+        auto tab_it = std::find_if( status.tabs.begin(), status.tabs.end(),
+                                    [&](const std::pair<QString, unsigned>& tab)
+                                    { return tab.first == tab_name; } );
+        if( tab_it == status.tabs.end() )
+        {
+            continue;
+        }
+        const int subtree = int( tab_it - status.tabs.begin() );
+        const auto& nodes = getTabByName( tab_name )->nodesByIndex();
+        for (size_t index = 0; index < status.nodes.size(); index++)
+        {
+            const SubtreeNodeIndex& node = status.nodes[index];
+            if( node.subtree == subtree && nodes.at( size_t(node.index) ) )
+            {
+                applyStatusStyle( nodes[ size_t(node.index) ], *status.styles[index], *_repaint_scheduler );
+            }
         }
     }
 }
@@ -1520,36 +2296,94 @@ void MainWindow::resetTreeStyle(AbsBehaviorTree &tree){
 void MainWindow::onChangeNodesStatus(const QString& bt_name,
                                      const std::vector<std::pair<int, NodeStatus> > &node_status)
 {
-    auto tree = BuildTreeFromScene( getTabByName(bt_name)->scene() );
+    NODE_TRACE_SCOPE("MainWindow::onChangeNodesStatus");
 
-    std::vector<NodeStatus> vec_last_status(tree.nodesCount());
+    auto container = getTabByName(bt_name);
+    if( !container )
+    {
+        return;
+    }
+    const auto& nodes = container->nodesByIndex();
 
-    // printf("---\n");
+    // the current tab, if one of the SubTrees of this tree; the others,
+    // not visible, are updated when shown
+    SubtreeStatus* subtree_status = nullptr;
+    int current_subtree = -1;
+    const std::vector<QtNodes::Node*>* subtree_nodes = nullptr;
+    if( !container->isBuilding() )
+    {
+        subtree_status = &subtreeStatus( bt_name, container );
+        const QString current_tab = ui->tabWidget->tabText( ui->tabWidget->currentIndex() );
+        for (size_t t = 0; t < subtree_status->tabs.size(); t++)
+        {
+            if( subtree_status->tabs[t].first == current_tab )
+            {
+                current_subtree = int(t);
+                subtree_nodes = &getTabByName( current_tab )->nodesByIndex();
+            }
+        }
+    }
+
+    std::vector<NodeStatus> vec_last_status(nodes.size());
 
     for (auto& it: node_status)
     {
         const int index = it.first;
         const NodeStatus status = it.second;
-        auto& abs_node = tree.nodes().at(index);
-
-        // printf("%3d: %d, %s\n", index, (int)it.second, abs_node.instance_name.toStdString().c_str());
+        auto gui_node = nodes.at(index);
 
         if(index == 1 && it.second == NodeStatus::RUNNING)
-            resetTreeStyle(tree);
+        {
+            resetTreeStyle(nodes);
+            if( subtree_status )
+            {
+                subtree_status->styles.assign( subtree_status->styles.size(), &getDefaultStyle() );
+            }
+            if( subtree_nodes )
+            {
+                resetTreeStyle( *subtree_nodes );
+            }
+        }
+
+        if( !gui_node )
+        {
+            // not built yet: the next message has its status too
+            continue;
+        }
 
-        auto gui_node = abs_node.graphic_node;
-        auto style = getStyleFromStatus( status, vec_last_status[index] );
-        gui_node->nodeDataModel()->setNodeStyle( style.first );
-        gui_node->nodeGraphicsObject().update();
+        const SharedStyle& style = getStyleFromStatus( status, vec_last_status[index] );
+        applyStatusStyle( gui_node, style, *_repaint_scheduler );
+
+        if( subtree_status )
+        {
+            subtree_status->styles[index] = &style;
+            const SubtreeNodeIndex& subtree_node = subtree_status->nodes[index];
+            if( subtree_nodes && subtree_node.subtree == current_subtree &&
+                subtree_nodes->at( size_t(subtree_node.index) ) )
+            {
+                applyStatusStyle( (*subtree_nodes)[ size_t(subtree_node.index) ], style,
+                                  *_repaint_scheduler );
+            }
+        }
 
         vec_last_status[index] = status;
+    }
+}
+
+void MainWindow::onShowNodesHeatmap(const QString &bt_name, const std::vector<double> &values)
+{
+    auto container = getTabByName(bt_name);
+    if( !container )
+    {
+        return;
+    }
+    const auto& nodes = container->nodesByIndex();
 
-        const auto& conn_in = gui_node->nodeState().connections(PortType::In, 0 );
-        if(conn_in.size() == 1)
+    for (size_t index = 0; index < nodes.size() && index < values.size(); index++)
+    {
+        if( nodes[index] )
         {
-            auto conn = conn_in.begin()->second;
-            conn->setStyle( style.second );
-            conn->connectionGraphicsObject().update();
+            applyStatusStyle( nodes[index], getHeatmapStyle( values[index] ), *_repaint_scheduler );
         }
     }
 }
@@ -1625,7 +2459,10 @@ void MainWindow::onTabRenameRequested(int tab_index, QString new_name)
         NodeModel model = { NodeType::SUBTREE, new_name, {}};
         onAddToModelRegistry( model );
         _treenode_models.insert( { new_name, model} );
-        _editor_widget->updateTreeView();
+        if( _editor_widget )
+        {
+            _editor_widget->updateTreeView();
+        }
         this->onTreeNodeEdited(old_name, new_name);
     }
 
@@ -1667,7 +2504,10 @@ void MainWindow::clearTreeModels()
     {
         _model_registry->unregisterModel(ID);
     }
-    _editor_widget->updateTreeView();
+    if( _editor_widget )
+    {
+        _editor_widget->updateTreeView();
+    }
 }
 
 const NodeModels &MainWindow::registeredModels() const
@@ -1700,6 +2540,219 @@ void MainWindow::on_actionReportIssue_triggered()
     QDesktopServices::openUrl(QUrl(url));
 }
 
+void MainWindow::on_actionExportImage_triggered()
+{
+    GraphicContainer* container = currentTabInfo();
+    if( !container )
+    {
+        return;
+    }
+    const QString tab_name = ui->tabWidget->tabText( ui->tabWidget->currentIndex() );
+
+    QSettings settings;
+    const QString directory_path = settings.value("MainWindow.lastExportDirectory",
+                                                  QDir::currentPath() ).toString();
+    QString selected_filter;
+    QString fileName = QFileDialog::getSaveFileName( this, tr("Export the tree as an image"),
+                                                     QDir( directory_path ).filePath( tab_name ),
+                                                     tr("SVG image (*.svg);;PNG image (*.png)"),
+                                                     &selected_filter );
+    if( fileName.isEmpty() )
+    {
+        return;
+    }
+    const bool png = selected_filter.contains("png");
+    const QString suffix = png ? ".png" : ".svg";
+    if( !fileName.endsWith( suffix, Qt::CaseInsensitive ) )
+    {
+        fileName += suffix;
+    }
+    settings.setValue("MainWindow.lastExportDirectory", QFileInfo( fileName ).absolutePath() );
+
+    QApplication::setOverrideCursor( Qt::WaitCursor );
+    QStringList files;
+    QString error;
+    try {
+        const QColor background = container->view()->backgroundBrush().color();
+        if( png )
+        {
+            files = ExportScenePNG( *container->scene(), fileName, background );
+        }
+        else{
+            ExportSceneSVG( *container->scene(), fileName, background, tab_name );
+            files.push_back( fileName );
+        }
+    }
+    catch( std::exception& err )
+    {
+        error = err.what();
+    }
+    QApplication::restoreOverrideCursor();
+
+    if( !error.isEmpty() )
+    {
+        QMessageBox::warning( this, tr("Export Image"), error );
+    }
+    else if( files.size() > 1 )
+    {
+        QMessageBox::information( this, tr("Export Image"),
+                                  tr("The tree is too large for a single PNG: it was split in %1 tiles, "
+                                     "from %2 to %3.")
+                                  .arg( files.size() )
+                                  .arg( QFileInfo( files.front() ).fileName() )
+                                  .arg( QFileInfo( files.back() ).fileName() ) );
+    }
+}
+
+void MainWindow::on_actionMemoryUsage_triggered()
+{
+    auto dialog = new MemoryReportDialog( memoryReport(), this );
+    dialog->setAttribute( Qt::WA_DeleteOnClose );
+    dialog->show();
+}
+
+MemoryReport MainWindow::memoryReport()
+{
+    MemoryReport report;
+    for(const auto& tab_it: _tab_info)
+    {
+        const GraphicContainer* container = tab_it.second;
+        TabMemoryUsage tab;
+        tab.name = tab_it.first;
+        tab.materialized = container->isMaterialized();
+        if( tab.materialized )
+        {
+            const auto scene = container->scene();
+            tab.nodes = int( scene->nodes().size() );
+            tab.connections = int( scene->connections().size() );
+            for(const auto& node_it: scene->nodes())
+            {
+                tab.widgets += node_it.second->nodeGraphicsObject().proxyWidget() ? 1 : 0;
+            }
+            tab.tree_bytes = container->loadedTree().memoryUsage();
+        }
+        else{
+            const AbsBehaviorTree& tree = container->deferredTree();
+            tab.nodes = int( tree.nodesCount() );
+            tab.connections = std::max( 0, tab.nodes - 1 );
+            tab.tree_bytes = tree.memoryUsage();
+        }
+        auto snapshot_it = _undo_tabs.find( tab_it.first );
+        if( snapshot_it != _undo_tabs.end() )
+        {
+            tab.undo_snapshot_bytes = snapshot_it->second.memoryUsage();
+        }
+        report.tabs.push_back( tab );
+    }
+
+    // the changes not packed yet, by tab; the packed ones all together
+    size_t packed_steps = 0;
+    size_t packed_bytes = 0;
+    for(const auto* stack: { &_undo_stack, &_redo_stack })
+    {
+        for(const UndoStep& step: *stack)
+        {
+            if( step.isPacked() )
+            {
+                packed_steps++;
+                packed_bytes += step.memoryUsage();
+                continue;
+            }
+            for(const TabChange& change: step.tabs)
+            {
+                for(auto& tab: report.tabs)
+                {
+                    if( tab.name == change.name )
+                    {
+                        tab.undo_steps_bytes += change.memoryUsage();
+                    }
+                }
+            }
+        }
+    }
+    report.addEntry( tr("Undo: steps"), _undo_stack.size(), 0 );
+    report.addEntry( tr("Redo: steps"), _redo_stack.size(), 0 );
+    report.addEntry( tr("Undo and redo: packed steps"), packed_steps, packed_bytes );
+
+    size_t layout_bytes = 0;
+    const std::vector<CachedLayout> layouts = CachedTreeLayouts();
+    for(const auto& layout: layouts)
+    {
+        layout_bytes += layout.positions.capacity() * sizeof(QPointF) +
+                        layout.snapshot.sizes.capacity() * sizeof(QSizeF);
+        for(const auto& children: layout.snapshot.children)
+        {
+            layout_bytes += sizeof(children) + children.capacity() * sizeof(int);
+        }
+    }
+    report.addEntry( tr("Cache: tree layouts"), layouts.size(), layout_bytes );
+
+    int included_files = 0;
+    qint64 included_bytes = 0;
+    IncludedFilesCacheUsage( included_files, included_bytes );
+    // the parsed content is about as large as the text, in UTF-16
+    report.addEntry( tr("Cache: included files"), size_t( included_files ), size_t( included_bytes ) * 2 );
+
+    if( _replay_widget )
+    {
+        _replay_widget->addMemoryUsage( report );
+    }
+#ifdef ZMQ_FOUND
+    if( _monitor_widget )
+    {
+        _monitor_widget->addMemoryUsage( report );
+    }
+#endif
+    return report;
+}
+
+void MainWindow::on_actionNodeShadows_toggled(bool enabled)
+{
+    QtNodes::NodeStyle::setShadowsEnabled( enabled );
+    QSettings settings;
+    settings.setValue("MainWindow.nodeShadows", enabled);
+
+    // the nodes are cached as pixmaps: each one must be repainted
+    for(auto& tab_it: _tab_info)
+    {
+        if( !tab_it.second->isMaterialized() )
+        {
+            continue;
+        }
+        for(auto& node_it: tab_it.second->scene()->nodes())
+        {
+            node_it.second->nodeGraphicsObject().update();
+        }
+    }
+}
+
+void MainWindow::on_actionOpenGLViewport_toggled(bool enabled)
+{
+    QSettings settings;
+    settings.setValue("MainWindow.openGLViewport", enabled);
+
+    for(auto& tab_it: _tab_info)
+    {
+        tab_it.second->view()->setOpenGLViewport( enabled );
+    }
+}
+
+// not saved: it is shown to look into a slowdown, not to stay
+void MainWindow::on_actionPerformanceOverlay_toggled(bool enabled)
+{
+    for(auto& tab_it: _tab_info)
+    {
+        tab_it.second->view()->setPerformanceHudVisible( enabled );
+    }
+}
+
+void MainWindow::on_actionAnimateLayout_toggled(bool enabled)
+{
+    QSettings settings;
+    settings.setValue("MainWindow.animateLayout", enabled);
+    GraphicContainer::setAnimatedLayout( enabled );
+}
+
 // returns the current graphic mode
 GraphicMode MainWindow::getGraphicMode(void) const
 {
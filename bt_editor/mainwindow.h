@@ -7,13 +7,20 @@
 #include <QTreeWidgetItem>
 #include <QShortcut>
 #include <QTimer>
+#include <QLockFile>
 #include <deque>
 #include <thread>
 #include <mutex>
 #include <nodes/DataModelRegistry>
 
 #include "graphic_container.h"
+#include "repaint_scheduler.h"
+#include "undo_history.h"
+#include "autosave.h"
+#include "port_value_dialog.h"
+#include "memory_report.h"
 #include "XML_utilities.hpp"
+#include "utils.h"
 #include "sidepanel_editor.h"
 #include "sidepanel_replay.h"
 #include "models/SubtreeNodeModel.hpp"
@@ -22,6 +29,9 @@
 #include "sidepanel_monitor.h"
 #endif
 
+class QProgressBar;
+class QToolButton;
+
 namespace Ui {
 class MainWindow;
 }
@@ -29,6 +39,7 @@ class MainWindow;
 namespace QtNodes{
 class FlowView;
 class FlowScene;
+class FlowMinimap;
 class Node;
 }
 
@@ -45,7 +56,12 @@ public:
     explicit MainWindow(GraphicMode initial_mode, QWidget *parent = nullptr);
     ~MainWindow() override;
 
-    void loadFromXML(const QString &xml_text);
+    // the relative <include> are looked for in "directory", or in the
+    // current one
+    void loadFromXML(const QString &xml_text, const QString &directory = QString());
+
+    // a tree in the editor, a log (or a directory of logs) in the replay
+    void openFile(const QString& path);
 
     QString saveToXML() const ;
 
@@ -57,7 +73,7 @@ public:
 
     const NodeModels &registeredModels() const;
 
-    void resetTreeStyle(AbsBehaviorTree &tree);
+    void resetTreeStyle(const std::vector<QtNodes::Node*>& nodes);
 
     GraphicMode getGraphicMode(void) const;
 
@@ -80,6 +96,9 @@ public slots:
 
     void onAddToModelRegistry(const NodeModel& model);
 
+    // the palette is updated once, after all of them
+    void onAddModelsToRegistry(const NodeModels& models);
+
     void onDestroySubTree(const QString &ID);
 
     void onModelRemoveRequested(QString ID);
@@ -96,12 +115,19 @@ public slots:
 
     void on_toolButtonCenterView_pressed();
 
+    // selects and centers the next node matching a text, in any tab
+    void onFindNode();
+
     void onCreateAbsBehaviorTree(const AbsBehaviorTree &tree,
                                  const QString &bt_name,
-                                 bool secondary_tabs = true);
+                                 bool secondary_tabs = true,
+                                 bool deferred = false);
 
     void onChangeNodesStatus(const QString& bt_name, const std::vector<std::pair<int, NodeStatus>>& node_status);
 
+    // color the nodes by value, in [0, 1], instead of by status
+    void onShowNodesHeatmap(const QString& bt_name, const std::vector<double>& values);
+
     void on_toolButtonLayout_clicked();
 
     void on_actionEditor_mode_triggered();
@@ -132,14 +158,42 @@ private slots:
 
     void on_actionReportIssue_triggered();
 
+    void on_actionMemoryUsage_triggered();
+
+    void on_actionExportImage_triggered();
+
+    void on_actionNodeShadows_toggled(bool enabled);
+
+    void on_actionOpenGLViewport_toggled(bool enabled);
+
+    void on_actionPerformanceOverlay_toggled(bool enabled);
+
+    void on_actionAnimateLayout_toggled(bool enabled);
+
+    void on_actionPortValueUsers_triggered();
+
+    void on_actionAutosave_triggered();
+
 public:
 
+    // offers to load the last autosave, if Groot did not close properly
+    void recoverAutosave();
+
     void lockEditing(const bool locked);
 
 private:
 
     void updateCurrentMode();
 
+    // the side panels are created the first time their mode is used
+    SidepanelEditor* editorPanel();
+
+    SidepanelReplay* replayPanel();
+
+#ifdef ZMQ_FOUND
+    SidepanelMonitor* monitorPanel();
+#endif
+
     bool eventFilter(QObject *obj, QEvent *event) override;
 
     void resizeEvent(QResizeEvent *) override;
@@ -150,29 +204,63 @@ private:
 
     void refreshExpandedSubtrees();
 
-    void streamElementAttributes(QXmlStreamWriter &stream, const QDomElement &element) const;
+    // The statuses of a tree of the monitor or of the replay, received by
+    // onChangeNodesStatus(), shown in the tabs of its SubTrees too.
+    struct SubtreeStatus
+    {
+        std::vector<SubtreeNodeIndex> nodes;
+        // the tabs in "nodes", with the revision they are mapped from
+        std::vector<std::pair<QString, unsigned>> tabs;
+        unsigned tree_revision = 0;
+        size_t tabs_count = 0;
+        // the last one of each node of the tree
+        std::vector<const SharedStyle*> styles;
+    };
 
-    QString xmlDocumentToString(const QDomDocument &document) const;
+    // mapped again when one of the tabs changes
+    SubtreeStatus& subtreeStatus(const QString& bt_name, GraphicContainer* container);
 
-    void recursivelySaveNodeCanonically(QXmlStreamWriter &stream, const QDomNode &parent_node) const;
+    // the styles of "tab", as SubTree of the trees of onChangeNodesStatus()
+    void showSubtreeStatus(const QString& tab_name);
 
-    struct SavedState
-    {
-        QString main_tree;
-        QString current_tab_name;
-        QTransform view_transform;
-        QRectF view_area;
-        std::map<QString, QByteArray> json_states;
-        bool operator ==( const SavedState& other) const;
-        bool operator !=( const SavedState& other) const { return !( *this == other); }
-    };
+    // the canonical XML of all the trees and the models, in a single pass
+    void writeXML(QXmlStreamWriter &stream) const;
+
+    // the changes since the last step recorded, that become the new state
+    // of the undo history
+    UndoStep collectUndoStep();
+
+    // the tabs must be in the "before" state of the step
+    void applyUndoStep(const UndoStep& step);
+
+    // goes back to the last step recorded
+    void discardPendingChanges();
+
+    // the old steps are packed, and the oldest removed beyond the budget
+    void pushUndoStep(UndoStep step);
+
+    UndoStep popUndoStep();
 
-    void loadSavedStateFromJson(SavedState state);
+    // the tabs modified since the last autosave are copied, and written on
+    // another thread
+    void onAutosave();
+
+    // seconds, 0 to disable it
+    void setAutosaveInterval(int seconds);
+
+    void markTabsForAutosave(const UndoStep& step);
+
+    // without updating the palette
+    void registerModel(const NodeModel& model);
 
     QtNodes::Node *subTreeExpand(GraphicContainer& container,
                        QtNodes::Node &node,
                        SubtreeExpandOption option);
 
+    // The expanded subtrees nested in the copy below "node" are created
+    // without a source revision: the current one of their tabs.
+    void setNestedSourceRevisions(GraphicContainer& container, QtNodes::Node& node);
+
     Ui::MainWindow *ui;
 
     GraphicMode _current_mode;
@@ -183,23 +271,73 @@ private:
 
     std::mutex _mutex;
 
-    std::deque<SavedState> _undo_stack;
-    std::deque<SavedState> _redo_stack;
-    SavedState _current_state;
+    std::deque<UndoStep> _undo_stack;
+    std::deque<UndoStep> _redo_stack;
+    // the tabs, as of the last step recorded
+    std::map<QString, TabSnapshot> _undo_tabs;
+    QString _undo_main_tree;
+    QString _undo_current_tab;
+    QtNodes::PortLayout _undo_layout;
+    size_t _undo_steps_recorded;
+    // bytes of the packed steps in _undo_stack
+    size_t _undo_packed_bytes;
+    size_t _undo_budget;
+    bool _applying_undo;
     QtNodes::PortLayout _current_layout;
 
     NodeModels _treenode_models;
 
     QString _main_tree;
 
+    RepaintScheduler* _repaint_scheduler;
+
+    std::map<QString, SubtreeStatus> _subtree_status;
+
+    // docked, follows the current tab
+    QtNodes::FlowMinimap* _minimap;
+
+    // the trees built by GraphicContainer::loadSceneProgressively()
+    QProgressBar* _build_progress;
+    QToolButton* _build_cancel;
+
+    // the matches of the last "Find Node", as tab and node
+    QString _find_query;
+    std::vector<std::pair<QString, QUuid>> _find_matches;
+    size_t _find_next;
+
+    QString _last_highlighted_value;
+
+    // the project loaded last, see project_cache.h
+    QByteArray _project_cache_key;
+
+    QTimer* _autosave_timer;
+    // null if another instance of Groot autosaves
+    std::unique_ptr<QLockFile> _autosave_lock;
+    AutosaveWriter* _autosave_writer;
+    // the last one written: its trees are replaced when modified
+    AutosaveSnapshot _autosave_snapshot;
+    std::set<QString> _autosave_dirty_tabs;
+    bool _autosave_needed;
+    // the last autosave failed, and it was shown in the status bar
+    bool _autosave_failed;
+
+    // null until their mode is used
     SidepanelEditor* _editor_widget;
     SidepanelReplay* _replay_widget;
 #ifdef ZMQ_FOUND
     SidepanelMonitor* _monitor_widget;
 #endif
     
-    MainWindow::SavedState saveCurrentState();
     void clearUndoStacks();
+
+    std::vector<std::pair<QString, QUuid>> findNodes(const QString& query);
+
+    // switches to the tab and centers the node; false if it does not exist
+    bool showNode(const QString& tab_name, const QUuid& node_id);
+
+    std::vector<PortValueUser> findPortValueUsers(const QString& value);
+
+    MemoryReport memoryReport();
 };
 
 
@@ -0,0 +1,167 @@
+#include "memory_report.h"
+#include <QApplication>
+#include <QClipboard>
+#include <QDialogButtonBox>
+#include <QHeaderView>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QLabel>
+#include <QPushButton>
+#include <QSortFilterProxyModel>
+#include <QStandardItemModel>
+#include <QTableView>
+#include <QVBoxLayout>
+
+namespace {
+
+enum TabColumn { TAB, NODES, CONNECTIONS, WIDGETS, TREE, UNDO_SNAPSHOT, UNDO_STEPS, TAB_COLUMNS };
+
+enum EntryColumn { ENTRY, COUNT, BYTES, ENTRY_COLUMNS };
+
+QString formatBytes(size_t bytes)
+{
+    if( bytes < 10 * 1024 )
+    {
+        return QString("%1 B").arg( bytes );
+    }
+    if( bytes < 10 * 1024 * 1024 )
+    {
+        return QString("%1 KB").arg( bytes / 1024 );
+    }
+    return QString("%1 MB").arg( double(bytes) / ( 1024 * 1024 ), 0, 'f', 1 );
+}
+
+// displayed formatted, sorted by value
+QStandardItem* bytesItem(size_t bytes)
+{
+    auto item = new QStandardItem( formatBytes( bytes ) );
+    item->setData( double(bytes), Qt::UserRole );
+    item->setTextAlignment( Qt::AlignRight | Qt::AlignVCenter );
+    return item;
+}
+
+QStandardItem* countItem(size_t count)
+{
+    auto item = new QStandardItem( QString::number( count ) );
+    item->setData( double(count), Qt::UserRole );
+    item->setTextAlignment( Qt::AlignRight | Qt::AlignVCenter );
+    return item;
+}
+
+QTableView* createTable(QStandardItemModel* model, int stretch_column, QWidget* parent)
+{
+    auto proxy = new QSortFilterProxyModel( parent );
+    proxy->setSourceModel( model );
+    proxy->setSortRole( Qt::UserRole );
+
+    auto table = new QTableView( parent );
+    table->setModel( proxy );
+    table->setSortingEnabled( true );
+    table->setEditTriggers( QAbstractItemView::NoEditTriggers );
+    table->setSelectionBehavior( QAbstractItemView::SelectRows );
+    table->verticalHeader()->setVisible( false );
+    table->horizontalHeader()->setSectionResizeMode( stretch_column, QHeaderView::Stretch );
+    return table;
+}
+
+} // end anonymous namespace
+
+size_t MemoryReport::totalBytes() const
+{
+    size_t bytes = 0;
+    for (const auto& tab: tabs)
+    {
+        bytes += tab.tree_bytes + tab.undo_snapshot_bytes + tab.undo_steps_bytes;
+    }
+    for (const auto& entry: entries)
+    {
+        bytes += entry.bytes;
+    }
+    return bytes;
+}
+
+QJsonDocument MemoryReport::toJson() const
+{
+    QJsonArray tabs_json;
+    for (const auto& tab: tabs)
+    {
+        QJsonObject json;
+        json["name"] = tab.name;
+        json["materialized"] = tab.materialized;
+        json["nodes"] = tab.nodes;
+        json["connections"] = tab.connections;
+        json["widgets"] = tab.widgets;
+        json["tree_bytes"] = double( tab.tree_bytes );
+        json["undo_snapshot_bytes"] = double( tab.undo_snapshot_bytes );
+        json["undo_steps_bytes"] = double( tab.undo_steps_bytes );
+        tabs_json.append( json );
+    }
+    QJsonArray entries_json;
+    for (const auto& entry: entries)
+    {
+        QJsonObject json;
+        json["name"] = entry.name;
+        json["count"] = double( entry.count );
+        json["bytes"] = double( entry.bytes );
+        entries_json.append( json );
+    }
+    QJsonObject root;
+    root["tabs"] = tabs_json;
+    root["entries"] = entries_json;
+    root["total_bytes"] = double( totalBytes() );
+    return QJsonDocument( root );
+}
+
+MemoryReportDialog::MemoryReportDialog(const MemoryReport &report, QWidget *parent):
+    QDialog(parent)
+{
+    setWindowTitle( tr("Memory Usage") );
+    resize( 800, 500 );
+
+    auto tabs_model = new QStandardItemModel( 0, TAB_COLUMNS, this );
+    tabs_model->setHorizontalHeaderLabels( { tr("Tab"), tr("Nodes"), tr("Connections"),
+                                             tr("Widgets"), tr("Tree"), tr("Undo State"),
+                                             tr("Undo Steps") } );
+    for (const auto& tab: report.tabs)
+    {
+        auto name = new QStandardItem( tab.materialized ? tab.name : tr("%1 (not built)").arg( tab.name ) );
+        name->setData( tab.name, Qt::UserRole );
+        tabs_model->appendRow( { name,
+                                 countItem( size_t(tab.nodes) ),
+                                 countItem( size_t(tab.connections) ),
+                                 countItem( size_t(tab.widgets) ),
+                                 bytesItem( tab.tree_bytes ),
+                                 bytesItem( tab.undo_snapshot_bytes ),
+                                 bytesItem( tab.undo_steps_bytes ) } );
+    }
+
+    auto entries_model = new QStandardItemModel( 0, ENTRY_COLUMNS, this );
+    entries_model->setHorizontalHeaderLabels( { tr("Other"), tr("Count"), tr("Size") } );
+    for (const auto& entry: report.entries)
+    {
+        auto name = new QStandardItem( entry.name );
+        name->setData( entry.name, Qt::UserRole );
+        entries_model->appendRow( { name, countItem( entry.count ), bytesItem( entry.bytes ) } );
+    }
+
+    auto tabs_table = createTable( tabs_model, TAB, this );
+    tabs_table->sortByColumn( TREE, Qt::DescendingOrder );
+    auto entries_table = createTable( entries_model, ENTRY, this );
+    entries_table->sortByColumn( BYTES, Qt::DescendingOrder );
+
+    auto buttons = new QDialogButtonBox( QDialogButtonBox::Close, this );
+    auto copy_button = buttons->addButton( tr("Copy as JSON"), QDialogButtonBox::ActionRole );
+    const QByteArray json = report.toJson().toJson();
+    connect( copy_button, &QPushButton::clicked, this, [json]()
+    {
+        QApplication::clipboard()->setText( QString::fromUtf8( json ) );
+    } );
+    connect( buttons, &QDialogButtonBox::rejected, this, &QDialog::reject );
+
+    auto layout = new QVBoxLayout( this );
+    layout->addWidget( new QLabel( tr("About %1 in total; estimates, without the memory of Qt.")
+                                   .arg( formatBytes( report.totalBytes() ) ), this ) );
+    layout->addWidget( tabs_table, 2 );
+    layout->addWidget( entries_table, 1 );
+    layout->addWidget( buttons );
+}
@@ -0,0 +1,64 @@
+#ifndef MEMORY_REPORT_H
+#define MEMORY_REPORT_H
+
+#include <QDialog>
+#include <QJsonDocument>
+#include <QString>
+#include <vector>
+
+// What the large structures of Groot use, to find where the memory of a
+// process goes. The bytes are estimates: the allocator overhead and the
+// memory of Qt itself are not counted.
+
+struct TabMemoryUsage
+{
+    QString name;
+    // false if the scene is not built yet: all of its nodes are in "tree_bytes"
+    bool materialized = true;
+    int nodes = 0;
+    int connections = 0;
+    // the embedded widgets created, one per node that has one
+    int widgets = 0;
+    // the AbsBehaviorTree of the tab: the deferred one, or as built from the scene
+    size_t tree_bytes = 0;
+    // the state of the tab kept by the undo history
+    size_t undo_snapshot_bytes = 0;
+    // the changes of the tab in the steps of the undo and redo stacks that
+    // are not packed
+    size_t undo_steps_bytes = 0;
+};
+
+// Anything else: a stack, a cache, a log.
+struct MemoryUsageEntry
+{
+    QString name;
+    // items of the entry, as steps or trees
+    size_t count = 0;
+    size_t bytes = 0;
+};
+
+struct MemoryReport
+{
+    std::vector<TabMemoryUsage> tabs;
+    std::vector<MemoryUsageEntry> entries;
+
+    void addEntry(const QString& name, size_t count, size_t bytes)
+    {
+        entries.push_back( { name, count, bytes } );
+    }
+
+    size_t totalBytes() const;
+
+    QJsonDocument toJson() const;
+};
+
+// The tables of a report, that can be copied as JSON.
+class MemoryReportDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    MemoryReportDialog(const MemoryReport& report, QWidget* parent = nullptr);
+};
+
+#endif // MEMORY_REPORT_H
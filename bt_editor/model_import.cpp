@@ -0,0 +1,63 @@
+#include "model_import.h"
+#include "tree_files.h"
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+NodeModels ReadSkillsModels(const QByteArray &json)
+{
+    QJsonParseError parse_error;
+    const QJsonDocument document = QJsonDocument::fromJson( json, &parse_error );
+    if( !document.isArray() )
+    {
+        throw std::runtime_error( QString("Error parsing JSON: %1")
+                                  .arg( parse_error.errorString() ).toStdString() );
+    }
+
+    NodeModels models;
+    for (const QJsonValue& value: document.array())
+    {
+        const QJsonObject skill = value.toObject()["skill"].toObject();
+        NodeModel model;
+        model.type = NodeType::ACTION;
+        model.registration_ID = skill["name"].toString();
+        if( model.registration_ID.isEmpty() )
+        {
+            continue;
+        }
+
+        auto addPorts = [&model](const QJsonObject& attributes, PortDirection direction)
+        {
+            for (auto it = attributes.begin(); it != attributes.end(); ++it)
+            {
+                PortModel port;
+                port.direction = direction;
+                port.type_name = it.value().toString();
+                model.ports.insert( { it.key(), std::move(port) } );
+            }
+        };
+        addPorts( skill["inAttribute"].toObject(), PortDirection::INPUT );
+        addPorts( skill["outAttribute"].toObject(), PortDirection::OUTPUT );
+
+        models.insert( { model.registration_ID, std::move(model) } );
+    }
+    return models;
+}
+
+ModelImportWorker::ModelImportWorker(QString file_name, QObject *parent):
+    QThread(parent),
+    _file_name( std::move(file_name) )
+{
+}
+
+void ModelImportWorker::run()
+{
+    try {
+        _models = ReadPaletteFile( _file_name );
+    }
+    catch( std::exception& err )
+    {
+        _error = err.what();
+        _models.clear();
+    }
+}
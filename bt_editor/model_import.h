@@ -0,0 +1,34 @@
+#ifndef MODEL_IMPORT_H
+#define MODEL_IMPORT_H
+
+#include <QThread>
+#include "bt_editor_base.h"
+
+// The models of a .skills.json catalogue: an Action for each skill, with
+// its attributes as ports. Throws std::runtime_error.
+NodeModels ReadSkillsModels(const QByteArray& json);
+
+// Reads the models of a file, XML or .skills.json, without blocking the
+// GUI; they are available when the thread has finished.
+class ModelImportWorker : public QThread
+{
+    Q_OBJECT
+
+public:
+    ModelImportWorker(QString file_name, QObject* parent = nullptr);
+
+    const NodeModels& models() const { return _models; }
+
+    // empty if the file was read
+    const QString& error() const { return _error; }
+
+protected:
+    void run() override;
+
+private:
+    QString _file_name;
+    NodeModels _models;
+    QString _error;
+};
+
+#endif // MODEL_IMPORT_H
@@ -9,21 +9,350 @@
 #include <QFont>
 #include <QApplication>
 #include <QJsonDocument>
+#include <QPainter>
+#include <QHash>
+#include <QSvgRenderer>
+#include <QCoreApplication>
+#include <cmath>
+#include "bt_editor/tree_clipboard.h"
 
 const int MARGIN = 10;
 const int DEFAULT_LINE_WIDTH  = 100;
 const int DEFAULT_FIELD_WIDTH = 50;
 const int DEFAULT_LABEL_WIDTH = 50;
 
+namespace {
+
+// the sizes of the widgets, when painted
+const int CAPTION_HEIGHT = 20;
+const int ICON_WIDTH = 21;
+const int ROWS_SPACING = 2;
+const int COLUMNS_SPACING = 4;
+const int LINE_EDIT_PADDING = 6;
+
+// the hidden nodes in save(), see EncodeClipboard()
+const char* COLLAPSED_KEY = "collapsed_branch";
+
+bool painted_mode = false;
+
+// The widths are measured again at each resize of a node, the texts rarely
+// change: cached by font.
+int textWidth(const QFont& font, const QString& text)
+{
+    static QHash<QString, QHash<QString, int>> widths;
+    const int MAX_WIDTHS_PER_FONT = 16384;
+
+    QHash<QString, int>& font_widths = widths[ font.key() ];
+    auto it = font_widths.find( text );
+    if( it != font_widths.end() )
+    {
+        return it.value();
+    }
+    if( font_widths.size() >= MAX_WIDTHS_PER_FONT )
+    {
+        font_widths.clear();
+    }
+    const int width = QFontMetrics( font ).boundingRect( text ).width();
+    font_widths.insert( text, width );
+    return width;
+}
+
+QStaticText staticText(const QString& text)
+{
+    QStaticText static_text( text );
+    static_text.setTextFormat( Qt::PlainText );
+    static_text.setPerformanceHint( QStaticText::AggressiveCaching );
+    return static_text;
+}
+
+// centered vertically in a row starting at "y"
+void drawStaticText(QPainter* painter, qreal x, qreal y, int row_height, const QStaticText& text)
+{
+    painter->drawStaticText( QPointF( x, y + ( row_height - text.size().height() ) * 0.5 ), text );
+}
+
+class BehaviorTreeNodePainter: public QtNodes::NodePainterDelegate
+{
+public:
+    void paint(QPainter* painter,
+               QtNodes::NodeGeometry const& geom,
+               QtNodes::NodeDataModel const* model) override
+    {
+        if( auto bt_model = dynamic_cast<const BehaviorTreeDataModel*>(model) )
+        {
+            bt_model->paintContent( painter, geom.widgetPosition() );
+        }
+    }
+};
+
+QFont captionFont()
+{
+    QFont font;
+    font.setPointSize(12);
+    return font;
+}
+
+// what NodesStyle.json defines for a type of node or a registration ID
+struct CaptionStyle
+{
+    bool has_icon = false;
+    bool has_color = false;
+    bool has_alias = false;
+    QString icon;
+    QColor color;
+    QString alias;
+};
+
+typedef QHash<QString, CaptionStyle> CaptionStyles;
+
+CaptionStyles& captionStyles()
+{
+    static CaptionStyles styles;
+    return styles;
+}
+
+bool styles_loaded = false;
+
+// The icons are shared by many nodes: each one is parsed once per tint, and
+// rasterized once per size, so that painting an icon is a blit.
+QPixmap iconPixmap(const QString& path, const QColor& tint, int pixel_size, qreal pixel_ratio)
+{
+    static QHash<QString, std::shared_ptr<QSvgRenderer>> renderers;
+    static QHash<QString, QPixmap> pixmaps;
+    // every zoom level of the painted nodes has its own size
+    const int MAX_PIXMAPS = 256;
+
+    const QString renderer_key = path + '|' + tint.name();
+    const QString pixmap_key = QString("%1|%2|%3").arg(renderer_key).arg(pixel_size).arg(pixel_ratio);
+
+    auto pixmap_it = pixmaps.find( pixmap_key );
+    if( pixmap_it != pixmaps.end() )
+    {
+        return pixmap_it.value();
+    }
+
+    auto renderer_it = renderers.find( renderer_key );
+    if( renderer_it == renderers.end() )
+    {
+        std::shared_ptr<QSvgRenderer> renderer;
+        QFile file(path);
+        if(!file.open(QIODevice::ReadOnly))
+        {
+            qDebug()<<"file not opened: "<< path;
+        }
+        else {
+            QByteArray ba = file.readAll();
+            QByteArray new_color_fill = QString("fill:%1;").arg( tint.name() ).toUtf8();
+            ba.replace("fill:#ffffff;", new_color_fill);
+            renderer = std::make_shared<QSvgRenderer>(ba);
+        }
+        renderer_it = renderers.insert( renderer_key, renderer );
+    }
+    if( !renderer_it.value() || pixel_size <= 0 )
+    {
+        return QPixmap();
+    }
+
+    const int side = qRound( pixel_size * pixel_ratio );
+    QImage image( side, side, QImage::Format_ARGB32_Premultiplied );
+    image.fill( Qt::transparent );
+    {
+        QPainter painter( &image );
+        renderer_it.value()->render( &painter );
+    }
+    QPixmap pixmap = QPixmap::fromImage( image );
+    pixmap.setDevicePixelRatio( pixel_ratio );
+
+    if( pixmaps.size() >= MAX_PIXMAPS )
+    {
+        pixmaps.clear();
+    }
+    pixmaps.insert( pixmap_key, pixmap );
+    return pixmap;
+}
+
+// Shared by the widgets of all the nodes. Unlike the style sheets, the
+// palettes are not parsed, nor polished again for every widget.
+struct NodePalettes
+{
+    QPalette name;
+    QPalette params;
+    QPalette field;
+    QPalette field_highlighted;
+};
+
+const NodePalettes& nodePalettes()
+{
+    static std::unique_ptr<NodePalettes> palettes;
+    if( !palettes )
+    {
+        palettes.reset( new NodePalettes );
+        const QPalette base = QApplication::palette();
+
+        palettes->name = base;
+        palettes->name.setColor( QPalette::Text, Qt::white );
+        palettes->name.setColor( QPalette::Base, Qt::transparent );
+
+        palettes->params = base;
+        palettes->params.setColor( QPalette::WindowText, Qt::white );
+
+        palettes->field = base;
+        palettes->field.setColor( QPalette::Text, QColor(30,30,30) );
+        palettes->field.setColor( QPalette::Base, QColor(200,200,200) );
+
+        palettes->field_highlighted = palettes->field;
+        palettes->field_highlighted.setColor( QPalette::Base, QColor(0xff,0xef,0x0b) );
+    }
+    return *palettes;
+}
+
+// the widgets taken back by BehaviorTreeDataModel::releaseWidgets()
+struct PooledWidgets
+{
+    QFrame* main_widget;
+    QFrame* params_widget;
+    QLineEdit* line_edit_name;
+    std::map<QString, QWidget*> ports_widgets;
+    QFormLayout* form_layout;
+    QVBoxLayout* main_layout;
+    QLabel* caption_label;
+    QFrame* caption_logo_left;
+    QFrame* caption_logo_right;
+};
+
+// per model: enough for the nodes scrolled out of the view and in again
+const size_t WIDGETS_POOL_SIZE = 16;
+
+typedef std::map<QString, std::vector<PooledWidgets>> WidgetsPool;
+
+WidgetsPool& widgetsPoolStorage()
+{
+    static WidgetsPool pool;
+    return pool;
+}
+
+// while the application is still there
+void clearWidgetsPool()
+{
+    for (auto& it: widgetsPoolStorage())
+    {
+        for (auto& widgets: it.second)
+        {
+            delete widgets.main_widget;
+        }
+    }
+    widgetsPoolStorage().clear();
+}
+
+WidgetsPool& widgetsPool()
+{
+    static bool registered = false;
+    if( !registered )
+    {
+        qAddPostRoutine( clearWidgetsPool );
+        registered = true;
+    }
+    return widgetsPoolStorage();
+}
+
+} // end anonymous namespace
+
+struct BehaviorTreeDataModel::Prototype
+{
+    // to know when the model changes
+    PortModels ports;
+    std::vector<std::pair<QString,QString>> port_rows;
+    // the tooltips of the rows
+    std::vector<QString> descriptions;
+    PortsMapping default_values;
+    // the labels of the rows, shared by the painted nodes
+    std::vector<QStaticText> label_texts;
+};
+
+std::shared_ptr<const BehaviorTreeDataModel::Prototype>
+BehaviorTreeDataModel::prototype(const NodeModel &model)
+{
+    static QHash<QString, std::shared_ptr<const Prototype>> prototypes;
+
+    auto it = prototypes.find( model.registration_ID );
+    if( it != prototypes.end() && it.value()->ports.isSharedWith( model.ports ) )
+    {
+        return it.value();
+    }
+
+    auto proto = std::make_shared<Prototype>();
+    proto->ports = model.ports;
+
+    PortDirection preferred_port_types[3] = { PortDirection::INPUT,
+                                              PortDirection::OUTPUT,
+                                              PortDirection::INOUT};
+
+    for(int pref_index=0; pref_index < 3; pref_index++)
+    {
+        for(const auto& port_it: model.ports )
+        {
+            auto preferred_direction = preferred_port_types[pref_index];
+            if( port_it.second.direction != preferred_direction )
+            {
+                continue;
+            }
+            QString label = port_it.first;
+            QString description = port_it.second.description;
+            if( preferred_direction == PortDirection::INPUT)
+            {
+                label.prepend("[IN] ");
+                description = description.isEmpty() ? QString("[INPUT]") :
+                                                      description.prepend("[INPUT]: ");
+            }
+            else if( preferred_direction == PortDirection::OUTPUT){
+                label.prepend("[OUT] ");
+                description = description.isEmpty() ? QString("[OUTPUT]") :
+                                                      description.prepend("[OUTPUT]: ");
+            }
+            proto->port_rows.push_back( std::make_pair( port_it.first, label ) );
+            proto->descriptions.push_back( description );
+            proto->label_texts.push_back( staticText( label ) );
+            proto->default_values[ port_it.first ] = port_it.second.default_value;
+        }
+    }
+    // the models of the same ID, modified, replace it
+    prototypes.insert( model.registration_ID, proto );
+    return proto;
+}
+
 BehaviorTreeDataModel::BehaviorTreeDataModel(const NodeModel &model):
+    _main_widget(nullptr),
     _params_widget(nullptr),
+    _line_edit_name(nullptr),
     _uid( GetUID() ),
+    _form_layout(nullptr),
+    _main_layout(nullptr),
+    _caption_label(nullptr),
+    _caption_logo_left(nullptr),
+    _caption_logo_right(nullptr),
+    _keep_widgets(false),
     _model(model),
-    _icon_renderer(nullptr),
+    _locked(false),
+    _label_column_width(0),
+    _field_column_width(0),
+    _painted_texts_valid(false),
     _style_caption_color( QtNodes::NodeStyle().FontColor ),
     _style_caption_alias( model.registration_ID )
 {
     readStyle();
+
+    _prototype = prototype( _model );
+    _port_rows = _prototype->port_rows;
+    _port_values = _prototype->default_values;
+
+    if( !painted_mode )
+    {
+        buildWidgets();
+    }
+}
+
+void BehaviorTreeDataModel::buildWidgets()
+{
     _main_widget = new QFrame();
     _line_edit_name = new QLineEdit(_main_widget);
     _params_widget = new QFrame();
@@ -40,8 +369,6 @@ BehaviorTreeDataModel::BehaviorTreeDataModel(const NodeModel &model):
     _caption_logo_right->setFixedSize( QSize(0,20) );
     _caption_label->setFixedHeight(20);
 
-    _caption_logo_left->installEventFilter(this);
-
     QFont capt_font = _caption_label->font();
     capt_font.setPointSize(12);
     _caption_label->setFont(capt_font);
@@ -58,107 +385,46 @@ BehaviorTreeDataModel::BehaviorTreeDataModel(const NodeModel &model):
 
     //----------------------------
     _line_edit_name->setAlignment( Qt::AlignCenter );
-    _line_edit_name->setText( _instance_name );
     _line_edit_name->setFixedWidth( DEFAULT_LINE_WIDTH );
 
     _main_widget->setAttribute(Qt::WA_NoSystemBackground);
 
-    _line_edit_name->setStyleSheet("color: white; "
-                                   "background-color: transparent;"
-                                   "border: 0px;");
+    const NodePalettes& palettes = nodePalettes();
+    _line_edit_name->setFrame( false );
+    _line_edit_name->setPalette( palettes.name );
 
     //--------------------------------------
     _form_layout = new QFormLayout( _params_widget );
     _form_layout->setFieldGrowthPolicy(QFormLayout::ExpandingFieldsGrow);
 
     _main_layout->addWidget(_params_widget);
-    _params_widget->setStyleSheet("color: white;");
+    // inherited by the labels
+    _params_widget->setPalette( palettes.params );
 
     _form_layout->setHorizontalSpacing(4);
     _form_layout->setVerticalSpacing(2);
     _form_layout->setContentsMargins(0, 0, 0, 0);
 
-    PortDirection preferred_port_types[3] = { PortDirection::INPUT,
-                                              PortDirection::OUTPUT,
-                                              PortDirection::INOUT};
-
-    for(int pref_index=0; pref_index < 3; pref_index++)
+    for(size_t row = 0; row < _port_rows.size(); row++ )
     {
-        for(const auto& port_it: model.ports )
-        {
-            auto preferred_direction = preferred_port_types[pref_index];
-            if( port_it.second.direction != preferred_direction )
-            {
-                continue;
-            }
+        const QString& port_name = _port_rows[row].first;
+        const QString& label = _port_rows[row].second;
 
-            QString description = port_it.second.description;
-            QString label = port_it.first;
-            if( preferred_direction == PortDirection::INPUT)
-            {
-                label.prepend("[IN] ");
-                if( description.isEmpty())
-                {
-                    description="[INPUT]";
-                }
-                else{
-                    description.prepend("[INPUT]: ");
-                }
-            }
-            else if( preferred_direction == PortDirection::OUTPUT){
-                label.prepend("[OUT] ");
-                if( description.isEmpty())
-                {
-                    description="[OUTPUT]";
-                }
-                else{
-                    description.prepend("[OUTPUT]: ");
-                }
-            }
-
-            GrootLineEdit* form_field = new GrootLineEdit();
-            form_field->setAlignment( Qt::AlignHCenter);
-            form_field->setMaximumWidth(140);
-            form_field->setText( port_it.second.default_value );
-
-            connect(form_field, &GrootLineEdit::doubleClicked,
-                    this, [this,form_field]()
-                    { emit this->portValueDoubleChicked(form_field); });
-
-            connect(form_field, &GrootLineEdit::lostFocus,
-                    this, [this]()
-                    { emit this->portValueDoubleChicked(nullptr); });
-
-            QLabel* form_label  =  new QLabel( label, _params_widget );
-            form_label->setStyleSheet("QToolTip {color: black;}");
-            form_label->setToolTip( description );
-
-            form_field->setMinimumWidth(DEFAULT_FIELD_WIDTH);
+        GrootLineEdit* form_field = new GrootLineEdit();
+        form_field->setAlignment( Qt::AlignHCenter);
+        form_field->setMaximumWidth(140);
 
-            _ports_widgets.insert( std::make_pair( port_it.first, form_field) );
+        QLabel* form_label  =  new QLabel( label, _params_widget );
+        form_label->setToolTip( _prototype->descriptions[row] );
 
-            form_field->setStyleSheet("color: rgb(30,30,30); "
-                                      "background-color: rgb(200,200,200); "
-                                      "border: 0px; ");
+        form_field->setMinimumWidth(DEFAULT_FIELD_WIDTH);
 
-            _form_layout->addRow( form_label, form_field );
+        _ports_widgets.insert( std::make_pair( port_name, form_field) );
 
-            auto paramUpdated = [this,label,form_field]()
-            {
-                this->parameterUpdated(label,form_field);
-            };
+        form_field->setFrame( false );
+        form_field->setPalette( palettes.field );
 
-            if(auto lineedit = dynamic_cast<QLineEdit*>( form_field ) )
-            {
-                connect( lineedit, &QLineEdit::editingFinished, this, paramUpdated );
-                connect( lineedit, &QLineEdit::editingFinished,
-                         this, &BehaviorTreeDataModel::updateNodeSize);
-            }
-            else if( auto combo = dynamic_cast<QComboBox*>( form_field ) )
-            {
-                connect( combo, &QComboBox::currentTextChanged, this, paramUpdated);
-            }
-        }
+        _form_layout->addRow( form_label, form_field );
     }
     _params_widget->adjustSize();
 
@@ -166,55 +432,214 @@ BehaviorTreeDataModel::BehaviorTreeDataModel(const NodeModel &model):
     _main_layout->setSizeConstraint(QLayout::SizeConstraint::SetMaximumSize);
     _form_layout->setSizeConstraint(QLayout::SizeConstraint::SetMaximumSize);
     //--------------------------------------
+    if( _style_icon.isEmpty() == false )
+    {
+        _caption_logo_left->setFixedWidth( 20 );
+        _caption_logo_right->setFixedWidth( 1 );
+    }
+    _caption_label->setText( captionText() );
+
+    QPalette capt_palette = _caption_label->palette();
+    capt_palette.setColor(_caption_label->backgroundRole(), Qt::transparent);
+    capt_palette.setColor(_caption_label->foregroundRole(), _style_caption_color);
+    _caption_label->setPalette(capt_palette);
+
+    _caption_logo_left->adjustSize();
+    _caption_logo_right->adjustSize();
+    _caption_label->adjustSize();
+
+    _painted_size = QSize();
+}
+
+void BehaviorTreeDataModel::connectWidgets()
+{
+    _caption_logo_left->installEventFilter(this);
+
+    _line_edit_name->setText( _instance_name );
     connect( _line_edit_name, &QLineEdit::editingFinished,
              this, [this]()
     {
         setInstanceName( _line_edit_name->text() );
     });
+
+    for(const auto& row: _port_rows )
+    {
+        const QString& port_name = row.first;
+        const QString& label = row.second;
+        auto form_field = qobject_cast<GrootLineEdit*>( _ports_widgets.at( port_name ) );
+        form_field->setText( _port_values[port_name] );
+
+        connect(form_field, &GrootLineEdit::doubleClicked,
+                this, [this,form_field]()
+                { emit this->portValueDoubleChicked(form_field); });
+
+        connect(form_field, &GrootLineEdit::lostFocus,
+                this, [this]()
+                { emit this->portValueDoubleChicked(nullptr); });
+
+        auto paramUpdated = [this,label,port_name,form_field]()
+        {
+            _port_values[port_name] = form_field->text();
+            this->parameterUpdated(label,form_field);
+        };
+
+        connect( form_field, &QLineEdit::editingFinished, this, paramUpdated );
+        connect( form_field, &QLineEdit::editingFinished,
+                 this, &BehaviorTreeDataModel::updateNodeSize);
+    }
 }
 
-BehaviorTreeDataModel::~BehaviorTreeDataModel()
+QString BehaviorTreeDataModel::widgetsPoolKey() const
 {
+    QString key = _model.registration_ID;
+    for(const auto& row: _port_rows )
+    {
+        key += '|' + row.first;
+    }
+    return key;
+}
 
+void BehaviorTreeDataModel::createWidgets()
+{
+    if( hasWidgets() )
+    {
+        return;
+    }
+    auto pool_it = widgetsPool().find( widgetsPoolKey() );
+    if( pool_it != widgetsPool().end() && !pool_it->second.empty() )
+    {
+        const PooledWidgets widgets = pool_it->second.back();
+        pool_it->second.pop_back();
+        _main_widget        = widgets.main_widget;
+        _params_widget      = widgets.params_widget;
+        _line_edit_name     = widgets.line_edit_name;
+        _ports_widgets      = widgets.ports_widgets;
+        _form_layout        = widgets.form_layout;
+        _main_layout        = widgets.main_layout;
+        _caption_label      = widgets.caption_label;
+        _caption_logo_left  = widgets.caption_logo_left;
+        _caption_logo_right = widgets.caption_logo_right;
+        _painted_size = QSize();
+        // released by a collapsed node, or the reverse
+        if( _caption_label->text() != captionText() )
+        {
+            _caption_label->setText( captionText() );
+            _caption_label->adjustSize();
+        }
+    }
+    else{
+        buildWidgets();
+    }
+    connectWidgets();
+    lock( _locked );
+    onHighlightPortValue( _highlighted_value );
+    updateNodeSize();
 }
 
-BT::NodeType BehaviorTreeDataModel::nodeType() const
+bool BehaviorTreeDataModel::releaseWidgets()
 {
-    return _model.type;
+    if( !hasWidgets() || _keep_widgets ||
+        _main_widget->isAncestorOf( QApplication::focusWidget() ) )
+    {
+        return false;
+    }
+    // painted from now on
+    _port_values = getCurrentPortMapping();
+    _caption_logo_left->removeEventFilter(this);
+    disconnect( _line_edit_name, nullptr, this, nullptr );
+    for(const auto& it: _ports_widgets)
+    {
+        disconnect( it.second, nullptr, this, nullptr );
+    }
+
+    std::vector<PooledWidgets>& pooled = widgetsPool()[ widgetsPoolKey() ];
+    if( pooled.size() < WIDGETS_POOL_SIZE )
+    {
+        pooled.push_back( { _main_widget, _params_widget, _line_edit_name, _ports_widgets,
+                            _form_layout, _main_layout, _caption_label,
+                            _caption_logo_left, _caption_logo_right } );
+    }
+    else{
+        // still embedded in the proxy of the node
+        _main_widget->deleteLater();
+    }
+
+    _main_widget = nullptr;
+    _params_widget = nullptr;
+    _line_edit_name = nullptr;
+    _ports_widgets.clear();
+    _form_layout = nullptr;
+    _main_layout = nullptr;
+    _caption_label = nullptr;
+    _caption_logo_left = nullptr;
+    _caption_logo_right = nullptr;
+
+    updateNodeSize();
+    return true;
 }
 
-void BehaviorTreeDataModel::initWidget()
+bool BehaviorTreeDataModel::resetForReuse()
 {
-    if( _style_icon.isEmpty() == false )
+    // the subclasses that change the widgets have their own state
+    if( _keep_widgets )
     {
-        _caption_logo_left->setFixedWidth( 20 );
-        _caption_logo_right->setFixedWidth( 1 );
+        return false;
+    }
+    setNodeStyle( getDefaultStyle().first );
+    lock( false );
+    onHighlightPortValue( QString() );
 
-        QFile file(_style_icon);
-        if(!file.open(QIODevice::ReadOnly))
-        {
-            qDebug()<<"file not opened: "<< _style_icon;
-            file.close();
-        }
-        else {
-            QByteArray ba = file.readAll();
-            QByteArray new_color_fill = QString("fill:%1;").arg( _style_caption_color.name() ).toUtf8();
-            ba.replace("fill:#ffffff;", new_color_fill);
-            _icon_renderer =  new QSvgRenderer(ba, this);
-        }
+    // as the constructor, for the current mode
+    if( painted_mode && hasWidgets() )
+    {
+        releaseWidgets();
+    }
+    else if( !painted_mode && !hasWidgets() )
+    {
+        createWidgets();
     }
 
-    _caption_label->setText( _style_caption_alias );
+    _collapsed_branch.reset();
+    if( _caption_label )
+    {
+        _caption_label->setText( captionText() );
+        _caption_label->adjustSize();
+    }
+    _instance_name.clear();
+    if( _line_edit_name )
+    {
+        _line_edit_name->setText( QString() );
+    }
+    for (const auto& it: _prototype->default_values)
+    {
+        setPortMapping( it.first, it.second );
+    }
+    updateNodeSize();
+    return true;
+}
 
-    QPalette capt_palette = _caption_label->palette();
-    capt_palette.setColor(_caption_label->backgroundRole(), Qt::transparent);
-    capt_palette.setColor(_caption_label->foregroundRole(), _style_caption_color);
-    _caption_label->setPalette(capt_palette);
+BehaviorTreeDataModel::~BehaviorTreeDataModel()
+{
 
-    _caption_logo_left->adjustSize();
-    _caption_logo_right->adjustSize();
-    _caption_label->adjustSize();
+}
+
+BT::NodeType BehaviorTreeDataModel::nodeType() const
+{
+    return _model.type;
+}
+
+void BehaviorTreeDataModel::setPaintedMode(bool painted)
+{
+    painted_mode = painted;
+}
 
+bool BehaviorTreeDataModel::paintedMode()
+{
+    return painted_mode;
+}
+
+void BehaviorTreeDataModel::initWidget()
+{
     updateNodeSize();
 }
 
@@ -244,15 +669,19 @@ NodeDataModel::ConnectionPolicy BehaviorTreeDataModel::portOutConnectionPolicy(Q
 
 void BehaviorTreeDataModel::updateNodeSize()
 {
+    if( !hasWidgets() )
+    {
+        updatePaintedSize();
+        emit embeddedWidgetSizeUpdated();
+        return;
+    }
     int caption_width = _caption_label->width();
     caption_width += _caption_logo_left->width() + _caption_logo_right->width();
     int line_edit_width =  caption_width;
 
     if( _line_edit_name->isHidden() == false)
     {
-        QFontMetrics fm = _line_edit_name->fontMetrics();
-        const QString& txt = _line_edit_name->text();
-        int text_width = fm.boundingRect(txt).width();
+        int text_width = textWidth( _line_edit_name->font(), _line_edit_name->text() );
         line_edit_width = std::max( line_edit_width, text_width + MARGIN);
     }
 
@@ -266,9 +695,7 @@ void BehaviorTreeDataModel::updateNodeSize()
         auto field_widget = _form_layout->itemAt(row, QFormLayout::FieldRole)->widget();
         if(auto field_line_edit = dynamic_cast<QLineEdit*>(field_widget))
         {
-            QFontMetrics fontMetrics = field_line_edit->fontMetrics();
-            QString text = field_line_edit->text();
-            int text_width = fontMetrics.boundingRect(text).width();
+            int text_width = textWidth( field_line_edit->font(), field_line_edit->text() );
             field_colum_width = std::max( field_colum_width, text_width + MARGIN);
         }
         label_colum_width = std::max(label_colum_width, label_widget->width());
@@ -299,6 +726,132 @@ void BehaviorTreeDataModel::updateNodeSize()
     emit embeddedWidgetSizeUpdated();
 }
 
+void BehaviorTreeDataModel::updatePaintedSize()
+{
+    // the same layout as the widgets
+    const QFont caption_font = captionFont();
+    const QFont font;
+    QFontMetrics metrics( font );
+
+    int caption_width = textWidth( caption_font, captionText() );
+    if( _style_icon.isEmpty() == false )
+    {
+        caption_width += ICON_WIDTH;
+    }
+    int line_edit_width = std::max( caption_width,
+                                    textWidth( font, _instance_name ) + MARGIN );
+
+    int field_colum_width = DEFAULT_LABEL_WIDTH;
+    int label_colum_width = 0;
+    for(const auto& row: _port_rows )
+    {
+        const QString& value = _port_values.at( row.first );
+        field_colum_width = std::max( field_colum_width, textWidth( font, value ) + MARGIN);
+        label_colum_width = std::max( label_colum_width, textWidth( font, row.second ) );
+    }
+    field_colum_width = std::max( field_colum_width,
+                                  line_edit_width - label_colum_width - COLUMNS_SPACING);
+    line_edit_width = std::max( line_edit_width,
+                                label_colum_width + COLUMNS_SPACING + field_colum_width );
+
+    const int row_height = metrics.height() + LINE_EDIT_PADDING;
+    const int rows = int( _port_rows.size() );
+
+    _label_column_width = label_colum_width;
+    _field_column_width = field_colum_width;
+    _painted_size = QSize( line_edit_width,
+                           CAPTION_HEIGHT + (rows + 1) * (ROWS_SPACING + row_height) );
+    _painted_texts_valid = false;
+}
+
+void BehaviorTreeDataModel::updatePaintedTexts() const
+{
+    QFontMetrics metrics( (QFont()) );
+
+    _caption_static_text = staticText( captionText() );
+    _name_static_text = staticText( _instance_name );
+    _value_static_texts.clear();
+    _value_static_texts.reserve( _port_rows.size() );
+    for(const auto& row: _port_rows )
+    {
+        const QString& value = _port_values.at( row.first );
+        _value_static_texts.push_back(
+                    staticText( metrics.elidedText( value, Qt::ElideRight, _field_column_width ) ) );
+    }
+    _painted_texts_valid = true;
+}
+
+QtNodes::NodePainterDelegate *BehaviorTreeDataModel::painterDelegate() const
+{
+    static BehaviorTreeNodePainter painter;
+    return hasWidgets() ? nullptr : &painter;
+}
+
+void BehaviorTreeDataModel::paintContent(QPainter *painter, QPointF origin) const
+{
+    if( !_painted_texts_valid )
+    {
+        updatePaintedTexts();
+    }
+    painter->save();
+    painter->translate( origin );
+
+    const int width = _painted_size.width();
+    const QFont caption_font = captionFont();
+    const QFont font;
+    QFontMetrics metrics( font );
+    const int row_height = metrics.height() + LINE_EDIT_PADDING;
+
+    //----------------------------
+    int caption_width = textWidth( caption_font, captionText() );
+    int x = width - caption_width;
+    if( _style_icon.isEmpty() == false )
+    {
+        x -= ICON_WIDTH;
+    }
+    x /= 2;
+    if( _style_icon.isEmpty() == false )
+    {
+        // rasterized at the size it has on screen, in device pixels
+        const QTransform& transform = painter->worldTransform();
+        const qreal scale = std::sqrt( transform.m11() * transform.m11() + transform.m12() * transform.m12() );
+        const qreal pixel_ratio = painter->device() ? painter->device()->devicePixelRatioF() : 1.0;
+        const QPixmap icon = iconPixmap( _style_icon, _style_caption_color,
+                                         qRound( CAPTION_HEIGHT * scale ), pixel_ratio );
+        painter->drawPixmap( QRectF( x, 0, CAPTION_HEIGHT, CAPTION_HEIGHT ), icon, icon.rect() );
+        x += ICON_WIDTH;
+    }
+    // laid out once, drawn as glyph runs
+    painter->setFont( caption_font );
+    painter->setPen( _style_caption_color );
+    drawStaticText( painter, x, 0, CAPTION_HEIGHT, _caption_static_text );
+
+    //----------------------------
+    painter->setFont( font );
+    int y = CAPTION_HEIGHT + ROWS_SPACING;
+    painter->setPen( Qt::white );
+    drawStaticText( painter, ( width - _name_static_text.size().width() ) * 0.5, y,
+                    row_height, _name_static_text );
+
+    for(size_t row = 0; row < _port_rows.size(); row++ )
+    {
+        y += row_height + ROWS_SPACING;
+        const QString& value = _port_values.at( _port_rows[row].first );
+
+        painter->setPen( Qt::white );
+        drawStaticText( painter, 0, y, row_height, _prototype->label_texts[row] );
+
+        QRect field( width - _field_column_width, y, _field_column_width, row_height );
+        const bool highlighted = !_highlighted_value.isEmpty() && value == _highlighted_value;
+        painter->fillRect( field, highlighted ? QColor("#ffef0b") : QColor(200,200,200) );
+        painter->setPen( QColor(30,30,30) );
+        const QStaticText& value_text = _value_static_texts[row];
+        drawStaticText( painter, field.left() + ( field.width() - value_text.size().width() ) * 0.5,
+                        y, row_height, value_text );
+    }
+    painter->restore();
+}
+
 QtNodes::NodeDataType BehaviorTreeDataModel::dataType(QtNodes::PortType, QtNodes::PortIndex) const
 {
     return NodeDataType {"", ""};
@@ -309,8 +862,12 @@ std::shared_ptr<QtNodes::NodeData> BehaviorTreeDataModel::outData(QtNodes::PortI
     return nullptr;
 }
 
-void BehaviorTreeDataModel::readStyle()
+void BehaviorTreeDataModel::reloadStyles()
 {
+    CaptionStyles& styles = captionStyles();
+    styles.clear();
+    styles_loaded = true;
+
     QFile style_file(":/NodesStyle.json");
 
     if (!style_file.open(QIODevice::ReadOnly))
@@ -339,25 +896,57 @@ void BehaviorTreeDataModel::readStyle()
         qDebug()<<"JSON object is empty.";
         return;
     }
+
+    for(auto it = toplevel_object.begin(); it != toplevel_object.end(); it++)
+    {
+        auto category_style = it.value().toObject();
+        CaptionStyle style;
+        if( category_style.contains("icon"))
+        {
+            style.has_icon = true;
+            style.icon = category_style["icon"].toString();
+        }
+        if( category_style.contains("caption_color"))
+        {
+            style.has_color = true;
+            style.color = category_style["caption_color"].toString();
+        }
+        if( category_style.contains("caption_alias"))
+        {
+            style.has_alias = true;
+            style.alias = category_style["caption_alias"].toString();
+        }
+        styles.insert( it.key(), style );
+    }
+}
+
+void BehaviorTreeDataModel::readStyle()
+{
+    if( !styles_loaded )
+    {
+        reloadStyles();
+    }
+    const CaptionStyles& styles = captionStyles();
     QString model_type_name( QString::fromStdString(toStr(_model.type)) );
 
     for (const auto& model_name: { model_type_name, _model.registration_ID} )
     {
-        if( toplevel_object.contains(model_name) )
+        auto it = styles.find( model_name );
+        if( it == styles.end() )
         {
-            auto category_style = toplevel_object[ model_name ].toObject() ;
-            if( category_style.contains("icon"))
-            {
-                _style_icon = category_style["icon"].toString();
-            }
-            if( category_style.contains("caption_color"))
-            {
-                _style_caption_color = category_style["caption_color"].toString();
-            }
-            if( category_style.contains("caption_alias"))
-            {
-                _style_caption_alias = category_style["caption_alias"].toString();
-            }
+            continue;
+        }
+        if( it->has_icon )
+        {
+            _style_icon = it->icon;
+        }
+        if( it->has_color )
+        {
+            _style_caption_color = it->color;
+        }
+        if( it->has_alias )
+        {
+            _style_caption_alias = it->alias;
         }
     }
 }
@@ -372,8 +961,17 @@ const QString &BehaviorTreeDataModel::instanceName() const
     return _instance_name;
 }
 
+QString BehaviorTreeDataModel::caption() const
+{
+    return _instance_name.isEmpty() ? _style_caption_alias : _instance_name;
+}
+
 PortsMapping BehaviorTreeDataModel::getCurrentPortMapping() const
 {
+    if( !hasWidgets() )
+    {
+        return _port_values;
+    }
     PortsMapping out;
 
     for(const auto& it: _ports_widgets)
@@ -399,14 +997,20 @@ QJsonObject BehaviorTreeDataModel::save() const
     modelJson["name"]  = registrationName();
     modelJson["alias"] = instanceName();
 
-    for (const auto& it: _ports_widgets)
+    for (const auto& it: getCurrentPortMapping())
     {
-        if( auto linedit = dynamic_cast<QLineEdit*>(it.second)){
-            modelJson[it.first] = linedit->text();
-        }
-        else if( auto combo = dynamic_cast<QComboBox*>(it.second)){
-            modelJson[it.first] = combo->currentText();
+        modelJson[it.first] = it.second;
+    }
+    // part of the undo history, as the instance name
+    if( _collapsed_branch )
+    {
+        ClipboardContent content;
+        content.trees.push_back( *_collapsed_branch );
+        for (const auto& abs_node: _collapsed_branch->nodes())
+        {
+            content.models.insert( { abs_node.model.registration_ID, abs_node.model } );
         }
+        modelJson[COLLAPSED_KEY] = QString::fromLatin1( EncodeClipboard( content ).toBase64() );
     }
 
     return modelJson;
@@ -423,16 +1027,33 @@ void BehaviorTreeDataModel::restore(const QJsonObject &modelJson)
 
     for(auto it = modelJson.begin(); it != modelJson.end(); it++ )
     {
-        if( it.key() != "alias" && it.key() != "name")
+        if( it.key() != "alias" && it.key() != "name" && it.key() != COLLAPSED_KEY )
         {
             setPortMapping( it.key(), it.value().toString() );
         }
     }
 
+    ClipboardContent content;
+    if( modelJson.contains( COLLAPSED_KEY ) &&
+        DecodeClipboard( QByteArray::fromBase64( modelJson[COLLAPSED_KEY].toString().toLatin1() ),
+                         content ) && content.trees.size() == 1 )
+    {
+        setCollapsedBranch( std::make_shared<const AbsBehaviorTree>( std::move(content.trees.front()) ) );
+    }
+    else if( _collapsed_branch )
+    {
+        setCollapsedBranch( nullptr );
+    }
+
 }
 
 void BehaviorTreeDataModel::lock(bool locked)
 {
+    _locked = locked;
+    if( !hasWidgets() )
+    {
+        return;
+    }
     _line_edit_name->setEnabled( !locked );
 
     for(const auto& it: _ports_widgets)
@@ -452,6 +1073,20 @@ void BehaviorTreeDataModel::lock(bool locked)
 
 void BehaviorTreeDataModel::setPortMapping(const QString &port_name, const QString &value)
 {
+    auto value_it = _port_values.find(port_name);
+    if( value_it != _port_values.end() )
+    {
+        value_it->second = value;
+        _painted_texts_valid = false;
+    }
+    if( !hasWidgets() )
+    {
+        if( value_it == _port_values.end() )
+        {
+            qDebug() << "error, label "<< port_name << " not found in the model";
+        }
+        return;
+    }
     auto it = _ports_widgets.find(port_name);
     if( it != _ports_widgets.end() )
     {
@@ -477,19 +1112,45 @@ void BehaviorTreeDataModel::setPortMapping(const QString &port_name, const QStri
 
 bool BehaviorTreeDataModel::eventFilter(QObject *obj, QEvent *event)
 {
-    if (event->type() == QEvent::Paint && obj == _caption_logo_left && _icon_renderer)
+    if (event->type() == QEvent::Paint && obj == _caption_logo_left && !_style_icon.isEmpty())
     {
         QPainter paint(_caption_logo_left);
-        _icon_renderer->render(&paint);
+        paint.drawPixmap( 0, 0, iconPixmap( _style_icon, _style_caption_color,
+                                            _caption_logo_left->height(),
+                                            _caption_logo_left->devicePixelRatioF() ) );
     }
     return NodeDataModel::eventFilter(obj, event);
 }
 
 
+void BehaviorTreeDataModel::setCollapsedBranch(std::shared_ptr<const AbsBehaviorTree> branch)
+{
+    _collapsed_branch = std::move(branch);
+    if( _caption_label )
+    {
+        _caption_label->setText( captionText() );
+        _caption_label->adjustSize();
+    }
+    updateNodeSize();
+}
+
+QString BehaviorTreeDataModel::captionText() const
+{
+    if( !_collapsed_branch )
+    {
+        return _style_caption_alias;
+    }
+    return QString("%1 [+%2]").arg( _style_caption_alias )
+                              .arg( _collapsed_branch->nodesCount() - 1 );
+}
+
 void BehaviorTreeDataModel::setInstanceName(const QString &name)
 {
     _instance_name = name;
-    _line_edit_name->setText( name );
+    if( _line_edit_name )
+    {
+        _line_edit_name->setText( name );
+    }
 
     updateNodeSize();
     emit instanceNameChanged();
@@ -498,22 +1159,14 @@ void BehaviorTreeDataModel::setInstanceName(const QString &name)
 
 void BehaviorTreeDataModel::onHighlightPortValue(QString value)
 {
+    _highlighted_value = value;
     for( const auto& it:  _ports_widgets)
     {
         if( auto line_edit = dynamic_cast<QLineEdit*>(it.second) )
         {
-            QString line_str = line_edit->text();
-            if( !value.isEmpty() && line_str == value )
-            {
-                line_edit->setStyleSheet("color: rgb(30,30,30); "
-                                         "background-color: #ffef0b; "
-                                         "border: 0px; ");
-            }
-            else{
-                line_edit->setStyleSheet("color: rgb(30,30,30); "
-                                         "background-color: rgb(200,200,200); "
-                                         "border: 0px; ");
-            }
+            const bool highlighted = !value.isEmpty() && line_edit->text() == value;
+            line_edit->setPalette( highlighted ? nodePalettes().field_highlighted :
+                                                 nodePalettes().field );
         }
     }
 }
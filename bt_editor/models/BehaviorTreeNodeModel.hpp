@@ -6,13 +6,14 @@
 #include <QLineEdit>
 #include <QFormLayout>
 #include <QEvent>
+#include <QStaticText>
 #include <nodes/NodeDataModel>
+#include <nodes/NodePainterDelegate>
 #include <iostream>
 #include <memory>
 #include <vector>
 #include <map>
 #include <functional>
-#include <QSvgRenderer>
 #include "bt_editor/bt_editor_base.h"
 #include "bt_editor/utils.h"
 
@@ -31,6 +32,17 @@ public:
 
     ~BehaviorTreeDataModel() override;
 
+    // The models created in painted mode have no widget: the caption, the
+    // instance name and the ports are drawn by painterDelegate(), until
+    // createWidgets() is called. Used by the read-only modes.
+    static void setPaintedMode(bool painted);
+
+    static bool paintedMode();
+
+    // NodesStyle.json is parsed once, by the first model created; the models
+    // created after a reload use the new styles
+    static void reloadStyles();
+
 public:
 
     NodeType nodeType() const;
@@ -57,6 +69,9 @@ public:
 
     QString name() const final { return registrationName(); }
 
+    // the instance name, or the alias of the model if it has none
+    QString caption() const override;
+
     const QString& instanceName() const;
 
     PortsMapping getCurrentPortMapping() const;
@@ -65,6 +80,30 @@ public:
 
     QWidget *parametersWidget() { return _params_widget; }
 
+    bool hasWidgets() const { return _main_widget != nullptr; }
+
+    // builds the widgets of a model created in painted mode, or takes the
+    // ones released by another node of the same model
+    void createWidgets();
+
+    // The reverse of createWidgets(): the node is painted again, its
+    // widgets are kept in a pool for the nodes of the same model. False if
+    // the widgets are needed by the subclass, or being edited.
+    // NodeGraphicsObject::updateEmbeddedQWidget() must be called right after.
+    bool releaseWidgets();
+
+    // a node removed from a scene, for a new node of the same model
+    bool resetForReuse() override;
+
+    bool isLocked() const { return _locked; }
+
+    QSize embeddedSize() const override { return _painted_size; }
+
+    QtNodes::NodePainterDelegate* painterDelegate() const override;
+
+    // draws the content of the widgets, "origin" is their top left corner
+    void paintContent(QPainter* painter, QPointF origin) const;
+
     QJsonObject save() const override;
 
     void restore(QJsonObject const &) override;
@@ -75,6 +114,13 @@ public:
 
     int UID() const { return _uid; }
 
+    // The hidden nodes of a collapsed branch, the first one is a copy of this
+    // node and the positions are relative to it; null when expanded.
+    // The number of hidden nodes is shown in the caption.
+    const AbsBehaviorTree* collapsedBranch() const { return _collapsed_branch.get(); }
+
+    void setCollapsedBranch(std::shared_ptr<const AbsBehaviorTree> branch);
+
     bool eventFilter(QObject *obj, QEvent *event) override;
 
 
@@ -100,10 +146,55 @@ protected:
     QFrame* _caption_logo_left;
     QFrame* _caption_logo_right;
 
+    // set by the subclasses that change the widgets: never released
+    bool _keep_widgets;
+
 private:
     const NodeModel _model;
     QString _instance_name;
-    QSvgRenderer* _icon_renderer;
+
+    // what the nodes of a model have in common, computed for the first one
+    struct Prototype;
+
+    static std::shared_ptr<const Prototype> prototype(const NodeModel& model);
+
+    std::shared_ptr<const Prototype> _prototype;
+
+    // the ports in the order of the rows, and the labels of the rows
+    std::vector<std::pair<QString,QString>> _port_rows;
+    // the values of the ports when there are no widgets
+    PortsMapping _port_values;
+    QString _highlighted_value;
+    bool _locked;
+
+    // when painted
+    QSize _painted_size;
+    int _label_column_width;
+    int _field_column_width;
+
+    // the texts of paintContent(), laid out once; the labels of the rows are
+    // in the prototype. Invalidated by updatePaintedSize() and setPortMapping().
+    mutable bool _painted_texts_valid;
+    mutable QStaticText _caption_static_text;
+    mutable QStaticText _name_static_text;
+    mutable std::vector<QStaticText> _value_static_texts;
+
+    void updatePaintedTexts() const;
+
+    void buildWidgets();
+
+    // the connections of the widgets to this model, and their values
+    void connectWidgets();
+
+    // the widgets of the models with the same ports are interchangeable
+    QString widgetsPoolKey() const;
+
+    void updatePaintedSize();
+
+    // the alias of the style, with the badge of a collapsed branch
+    QString captionText() const;
+
+    std::shared_ptr<const AbsBehaviorTree> _collapsed_branch;
 
     void readStyle();
     QString _style_icon;
@@ -4,8 +4,13 @@
 
 SubtreeNodeModel::SubtreeNodeModel(const NodeModel &model):
     BehaviorTreeDataModel ( model ),
-    _expanded(false)
+    _expanded(false),
+    _source_revision(0)
 {
+    // the expand button is needed in every mode
+    createWidgets();
+    _keep_widgets = true;
+
     _line_edit_name->setReadOnly(true);
     _line_edit_name->setHidden(true);
 
@@ -36,6 +41,7 @@ SubtreeNodeModel::SubtreeNodeModel(const NodeModel &model):
 void SubtreeNodeModel::setExpanded(bool expand)
 {
     _expanded = expand;
+    _source_revision = 0;
     _expand_button->setText( _expanded ? "Collapse" : "Expand");
     _expand_button->adjustSize();
     _main_widget->adjustSize();
@@ -17,6 +17,12 @@ public:
 
     bool expanded() const { return _expanded; }
 
+    // GraphicContainer::revision() of the tab of the subtree when it was
+    // copied by the expansion; 0 if unknown
+    unsigned sourceRevision() const { return _source_revision; }
+
+    void setSourceRevision(unsigned revision) { _source_revision = revision; }
+
     unsigned int  nPorts(PortType portType) const override
     {
         int out_port = _expanded ? 1 : 0;
@@ -41,6 +47,7 @@ signals:
 private:
     QPushButton* _expand_button;
     bool _expanded;
+    unsigned _source_revision;
 
 };
 
@@ -0,0 +1,263 @@
+#include "monitor_receiver.h"
+#include <QDebug>
+#include <QElapsedTimer>
+#include <algorithm>
+#include <cstdio>
+
+#include "utils.h"
+
+// Enough to absorb a few seconds of a fast tree, while the GUI is busy.
+static const size_t MONITOR_QUEUE_CAPACITY = 1024;
+
+const char* MONITOR_KEYFRAME_TOPIC = "F";
+
+std::string MonitorEndpoint(const QString &address, const QString &port)
+{
+    if( port.contains("://") )
+    {
+        return port.toStdString();
+    }
+    if( address.startsWith("ipc://") )
+    {
+        return ( address + "." + port ).toStdString();
+    }
+    if( address.startsWith("tcp://") )
+    {
+        return ( address + ":" + port ).toStdString();
+    }
+    return ( "tcp://" + address + ":" + port ).toStdString();
+}
+
+std::string MonitorBlockTopic(int block)
+{
+    char topic[8];
+    snprintf( topic, sizeof(topic), "B%04x", block & 0xffff );
+    return topic;
+}
+
+MonitorReceiver::Subscription::Subscription(zmq::context_t &context,
+                                            size_t queue_capacity):
+    socket(context, ZMQ_SUB),
+    queue(queue_capacity),
+    closed(false),
+    received_count(0),
+    dropped_count(0),
+    received_bytes(0),
+    decode_time_ns(0),
+    publishes_topics(false),
+    topics_changed(false),
+    subscribed_topics( 1, std::string() )
+{
+}
+
+void MonitorReceiver::Subscription::setTopics(const std::vector<std::string> &topics)
+{
+    std::lock_guard<std::mutex> lock(topics_mutex);
+    pending_topics = topics;
+    if( pending_topics.empty() )
+    {
+        pending_topics.push_back( std::string() );
+    }
+    topics_changed.store(true);
+}
+
+MonitorReceiver::MonitorReceiver(zmq::context_t &context, QObject *parent):
+    QThread(parent),
+    _context(context),
+    _stop_requested(false)
+{
+}
+
+MonitorReceiver::~MonitorReceiver()
+{
+    stop();
+    wait();
+}
+
+MonitorReceiver::SubscriptionPtr MonitorReceiver::subscribe(const std::string &address)
+{
+    auto subscription = std::make_shared<Subscription>( _context, MONITOR_QUEUE_CAPACITY );
+
+    int linger_ms = 0;
+    subscription->socket.setsockopt(ZMQ_SUBSCRIBE, "", 0);
+    subscription->socket.setsockopt(ZMQ_LINGER, &linger_ms, sizeof(int) );
+    subscription->socket.connect( address.c_str() );
+
+    {
+        // from now on, the socket is used only by the receiver thread
+        std::lock_guard<std::mutex> lock(_pending_mutex);
+        _pending.push_back( subscription );
+    }
+    if( !isRunning() )
+    {
+        start();
+    }
+    return subscription;
+}
+
+void MonitorReceiver::unsubscribe(const SubscriptionPtr &subscription)
+{
+    if( subscription )
+    {
+        subscription->closed.store(true);
+    }
+}
+
+void MonitorReceiver::stop()
+{
+    _stop_requested.store(true);
+}
+
+bool MonitorReceiver::decode(const zmq::message_t &msg, MonitorMessage &decoded)
+{
+    decoded.header.clear();
+    decoded.transitions.clear();
+
+    const size_t msg_size = msg.size();
+    const char* buffer = reinterpret_cast<const char*>(msg.data());
+
+    if( msg_size < 4 ) return false;
+    const uint32_t header_size = flatbuffers::ReadScalar<uint32_t>( buffer );
+
+    if( msg_size < 8 + size_t(header_size) ) return false;
+    const uint32_t num_transitions = flatbuffers::ReadScalar<uint32_t>( &buffer[4+header_size] );
+
+    if( msg_size < 8 + size_t(header_size) + 12*size_t(num_transitions) ) return false;
+
+    decoded.header.reserve( header_size / 3 );
+    for(size_t offset = 4; offset < header_size +4; offset +=3 )
+    {
+        const uint16_t uid = flatbuffers::ReadScalar<uint16_t>(&buffer[offset]);
+        const auto status = flatbuffers::ReadScalar<Serialization::NodeStatus>(&buffer[offset+2] );
+        decoded.header.push_back( { uid, convert(status) } );
+    }
+
+    decoded.transitions.reserve( num_transitions );
+    for(size_t t=0; t < num_transitions; t++)
+    {
+        size_t offset = 8 + header_size + 12*t;
+
+        MonitorMessage::Transition transition;
+        const double t_sec  = flatbuffers::ReadScalar<uint32_t>( &buffer[offset] );
+        const double t_usec = flatbuffers::ReadScalar<uint32_t>( &buffer[offset+4] );
+        transition.timestamp = t_sec + t_usec* 0.000001;
+        transition.uid = flatbuffers::ReadScalar<uint16_t>(&buffer[offset+8]);
+        transition.prev_status = convert(flatbuffers::ReadScalar<Serialization::NodeStatus>(&buffer[offset+10] ));
+        transition.status      = convert(flatbuffers::ReadScalar<Serialization::NodeStatus>(&buffer[offset+11] ));
+        decoded.transitions.push_back( transition );
+    }
+    return true;
+}
+
+void MonitorReceiver::applyTopics(Subscription &sub)
+{
+    std::vector<std::string> topics;
+    {
+        std::lock_guard<std::mutex> lock(sub.topics_mutex);
+        topics.swap( sub.pending_topics );
+        sub.topics_changed.store(false);
+    }
+    // subscribed first: no message is lost meanwhile
+    for(const auto& topic: topics)
+    {
+        sub.socket.setsockopt( ZMQ_SUBSCRIBE, topic.data(), topic.size() );
+    }
+    for(const auto& topic: sub.subscribed_topics)
+    {
+        sub.socket.setsockopt( ZMQ_UNSUBSCRIBE, topic.data(), topic.size() );
+    }
+    sub.subscribed_topics.swap( topics );
+}
+
+void MonitorReceiver::run()
+{
+    // short timeout, so that stop() and new subscriptions are honored quickly
+    const long poll_timeout_ms = 100;
+
+    std::vector<SubscriptionPtr> active;
+    std::vector<zmq::pollitem_t> poll_items;
+    zmq::message_t msg;
+    MonitorMessage decoded;
+    QElapsedTimer decode_timer;
+
+    while( !_stop_requested.load() )
+    {
+        {
+            std::lock_guard<std::mutex> lock(_pending_mutex);
+            active.insert( active.end(), _pending.begin(), _pending.end() );
+            _pending.clear();
+        }
+        active.erase( std::remove_if( active.begin(), active.end(),
+                                      [](const SubscriptionPtr& sub) { return sub->closed.load(); } ),
+                      active.end() );
+
+        if( active.empty() )
+        {
+            msleep( poll_timeout_ms );
+            continue;
+        }
+
+        poll_items.resize( active.size() );
+        for(size_t i = 0; i < active.size(); i++)
+        {
+            poll_items[i] = { static_cast<void*>(active[i]->socket), 0, ZMQ_POLLIN, 0 };
+        }
+
+        try{
+            for(const auto& sub: active)
+            {
+                if( sub->topics_changed.load() )
+                {
+                    applyTopics( *sub );
+                }
+            }
+            zmq::poll( poll_items.data(), poll_items.size(), poll_timeout_ms );
+
+            for(size_t i = 0; i < active.size(); i++)
+            {
+                if( (poll_items[i].revents & ZMQ_POLLIN) == 0 )
+                {
+                    continue;
+                }
+                Subscription& sub = *active[i];
+
+                while( sub.socket.recv(&msg, ZMQ_DONTWAIT) )
+                {
+                    sub.received_count++;
+                    sub.received_bytes += msg.size();
+
+                    // the parts of a message arrive together
+                    decoded.topic.clear();
+                    if( msg.more() )
+                    {
+                        decoded.topic.assign( static_cast<const char*>( msg.data() ), msg.size() );
+                        sub.socket.recv( &msg );
+                        sub.received_bytes += msg.size();
+                        sub.publishes_topics.store(true);
+                    }
+
+                    decode_timer.start();
+                    const bool valid = decode( msg, decoded );
+                    sub.decode_time_ns += decode_timer.nsecsElapsed();
+
+                    if( !valid )
+                    {
+                        qDebug() << "Malformed monitor message, size: " << msg.size();
+                        continue;
+                    }
+                    if( !sub.queue.push( decoded ) )
+                    {
+                        // The queue is full. Every message carries the status of the
+                        // whole tree in its header, so dropping one is recoverable.
+                        sub.dropped_count++;
+                    }
+                }
+            }
+        }
+        catch( zmq::error_t& err)
+        {
+            if( err.num() == ETERM ) break;
+            qDebug() << "ZMQ receive failed: " << err.what();
+        }
+    }
+}
@@ -0,0 +1,137 @@
+#ifndef MONITOR_RECEIVER_H
+#define MONITOR_RECEIVER_H
+
+#include <QString>
+#include <QThread>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <zmq.hpp>
+
+#include "bt_editor_base.h"
+#include "spsc_queue.h"
+
+// BT::PublisherZMQ publishes single-part messages with the whole tree.
+// A server may publish two-part messages instead, a topic and a status
+// message, so that a client subscribes only to the nodes it shows:
+//  - MonitorBlockTopic(uid / MONITOR_BLOCK_SIZE): the nodes with the uids of
+//    the block in the header, and their transitions;
+//  - MONITOR_KEYFRAME_TOPIC: all the nodes in the header, no transition,
+//    once per second or so, for the nodes that are not subscribed.
+// The uids of a subtree are consecutive: a subtree is a few blocks.
+static const int MONITOR_BLOCK_SIZE = 64;
+
+// The endpoint of a port of a BT server:
+//  - "tcp://host:port" for a host name or an IP address;
+//  - "ipc://path.port" for "ipc://path", when the server runs on the same
+//    computer, to skip the TCP loopback;
+//  - "port" itself, if it is already an endpoint.
+std::string MonitorEndpoint(const QString& address, const QString& port);
+
+extern const char* MONITOR_KEYFRAME_TOPIC;
+
+std::string MonitorBlockTopic(int block);
+
+// A status message published by BT::PublisherZMQ, already decoded.
+// Node are still identified by their UID; the conversion to an index of the
+// loaded tree is done by the consumer, that owns the tree.
+struct MonitorMessage
+{
+    struct Transition
+    {
+        uint16_t uid;
+        NodeStatus prev_status;
+        NodeStatus status;
+        double timestamp;
+    };
+
+    std::vector<std::pair<uint16_t, NodeStatus>> header;
+    std::vector<Transition> transitions;
+
+    // empty for a single-part message
+    std::string topic;
+
+    // the header has only the nodes of a block
+    bool isBlock() const { return !topic.empty() && topic != MONITOR_KEYFRAME_TOPIC; }
+
+    bool isKeyframe() const { return topic == MONITOR_KEYFRAME_TOPIC; }
+};
+
+// Receives and decodes the messages of all the SUB sockets on a single
+// thread. Each subscription has its own queue, and the GUI thread is its only
+// consumer.
+class MonitorReceiver : public QThread
+{
+    Q_OBJECT
+
+public:
+    struct Subscription
+    {
+        Subscription(zmq::context_t& context, size_t queue_capacity);
+
+        bool pop(MonitorMessage& msg) { return queue.pop(msg); }
+
+        int receivedCount() const { return received_count.load(); }
+
+        // messages discarded because the GUI did not drain the queue in time
+        int droppedCount() const { return dropped_count.load(); }
+
+        long long receivedBytes() const { return received_bytes.load(); }
+
+        // total time spent in decode()
+        long long decodeTimeNs() const { return decode_time_ns.load(); }
+
+        // true once a message with a topic was received
+        bool publishesTopics() const { return publishes_topics.load(); }
+
+        // Empty for all the messages. Applied by the receiver thread.
+        void setTopics(const std::vector<std::string>& topics);
+
+        zmq::socket_t socket;
+        SPSCQueue<MonitorMessage> queue;
+        std::atomic<bool> closed;
+        std::atomic<int> received_count;
+        std::atomic<int> dropped_count;
+        std::atomic<long long> received_bytes;
+        std::atomic<long long> decode_time_ns;
+        std::atomic<bool> publishes_topics;
+
+        std::mutex topics_mutex;
+        std::vector<std::string> pending_topics;
+        std::atomic<bool> topics_changed;
+        // used by the receiver thread only
+        std::vector<std::string> subscribed_topics;
+    };
+
+    typedef std::shared_ptr<Subscription> SubscriptionPtr;
+
+    MonitorReceiver(zmq::context_t& context, QObject* parent = nullptr);
+
+    ~MonitorReceiver() override;
+
+    // Connects a new subscriber and starts the thread, if needed.
+    // Throws zmq::error_t on failure.
+    SubscriptionPtr subscribe(const std::string& address);
+
+    // The socket is closed by the receiver thread.
+    void unsubscribe(const SubscriptionPtr& subscription);
+
+    void stop();
+
+    static bool decode(const zmq::message_t& msg, MonitorMessage& decoded);
+
+protected:
+    void run() override;
+
+private:
+    zmq::context_t& _context;
+    std::mutex _pending_mutex;
+    std::vector<SubscriptionPtr> _pending;
+    std::atomic<bool> _stop_requested;
+
+    static void applyTopics(Subscription& sub);
+};
+
+#endif // MONITOR_RECEIVER_H
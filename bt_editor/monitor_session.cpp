@@ -0,0 +1,631 @@
+#include "monitor_session.h"
+#include <QCryptographicHash>
+#include <QDebug>
+#include <limits>
+#include <algorithm>
+#include <set>
+#include <QSettings>
+#include <QDateTime>
+
+#include "mainwindow.h"
+#include "utils.h"
+#include "models/BehaviorTreeNodeModel.hpp"
+#include <nodes/FlowView>
+
+MonitorSession::MonitorSession(const QString &tab_name,
+                               zmq::context_t &context,
+                               MonitorReceiver &receiver,
+                               MonitorTreeCache &tree_cache,
+                               MainWindow *main_window,
+                               QObject *parent):
+    QObject(parent),
+    _tab_name(tab_name),
+    _zmq_context(context),
+    _receiver(receiver),
+    _tree_cache(tree_cache),
+    _main_window(main_window),
+    _fetcher(nullptr),
+    _fetch_request_id(0),
+    _connected(false),
+    _msg_count(0),
+    _dropped_count(0),
+    _resync_needed(true),
+    _uid_to_index( std::numeric_limits<uint16_t>::max() + 1, UNKNOWN_UID ),
+    _rewinding(false),
+    _rewind_time(0),
+    _last_timestamp(0),
+    _topics_enabled(true),
+    _recorder(nullptr),
+    _stats_decode_ns(0),
+    _apply_time_ns(0),
+    _apply_frames(0),
+    _frame_transitions(0),
+    _displayed_revision(0),
+    _displayed(false)
+{
+}
+
+QJsonObject MonitorStats::toJson() const
+{
+    QJsonObject json;
+    json["messages"] = messages;
+    json["bytes"] = double(bytes);
+    json["dropped"] = dropped;
+    json["transitions"] = double(transitions);
+    json["coalesced"] = double(coalesced);
+    json["messages_per_sec"] = messages_per_sec;
+    json["bytes_per_sec"] = bytes_per_sec;
+    json["decode_us_per_message"] = decode_us_per_message;
+    json["lag_ms"] = lag_ms;
+    json["apply_us_per_frame"] = apply_us_per_frame;
+    return json;
+}
+
+void MonitorSession::updateStats()
+{
+    if( _subscription )
+    {
+        _stats.messages = _msg_count;
+        _stats.bytes = _subscription->receivedBytes();
+        _stats.dropped = _subscription->droppedCount();
+    }
+
+    if( !_stats_timer.isValid() )
+    {
+        _stats_timer.start();
+        _stats_snapshot = _stats;
+        return;
+    }
+    const qint64 elapsed_ms = _stats_timer.elapsed();
+    if( elapsed_ms < 1000 )
+    {
+        return;
+    }
+    const double elapsed_sec = elapsed_ms * 0.001;
+    const int messages = _stats.messages - _stats_snapshot.messages;
+    const long long decode_ns = _subscription ? _subscription->decodeTimeNs() : _stats_decode_ns;
+
+    _stats.messages_per_sec = messages / elapsed_sec;
+    _stats.bytes_per_sec = (_stats.bytes - _stats_snapshot.bytes) / elapsed_sec;
+    _stats.decode_us_per_message = messages > 0 ? (decode_ns - _stats_decode_ns) * 0.001 / messages : 0.0;
+    _stats.apply_us_per_frame = _apply_frames > 0 ? _apply_time_ns * 0.001 / _apply_frames : 0.0;
+
+    _stats_decode_ns = decode_ns;
+    _apply_time_ns = 0;
+    _apply_frames = 0;
+    _stats_snapshot = _stats;
+    _stats_timer.restart();
+}
+
+bool MonitorSession::startRecording(const QString &filename, QString &error)
+{
+    stopRecording();
+    if( !_connected )
+    {
+        error = tr("Not connected");
+        return false;
+    }
+    QSettings settings;
+    const bool compressed = settings.value("MonitorSession.compressRecordings", true).toBool();
+
+    _recording_error.clear();
+    _recorder = new LogRecorder( filename, this );
+    if( !_recorder->open( _loaded_tree_buffer, compressed ) )
+    {
+        error = _recorder->errorString();
+        delete _recorder;
+        _recorder = nullptr;
+        return false;
+    }
+    // queued: emitted by the writer thread, maybe after this recording stopped
+    LogRecorder* recorder = _recorder;
+    connect( _recorder, &LogRecorder::writeFailed, this, [this, recorder, filename](QString write_error)
+    {
+        if( _recorder != recorder )
+        {
+            return;
+        }
+        _recording_error = write_error;
+        stopRecording();
+        emit recordingFailed( filename, write_error );
+    } );
+    _recorder->start();
+    // every transition is recorded
+    updateTopics( true );
+    return true;
+}
+
+void MonitorSession::stopRecording()
+{
+    if( _recorder )
+    {
+        const QString filename = _recorder->fileName();
+        // the destructor flushes the pending data and joins the thread
+        delete _recorder;
+        _recorder = nullptr;
+        emit recordingStopped( filename );
+    }
+}
+
+void MonitorSession::resetHistory()
+{
+    // the history is bounded both in time and in memory
+    QSettings settings;
+    const double max_seconds = settings.value("MonitorSession.historySeconds", 60.0).toDouble();
+    const double max_megabytes = settings.value("MonitorSession.historyMegabytes", 16.0).toDouble();
+    const size_t capacity = size_t( max_megabytes * 1024 * 1024 / sizeof(Transition) );
+
+    _history.reset( _loaded_tree.nodesCount(), capacity, max_seconds );
+    for(size_t index = 0; index < _loaded_tree.nodesCount(); index++)
+    {
+        _history.setBaseStatus( int(index), _loaded_tree.nodes()[index].status );
+    }
+    _rewinding = false;
+}
+
+void MonitorSession::rewindTo(double timestamp)
+{
+    _rewinding = true;
+    _rewind_time = timestamp;
+    emit changeNodeStyle( _tab_name, _history.statusAfter( _history.countUntil(timestamp) ) );
+}
+
+void MonitorSession::goLive()
+{
+    if( !_rewinding ) return;
+    _rewinding = false;
+    _coalescer.reset( _loaded_tree.nodesCount() );
+    emit changeNodeStyle( _tab_name, _history.statusAfter( _history.size() ) );
+}
+
+MonitorSession::~MonitorSession()
+{
+    delete _recorder;
+    _receiver.unsubscribe( _subscription );
+    // the destructor stops and joins the thread
+    delete _fetcher;
+}
+
+void MonitorSession::connectToServer(const std::string &address_pub,
+                                     const std::string &address_req)
+{
+    closeConnection();
+
+    _connection_address_pub = address_pub;
+    _connection_address_req = address_req;
+    _msg_count = 0;
+    _dropped_count = 0;
+    _stats = MonitorStats();
+    _stats_timer.invalidate();
+    _stats_decode_ns = 0;
+
+    _subscription = _receiver.subscribe( _connection_address_pub );
+    _topics.clear();
+    _topics_enabled = QSettings().value("MonitorSession.visibleNodesOnly", true).toBool();
+    requestTreeFromServer();
+}
+
+void MonitorSession::disconnectFromServer()
+{
+    closeConnection();
+}
+
+void MonitorSession::closeConnection()
+{
+    stopRecording();
+    cancelTreeRequest();
+    _receiver.unsubscribe( _subscription );
+    _subscription.reset();
+    if( _connected )
+    {
+        _connected = false;
+        emit connectionUpdate(false);
+    }
+}
+
+void MonitorSession::update()
+{
+    if( !_connected || !_subscription ) return;
+
+    // the receiver thread did the reception and decoding, just apply
+    // the messages that are ready.
+    MonitorMessage msg;
+    bool received = false;
+
+    while( _subscription->pop(msg) )
+    {
+        received = true;
+        _msg_count++;
+
+        if( _fetcher )
+        {
+            // waiting for a new tree, keep showing the old one
+            _resync_needed = true;
+            continue;
+        }
+
+        // single pass: an unknown uid means that the tree changed on the
+        // server side and must be loaded again.
+        auto& nodes = _loaded_tree.nodes();
+        const bool block = msg.isBlock();
+        bool unknown_uid = !block && ( msg.header.size() + 1 != nodes.size() );
+
+        // The header contains the status of all the nodes. In steady state
+        // the transitions are enough; the header is used only to resync
+        // after we missed something. The keyframes are the only status of
+        // the nodes of the blocks not subscribed.
+        const int dropped_count = _subscription->droppedCount();
+        bool resync = _resync_needed || msg.isKeyframe() || ( dropped_count != _dropped_count );
+        _dropped_count = dropped_count;
+
+        if( !unknown_uid )
+        {
+            _stats.transitions += msg.transitions.size();
+            for(const auto& transition: msg.transitions)
+            {
+                const int index = _uid_to_index[transition.uid];
+                if( index == UNKNOWN_UID )
+                {
+                    unknown_uid = true;
+                    break;
+                }
+                auto& node = nodes[index];
+                if( node.status != transition.prev_status )
+                {
+                    // a transition got lost: sequence gap
+                    resync = true;
+                }
+                node.status = transition.status;
+                _coalescer.addTransition( index, transition.prev_status, transition.status );
+                _frame_transitions++;
+                _history.push( index, transition.timestamp, transition.prev_status, transition.status );
+                _last_timestamp = transition.timestamp;
+                if( _recorder )
+                {
+                    LogRecorder::encodeTransition( _record_batch, transition.uid, transition.timestamp,
+                                                   transition.prev_status, transition.status );
+                }
+            }
+        }
+
+        if( !unknown_uid && resync )
+        {
+            for(const auto& it: msg.header)
+            {
+                const int index = _uid_to_index[it.first];
+                if( index == UNKNOWN_UID )
+                {
+                    unknown_uid = true;
+                    break;
+                }
+                auto& node = nodes[index];
+                if( node.status != it.second )
+                {
+                    _coalescer.addTransition( index, node.status, it.second );
+                    _frame_transitions++;
+                    _history.push( index, _last_timestamp, node.status, it.second );
+                    if( _recorder )
+                    {
+                        LogRecorder::encodeTransition( _record_batch, it.first, _last_timestamp,
+                                                       node.status, it.second );
+                    }
+                    node.status = it.second;
+                }
+            }
+            // the other blocks are resynced by the next keyframe
+            if( !block )
+            {
+                _resync_needed = unknown_uid;
+            }
+        }
+
+        if( unknown_uid )
+        {
+            qDebug() << "Reload tree from server";
+            _coalescer.reset( _loaded_tree.nodesCount() );
+            _frame_transitions = 0;
+            requestTreeFromServer();
+        }
+    }
+
+    if( _recorder && !_record_batch.isEmpty() )
+    {
+        _recorder->append( _record_batch );
+        _record_batch.resize(0);
+    }
+
+    if( received && !msg.transitions.empty() )
+    {
+        const double now = QDateTime::currentMSecsSinceEpoch() * 0.001;
+        _stats.lag_ms = (now - _last_timestamp) * 1000.0;
+    }
+
+    if( received && _rewinding )
+    {
+        // showing the past: the live changes are only in the history
+        _coalescer.reset( _loaded_tree.nodesCount() );
+        _frame_transitions = 0;
+    }
+    else if( received )
+    {
+        QElapsedTimer apply_timer;
+        apply_timer.start();
+
+        // update the graphic part, once per frame
+        if( !_coalescer.empty() )
+        {
+            _stats.coalesced += std::max<int>( 0, _frame_transitions - int(_coalescer.dirtyCount()) );
+            _frame_transitions = 0;
+            emit changeNodeStyle( _tab_name, _coalescer.flush() );
+        }
+
+        // lock editing of nodes
+        _main_window->lockEditing(true);
+
+        _apply_time_ns += apply_timer.nsecsElapsed();
+        _apply_frames++;
+    }
+    updateTopics( false );
+    updateStats();
+}
+
+void MonitorSession::updateTopics(bool force)
+{
+    if( !_subscription || !_subscription->publishesTopics() || !_topics_enabled )
+    {
+        return;
+    }
+    if( !force && _topics_timer.isValid() && _topics_timer.elapsed() < TOPICS_UPDATE_MS )
+    {
+        return;
+    }
+    _topics_timer.start();
+
+    std::vector<std::string> topics;
+    auto container = _main_window->getTabByName( _tab_name );
+    if( !_recorder && !_fetcher && container && isLoadedTreeDisplayed() )
+    {
+        // only the nodes in the view, found by the index of the scene
+        const QRectF visible_rect = container->view()->visibleSceneRect();
+        std::set<int> blocks;
+        for(QtNodes::Node* node: container->scene()->nodeIndex().nodesIn( visible_rect ))
+        {
+            auto it = _displayed_index.find( node );
+            if( it == _displayed_index.end() || !node->nodeGraphicsObject().isVisible() )
+            {
+                continue;
+            }
+            const int uid = _index_to_uid[ size_t(it->second) ];
+            if( uid != UNKNOWN_UID )
+            {
+                blocks.insert( uid / MONITOR_BLOCK_SIZE );
+            }
+        }
+        topics.push_back( MONITOR_KEYFRAME_TOPIC );
+        for(int block: blocks)
+        {
+            topics.push_back( MonitorBlockTopic( block ) );
+        }
+    }
+    if( topics != _topics )
+    {
+        _topics = topics;
+        _subscription->setTopics( _topics );
+    }
+}
+
+void MonitorSession::requestTreeFromServer()
+{
+    if( _fetcher )
+    {
+        return; // already waiting for it
+    }
+    _fetch_request_id++;
+    _fetcher = new TreeFetcher( _zmq_context, _connection_address_req,
+                                _fetch_request_id, TREE_FETCH_TIMEOUT_MS, this );
+
+    connect( _fetcher, &TreeFetcher::progress,
+             this, &MonitorSession::onTreeFetchProgress );
+    connect( _fetcher, &TreeFetcher::treeReceived,
+             this, &MonitorSession::onTreeReceived );
+    connect( _fetcher, &TreeFetcher::fetchFailed,
+             this, &MonitorSession::onTreeFetchFailed );
+
+    emit fetchProgress( 0, TREE_FETCH_TIMEOUT_MS );
+    _fetcher->start();
+}
+
+void MonitorSession::cancelTreeRequest()
+{
+    if( _fetcher )
+    {
+        // late signals are discarded, thanks to _fetch_request_id
+        _fetch_request_id++;
+        _fetcher->cancel();
+        _fetcher->deleteLater();
+        _fetcher = nullptr;
+        emit fetchProgress( TREE_FETCH_TIMEOUT_MS, TREE_FETCH_TIMEOUT_MS );
+    }
+}
+
+void MonitorSession::onTreeFetchProgress(int request_id, int elapsed_ms)
+{
+    if( request_id != _fetch_request_id ) return;
+    emit fetchProgress( elapsed_ms, TREE_FETCH_TIMEOUT_MS );
+}
+
+void MonitorSession::onTreeReceived(int request_id, QByteArray buffer)
+{
+    if( request_id != _fetch_request_id ) return;
+    cancelTreeRequest();
+
+    if( !loadTreeFromBuffer(buffer) )
+    {
+        closeConnection();
+        return;
+    }
+
+    if( !_connected )
+    {
+        _connected = true;
+        emit connectionUpdate(true);
+    }
+}
+
+void MonitorSession::onTreeFetchFailed(int request_id, QString error)
+{
+    if( request_id != _fetch_request_id ) return;
+    qDebug() << "ZMQ client receive failed: " << error;
+
+    const bool was_connected = _connected;
+    closeConnection();
+
+    if( !was_connected )
+    {
+        emit connectionFailed( tr("Was not able to connect to [%1]\n").arg(_connection_address_pub.c_str()) );
+    }
+}
+
+bool MonitorSession::isLoadedTreeDisplayed()
+{
+    auto container = _main_window->getTabByName( _tab_name );
+    if( !container || container->isBuilding() )
+    {
+        // still built by GraphicContainer::loadSceneProgressively()
+        return false;
+    }
+    const auto& gui_nodes = container->nodesByIndex();
+    if( container == _displayed_container && container->revision() == _displayed_revision )
+    {
+        return _displayed;
+    }
+    _displayed_container = container;
+    _displayed_revision = container->revision();
+    _displayed = false;
+    _displayed_index.clear();
+
+    if( gui_nodes.size() != _loaded_tree.nodesCount() )
+    {
+        return false;
+    }
+    for(size_t index = 0; index < gui_nodes.size(); index++)
+    {
+        if( !gui_nodes[index] )
+        {
+            return false;
+        }
+        auto bt_model = dynamic_cast<BehaviorTreeDataModel*>( gui_nodes[index]->nodeDataModel() );
+        const auto& abs_node = _loaded_tree.nodes()[index];
+        if( !bt_model ||
+            bt_model->registrationName() != abs_node.model.registration_ID ||
+            bt_model->instanceName() != abs_node.instance_name )
+        {
+            return false;
+        }
+    }
+    _displayed_index.reserve( gui_nodes.size() );
+    for(size_t index = 0; index < gui_nodes.size(); index++)
+    {
+        _displayed_index[ gui_nodes[index] ] = int(index);
+    }
+    _displayed = true;
+    return true;
+}
+
+bool MonitorSession::loadTreeFromBuffer(const QByteArray& buffer)
+{
+    const QByteArray hash = QCryptographicHash::hash( buffer, QCryptographicHash::Sha1 );
+
+    if( hash == _loaded_tree_hash && isLoadedTreeDisplayed() )
+    {
+        // same tree as before (typically, a reconnection): no need to
+        // rebuild anything, just refresh the statuses.
+        _coalescer.reset( _loaded_tree.nodesCount() );
+        _resync_needed = true;
+        _rewinding = false;
+        emitFullStatus();
+        return true;
+    }
+
+    if( CachedMonitorTree* cached = _tree_cache.object( hash ) )
+    {
+        _loaded_tree = cached->tree;
+        _uid_to_index.assign( std::numeric_limits<uint16_t>::max() + 1, UNKNOWN_UID );
+        for(const auto& it: cached->uid_to_index)
+        {
+            _uid_to_index[ it.first ] = it.second;
+        }
+    }
+    else
+    {
+        auto fb_behavior_tree = Serialization::GetBehaviorTree( buffer.data() );
+
+        auto res_pair = BuildTreeFromFlatbuffers( fb_behavior_tree );
+
+        auto new_entry = new CachedMonitorTree;
+        new_entry->tree = res_pair.first;
+        new_entry->uid_to_index.reserve( res_pair.second.size() );
+
+        _loaded_tree  = std::move( res_pair.first );
+        // UIDs are uint16_t: a dense table is faster than a hash map
+        _uid_to_index.assign( std::numeric_limits<uint16_t>::max() + 1, UNKNOWN_UID );
+        for(const auto& it: res_pair.second)
+        {
+            _uid_to_index[ uint16_t(it.first) ] = it.second;
+            new_entry->uid_to_index.push_back( { uint16_t(it.first), it.second } );
+        }
+        _tree_cache.insert( hash, new_entry );
+    }
+    // a log file contains a single tree
+    stopRecording();
+
+    _index_to_uid.assign( _loaded_tree.nodesCount(), UNKNOWN_UID );
+    for(size_t uid = 0; uid < _uid_to_index.size(); uid++)
+    {
+        if( _uid_to_index[uid] != UNKNOWN_UID )
+        {
+            _index_to_uid[ size_t(_uid_to_index[uid]) ] = int(uid);
+        }
+    }
+    _loaded_tree_hash = hash;
+    _loaded_tree_buffer = buffer;
+    // compared again with the tab
+    _displayed_container.clear();
+    _coalescer.reset( _loaded_tree.nodesCount() );
+    _resync_needed = true;
+    resetHistory();
+
+    // add new models to registry
+    for(const auto& tree_node: _loaded_tree.nodes())
+    {
+        const auto& registration_ID = tree_node.model.registration_ID;
+        if( BuiltinNodeModels().count(registration_ID) == 0)
+        {
+            emit addNewModel( tree_node.model );
+        }
+    }
+
+    try {
+        emit loadBehaviorTree( _loaded_tree, _tab_name );
+    }
+    catch (std::exception& err) {
+        _loaded_tree_hash.clear();
+        emit connectionFailed( err.what() );
+        return false;
+    }
+
+    emitFullStatus();
+    return true;
+}
+
+void MonitorSession::emitFullStatus()
+{
+    std::vector<std::pair<int, NodeStatus>> node_status;
+    node_status.reserve(_loaded_tree.nodesCount());
+
+    for(size_t t=0; t < _loaded_tree.nodesCount(); t++)
+    {
+        node_status.push_back( { t, _loaded_tree.nodes()[t].status } );
+    }
+    emit changeNodeStyle( _tab_name, node_status );
+}
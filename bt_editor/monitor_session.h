@@ -0,0 +1,233 @@
+#ifndef MONITOR_SESSION_H
+#define MONITOR_SESSION_H
+
+#include <QObject>
+#include <QCache>
+#include <QElapsedTimer>
+#include <QJsonObject>
+#include <QPointer>
+#include <unordered_map>
+#include <zmq.hpp>
+
+#include "bt_editor_base.h"
+#include "monitor_receiver.h"
+#include "tree_fetcher.h"
+#include "status_coalescer.h"
+#include "transition_history.h"
+#include "log_recorder.h"
+
+class MainWindow;
+class GraphicContainer;
+
+// A tree already received from a server, cached by hash of its serialization.
+struct CachedMonitorTree
+{
+    AbsBehaviorTree tree;
+    std::vector<std::pair<uint16_t, int>> uid_to_index;
+};
+
+typedef QCache<QByteArray, CachedMonitorTree> MonitorTreeCache;
+
+// Throughput and latency of a session. Counters are cumulative, rates are
+// averaged over the last second.
+struct MonitorStats
+{
+    int messages = 0;
+    long long bytes = 0;
+    // messages discarded because the queue was full
+    int dropped = 0;
+    long long transitions = 0;
+    // transitions folded into a later one before being drawn
+    long long coalesced = 0;
+
+    double messages_per_sec = 0;
+    double bytes_per_sec = 0;
+    double decode_us_per_message = 0;
+    // wall clock minus timestamp of the latest transition; meaningful only
+    // if the clocks of the robot and of this computer are synchronized
+    double lag_ms = 0;
+    // time spent by the GUI to apply the statuses of a frame
+    double apply_us_per_frame = 0;
+
+    QJsonObject toJson() const;
+};
+
+// Connection to a single BT server (i.e. a robot), displayed in its own tab.
+// All the sessions share the receiver thread, the tree cache and the
+// model registry.
+class MonitorSession : public QObject
+{
+    Q_OBJECT
+
+public:
+    MonitorSession(const QString& tab_name,
+                   zmq::context_t& context,
+                   MonitorReceiver& receiver,
+                   MonitorTreeCache& tree_cache,
+                   MainWindow* main_window,
+                   QObject* parent = nullptr);
+
+    ~MonitorSession() override;
+
+    // Subscribes and requests the tree; the connection is completed when the
+    // tree is received. Throws zmq::error_t on failure.
+    void connectToServer(const std::string& address_pub,
+                         const std::string& address_req);
+
+    void disconnectFromServer();
+
+    bool isConnected() const { return _connected; }
+
+    bool isConnecting() const { return !_connected && _fetcher != nullptr; }
+
+    const QString& tabName() const { return _tab_name; }
+
+    const std::string& publisherAddress() const { return _connection_address_pub; }
+
+    int messagesCount() const { return _msg_count; }
+
+    const MonitorStats& stats() const { return _stats; }
+
+    // Drain the received messages and emit changeNodeStyle, at most once.
+    // Meant to be called once per frame.
+    void update();
+
+    const TransitionHistory& history() const { return _history; }
+
+    const AbsBehaviorTree& loadedTree() const { return _loaded_tree; }
+
+    // Show the status of the tree at a past time still in the history.
+    // Live messages are still received and recorded meanwhile.
+    void rewindTo(double timestamp);
+
+    void goLive();
+
+    bool isRewinding() const { return _rewinding; }
+
+    double rewindTime() const { return _rewind_time; }
+
+    // Record the received transitions to a .fbl file, until stopRecording()
+    // or until the tree changes. Returns false and sets "error" on failure.
+    bool startRecording(const QString& filename, QString& error);
+
+    void stopRecording();
+
+    bool isRecording() const { return _recorder != nullptr; }
+
+    // why the last recording stopped by itself, empty if it did not
+    const QString& recordingError() const { return _recording_error; }
+
+    static const int TREE_FETCH_TIMEOUT_MS = 3000;
+
+    // the visible part of the tab is checked at this period, when the server
+    // publishes by blocks of nodes
+    static const int TOPICS_UPDATE_MS = 250;
+
+signals:
+    void loadBehaviorTree(const AbsBehaviorTree& tree, const QString &bt_name );
+
+    void connectionUpdate(bool connected);
+
+    void connectionFailed(QString error);
+
+    void fetchProgress(int elapsed_ms, int timeout_ms);
+
+    void changeNodeStyle(const QString& bt_name,
+                         const std::vector<std::pair<int, NodeStatus>>& node_status);
+
+    void addNewModel(const NodeModel &new_model);
+
+    void recordingStopped(QString filename);
+
+    // the recording was stopped because the file could not be written
+    void recordingFailed(QString filename, QString error);
+
+private slots:
+
+    void onTreeFetchProgress(int request_id, int elapsed_ms);
+
+    void onTreeReceived(int request_id, QByteArray buffer);
+
+    void onTreeFetchFailed(int request_id, QString error);
+
+private:
+    QString _tab_name;
+    zmq::context_t& _zmq_context;
+    MonitorReceiver& _receiver;
+    MonitorTreeCache& _tree_cache;
+    MainWindow* _main_window;
+
+    MonitorReceiver::SubscriptionPtr _subscription;
+    TreeFetcher* _fetcher;
+    int _fetch_request_id;
+
+    bool _connected;
+    std::string _connection_address_pub;
+    std::string _connection_address_req;
+    int _msg_count;
+    int _dropped_count;
+    // apply the full snapshot in the header of the next message
+    bool _resync_needed;
+
+    QByteArray _loaded_tree_hash;
+    QByteArray _loaded_tree_buffer;
+    AbsBehaviorTree _loaded_tree;
+    // uid to index in _loaded_tree, UNKNOWN_UID if not present
+    std::vector<int> _uid_to_index;
+    enum { UNKNOWN_UID = -1 };
+    // the reverse, UNKNOWN_UID for the Root
+    std::vector<int> _index_to_uid;
+
+    // The blocks of the nodes that are visible in the tab, see
+    // MonitorBlockTopic(); empty for all the messages.
+    bool _topics_enabled;
+    std::vector<std::string> _topics;
+    QElapsedTimer _topics_timer;
+    StatusCoalescer _coalescer;
+    TransitionHistory _history;
+    bool _rewinding;
+    double _rewind_time;
+    double _last_timestamp;
+
+    LogRecorder* _recorder;
+    QByteArray _record_batch;
+    QString _recording_error;
+
+    MonitorStats _stats;
+    QElapsedTimer _stats_timer;
+    MonitorStats _stats_snapshot;
+    long long _stats_decode_ns;
+    long long _apply_time_ns;
+    int _apply_frames;
+    int _frame_transitions;
+
+    void updateStats();
+
+    // subscribes to the blocks of the visible nodes only, if the server
+    // publishes them; to all the messages while recording
+    void updateTopics(bool force);
+
+    void resetHistory();
+
+    void requestTreeFromServer();
+
+    void cancelTreeRequest();
+
+    bool loadTreeFromBuffer(const QByteArray& buffer);
+
+    // cached for each revision of the tab
+    bool isLoadedTreeDisplayed();
+
+    // the last tab and revision compared by isLoadedTreeDisplayed()
+    QPointer<GraphicContainer> _displayed_container;
+    unsigned _displayed_revision;
+    bool _displayed;
+    // index in _loaded_tree of the graphic nodes, when displayed
+    std::unordered_map<const QtNodes::Node*, int> _displayed_index;
+
+    void emitFullStatus();
+
+    void closeConnection();
+};
+
+#endif // MONITOR_SESSION_H
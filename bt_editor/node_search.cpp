@@ -0,0 +1,87 @@
+#include "node_search.h"
+#include "models/BehaviorTreeNodeModel.hpp"
+#include <algorithm>
+
+QString NodeSearchIndex::searchableText(const QtNodes::Node &node)
+{
+    auto bt_model = dynamic_cast<const BehaviorTreeDataModel*>( node.nodeDataModel() );
+    if( !bt_model )
+    {
+        return node.nodeDataModel()->name();
+    }
+    // one per line: a match does not span two fields
+    QString text = bt_model->instanceName();
+    text += '\n';
+    text += bt_model->registrationName();
+    for (const auto& port_it: bt_model->getCurrentPortMapping())
+    {
+        if( !port_it.second.isEmpty() )
+        {
+            text += '\n';
+            text += port_it.second;
+        }
+    }
+    return text;
+}
+
+void PortValueIndex::update(QtNodes::Node &node)
+{
+    std::vector<QString> values;
+    if( auto bt_model = dynamic_cast<const BehaviorTreeDataModel*>( node.nodeDataModel() ) )
+    {
+        for (const auto& port_it: bt_model->getCurrentPortMapping())
+        {
+            if( !port_it.second.isEmpty() )
+            {
+                values.push_back( port_it.second );
+            }
+        }
+        std::sort( values.begin(), values.end() );
+        values.erase( std::unique( values.begin(), values.end() ), values.end() );
+    }
+
+    auto it = _values_of_node.find( &node );
+    if( it != _values_of_node.end() && it->second == values )
+    {
+        return;
+    }
+    remove( node );
+    if( values.empty() )
+    {
+        return;
+    }
+    for (const QString& value: values)
+    {
+        _nodes_by_value[value].insert( &node );
+    }
+    _values_of_node.insert( { &node, std::move(values) } );
+}
+
+void PortValueIndex::remove(QtNodes::Node &node)
+{
+    auto it = _values_of_node.find( &node );
+    if( it == _values_of_node.end() )
+    {
+        return;
+    }
+    for (const QString& value: it->second)
+    {
+        auto value_it = _nodes_by_value.find( value );
+        if( value_it != _nodes_by_value.end() )
+        {
+            value_it->erase( &node );
+            if( value_it->empty() )
+            {
+                _nodes_by_value.erase( value_it );
+            }
+        }
+    }
+    _values_of_node.erase( it );
+}
+
+const std::set<QtNodes::Node *> &PortValueIndex::nodesWithValue(const QString &value) const
+{
+    static const std::set<QtNodes::Node*> no_nodes;
+    auto it = _nodes_by_value.find( value );
+    return ( it == _nodes_by_value.end() ) ? no_nodes : *it;
+}
@@ -0,0 +1,47 @@
+#ifndef NODE_SEARCH_H
+#define NODE_SEARCH_H
+
+#include <vector>
+#include <set>
+#include <QHash>
+#include <nodes/Node>
+#include "trigram_index.h"
+
+// Index of the nodes of a scene by instance name, registration ID and port
+// values, for the "Find Node" of the editor.
+class NodeSearchIndex
+{
+public:
+    // the text of the node is recomputed from its model
+    void update(QtNodes::Node& node) { _index.update( &node, searchableText( node ) ); }
+
+    void remove(QtNodes::Node& node) { _index.remove( &node ); }
+
+    // the nodes containing "query", ignoring the case
+    std::vector<QtNodes::Node*> find(const QString& query) const { return _index.find( query ); }
+
+    // what the index compares for a node
+    static QString searchableText(const QtNodes::Node& node);
+
+private:
+    TrigramIndex<QtNodes::Node*> _index;
+};
+
+// The nodes using each port value, as the blackboard keys "{key}": the
+// ports to highlight are found without looking at the other nodes.
+class PortValueIndex
+{
+public:
+    // the values of the node are read again from its model
+    void update(QtNodes::Node& node);
+
+    void remove(QtNodes::Node& node);
+
+    const std::set<QtNodes::Node*>& nodesWithValue(const QString& value) const;
+
+private:
+    QHash<QString, std::set<QtNodes::Node*>> _nodes_by_value;
+    std::unordered_map<QtNodes::Node*, std::vector<QString>> _values_of_node;
+};
+
+#endif // NODE_SEARCH_H
@@ -0,0 +1,239 @@
+#include "node_statistics.h"
+#include <QThreadPool>
+#include <QRunnable>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+const double NOT_RUNNING = std::numeric_limits<double>::quiet_NaN();
+
+// Partial result of a range of rows. The RUNNING intervals crossing the
+// boundaries of the range are completed by the merge.
+struct Shard
+{
+    std::vector<NodeStatistics> nodes;
+    // time of the first exit from RUNNING, of the nodes that were already
+    // RUNNING when the range begins
+    std::vector<double> first_exit;
+    // time of the last entry in RUNNING, of the nodes still RUNNING when the
+    // range ends
+    std::vector<double> open_since;
+    std::vector<double> restarts;
+};
+
+void addRunningInterval(NodeStatistics& stats, double duration)
+{
+    stats.running_time += duration;
+    stats.max_running_time = std::max( stats.max_running_time, duration );
+}
+
+void computeShard(const TransitionStore& transitions, size_t begin, size_t end,
+                  int nodes_count, const std::atomic<bool>* cancelled, Shard& shard)
+{
+    shard.nodes.assign( size_t(nodes_count), NodeStatistics() );
+    shard.first_exit.assign( size_t(nodes_count), NOT_RUNNING );
+    shard.open_since.assign( size_t(nodes_count), NOT_RUNNING );
+    std::vector<bool> exited( size_t(nodes_count), false );
+
+    for(size_t row = begin; row < end; row++)
+    {
+        if( cancelled && (row % 65536) == 0 && cancelled->load() )
+        {
+            return;
+        }
+        const int index = transitions.index(row);
+        if( index < 0 || index >= nodes_count )
+        {
+            continue;
+        }
+        const NodeStatus status = transitions.status(row);
+        const NodeStatus prev_status = transitions.prevStatus(row);
+        const double timestamp = transitions.timestamp(row);
+        NodeStatistics& stats = shard.nodes[index];
+
+        switch( status )
+        {
+        case NodeStatus::SUCCESS: stats.success++; break;
+        case NodeStatus::FAILURE: stats.failure++; break;
+        case NodeStatus::RUNNING: stats.running++; break;
+        default: break;
+        }
+        if( prev_status == NodeStatus::IDLE && status != NodeStatus::IDLE )
+        {
+            stats.ticks++;
+        }
+
+        double& open_since = shard.open_since[index];
+        if( status == NodeStatus::RUNNING && prev_status != NodeStatus::RUNNING )
+        {
+            open_since = timestamp;
+        }
+        else if( prev_status == NodeStatus::RUNNING && status != NodeStatus::RUNNING )
+        {
+            if( !std::isnan( open_since ) )
+            {
+                addRunningInterval( stats, timestamp - open_since );
+                open_since = NOT_RUNNING;
+            }
+            else if( !exited[index] )
+            {
+                // it entered RUNNING before this range
+                shard.first_exit[index] = timestamp;
+            }
+            exited[index] = true;
+        }
+
+        if( transitions.isTreeRestart(row) )
+        {
+            shard.restarts.push_back( timestamp );
+        }
+    }
+}
+
+class ShardTask : public QRunnable
+{
+public:
+    ShardTask(const TransitionStore& transitions, size_t begin, size_t end,
+              int nodes_count, const std::atomic<bool>* cancelled, Shard& shard):
+        _transitions(transitions), _begin(begin), _end(end),
+        _nodes_count(nodes_count), _cancelled(cancelled), _shard(shard)
+    {}
+
+    void run() override
+    {
+        computeShard( _transitions, _begin, _end, _nodes_count, _cancelled, _shard );
+    }
+
+private:
+    const TransitionStore& _transitions;
+    size_t _begin;
+    size_t _end;
+    int _nodes_count;
+    const std::atomic<bool>* _cancelled;
+    Shard& _shard;
+};
+
+} // end anonymous namespace
+
+ReplayStatistics ReplayStatistics::compute(const TransitionStore &transitions, size_t rows,
+                                           int nodes_count, int shards,
+                                           const std::atomic<bool> *cancelled)
+{
+    ReplayStatistics result;
+    rows = std::min( rows, transitions.size() );
+    if( nodes_count <= 0 )
+    {
+        return result;
+    }
+    // small logs are not worth a thread
+    const size_t MIN_SHARD_ROWS = 64*1024;
+    shards = int( std::max<size_t>( 1, std::min( size_t(std::max(1, shards)),
+                                                 rows / MIN_SHARD_ROWS ) ) );
+
+    std::vector<Shard> partial( size_t(shards) );
+    const size_t rows_per_shard = (rows + size_t(shards) - 1) / size_t(shards);
+
+    QThreadPool pool;
+    pool.setMaxThreadCount( shards );
+    for(int s = 0; s < shards; s++)
+    {
+        const size_t begin = std::min( rows, size_t(s) * rows_per_shard );
+        const size_t end = std::min( rows, begin + rows_per_shard );
+        // the pool deletes the task
+        pool.start( new ShardTask( transitions, begin, end, nodes_count, cancelled, partial[s] ) );
+    }
+    pool.waitForDone();
+
+    if( cancelled && cancelled->load() )
+    {
+        return result;
+    }
+
+    // merge in order, completing the intervals that cross the shards
+    result.nodes.assign( size_t(nodes_count), NodeStatistics() );
+    std::vector<double> open_since( size_t(nodes_count), NOT_RUNNING );
+    std::vector<double> restarts;
+
+    for(const Shard& shard: partial)
+    {
+        for(size_t index = 0; index < size_t(nodes_count); index++)
+        {
+            const NodeStatistics& part = shard.nodes[index];
+            NodeStatistics& total = result.nodes[index];
+            total.ticks += part.ticks;
+            total.success += part.success;
+            total.failure += part.failure;
+            total.running += part.running;
+            total.running_time += part.running_time;
+            total.max_running_time = std::max( total.max_running_time, part.max_running_time );
+
+            if( !std::isnan( shard.first_exit[index] ) )
+            {
+                if( !std::isnan( open_since[index] ) )
+                {
+                    addRunningInterval( total, shard.first_exit[index] - open_since[index] );
+                }
+                open_since[index] = NOT_RUNNING;
+            }
+            if( !std::isnan( shard.open_since[index] ) )
+            {
+                open_since[index] = shard.open_since[index];
+            }
+        }
+        restarts.insert( restarts.end(), shard.restarts.begin(), shard.restarts.end() );
+    }
+
+    result.restarts = restarts.size();
+    if( restarts.size() >= 2 )
+    {
+        result.min_restart_interval = std::numeric_limits<double>::max();
+        for(size_t i = 1; i < restarts.size(); i++)
+        {
+            const double interval = restarts[i] - restarts[i-1];
+            result.min_restart_interval = std::min( result.min_restart_interval, interval );
+            result.max_restart_interval = std::max( result.max_restart_interval, interval );
+        }
+        result.mean_restart_interval = (restarts.back() - restarts.front()) /
+                                       double( restarts.size() - 1 );
+    }
+    return result;
+}
+
+StatisticsWorker::StatisticsWorker(const TransitionStore &transitions,
+                                   int nodes_count,
+                                   int request_id,
+                                   QObject *parent):
+    QThread(parent),
+    _transitions(transitions),
+    _rows(transitions.size()),
+    _nodes_count(nodes_count),
+    _request_id(request_id),
+    _cancelled(false)
+{
+    qRegisterMetaType<ReplayStatisticsPtr>();
+}
+
+StatisticsWorker::~StatisticsWorker()
+{
+    cancel();
+    wait();
+}
+
+void StatisticsWorker::cancel()
+{
+    _cancelled.store(true);
+}
+
+void StatisticsWorker::run()
+{
+    const int shards = std::max( 1, QThread::idealThreadCount() );
+    auto statistics = std::make_shared<ReplayStatistics>(
+                ReplayStatistics::compute( _transitions, _rows, _nodes_count, shards, &_cancelled ) );
+
+    if( !_cancelled.load() )
+    {
+        emit statisticsReady( _request_id, statistics );
+    }
+}
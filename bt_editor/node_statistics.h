@@ -0,0 +1,80 @@
+#ifndef NODE_STATISTICS_H
+#define NODE_STATISTICS_H
+
+#include <QThread>
+#include <QMetaType>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <cstdint>
+
+#include "transition_store.h"
+
+struct NodeStatistics
+{
+    // transitions out of IDLE
+    uint64_t ticks = 0;
+    uint64_t success = 0;
+    uint64_t failure = 0;
+    uint64_t running = 0;
+    // seconds
+    double running_time = 0;
+    double max_running_time = 0;
+};
+
+struct ReplayStatistics
+{
+    // by node index
+    std::vector<NodeStatistics> nodes;
+
+    uint64_t restarts = 0;
+    // seconds between two consecutive restarts of the tree
+    double min_restart_interval = 0;
+    double mean_restart_interval = 0;
+    double max_restart_interval = 0;
+
+    // Statistics of the first "rows" transitions. The rows are split in
+    // "shards" ranges, processed in parallel and then merged in order.
+    // Returns an empty result if "cancelled" becomes true.
+    static ReplayStatistics compute(const TransitionStore& transitions, size_t rows,
+                                    int nodes_count, int shards,
+                                    const std::atomic<bool>* cancelled = nullptr);
+};
+
+typedef std::shared_ptr<ReplayStatistics> ReplayStatisticsPtr;
+
+// Computes the statistics on its own thread. The store must not be modified
+// until the thread is finished.
+class StatisticsWorker : public QThread
+{
+    Q_OBJECT
+
+public:
+    StatisticsWorker(const TransitionStore& transitions,
+                     int nodes_count,
+                     int request_id,
+                     QObject* parent = nullptr);
+
+    ~StatisticsWorker() override;
+
+    void cancel();
+
+    int requestId() const { return _request_id; }
+
+signals:
+    void statisticsReady(int request_id, ReplayStatisticsPtr statistics);
+
+protected:
+    void run() override;
+
+private:
+    const TransitionStore& _transitions;
+    size_t _rows;
+    int _nodes_count;
+    int _request_id;
+    std::atomic<bool> _cancelled;
+};
+
+Q_DECLARE_METATYPE(ReplayStatisticsPtr)
+
+#endif // NODE_STATISTICS_H
@@ -0,0 +1,72 @@
+#include "port_value_dialog.h"
+#include <QVBoxLayout>
+#include <QTableView>
+#include <QHeaderView>
+#include <QLabel>
+#include <QStandardItemModel>
+#include <QSortFilterProxyModel>
+#include <QDialogButtonBox>
+
+namespace {
+
+enum Column { TREE, NODE, PORT, DIRECTION };
+
+const int NODE_ID_ROLE = Qt::UserRole;
+
+} // end anonymous namespace
+
+PortValueDialog::PortValueDialog(const QString &value,
+                                 const std::vector<PortValueUser> &users,
+                                 QWidget *parent):
+    QDialog(parent)
+{
+    setWindowTitle( tr("Users of %1").arg( value ) );
+    resize( 600, 400 );
+
+    auto model = new QStandardItemModel( 0, 4, this );
+    model->setHorizontalHeaderLabels( { tr("Tree"), tr("Node"), tr("Port"), tr("Direction") } );
+
+    int readers = 0;
+    int writers = 0;
+    for (const auto& user: users)
+    {
+        QList<QStandardItem*> row;
+        row.push_back( new QStandardItem( user.tab ) );
+        row.push_back( new QStandardItem( user.instance_name ) );
+        row.push_back( new QStandardItem( user.port ) );
+        row.push_back( new QStandardItem( QString::fromStdString( toStr( user.direction ) ) ) );
+        row.front()->setData( user.node, NODE_ID_ROLE );
+        model->appendRow( row );
+
+        readers += ( user.direction != PortDirection::OUTPUT ) ? 1 : 0;
+        writers += ( user.direction != PortDirection::INPUT ) ? 1 : 0;
+    }
+
+    auto proxy = new QSortFilterProxyModel( this );
+    proxy->setSourceModel( model );
+
+    auto table = new QTableView( this );
+    table->setModel( proxy );
+    table->setSortingEnabled( true );
+    table->setEditTriggers( QAbstractItemView::NoEditTriggers );
+    table->setSelectionBehavior( QAbstractItemView::SelectRows );
+    table->verticalHeader()->setVisible( false );
+    table->horizontalHeader()->setSectionResizeMode( NODE, QHeaderView::Stretch );
+    table->sortByColumn( TREE, Qt::AscendingOrder );
+
+    connect( table, &QTableView::doubleClicked, this, [this, proxy](const QModelIndex& index)
+    {
+        const QModelIndex tree_index = proxy->index( index.row(), TREE );
+        emit nodeActivated( tree_index.data().toString(),
+                            tree_index.data( NODE_ID_ROLE ).toUuid() );
+    } );
+
+    auto buttons = new QDialogButtonBox( QDialogButtonBox::Close, this );
+    connect( buttons, &QDialogButtonBox::rejected, this, &QDialog::reject );
+
+    auto layout = new QVBoxLayout( this );
+    layout->addWidget( new QLabel( tr("%1 readers and %2 writers. Double click to show a node.")
+                                   .arg( readers ).arg( writers ), this ) );
+    layout->addWidget( table );
+    layout->addWidget( buttons );
+}
@@ -0,0 +1,35 @@
+#ifndef PORT_VALUE_DIALOG_H
+#define PORT_VALUE_DIALOG_H
+
+#include <QDialog>
+#include <QUuid>
+#include <vector>
+
+#include "bt_editor_base.h"
+
+// A port of a node set to a given value
+struct PortValueUser
+{
+    QString tab;
+    QUuid node;
+    QString instance_name;
+    QString port;
+    PortDirection direction;
+};
+
+// Table of the readers and writers of a blackboard key (or of any port
+// value), in all the trees.
+class PortValueDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    PortValueDialog(const QString& value,
+                    const std::vector<PortValueUser>& users,
+                    QWidget* parent = nullptr);
+
+signals:
+    void nodeActivated(QString tab, QUuid node);
+};
+
+#endif // PORT_VALUE_DIALOG_H
@@ -0,0 +1,447 @@
+#include "project_cache.h"
+#include "tree_layout.h"
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+namespace
+{
+
+const quint32 CACHE_MAGIC   = 0x47505243; // "GPRC"
+const quint32 CACHE_VERSION = 1;
+
+// the oldest projects are removed
+const int CACHED_PROJECTS = 32;
+
+const char* TREES_SUFFIX  = ".trees";
+const char* LAYOUT_SUFFIX = ".layouts";
+
+QString cacheDirectory()
+{
+    return QStandardPaths::writableLocation( QStandardPaths::CacheLocation ) + "/projects";
+}
+
+QString cacheFile(const QByteArray& key, const char* suffix)
+{
+    return cacheDirectory() + "/" + QString::fromLatin1( key.toHex() ) + suffix;
+}
+
+QByteArray fileHash(const QString& path)
+{
+    QFile file( path );
+    if( !file.open( QIODevice::ReadOnly ) )
+    {
+        return QByteArray();
+    }
+    QCryptographicHash hash( QCryptographicHash::Sha1 );
+    hash.addData( &file );
+    return hash.result();
+}
+
+//------------ writing ------------
+
+void write(QDataStream& out, const PortModel& port)
+{
+    out << port.type_name << qint32( port.direction ) << port.description << port.default_value;
+}
+
+void write(QDataStream& out, const NodeModel& model)
+{
+    out << qint32( model.type ) << model.registration_ID << quint32( model.ports.size() );
+    for (const auto& it: model.ports)
+    {
+        out << it.first;
+        write( out, it.second );
+    }
+}
+
+void write(QDataStream& out, const XMLTree& xml_tree)
+{
+    out << xml_tree.name << xml_tree.has_ID << xml_tree.has_root_tag << xml_tree.file;
+
+    const auto& nodes = xml_tree.tree.nodes();
+    out << quint32( nodes.size() );
+    for (const auto& node: nodes)
+    {
+        // before ResolveTreeModels(), the model is only an ID
+        out << node.model.registration_ID << node.instance_name << quint32( node.ports_mapping.size() );
+        for (const auto& it: node.ports_mapping)
+        {
+            out << it.first << it.second;
+        }
+        out << quint32( node.children_index.size() );
+        for (int child: node.children_index)
+        {
+            out << qint32( child );
+        }
+    }
+    out << quint32( xml_tree.lines.size() );
+    for (qint64 line: xml_tree.lines)
+    {
+        out << line;
+    }
+}
+
+void write(QDataStream& out, const LayoutSnapshot& snapshot, const std::vector<QPointF>& positions)
+{
+    out << qint32( snapshot.layout ) << qint32( snapshot.root ) << quint32( snapshot.sizes.size() );
+    for (size_t i = 0; i < snapshot.sizes.size(); i++)
+    {
+        out << snapshot.sizes[i] << positions[i] << quint32( snapshot.children[i].size() );
+        for (int child: snapshot.children[i])
+        {
+            out << qint32( child );
+        }
+    }
+}
+
+//------------ reading ------------
+
+// every count is checked against what is left, a damaged file fails
+bool readCount(QDataStream& in, quint32& count)
+{
+    in >> count;
+    return in.status() == QDataStream::Ok && count <= quint32( in.device()->bytesAvailable() );
+}
+
+bool read(QDataStream& in, PortModel& port)
+{
+    qint32 direction;
+    in >> port.type_name >> direction >> port.description >> port.default_value;
+    port.direction = PortDirection( direction );
+    return in.status() == QDataStream::Ok;
+}
+
+bool read(QDataStream& in, NodeModel& model)
+{
+    qint32 type;
+    quint32 count;
+    in >> type >> model.registration_ID;
+    model.type = NodeType( type );
+    if( !readCount( in, count ) )
+    {
+        return false;
+    }
+    for (quint32 i = 0; i < count; i++)
+    {
+        QString name;
+        PortModel port;
+        in >> name;
+        if( !read( in, port ) )
+        {
+            return false;
+        }
+        model.ports.insert( { name, std::move(port) } );
+    }
+    return true;
+}
+
+bool read(QDataStream& in, XMLTree& xml_tree)
+{
+    quint32 count;
+    in >> xml_tree.name >> xml_tree.has_ID >> xml_tree.has_root_tag >> xml_tree.file;
+    if( !readCount( in, count ) )
+    {
+        return false;
+    }
+    auto& nodes = xml_tree.tree.nodes();
+    for (quint32 index = 0; index < count; index++)
+    {
+        AbstractTreeNode node;
+        node.index = int(index);
+        quint32 ports;
+        in >> node.model.registration_ID >> node.instance_name;
+        if( !readCount( in, ports ) )
+        {
+            return false;
+        }
+        for (quint32 p = 0; p < ports; p++)
+        {
+            QString name, value;
+            in >> name >> value;
+            node.ports_mapping.insert( { name, value } );
+        }
+        quint32 children;
+        if( !readCount( in, children ) )
+        {
+            return false;
+        }
+        for (quint32 c = 0; c < children; c++)
+        {
+            qint32 child;
+            in >> child;
+            if( child <= int(index) || child >= int(count) )
+            {
+                return false;
+            }
+            node.children_index.push_back( child );
+        }
+        nodes.push_back( std::move(node) );
+    }
+    if( !readCount( in, count ) || count != nodes.size() )
+    {
+        return false;
+    }
+    xml_tree.lines.resize( count );
+    for (auto& line: xml_tree.lines)
+    {
+        in >> line;
+    }
+    return in.status() == QDataStream::Ok;
+}
+
+bool read(QDataStream& in, CachedLayout& layout)
+{
+    qint32 port_layout, root;
+    quint32 count;
+    in >> port_layout >> root;
+    layout.snapshot.layout = QtNodes::PortLayout( port_layout );
+    layout.snapshot.root = root;
+    if( !readCount( in, count ) )
+    {
+        return false;
+    }
+    layout.snapshot.sizes.resize( count );
+    layout.snapshot.children.resize( count );
+    layout.positions.resize( count );
+    for (quint32 i = 0; i < count; i++)
+    {
+        quint32 children;
+        in >> layout.snapshot.sizes[i] >> layout.positions[i];
+        if( !readCount( in, children ) )
+        {
+            return false;
+        }
+        for (quint32 c = 0; c < children; c++)
+        {
+            qint32 child;
+            in >> child;
+            if( child < 0 || child >= int(count) )
+            {
+                return false;
+            }
+            layout.snapshot.children[i].push_back( child );
+        }
+    }
+    return in.status() == QDataStream::Ok && root < int(count);
+}
+
+bool readHeader(QDataStream& in)
+{
+    quint32 magic, version;
+    in >> magic >> version;
+    in.setVersion( QDataStream::Qt_5_0 );
+    return in.status() == QDataStream::Ok && magic == CACHE_MAGIC && version == CACHE_VERSION;
+}
+
+void writeHeader(QDataStream& out)
+{
+    out << CACHE_MAGIC << CACHE_VERSION;
+    out.setVersion( QDataStream::Qt_5_0 );
+}
+
+void removeOldProjects()
+{
+    QDir dir( cacheDirectory() );
+    const QFileInfoList files = dir.entryInfoList( { QString("*") + TREES_SUFFIX },
+                                                   QDir::Files, QDir::Time );
+    for (int i = CACHED_PROJECTS; i < files.size(); i++)
+    {
+        dir.remove( files[i].fileName() );
+        dir.remove( files[i].completeBaseName() + LAYOUT_SUFFIX );
+    }
+}
+
+}
+
+QByteArray ProjectCacheKey(const QString &xml_text, const QString &directory)
+{
+    QCryptographicHash hash( QCryptographicHash::Sha1 );
+    hash.addData( directory.toUtf8() );
+    hash.addData( "\n" );
+    hash.addData( xml_text.toUtf8() );
+    return hash.result();
+}
+
+bool ReadProjectCache(const QByteArray &key, XMLDocumentContent &content)
+{
+    QFile file( cacheFile( key, TREES_SUFFIX ) );
+    if( !file.open( QIODevice::ReadOnly ) )
+    {
+        return false;
+    }
+    QDataStream in( &file );
+    if( !readHeader( in ) )
+    {
+        return false;
+    }
+
+    XMLDocumentContent cached;
+    quint32 count;
+
+    // each included file is checked as the parse cache of ReadXMLProject()
+    if( !readCount( in, count ) )
+    {
+        return false;
+    }
+    for (quint32 i = 0; i < count; i++)
+    {
+        QString path;
+        QDateTime modified;
+        qint64 size;
+        QByteArray hash;
+        in >> path >> modified >> size >> hash;
+        const QFileInfo info( path );
+        if( in.status() != QDataStream::Ok || !info.exists() )
+        {
+            return false;
+        }
+        if( ( info.lastModified() != modified || info.size() != size ) && fileHash( path ) != hash )
+        {
+            return false;
+        }
+        cached.included_files.push_back( path );
+    }
+
+    in >> cached.main_tree;
+    if( !readCount( in, count ) )
+    {
+        return false;
+    }
+    for (quint32 i = 0; i < count; i++)
+    {
+        NodeModel model;
+        if( !read( in, model ) )
+        {
+            return false;
+        }
+        cached.models.insert( { model.registration_ID, std::move(model) } );
+    }
+
+    if( !readCount( in, count ) )
+    {
+        return false;
+    }
+    cached.trees.resize( count );
+    for (auto& xml_tree: cached.trees)
+    {
+        if( !read( in, xml_tree ) )
+        {
+            return false;
+        }
+    }
+
+    if( !readCount( in, count ) )
+    {
+        return false;
+    }
+    cached.includes.resize( count );
+    for (auto& include: cached.includes)
+    {
+        in >> include.path >> include.line;
+    }
+    if( in.status() != QDataStream::Ok )
+    {
+        return false;
+    }
+    content = std::move(cached);
+
+    // without them, the layouts are computed again
+    QFile layout_file( cacheFile( key, LAYOUT_SUFFIX ) );
+    if( layout_file.open( QIODevice::ReadOnly ) )
+    {
+        QDataStream layout_in( &layout_file );
+        if( readHeader( layout_in ) && readCount( layout_in, count ) )
+        {
+            std::vector<CachedLayout> layouts( count );
+            for (auto& layout: layouts)
+            {
+                if( !read( layout_in, layout ) )
+                {
+                    layouts.clear();
+                    break;
+                }
+            }
+            // the most recently used is added last, as the first in the cache
+            for (auto it = layouts.rbegin(); it != layouts.rend(); ++it)
+            {
+                AddCachedTreeLayout( std::move(*it) );
+            }
+        }
+    }
+    return true;
+}
+
+void WriteProjectCache(const QByteArray &key, const XMLDocumentContent &content)
+{
+    QDir().mkpath( cacheDirectory() );
+    QSaveFile file( cacheFile( key, TREES_SUFFIX ) );
+    if( !file.open( QIODevice::WriteOnly ) )
+    {
+        return;
+    }
+    QDataStream out( &file );
+    writeHeader( out );
+
+    out << quint32( content.included_files.size() );
+    for (const QString& path: content.included_files)
+    {
+        const QFileInfo info( path );
+        out << path << info.lastModified() << info.size() << fileHash( path );
+    }
+
+    out << content.main_tree << quint32( content.models.size() );
+    for (const auto& it: content.models)
+    {
+        write( out, it.second );
+    }
+
+    out << quint32( content.trees.size() );
+    for (const auto& xml_tree: content.trees)
+    {
+        write( out, xml_tree );
+    }
+
+    out << quint32( content.includes.size() );
+    for (const auto& include: content.includes)
+    {
+        out << include.path << include.line;
+    }
+
+    if( out.status() == QDataStream::Ok )
+    {
+        file.commit();
+    }
+    removeOldProjects();
+}
+
+void WriteProjectLayouts(const QByteArray &key)
+{
+    if( !QFileInfo::exists( cacheFile( key, TREES_SUFFIX ) ) )
+    {
+        return;
+    }
+    const std::vector<CachedLayout> layouts = CachedTreeLayouts();
+
+    QSaveFile file( cacheFile( key, LAYOUT_SUFFIX ) );
+    if( !file.open( QIODevice::WriteOnly ) )
+    {
+        return;
+    }
+    QDataStream out( &file );
+    writeHeader( out );
+    out << quint32( layouts.size() );
+    for (const auto& layout: layouts)
+    {
+        write( out, layout.snapshot, layout.positions );
+    }
+    if( out.status() == QDataStream::Ok )
+    {
+        file.commit();
+    }
+}
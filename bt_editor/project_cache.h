@@ -0,0 +1,27 @@
+#ifndef PROJECT_CACHE_H
+#define PROJECT_CACHE_H
+
+#include <QByteArray>
+#include <QString>
+#include "XML_utilities.hpp"
+
+// A binary copy of the projects opened recently, in the cache directory of
+// the user: re-opening an unchanged file does not parse its XML again, and
+// finds the layouts of its trees already computed.
+
+// The key of a file: the hash of its text and of its directory, where its
+// <include> are.
+QByteArray ProjectCacheKey(const QString& xml_text, const QString& directory);
+
+// False when there is no valid copy, or if one of the included files
+// changed; "content" is not modified then. The layouts are given back to
+// CachedTreeLayout().
+bool ReadProjectCache(const QByteArray& key, XMLDocumentContent& content);
+
+void WriteProjectCache(const QByteArray& key, const XMLDocumentContent& content);
+
+// The layouts known by CachedTreeLayout(), written apart from the content:
+// most of them are computed after the loading, when the trees are shown.
+void WriteProjectLayouts(const QByteArray& key);
+
+#endif // PROJECT_CACHE_H
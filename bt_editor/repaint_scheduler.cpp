@@ -0,0 +1,68 @@
+#include "repaint_scheduler.h"
+#include <QElapsedTimer>
+
+RepaintScheduler::RepaintScheduler(QObject *parent):
+    QObject(parent),
+    _budget_ms(8)
+{
+    _timer.setSingleShot(true);
+    _timer.setInterval( FRAME_PERIOD_MS );
+    connect( &_timer, &QTimer::timeout, this, &RepaintScheduler::onFrame );
+}
+
+void RepaintScheduler::schedule(QGraphicsObject *item)
+{
+    if( !item || _scheduled.contains(item) )
+    {
+        return;
+    }
+    _scheduled.insert( item );
+    _pending.push_back( { item, QPointer<QGraphicsObject>(item) } );
+
+    if( !_timer.isActive() )
+    {
+        _timer.start();
+    }
+}
+
+void RepaintScheduler::flushAll()
+{
+    _timer.stop();
+    for(auto& pending: _pending)
+    {
+        if( pending.item ) pending.item->update();
+    }
+    _pending.clear();
+    _scheduled.clear();
+}
+
+void RepaintScheduler::onFrame()
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    // check the clock every few items only: update() itself is cheap
+    const int check_period = 64;
+    int count = 0;
+
+    while( !_pending.empty() )
+    {
+        PendingItem pending = _pending.front();
+        _pending.pop_front();
+        _scheduled.remove( pending.key );
+
+        if( pending.item )
+        {
+            pending.item->update();
+        }
+        if( ++count % check_period == 0 && timer.elapsed() >= _budget_ms )
+        {
+            break;
+        }
+    }
+
+    if( !_pending.empty() )
+    {
+        _timer.start();
+    }
+}
@@ -0,0 +1,51 @@
+#ifndef REPAINT_SCHEDULER_H
+#define REPAINT_SCHEDULER_H
+
+#include <QObject>
+#include <QPointer>
+#include <QGraphicsObject>
+#include <QTimer>
+#include <QSet>
+#include <deque>
+
+// Collects the graphic items that need to be repainted and calls update() on
+// them once per frame, within a time budget. What does not fit in the budget
+// is left for the next frame, so that input events are never starved.
+class RepaintScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit RepaintScheduler(QObject* parent = nullptr);
+
+    // The same item is updated at most once per frame.
+    void schedule(QGraphicsObject* item);
+
+    // Update all the pending items now, ignoring the budget.
+    void flushAll();
+
+    void setBudget(int budget_ms) { _budget_ms = budget_ms; }
+
+    int budget() const { return _budget_ms; }
+
+    size_t pendingCount() const { return _pending.size(); }
+
+    static const int FRAME_PERIOD_MS = 16;
+
+private slots:
+    void onFrame();
+
+private:
+    struct PendingItem
+    {
+        QGraphicsObject* key;
+        // the graphic item may be deleted before the flush
+        QPointer<QGraphicsObject> item;
+    };
+    std::deque<PendingItem> _pending;
+    QSet<QGraphicsObject*> _scheduled;
+    QTimer _timer;
+    int _budget_ms;
+};
+
+#endif // REPAINT_SCHEDULER_H
@@ -0,0 +1,400 @@
+#include "replay_query.h"
+#include <QObject>
+#include <QStringList>
+#include <QRegularExpression>
+#include <algorithm>
+
+void ReplayQueryIndex::clear()
+{
+    _rows.clear();
+    _indexed = 0;
+}
+
+void ReplayQueryIndex::update(const TransitionStore &transitions, int nodes_count)
+{
+    if( int(_rows.size()) != nodes_count * 4 || transitions.size() < _indexed )
+    {
+        _rows.assign( size_t(nodes_count) * 4, std::vector<int>() );
+        _indexed = 0;
+    }
+    for(size_t row = _indexed; row < transitions.size(); row++)
+    {
+        const int node = transitions.index(row);
+        if( node >= 0 && node < nodes_count )
+        {
+            _rows[ size_t(node) * 4 + size_t(transitions.status(row)) ].push_back( int(row) );
+        }
+    }
+    _indexed = transitions.size();
+}
+
+namespace {
+
+// split on spaces, keeping the quoted names together
+QStringList tokenize(const QString& text, QString& error)
+{
+    QStringList tokens;
+    QString current;
+    bool quoted = false;
+    bool has_token = false;
+
+    for(const QChar c: text)
+    {
+        if( c == '"' )
+        {
+            quoted = !quoted;
+            has_token = true;
+        }
+        else if( c.isSpace() && !quoted )
+        {
+            if( has_token ) tokens.push_back( current );
+            current.clear();
+            has_token = false;
+        }
+        else{
+            current += c;
+            has_token = true;
+        }
+    }
+    if( quoted )
+    {
+        error = QObject::tr("Missing closing quote");
+    }
+    if( has_token ) tokens.push_back( current );
+    return tokens;
+}
+
+bool parseStatus(const QString& token, NodeStatus& status)
+{
+    const QString upper = token.toUpper();
+    if( upper == "IDLE" )    { status = NodeStatus::IDLE;    return true; }
+    if( upper == "RUNNING" ) { status = NodeStatus::RUNNING; return true; }
+    if( upper == "SUCCESS" ) { status = NodeStatus::SUCCESS; return true; }
+    if( upper == "FAILURE" ) { status = NodeStatus::FAILURE; return true; }
+    return false;
+}
+
+bool isKeyword(const QString& token, const char* keyword)
+{
+    return token.compare( keyword, Qt::CaseInsensitive ) == 0;
+}
+
+// "50ms", "2s", "100us", "1.5": seconds
+bool parseDuration(const QString& token, double& seconds)
+{
+    static const QRegularExpression re("^([0-9]*\\.?[0-9]+)(us|ms|s)?$",
+                                       QRegularExpression::CaseInsensitiveOption);
+    const auto match = re.match( token );
+    if( !match.hasMatch() )
+    {
+        return false;
+    }
+    seconds = match.captured(1).toDouble();
+    const QString unit = match.captured(2).toLower();
+    if( unit == "ms" ) seconds *= 1e-3;
+    else if( unit == "us" ) seconds *= 1e-6;
+    return true;
+}
+
+} // end anonymous namespace
+
+bool ReplayQuery::parse(const QString &input, const AbsBehaviorTree &tree, QString &error)
+{
+    _events.clear();
+    _has_time_range = false;
+    error.clear();
+
+    const QStringList raw_tokens = tokenize( input, error );
+    if( !error.isEmpty() )
+    {
+        return false;
+    }
+    // "10..20", "10 .. 20" and "50 ms" are split or joined the same way
+    static const QRegularExpression unit_re("^(us|ms|s)$", QRegularExpression::CaseInsensitiveOption);
+    QStringList tokens;
+    double number = 0;
+    for(const QString& token: raw_tokens)
+    {
+        const int dots = token.indexOf("..");
+        if( dots >= 0 && token != ".." )
+        {
+            if( dots > 0 ) tokens.push_back( token.left(dots) );
+            tokens.push_back( ".." );
+            if( dots + 2 < token.size() ) tokens.push_back( token.mid(dots + 2) );
+        }
+        else if( unit_re.match(token).hasMatch() && !tokens.isEmpty() &&
+                 parseDuration( tokens.back(), number ) )
+        {
+            tokens.back() += token;
+        }
+        else{
+            tokens.push_back( token );
+        }
+    }
+
+    int pos = 0;
+    auto peek = [&]() -> QString { return pos < tokens.size() ? tokens[pos] : QString(); };
+
+    while( true )
+    {
+        Event event;
+        if( isKeyword( peek(), "node" ) ) pos++;
+
+        const QString name = peek();
+        if( name.isEmpty() )
+        {
+            error = QObject::tr("Expected the name of a node");
+            return false;
+        }
+        pos++;
+
+        if( name != "*" )
+        {
+            // exact match first, then ignoring the case
+            for(auto sensitivity: { Qt::CaseSensitive, Qt::CaseInsensitive })
+            {
+                for(size_t index = 0; index < tree.nodesCount(); index++)
+                {
+                    if( tree.node(index)->instance_name.compare( name, sensitivity ) == 0 )
+                    {
+                        event.nodes.push_back( int(index) );
+                    }
+                }
+                if( !event.nodes.empty() ) break;
+            }
+            if( event.nodes.empty() )
+            {
+                error = QObject::tr("There is no node called \"%1\"").arg(name);
+                return false;
+            }
+        }
+
+        if( parseStatus( peek(), event.status ) )
+        {
+            event.any_status = false;
+            pos++;
+        }
+        if( isKeyword( peek(), "from" ) )
+        {
+            pos++;
+            if( !parseStatus( peek(), event.prev_status ) )
+            {
+                error = QObject::tr("Expected a status after \"from\"");
+                return false;
+            }
+            event.any_prev_status = false;
+            pos++;
+        }
+        if( !_events.empty() && isKeyword( peek(), "within" ) )
+        {
+            pos++;
+            if( !parseDuration( peek(), event.within ) )
+            {
+                error = QObject::tr("Invalid duration \"%1\"").arg( peek() );
+                return false;
+            }
+            pos++;
+        }
+        _events.push_back( event );
+
+        if( !isKeyword( peek(), "after" ) )
+        {
+            break;
+        }
+        pos++;
+    }
+
+    if( isKeyword( peek(), "in" ) )
+    {
+        pos++;
+        bool ok_begin = false;
+        bool ok_end = false;
+        _time_begin = peek().toDouble( &ok_begin );
+        pos++;
+        if( peek() != ".." )
+        {
+            ok_end = false;
+        }
+        else{
+            pos++;
+            _time_end = peek().toDouble( &ok_end );
+            pos++;
+        }
+        if( !ok_begin || !ok_end )
+        {
+            error = QObject::tr("Expected a time range, like \"in 10..20\"");
+            return false;
+        }
+        _has_time_range = true;
+    }
+
+    if( pos < tokens.size() )
+    {
+        error = QObject::tr("Unexpected \"%1\"").arg( peek() );
+        return false;
+    }
+    return true;
+}
+
+bool ReplayQuery::matches(const Event &event, const TransitionStore &transitions, int row) const
+{
+    if( !event.any_status && transitions.status(row) != event.status )
+    {
+        return false;
+    }
+    if( !event.any_prev_status && transitions.prevStatus(row) != event.prev_status )
+    {
+        return false;
+    }
+    return event.nodes.empty() ||
+           std::find( event.nodes.begin(), event.nodes.end(), transitions.index(row) ) != event.nodes.end();
+}
+
+std::vector<int> ReplayQuery::candidates(const Event &event, const TransitionStore &transitions,
+                                         const ReplayQueryIndex &index) const
+{
+    std::vector<int> rows;
+    if( event.nodes.empty() || index.nodesCount() == 0 )
+    {
+        for(size_t row = 0; row < transitions.size(); row++)
+        {
+            if( matches( event, transitions, int(row) ) )
+            {
+                rows.push_back( int(row) );
+            }
+        }
+        return rows;
+    }
+
+    const NodeStatus all_status[4] = { NodeStatus::IDLE, NodeStatus::RUNNING,
+                                       NodeStatus::SUCCESS, NodeStatus::FAILURE };
+    size_t lists = 0;
+    for(int node: event.nodes)
+    {
+        for(NodeStatus status: all_status)
+        {
+            if( !event.any_status && status != event.status ) continue;
+
+            for(int row: index.rows( node, status ))
+            {
+                if( event.any_prev_status || transitions.prevStatus(row) == event.prev_status )
+                {
+                    rows.push_back( row );
+                }
+            }
+            lists++;
+        }
+    }
+    if( lists > 1 )
+    {
+        std::sort( rows.begin(), rows.end() );
+    }
+    return rows;
+}
+
+std::vector<int> ReplayQuery::precededBy(const std::vector<int> &list,
+                                         const std::vector<int> &preceding, double within,
+                                         const TransitionStore &transitions)
+{
+    std::vector<int> result;
+    auto closest = preceding.begin();
+    for(int row: list)
+    {
+        // the rows are sorted: the closest row before "row" only moves forward
+        while( closest != preceding.end() && *closest < row )
+        {
+            ++closest;
+        }
+        if( closest == preceding.begin() )
+        {
+            continue;
+        }
+        const int before = *(closest - 1);
+        if( within < 0 ||
+            transitions.timestamp( size_t(row) ) - transitions.timestamp( size_t(before) ) <= within )
+        {
+            result.push_back( row );
+        }
+    }
+    return result;
+}
+
+std::vector<int> ReplayQuery::run(const TransitionStore &transitions,
+                                  const ReplayQueryIndex &index,
+                                  const std::atomic<bool> *cancelled) const
+{
+    std::vector<int> result;
+    if( _events.empty() || transitions.empty() )
+    {
+        return result;
+    }
+    // from the last event of the chain: the rows of each event preceded by
+    // the ones still matching of the next event
+    const double origin = transitions.timestamp(0);
+    std::vector<int> matching;
+    for(size_t level = _events.size(); level-- > 0; )
+    {
+        if( cancelled && cancelled->load() )
+        {
+            return result;
+        }
+        std::vector<int> rows = candidates( _events[level], transitions, index );
+        if( level == 0 && _has_time_range )
+        {
+            rows.erase( std::remove_if( rows.begin(), rows.end(), [&](int row)
+            {
+                const double time = transitions.timestamp( size_t(row) ) - origin;
+                return time < _time_begin || time > _time_end;
+            } ), rows.end() );
+        }
+        if( level + 1 < _events.size() )
+        {
+            matching = precededBy( rows, matching, _events[level + 1].within, transitions );
+        }
+        else{
+            matching = std::move( rows );
+        }
+    }
+    if( cancelled && cancelled->load() )
+    {
+        return result;
+    }
+    return matching;
+}
+
+ReplayQueryWorker::ReplayQueryWorker(const ReplayQuery &query,
+                                     const TransitionStore &transitions,
+                                     const ReplayQueryIndex &index,
+                                     int request_id,
+                                     QObject *parent):
+    QThread(parent),
+    _query(query),
+    _transitions(transitions),
+    _index(index),
+    _request_id(request_id),
+    _cancelled(false)
+{
+    qRegisterMetaType<ReplayQueryMatchesPtr>();
+}
+
+ReplayQueryWorker::~ReplayQueryWorker()
+{
+    cancel();
+    wait();
+}
+
+void ReplayQueryWorker::cancel()
+{
+    _cancelled.store(true);
+}
+
+void ReplayQueryWorker::run()
+{
+    auto matches = std::make_shared<const std::vector<int>>(
+                _query.run( _transitions, _index, &_cancelled ) );
+
+    if( !_cancelled.load() )
+    {
+        emit queryReady( _request_id, matches );
+    }
+}
@@ -0,0 +1,135 @@
+#ifndef REPLAY_QUERY_H
+#define REPLAY_QUERY_H
+
+#include <QString>
+#include <QThread>
+#include <QMetaType>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include "bt_editor_base.h"
+#include "transition_store.h"
+
+// Rows of each node, split by the status they enter. Updated incrementally
+// while the log is loading.
+class ReplayQueryIndex
+{
+public:
+    void clear();
+
+    // index the rows of "transitions" not indexed yet
+    void update(const TransitionStore& transitions, int nodes_count);
+
+    const std::vector<int>& rows(int node_index, NodeStatus status) const
+    {
+        return _rows[ size_t(node_index) * 4 + size_t(status) ];
+    }
+
+    int nodesCount() const { return int(_rows.size() / 4); }
+
+private:
+    std::vector<std::vector<int>> _rows;
+    size_t _indexed = 0;
+};
+
+// A query over the transitions of a log, for instance:
+//
+//   Wait FAILURE after Approach RUNNING within 50ms
+//   "Open door" SUCCESS from RUNNING in 10..20
+//   * FAILURE after Retry SUCCESS within 1s after Retry FAILURE within 2s
+//
+// Grammar (keywords and statuses are case insensitive):
+//
+//   query    := event { "after" event [ "within" duration ] } [ "in" time ".." time ]
+//   event    := [ "node" ] name [ status ] [ "from" status ]
+//   name     := instance name, quoted if it contains spaces, or "*" for any node
+//   duration := number [ "us" | "ms" | "s" ]   (seconds by default)
+//   time     := seconds since the first transition of the log
+//
+// "A after B within D" matches the transitions of A with a transition of B
+// at most D before; without "within", at any time before. Each "after"
+// applies to the event just before it.
+class ReplayQuery
+{
+public:
+    // false and "error" set if the syntax is not valid, or a name is not in
+    // the tree
+    bool parse(const QString& text, const AbsBehaviorTree& tree, QString& error);
+
+    // Rows matching the first event of the query, sorted. Returns an empty
+    // result if "cancelled" becomes true.
+    std::vector<int> run(const TransitionStore& transitions,
+                         const ReplayQueryIndex& index,
+                         const std::atomic<bool>* cancelled = nullptr) const;
+
+private:
+    struct Event
+    {
+        // empty for any node
+        std::vector<int> nodes;
+        bool any_status = true;
+        NodeStatus status = NodeStatus::IDLE;
+        bool any_prev_status = true;
+        NodeStatus prev_status = NodeStatus::IDLE;
+        // at most this long before the previous event of the query;
+        // < 0 if unbounded
+        double within = -1;
+    };
+
+    std::vector<Event> _events;
+    bool _has_time_range = false;
+    double _time_begin = 0;
+    double _time_end = 0;
+
+    // candidate rows of an event, sorted
+    std::vector<int> candidates(const Event& event, const TransitionStore& transitions,
+                                const ReplayQueryIndex& index) const;
+
+    bool matches(const Event& event, const TransitionStore& transitions, int row) const;
+
+    // The rows of "list" with a row of "preceding" before them, at most
+    // "within" before if >= 0. Both are sorted: the closest preceding row is
+    // the only one to check, found by a single scan.
+    static std::vector<int> precededBy(const std::vector<int>& list,
+                                       const std::vector<int>& preceding, double within,
+                                       const TransitionStore& transitions);
+};
+
+typedef std::shared_ptr<const std::vector<int>> ReplayQueryMatchesPtr;
+
+// Runs a query on its own thread. The store and the index must not be
+// modified until the thread is finished.
+class ReplayQueryWorker : public QThread
+{
+    Q_OBJECT
+
+public:
+    ReplayQueryWorker(const ReplayQuery& query,
+                      const TransitionStore& transitions,
+                      const ReplayQueryIndex& index,
+                      int request_id,
+                      QObject* parent = nullptr);
+
+    ~ReplayQueryWorker() override;
+
+    void cancel();
+
+    int requestId() const { return _request_id; }
+
+signals:
+    void queryReady(int request_id, ReplayQueryMatchesPtr matches);
+
+protected:
+    void run() override;
+
+private:
+    ReplayQuery _query;
+    const TransitionStore& _transitions;
+    const ReplayQueryIndex& _index;
+    int _request_id;
+    std::atomic<bool> _cancelled;
+};
+
+Q_DECLARE_METATYPE(ReplayQueryMatchesPtr)
+
+#endif // REPLAY_QUERY_H
@@ -0,0 +1,138 @@
+#include "replay_statistics_dialog.h"
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QTableView>
+#include <QHeaderView>
+#include <QLabel>
+#include <QSortFilterProxyModel>
+#include <QDialogButtonBox>
+#include <algorithm>
+
+namespace {
+
+enum Column { NAME, ID, TICKS, SUCCESS, FAILURE, RUNNING, RUNNING_TIME, MAX_RUNNING_TIME };
+
+QStandardItem* numberItem(double value)
+{
+    auto item = new QStandardItem();
+    // the proxy sorts by number, not by text
+    item->setData( value, Qt::DisplayRole );
+    item->setTextAlignment( Qt::AlignRight | Qt::AlignVCenter );
+    return item;
+}
+
+double heatmapValue(const NodeStatistics& stats, int column)
+{
+    switch( column )
+    {
+    case TICKS:            return double(stats.ticks);
+    case FAILURE:          return double(stats.failure);
+    case RUNNING_TIME:     return stats.running_time;
+    case MAX_RUNNING_TIME: return stats.max_running_time;
+    default:               return 0;
+    }
+}
+
+} // end anonymous namespace
+
+ReplayStatisticsDialog::ReplayStatisticsDialog(const ReplayStatistics &statistics,
+                                               const AbsBehaviorTree &tree,
+                                               QWidget *parent):
+    QDialog(parent),
+    _statistics(statistics)
+{
+    setWindowTitle( tr("Node statistics") );
+    resize( 700, 500 );
+
+    _model = new QStandardItemModel( 0, 8, this );
+    _model->setHorizontalHeaderLabels( { tr("Node"), tr("ID"), tr("Ticks"),
+                                         tr("Success"), tr("Failure"), tr("Running"),
+                                         tr("Running time [s]"), tr("Max running [s]") } );
+
+    for (size_t index = 0; index < statistics.nodes.size() && index < tree.nodesCount(); index++)
+    {
+        const NodeStatistics& stats = statistics.nodes[index];
+        const AbstractTreeNode* node = tree.node( index );
+        QList<QStandardItem*> row;
+        row.push_back( new QStandardItem( node->instance_name ) );
+        row.push_back( new QStandardItem( node->model.registration_ID ) );
+        row.push_back( numberItem( double(stats.ticks) ) );
+        row.push_back( numberItem( double(stats.success) ) );
+        row.push_back( numberItem( double(stats.failure) ) );
+        row.push_back( numberItem( double(stats.running) ) );
+        row.push_back( numberItem( stats.running_time ) );
+        row.push_back( numberItem( stats.max_running_time ) );
+        _model->appendRow( row );
+    }
+
+    auto proxy = new QSortFilterProxyModel( this );
+    proxy->setSourceModel( _model );
+
+    auto table = new QTableView( this );
+    table->setModel( proxy );
+    table->setSortingEnabled( true );
+    table->setEditTriggers( QAbstractItemView::NoEditTriggers );
+    table->setSelectionBehavior( QAbstractItemView::SelectRows );
+    table->verticalHeader()->setVisible( false );
+    table->horizontalHeader()->setSectionResizeMode( NAME, QHeaderView::Stretch );
+    table->sortByColumn( RUNNING_TIME, Qt::DescendingOrder );
+
+    QString restarts = tr("Restarts of the tree: %1").arg( statistics.restarts );
+    if( statistics.restarts >= 2 )
+    {
+        restarts += tr(", interval min %1 s, mean %2 s, max %3 s")
+                .arg( statistics.min_restart_interval, 0, 'f', 3 )
+                .arg( statistics.mean_restart_interval, 0, 'f', 3 )
+                .arg( statistics.max_restart_interval, 0, 'f', 3 );
+    }
+
+    _heatmap_combo = new QComboBox( this );
+    _heatmap_combo->addItem( tr("None"), -1 );
+    _heatmap_combo->addItem( tr("Ticks"), int(TICKS) );
+    _heatmap_combo->addItem( tr("Failures"), int(FAILURE) );
+    _heatmap_combo->addItem( tr("Running time"), int(RUNNING_TIME) );
+    _heatmap_combo->addItem( tr("Max running time"), int(MAX_RUNNING_TIME) );
+    connect( _heatmap_combo, static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged),
+             this, &ReplayStatisticsDialog::onHeatmapSelected );
+
+    auto heatmap_layout = new QHBoxLayout();
+    heatmap_layout->addWidget( new QLabel( tr("Heatmap on the tree:"), this ) );
+    heatmap_layout->addWidget( _heatmap_combo );
+    heatmap_layout->addStretch();
+
+    auto buttons = new QDialogButtonBox( QDialogButtonBox::Close, this );
+    connect( buttons, &QDialogButtonBox::rejected, this, &QDialog::reject );
+
+    auto layout = new QVBoxLayout( this );
+    layout->addWidget( new QLabel( restarts, this ) );
+    layout->addWidget( table );
+    layout->addLayout( heatmap_layout );
+    layout->addWidget( buttons );
+
+    connect( this, &QDialog::finished, this, [this]()
+    {
+        emit heatmapChanged( std::vector<double>() );
+    } );
+}
+
+void ReplayStatisticsDialog::onHeatmapSelected(int index)
+{
+    const int column = _heatmap_combo->itemData( index ).toInt();
+    std::vector<double> values;
+
+    if( column >= 0 )
+    {
+        values.reserve( _statistics.nodes.size() );
+        double max_value = 0;
+        for (const auto& stats: _statistics.nodes)
+        {
+            values.push_back( heatmapValue( stats, column ) );
+            max_value = std::max( max_value, values.back() );
+        }
+        for (double& value: values)
+        {
+            value = ( max_value > 0 ) ? value / max_value : 0.0;
+        }
+    }
+    emit heatmapChanged( values );
+}
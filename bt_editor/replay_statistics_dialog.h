@@ -0,0 +1,35 @@
+#ifndef REPLAY_STATISTICS_DIALOG_H
+#define REPLAY_STATISTICS_DIALOG_H
+
+#include <QDialog>
+#include <QStandardItemModel>
+#include <QComboBox>
+
+#include "bt_editor_base.h"
+#include "node_statistics.h"
+
+// Sortable table of the statistics of each node of a replayed log. The
+// selected column can be shown as a heatmap on the tree.
+class ReplayStatisticsDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    ReplayStatisticsDialog(const ReplayStatistics& statistics,
+                           const AbsBehaviorTree& tree,
+                           QWidget* parent = nullptr);
+
+signals:
+    // one value in [0, 1] per node index; empty to show the status again
+    void heatmapChanged(const std::vector<double>& values);
+
+private slots:
+    void onHeatmapSelected(int index);
+
+private:
+    ReplayStatistics _statistics;
+    QStandardItemModel* _model;
+    QComboBox* _heatmap_combo;
+};
+
+#endif // REPLAY_STATISTICS_DIALOG_H
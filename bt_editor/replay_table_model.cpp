@@ -0,0 +1,381 @@
+#include "replay_table_model.h"
+#include <QColor>
+#include <QFont>
+#include <algorithm>
+
+ReplayTableModel::ReplayTableModel(const TransitionStore &transitions,
+                                   const std::vector<std::pair<double, int> > &timepoints,
+                                   const AbsBehaviorTree &tree,
+                                   QObject *parent):
+    QAbstractTableModel(parent),
+    _transitions(transitions),
+    _timepoints(timepoints),
+    _tree(tree),
+    _row_count(0),
+    _current_row(-1)
+{
+}
+
+int ReplayTableModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : _row_count;
+}
+
+int ReplayTableModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : 4;
+}
+
+static const char* statusText(NodeStatus status)
+{
+    switch (status)
+    {
+    case NodeStatus::SUCCESS: return "SUCCESS";
+    case NodeStatus::FAILURE: return "FAILURE";
+    case NodeStatus::RUNNING: return "RUNNING";
+    case NodeStatus::IDLE:    return "IDLE";
+    }
+    return "";
+}
+
+static QColor statusColor(NodeStatus status)
+{
+    switch (status)
+    {
+    case NodeStatus::SUCCESS: return QColor::fromRgb(22, 255, 22);
+    case NodeStatus::FAILURE: return QColor::fromRgb(255, 22, 22);
+    case NodeStatus::RUNNING: return QColor::fromRgb(250, 160, 20);
+    case NodeStatus::IDLE:    return QColor::fromRgb(222, 222, 222);
+    }
+    return QColor();
+}
+
+bool ReplayTableModel::isTimepoint(int row) const
+{
+    // the time points are sorted by row
+    auto it = std::lower_bound( _timepoints.begin(), _timepoints.end(), row,
+                                [](const std::pair<double,int>& a, int val) -> bool
+    {
+        return a.second < val;
+    } );
+    return it != _timepoints.end() && it->second == row;
+}
+
+QVariant ReplayTableModel::data(const QModelIndex &index, int role) const
+{
+    if( !index.isValid() || index.row() >= _row_count )
+    {
+        return QVariant();
+    }
+    const int row = index.row();
+    const int column = index.column();
+
+    switch( role )
+    {
+    case Qt::DisplayRole:
+    {
+        switch( column )
+        {
+        case 0:
+            return QString::number( _transitions.timestamp(row) - _transitions.timestamp(0), 'f', 3 );
+        case 1:
+            return _tree.node( _transitions.index(row) )->instance_name;
+        case 2:
+            return QString( statusText( _transitions.prevStatus(row) ) );
+        case 3:
+            return QString( statusText( _transitions.status(row) ) );
+        }
+    } break;
+
+    case Qt::ToolTipRole:
+    {
+        if( column == 0 )
+        {
+            return QString("absolute time: %1").arg( _transitions.timestamp(row), 0, 'f', 3 );
+        }
+    } break;
+
+    case Qt::FontRole:
+    {
+        if( column == 0 && isTimepoint(row) )
+        {
+            QFont font;
+            font.setBold(true);
+            return font;
+        }
+    } break;
+
+    case Qt::BackgroundRole:
+    {
+        if( column == 2 ) return statusColor( _transitions.prevStatus(row) );
+        if( column == 3 ) return statusColor( _transitions.status(row) );
+        if( row <= _current_row ) return QColor::fromRgb(210, 210, 210);
+    } break;
+
+    case Qt::ForegroundRole:
+    {
+        if( column >= 2 ) return QColor::fromRgb(0, 0, 0);
+    } break;
+    }
+    return QVariant();
+}
+
+QVariant ReplayTableModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if( orientation != Qt::Horizontal || role != Qt::DisplayRole )
+    {
+        return QAbstractTableModel::headerData( section, orientation, role );
+    }
+    switch( section )
+    {
+    case 0: return QString("Time");
+    case 1: return QString("Node Name");
+    case 2: return QString("Previous");
+    case 3: return QString("Status");
+    }
+    return QVariant();
+}
+
+void ReplayTableModel::appendRows()
+{
+    const int new_count = int( _transitions.size() );
+    if( new_count <= _row_count )
+    {
+        return;
+    }
+    beginInsertRows( QModelIndex(), _row_count, new_count - 1 );
+    _row_count = new_count;
+    endInsertRows();
+}
+
+void ReplayTableModel::reset()
+{
+    beginResetModel();
+    _row_count = int( _transitions.size() );
+    _current_row = -1;
+    endResetModel();
+}
+
+void ReplayTableModel::setCurrentRow(int row)
+{
+    if( row == _current_row )
+    {
+        return;
+    }
+    // only the rows between the old and the new position change color
+    const int first = std::max( 0, std::min( row, _current_row ) + 1 );
+    const int last  = std::min( _row_count - 1, std::max( row, _current_row ) );
+    _current_row = row;
+
+    if( first <= last )
+    {
+        emit dataChanged( index(first, 0), index(last, 1), { Qt::BackgroundRole } );
+    }
+}
+
+ReplayFilterModel::ReplayFilterModel(const TransitionStore &transitions,
+                                     const AbsBehaviorTree &tree,
+                                     QObject *parent):
+    QAbstractProxyModel(parent),
+    _transitions(transitions),
+    _tree(tree),
+    _filtered(false),
+    _indexed_rows(0)
+{
+}
+
+void ReplayFilterModel::setSourceModel(QAbstractItemModel *source_model)
+{
+    if( sourceModel() )
+    {
+        disconnect( sourceModel(), nullptr, this, nullptr );
+    }
+    QAbstractProxyModel::setSourceModel( source_model );
+
+    connect( source_model, &QAbstractItemModel::rowsInserted,
+             this, &ReplayFilterModel::onSourceRowsInserted );
+    connect( source_model, &QAbstractItemModel::dataChanged,
+             this, &ReplayFilterModel::onSourceDataChanged );
+    connect( source_model, &QAbstractItemModel::modelReset,
+             this, &ReplayFilterModel::onSourceReset );
+    onSourceReset();
+}
+
+void ReplayFilterModel::updateNodeVisibility()
+{
+    const size_t nodes_count = _tree.nodesCount();
+    _node_visible.assign( nodes_count, 1 );
+    _rows_by_node.resize( nodes_count );
+
+    if( _filtered )
+    {
+        for(size_t index = 0; index < nodes_count; index++)
+        {
+            _node_visible[index] = _tree.node(index)->instance_name.contains( _filter_text,
+                                                                               Qt::CaseInsensitive );
+        }
+    }
+}
+
+void ReplayFilterModel::rebuildRows()
+{
+    _rows.clear();
+    if( !_filtered )
+    {
+        return;
+    }
+    for(size_t index = 0; index < _rows_by_node.size(); index++)
+    {
+        if( _node_visible[index] )
+        {
+            _rows.insert( _rows.end(), _rows_by_node[index].begin(), _rows_by_node[index].end() );
+        }
+    }
+    std::sort( _rows.begin(), _rows.end() );
+}
+
+void ReplayFilterModel::setFilter(const QString &filter_text)
+{
+    beginResetModel();
+    _filter_text = filter_text;
+    _filtered = !filter_text.isEmpty();
+    updateNodeVisibility();
+    rebuildRows();
+    endResetModel();
+}
+
+void ReplayFilterModel::onSourceReset()
+{
+    beginResetModel();
+    _rows_by_node.clear();
+    _indexed_rows = 0;
+    updateNodeVisibility();
+
+    const int source_rows = sourceModel() ? sourceModel()->rowCount() : 0;
+    for(int row = 0; row < source_rows; row++)
+    {
+        _rows_by_node[ _transitions.index(row) ].push_back( row );
+    }
+    _indexed_rows = source_rows;
+    rebuildRows();
+    endResetModel();
+}
+
+void ReplayFilterModel::onSourceRowsInserted(const QModelIndex &, int first, int last)
+{
+    // the tree can change after the reset
+    if( _rows_by_node.size() != _tree.nodesCount() )
+    {
+        updateNodeVisibility();
+    }
+
+    // the log is only appended
+    std::vector<int> new_rows;
+    for(int row = first; row <= last; row++)
+    {
+        const int node_index = _transitions.index(row);
+        _rows_by_node[ node_index ].push_back( row );
+        if( _filtered && _node_visible[node_index] )
+        {
+            new_rows.push_back( row );
+        }
+    }
+
+    if( !_filtered )
+    {
+        beginInsertRows( QModelIndex(), _indexed_rows, last );
+        _indexed_rows = last + 1;
+        endInsertRows();
+    }
+    else{
+        _indexed_rows = last + 1;
+        if( !new_rows.empty() )
+        {
+            const int proxy_first = int(_rows.size());
+            beginInsertRows( QModelIndex(), proxy_first, proxy_first + int(new_rows.size()) - 1 );
+            _rows.insert( _rows.end(), new_rows.begin(), new_rows.end() );
+            endInsertRows();
+        }
+    }
+}
+
+void ReplayFilterModel::onSourceDataChanged(const QModelIndex &top_left,
+                                            const QModelIndex &bottom_right,
+                                            const QVector<int> &roles)
+{
+    int first = top_left.row();
+    int last = bottom_right.row();
+    if( _filtered )
+    {
+        first = int( std::lower_bound( _rows.begin(), _rows.end(), first ) - _rows.begin() );
+        last  = int( std::upper_bound( _rows.begin(), _rows.end(), last ) - _rows.begin() ) - 1;
+    }
+    if( first <= last )
+    {
+        emit dataChanged( index(first, top_left.column()), index(last, bottom_right.column()), roles );
+    }
+}
+
+QModelIndex ReplayFilterModel::mapToSource(const QModelIndex &proxy_index) const
+{
+    if( !proxy_index.isValid() || !sourceModel() )
+    {
+        return QModelIndex();
+    }
+    const int row = _filtered ? _rows[ proxy_index.row() ] : proxy_index.row();
+    return sourceModel()->index( row, proxy_index.column() );
+}
+
+QModelIndex ReplayFilterModel::mapFromSource(const QModelIndex &source_index) const
+{
+    if( !source_index.isValid() || source_index.row() >= _indexed_rows )
+    {
+        return QModelIndex();
+    }
+    if( !_filtered )
+    {
+        return index( source_index.row(), source_index.column() );
+    }
+    auto it = std::lower_bound( _rows.begin(), _rows.end(), source_index.row() );
+    if( it == _rows.end() || *it != source_index.row() )
+    {
+        return QModelIndex();
+    }
+    return index( int(it - _rows.begin()), source_index.column() );
+}
+
+QModelIndex ReplayFilterModel::index(int row, int column, const QModelIndex &parent) const
+{
+    if( parent.isValid() || row < 0 || row >= rowCount() || column < 0 || column >= columnCount() )
+    {
+        return QModelIndex();
+    }
+    return createIndex( row, column );
+}
+
+QModelIndex ReplayFilterModel::parent(const QModelIndex &) const
+{
+    return QModelIndex();
+}
+
+int ReplayFilterModel::rowCount(const QModelIndex &parent) const
+{
+    if( parent.isValid() ) return 0;
+    return _filtered ? int(_rows.size()) : _indexed_rows;
+}
+
+int ReplayFilterModel::columnCount(const QModelIndex &parent) const
+{
+    if( parent.isValid() || !sourceModel() ) return 0;
+    return sourceModel()->columnCount();
+}
+
+const std::vector<int> &ReplayFilterModel::rowsOfNode(int node_index) const
+{
+    static const std::vector<int> empty;
+    if( node_index < 0 || size_t(node_index) >= _rows_by_node.size() )
+    {
+        return empty;
+    }
+    return _rows_by_node[node_index];
+}
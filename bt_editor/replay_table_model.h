@@ -0,0 +1,108 @@
+#ifndef REPLAY_TABLE_MODEL_H
+#define REPLAY_TABLE_MODEL_H
+
+#include <QAbstractTableModel>
+#include <QAbstractProxyModel>
+#include "bt_editor_base.h"
+#include "transition_store.h"
+
+// Read-only view of the transitions of a log. Nothing is stored per row:
+// text, colors and fonts are computed in data().
+class ReplayTableModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    ReplayTableModel(const TransitionStore& transitions,
+                     const std::vector<std::pair<double,int>>& timepoints,
+                     const AbsBehaviorTree& tree,
+                     QObject* parent = nullptr);
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+
+    int columnCount(const QModelIndex& parent = QModelIndex()) const override;
+
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+
+    QVariant headerData(int section, Qt::Orientation orientation,
+                        int role = Qt::DisplayRole) const override;
+
+    // To be called after new transitions were appended.
+    void appendRows();
+
+    // To be called after the transitions were replaced.
+    void reset();
+
+    // rows up to the current one are highlighted
+    void setCurrentRow(int row);
+
+    int currentRow() const { return _current_row; }
+
+private:
+    const TransitionStore& _transitions;
+    const std::vector<std::pair<double,int>>& _timepoints;
+    const AbsBehaviorTree& _tree;
+    int _row_count;
+    int _current_row;
+
+    bool isTimepoint(int row) const;
+};
+
+// Shows only the transitions of the nodes whose name contains a given text.
+// The rows of each node are indexed while they are inserted, so changing the
+// filter costs O(nodes + visible rows), independently of the size of the log.
+class ReplayFilterModel : public QAbstractProxyModel
+{
+    Q_OBJECT
+
+public:
+    ReplayFilterModel(const TransitionStore& transitions,
+                      const AbsBehaviorTree& tree,
+                      QObject* parent = nullptr);
+
+    void setSourceModel(QAbstractItemModel* source_model) override;
+
+    void setFilter(const QString& filter_text);
+
+    QModelIndex mapToSource(const QModelIndex& proxy_index) const override;
+
+    QModelIndex mapFromSource(const QModelIndex& source_index) const override;
+
+    QModelIndex index(int row, int column, const QModelIndex& parent = QModelIndex()) const override;
+
+    QModelIndex parent(const QModelIndex& child) const override;
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+
+    int columnCount(const QModelIndex& parent = QModelIndex()) const override;
+
+    // sorted rows of the transitions of a node
+    const std::vector<int>& rowsOfNode(int node_index) const;
+
+private slots:
+
+    void onSourceRowsInserted(const QModelIndex& parent, int first, int last);
+
+    void onSourceDataChanged(const QModelIndex& top_left, const QModelIndex& bottom_right,
+                             const QVector<int>& roles);
+
+    void onSourceReset();
+
+private:
+    const TransitionStore& _transitions;
+    const AbsBehaviorTree& _tree;
+
+    QString _filter_text;
+    bool _filtered;
+    std::vector<char> _node_visible;
+    std::vector<std::vector<int>> _rows_by_node;
+    int _indexed_rows;
+    // proxy row to source row, when filtered
+    std::vector<int> _rows;
+
+    void updateNodeVisibility();
+
+    void rebuildRows();
+};
+
+#endif // REPLAY_TABLE_MODEL_H
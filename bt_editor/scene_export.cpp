@@ -0,0 +1,153 @@
+#include "scene_export.h"
+#include <QDir>
+#include <QFileInfo>
+#include <QImage>
+#include <QImageWriter>
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
+#include <QSvgGenerator>
+#include <cmath>
+#include <stdexcept>
+#include <nodes/SceneRender>
+
+#include "models/BehaviorTreeNodeModel.hpp"
+#include "models/SubtreeNodeModel.hpp"
+
+namespace
+{
+
+const qreal EXPORT_MARGIN = 40;
+
+QRectF exportRect(QtNodes::FlowScene& scene)
+{
+    const QRectF rect = scene.itemsBoundingRect();
+    if( rect.isEmpty() )
+    {
+        throw std::runtime_error( "There is nothing to export" );
+    }
+    return rect.adjusted( -EXPORT_MARGIN, -EXPORT_MARGIN, EXPORT_MARGIN, EXPORT_MARGIN );
+}
+
+}
+
+void ExportSceneSVG(QtNodes::FlowScene &scene, const QString &path,
+                    const QColor &background, const QString &title)
+{
+    const QRectF rect = exportRect( scene );
+
+    QSvgGenerator generator;
+    generator.setFileName( path );
+    generator.setTitle( title );
+    generator.setDescription( "Exported by Groot" );
+    generator.setSize( rect.size().toSize() );
+    generator.setViewBox( QRectF( QPointF(0, 0), rect.size() ) );
+
+    QPainter painter;
+    if( !painter.begin( &generator ) )
+    {
+        throw std::runtime_error( QString("Can't write %1").arg( path ).toStdString() );
+    }
+    painter.fillRect( QRectF( QPointF(0, 0), rect.size() ), background );
+    painter.setRenderHint( QPainter::Antialiasing );
+    painter.translate( -rect.topLeft() );
+    QtNodes::renderScene( scene, painter, rect );
+    painter.end();
+}
+
+QStringList ExportScenePNG(QtNodes::FlowScene &scene, const QString &path,
+                           const QColor &background, double scale, int tile_size)
+{
+    const QRectF rect = exportRect( scene );
+    scale = std::max( 0.01, scale );
+    tile_size = std::max( 256, tile_size );
+
+    const int width  = int( std::ceil( rect.width() * scale ) );
+    const int height = int( std::ceil( rect.height() * scale ) );
+    const int columns = ( width + tile_size - 1 ) / tile_size;
+    const int rows    = ( height + tile_size - 1 ) / tile_size;
+
+    // a "tree.png" gives "tree_0_0.png", "tree_0_1.png"...
+    const QFileInfo info( path );
+    const QString base = info.dir().filePath( info.completeBaseName() );
+
+    // the lowest level of detail of the zoom, as the view would draw them
+    QStyleOptionGraphicsItem option;
+    const QtNodes::LevelOfDetail lod =
+        QtNodes::levelOfDetail( option.levelOfDetailFromTransform( QTransform::fromScale( scale, scale ) ) );
+
+    QStringList files;
+    // allocated once
+    QImage tile;
+    for (int row = 0; row < rows; row++)
+    {
+        for (int column = 0; column < columns; column++)
+        {
+            const int tile_width  = std::min( tile_size, width - column * tile_size );
+            const int tile_height = std::min( tile_size, height - row * tile_size );
+            if( tile.width() != tile_width || tile.height() != tile_height )
+            {
+                tile = QImage( tile_width, tile_height, QImage::Format_ARGB32_Premultiplied );
+                if( tile.isNull() )
+                {
+                    throw std::runtime_error( "Not enough memory for a tile of the image" );
+                }
+            }
+            tile.fill( background );
+
+            // the part of the scene of this tile
+            const QRectF tile_rect( rect.left() + column * tile_size / scale,
+                                    rect.top() + row * tile_size / scale,
+                                    tile_width / scale, tile_height / scale );
+            {
+                QPainter painter( &tile );
+                painter.setRenderHint( QPainter::Antialiasing );
+                painter.setRenderHint( QPainter::SmoothPixmapTransform );
+                painter.scale( scale, scale );
+                painter.translate( -tile_rect.topLeft() );
+                painter.setClipRect( tile_rect );
+                QtNodes::renderScene( scene, painter, tile_rect, lod );
+            }
+
+            const QString file = ( rows * columns == 1 ) ?
+                        path : QString("%1_%2_%3.png").arg( base ).arg( row ).arg( column );
+            QImageWriter writer( file, "png" );
+            if( !writer.write( tile ) )
+            {
+                throw std::runtime_error( QString("%1: %2").arg( file, writer.errorString() ).toStdString() );
+            }
+            files.push_back( file );
+        }
+    }
+    return files;
+}
+
+std::shared_ptr<QtNodes::DataModelRegistry> CreateModelRegistry(const NodeModels &models)
+{
+    auto registry = std::make_shared<QtNodes::DataModelRegistry>();
+    auto add = [&registry](const NodeModel& model)
+    {
+        const QString& ID = model.registration_ID;
+        const QString category = ( ID == "Root" ) ? QString("Root") :
+                                                    QString::fromStdString( BT::toStr(model.type) );
+        registry->registerModel( category, [model]() -> QtNodes::DataModelRegistry::RegistryItemPtr
+        {
+            if( model.type == NodeType::SUBTREE )
+            {
+                return std::unique_ptr<QtNodes::NodeDataModel>( new SubtreeNodeModel( model ) );
+            }
+            return std::unique_ptr<QtNodes::NodeDataModel>( new BehaviorTreeDataModel( model ) );
+        }, ID );
+    };
+    for (const auto& it: BuiltinNodeModels())
+    {
+        add( it.second );
+    }
+    for (const auto& it: models)
+    {
+        if( BuiltinNodeModels().count( it.first ) == 0 )
+        {
+            add( it.second );
+        }
+    }
+    return registry;
+}
@@ -0,0 +1,32 @@
+#ifndef SCENE_EXPORT_H
+#define SCENE_EXPORT_H
+
+#include <QColor>
+#include <QString>
+#include <QStringList>
+#include <memory>
+#include <nodes/FlowScene>
+#include <nodes/DataModelRegistry>
+
+#include "bt_editor_base.h"
+
+// Images of a whole tree, for the design reviews. The memory used does not
+// depend on the size of the tree: the PNG are rendered a tile at a time and
+// the SVG is streamed, with QtNodes::renderScene() in both cases.
+
+// Vector image of all the nodes. Throws std::runtime_error.
+void ExportSceneSVG(QtNodes::FlowScene& scene, const QString& path,
+                    const QColor& background, const QString& title = QString());
+
+// The nodes scaled by "scale", in a single PNG if it is not larger than
+// "tile_size" pixels, or else in tiles "<path>_<row>_<column>.png", each one
+// rendered and written before the next. Returns the files written.
+// Throws std::runtime_error.
+QStringList ExportScenePNG(QtNodes::FlowScene& scene, const QString& path,
+                           const QColor& background, double scale = 1.0, int tile_size = 4096);
+
+// The models of the nodes, builtin ones included, registered as the editor
+// does: to build scenes without a MainWindow.
+std::shared_ptr<QtNodes::DataModelRegistry> CreateModelRegistry(const NodeModels& models);
+
+#endif // SCENE_EXPORT_H
@@ -2,6 +2,7 @@
 #include "ui_sidepanel_editor.h"
 #include "custom_node_dialog.h"
 #include "utils.h"
+#include "model_import.h"
 
 #include <QHeaderView>
 #include <QPushButton>
@@ -10,9 +11,43 @@
 #include <QMenu>
 #include <QFileDialog>
 #include <QMessageBox>
-#include <QJsonDocument>
-#include <QJsonArray>
 #include <QSettings>
+#include <QMimeData>
+
+namespace
+{
+const char* PALETTE_MIME_TYPE = "application/x-qabstractitemmodeldatalist";
+}
+
+void PaletteFilterModel::setMatches(bool filtered, QSet<QString> matches)
+{
+    _filtered = filtered;
+    _matches = std::move(matches);
+    invalidateFilter();
+}
+
+QStringList PaletteFilterModel::mimeTypes() const
+{
+    return { PALETTE_MIME_TYPE };
+}
+
+QMimeData *PaletteFilterModel::mimeData(const QModelIndexList &indexes) const
+{
+    // encoded as the items of a QTreeWidget, see EditorFlowScene::dropEvent()
+    return QAbstractItemModel::mimeData( indexes );
+}
+
+bool PaletteFilterModel::filterAcceptsRow(int source_row, const QModelIndex &source_parent) const
+{
+    if( !_filtered )
+    {
+        return true;
+    }
+    const QModelIndex index = sourceModel()->index( source_row, 0, source_parent );
+    const QString ID = index.data( Qt::UserRole ).toString();
+    // the categories are always visible
+    return ID.isEmpty() || _matches.contains( ID );
+}
 
 SidepanelEditor::SidepanelEditor(QtNodes::DataModelRegistry *registry,
                                  NodeModels &tree_nodes_model,
@@ -24,11 +59,35 @@ SidepanelEditor::SidepanelEditor(QtNodes::DataModelRegistry *registry,
 {
     ui->setupUi(this);   
     ui->paramsFrame->setHidden(true);
-    ui->paletteTreeWidget->setContextMenuPolicy(Qt::CustomContextMenu);
 
-    connect( ui->paletteTreeWidget, &QWidget::customContextMenuRequested,
+    _palette_model = new QStandardItemModel(this);
+    _palette_filter = new PaletteFilterModel(this);
+    _palette_filter->setSourceModel( _palette_model );
+    ui->paletteTreeView->setModel( _palette_filter );
+    ui->paletteTreeView->setContextMenuPolicy(Qt::CustomContextMenu);
+
+    for (const QString& category : {"Action", "Condition",
+                                    "Control", "Decorator", "SubTree" } )
+    {
+      auto item = new QStandardItem(category);
+      QFont font = item->font();
+      font.setBold(true);
+      font.setPointSize(11);
+      item->setFont(font);
+      item->setEditable(false);
+      item->setDragEnabled(false);
+      item->setDropEnabled(false);
+      item->setSelectable(false);
+      _palette_model->appendRow(item);
+      _tree_view_category_items[ category ] = item;
+    }
+
+    connect( ui->paletteTreeView, &QWidget::customContextMenuRequested,
              this, &SidepanelEditor::onContextMenu);
 
+    connect( ui->paletteTreeView->selectionModel(), &QItemSelectionModel::selectionChanged,
+             this, &SidepanelEditor::onPaletteSelectionChanged);
+
     auto table_header = ui->portsTableWidget->horizontalHeader();
 
     table_header->setSectionResizeMode(0, QHeaderView::ResizeToContents);
@@ -43,6 +102,10 @@ SidepanelEditor::SidepanelEditor(QtNodes::DataModelRegistry *registry,
 
 SidepanelEditor::~SidepanelEditor()
 {
+    for (auto worker: findChildren<ModelImportWorker*>())
+    {
+        worker->wait();
+    }
     QSettings settings;
     settings.setValue("SidepanelEditor/header",
                       ui->portsTableWidget->horizontalHeader()->saveState() );
@@ -50,52 +113,114 @@ SidepanelEditor::~SidepanelEditor()
     delete ui;
 }
 
+void SidepanelEditor::updateItemStyle(QStandardItem *item) const
+{
+    const QString ID = item->data(Qt::UserRole).toString();
+    const bool is_builtin = BuiltinNodeModels().count( ID ) > 0;
+    const bool is_editable = (!ui->buttonLock->isChecked() && !is_builtin);
+
+    QFont font = item->font();
+    font.setItalic( is_builtin );
+    font.setPointSize(11);
+    item->setFont(font);
+    item->setForeground( is_editable ? QBrush(QColor(70, 110, 154)) : QBrush() );
+}
+
 void SidepanelEditor::updateTreeView()
 {
-    ui->paletteTreeWidget->clear();
-    _tree_view_category_items.clear();
+    bool changed = false;
 
-    for (const QString& category : {"Action", "Condition",
-                                    "Control", "Decorator", "SubTree" } )
+    // removed, or moved to another category
+    for (auto it = _tree_view_model_items.begin(); it != _tree_view_model_items.end(); )
     {
-      auto item = new QTreeWidgetItem(ui->paletteTreeWidget, {category});
-      QFont font = item->font(0);
-      font.setBold(true);
-      font.setPointSize(11);
-      item->setFont(0, font);
-      item->setFlags( item->flags() ^ Qt::ItemIsDragEnabled );
-      item->setFlags( item->flags() ^ Qt::ItemIsSelectable );
-      _tree_view_category_items[ category ] = item;
+        QStandardItem* item = it->second;
+        auto model_it = _tree_nodes_model.find( it->first );
+        const bool keep = model_it != _tree_nodes_model.end() &&
+                item->parent() == _tree_view_category_items[ QString::fromStdString(toStr(model_it->second.type)) ];
+        if( keep )
+        {
+            ++it;
+            continue;
+        }
+        item->parent()->removeRow( item->row() );
+        _palette_index.remove( it->first );
+        it = _tree_view_model_items.erase( it );
+        changed = true;
     }
 
+    // added: appended at once to an empty category, else in sorted order
+    std::map<QStandardItem*, QList<QStandardItem*>> appended;
     for (const auto &it : _tree_nodes_model)
     {
       const auto& ID = it.first;
       const NodeModel& model = it.second;
 
-      if( model.registration_ID == "Root")
+      if( model.registration_ID == "Root" || _tree_view_model_items.count( ID ) )
       {
           continue;
       }
       QString category = QString::fromStdString(toStr(model.type));
-      auto parent = _tree_view_category_items[category];
-      auto item = new QTreeWidgetItem(parent, {ID});
-      const bool is_builtin = BuiltinNodeModels().count( ID ) > 0;
-      const bool is_editable = (!ui->buttonLock->isChecked() && !is_builtin);
+      auto category_it = _tree_view_category_items.find(category);
+      if( category_it == _tree_view_category_items.end() )
+      {
+          continue;
+      }
+      QStandardItem* parent = category_it->second;
 
-      QFont font = item->font(0);
-      font.setItalic( is_builtin );
-      font.setPointSize(11);
-      item->setFont(0, font);
-      item->setData(0, Qt::UserRole, ID);
+      auto item = new QStandardItem(ID);
+      item->setData(ID, Qt::UserRole);
+      item->setEditable(false);
+      item->setDropEnabled(false);
+      updateItemStyle(item);
 
-      if (is_editable)
+      _tree_view_model_items[ID] = item;
+      _palette_index.update( ID, ID );
+      changed = true;
+
+      if( parent->rowCount() == 0 || appended.count(parent) )
+      {
+          appended[parent].push_back(item);
+          continue;
+      }
+      int first = 0;
+      int last  = parent->rowCount();
+      while( first < last )
       {
-        item->setForeground(0, QBrush(QColor(70, 110, 154)));
+          const int mid = (first + last) / 2;
+          if( parent->child(mid)->text() < ID )
+          {
+              first = mid + 1;
+          }
+          else{
+              last = mid;
+          }
       }
+      parent->insertRow(first, item);
+    }
+    for (auto& it: appended)
+    {
+        it.first->appendRows( it.second );
+    }
+
+    if( changed )
+    {
+        applyPaletteFilter();
     }
+}
 
-    ui->paletteTreeWidget->expandAll();
+void SidepanelEditor::applyPaletteFilter()
+{
+    const QString text = ui->lineEditFilter->text();
+    QSet<QString> matches;
+    if( !text.isEmpty() )
+    {
+        for (const QString& ID: _palette_index.find( text ))
+        {
+            matches.insert( ID );
+        }
+    }
+    _palette_filter->setMatches( !text.isEmpty(), std::move(matches) );
+    ui->paletteTreeView->expandAll();
 }
 
 void SidepanelEditor::clear()
@@ -103,20 +228,21 @@ void SidepanelEditor::clear()
 
 }
 
-void SidepanelEditor::on_paletteTreeWidget_itemSelectionChanged()
+void SidepanelEditor::onPaletteSelectionChanged()
 {
-  auto selected_items = ui->paletteTreeWidget->selectedItems();
-  if(selected_items.size() == 0)
+  auto selected_indexes = ui->paletteTreeView->selectionModel()->selectedIndexes();
+  auto model_it = selected_indexes.empty() ? _tree_nodes_model.end() :
+                           _tree_nodes_model.find( selected_indexes.front().data(Qt::UserRole).toString() );
+  if( model_it == _tree_nodes_model.end() )
   {
     ui->paramsFrame->setHidden(true);
   }
   else {
-    auto selected_item = selected_items.front();
-    QString item_name = selected_item->text(0);
+    QString item_name = model_it->first;
     ui->paramsFrame->setHidden(false);
     ui->label->setText( item_name + QString(" Parameters"));
 
-    const auto& model = _tree_nodes_model.at(item_name);
+    const auto& model = model_it->second;
 
     ui->portsTableWidget->setRowCount( model.ports.size() );
 
@@ -133,18 +259,9 @@ void SidepanelEditor::on_paletteTreeWidget_itemSelectionChanged()
 
 }
 
-void SidepanelEditor::on_lineEditFilter_textChanged(const QString &text)
+void SidepanelEditor::on_lineEditFilter_textChanged(const QString &)
 {
-  for (auto& it : _tree_view_category_items)
-  {
-    for (int i = 0; i < it.second->childCount(); ++i)
-    {
-      auto child = it.second->child(i);
-      auto modelName = child->data(0, Qt::UserRole).toString();
-      bool show = modelName.contains(text, Qt::CaseInsensitive);
-      child->setHidden( !show);
-    }
-  }
+    applyPaletteFilter();
 }
 
 
@@ -180,12 +297,12 @@ void SidepanelEditor::onRemoveModel(QString selected_name)
 
 void SidepanelEditor::onContextMenu(const QPoint& pos)
 {
-    QTreeWidgetItem* selected_item = ui->paletteTreeWidget->itemAt(pos);
-    if( selected_item == nullptr)
+    // the categories have no ID
+    QString selected_name = ui->paletteTreeView->indexAt(pos).data(Qt::UserRole).toString();
+    if( selected_name.isEmpty() )
     {
         return;
     }
-    QString selected_name = selected_item->text(0);
 
     if( ui->buttonLock->isChecked() ||
         BuiltinNodeModels().count( selected_name ) != 0 )
@@ -193,16 +310,6 @@ void SidepanelEditor::onContextMenu(const QPoint& pos)
         return;
     }
 
-    // Loop through the category items and prevent the right click
-    // menu from showing for any of the items
-    for (const auto& it : _tree_view_category_items)
-    {
-        const auto category_item = it.second;
-        if( category_item == selected_item ) {
-            return;
-        }
-    }
-
     QMenu menu(this);
 
     QAction* edit   = menu.addAction("Edit");
@@ -222,7 +329,7 @@ void SidepanelEditor::onContextMenu(const QPoint& pos)
         emit modelRemoveRequested(selected_name);
     } );
 
-    QPoint globalPos = ui->paletteTreeWidget->mapToGlobal(pos);
+    QPoint globalPos = ui->paletteTreeView->viewport()->mapToGlobal(pos);
     menu.exec(globalPos);
 
     QApplication::processEvents();
@@ -330,17 +437,25 @@ void SidepanelEditor::on_buttonDownload_clicked()
     settings.sync();
 
     //--------------------------------
-    NodeModels imported_models;
-    if( fileInfo.suffix() == "xml" )
+    // parsed on another thread; the button waits for the end of it
+    ui->buttonDownload->setEnabled( false );
+    auto worker = new ModelImportWorker( fileName, this );
+    connect( worker, &QThread::finished, this, [this, worker]()
     {
-        QFile file(fileName);
-        imported_models = importFromXML( &file );
-    }
-    else if( fileInfo.completeSuffix() == "skills.json" )
+        worker->deleteLater();
+        ui->buttonDownload->setEnabled( true );
+        onModelsImported( worker->models(), worker->error() );
+    });
+    worker->start();
+}
+
+void SidepanelEditor::onModelsImported(const NodeModels& imported_models, const QString& error)
+{
+    if( !error.isEmpty() )
     {
-        imported_models = importFromSkills( fileName );
+        QMessageBox::warning(this, "Error loading TreeNodeModel from file", error);
+        return;
     }
-
     if( imported_models.empty() )
     {
         return;
@@ -353,104 +468,8 @@ void SidepanelEditor::on_buttonDownload_clicked()
         emit modelRemoveRequested(model_name);
     }
 
-    for(auto& it: imported_models)
-    {
-        emit addNewModel( it.second );
-    }
-}
-
-NodeModels SidepanelEditor::importFromXML(QFile* file)
-{
-    QDomDocument doc;
-
-
-    if (!file->open(QIODevice::ReadOnly))
-    {
-        QMessageBox::warning(this,"Error loading TreeNodeModel from file",
-                             "The XML was not correctly loaded");
-        return {};
-    }
-
-    QString errorMsg;
-    int errorLine;
-    if( ! doc.setContent(file, &errorMsg, &errorLine ) )
-    {
-        auto error = tr("Error parsing XML (line %1): %2").arg(errorLine).arg(errorMsg);
-        QMessageBox::warning(this,"Error loading TreeNodeModel form file", error);
-        file->close();
-        return {};
-    }
-    file->close();
-
-    NodeModels custom_models;
-
-    QDomElement xml_root = doc.documentElement();
-    if ( xml_root.isNull() || xml_root.tagName() != "root")
-    {
-        QMessageBox::warning(this,"Error loading TreeNodeModel form file",
-                             "The XML must have a root node called <root>");
-        return custom_models;
-    }
-
-    auto manifest_root = xml_root.firstChildElement("TreeNodesModel");
-
-    if ( manifest_root.isNull() )
-    {
-        QMessageBox::warning(this,"Error loading TreeNodeModel form file",
-                             "Expecting <TreeNodesModel> under <root>");
-        return custom_models;
-    }
-
-    for( QDomElement model_element = manifest_root.firstChildElement();
-         !model_element.isNull();
-         model_element = model_element.nextSiblingElement() )
-    {
-        auto model = buildTreeNodeModelFromXML(model_element);
-        custom_models.insert( { model.registration_ID, model } );
-    }
-
-    return custom_models;
-}
-
-NodeModels SidepanelEditor::importFromSkills(const QString &fileName)
-{
-    NodeModels custom_models;
-
-    QFile loadFile(fileName);
-
-    if (!loadFile.open(QIODevice::ReadOnly))
-    {
-        QMessageBox::warning(this,"Error loading Skills",
-                             tr("Something wrong with %1").arg(fileName) );
-        return custom_models;
-    }
-
-    // TODO VER_3
-//     QJsonDocument loadDoc =  QJsonDocument::fromJson( loadFile.readAll() ) ;
-
-//     QJsonArray root_array = loadDoc.array();
-
-//     for (QJsonValueRef skill_node : root_array)
-//     {
-
-//         auto skill = skill_node.toObject()["skill"].toObject();
-//         auto name = skill["name"].toString();
-//         qDebug() << name;
-
-//         auto attributes = skill["in-attribute"].toObject();
-//         auto params_keys = attributes.keys();
-
-//         PortModels ports_models;
-
-//         for (const auto& key: params_keys)
-//         {
-//             ports_models.insert(  {key, attributes[key].toString()} );
-//         }
-//         NodeModel model = { NodeType::ACTION, name, ports_mapping };
-//         custom_models.insert( {name, model} );
-//     }
-
-    return custom_models;
+    // registered together, the palette is updated once
+    emit addNewModels( imported_models );
 }
 
 
@@ -460,5 +479,8 @@ void SidepanelEditor::on_buttonLock_toggled(bool locked)
     static QIcon icon_unlocked( QPixmap(":/icons/svg/lock_open.svg") );
 
     ui->buttonLock->setIcon( locked ? icon_locked : icon_unlocked);
-    updateTreeView();
+    for (auto& it: _tree_view_model_items)
+    {
+        updateItemStyle( it.second );
+    }
 }
@@ -3,14 +3,39 @@
 
 #include <QFrame>
 #include <QFile>
-#include <QTreeWidgetItem>
+#include <QStandardItemModel>
+#include <QSortFilterProxyModel>
 #include <QTableWidgetItem>
+#include <QSet>
 #include "XML_utilities.hpp"
+#include "trigram_index.h"
 
 namespace Ui {
 class SidepanelEditor;
 }
 
+// Shows the categories and the models in the matches of the filter; all
+// of them when there is no filter.
+class PaletteFilterModel : public QSortFilterProxyModel
+{
+public:
+    explicit PaletteFilterModel(QObject* parent = nullptr):
+        QSortFilterProxyModel(parent), _filtered(false) {}
+
+    void setMatches(bool filtered, QSet<QString> matches);
+
+    QStringList mimeTypes() const override;
+
+    QMimeData* mimeData(const QModelIndexList &indexes) const override;
+
+protected:
+    bool filterAcceptsRow(int source_row, const QModelIndex &source_parent) const override;
+
+private:
+    bool _filtered;
+    QSet<QString> _matches;
+};
+
 class SidepanelEditor : public QFrame
 {
     Q_OBJECT
@@ -21,6 +46,8 @@ public:
                              QWidget *parent = nullptr);
     ~SidepanelEditor();
 
+    // the palette follows the models: only the items of the models added,
+    // removed or changed since the last call are updated
     void updateTreeView();
 
     void clear();
@@ -33,7 +60,7 @@ public slots:
 
 private slots:
 
-    void on_paletteTreeWidget_itemSelectionChanged();
+    void onPaletteSelectionChanged();
 
     void on_lineEditFilter_textChanged(const QString &arg1);
 
@@ -51,6 +78,8 @@ signals:
 
     void addNewModel(const NodeModel &new_model);
 
+    void addNewModels(const NodeModels &new_models);
+
     void modelRemoveRequested(QString ID);
 
     void nodeModelEdited(QString prev_ID, QString new_ID);
@@ -65,11 +94,18 @@ private:
     Ui::SidepanelEditor *ui;
     NodeModels &_tree_nodes_model;
     QtNodes::DataModelRegistry* _model_registry;
-    std::map<QString, QTreeWidgetItem*> _tree_view_category_items;
+    QStandardItemModel* _palette_model;
+    PaletteFilterModel* _palette_filter;
+    std::map<QString, QStandardItem*> _tree_view_category_items;
+    // by registration_ID
+    std::map<QString, QStandardItem*> _tree_view_model_items;
+    TrigramIndex<QString, QStringHash> _palette_index;
+
+    void applyPaletteFilter();
 
-    NodeModels importFromXML(QFile *file);
+    void updateItemStyle(QStandardItem* item) const;
 
-    NodeModels importFromSkills(const QString& filename);
+    void onModelsImported(const NodeModels& imported_models, const QString& error);
 
 };
 
@@ -5,7 +5,20 @@
 #include <QMessageBox>
 #include <QTimer>
 #include <QLabel>
+#include <QProgressBar>
+#include <QListWidget>
+#include <QSlider>
+#include <QFileDialog>
+#include <QSettings>
+#include <QDir>
+#include <QFileInfo>
+#include <QMenu>
+#include <QApplication>
+#include <QClipboard>
+#include <QJsonArray>
+#include <QSaveFile>
 #include <QDebug>
+#include <algorithm>
 
 #include "mainwindow.h"
 #include "utils.h"
@@ -14,251 +27,483 @@ SidepanelMonitor::SidepanelMonitor(QWidget *parent) :
     QFrame(parent),
     ui(new Ui::SidepanelMonitor),
     _zmq_context(1),
-    _zmq_subscriber(_zmq_context, ZMQ_SUB),
-    _connected(false),
-    _msg_count(0),
+    _receiver(nullptr),
+    _tree_cache(TREE_CACHE_SIZE),
+    _stats_path( QString::fromLocal8Bit( qgetenv("GROOT_MONITOR_STATS") ) ),
     _parent(parent)
 {
     ui->setupUi(this);
+    ui->progressBarFetch->setHidden(true);
+
+    _receiver = new MonitorReceiver( _zmq_context, this );
     _timer = new QTimer(this);
 
     connect( _timer, &QTimer::timeout, this, &SidepanelMonitor::on_timer );
+
+    connect( ui->listSessions, &QWidget::customContextMenuRequested,
+             this, &SidepanelMonitor::onSessionContextMenu);
 }
 
 SidepanelMonitor::~SidepanelMonitor()
 {
+    // sockets must be closed before _zmq_context is destroyed
+    for(auto session: _sessions)
+    {
+        delete session;
+    }
+    _sessions.clear();
+    delete _receiver;
+
     delete ui;
 }
 
 void SidepanelMonitor::clear()
 {
-    if( _connected ) this->on_Connect();
+    while( _sessions.size() > 1 )
+    {
+        removeSession( _sessions.back() );
+    }
+    if( !_sessions.empty() )
+    {
+        _sessions.front()->disconnectFromServer();
+    }
+    updateSessionList();
 }
 
 void SidepanelMonitor::on_timer()
 {
-    if( !_connected ) return;
+    bool any_connected = false;
+    int msg_count = 0;
 
-    zmq::message_t msg;
-    try{
-        while(  _zmq_subscriber.recv(&msg) )
-        {
-            _msg_count++;
-            ui->labelCount->setText( QString("Messages received: %1").arg(_msg_count) );
-
-            const char* buffer = reinterpret_cast<const char*>(msg.data());
-
-            const uint32_t header_size = flatbuffers::ReadScalar<uint32_t>( buffer );
-            const uint32_t num_transitions = flatbuffers::ReadScalar<uint32_t>( &buffer[4+header_size] );
-            
-            std::vector<std::pair<int, NodeStatus>> node_status;
-            // check uid in the index, if failed load tree from server
-            try{
-                for(size_t offset = 4; offset < header_size +4; offset +=3 )
-                {
-                    const uint16_t uid = flatbuffers::ReadScalar<uint16_t>(&buffer[offset]);
-                    _uid_to_index.at(uid);
-                }
-                
-                for(size_t t=0; t < num_transitions; t++)
-                {
-                    size_t offset = 8 + header_size + 12*t;
-                    const uint16_t uid = flatbuffers::ReadScalar<uint16_t>(&buffer[offset+8]);
-                    _uid_to_index.at(uid);
-                }
-
-                for(size_t offset = 4; offset < header_size +4; offset +=3 )
-                {
-                    const uint16_t uid = flatbuffers::ReadScalar<uint16_t>(&buffer[offset]);
-                    const uint16_t index = _uid_to_index.at(uid);
-                    AbstractTreeNode* node = _loaded_tree.node( index );
-                    node->status = convert(flatbuffers::ReadScalar<Serialization::NodeStatus>(&buffer[offset+2] ));
-                }
-
-                //qDebug() << "--------";
-                for(size_t t=0; t < num_transitions; t++)
-                {
-                    size_t offset = 8 + header_size + 12*t;
-
-                    // const double t_sec  = flatbuffers::ReadScalar<uint32_t>( &buffer[offset] );
-                    // const double t_usec = flatbuffers::ReadScalar<uint32_t>( &buffer[offset+4] );
-                    // double timestamp = t_sec + t_usec* 0.000001;
-                    const uint16_t uid = flatbuffers::ReadScalar<uint16_t>(&buffer[offset+8]);
-                    const uint16_t index = _uid_to_index.at(uid);
-                    // NodeStatus prev_status = convert(flatbuffers::ReadScalar<Serialization::NodeStatus>(&buffer[index+10] ));
-                    NodeStatus status  = convert(flatbuffers::ReadScalar<Serialization::NodeStatus>(&buffer[offset+11] ));
-
-                    _loaded_tree.node(index)->status = status;
-                    node_status.push_back( {index, status} );
-
-                }
-            }
-            catch( std::out_of_range& err) {
-                qDebug() << "Reload tree from server";
-                if( !getTreeFromServer() ) {
-                    _connected = false;
-                    ui->lineEdit->setDisabled(false);
-                    _timer->stop();
-                    connectionUpdate(false);
-                    return;
-                }
-            }
+    for(auto session: _sessions)
+    {
+        session->update();
+        any_connected |= session->isConnected();
+        msg_count += session->messagesCount();
+    }
 
-            // update the graphic part
-            emit changeNodeStyle( "BehaviorTree", node_status );
+    ui->labelCount->setText( QString("Messages received: %1").arg(msg_count) );
+    updateSessionList();
+    updateHistoryLabel();
+    updateStatsLabel();
 
-            // lock editing of nodes
-            auto main_win = dynamic_cast<MainWindow*>( _parent );
-            main_win->lockEditing(true);
-        }
+    if( !_stats_path.isEmpty() &&
+        ( !_stats_timer.isValid() || _stats_timer.elapsed() >= STATS_FILE_PERIOD_MS ) )
+    {
+        writeStatsFile();
     }
-    catch( zmq::error_t& err)
+
+    if( !any_connected )
     {
-        qDebug() << "ZMQ receive failed: " << err.what();
+        _timer->stop();
     }
 }
 
-bool SidepanelMonitor::getTreeFromServer()
+void SidepanelMonitor::writeStatsFile()
 {
-    try{
-        zmq::message_t request(0);
-        zmq::message_t reply;
+    _stats_timer.start();
+    QSaveFile file( _stats_path );
+    if( file.open( QIODevice::WriteOnly ) )
+    {
+        file.write( statsToJson().toJson() );
+        file.commit();
+    }
+}
 
-        zmq::socket_t  zmq_client( _zmq_context, ZMQ_REQ );
-        zmq_client.connect( _connection_address_req.c_str() );
+bool SidepanelMonitor::readAddresses(std::string &address_pub, std::string &address_req)
+{
+    QString address = ui->lineEdit->text();
+    if( address.isEmpty() )
+    {
+        address = ui->lineEdit->placeholderText();
+        ui->lineEdit->setText(address);
+    }
 
-        int timeout_ms = 1000;
-        zmq_client.setsockopt(ZMQ_RCVTIMEO,&timeout_ms, sizeof(int) );
+    QString publisher_port = ui->lineEdit_publisher->text();
+    if( publisher_port.isEmpty() )
+    {
+        publisher_port = ui->lineEdit_publisher->placeholderText();
+        ui->lineEdit_publisher->setText(publisher_port);
+    }
 
-        zmq_client.send(request);
+    QString server_port = ui->lineEdit_server->text();
+    if( server_port.isEmpty() )
+    {
+      server_port = ui->lineEdit_server->placeholderText();
+      ui->lineEdit_server->setText(server_port);
+    }
 
-        bool received = zmq_client.recv(&reply);
-        if( ! received )
-        {
-            return false;
-        }
+    if( address.isEmpty() )
+    {
+        return false;
+    }
+    address_pub = MonitorEndpoint( address, publisher_port );
+    address_req = MonitorEndpoint( address, server_port );
+    return true;
+}
 
-        const char* buffer = reinterpret_cast<const char*>(reply.data());
-        auto fb_behavior_tree = Serialization::GetBehaviorTree( buffer );
+MonitorSession *SidepanelMonitor::createSession(const QString &tab_name)
+{
+    auto session = new MonitorSession( tab_name, _zmq_context, *_receiver, _tree_cache,
+                                       dynamic_cast<MainWindow*>( _parent ), this );
 
-        auto res_pair = BuildTreeFromFlatbuffers( fb_behavior_tree );
+    connect( session, &MonitorSession::loadBehaviorTree,
+             this, &SidepanelMonitor::loadBehaviorTree );
 
-        _loaded_tree  = std::move( res_pair.first );
-        _uid_to_index = std::move( res_pair.second );
+    connect( session, &MonitorSession::changeNodeStyle,
+             this, &SidepanelMonitor::changeNodeStyle );
 
-        // add new models to registry
-        for(const auto& tree_node: _loaded_tree.nodes())
-        {
-            const auto& registration_ID = tree_node.model.registration_ID;
-            if( BuiltinNodeModels().count(registration_ID) == 0)
-            {
-                addNewModel( tree_node.model );
-            }
-        }
+    connect( session, &MonitorSession::addNewModel,
+             this, &SidepanelMonitor::addNewModel );
 
-        try {
-            loadBehaviorTree( _loaded_tree, "BehaviorTree" );
+    connect( session, &MonitorSession::connectionUpdate,
+             this, [this, session](bool connected)
+    {
+        if( connected && !_timer->isActive() )
+        {
+            _timer->start(20);
         }
-        catch (std::exception& err) {
-            QMessageBox messageBox;
-            messageBox.critical(this,"Error Connecting to remote server", err.what() );
-            messageBox.show();
-            return false;
+        if( !_sessions.empty() && _sessions.front() == session )
+        {
+            emit connectionUpdate(connected);
         }
+        updateSessionList();
+    });
+
+    connect( session, &MonitorSession::connectionFailed,
+             this, [this](QString error)
+    {
+        ui->progressBarFetch->setHidden(true);
+        updateSessionList();
+        QMessageBox::warning(this, tr("ZeroMQ connection"), error, QMessageBox::Close);
+    });
+
+    connect( session, &MonitorSession::recordingStopped,
+             this, [this](QString filename)
+    {
+        qDebug() << "Stopped recording " << filename;
+        updateSessionList();
+    });
+
+    connect( session, &MonitorSession::recordingFailed,
+             this, [this](QString filename, QString error)
+    {
+        updateSessionList();
+        QMessageBox::warning(this, tr("Record Log"),
+                             tr("Stopped recording to [%1]\n%2").arg(filename, error),
+                             QMessageBox::Close);
+    });
+
+    connect( session, &MonitorSession::fetchProgress,
+             this, [this](int elapsed_ms, int timeout_ms)
+    {
+        ui->progressBarFetch->setRange(0, timeout_ms);
+        ui->progressBarFetch->setValue(elapsed_ms);
+        ui->progressBarFetch->setHidden( elapsed_ms >= timeout_ms );
+    });
 
-        std::vector<std::pair<int, NodeStatus>> node_status;
-        node_status.reserve(_loaded_tree.nodesCount());
+    _sessions.push_back( session );
+    return session;
+}
+
+void SidepanelMonitor::removeSession(MonitorSession *session)
+{
+    auto it = std::find( _sessions.begin(), _sessions.end(), session );
+    if( it != _sessions.end() )
+    {
+        _sessions.erase( it );
+    }
+    session->disconnectFromServer();
+    session->deleteLater();
+}
 
-        //  qDebug() << "--------";
+void SidepanelMonitor::connectSession(MonitorSession *session)
+{
+    std::string address_pub;
+    std::string address_req;
+    bool failed = !readAddresses( address_pub, address_req );
 
-        for(size_t t=0; t < _loaded_tree.nodesCount(); t++)
+    if( !failed )
+    {
+        try{
+            // the connection is completed when the tree is received
+            session->connectToServer( address_pub, address_req );
+        }
+        catch(zmq::error_t& err)
         {
-            node_status.push_back( { t, _loaded_tree.nodes()[t].status } );
+            failed = true;
+            session->disconnectFromServer();
         }
-        emit changeNodeStyle( "BehaviorTree", node_status );
     }
-    catch( zmq::error_t& err)
+
+    if( failed )
     {
-        qDebug() << "ZMQ client receive failed: " << err.what();
-        return false;
+        QMessageBox::warning(this,
+                             tr("ZeroMQ connection"),
+                             tr("Was not able to connect to [%1]\n").arg(address_pub.c_str()),
+                             QMessageBox::Close);
     }
-    return true;
+    updateSessionList();
 }
 
 void SidepanelMonitor::on_Connect()
 {
-    if( !_connected)
+    MonitorSession* main_session = _sessions.empty() ? nullptr : _sessions.front();
+
+    if( main_session && (main_session->isConnected() || main_session->isConnecting()) )
     {
-        QString address = ui->lineEdit->text();
-        if( address.isEmpty() )
+        // disconnect, or cancel while still waiting for the tree
+        main_session->disconnectFromServer();
+        updateSessionList();
+        return;
+    }
+
+    if( !main_session )
+    {
+        main_session = createSession("BehaviorTree");
+    }
+    connectSession( main_session );
+}
+
+void SidepanelMonitor::on_buttonAddSession_clicked()
+{
+    MonitorSession* main_session = _sessions.empty() ? nullptr : _sessions.front();
+    if( !main_session || (!main_session->isConnected() && !main_session->isConnecting()) )
+    {
+        on_Connect();
+        return;
+    }
+
+    const QString tab_name = ui->lineEdit->text() + ":" + ui->lineEdit_publisher->text();
+    for(auto session: _sessions)
+    {
+        if( session->tabName() == tab_name )
         {
-            address = ui->lineEdit->placeholderText();
-            ui->lineEdit->setText(address);
+            if( !session->isConnected() && !session->isConnecting() )
+            {
+                connectSession( session );
+            }
+            return;
         }
+    }
+    connectSession( createSession(tab_name) );
+}
 
-        QString publisher_port = ui->lineEdit_publisher->text();
-        if( publisher_port.isEmpty() )
-        {
-            publisher_port = ui->lineEdit_publisher->placeholderText();
-            ui->lineEdit_publisher->setText(publisher_port);
+void SidepanelMonitor::onSessionContextMenu(const QPoint &pos)
+{
+    const int row = ui->listSessions->row( ui->listSessions->itemAt(pos) );
+    if( row < 0 || row >= int(_sessions.size()) )
+    {
+        return;
+    }
+    MonitorSession* session = _sessions[row];
+
+    QMenu menu(this);
+    QAction* disconnect_action = menu.addAction("Disconnect");
+    disconnect_action->setEnabled( session->isConnected() || session->isConnecting() || row > 0 );
+    QAction* copy_stats_action = menu.addAction("Copy Statistics (JSON)");
+
+    connect( copy_stats_action, &QAction::triggered, this, [this]()
+    {
+        QApplication::clipboard()->setText( statsToJson().toJson() );
+    } );
+
+    connect( disconnect_action, &QAction::triggered, this, [this, session, row]()
+    {
+        if( row == 0 ) {
+            session->disconnectFromServer();
+        }
+        else{
+            removeSession(session);
         }
+        updateSessionList();
+    } );
+
+    menu.exec( ui->listSessions->mapToGlobal(pos) );
+}
 
-        QString server_port = ui->lineEdit_server->text();
-        if( server_port.isEmpty() )
+void SidepanelMonitor::updateSessionList()
+{
+    while( ui->listSessions->count() > int(_sessions.size()) )
+    {
+        delete ui->listSessions->takeItem( ui->listSessions->count() - 1 );
+    }
+    while( ui->listSessions->count() < int(_sessions.size()) )
+    {
+        ui->listSessions->addItem( QString() );
+    }
+
+    for(size_t row = 0; row < _sessions.size(); row++)
+    {
+        const MonitorSession* session = _sessions[row];
+        QString state = session->isConnected()  ? tr("%1 msgs").arg(session->messagesCount()) :
+                        session->isConnecting() ? tr("connecting...") : tr("disconnected");
+        QString tooltip = session->publisherAddress().c_str();
+        if( session->isRecording() )
         {
-          publisher_port = ui->lineEdit_server->placeholderText();
-          ui->lineEdit_server->setText(publisher_port);
+            state += tr(", recording");
+        }
+        else if( !session->recordingError().isEmpty() )
+        {
+            state += tr(", recording failed");
+            tooltip += "\n" + session->recordingError();
         }
 
-        bool failed = false;
-        if( !address.isEmpty() )
+        const QString text = QString("%1 [%2]").arg( session->tabName(), state );
+        auto item = ui->listSessions->item( int(row) );
+        if( item->text() != text || item->toolTip() != tooltip )
         {
-            _connection_address_pub = "tcp://" + address.toStdString() + ":" + publisher_port.toStdString();
-            _connection_address_req = "tcp://" + address.toStdString() + ":" + server_port.toStdString();
+            item->setText( text );
+            item->setToolTip( tooltip );
+        }
+    }
 
-            try{
-                _zmq_subscriber.connect( _connection_address_pub.c_str() );
+    MonitorSession* selected = selectedSession();
+    ui->buttonRecord->setEnabled( selected && selected->isConnected() );
+    ui->buttonRecord->setChecked( selected && selected->isRecording() );
+    ui->buttonRecord->setText( ui->buttonRecord->isChecked() ? tr("Stop Recording") : tr("Record...") );
+}
 
-                int timeout_ms = 1;
-                _zmq_subscriber.setsockopt(ZMQ_SUBSCRIBE, "", 0);
-                _zmq_subscriber.setsockopt(ZMQ_RCVTIMEO,&timeout_ms, sizeof(int) );
+void SidepanelMonitor::on_buttonRecord_clicked()
+{
+    MonitorSession* session = selectedSession();
+    if( !session )
+    {
+        return;
+    }
+    if( session->isRecording() )
+    {
+        session->stopRecording();
+        updateSessionList();
+        return;
+    }
 
-                if( !getTreeFromServer() )
-                {
-                    failed = true;
-                    _connected = false;
-                }
-            }
-            catch(zmq::error_t& err)
-            {
-                failed = true;
-            }
-        }
-        else {
-            failed = true;
-        }
+    QSettings settings;
+    QString directory_path  = settings.value("SidepanelMonitor.lastRecordDirectory",
+                                             QDir::homePath() ).toString();
 
-        if( !failed )
+    QString filename = QFileDialog::getSaveFileName(this, "Record Log",
+                                                    directory_path, "Flatbuffers log (*.fbl)");
+    if( !filename.isEmpty() )
+    {
+        if( !filename.endsWith(".fbl") )
         {
-            _connected = true;
-            ui->lineEdit->setDisabled(true);
-            ui->lineEdit_publisher->setDisabled(true);
-            _timer->start(20);
-            connectionUpdate(true);
+            filename += ".fbl";
         }
-        else{
-            QMessageBox::warning(this,
-                                 tr("ZeroMQ connection"),
-                                 tr("Was not able to connect to [%1]\n").arg(_connection_address_pub.c_str()),
+        QString error;
+        if( !session->startRecording( filename, error ) )
+        {
+            QMessageBox::warning(this, tr("Record Log"),
+                                 tr("Was not able to record to [%1]\n%2").arg(filename, error),
                                  QMessageBox::Close);
         }
+        else{
+            directory_path = QFileInfo(filename).absolutePath();
+            settings.setValue("SidepanelMonitor.lastRecordDirectory", directory_path);
+        }
+    }
+    updateSessionList();
+}
+
+MonitorSession *SidepanelMonitor::selectedSession()
+{
+    const int row = ui->listSessions->currentRow();
+    if( row >= 0 && row < int(_sessions.size()) )
+    {
+        return _sessions[row];
+    }
+    return _sessions.empty() ? nullptr : _sessions.front();
+}
+
+void SidepanelMonitor::on_sliderHistory_valueChanged(int value)
+{
+    MonitorSession* session = selectedSession();
+    if( !session || !session->isConnected() )
+    {
+        return;
+    }
+    if( value == ui->sliderHistory->maximum() )
+    {
+        session->goLive();
     }
     else{
-        _connected = false;
-        ui->lineEdit->setDisabled(false);
-        ui->lineEdit_publisher->setDisabled(false);
-        _timer->stop();
+        const auto& history = session->history();
+        const double ratio = double(value) / ui->sliderHistory->maximum();
+        const double oldest = history.oldestTimestamp();
+        session->rewindTo( oldest + ratio * (history.newestTimestamp() - oldest) );
+    }
+    updateHistoryLabel();
+}
 
-        connectionUpdate(false);
+void SidepanelMonitor::updateHistoryLabel()
+{
+    MonitorSession* session = selectedSession();
+    if( !session || !session->isRewinding() )
+    {
+        // the length of the history available to rewind
+        const double length = session ? session->history().newestTimestamp() -
+                                        session->history().oldestTimestamp() : 0.0;
+        ui->labelHistory->setText( tr("Live (%1 s)").arg( length, 0, 'f', 1 ) );
+        if( ui->sliderHistory->value() != ui->sliderHistory->maximum() )
+        {
+            const QSignalBlocker blocker( ui->sliderHistory );
+            ui->sliderHistory->setValue( ui->sliderHistory->maximum() );
+        }
+        return;
+    }
+    // the history keeps moving while rewinding: show the distance from now
+    const double delay = session->history().newestTimestamp() - session->rewindTime();
+    ui->labelHistory->setText( tr("-%1 s").arg( delay, 0, 'f', 1 ) );
+}
+
+QJsonDocument SidepanelMonitor::statsToJson() const
+{
+    QJsonArray sessions;
+    for(const auto session: _sessions)
+    {
+        QJsonObject json = session->stats().toJson();
+        json["tab"] = session->tabName();
+        json["address"] = QString::fromStdString( session->publisherAddress() );
+        json["connected"] = session->isConnected();
+        sessions.append( json );
+    }
+    QJsonObject root;
+    root["sessions"] = sessions;
+    return QJsonDocument( root );
+}
+
+void SidepanelMonitor::addMemoryUsage(MemoryReport &report) const
+{
+    for(const auto session: _sessions)
+    {
+        report.addEntry( tr("Monitor %1: history").arg( session->tabName() ),
+                         session->history().size(), session->history().memoryUsage() );
+        report.addEntry( tr("Monitor %1: tree").arg( session->tabName() ),
+                         session->loadedTree().nodesCount(), session->loadedTree().memoryUsage() );
+    }
+    // their size is not known without reordering the cache
+    report.addEntry( tr("Monitor: cached trees"), size_t( _tree_cache.count() ), 0 );
+}
+
+void SidepanelMonitor::updateStatsLabel()
+{
+    MonitorSession* session = selectedSession();
+    if( !session || !session->isConnected() )
+    {
+        ui->labelStats->clear();
+        return;
     }
+    const MonitorStats& stats = session->stats();
+    ui->labelStats->setText(
+        tr("%1 msg/s, %2 KB/s\n"
+           "decode: %3 us/msg, draw: %4 us/frame\n"
+           "lag: %5 ms\n"
+           "dropped: %6, coalesced: %7")
+        .arg( stats.messages_per_sec, 0, 'f', 1 )
+        .arg( stats.bytes_per_sec / 1024.0, 0, 'f', 1 )
+        .arg( stats.decode_us_per_message, 0, 'f', 1 )
+        .arg( stats.apply_us_per_frame, 0, 'f', 0 )
+        .arg( stats.lag_ms, 0, 'f', 0 )
+        .arg( stats.dropped )
+        .arg( stats.coalesced ) );
 }
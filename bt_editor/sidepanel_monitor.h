@@ -2,9 +2,14 @@
 #define SIDEPANEL_MONITOR_H
 
 #include <QFrame>
+#include <QElapsedTimer>
+#include <QJsonDocument>
 #include <zmq.hpp>
 
 #include "bt_editor_base.h"
+#include "monitor_receiver.h"
+#include "monitor_session.h"
+#include "memory_report.h"
 
 namespace Ui {
 class SidepanelMonitor;
@@ -20,14 +25,29 @@ public:
 
     void clear();
 
+    // statistics of all the sessions, machine-readable
+    QJsonDocument statsToJson() const;
+
+    // the trees and the histories of the sessions
+    void addMemoryUsage(MemoryReport& report) const;
+
 public slots:
 
+    // connect/disconnect the main session, displayed in the "BehaviorTree" tab
     void on_Connect();
 
 private slots:
 
     void on_timer();
 
+    void on_buttonAddSession_clicked();
+
+    void onSessionContextMenu(const QPoint &pos);
+
+    void on_sliderHistory_valueChanged(int value);
+
+    void on_buttonRecord_clicked();
+
 signals:
     void loadBehaviorTree(const AbsBehaviorTree& tree, const QString &bt_name );
 
@@ -42,17 +62,41 @@ private:
     Ui::SidepanelMonitor *ui;
 
     zmq::context_t _zmq_context;
-    zmq::socket_t  _zmq_subscriber;
+    MonitorReceiver* _receiver;
+    MonitorTreeCache _tree_cache;
+
+    // the first one is the main session
+    std::vector<MonitorSession*> _sessions;
 
-    bool _connected;
-    std::string _connection_address_pub;
-    std::string _connection_address_req;
     QTimer* _timer;
-    int _msg_count;
-    AbsBehaviorTree _loaded_tree;
-    std::unordered_map<int, int> _uid_to_index;
 
-    bool getTreeFromServer();
+    static const int TREE_CACHE_SIZE = 8;
+
+    // GROOT_MONITOR_STATS: statsToJson() is written there every second,
+    // for the load tests run with groot_publisher
+    QString _stats_path;
+    QElapsedTimer _stats_timer;
+
+    static const int STATS_FILE_PERIOD_MS = 1000;
+
+    void writeStatsFile();
+
+    bool readAddresses(std::string& address_pub, std::string& address_req);
+
+    MonitorSession* createSession(const QString& tab_name);
+
+    void removeSession(MonitorSession* session);
+
+    void connectSession(MonitorSession* session);
+
+    void updateSessionList();
+
+    // the session selected in the list, or the main one
+    MonitorSession* selectedSession();
+
+    void updateHistoryLabel();
+
+    void updateStatsLabel();
 
     QWidget *_parent;
 
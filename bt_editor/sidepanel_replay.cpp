@@ -8,32 +8,55 @@
 #include <QFileDialog>
 #include <QSettings>
 #include <QKeyEvent>
-#include <QStandardItem>
 #include <QModelIndex>
 #include <QTimer>
 #include <QMessageBox>
+#include <QInputDialog>
+#include <QMenu>
+#include <QDebug>
+#include <QRegularExpression>
 
 #include "bt_editor_base.h"
+#include <nodes/Trace>
 #include "mainwindow.h"
 #include "utils.h"
+#include "replay_statistics_dialog.h"
+#include "log_diff_dialog.h"
+#include <stdexcept>
+#include <limits>
+#include <algorithm>
 
 
 SidepanelReplay::SidepanelReplay(QWidget *parent) :
     QFrame(parent),
     ui(new Ui::SidepanelReplay),
     _prev_row(-1),
+    _parser(nullptr),
+    _parse_request_id(0),
+    _log_end_offset(0),
+    _play_start_time(0),
+    _play_speed(1.0),
+    _statistics_worker(nullptr),
+    _statistics_request_id(0),
+    _diff_worker(nullptr),
+    _diff_request_id(0),
+    _export_worker(nullptr),
+    _timeline_view(nullptr),
+    _query_valid(false),
+    _query_worker(nullptr),
+    _query_request_id(0),
     _parent(parent)
 {
     ui->setupUi(this);
+    ui->progressBarLoad->setHidden(true);
+    ui->pushButtonCancelLoad->setHidden(true);
+    ui->labelFile->setHidden(true);
 
-    _table_model = new QStandardItemModel(0,4, this);
+    _table_model = new ReplayTableModel(_transitions, _timepoint, _loaded_tree, this);
 
-    _table_model->setHeaderData(0,Qt::Horizontal, "Time");
-    _table_model->setHeaderData(1,Qt::Horizontal, "Node Name");
-    _table_model->setHeaderData(2,Qt::Horizontal, "Previous");
-    _table_model->setHeaderData(3,Qt::Horizontal, "Status");
-
-    ui->tableView->setModel(_table_model);
+    _filter_model = new ReplayFilterModel(_transitions, _loaded_tree, this);
+    _filter_model->setSourceModel(_table_model);
+    ui->tableView->setModel(_filter_model);
     ui->tableView->horizontalHeader()->setSectionResizeMode(1, QHeaderView::Stretch);
 
     _layout_update_timer = new QTimer(this);
@@ -42,109 +65,179 @@ SidepanelReplay::SidepanelReplay(QWidget *parent) :
 
 
     _play_timer = new QTimer(this);
-    _play_timer->setSingleShot(true);
+    _play_timer->setInterval(16);
+    _play_timer->setTimerType(Qt::PreciseTimer);
     connect( _play_timer, &QTimer::timeout, this, &SidepanelReplay::onPlayUpdate );
 
+    {
+        QSignalBlocker block_speed( ui->comboBoxSpeed );
+        const double speeds[] = { 0.1, 0.25, 0.5, 1, 2, 5, 10, 25, 50, 100 };
+        for( double speed: speeds )
+        {
+            ui->comboBoxSpeed->addItem( QString("%1x").arg(speed), speed );
+        }
+        QSettings settings;
+        const double saved_speed = settings.value("SidepanelReplay.playSpeed", 1.0).toDouble();
+        const int speed_index = ui->comboBoxSpeed->findData( saved_speed );
+        ui->comboBoxSpeed->setCurrentIndex( speed_index >= 0 ? speed_index : ui->comboBoxSpeed->findData(1.0) );
+        _play_speed = ui->comboBoxSpeed->currentData().toDouble();
+    }
+
     ui->tableView->installEventFilter(this);
+
+    connect( ui->tableView, &QWidget::customContextMenuRequested,
+             this, &SidepanelReplay::onTableContextMenu );
+
+    _log_watcher = new QFileSystemWatcher(this);
+    connect( _log_watcher, &QFileSystemWatcher::fileChanged,
+             this, &SidepanelReplay::onLogFileChanged );
+
+    _follow_timer = new QTimer(this);
+    _follow_timer->setInterval(1000);
+    connect( _follow_timer, &QTimer::timeout, this, &SidepanelReplay::onLogFileChanged );
 }
 
 SidepanelReplay::~SidepanelReplay()
 {
+    // the destructors stop and join the threads
+    delete _parser;
+    delete _statistics_worker;
+    delete _diff_worker;
+    delete _query_worker;
+    delete _export_worker;
     delete ui;
 }
 
 void SidepanelReplay::clear()
 {
-    _table_model->setColumnCount(4);
-    _table_model->setRowCount(0);
+    stopFollowing();
+    _log_filename.clear();
+    _log_session.clear();
+    ui->labelFile->setHidden(true);
+    ui->checkBoxFollow->setEnabled(false);
+    cancelParsing();
+    cancelStatistics();
+    cancelDiff();
+    cancelQuery();
+    _transitions.clear();
+    _timepoint.clear();
+    _checkpoints.clear();
+    _table_model->reset();
+    _query_index.clear();
+    _query_matches.clear();
+    _query_valid = false;
+    _timeline_intervals.clear();
+    updateTimeline();
 }
 
-void SidepanelReplay::updateTableModel(const AbsBehaviorTree& locaded_tree)
+void SidepanelReplay::addMemoryUsage(MemoryReport &report) const
 {
-    _table_model->setColumnCount(4);
-    _table_model->setRowCount(0);
-
-    const size_t transitions_count = _transitions.size();
-
-    auto createStatusItem = [](NodeStatus status) -> QStandardItem*
+    report.addEntry( tr("Replay: transitions"), _transitions.size(), _transitions.memoryUsage() );
+    report.addEntry( tr("Replay: time points"), _timepoint.size(),
+                     _timepoint.capacity() * sizeof(_timepoint.front()) );
+    report.addEntry( tr("Replay: checkpoints"), _checkpoints.size(), _checkpoints.capacity() );
+    report.addEntry( tr("Replay: tree"), _loaded_tree.nodesCount(), _loaded_tree.memoryUsage() );
+
+    size_t intervals_bytes = 0;
+    for (int lane = 0; lane < _timeline_intervals.lanesCount(); lane++)
     {
-        QStandardItem* item = nullptr;
-        switch (status)
-        {
-        case NodeStatus::SUCCESS:{
-            item = new QStandardItem("SUCCESS");
-            item->setBackground(QColor::fromRgb(22, 255, 22));
-        } break;
-        case NodeStatus::FAILURE:{
-            item = new QStandardItem("FAILURE");
-            item->setBackground(QColor::fromRgb(255, 22, 22));
-        } break;
-        case NodeStatus::RUNNING:{
-            item = new QStandardItem("RUNNING");
-            item->setBackground(QColor::fromRgb(250, 160, 20));
-        } break;
-        case NodeStatus::IDLE:{
-            item = new QStandardItem("IDLE");
-            item->setBackground(QColor::fromRgb(222, 222, 222));
-        } break;
-        }
-        item->setForeground(QColor::fromRgb(0, 0, 0));
-        return item;
-    };
+        intervals_bytes += _timeline_intervals.lane( lane ).capacity() * sizeof(TimelineIntervals::Interval);
+    }
+    report.addEntry( tr("Replay: timeline"), _timeline_intervals.intervalsCount(), intervals_bytes );
 
-    if(  transitions_count > 0)
+    size_t query_rows = 0;
+    for (int node = 0; node < _query_index.nodesCount(); node++)
     {
-        double previous_timestamp = 0;
-        const double first_timestamp = _transitions.front().timestamp;
-
-        for(size_t row=0; row < transitions_count; row++)
+        for (int status = 0; status < 4; status++)
         {
-            auto& trans = _transitions[row];
-            auto node  = locaded_tree.node( trans.index );
-
-            QString timestamp;
-            timestamp.sprintf("%.3f", trans.timestamp - first_timestamp);
-
-            auto timestamp_item = new QStandardItem( timestamp );
-            timestamp.sprintf("absolute time: %.3f", trans.timestamp);
-            timestamp_item->setToolTip( timestamp );
-
-            if(  (trans.timestamp - previous_timestamp) >= 0.001 || row == transitions_count-1)
-            {
-                _timepoint.push_back( {trans.timestamp, row}  );
-                previous_timestamp = trans.timestamp;
+            query_rows += _query_index.rows( node, NodeStatus(status) ).size();
+        }
+    }
+    report.addEntry( tr("Replay: query index"), query_rows, query_rows * sizeof(int) );
+}
 
-                auto font = timestamp_item->font();
-                font.setBold(true);
-                timestamp_item->setFont(font);
-            }
+void SidepanelReplay::appendChunk(const LogParser::Chunk& chunk)
+{
+    // the new rows may match: the query runs again on the next search
+    cancelQuery();
+    const size_t first_row = _transitions.size();
+    _transitions.append( chunk.transitions );
+    _timepoint.insert( _timepoint.end(), chunk.timepoints.begin(), chunk.timepoints.end() );
+    _checkpoints.insert( _checkpoints.end(), chunk.checkpoints.begin(), chunk.checkpoints.end() );
 
-            QList<QStandardItem *> rowData;
-            rowData << timestamp_item;
-            rowData << new QStandardItem( node->instance_name );
-            rowData << createStatusItem( trans.prev_status );
-            rowData << createStatusItem( trans.status );
-            _table_model->appendRow(rowData);
-        }
+    const size_t transitions_count = _transitions.size();
+    if( transitions_count == 0 )
+    {
+        return;
+    }
 
-        emit _table_model->dataChanged( _table_model->index(0,0), _table_model->index( transitions_count-1, 3) );
+    // rows appended while loading are filtered by _filter_model too
+    _table_model->appendRows();
+    _query_index.update( _transitions, int(_loaded_tree.nodesCount()) );
+    // new rows may match
+    _query_valid = false;
 
+    if( first_row == 0 )
+    {
         ui->tableView->horizontalHeader()->setSectionResizeMode(0, QHeaderView::ResizeToContents);
         ui->tableView->horizontalHeader()->setSectionResizeMode(1, QHeaderView::Stretch);
         ui->tableView->horizontalHeader()->setSectionResizeMode(2, QHeaderView::ResizeToContents);
         ui->tableView->horizontalHeader()->setSectionResizeMode(3, QHeaderView::ResizeToContents);
-        ui->tableView->verticalHeader()->minimumSize();
     }
+}
+
+void SidepanelReplay::updateTimeControls()
+{
+    const bool was_empty = !ui->spinBox->isEnabled();
 
     ui->label->setText( QString("of %1").arg( _timepoint.size() ) );
 
-    ui->spinBox->setValue(0);
-    ui->spinBox->setMaximum( std::max(0 , (int)_timepoint.size()-1) );
-    ui->spinBox->setEnabled( !_timepoint.empty() );
-    ui->timeSlider->setValue( 0 );
-    ui->timeSlider->setMaximum( std::max(0 , (int)_timepoint.size()-1) );
-    ui->timeSlider->setEnabled( !_timepoint.empty() );
+    {
+        // the current position is kept while the log is loading
+        QSignalBlocker block_spin( ui->spinBox );
+        QSignalBlocker block_slider( ui->timeSlider );
+        ui->spinBox->setMaximum( std::max(0 , (int)_timepoint.size()-1) );
+        ui->timeSlider->setMaximum( std::max(0 , (int)_timepoint.size()-1) );
+    }
+    ui->pushButtonStatistics->setEnabled( !_transitions.empty() && !_parser && !_statistics_worker );
+    ui->pushButtonTimeline->setEnabled( !_transitions.empty() && !_parser );
+    ui->pushButtonCompare->setEnabled( !_transitions.empty() && !_parser && !_diff_worker );
+    ui->pushButtonExport->setEnabled( _log_session.filesCount() > 0 || _export_worker );
+    ui->spinBox->setEnabled( !_timepoint.empty() && !ui->pushButtonPlay->isChecked() );
+    ui->timeSlider->setEnabled( !_timepoint.empty() && !ui->pushButtonPlay->isChecked() );
     ui->pushButtonPlay->setEnabled( !_timepoint.empty() );
+
+    if( was_empty )
+    {
+        QSignalBlocker block_spin( ui->spinBox );
+        QSignalBlocker block_slider( ui->timeSlider );
+        ui->spinBox->setValue(0);
+        ui->timeSlider->setValue( 0 );
+    }
+}
+
+void SidepanelReplay::resetTableModel()
+{
+    cancelStatistics();
+    cancelDiff();
+    cancelQuery();
+    _query_index.clear();
+    _query_matches.clear();
+    _query_valid = false;
+    _timeline_intervals.clear();
+    if( _timeline_view )
+    {
+        _timeline_view->setIntervals( &_timeline_intervals, &_loaded_tree );
+    }
+    _transitions.clear();
+    _timepoint.clear();
+    _checkpoints.clear();
+    _table_model->reset();
+    _prev_row = -1;
+
+    ui->spinBox->setEnabled( false );
+    ui->timeSlider->setEnabled( false );
+    updateTimeControls();
 }
 
 void SidepanelReplay::on_LoadLog()
@@ -153,56 +246,290 @@ void SidepanelReplay::on_LoadLog()
     QString directory_path  = settings.value("SidepanelReplay.lastLoadDirectory",
                                              QDir::homePath() ).toString();
 
-    QString fileName = QFileDialog::getOpenFileName(this,
+    // several files of a rotated recording are replayed as one
+    QStringList fileNames = QFileDialog::getOpenFileNames(this,
                                                     tr("Open Flow Scene"), directory_path,
                                                     tr("Flatbuffers log (*.fbl)"));
 
-    if (fileName.isEmpty() || !QFileInfo::exists(fileName))
+    if (fileNames.isEmpty() || !QFileInfo::exists(fileNames.front()))
+    {
+        return;
+    }
+    fileNames.sort();
+
+    directory_path = QFileInfo(fileNames.front()).absolutePath();
+    settings.setValue("SidepanelReplay.lastLoadDirectory", directory_path);
+    settings.sync();
+
+    loadLogFiles( fileNames );
+}
+
+void SidepanelReplay::loadLogFile(const QString &fileName)
+{
+    loadLogFiles( { fileName } );
+}
+
+void SidepanelReplay::loadLogFiles(const QStringList &paths)
+{
+    QStringList fileNames;
+    for (const QString& path: paths)
+    {
+        if( QFileInfo(path).isDir() )
+        {
+            fileNames += LogSession::filesInDirectory( path );
+        }
+        else{
+            fileNames.push_back( path );
+        }
+    }
+    if( fileNames.isEmpty() )
     {
         return;
     }
+    const QString fileName = fileNames.front();
     QFile file(fileName);
 
     if (!file.open(QIODevice::ReadOnly)){
         return;
     }
 
-    directory_path = QFileInfo(fileName).absolutePath();
-    settings.setValue("SidepanelReplay.lastLoadDirectory", directory_path);
-    settings.sync();
+    // the log is parsed in place: no copy of the file in memory, and the
+    // OS is free to page it out once parsed
+    const qint64 file_size = file.size();
+    uchar* mapped = file.map( 0, file_size );
+    if( !mapped )
+    {
+        QByteArray content = file.readAll();
+        loadLog( content );
+        return;
+    }
+    stopFollowing();
+
+    LogLayout layout;
+    std::unordered_map<int,int> uid_to_index;
+    const bool valid = loadTreeFromLog( reinterpret_cast<const char*>(mapped), size_t(file_size),
+                                        layout, uid_to_index );
+    _log_session.clear();
+    if( valid )
+    {
+        _log_session.setFirstFile( fileName, layout, reinterpret_cast<const char*>(mapped) );
+    }
+    file.unmap( mapped );
 
-    QByteArray content = file.readAll();
-    loadLog( content );
+    _log_filename.clear();
+    ui->checkBoxFollow->setEnabled( valid );
+
+    if( valid )
+    {
+        QString error;
+        for (int i = 1; i < fileNames.size(); i++)
+        {
+            if( !_log_session.appendFile( fileNames[i], error ) )
+            {
+                // the files before it are still a valid session
+                QMessageBox::warning( this, "Log file skipped",
+                                      QString("Only the first %1 files are loaded.\n%2")
+                                      .arg( _log_session.filesCount() ).arg( error ) );
+                break;
+            }
+        }
+        ui->labelFile->setHidden( _log_session.filesCount() < 2 );
+
+        _log_filename = fileName;
+        _log_layout = layout;
+        _log_uid_to_index = uid_to_index;
+        _log_end_offset = layout.transitions_begin;
+        _log_state = LogParser::State( int(_loaded_tree.nodesCount()) );
+
+        // the transitions can be many millions: parse them in background.
+        _parser = new LogParser( _log_session.files(), uid_to_index,
+                                 int(_loaded_tree.nodesCount()), ++_parse_request_id, this );
+
+        connect( _parser, &LogParser::chunkParsed, this, &SidepanelReplay::onChunkParsed );
+        connect( _parser, &LogParser::parsingFinished, this, &SidepanelReplay::onParsingFinished );
+        connect( _parser, &LogParser::parsingFailed, this, &SidepanelReplay::onParsingFailed );
+
+        ui->progressBarLoad->setValue(0);
+        const auto& session_files = _log_session.files();
+        const bool indexed = std::all_of( session_files.begin(), session_files.end(),
+                                          [](const LogSessionFile& f) { return !f.layout.index.blocks.empty(); } );
+        if( indexed )
+        {
+            // the index tells the content of the log without reading it
+            uint64_t transitions_count = 0;
+            for (const auto& f: session_files)
+            {
+                transitions_count += f.layout.index.transitionsCount();
+            }
+            const double duration = session_files.back().layout.index.blocks.back().last_timestamp -
+                                    session_files.front().layout.index.blocks.front().first_timestamp;
+            ui->progressBarLoad->setFormat( tr("%p% of %1 transitions, %2 s")
+                                            .arg( transitions_count )
+                                            .arg( duration, 0, 'f', 1 ) );
+        }
+        else{
+            ui->progressBarLoad->setFormat( "%p%" );
+        }
+        ui->progressBarLoad->setHidden(false);
+        ui->pushButtonCancelLoad->setHidden(false);
+        _parser->start();
+
+        if( ui->checkBoxFollow->isChecked() )
+        {
+            on_checkBoxFollow_toggled( true );
+        }
+    }
+}
+
+void SidepanelReplay::cancelParsing()
+{
+    if( _parser )
+    {
+        // late signals are discarded, thanks to _parse_request_id
+        _parse_request_id++;
+        _parser->cancel();
+        _parser->deleteLater();
+        _parser = nullptr;
+    }
+    ui->progressBarLoad->setHidden(true);
+    ui->pushButtonCancelLoad->setHidden(true);
+}
+
+void SidepanelReplay::on_pushButtonCancelLoad_clicked()
+{
+    // keep what was already parsed; following would read the rest
+    if( _parser ) {
+        ui->checkBoxFollow->setChecked(false);
+        onParsingFinished( _parser->requestId() );
+    }
+}
+
+void SidepanelReplay::onChunkParsed(int request_id, LogParser::ChunkPtr chunk, int percent)
+{
+    if( request_id != _parse_request_id ) return;
+
+    if( chunk->file != _log_session.reachedFiles() && size_t(chunk->file) < _log_session.filesCount() )
+    {
+        // following resumes from the last file parsed
+        _log_session.setFirstRow( chunk->file, _transitions.size() );
+        _log_filename = _log_session.files()[ size_t(chunk->file) ].filename;
+        _log_layout = _log_session.files()[ size_t(chunk->file) ].layout;
+    }
+    appendChunk( *chunk );
+    _log_end_offset = chunk->end_offset;
+    _log_state = chunk->state;
+    updateTimeControls();
+    ui->progressBarLoad->setValue( percent );
+}
+
+void SidepanelReplay::addLastTimepoint()
+{
+    if( !_transitions.empty() &&
+        (_timepoint.empty() || _timepoint.back().second != int(_transitions.size()) - 1) )
+    {
+        _timepoint.push_back( { _transitions.timestamp( _transitions.size() - 1 ), int(_transitions.size()) - 1 } );
+        updateTimeControls();
+    }
+}
+
+void SidepanelReplay::onParsingFinished(int request_id)
+{
+    if( request_id != _parse_request_id ) return;
+    cancelParsing();
+
+    // when cancelled, the last transition loaded must be a time point too
+    addLastTimepoint();
+    updateTimeControls();
+    updateTimeline();
+
+    // what was appended while parsing
+    if( ui->checkBoxFollow->isChecked() )
+    {
+        onLogFileChanged();
+    }
+}
+
+void SidepanelReplay::onParsingFailed(int request_id, QString error)
+{
+    if( request_id != _parse_request_id ) return;
+    cancelParsing();
+
+    QMessageBox::warning( this, "Log file is corrupt",
+                          QString("Failed to load this file.\n%1").arg(error) );
 }
 
 void SidepanelReplay::loadLog(const QByteArray &content)
 {
-    const char* buffer = reinterpret_cast<const char*>(content.data());
+    loadLog( content.data(), size_t(content.size()) );
+}
+
+void SidepanelReplay::loadLog(const char *buffer, size_t read_bytes)
+{
+    NODE_TRACE_SCOPE("SidepanelReplay::loadLog");
+
+    // there is no file to follow
+    stopFollowing();
+    _log_filename.clear();
+    _log_session.clear();
+    ui->labelFile->setHidden(true);
+    ui->checkBoxFollow->setEnabled(false);
+
+    LogLayout layout;
+    std::unordered_map<int,int> uid_to_index;
 
-    // how many bytes did we read off the disk (uoffset_t aka uint32_t)
-    const auto read_bytes = content.size();
+    if( !loadTreeFromLog( buffer, read_bytes, layout, uid_to_index ) )
+    {
+        return;
+    }
+
+    LogParser::State state( int(_loaded_tree.nodesCount()) );
+    LogParser::Chunk chunk;
+    try{
+        if( !LogParser::parseLog( buffer, layout, uid_to_index, state, chunk ) )
+        {
+            qDebug() << "The log is truncated, after " << chunk.transitions.size() << " transitions";
+        }
+    }
+    catch( std::out_of_range& )
+    {
+        QMessageBox::warning( this, "Log file is corrupt",
+                             "Failed to load this file.\n"
+                             "The log contains a node that is not in the tree");
+    }
+    if( !chunk.transitions.empty() )
+    {
+        LogParser::finish( state, chunk.transitions.back().timestamp, chunk );
+    }
+    appendChunk( chunk );
+    updateTimeControls();
+}
+
+bool SidepanelReplay::loadTreeFromLog(const char *buffer, size_t read_bytes,
+                                      LogLayout &layout,
+                                      std::unordered_map<int, int> &uid_to_index)
+{
+    cancelParsing();
 
     // we need at least 4 bytes to read the bt_header_size
     if( read_bytes < 4 ) {
         QMessageBox::warning( this, "Log file is empty",
                              "Failed to load this file.\n"
                              "This Log file is empty");
-        return;
+        return false;
     }
     
-    // read the length of the header section from the file
-    const size_t bt_header_size = flatbuffers::ReadScalar<uint32_t>(buffer);
-
+    // read the version and the location of the tree (header section)
     // if the length of the header goes past the end of the file, it is invalid
-    if( (bt_header_size == 0) || (bt_header_size > read_bytes) ) {
+    if( !readLogLayout( buffer, read_bytes, layout ) ) {
         QMessageBox::warning( this, "Log file is corrupt",
                              "Failed to load this file.\n"
                              "This Log file corrupted or truncated");
-        return;
+        return false;
     }
 
-    flatbuffers::Verifier verifier( reinterpret_cast<const uint8_t*>(buffer+4),
-                                   size_t(content.size() -4));
+    const size_t tree_offset = layout.tree_offset;
+    flatbuffers::Verifier verifier( reinterpret_cast<const uint8_t*>(buffer + tree_offset),
+                                   layout.transitions_begin - tree_offset );
 
     bool valid_tree = Serialization::VerifyBehaviorTreeBuffer(verifier);
     if( ! valid_tree )
@@ -210,17 +537,18 @@ void SidepanelReplay::loadLog(const QByteArray &content)
         QMessageBox::warning( this, "Flatbuffer verification failed",
                              "Failed to load this file.\n"
                              "Its format is not compatible with the current one");
-        return;
+        return false;
     }
 
 
-    auto fb_behavior_tree = Serialization::GetBehaviorTree( &buffer[4] );
+    auto fb_behavior_tree = Serialization::GetBehaviorTree( &buffer[tree_offset] );
 
 
     auto res_pair = BuildTreeFromFlatbuffers( fb_behavior_tree );
 
-    _loaded_tree  = res_pair.first;
-    const auto& uid_to_index = res_pair.second;
+    // the table must not refer to the old tree
+    resetTableModel();
+    _loaded_tree  = std::move( res_pair.first );
 
     for (const auto& tree_node: _loaded_tree.nodes() )
     {
@@ -233,51 +561,19 @@ void SidepanelReplay::loadLog(const QByteArray &content)
 
     emit loadBehaviorTree( _loaded_tree, "BehaviorTree" );
 
-    _transitions.clear();
-    _transitions.reserve( (content.size() - 4 - bt_header_size) / 12 );
-
-    int idle_counter = _loaded_tree.nodes().size();
-    const int total_nodes = _loaded_tree.nodes().size();
-    int nearest_restart_transition_index = 0;
-
-    for (size_t offset = 4+bt_header_size; offset < content.size(); offset += 12)
-    {
-        Transition transition;
-        const double t_sec  = flatbuffers::ReadScalar<uint32_t>( &buffer[offset] );
-        const double t_usec = flatbuffers::ReadScalar<uint32_t>( &buffer[offset+4] );
-        double timestamp = t_sec + t_usec* 0.000001;
-        transition.timestamp = timestamp;
-        const uint16_t uid = flatbuffers::ReadScalar<uint16_t>(&buffer[offset+8]);
-        transition.index = uid_to_index.at(uid);
-        transition.prev_status = convert(flatbuffers::ReadScalar<Serialization::NodeStatus>(&buffer[offset+10] ));
-        transition.status      = convert(flatbuffers::ReadScalar<Serialization::NodeStatus>(&buffer[offset+11] ));
-        transition.is_tree_restart = false;
-
-        if(transition.index == 1 &&
-                (transition.status == NodeStatus::RUNNING || transition.status == NodeStatus::IDLE) &&
-                idle_counter >= total_nodes - 1){
-            transition.is_tree_restart = true;
-            nearest_restart_transition_index = _transitions.size();
-        }
-
-        if(transition.prev_status != NodeStatus::IDLE && transition.status == NodeStatus::IDLE)
-            idle_counter++;
-        else if(transition.prev_status == NodeStatus::IDLE && transition.status != NodeStatus::IDLE)
-            idle_counter--;
-
-        transition.nearest_restart_transition_index = nearest_restart_transition_index;
-
-        _transitions.push_back(transition);
+    if( layout.hasBlocks() && !layout.index.blocks.empty() )
+    {
+        _transitions.reserve( size_t( layout.index.transitionsCount() ) );
     }
-
-    _timepoint.clear();
-    _prev_row = -1;
-    updateTableModel(_loaded_tree);
-
+    else{
+        _transitions.reserve( (layout.transitions_end - layout.transitions_begin) / 12 );
+    }
+    uid_to_index = res_pair.second;
 
     // We need to lock the nodes after they are loaded
     auto main_win = dynamic_cast<MainWindow*>( _parent );
     main_win->lockEditing(true);
+    return true;
 }
 
 
@@ -288,9 +584,10 @@ void SidepanelReplay::on_spinBox_valueChanged(int value)
         ui->timeSlider->setValue( value );
     }
 
+    if( value < 0 || value >= int(_timepoint.size()) ) return;
     int row = _timepoint[value].second;
 
-    ui->tableView->scrollTo( _table_model->index(row,0), QAbstractItemView::PositionAtCenter  );
+    ui->tableView->scrollTo( tableIndex(row,0), QAbstractItemView::PositionAtCenter  );
 
     onRowChanged( row );
 }
@@ -302,8 +599,9 @@ void SidepanelReplay::on_timeSlider_valueChanged(int value)
         ui->spinBox->setValue( value );
     }
 
+    if( value < 0 || value >= int(_timepoint.size()) ) return;
     int row = _timepoint[value].second;
-    ui->tableView->scrollTo( _table_model->index(row,0), QAbstractItemView::PositionAtCenter);
+    ui->tableView->scrollTo( tableIndex(row,0), QAbstractItemView::PositionAtCenter);
 
     onRowChanged( row );
 }
@@ -324,19 +622,7 @@ void SidepanelReplay::onRowChanged(int current_row)
     ui->tableView->horizontalHeader()->setSectionResizeMode (QHeaderView::Fixed);
     ui->tableView->verticalHeader()->setSectionResizeMode (QHeaderView::Fixed);
 
-    const auto selected_color   = QColor::fromRgb(210, 210, 210);
-    const auto unselected_color = QColor::fromRgb(255, 255, 255);
-
-    for (int row = std::max(0,_prev_row); row <= current_row; row++)
-    {
-        _table_model->item(row, 0)->setBackground( selected_color );
-        _table_model->item(row, 1)->setBackground( selected_color );
-    }
-    for (int row = current_row+1; row <= _prev_row; row++)
-    {
-        _table_model->item(row, 0)->setBackground( unselected_color );
-        _table_model->item(row, 1)->setBackground( unselected_color );
-    }
+    _table_model->setCurrentRow( current_row );
 
     // cancel the refresh of the layout refresh
     if( !_layout_update_timer->isActive() )
@@ -347,19 +633,48 @@ void SidepanelReplay::onRowChanged(int current_row)
 
     const QString bt_name("BehaviorTree");
 
-    std::vector<std::pair<int, NodeStatus>>  node_status;
-    for(size_t index = 0; index < _loaded_tree.nodes().size(); index++ )
+    const size_t nodes_count = _loaded_tree.nodesCount();
+    std::vector<NodeStatus> status( nodes_count, NodeStatus::IDLE );
+    std::vector<NodeStatus> prev_status( nodes_count, NodeStatus::IDLE );
+
+    // Start from the latest restart or from the latest checkpoint, whatever
+    // is closer: at most CHECKPOINT_INTERVAL transitions are replayed.
+    int first_row = _transitions.nearestRestart( current_row );
+    const size_t checkpoint = size_t(current_row) / LogParser::CHECKPOINT_INTERVAL;
+    const int checkpoint_row = int( checkpoint * LogParser::CHECKPOINT_INTERVAL );
+
+    if( nodes_count > 0 && first_row < checkpoint_row &&
+        (checkpoint + 1) * nodes_count <= _checkpoints.size() )
+    {
+        const uint8_t* snapshot = &_checkpoints[ checkpoint * nodes_count ];
+        for(size_t index = 0; index < nodes_count; index++)
+        {
+            LogParser::decodeCheckpoint( snapshot[index], status[index], prev_status[index] );
+        }
+        first_row = checkpoint_row;
+    }
+
+    for (int t = first_row; t <= current_row; t++)
     {
-        node_status.push_back( { index, NodeStatus::IDLE} );
+        const int index = _transitions.index(t);
+        status[index] = _transitions.status(t);
+        prev_status[index] = _transitions.prevStatus(t);
     }
 
-    for (int t = _transitions[current_row].nearest_restart_transition_index; t <= current_row; t++)
+    emit changeNodeStyle( bt_name, encodeNodesStatus( status, prev_status ) );
+
+    if( _timeline_view && _timeline_view->isVisible() )
     {
-        auto& trans = _transitions[t];
-        node_status.push_back( { trans.index, trans.status} );
+        _timeline_view->setCursorTime( _transitions.timestamp( current_row ) );
     }
 
-    emit changeNodeStyle( bt_name, node_status );
+    if( _log_session.filesCount() > 1 )
+    {
+        const int file = _log_session.fileOfRow( size_t(current_row) );
+        ui->labelFile->setText( tr("File %1 of %2: %3").arg( file + 1 )
+                                .arg( _log_session.filesCount() )
+                                .arg( QFileInfo( _log_session.files()[ size_t(file) ].filename ).fileName() ) );
+    }
 
     _prev_row = current_row;
 }
@@ -406,7 +721,7 @@ bool SidepanelReplay::eventFilter(QObject *object, QEvent *event)
             {
                 onRowChanged( next_row);
                 updatedSpinAndSlider( next_row );
-                ui->tableView->scrollTo( _table_model->index(next_row,0),
+                ui->tableView->scrollTo( tableIndex(next_row,0),
                                          QAbstractItemView::EnsureVisible);
             }
             return true;
@@ -420,11 +735,17 @@ void SidepanelReplay::on_tableView_clicked(const QModelIndex &index)
     // disable during play
     if( !ui->pushButtonPlay->isChecked())
     {
-        onRowChanged( index.row() );
-        updatedSpinAndSlider( index.row() );
+        const int row = _filter_model->mapToSource( index ).row();
+        onRowChanged( row );
+        updatedSpinAndSlider( row );
     }
 }
 
+QModelIndex SidepanelReplay::tableIndex(int row, int column) const
+{
+    return _filter_model->mapFromSource( _table_model->index(row, column) );
+}
+
 void SidepanelReplay::onTimerUpdate()
 {
     ui->tableView->horizontalHeader()->setSectionResizeMode(0, QHeaderView::ResizeToContents);
@@ -438,70 +759,642 @@ void SidepanelReplay::on_pushButtonPlay_toggled(bool checked)
     ui->timeSlider->setEnabled( !checked );
     ui->spinBox->setEnabled( !checked );
 
-    if(checked)
+    if(checked && !_transitions.empty())
     {
-        _next_row = std::max(0, _prev_row);
+        _play_start_time = _transitions.timestamp( std::max(0, _prev_row) );
+        _play_clock.start();
+        _play_timer->start();
         onPlayUpdate();
     }
     else{
-        ui->tableView->scrollTo( _table_model->index( _prev_row,0),
+        _play_timer->stop();
+        ui->tableView->scrollTo( tableIndex( _prev_row,0),
                                  QAbstractItemView::PositionAtCenter);
     }
 }
 
+double SidepanelReplay::playTime() const
+{
+    return _play_start_time + _play_speed * double( _play_clock.nsecsElapsed() ) * 1e-9;
+}
+
+void SidepanelReplay::on_comboBoxSpeed_currentIndexChanged(int index)
+{
+    if( index < 0 ) return;
+
+    // the clock restarts from the time shown, at the new speed
+    if( _play_timer->isActive() )
+    {
+        _play_start_time = playTime();
+        _play_clock.start();
+    }
+    _play_speed = ui->comboBoxSpeed->itemData(index).toDouble();
+
+    QSettings settings;
+    settings.setValue("SidepanelReplay.playSpeed", _play_speed);
+}
+
 void SidepanelReplay::onPlayUpdate()
 {
     if( !ui->pushButtonPlay->isChecked() || _transitions.empty() )
     {
+        _play_timer->stop();
         return;
-    }  
+    }
 
-    using namespace std::chrono;
-    const int LAST_ROW = _transitions.size()-1;
+    const int LAST_ROW = int(_transitions.size()) - 1;
 
-    _next_row = std::max(0, _next_row);
-    _next_row = std::min(LAST_ROW, _next_row);
+    // a single status update per frame, through the checkpoints
+    const int row = std::max( 0, int( _transitions.countUntil( playTime() ) ) - 1 );
 
-    const double TIME_DIFFERENCE_THRESHOLD = 0.01;
+    if( row != _prev_row )
+    {
+        onRowChanged( row );
+        updatedSpinAndSlider( row );
+        ui->tableView->scrollTo( tableIndex(row,0), QAbstractItemView::EnsureVisible  );
+    }
 
-    // move forward as long as timestamp difference is small.
-    while( _next_row < LAST_ROW -1 &&
-           (_transitions[_next_row+1].timestamp - _transitions[_next_row].timestamp) < TIME_DIFFERENCE_THRESHOLD )
+    if( row >= LAST_ROW )
     {
-        _next_row++;
+        ui->pushButtonPlay->setChecked(false);
     }
+}
 
-    onRowChanged( _next_row );
-    updatedSpinAndSlider( _next_row );
-    ui->tableView->scrollTo( _table_model->index(_next_row,0), QAbstractItemView::EnsureVisible  );
+void SidepanelReplay::on_lineEditFilter_textChanged(const QString &filter_text)
+{
+    _filter_model->setFilter( filter_text );
 
-    if( _next_row == LAST_ROW)
+    if( _prev_row >= 0 )
+    {
+        ui->tableView->scrollTo( tableIndex(_prev_row, 0), QAbstractItemView::PositionAtCenter );
+    }
+}
+
+void SidepanelReplay::seekToRow(int row)
+{
+    if( row < 0 || row >= int(_transitions.size()) )
     {
-        ui->pushButtonPlay->setChecked(false);
         return;
     }
+    onRowChanged( row );
+    updatedSpinAndSlider( row );
+    ui->tableView->scrollTo( tableIndex(row, 0), QAbstractItemView::PositionAtCenter );
+}
 
-    const double prev_time = _transitions[_next_row].timestamp;
-    const double next_time = _transitions[_next_row+1].timestamp;
-    int delay_relative = (next_time - prev_time) * 1000;
+bool SidepanelReplay::parseSeekTime(QString text, double &timestamp) const
+{
+    if( _transitions.empty() )
+    {
+        return false;
+    }
+    text = text.simplified().remove(' ');
+    if( text.endsWith("s") )
+    {
+        text.chop(1);
+    }
 
-    _next_row++;
-    //qDebug() << "delay_relative " << delay_relative << " next_row " << _next_row << "\n";
+    bool ok = false;
+    if( text.startsWith("@") )
+    {
+        timestamp = text.mid(1).toDouble(&ok);
+    }
+    else if( text.startsWith("+") || text.startsWith("-") )
+    {
+        const double current = _transitions.timestamp( std::max(0, _prev_row) );
+        timestamp = current + text.toDouble(&ok);
+    }
+    else{
+        if( text.startsWith("t=") )
+        {
+            text = text.mid(2);
+        }
+        timestamp = _transitions.timestamp(0) + text.toDouble(&ok);
+    }
+    return ok;
+}
 
-    _play_timer->start(delay_relative);
+void SidepanelReplay::on_lineEditSeek_returnPressed()
+{
+    double timestamp = 0;
+    if( !parseSeekTime( ui->lineEditSeek->text(), timestamp ) )
+    {
+        ui->lineEditSeek->selectAll();
+        return;
+    }
+    // the last transition at or before the requested time
+    const int row = std::max( 0, int( _transitions.countUntil(timestamp) ) - 1 );
+    seekToRow( row );
 }
 
-void SidepanelReplay::on_lineEditFilter_textChanged(const QString &filter_text)
+int SidepanelReplay::findNextStatus(int node_index, NodeStatus status, int row) const
+{
+    const auto& rows = _filter_model->rowsOfNode( node_index );
+    for(auto it = std::upper_bound( rows.begin(), rows.end(), row ); it != rows.end(); it++)
+    {
+        if( _transitions.status(*it) == status )
+        {
+            return *it;
+        }
+    }
+    return -1;
+}
+
+void SidepanelReplay::onTableContextMenu(const QPoint &pos)
+{
+    const QModelIndex index = _filter_model->mapToSource( ui->tableView->indexAt(pos) );
+    if( !index.isValid() )
+    {
+        return;
+    }
+    const int node_index = _transitions.index( index.row() );
+    const QString& name = _loaded_tree.node( node_index )->instance_name;
+
+    QMenu menu(this);
+    QAction* next_failure = menu.addAction( tr("Jump to next FAILURE of \"%1\"").arg(name) );
+
+    connect( next_failure, &QAction::triggered, this, [this, node_index]()
+    {
+        const int row = findNextStatus( node_index, NodeStatus::FAILURE, std::max(0, _prev_row) );
+        if( row >= 0 )
+        {
+            seekToRow( row );
+        }
+    } );
+
+    menu.exec( ui->tableView->viewport()->mapToGlobal(pos) );
+}
+
+void SidepanelReplay::stopFollowing()
 {
-    for (int row=0; row < _table_model->rowCount(); row++ )
+    _follow_timer->stop();
+    if( !_log_watcher->files().isEmpty() )
+    {
+        _log_watcher->removePaths( _log_watcher->files() );
+    }
+}
+
+void SidepanelReplay::on_checkBoxFollow_toggled(bool checked)
+{
+    stopFollowing();
+    if( checked && !_log_filename.isEmpty() )
+    {
+        _log_watcher->addPath( _log_filename );
+        _follow_timer->start();
+        onLogFileChanged();
+    }
+}
+
+void SidepanelReplay::onLogFileChanged()
+{
+    // while parsing, the appended data is read by onParsingFinished
+    if( _log_filename.isEmpty() || _parser || _statistics_worker || _diff_worker ||
+        _query_worker || !ui->checkBoxFollow->isChecked() )
+    {
+        return;
+    }
+    // some writers replace the file, and the watcher forgets it
+    if( _log_watcher->files().isEmpty() && QFileInfo::exists( _log_filename ) )
+    {
+        _log_watcher->addPath( _log_filename );
+    }
+
+    QFile file( _log_filename );
+    if( !file.open(QIODevice::ReadOnly) )
+    {
+        return;
+    }
+    const size_t file_size = size_t( file.size() );
+    if( file_size < _log_end_offset )
+    {
+        // truncated or overwritten: start again
+        loadLogFiles( _log_session.filenames() );
+        return;
+    }
+    if( file_size < _log_end_offset + 12 )
+    {
+        return;
+    }
+
+    uchar* mapped = file.map( 0, file.size() );
+    if( !mapped )
+    {
+        return;
+    }
+    const char* buffer = reinterpret_cast<const char*>(mapped);
+
+    size_t end = file_size;
+    LogIndex index;
+    if( _log_layout.hasBlocks() && readLogIndex( buffer, file_size, index ) )
+    {
+        // the recording is complete: do not parse the footer as a block
+        end = size_t( index.footer_offset );
+    }
+
+    const bool at_end = ( _prev_row == int(_transitions.size()) - 1 );
+    LogParser::Chunk chunk;
+    try{
+        if( _log_layout.hasBlocks() )
+        {
+            // an incomplete block is parsed once the recorder completes it
+            LogParser::parseBlocks( buffer, _log_end_offset, end,
+                                    std::numeric_limits<size_t>::max(),
+                                    _log_layout.isCompressed(),
+                                    _log_uid_to_index, _log_state, chunk );
+        }
+        else{
+            const size_t parsed_end = _log_end_offset + ( (end - _log_end_offset) / 12 ) * 12;
+            LogParser::parse( buffer, _log_end_offset, parsed_end,
+                              _log_uid_to_index, _log_state, chunk );
+            _log_end_offset = parsed_end;
+        }
+    }
+    catch( std::out_of_range& )
+    {
+        file.unmap( mapped );
+        ui->checkBoxFollow->setChecked(false);
+        QMessageBox::warning( this, "Log file is corrupt",
+                             "Stopped following this file.\n"
+                             "The log contains a node that is not in the tree");
+        return;
+    }
+    file.unmap( mapped );
+
+    if( chunk.transitions.empty() )
+    {
+        return;
+    }
+    appendChunk( chunk );
+    addLastTimepoint();
+    updateTimeControls();
+    updateTimeline();
+
+    // keep showing the latest status, unless the user is looking at the past
+    if( at_end || _prev_row < 0 )
+    {
+        seekToRow( int(_transitions.size()) - 1 );
+    }
+}
+
+void SidepanelReplay::cancelStatistics()
+{
+    if( _statistics_worker )
+    {
+        // joined now: the transitions are about to change
+        _statistics_request_id++;
+        delete _statistics_worker;
+        _statistics_worker = nullptr;
+        ui->pushButtonStatistics->setText( tr("Statistics") );
+    }
+}
+
+void SidepanelReplay::on_pushButtonStatistics_clicked()
+{
+    if( _statistics_worker || _parser || _transitions.empty() )
+    {
+        return;
+    }
+    _statistics_worker = new StatisticsWorker( _transitions, int(_loaded_tree.nodesCount()),
+                                               ++_statistics_request_id, this );
+    connect( _statistics_worker, &StatisticsWorker::statisticsReady,
+             this, &SidepanelReplay::onStatisticsReady );
+
+    ui->pushButtonStatistics->setEnabled(false);
+    ui->pushButtonStatistics->setText( tr("Computing...") );
+    _statistics_worker->start();
+}
+
+void SidepanelReplay::onStatisticsReady(int request_id, ReplayStatisticsPtr statistics)
+{
+    if( request_id != _statistics_request_id ) return;
+    cancelStatistics();
+    updateTimeControls();
+
+    auto dialog = new ReplayStatisticsDialog( *statistics, _loaded_tree, this );
+    dialog->setAttribute( Qt::WA_DeleteOnClose );
+
+    connect( dialog, &ReplayStatisticsDialog::heatmapChanged,
+             this, [this](const std::vector<double>& values)
+    {
+        if( values.empty() )
+        {
+            // show the status of the current row again
+            const int row = _prev_row;
+            _prev_row = -1;
+            if( row >= 0 ) onRowChanged( row );
+        }
+        else{
+            emit showNodesHeatmap( "BehaviorTree", values );
+        }
+    } );
+    dialog->show();
+}
+
+void SidepanelReplay::cancelDiff()
+{
+    if( _diff_worker )
+    {
+        // joined now: the transitions are about to change
+        _diff_request_id++;
+        delete _diff_worker;
+        _diff_worker = nullptr;
+        ui->pushButtonCompare->setText( tr("Compare...") );
+    }
+}
+
+void SidepanelReplay::on_pushButtonCompare_clicked()
+{
+    if( _diff_worker || _parser || _transitions.empty() )
+    {
+        return;
+    }
+    QSettings settings;
+    QString directory_path  = settings.value("SidepanelReplay.lastLoadDirectory",
+                                             QDir::homePath() ).toString();
+
+    QString filename = QFileDialog::getOpenFileName(this, tr("Compare with log"),
+                                                    directory_path,
+                                                    tr("Flatbuffers log (*.fbl)"));
+    if( filename.isEmpty() )
     {
-        bool show = _table_model->item(row,1)->text().contains(filter_text, Qt::CaseInsensitive);
+        return;
+    }
+
+    const QStringList alignments = { tr("By restart of the tree"),
+                                     tr("By time, in windows of 1 second") };
+    const int saved_alignment = settings.value("SidepanelReplay.diffAlignment", 0).toInt();
+    bool ok = false;
+    const QString alignment = QInputDialog::getItem( this, tr("Compare logs"),
+                                                     tr("Align the two logs:"), alignments,
+                                                     saved_alignment == 1 ? 1 : 0, false, &ok );
+    if( !ok )
+    {
+        return;
+    }
+    const int alignment_index = alignments.indexOf( alignment );
+    settings.setValue("SidepanelReplay.diffAlignment", alignment_index );
+
+    _diff_filename = filename;
+    _diff_worker = new LogDiffWorker( filename, _transitions, _loaded_tree,
+                                      alignment_index == 1 ? LogDiff::BY_TIME : LogDiff::BY_RESTART,
+                                      1.0, ++_diff_request_id, this );
+    connect( _diff_worker, &LogDiffWorker::diffReady, this, &SidepanelReplay::onDiffReady );
+    connect( _diff_worker, &LogDiffWorker::diffFailed, this, &SidepanelReplay::onDiffFailed );
+
+    ui->pushButtonCompare->setEnabled(false);
+    ui->pushButtonCompare->setText( tr("Comparing...") );
+    _diff_worker->start();
+}
+
+void SidepanelReplay::onDiffReady(int request_id, NodeDiffsPtr nodes, quint64 segments)
+{
+    if( request_id != _diff_request_id ) return;
+    cancelDiff();
+    updateTimeControls();
 
-        if( show ){
-            ui->tableView->showRow(row);
+    auto dialog = new LogDiffDialog( *nodes, segments, _diff_filename, _loaded_tree, this );
+    dialog->setAttribute( Qt::WA_DeleteOnClose );
+
+    connect( dialog, &LogDiffDialog::heatmapChanged,
+             this, [this](const std::vector<double>& values)
+    {
+        if( values.empty() )
+        {
+            // show the status of the current row again
+            const int row = _prev_row;
+            _prev_row = -1;
+            if( row >= 0 ) onRowChanged( row );
         }
         else{
-            ui->tableView->hideRow(row);
+            emit showNodesHeatmap( "BehaviorTree", values );
         }
+    } );
+    dialog->show();
+    emit showNodesHeatmap( "BehaviorTree", dialog->highlightValues() );
+}
+
+void SidepanelReplay::onDiffFailed(int request_id, QString error)
+{
+    if( request_id != _diff_request_id ) return;
+    cancelDiff();
+    updateTimeControls();
+    QMessageBox::warning( this, tr("Compare logs"), error );
+}
+
+void SidepanelReplay::on_pushButtonExport_clicked()
+{
+    if( _export_worker )
+    {
+        _export_worker->cancel();
+        return;
+    }
+    if( _log_session.filesCount() == 0 )
+    {
+        return;
+    }
+    QSettings settings;
+    QString directory_path  = settings.value("SidepanelReplay.lastExportDirectory",
+                                             QDir::homePath() ).toString();
+    const QString csv_filter = tr("CSV (*.csv)");
+    const QString arrow_filter = tr("Arrow IPC stream (*.arrows)");
+    QString selected_filter = csv_filter;
+    QString filename = QFileDialog::getSaveFileName(this, tr("Export transitions"),
+                                                    directory_path,
+                                                    csv_filter + ";;" + arrow_filter,
+                                                    &selected_filter);
+    if( filename.isEmpty() )
+    {
+        return;
+    }
+    if( QFileInfo(filename).suffix().isEmpty() )
+    {
+        filename += ( selected_filter == arrow_filter ) ? ".arrows" : ".csv";
+    }
+    settings.setValue("SidepanelReplay.lastExportDirectory", QFileInfo(filename).absolutePath() );
+
+    // the files are read again: the export does not depend on what is loaded
+    _export_worker = new LogExportWorker( _log_session.filenames(), filename, this );
+    connect( _export_worker, &LogExportWorker::exportProgress,
+             this, &SidepanelReplay::onExportProgress );
+    connect( _export_worker, &LogExportWorker::exportFinished,
+             this, &SidepanelReplay::onExportFinished );
+
+    ui->pushButtonExport->setText( tr("Cancel export") );
+    ui->labelExport->setStyleSheet( QString() );
+    ui->labelExport->setToolTip( filename );
+    ui->labelExport->setText( tr("exporting...") );
+    _export_worker->start();
+}
+
+void SidepanelReplay::onExportProgress(int percent)
+{
+    if( _export_worker )
+    {
+        ui->pushButtonExport->setToolTip( tr("Exporting: %1%").arg( percent ) );
+    }
+}
+
+void SidepanelReplay::onExportFinished(QString error, quint64 rows)
+{
+    const bool cancelled = _export_worker && _export_worker->isCancelled();
+    if( _export_worker )
+    {
+        _export_worker->wait();
+        delete _export_worker;
+        _export_worker = nullptr;
+    }
+    ui->pushButtonExport->setText( tr("Export...") );
+    ui->pushButtonExport->setToolTip( tr("Export the transitions of the log to CSV or to an Arrow IPC stream") );
+    updateTimeControls();
+
+    // the tooltip keeps the name of the file
+    if( !error.isEmpty() )
+    {
+        ui->labelExport->setText( tr("export failed") );
+        ui->labelExport->setToolTip( ui->labelExport->toolTip() + "\n" + error );
+        ui->labelExport->setStyleSheet( "color: rgb(250, 50, 50)" );
+    }
+    else if( cancelled )
+    {
+        ui->labelExport->setText( tr("export cancelled") );
+    }
+    else{
+        ui->labelExport->setText( tr("%1 exported").arg( rows ) );
+    }
+}
+
+void SidepanelReplay::updateTimeline()
+{
+    if( !_timeline_view || !_timeline_view->isVisible() || _parser )
+    {
+        return;
+    }
+    const int nodes_count = int(_loaded_tree.nodesCount());
+    if( !_timeline_intervals.empty() && _timeline_intervals.lanesCount() == nodes_count &&
+        _timeline_intervals.rowsCount() <= _transitions.size() )
+    {
+        // following the log: only the rows appended since the last update,
+        // and the user keeps the zoom
+        _timeline_intervals.append( _transitions );
+        _timeline_view->update();
+    }
+    else{
+        _timeline_intervals.build( _transitions, nodes_count );
+        _timeline_view->setIntervals( &_timeline_intervals, &_loaded_tree );
+    }
+    if( _prev_row >= 0 && _prev_row < int(_transitions.size()) )
+    {
+        _timeline_view->setCursorTime( _transitions.timestamp( _prev_row ) );
+    }
+}
+
+void SidepanelReplay::on_pushButtonTimeline_clicked()
+{
+    if( !_timeline_view )
+    {
+        _timeline_view = new TimelineView( this );
+        _timeline_view->setWindowFlags( Qt::Window );
+        _timeline_view->setWindowTitle( tr("Timeline") );
+        _timeline_view->resize( 900, 400 );
+        connect( _timeline_view, &TimelineView::timeClicked,
+                 this, &SidepanelReplay::onTimelineClicked );
+    }
+    _timeline_view->show();
+    _timeline_view->raise();
+    updateTimeline();
+}
+
+void SidepanelReplay::onTimelineClicked(double timestamp)
+{
+    if( ui->pushButtonPlay->isChecked() )
+    {
+        return;
+    }
+    seekToRow( std::max( 0, int( _transitions.countUntil(timestamp) ) - 1 ) );
+}
+
+void SidepanelReplay::on_lineEditQuery_textChanged(const QString &)
+{
+    cancelQuery();
+    _query_valid = false;
+    ui->labelQuery->clear();
+    ui->labelQuery->setToolTip( QString() );
+}
+
+void SidepanelReplay::cancelQuery()
+{
+    if( _query_worker )
+    {
+        // joined now: the transitions or the query are about to change
+        _query_request_id++;
+        delete _query_worker;
+        _query_worker = nullptr;
+        ui->labelQuery->clear();
+    }
+}
+
+void SidepanelReplay::on_lineEditQuery_returnPressed()
+{
+    const QString text = ui->lineEditQuery->text().trimmed();
+    if( text.isEmpty() || _transitions.empty() || _query_worker )
+    {
+        return;
+    }
+
+    if( _query_valid )
+    {
+        seekToNextMatch();
+        return;
+    }
+    ReplayQuery query;
+    QString error;
+    if( !query.parse( text, _loaded_tree, error ) )
+    {
+        ui->labelQuery->setText( tr("error") );
+        ui->labelQuery->setToolTip( error );
+        ui->labelQuery->setStyleSheet( "color: rgb(250, 50, 50)" );
+        return;
+    }
+    _query_worker = new ReplayQueryWorker( query, _transitions, _query_index,
+                                           ++_query_request_id, this );
+    connect( _query_worker, &ReplayQueryWorker::queryReady,
+             this, &SidepanelReplay::onQueryReady );
+
+    ui->labelQuery->setStyleSheet( QString() );
+    ui->labelQuery->setToolTip( QString() );
+    ui->labelQuery->setText( tr("searching...") );
+    _query_worker->start();
+}
+
+void SidepanelReplay::onQueryReady(int request_id, ReplayQueryMatchesPtr matches)
+{
+    if( request_id != _query_request_id ) return;
+    cancelQuery();
+
+    _query_matches = *matches;
+    _query_valid = true;
+    seekToNextMatch();
+
+    // what was appended while searching
+    if( ui->checkBoxFollow->isChecked() )
+    {
+        onLogFileChanged();
+    }
+}
+
+void SidepanelReplay::seekToNextMatch()
+{
+    if( _query_matches.empty() )
+    {
+        ui->labelQuery->setText( tr("no match") );
+        return;
+    }
+    // the next match after the current row, wrapping around
+    auto it = std::upper_bound( _query_matches.begin(), _query_matches.end(), _prev_row );
+    if( it == _query_matches.end() )
+    {
+        it = _query_matches.begin();
     }
+    ui->labelQuery->setText( tr("%1 of %2").arg( int(it - _query_matches.begin()) + 1 )
+                                          .arg( _query_matches.size() ) );
+    seekToRow( *it );
 }
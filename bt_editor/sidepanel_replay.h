@@ -4,8 +4,19 @@
 #include <chrono>
 #include <QFrame>
 #include <QTableWidgetItem>
-#include <QStandardItemModel>
+#include <QFileSystemWatcher>
+#include <QElapsedTimer>
+#include <unordered_map>
 #include "bt_editor_base.h"
+#include "log_parser.h"
+#include "replay_table_model.h"
+#include "node_statistics.h"
+#include "timeline_intervals.h"
+#include "timeline_view.h"
+#include "replay_query.h"
+#include "log_diff.h"
+#include "log_export.h"
+#include "memory_report.h"
 
 
 namespace Ui {
@@ -24,12 +35,27 @@ public:
 
     void loadLog(const QByteArray& content);
 
+    // the buffer is not used after the call
+    void loadLog(const char* buffer, size_t size);
+
     size_t transitionsCount() const { return _transitions.size(); }
 
+    bool isLoading() const { return _parser != nullptr; }
+
+    // the transitions loaded and the indexes built from them
+    void addMemoryUsage(MemoryReport& report) const;
+
 public slots:
 
     void on_LoadLog();
 
+    // parse the file in background; it can be followed while it grows
+    void loadLogFile(const QString& filename);
+
+    // a session of several files with the same tree, replayed as a single
+    // log; the directories are replaced by the .fbl files they contain
+    void loadLogFiles(const QStringList& paths);
+
 private slots:
 
     void on_pushButtonPlay_toggled(bool checked);
@@ -44,8 +70,53 @@ private slots:
 
     void onPlayUpdate();
 
+    void on_comboBoxSpeed_currentIndexChanged(int index);
+
+    void on_pushButtonStatistics_clicked();
+
+    void onStatisticsReady(int request_id, ReplayStatisticsPtr statistics);
+
+    void on_pushButtonTimeline_clicked();
+
+    void onTimelineClicked(double timestamp);
+
+    void on_pushButtonCompare_clicked();
+
+    void onDiffReady(int request_id, NodeDiffsPtr nodes, quint64 segments);
+
+    void onDiffFailed(int request_id, QString error);
+
+    void on_pushButtonExport_clicked();
+
+    void onExportProgress(int percent);
+
+    void onExportFinished(QString error, quint64 rows);
+
+    void on_lineEditQuery_returnPressed();
+
+    void onQueryReady(int request_id, ReplayQueryMatchesPtr matches);
+
+    void on_lineEditQuery_textChanged(const QString& text);
+
     void on_lineEditFilter_textChanged(const QString &filter_text);
 
+    void on_pushButtonCancelLoad_clicked();
+
+    void onChunkParsed(int request_id, LogParser::ChunkPtr chunk, int percent);
+
+    void onParsingFinished(int request_id);
+
+    void onParsingFailed(int request_id, QString error);
+
+    void on_lineEditSeek_returnPressed();
+
+    void onTableContextMenu(const QPoint& pos);
+
+    void on_checkBoxFollow_toggled(bool checked);
+
+    // parse what was appended to the followed file since the last time
+    void onLogFileChanged();
+
 signals:
     void loadBehaviorTree(const AbsBehaviorTree& tree, const QString& name );
 
@@ -54,6 +125,8 @@ signals:
 
     void addNewModel(const NodeModel &new_model);
 
+    void showNodesHeatmap(const QString& bt_name, const std::vector<double>& values);
+
 private:
 
     bool eventFilter(QObject *object, QEvent *event) override;
@@ -64,31 +137,119 @@ private:
 
     Ui::SidepanelReplay *ui;
 
-    struct Transition{
-        int16_t index;
-        double timestamp;
-        NodeStatus prev_status;
-        NodeStatus status;
-        bool is_tree_restart;
-        int nearest_restart_transition_index;
-    };
-    std::vector<Transition> _transitions;
+    TransitionStore _transitions;
     std::vector< std::pair<double,int>> _timepoint;
+    std::vector<uint8_t> _checkpoints;
 
     int _prev_row;
-    int _next_row;
 
     void updatedSpinAndSlider(int row);
 
-    QStandardItemModel* _table_model;
+    ReplayTableModel* _table_model;
+    ReplayFilterModel* _filter_model;
+
+    // index in the table view of a row of _transitions; invalid if filtered out
+    QModelIndex tableIndex(int row, int column) const;
 
     QTimer *_layout_update_timer;
 
+    // Playback clock: the log time shown is
+    // _play_start_time + speed * _play_clock.elapsed().
+    // The timer fires once per display frame, whatever the density of the
+    // log: transitions between two frames are skipped, not drawn.
     QTimer *_play_timer;
+    QElapsedTimer _play_clock;
+    double _play_start_time;
+    double _play_speed;
+
+    // log time shown by the playback
+    double playTime() const;
 
     AbsBehaviorTree _loaded_tree;
 
-    void updateTableModel(const AbsBehaviorTree &tree);
+    LogParser* _parser;
+    int _parse_request_id;
+
+    // the file loaded by loadLogFile() and where its parsing can be resumed
+    QString _log_filename;
+    LogLayout _log_layout;
+    std::unordered_map<int,int> _log_uid_to_index;
+    size_t _log_end_offset;
+    LogParser::State _log_state;
+    // all the files loaded; _log_filename is the last one reached
+    LogSession _log_session;
+
+    QFileSystemWatcher* _log_watcher;
+    // the watcher misses changes on some network drives
+    QTimer* _follow_timer;
+
+    // reads _transitions: it is joined before they are modified
+    StatisticsWorker* _statistics_worker;
+    int _statistics_request_id;
+
+    void cancelStatistics();
+
+    // reads _transitions too, while it streams the other log
+    LogDiffWorker* _diff_worker;
+    int _diff_request_id;
+    QString _diff_filename;
+
+    void cancelDiff();
+
+    // reads the files of _log_session, not _transitions
+    LogExportWorker* _export_worker;
+
+    // built from _transitions when the timeline is shown and the log is
+    // completely loaded
+    TimelineIntervals _timeline_intervals;
+    // a separate window, created on demand
+    TimelineView* _timeline_view;
+
+    void updateTimeline();
+
+    ReplayQueryIndex _query_index;
+    // rows matching the last query
+    std::vector<int> _query_matches;
+    bool _query_valid;
+
+    // reads _transitions and _query_index: it is joined before they are
+    // modified
+    ReplayQueryWorker* _query_worker;
+    int _query_request_id;
+
+    void cancelQuery();
+
+    // seek to the match after the current row
+    void seekToNextMatch();
+
+    void stopFollowing();
+
+    // the last transition loaded must be a time point
+    void addLastTimepoint();
+
+    // load the tree in the header of the log; on success, layout tells
+    // where the transitions are
+    bool loadTreeFromLog(const char* buffer, size_t size,
+                         LogLayout& layout,
+                         std::unordered_map<int,int>& uid_to_index);
+
+    void cancelParsing();
+
+    void resetTableModel();
+
+    void appendChunk(const LogParser::Chunk& chunk);
+
+    void updateTimeControls();
+
+    // select a row of _transitions and show it
+    void seekToRow(int row);
+
+    // Parses "t=12.5s", "+2s", "-2s" or "@1612345678.5" into an absolute
+    // timestamp. Returns false if the syntax is not valid.
+    bool parseSeekTime(QString text, double& timestamp) const;
+
+    // next row of a node with the given status, after "row"; -1 if none
+    int findNextStatus(int node_index, NodeStatus status, int row) const;
 
     QWidget *_parent;
 };
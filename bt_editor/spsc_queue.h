@@ -0,0 +1,77 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <atomic>
+#include <vector>
+#include <cstddef>
+#include <utility>
+
+// Bounded, lock-free, single-producer / single-consumer queue.
+// One thread may call push(), another thread may call pop(); no other
+// combination is safe. The capacity is rounded up to a power of two.
+template <typename T>
+class SPSCQueue
+{
+public:
+    explicit SPSCQueue(size_t capacity):
+        _head(0),
+        _tail(0)
+    {
+        size_t size = 2;
+        while( size < capacity ) size <<= 1;
+        _buffer.resize( size );
+        _mask = size - 1;
+    }
+
+    SPSCQueue(const SPSCQueue&) = delete;
+    SPSCQueue& operator=(const SPSCQueue&) = delete;
+
+    size_t capacity() const { return _buffer.size(); }
+
+    // Producer side. Returns false (and leaves value untouched) if full.
+    bool push(T& value)
+    {
+        const size_t tail = _tail.load( std::memory_order_relaxed );
+        if( tail - _head.load( std::memory_order_acquire ) >= _buffer.size() )
+        {
+            return false;
+        }
+        _buffer[ tail & _mask ] = std::move(value);
+        _tail.store( tail + 1, std::memory_order_release );
+        return true;
+    }
+
+    // Consumer side. Returns false if empty.
+    bool pop(T& value)
+    {
+        const size_t head = _head.load( std::memory_order_relaxed );
+        if( head == _tail.load( std::memory_order_acquire ) )
+        {
+            return false;
+        }
+        value = std::move( _buffer[ head & _mask ] );
+        _head.store( head + 1, std::memory_order_release );
+        return true;
+    }
+
+    // Approximate when called concurrently with push/pop.
+    size_t size() const
+    {
+        return _tail.load( std::memory_order_acquire ) -
+               _head.load( std::memory_order_acquire );
+    }
+
+    bool empty() const { return size() == 0; }
+
+private:
+    std::vector<T> _buffer;
+    size_t _mask;
+    // keep producer and consumer indexes on separate cache lines
+    // (padding rather than alignas, that operator new may not honor)
+    char _pad0[64];
+    std::atomic<size_t> _head;
+    char _pad1[64];
+    std::atomic<size_t> _tail;
+};
+
+#endif // SPSC_QUEUE_H
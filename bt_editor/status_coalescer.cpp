@@ -0,0 +1,73 @@
+#include "status_coalescer.h"
+
+void StatusCoalescer::reset(size_t nodes_count)
+{
+    _nodes.clear();
+    _nodes.resize( nodes_count );
+    _dirty.clear();
+    _restarted = false;
+}
+
+void StatusCoalescer::addTransition(int index, NodeStatus prev_status, NodeStatus status)
+{
+    if( index < 0 ) return;
+    if( size_t(index) >= _nodes.size() )
+    {
+        _nodes.resize( index+1 );
+    }
+
+    // The first child of the Root became RUNNING: a new tick started and
+    // the style of the whole tree will be reset. What happened before is
+    // not visible anymore.
+    if( index == 1 && status == NodeStatus::RUNNING )
+    {
+        for(int dirty_index: _dirty)
+        {
+            _nodes[dirty_index].dirty = false;
+        }
+        _dirty.clear();
+        _restarted = true;
+    }
+
+    NodeSnapshot& node = _nodes[index];
+    node.prev_status = prev_status;
+    node.status = status;
+    if( !node.dirty )
+    {
+        node.dirty = true;
+        _dirty.push_back( index );
+    }
+}
+
+std::vector<std::pair<int, NodeStatus>> StatusCoalescer::flush()
+{
+    std::vector<std::pair<int, NodeStatus>> node_status;
+    node_status.reserve( _dirty.size() + 1 );
+
+    if( _restarted )
+    {
+        node_status.push_back( { 1, NodeStatus::RUNNING } );
+    }
+
+    for(int index: _dirty)
+    {
+        NodeSnapshot& node = _nodes[index];
+        node.dirty = false;
+
+        if( _restarted && index == 1 && node.status == NodeStatus::RUNNING )
+        {
+            continue; // already added
+        }
+        // The previous status matters only to dim a node that went back
+        // to IDLE. onChangeNodesStatus takes it from the preceding entry.
+        if( node.status == NodeStatus::IDLE && node.prev_status != NodeStatus::IDLE &&
+            !(index == 1 && node.prev_status == NodeStatus::RUNNING) )
+        {
+            node_status.push_back( { index, node.prev_status } );
+        }
+        node_status.push_back( { index, node.status } );
+    }
+    _dirty.clear();
+    _restarted = false;
+    return node_status;
+}
@@ -0,0 +1,43 @@
+#ifndef STATUS_COALESCER_H
+#define STATUS_COALESCER_H
+
+#include <vector>
+#include "bt_editor_base.h"
+
+// Folds any number of status transitions into a single "current + previous"
+// snapshot per node, to be applied once per display frame.
+// The cost of a flush depends on the number of nodes that changed, not on
+// the number of transitions received in between.
+class StatusCoalescer
+{
+public:
+    StatusCoalescer() = default;
+
+    // Discard pending changes and track a tree with nodes_count nodes.
+    void reset(size_t nodes_count);
+
+    void addTransition(int index, NodeStatus prev_status, NodeStatus status);
+
+    bool empty() const { return _dirty.empty() && !_restarted; }
+
+    // number of nodes that will be updated by the next flush()
+    size_t dirtyCount() const { return _dirty.size(); }
+
+    // Pending changes, encoded as expected by MainWindow::onChangeNodesStatus.
+    // Clear the internal state.
+    std::vector<std::pair<int, NodeStatus>> flush();
+
+private:
+    struct NodeSnapshot
+    {
+        NodeStatus status = NodeStatus::IDLE;
+        NodeStatus prev_status = NodeStatus::IDLE;
+        bool dirty = false;
+    };
+
+    std::vector<NodeSnapshot> _nodes;
+    std::vector<int> _dirty;
+    bool _restarted = false;
+};
+
+#endif // STATUS_COALESCER_H
@@ -0,0 +1,307 @@
+#include "synthetic_trees.h"
+#include "log_format.h"
+#include "utils.h"
+#include <QtEndian>
+#include <algorithm>
+#include <random>
+
+namespace
+{
+
+const char* MAIN_TREE = "BehaviorTree";
+const int BLACKBOARD_KEYS = 32;
+const double INVERTER_RATIO = 0.1;
+
+class TreeGenerator
+{
+public:
+    TreeGenerator(const SyntheticTreeOptions& options):
+        _options(options),
+        _random(options.seed),
+        _leaves_count(0)
+    {}
+
+    TreeFileContent generate()
+    {
+        TreeFileContent content;
+        for (int i = 0; i < std::max( 1, _options.models ); i++)
+        {
+            NodeModel model;
+            // a condition every three models
+            model.type = ( i % 3 == 2 ) ? NodeType::CONDITION : NodeType::ACTION;
+            model.registration_ID = QString( model.type == NodeType::CONDITION ?
+                                                 "Condition_%1" : "Action_%1" ).arg( i );
+            for (int p = 0; p < _options.ports; p++)
+            {
+                PortModel port;
+                port.direction = PortDirection::INPUT;
+                port.type_name = "std::string";
+                model.ports.insert( { QString("in_%1").arg( p ), std::move(port) } );
+            }
+            content.models.insert( { model.registration_ID, model } );
+            _leaf_models.push_back( std::move(model) );
+        }
+
+        // the subtrees do not call other subtrees
+        const int subtree_depth = std::max( 2, _options.depth / 2 );
+        for (int i = 0; i < _options.subtrees; i++)
+        {
+            NodeModel model;
+            model.type = NodeType::SUBTREE;
+            model.registration_ID = QString("Subtree_%1").arg( i );
+            content.models.insert( { model.registration_ID, model } );
+            addNode( content.trees[ model.registration_ID ], nullptr, subtree_depth, false );
+            _subtree_models.push_back( std::move(model) );
+        }
+
+        content.main_tree = MAIN_TREE;
+        addNode( content.trees[ MAIN_TREE ], nullptr, std::max( 1, _options.depth ), true );
+        return content;
+    }
+
+private:
+    const SyntheticTreeOptions& _options;
+    std::mt19937 _random;
+    std::vector<NodeModel> _leaf_models;
+    std::vector<NodeModel> _subtree_models;
+    int _leaves_count;
+
+    bool chance(double ratio)
+    {
+        return std::uniform_real_distribution<double>( 0.0, 1.0 )( _random ) < ratio;
+    }
+
+    size_t pick(size_t count)
+    {
+        return std::uniform_int_distribution<size_t>( 0, count - 1 )( _random );
+    }
+
+    static AbstractTreeNode builtinNode(const char* ID)
+    {
+        AbstractTreeNode node;
+        node.model = BuiltinNodeModels().at( ID );
+        node.instance_name = ID;
+        return node;
+    }
+
+    // the level of "parent" has "levels" below it, this one included
+    void addNode(AbsBehaviorTree& tree, AbstractTreeNode* parent, int levels, bool main_tree)
+    {
+        if( levels > 1 )
+        {
+            AbstractTreeNode* control = tree.addNode( parent, builtinNode( chance( 0.6 ) ? "Sequence" :
+                                                                                         "Fallback" ) );
+            for (int i = 0; i < std::max( 1, _options.branching ); i++)
+            {
+                addNode( tree, control, levels - 1, main_tree );
+            }
+            return;
+        }
+
+        if( main_tree && !_subtree_models.empty() && chance( _options.subtree_ratio ) )
+        {
+            AbstractTreeNode node;
+            node.model = _subtree_models[ pick( _subtree_models.size() ) ];
+            node.instance_name = node.model.registration_ID;
+            tree.addNode( parent, std::move(node) );
+            return;
+        }
+
+        if( parent && chance( INVERTER_RATIO ) )
+        {
+            parent = tree.addNode( parent, builtinNode( "Inverter" ) );
+        }
+        AbstractTreeNode node;
+        node.model = _leaf_models[ pick( _leaf_models.size() ) ];
+        node.instance_name = QString("%1_%2").arg( node.model.type == NodeType::CONDITION ?
+                                                       "condition" : "action" ).arg( _leaves_count++ );
+        for (const auto& port_it: node.model.ports)
+        {
+            node.ports_mapping.insert( { port_it.first,
+                                         QString("{key_%1}").arg( pick( BLACKBOARD_KEYS ) ) } );
+        }
+        tree.addNode( parent, std::move(node) );
+    }
+};
+
+// Ticks the tree of a log and writes the transitions of its nodes, until
+// there are enough of them.
+class TickSimulator
+{
+public:
+    TickSimulator(const AbsBehaviorTree& tree, const std::unordered_map<int, int>& uid_to_index,
+                  const SyntheticLogOptions& options, QByteArray& output):
+        _tree(tree),
+        _options(options),
+        _output(output),
+        _random(options.seed),
+        _status( tree.nodesCount(), NodeStatus::IDLE ),
+        _uids( tree.nodesCount(), 0 ),
+        _written(0),
+        _time(0)
+    {
+        for (const auto& it: uid_to_index)
+        {
+            _uids[ size_t(it.second) ] = uint16_t( it.first );
+        }
+    }
+
+    void run()
+    {
+        // the node 0 is the Root added by BuildTreeFromFlatbuffers()
+        const int root = _tree.rootNode()->children_index.front();
+        for (size_t tick = 0; !full(); tick++)
+        {
+            _time = std::max( _time, tick * _options.tick_period );
+            const NodeStatus result = this->tick( root );
+            if( result != NodeStatus::RUNNING || chance( _options.halt_ratio ) )
+            {
+                // all IDLE: the next tick is a restart
+                halt( root );
+            }
+        }
+    }
+
+private:
+    const AbsBehaviorTree& _tree;
+    const SyntheticLogOptions& _options;
+    QByteArray& _output;
+    std::mt19937 _random;
+    std::vector<NodeStatus> _status;
+    std::vector<uint16_t> _uids;
+    size_t _written;
+    double _time;
+
+    bool full() const { return _written >= _options.transitions; }
+
+    bool chance(double ratio)
+    {
+        return std::uniform_real_distribution<double>( 0.0, 1.0 )( _random ) < ratio;
+    }
+
+    void setStatus(int index, NodeStatus status)
+    {
+        const NodeStatus prev_status = _status[ size_t(index) ];
+        if( prev_status == status || full() )
+        {
+            return;
+        }
+        _status[ size_t(index) ] = status;
+        // a few microseconds between two transitions
+        _time += std::uniform_int_distribution<int>( 5, 50 )( _random ) * 1e-6;
+
+        // u32 t_sec | u32 t_usec | u16 uid | u8 prev_status | u8 status
+        uchar transition[12];
+        const quint32 t_sec = quint32( _time );
+        qToLittleEndian<quint32>( t_sec, transition );
+        qToLittleEndian<quint32>( quint32( ( _time - t_sec ) * 1e6 ), transition + 4 );
+        qToLittleEndian<quint16>( _uids[ size_t(index) ], transition + 8 );
+        transition[10] = uchar( prev_status );
+        transition[11] = uchar( status );
+        _output.append( reinterpret_cast<const char*>( transition ), 12 );
+        _written++;
+    }
+
+    NodeStatus leafResult(NodeType type)
+    {
+        if( type == NodeType::ACTION && chance( _options.running_ratio ) )
+        {
+            return NodeStatus::RUNNING;
+        }
+        return chance( _options.failure_ratio ) ? NodeStatus::FAILURE : NodeStatus::SUCCESS;
+    }
+
+    NodeStatus tick(int index)
+    {
+        const AbstractTreeNode& node = *_tree.node( size_t(index) );
+        const NodeType type = node.model.type;
+        const auto& children = node.children_index;
+
+        if( children.empty() )
+        {
+            // the conditions complete in the tick that starts them
+            if( type != NodeType::CONDITION )
+            {
+                setStatus( index, NodeStatus::RUNNING );
+            }
+            const NodeStatus result = leafResult( type );
+            setStatus( index, result );
+            return result;
+        }
+
+        setStatus( index, NodeStatus::RUNNING );
+        NodeStatus result = NodeStatus::SUCCESS;
+        if( type == NodeType::CONTROL )
+        {
+            const bool fallback = node.model.registration_ID.startsWith( "Fallback" );
+            const NodeStatus done = fallback ? NodeStatus::FAILURE : NodeStatus::SUCCESS;
+            result = done;
+            for (int child: children)
+            {
+                // completed in a previous tick
+                if( _status[ size_t(child) ] == done )
+                {
+                    continue;
+                }
+                const NodeStatus child_result = tick( child );
+                if( child_result != done )
+                {
+                    result = child_result;
+                    break;
+                }
+            }
+        }
+        else{
+            // decorators and subtrees have a single child
+            result = tick( children.front() );
+            if( node.model.registration_ID == "Inverter" && result != NodeStatus::RUNNING )
+            {
+                result = ( result == NodeStatus::SUCCESS ) ? NodeStatus::FAILURE : NodeStatus::SUCCESS;
+            }
+        }
+
+        if( result != NodeStatus::RUNNING )
+        {
+            // as ControlNode::haltChildren()
+            for (int child: children)
+            {
+                halt( child );
+            }
+            setStatus( index, result );
+        }
+        return result;
+    }
+
+    // the children first, as BehaviorTree.CPP halts them
+    void halt(int index)
+    {
+        for (int child: _tree.node( size_t(index) )->children_index)
+        {
+            halt( child );
+        }
+        setStatus( index, NodeStatus::IDLE );
+    }
+};
+
+}
+
+TreeFileContent GenerateSyntheticTrees(const SyntheticTreeOptions &options)
+{
+    return TreeGenerator( options ).generate();
+}
+
+QByteArray GenerateSyntheticLog(const TreeFileContent &content, const SyntheticLogOptions &options)
+{
+    // the subtrees expanded, as the tree of a log has them
+    QByteArray log = WriteTreeFileLog( content );
+
+    size_t tree_offset = 0;
+    size_t tree_size = 0;
+    logTreeLocation( log.constData(), size_t( log.size() ), tree_offset, tree_size );
+    const auto tree = BuildTreeFromFlatbuffers( Serialization::GetBehaviorTree(
+                                                    log.constData() + tree_offset ) );
+
+    log.reserve( log.size() + int( options.transitions * 12 ) );
+    TickSimulator( tree.first, tree.second, options, log ).run();
+    return log;
+}
@@ -0,0 +1,51 @@
+#ifndef SYNTHETIC_TREES_H
+#define SYNTHETIC_TREES_H
+
+#include <QByteArray>
+#include "tree_files.h"
+
+// Trees and logs of any size, for the benchmarks and the scaling tests.
+// The same options and seed always give the same files.
+
+struct SyntheticTreeOptions
+{
+    // levels of the main tree, the leaves included
+    int depth = 5;
+    // children of each control node
+    int branching = 4;
+    // trees called by SubTree nodes, and the share of the leaves of the
+    // main tree that call one of them
+    int subtrees = 0;
+    double subtree_ratio = 0.2;
+    // models of the actions and conditions, and their input ports
+    int models = 16;
+    int ports = 2;
+    unsigned seed = 1;
+};
+
+// The main tree is "BehaviorTree", the others "Subtree_<n>". Sequences and
+// Fallbacks everywhere but the leaves: actions and conditions, a tenth of
+// them below an Inverter.
+TreeFileContent GenerateSyntheticTrees(const SyntheticTreeOptions& options);
+
+struct SyntheticLogOptions
+{
+    size_t transitions = 100000;
+    // of the actions and conditions that complete
+    double failure_ratio = 0.2;
+    // the actions still RUNNING at the end of a tick, completed by a later one
+    double running_ratio = 0.3;
+    // the ticks after which the running tree is halted: the next one is a
+    // restart
+    double halt_ratio = 0.01;
+    // seconds between the ticks
+    double tick_period = 0.01;
+    unsigned seed = 1;
+};
+
+// A version 1 .fbl log of the main tree, as BT::FileLogger writes it while
+// the tree is ticked: the status of each node follows the rules of its
+// Sequence, Fallback or Inverter. Throws std::runtime_error.
+QByteArray GenerateSyntheticLog(const TreeFileContent& content, const SyntheticLogOptions& options);
+
+#endif // SYNTHETIC_TREES_H
@@ -0,0 +1,275 @@
+#include "timeline_intervals.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// add the buckets [first, last] to the runs, that are sorted
+void appendRun(std::vector<TimelineIntervals::Run>& runs, uint32_t first, uint32_t last, uint8_t mask)
+{
+    if( !runs.empty() && runs.back().last >= first )
+    {
+        // the first bucket is shared with the previous run
+        TimelineIntervals::Run& back = runs.back();
+        if( (back.mask | mask) != back.mask )
+        {
+            if( back.first < first )
+            {
+                back.last = first - 1;
+                runs.push_back( { first, first, uint8_t(back.mask | mask) } );
+            }
+            else{
+                back.mask |= mask;
+            }
+        }
+        first = std::max( first, runs.back().last + 1 );
+        if( first > last )
+        {
+            return;
+        }
+    }
+    if( !runs.empty() && runs.back().last + 1 == first && runs.back().mask == mask )
+    {
+        runs.back().last = last;
+    }
+    else{
+        runs.push_back( { first, last, mask } );
+    }
+}
+
+// a little more than the whole log, so that the last bucket is not full
+double spanOf(double duration)
+{
+    return duration * 1.0001 + 1e-6;
+}
+
+} // end anonymous namespace
+
+void TimelineIntervals::clear()
+{
+    _lanes.clear();
+    _levels.clear();
+    _intervals_count = 0;
+    _rows_count = 0;
+    _begin_time = 0;
+    _end_time = 0;
+    _span = 0;
+    _open_since.clear();
+    _open_status.clear();
+    _open_tails.clear();
+}
+
+void TimelineIntervals::build(const TransitionStore &transitions, int nodes_count)
+{
+    clear();
+    if( transitions.empty() || nodes_count <= 0 )
+    {
+        return;
+    }
+    _lanes.resize( size_t(nodes_count) );
+    _open_since.assign( size_t(nodes_count), 0 );
+    _open_status.assign( size_t(nodes_count), NodeStatus::IDLE );
+    _begin_time = transitions.timestamp(0);
+    _end_time = transitions.timestamp( transitions.size() - 1 );
+    _span = spanOf( _end_time - _begin_time );
+
+    appendRows( transitions );
+    buildLevels();
+    addOpenTails();
+}
+
+void TimelineIntervals::append(const TransitionStore &transitions)
+{
+    if( _lanes.empty() || transitions.size() <= _rows_count )
+    {
+        return;
+    }
+    removeOpenTails();
+    _end_time = transitions.timestamp( transitions.size() - 1 );
+
+    std::vector<size_t> previous_sizes( _lanes.size() );
+    for(size_t lane = 0; lane < _lanes.size(); lane++)
+    {
+        previous_sizes[lane] = _lanes[lane].size();
+    }
+    appendRows( transitions );
+
+    if( spanOf( _end_time - _begin_time ) > _span )
+    {
+        // the buckets do not cover the log anymore: make them twice as long
+        _span = std::max( 2 * _span, spanOf( _end_time - _begin_time ) );
+        buildLevels();
+    }
+    else{
+        for(size_t lane = 0; lane < _lanes.size(); lane++)
+        {
+            for(size_t i = previous_sizes[lane]; i < _lanes[lane].size(); i++)
+            {
+                appendToLevels( int(lane), _lanes[lane][i] );
+            }
+        }
+    }
+    addOpenTails();
+}
+
+void TimelineIntervals::appendRows(const TransitionStore &transitions)
+{
+    const int nodes_count = int( _lanes.size() );
+
+    auto close = [&](int index, double time)
+    {
+        if( _open_status[index] != NodeStatus::IDLE )
+        {
+            _lanes[index].push_back( { _open_since[index], float( time - _open_since[index] ),
+                                       _open_status[index] } );
+            _open_status[index] = NodeStatus::IDLE;
+            _intervals_count++;
+        }
+    };
+
+    for(size_t row = _rows_count; row < transitions.size(); row++)
+    {
+        const double timestamp = transitions.timestamp(row);
+        if( transitions.isTreeRestart(row) )
+        {
+            // all the nodes are IDLE again
+            for(int index = 0; index < nodes_count; index++)
+            {
+                close( index, timestamp );
+            }
+        }
+        const int index = transitions.index(row);
+        if( index < 0 || index >= nodes_count )
+        {
+            continue;
+        }
+        close( index, timestamp );
+
+        const NodeStatus status = transitions.status(row);
+        if( status != NodeStatus::IDLE )
+        {
+            _open_since[index] = timestamp;
+            _open_status[index] = status;
+        }
+    }
+    _rows_count = transitions.size();
+}
+
+void TimelineIntervals::addOpenTails()
+{
+    for(size_t lane = 0; lane < _lanes.size(); lane++)
+    {
+        if( _open_status[lane] == NodeStatus::IDLE )
+        {
+            continue;
+        }
+        OpenTail tail;
+        tail.lane = int(lane);
+        tail.levels.reserve( LEVELS );
+        for(int level = 0; level < LEVELS; level++)
+        {
+            const std::vector<Run>& runs = _levels[level][lane];
+            tail.levels.push_back( { runs.size(), runs.empty() ? Run{0, 0, 0} : runs.back() } );
+        }
+        const Interval interval = { _open_since[lane], float( _end_time - _open_since[lane] ),
+                                    _open_status[lane] };
+        _lanes[lane].push_back( interval );
+        _intervals_count++;
+        appendToLevels( int(lane), interval );
+        _open_tails.push_back( std::move(tail) );
+    }
+}
+
+void TimelineIntervals::removeOpenTails()
+{
+    for(const OpenTail& tail: _open_tails)
+    {
+        _lanes[tail.lane].pop_back();
+        _intervals_count--;
+        for(int level = 0; level < LEVELS; level++)
+        {
+            std::vector<Run>& runs = _levels[level][tail.lane];
+            runs.resize( tail.levels[level].first );
+            if( !runs.empty() )
+            {
+                runs.back() = tail.levels[level].second;
+            }
+        }
+    }
+    _open_tails.clear();
+}
+
+void TimelineIntervals::buildLevels()
+{
+    _levels.assign( LEVELS, std::vector<std::vector<Run>>( _lanes.size() ) );
+    const double duration = bucketDuration(0);
+
+    for(size_t lane = 0; lane < _lanes.size(); lane++)
+    {
+        std::vector<Run>& level_zero = _levels[0][lane];
+        for(const Interval& interval: _lanes[lane])
+        {
+            const uint32_t first = uint32_t( std::min<double>( BASE_BUCKETS - 1,
+                                             (interval.begin - _begin_time) / duration ) );
+            const uint32_t last = uint32_t( std::min<double>( BASE_BUCKETS - 1,
+                                            (interval.end() - _begin_time) / duration ) );
+            appendRun( level_zero, first, last, uint8_t( 1 << int(interval.status) ) );
+        }
+        for(int level = 1; level < LEVELS; level++)
+        {
+            std::vector<Run>& runs = _levels[level][lane];
+            for(const Run& run: _levels[level-1][lane])
+            {
+                appendRun( runs, run.first >> 1, run.last >> 1, run.mask );
+            }
+        }
+    }
+}
+
+void TimelineIntervals::appendToLevels(int lane, const Interval &interval)
+{
+    // a bucket of a level covers two of the previous one: shifting the
+    // buckets of the interval gives the ones of each level
+    const double duration = bucketDuration(0);
+    const uint32_t first = uint32_t( std::min<double>( BASE_BUCKETS - 1,
+                                     (interval.begin - _begin_time) / duration ) );
+    const uint32_t last = uint32_t( std::min<double>( BASE_BUCKETS - 1,
+                                    (interval.end() - _begin_time) / duration ) );
+    const uint8_t mask = uint8_t( 1 << int(interval.status) );
+    for(int level = 0; level < LEVELS; level++)
+    {
+        appendRun( _levels[level][lane], first >> level, last >> level, mask );
+    }
+}
+
+size_t TimelineIntervals::lowerBound(int lane, double time) const
+{
+    const auto& intervals = _lanes[lane];
+    auto it = std::lower_bound( intervals.begin(), intervals.end(), time,
+                                [](const Interval& interval, double t) { return interval.end() < t; } );
+    return size_t( it - intervals.begin() );
+}
+
+int TimelineIntervals::levelFor(double duration) const
+{
+    const double base = bucketDuration(0);
+    if( base <= 0 || duration < base )
+    {
+        return -1;
+    }
+    const int level = int( std::floor( std::log2( duration / base ) ) );
+    return std::min( level, LEVELS - 1 );
+}
+
+double TimelineIntervals::bucketDuration(int level) const
+{
+    return _span / double(BASE_BUCKETS) * double( 1u << level );
+}
+
+size_t TimelineIntervals::lowerBoundRun(int lane, int level, uint32_t bucket) const
+{
+    const auto& level_runs = _levels[level][lane];
+    auto it = std::lower_bound( level_runs.begin(), level_runs.end(), bucket,
+                                [](const Run& run, uint32_t b) { return run.last < b; } );
+    return size_t( it - level_runs.begin() );
+}
@@ -0,0 +1,109 @@
+#ifndef TIMELINE_INTERVALS_H
+#define TIMELINE_INTERVALS_H
+
+#include <vector>
+#include <cstdint>
+#include "transition_store.h"
+
+// The time spent by each node in a status other than IDLE, as sorted,
+// disjoint intervals: one lane per node index.
+//
+// To draw millions of intervals when zoomed out, each lane has also levels
+// of detail: the time is divided in buckets (BASE_BUCKETS at level 0, half
+// as many at each next level), and a run of consecutive buckets with the
+// same statuses is stored once.
+class TimelineIntervals
+{
+public:
+    struct Interval
+    {
+        double begin;
+        float duration;
+        NodeStatus status;
+
+        double end() const { return begin + double(duration); }
+    };
+
+    // buckets [first, last] containing the statuses in "mask" (bit 1<<status)
+    struct Run
+    {
+        uint32_t first;
+        uint32_t last;
+        uint8_t mask;
+    };
+
+    void build(const TransitionStore& transitions, int nodes_count);
+
+    // Extend the intervals with the rows appended to "transitions" since the
+    // last build() or append(). The buckets are kept while the log fits in
+    // them, then doubled, so that following a growing log costs the new rows
+    // only, amortized.
+    void append(const TransitionStore& transitions);
+
+    // Number of rows of the transitions already in the intervals.
+    size_t rowsCount() const { return _rows_count; }
+
+    void clear();
+
+    bool empty() const { return _lanes.empty(); }
+
+    int lanesCount() const { return int(_lanes.size()); }
+
+    const std::vector<Interval>& lane(int index) const { return _lanes[index]; }
+
+    size_t intervalsCount() const { return _intervals_count; }
+
+    double beginTime() const { return _begin_time; }
+
+    double endTime() const { return _end_time; }
+
+    // Position of the first interval not ending before "time".
+    size_t lowerBound(int lane, double time) const;
+
+    // Coarsest level whose buckets are not longer than "duration", or -1 if
+    // the intervals themselves should be drawn.
+    int levelFor(double duration) const;
+
+    double bucketDuration(int level) const;
+
+    const std::vector<Run>& runs(int lane, int level) const { return _levels[level][lane]; }
+
+    // Position of the first run not ending before "bucket".
+    size_t lowerBoundRun(int lane, int level, uint32_t bucket) const;
+
+    static const int BASE_BUCKETS = 1 << 16;
+    static const int LEVELS = 17;
+
+private:
+    std::vector<std::vector<Interval>> _lanes;
+    // [level][lane]
+    std::vector<std::vector<std::vector<Run>>> _levels;
+    size_t _intervals_count = 0;
+    size_t _rows_count = 0;
+    double _begin_time = 0;
+    double _end_time = 0;
+    // the time covered by the buckets, at least _end_time - _begin_time
+    double _span = 0;
+
+    // status of each node after the last row, and since when
+    std::vector<double> _open_since;
+    std::vector<NodeStatus> _open_status;
+
+    // The intervals still open are closed at _end_time, until the next
+    // append(): what they replaced in the runs, to be restored.
+    struct OpenTail
+    {
+        int lane;
+        // [level] size of the runs, and last run when not empty
+        std::vector<std::pair<size_t, Run>> levels;
+    };
+    std::vector<OpenTail> _open_tails;
+
+    void appendRows(const TransitionStore& transitions);
+    void buildLevels();
+    void appendToLevels(int lane, const Interval& interval);
+    void addOpenTails();
+    void removeOpenTails();
+};
+
+#endif // TIMELINE_INTERVALS_H
@@ -0,0 +1,259 @@
+#include "timeline_view.h"
+#include <QPainter>
+#include <QWheelEvent>
+#include <QMouseEvent>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+QColor colorOfMask(uint8_t mask)
+{
+    // the most relevant status is shown when they are mixed
+    if( mask & (1 << int(NodeStatus::FAILURE)) ) return QColor(250, 50, 50);
+    if( mask & (1 << int(NodeStatus::RUNNING)) ) return QColor(220, 140, 20);
+    if( mask & (1 << int(NodeStatus::SUCCESS)) ) return QColor(51, 200, 51);
+    return Qt::transparent;
+}
+
+} // end anonymous namespace
+
+TimelineView::TimelineView(QWidget *parent):
+    QWidget(parent),
+    _intervals(nullptr),
+    _tree(nullptr),
+    _view_begin(0),
+    _view_duration(1),
+    _first_lane(0),
+    _cursor_time(0),
+    _dragging(false)
+{
+    setMinimumSize( 400, 150 );
+    setMouseTracking( false );
+    setAttribute( Qt::WA_OpaquePaintEvent );
+}
+
+void TimelineView::setIntervals(const TimelineIntervals *intervals, const AbsBehaviorTree *tree)
+{
+    _intervals = intervals;
+    _tree = tree;
+    _first_lane = 0;
+    resetZoom();
+}
+
+void TimelineView::setCursorTime(double timestamp)
+{
+    if( _cursor_time != timestamp )
+    {
+        _cursor_time = timestamp;
+        update();
+    }
+}
+
+void TimelineView::resetZoom()
+{
+    if( _intervals && !_intervals->empty() )
+    {
+        _view_begin = _intervals->beginTime();
+        _view_duration = std::max( 1e-3, _intervals->endTime() - _intervals->beginTime() );
+    }
+    update();
+}
+
+double TimelineView::timeAt(int x) const
+{
+    const int width = std::max( 1, this->width() - NAMES_WIDTH );
+    return _view_begin + double(x - NAMES_WIDTH) / width * _view_duration;
+}
+
+double TimelineView::xAt(double time) const
+{
+    const int width = std::max( 1, this->width() - NAMES_WIDTH );
+    return NAMES_WIDTH + (time - _view_begin) / _view_duration * width;
+}
+
+int TimelineView::visibleLanes() const
+{
+    return std::max( 0, (height() - AXIS_HEIGHT) / LANE_HEIGHT + 1 );
+}
+
+void TimelineView::paintEvent(QPaintEvent *)
+{
+    QPainter painter(this);
+    painter.fillRect( rect(), palette().base() );
+
+    if( !_intervals || _intervals->empty() || !_tree )
+    {
+        painter.drawText( rect(), Qt::AlignCenter, tr("No log loaded") );
+        return;
+    }
+
+    const int last_lane = std::min( _intervals->lanesCount(), _first_lane + visibleLanes() );
+    for (int lane = _first_lane; lane < last_lane; lane++)
+    {
+        const int y = AXIS_HEIGHT + (lane - _first_lane) * LANE_HEIGHT;
+        if( lane % 2 == 1 )
+        {
+            painter.fillRect( 0, y, width(), LANE_HEIGHT, palette().alternateBase() );
+        }
+        painter.setClipRect( NAMES_WIDTH, AXIS_HEIGHT, width() - NAMES_WIDTH, height() - AXIS_HEIGHT );
+        drawLane( painter, lane, y );
+        painter.setClipping( false );
+
+        if( size_t(lane) < _tree->nodesCount() )
+        {
+            const QString name = fontMetrics().elidedText( _tree->node( size_t(lane) )->instance_name,
+                                                          Qt::ElideRight, NAMES_WIDTH - 8 );
+            painter.setPen( palette().text().color() );
+            painter.drawText( QRect(4, y, NAMES_WIDTH - 8, LANE_HEIGHT),
+                              Qt::AlignVCenter | Qt::AlignLeft, name );
+        }
+    }
+
+    drawAxis( painter );
+
+    const double cursor_x = xAt( _cursor_time );
+    if( cursor_x >= NAMES_WIDTH && cursor_x <= width() )
+    {
+        painter.setPen( QPen( palette().text().color(), 1, Qt::DashLine ) );
+        painter.drawLine( QPointF(cursor_x, AXIS_HEIGHT), QPointF(cursor_x, height()) );
+    }
+}
+
+void TimelineView::drawLane(QPainter &painter, int lane, int y)
+{
+    const int width = std::max( 1, this->width() - NAMES_WIDTH );
+    const double seconds_per_pixel = _view_duration / width;
+    const double view_end = _view_begin + _view_duration;
+    const int level = _intervals->levelFor( seconds_per_pixel );
+    const int top = y + 2;
+    const int height = LANE_HEIGHT - 4;
+
+    if( level < 0 )
+    {
+        const auto& intervals = _intervals->lane(lane);
+        for (size_t i = _intervals->lowerBound( lane, _view_begin );
+             i < intervals.size() && intervals[i].begin <= view_end; i++)
+        {
+            const auto& interval = intervals[i];
+            const double x0 = xAt( interval.begin );
+            const double x1 = std::max( x0 + 1.0, xAt( interval.end() ) );
+            painter.fillRect( QRectF( x0, top, x1 - x0, height ),
+                              colorOfMask( uint8_t(1 << int(interval.status)) ) );
+        }
+        return;
+    }
+
+    // zoomed out: buckets of at least one pixel
+    const double bucket_duration = _intervals->bucketDuration( level );
+    const double begin_time = _intervals->beginTime();
+    const double first = std::max( 0.0, (_view_begin - begin_time) / bucket_duration );
+    const double last = std::max( 0.0, (view_end - begin_time) / bucket_duration );
+
+    const auto& runs = _intervals->runs( lane, level );
+    for (size_t r = _intervals->lowerBoundRun( lane, level, uint32_t(first) );
+         r < runs.size() && double(runs[r].first) <= last; r++)
+    {
+        const auto& run = runs[r];
+        const double x0 = xAt( begin_time + run.first * bucket_duration );
+        const double x1 = std::max( x0 + 1.0, xAt( begin_time + (run.last + 1) * bucket_duration ) );
+        painter.fillRect( QRectF( x0, top, x1 - x0, height ), colorOfMask( run.mask ) );
+    }
+}
+
+void TimelineView::drawAxis(QPainter &painter)
+{
+    painter.fillRect( 0, 0, width(), AXIS_HEIGHT, palette().window() );
+    painter.setPen( palette().text().color() );
+
+    // about one label every 100 pixels, with a round step
+    const int width = std::max( 1, this->width() - NAMES_WIDTH );
+    const double raw_step = _view_duration * 100.0 / width;
+    const double magnitude = std::pow( 10.0, std::floor( std::log10( raw_step ) ) );
+    double step = magnitude;
+    if( raw_step > 5 * magnitude ) step = 10 * magnitude;
+    else if( raw_step > 2 * magnitude ) step = 5 * magnitude;
+    else if( raw_step > magnitude ) step = 2 * magnitude;
+
+    const double origin = _intervals->beginTime();
+    const int decimals = std::max( 0, int( -std::floor( std::log10( step ) ) ) );
+
+    for (double t = std::ceil( (_view_begin - origin) / step ) * step;
+         origin + t <= _view_begin + _view_duration; t += step)
+    {
+        const double x = xAt( origin + t );
+        painter.drawLine( QPointF(x, AXIS_HEIGHT - 4), QPointF(x, AXIS_HEIGHT) );
+        painter.drawText( QPointF(x + 2, AXIS_HEIGHT - 6),
+                          QString("%1 s").arg( t, 0, 'f', decimals ) );
+    }
+}
+
+void TimelineView::wheelEvent(QWheelEvent *event)
+{
+    if( !_intervals || _intervals->empty() )
+    {
+        return;
+    }
+    const int delta = event->angleDelta().y();
+
+    if( event->modifiers() & Qt::ShiftModifier )
+    {
+        const int max_first = std::max( 0, _intervals->lanesCount() - visibleLanes() + 1 );
+        _first_lane = std::max( 0, std::min( max_first, _first_lane - delta / 40 ) );
+    }
+    else{
+        const int x = event->pos().x();
+        const double anchor = timeAt( x );
+        const double total = _intervals->endTime() - _intervals->beginTime();
+        const double factor = std::pow( 1.0015, -delta );
+        _view_duration = std::max( 1e-6, std::min( std::max(1e-3, total) * 1.05, _view_duration * factor ) );
+        // the time under the mouse does not move
+        const int width = std::max( 1, this->width() - NAMES_WIDTH );
+        _view_begin = anchor - double(x - NAMES_WIDTH) / width * _view_duration;
+    }
+    update();
+    event->accept();
+}
+
+void TimelineView::mousePressEvent(QMouseEvent *event)
+{
+    _press_pos = _last_pos = event->pos();
+    _dragging = false;
+}
+
+void TimelineView::mouseMoveEvent(QMouseEvent *event)
+{
+    if( !(event->buttons() & Qt::LeftButton) )
+    {
+        return;
+    }
+    if( (event->pos() - _press_pos).manhattanLength() > 4 )
+    {
+        _dragging = true;
+    }
+    if( _dragging && _intervals && !_intervals->empty() )
+    {
+        const QPoint delta = event->pos() - _last_pos;
+        const int width = std::max( 1, this->width() - NAMES_WIDTH );
+        _view_begin -= double(delta.x()) / width * _view_duration;
+
+        const int max_first = std::max( 0, _intervals->lanesCount() - visibleLanes() + 1 );
+        const int lanes = -delta.y() / LANE_HEIGHT;
+        if( lanes != 0 )
+        {
+            _first_lane = std::max( 0, std::min( max_first, _first_lane + lanes ) );
+            _last_pos.setY( event->pos().y() );
+        }
+        _last_pos.setX( event->pos().x() );
+        update();
+    }
+}
+
+void TimelineView::mouseReleaseEvent(QMouseEvent *event)
+{
+    if( !_dragging && event->button() == Qt::LeftButton && event->pos().x() >= NAMES_WIDTH )
+    {
+        emit timeClicked( timeAt( event->pos().x() ) );
+    }
+    _dragging = false;
+}
@@ -0,0 +1,72 @@
+#ifndef TIMELINE_VIEW_H
+#define TIMELINE_VIEW_H
+
+#include <QWidget>
+#include "bt_editor_base.h"
+#include "timeline_intervals.h"
+
+// Gantt chart of a replayed log: one lane per node, colored by status.
+// Only the visible lanes and time range are drawn; when an interval is
+// shorter than a pixel, the levels of detail of TimelineIntervals are used.
+//
+// Wheel: zoom around the mouse. Shift+wheel: scroll the lanes.
+// Drag: pan. Click: seek the replay to that time.
+class TimelineView : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit TimelineView(QWidget* parent = nullptr);
+
+    // the intervals and the tree must outlive the view, or be reset
+    void setIntervals(const TimelineIntervals* intervals, const AbsBehaviorTree* tree);
+
+    void setCursorTime(double timestamp);
+
+    // show the whole log
+    void resetZoom();
+
+signals:
+    void timeClicked(double timestamp);
+
+protected:
+    void paintEvent(QPaintEvent* event) override;
+
+    void wheelEvent(QWheelEvent* event) override;
+
+    void mousePressEvent(QMouseEvent* event) override;
+
+    void mouseMoveEvent(QMouseEvent* event) override;
+
+    void mouseReleaseEvent(QMouseEvent* event) override;
+
+private:
+    const TimelineIntervals* _intervals;
+    const AbsBehaviorTree* _tree;
+
+    // visible time range
+    double _view_begin;
+    double _view_duration;
+    int _first_lane;
+    double _cursor_time;
+
+    QPoint _press_pos;
+    QPoint _last_pos;
+    bool _dragging;
+
+    static const int LANE_HEIGHT = 16;
+    static const int NAMES_WIDTH = 160;
+    static const int AXIS_HEIGHT = 20;
+
+    double timeAt(int x) const;
+
+    double xAt(double time) const;
+
+    int visibleLanes() const;
+
+    void drawLane(QPainter& painter, int lane, int y);
+
+    void drawAxis(QPainter& painter);
+};
+
+#endif // TIMELINE_VIEW_H
@@ -0,0 +1,108 @@
+#include "transition_history.h"
+#include <algorithm>
+
+#include "utils.h"
+
+TransitionHistory::TransitionHistory():
+    _head(0),
+    _size(0),
+    _max_age(0)
+{
+}
+
+void TransitionHistory::reset(size_t nodes_count, size_t capacity, double max_age_sec)
+{
+    _buffer.resize( std::max<size_t>(capacity, 1) );
+    _max_age = max_age_sec;
+    _base_status.assign( nodes_count, NodeStatus::IDLE );
+    _base_prev_status.assign( nodes_count, NodeStatus::IDLE );
+    _head = 0;
+    _size = 0;
+}
+
+void TransitionHistory::clear()
+{
+    reset( _base_status.size(), _buffer.size(), _max_age );
+}
+
+void TransitionHistory::setBaseStatus(int index, NodeStatus status)
+{
+    if( index >= 0 && size_t(index) < _base_status.size() )
+    {
+        _base_status[index] = status;
+    }
+}
+
+void TransitionHistory::popOldest()
+{
+    const Transition& oldest = at(0);
+    if( size_t(oldest.index) < _base_status.size() )
+    {
+        _base_status[oldest.index] = oldest.status;
+        _base_prev_status[oldest.index] = oldest.prev_status;
+    }
+    _head = (_head + 1) % _buffer.size();
+    _size--;
+}
+
+void TransitionHistory::push(int index, double timestamp,
+                             NodeStatus prev_status, NodeStatus status)
+{
+    if( _buffer.empty() || index < 0 || size_t(index) >= _base_status.size() )
+    {
+        return;
+    }
+    if( _size == _buffer.size() )
+    {
+        popOldest();
+    }
+    while( _size > 0 && at(0).timestamp < timestamp - _max_age )
+    {
+        popOldest();
+    }
+
+    Transition& transition = _buffer[ (_head + _size) % _buffer.size() ];
+    transition.index = int16_t(index);
+    transition.timestamp = timestamp;
+    transition.prev_status = prev_status;
+    transition.status = status;
+    transition.is_tree_restart = ( index == 1 && status == NodeStatus::RUNNING );
+    transition.nearest_restart_transition_index = 0;
+    _size++;
+}
+
+size_t TransitionHistory::countUntil(double time) const
+{
+    // binary search, the transitions are sorted by timestamp
+    size_t first = 0;
+    size_t count = _size;
+    while( count > 0 )
+    {
+        const size_t step = count / 2;
+        if( at(first + step).timestamp <= time )
+        {
+            first += step + 1;
+            count -= step + 1;
+        }
+        else{
+            count = step;
+        }
+    }
+    return first;
+}
+
+std::vector<std::pair<int, NodeStatus>> TransitionHistory::statusAfter(size_t count) const
+{
+    std::vector<NodeStatus> status = _base_status;
+    std::vector<NodeStatus> prev_status = _base_prev_status;
+
+    count = std::min( count, _size );
+    for(size_t i = 0; i < count; i++)
+    {
+        const Transition& transition = at(i);
+        status[transition.index] = transition.status;
+        prev_status[transition.index] = transition.prev_status;
+    }
+
+    return encodeNodesStatus( status, prev_status );
+}
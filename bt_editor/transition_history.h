@@ -0,0 +1,67 @@
+#ifndef TRANSITION_HISTORY_H
+#define TRANSITION_HISTORY_H
+
+#include <vector>
+#include "bt_editor_base.h"
+
+// Fixed-memory ring buffer of the most recent transitions of a tree.
+// The memory is allocated once in reset(); recording a transition never
+// allocates. Transitions older than max_age_sec, or exceeding the capacity,
+// are folded into a base snapshot, so that the status of the tree can be
+// rebuilt at any time still covered by the buffer.
+class TransitionHistory
+{
+public:
+    TransitionHistory();
+
+    void reset(size_t nodes_count, size_t capacity, double max_age_sec);
+
+    void clear();
+
+    // status of the nodes before the first transition that will be pushed
+    void setBaseStatus(int index, NodeStatus status);
+
+    void push(int index, double timestamp, NodeStatus prev_status, NodeStatus status);
+
+    size_t size() const { return _size; }
+
+    bool empty() const { return _size == 0; }
+
+    // i = 0 is the oldest transition
+    const Transition& at(size_t i) const
+    {
+        return _buffer[ (_head + i) % _buffer.size() ];
+    }
+
+    double oldestTimestamp() const { return empty() ? 0.0 : at(0).timestamp; }
+
+    double newestTimestamp() const { return empty() ? 0.0 : at(_size-1).timestamp; }
+
+    // number of transitions with timestamp <= time
+    size_t countUntil(double time) const;
+
+    // Status of all the nodes after the first "count" transitions, encoded
+    // as expected by MainWindow::onChangeNodesStatus.
+    std::vector<std::pair<int, NodeStatus>> statusAfter(size_t count) const;
+
+    // allocated by reset(), whatever the size
+    size_t memoryUsage() const
+    {
+        return _buffer.capacity() * sizeof(Transition) +
+               ( _base_status.capacity() + _base_prev_status.capacity() ) * sizeof(NodeStatus);
+    }
+
+private:
+    std::vector<Transition> _buffer;
+    size_t _head;
+    size_t _size;
+    double _max_age;
+
+    // status before the oldest transition in the buffer
+    std::vector<NodeStatus> _base_status;
+    std::vector<NodeStatus> _base_prev_status;
+
+    void popOldest();
+};
+
+#endif // TRANSITION_HISTORY_H
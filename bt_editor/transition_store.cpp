@@ -0,0 +1,127 @@
+#include "transition_store.h"
+#include <algorithm>
+#include <cmath>
+
+// odr-used by push_back(): C++11 needs a definition
+const uint32_t TransitionStore::FAR_TIMESTAMP;
+
+TransitionStore::TransitionStore()
+{
+}
+
+void TransitionStore::clear()
+{
+    _block_start.clear();
+    _delta_usec.clear();
+    _index.clear();
+    _status.clear();
+    _restart_rows.clear();
+    _far_timestamps.clear();
+}
+
+void TransitionStore::reserve(size_t count)
+{
+    _block_start.reserve( count / BLOCK_SIZE + 1 );
+    _delta_usec.reserve( count );
+    _index.reserve( count );
+    _status.reserve( count );
+}
+
+void TransitionStore::push_back(const Transition &transition)
+{
+    const size_t row = size();
+    if( row % BLOCK_SIZE == 0 )
+    {
+        _block_start.push_back( transition.timestamp );
+    }
+
+    const double delta = std::round( (transition.timestamp - _block_start.back()) * 1e6 );
+    if( delta >= 0 && delta < double(FAR_TIMESTAMP) )
+    {
+        _delta_usec.push_back( uint32_t(delta) );
+    }
+    else{
+        _delta_usec.push_back( FAR_TIMESTAMP );
+        _far_timestamps.push_back( { int(row), transition.timestamp } );
+    }
+
+    _index.push_back( uint16_t(transition.index) );
+    _status.push_back( uint8_t(transition.status) | (uint8_t(transition.prev_status) << 2) );
+
+    if( transition.is_tree_restart )
+    {
+        _restart_rows.push_back( int(row) );
+    }
+}
+
+void TransitionStore::append(const std::vector<Transition> &transitions)
+{
+    for(const auto& transition: transitions)
+    {
+        push_back( transition );
+    }
+}
+
+double TransitionStore::timestamp(size_t row) const
+{
+    const uint32_t delta = _delta_usec[row];
+    if( delta != FAR_TIMESTAMP )
+    {
+        return _block_start[ row / BLOCK_SIZE ] + delta * 1e-6;
+    }
+    auto it = std::lower_bound( _far_timestamps.begin(), _far_timestamps.end(), int(row),
+                                [](const std::pair<int,double>& a, int val) { return a.first < val; } );
+    return it->second;
+}
+
+bool TransitionStore::isTreeRestart(size_t row) const
+{
+    return std::binary_search( _restart_rows.begin(), _restart_rows.end(), int(row) );
+}
+
+int TransitionStore::nearestRestart(size_t row) const
+{
+    auto it = std::upper_bound( _restart_rows.begin(), _restart_rows.end(), int(row) );
+    return ( it == _restart_rows.begin() ) ? 0 : *(it - 1);
+}
+
+size_t TransitionStore::countUntil(double time) const
+{
+    size_t first = 0;
+    size_t count = size();
+    while( count > 0 )
+    {
+        const size_t step = count / 2;
+        if( timestamp(first + step) <= time )
+        {
+            first += step + 1;
+            count -= step + 1;
+        }
+        else{
+            count = step;
+        }
+    }
+    return first;
+}
+
+Transition TransitionStore::operator[](size_t row) const
+{
+    Transition transition;
+    transition.index = int16_t( _index[row] );
+    transition.timestamp = timestamp(row);
+    transition.prev_status = prevStatus(row);
+    transition.status = status(row);
+    transition.is_tree_restart = isTreeRestart(row);
+    transition.nearest_restart_transition_index = nearestRestart(row);
+    return transition;
+}
+
+size_t TransitionStore::memoryUsage() const
+{
+    return _block_start.capacity() * sizeof(double) +
+           _delta_usec.capacity() * sizeof(uint32_t) +
+           _index.capacity() * sizeof(uint16_t) +
+           _status.capacity() * sizeof(uint8_t) +
+           _restart_rows.capacity() * sizeof(int) +
+           _far_timestamps.capacity() * sizeof(std::pair<int,double>);
+}
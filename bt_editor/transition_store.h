@@ -0,0 +1,73 @@
+#ifndef TRANSITION_STORE_H
+#define TRANSITION_STORE_H
+
+#include <vector>
+#include <cstdint>
+#include "bt_editor_base.h"
+
+// Compact, append-only, column-oriented storage of the transitions of a log.
+// About 7 bytes per transition, instead of sizeof(Transition):
+//  - timestamps are stored in microseconds, relative to the first
+//    transition of their block of BLOCK_SIZE transitions;
+//  - node index on 16 bits;
+//  - both statuses packed in one byte;
+//  - the restarts of the tree are a sparse list of rows.
+class TransitionStore
+{
+public:
+    TransitionStore();
+
+    size_t size() const { return _index.size(); }
+
+    bool empty() const { return _index.empty(); }
+
+    void clear();
+
+    void reserve(size_t count);
+
+    void push_back(const Transition& transition);
+
+    void append(const std::vector<Transition>& transitions);
+
+    double timestamp(size_t row) const;
+
+    int index(size_t row) const { return _index[row]; }
+
+    NodeStatus status(size_t row) const { return NodeStatus( _status[row] & 0x03 ); }
+
+    NodeStatus prevStatus(size_t row) const { return NodeStatus( (_status[row] >> 2) & 0x03 ); }
+
+    bool isTreeRestart(size_t row) const;
+
+    int nearestRestart(size_t row) const;
+
+    // Number of transitions with timestamp <= time, by binary search.
+    // The timestamps of a log are sorted.
+    size_t countUntil(double time) const;
+
+    // Rebuild the whole record. Prefer the accessors of a single column in
+    // the sequential scans.
+    Transition operator[](size_t row) const;
+
+    Transition front() const { return (*this)[0]; }
+
+    Transition back() const { return (*this)[ size() - 1 ]; }
+
+    size_t memoryUsage() const;
+
+    static const size_t BLOCK_SIZE = 4096;
+
+private:
+    std::vector<double> _block_start;
+    std::vector<uint32_t> _delta_usec;
+    std::vector<uint16_t> _index;
+    std::vector<uint8_t> _status;
+    // sorted
+    std::vector<int> _restart_rows;
+    // rows whose delta does not fit in 32 bits (more than one hour)
+    std::vector<std::pair<int,double>> _far_timestamps;
+
+    static const uint32_t FAR_TIMESTAMP = 0xFFFFFFFF;
+};
+
+#endif // TRANSITION_STORE_H
@@ -0,0 +1,211 @@
+#include "tree_clipboard.h"
+#include <QDataStream>
+#include <QHash>
+#include <functional>
+#include <limits>
+#include <set>
+
+#include "editor_flowscene.h"
+#include "utils.h"
+#include "models/SubtreeNodeModel.hpp"
+
+const char* NODES_MIME_TYPE = "application/x-groot-nodes";
+
+namespace
+{
+const quint32 CLIPBOARD_MAGIC = 0x47525443; // "GRTC"
+const quint16 CLIPBOARD_VERSION = 1;
+}
+
+ClipboardContent CopyNodes(const EditorFlowScene& scene,
+                           const std::vector<QtNodes::Node*>& nodes)
+{
+    ClipboardContent content;
+    const std::set<const QtNodes::Node*> copied( nodes.begin(), nodes.end() );
+
+    QPointF top_left( std::numeric_limits<qreal>::max(), std::numeric_limits<qreal>::max() );
+    for (auto node: nodes)
+    {
+        const QPointF pos = scene.getNodePosition( *node );
+        top_left.setX( std::min( top_left.x(), pos.x() ) );
+        top_left.setY( std::min( top_left.y(), pos.y() ) );
+    }
+
+    std::function<void(AbsBehaviorTree&, AbstractTreeNode*, QtNodes::Node*)> copyRecursively;
+    copyRecursively = [&](AbsBehaviorTree& tree, AbstractTreeNode* parent, QtNodes::Node* node)
+    {
+        auto bt_model = dynamic_cast<BehaviorTreeDataModel*>( node->nodeDataModel() );
+        AbstractTreeNode abs_node;
+        abs_node.model = bt_model->model();
+        abs_node.instance_name = bt_model->instanceName();
+        abs_node.ports_mapping = bt_model->getCurrentPortMapping();
+        abs_node.pos = scene.getNodePosition( *node ) - top_left;
+        content.models.insert( { abs_node.model.registration_ID, abs_node.model } );
+
+        AbstractTreeNode* added_node = tree.addNode( parent, std::move(abs_node) );
+
+        auto subtree = dynamic_cast<SubtreeNodeModel*>( bt_model );
+        if( subtree && subtree->expanded() )
+        {
+            return;
+        }
+        for (auto child: getChildren( scene, *node, true ))
+        {
+            if( copied.count( child ) )
+            {
+                copyRecursively( tree, added_node, child );
+            }
+        }
+    };
+
+    for (auto node: nodes)
+    {
+        auto bt_model = dynamic_cast<BehaviorTreeDataModel*>( node->nodeDataModel() );
+        if( !bt_model || bt_model->registrationName() == "Root" )
+        {
+            continue;
+        }
+        // copied with its parent
+        auto parent = scene.topology().parent( *node );
+        if( parent && copied.count( parent ) )
+        {
+            continue;
+        }
+        content.trees.emplace_back();
+        copyRecursively( content.trees.back(), nullptr, node );
+    }
+    return content;
+}
+
+QByteArray EncodeClipboard(const ClipboardContent& content)
+{
+    QByteArray data;
+    {
+        QDataStream stream( &data, QIODevice::WriteOnly );
+        stream << CLIPBOARD_MAGIC << CLIPBOARD_VERSION;
+
+        QHash<QString, quint32> model_index;
+        stream << quint32( content.models.size() );
+        for (const auto& it: content.models)
+        {
+            const NodeModel& model = it.second;
+            model_index.insert( model.registration_ID, quint32( model_index.size() ) );
+            stream << model.registration_ID << qint32( model.type ) << quint32( model.ports.size() );
+            for (const auto& port_it: model.ports)
+            {
+                const PortModel& port = port_it.second;
+                stream << port_it.first << port.type_name << qint32( port.direction )
+                       << port.description << port.default_value;
+            }
+        }
+
+        stream << quint32( content.trees.size() );
+        for (const auto& tree: content.trees)
+        {
+            // the parents are before their children
+            std::vector<qint32> parents( tree.nodesCount(), -1 );
+            for (const auto& abs_node: tree.nodes())
+            {
+                for (int child: abs_node.children_index)
+                {
+                    parents[size_t(child)] = abs_node.index;
+                }
+            }
+            stream << quint32( tree.nodesCount() );
+            for (const auto& abs_node: tree.nodes())
+            {
+                stream << model_index.value( abs_node.model.registration_ID )
+                       << parents[size_t(abs_node.index)] << abs_node.instance_name
+                       << float( abs_node.pos.x() ) << float( abs_node.pos.y() );
+                stream << quint32( abs_node.ports_mapping.size() );
+                for (const auto& port_it: abs_node.ports_mapping)
+                {
+                    stream << port_it.first << port_it.second;
+                }
+            }
+        }
+    }
+    return qCompress( data );
+}
+
+bool DecodeClipboard(const QByteArray& compressed, ClipboardContent& content)
+{
+    content = ClipboardContent();
+    const QByteArray data = qUncompress( compressed );
+    QDataStream stream( data );
+
+    quint32 magic = 0;
+    quint16 version = 0;
+    stream >> magic >> version;
+    if( magic != CLIPBOARD_MAGIC || version != CLIPBOARD_VERSION )
+    {
+        return false;
+    }
+
+    quint32 models_count = 0;
+    stream >> models_count;
+    std::vector<const NodeModel*> models;
+    for (quint32 m = 0; m < models_count && stream.status() == QDataStream::Ok; m++)
+    {
+        NodeModel model;
+        qint32 type = 0;
+        quint32 ports_count = 0;
+        stream >> model.registration_ID >> type >> ports_count;
+        model.type = static_cast<NodeType>( type );
+        for (quint32 p = 0; p < ports_count && stream.status() == QDataStream::Ok; p++)
+        {
+            QString name;
+            PortModel port;
+            qint32 direction = 0;
+            stream >> name >> port.type_name >> direction >> port.description >> port.default_value;
+            port.direction = static_cast<PortDirection>( direction );
+            model.ports.insert( { name, port } );
+        }
+        auto it = content.models.insert( { model.registration_ID, model } ).first;
+        models.push_back( &it->second );
+    }
+
+    quint32 trees_count = 0;
+    stream >> trees_count;
+    for (quint32 t = 0; t < trees_count && stream.status() == QDataStream::Ok; t++)
+    {
+        AbsBehaviorTree tree;
+        quint32 nodes_count = 0;
+        stream >> nodes_count;
+        for (quint32 n = 0; n < nodes_count; n++)
+        {
+            quint32 model = 0;
+            qint32 parent = -1;
+            float x = 0, y = 0;
+            quint32 ports_count = 0;
+            AbstractTreeNode abs_node;
+            stream >> model >> parent >> abs_node.instance_name >> x >> y >> ports_count;
+            for (quint32 p = 0; p < ports_count && stream.status() == QDataStream::Ok; p++)
+            {
+                QString name, value;
+                stream >> name >> value;
+                abs_node.ports_mapping[name] = value;
+            }
+            // only the first node has no parent
+            if( stream.status() != QDataStream::Ok || model >= models.size() ||
+                parent >= qint32( n ) || ( parent < 0 ) != ( n == 0 ) )
+            {
+                content = ClipboardContent();
+                return false;
+            }
+            abs_node.model = *models[model];
+            abs_node.pos = QPointF( x, y );
+            tree.addNode( parent < 0 ? nullptr : tree.node( size_t(parent) ), std::move(abs_node) );
+        }
+        if( tree.nodesCount() > 0 )
+        {
+            content.trees.push_back( std::move(tree) );
+        }
+    }
+    if( stream.status() != QDataStream::Ok )
+    {
+        content = ClipboardContent();
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,38 @@
+#ifndef TREE_CLIPBOARD_H
+#define TREE_CLIPBOARD_H
+
+#include <QByteArray>
+#include <vector>
+
+#include "bt_editor_base.h"
+
+class EditorFlowScene;
+
+// The nodes copied with Ctrl+C, as a forest: a tree for each node whose
+// parent is not copied. The positions are relative to the top left corner
+// of the copied nodes.
+struct ClipboardContent
+{
+    std::vector<AbsBehaviorTree> trees;
+
+    // the models of the nodes, for the instances of Groot that do not know them
+    NodeModels models;
+
+    bool empty() const { return trees.empty(); }
+};
+
+// the MIME type of EncodeClipboard()
+extern const char* NODES_MIME_TYPE;
+
+// The children of the expanded SubTrees are copies of another tree: the
+// SubTree is copied collapsed. The Root is never copied.
+ClipboardContent CopyNodes(const EditorFlowScene& scene,
+                           const std::vector<QtNodes::Node*>& nodes);
+
+// Compressed, each model and its ports are written once.
+QByteArray EncodeClipboard(const ClipboardContent& content);
+
+// false if "data" is not a valid EncodeClipboard()
+bool DecodeClipboard(const QByteArray& data, ClipboardContent& content);
+
+#endif // TREE_CLIPBOARD_H
@@ -0,0 +1,75 @@
+#include "tree_fetcher.h"
+#include <QElapsedTimer>
+
+TreeFetcher::TreeFetcher(zmq::context_t &context,
+                         const std::string &address,
+                         int request_id,
+                         int timeout_ms,
+                         QObject *parent):
+    QThread(parent),
+    _context(context),
+    _address(address),
+    _request_id(request_id),
+    _timeout_ms(timeout_ms),
+    _cancelled(false)
+{
+}
+
+TreeFetcher::~TreeFetcher()
+{
+    cancel();
+    wait();
+}
+
+void TreeFetcher::cancel()
+{
+    _cancelled.store(true);
+}
+
+void TreeFetcher::run()
+{
+    // the recv is split in small steps, to report the progress and to
+    // react quickly to cancel()
+    const int step_ms = 50;
+
+    try{
+        zmq::socket_t zmq_client( _context, ZMQ_REQ );
+
+        int linger_ms = 0;
+        zmq_client.setsockopt(ZMQ_LINGER, &linger_ms, sizeof(int) );
+        zmq_client.setsockopt(ZMQ_RCVTIMEO, &step_ms, sizeof(int) );
+        zmq_client.connect( _address.c_str() );
+
+        zmq::message_t request(0);
+        zmq_client.send(request);
+
+        QElapsedTimer timer;
+        timer.start();
+
+        zmq::message_t reply;
+        while( !_cancelled.load() )
+        {
+            if( zmq_client.recv(&reply) )
+            {
+                QByteArray buffer( reinterpret_cast<const char*>(reply.data()),
+                                   int(reply.size()) );
+                emit treeReceived( _request_id, buffer );
+                return;
+            }
+            const int elapsed_ms = int(timer.elapsed());
+            if( elapsed_ms >= _timeout_ms )
+            {
+                emit fetchFailed( _request_id, tr("No reply from [%1]").arg(_address.c_str()) );
+                return;
+            }
+            emit progress( _request_id, elapsed_ms );
+        }
+    }
+    catch( zmq::error_t& err)
+    {
+        if( !_cancelled.load() )
+        {
+            emit fetchFailed( _request_id, err.what() );
+        }
+    }
+}
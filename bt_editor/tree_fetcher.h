@@ -0,0 +1,50 @@
+#ifndef TREE_FETCHER_H
+#define TREE_FETCHER_H
+
+#include <QThread>
+#include <QByteArray>
+#include <atomic>
+#include <zmq.hpp>
+
+// Requests the serialized tree to the BT server without blocking the GUI.
+// Exactly one of treeReceived() or fetchFailed() is emitted, unless the
+// request is cancelled.
+class TreeFetcher : public QThread
+{
+    Q_OBJECT
+
+public:
+    TreeFetcher(zmq::context_t& context,
+                const std::string& address,
+                int request_id,
+                int timeout_ms,
+                QObject* parent = nullptr);
+
+    ~TreeFetcher() override;
+
+    void cancel();
+
+    int requestId() const { return _request_id; }
+
+    int timeout() const { return _timeout_ms; }
+
+signals:
+
+    void progress(int request_id, int elapsed_ms);
+
+    void treeReceived(int request_id, QByteArray buffer);
+
+    void fetchFailed(int request_id, QString error);
+
+protected:
+    void run() override;
+
+private:
+    zmq::context_t& _context;
+    std::string _address;
+    int _request_id;
+    int _timeout_ms;
+    std::atomic<bool> _cancelled;
+};
+
+#endif // TREE_FETCHER_H
@@ -0,0 +1,237 @@
+#include "tree_files.h"
+#include "XML_utilities.hpp"
+#include "model_import.h"
+#include "log_format.h"
+#include "utils.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QTextStream>
+#include <QXmlStreamWriter>
+#include <QtEndian>
+
+namespace
+{
+
+QByteArray readFile(const QString& path)
+{
+    QFile file( path );
+    if( !file.open( QIODevice::ReadOnly ) )
+    {
+        throw std::runtime_error( QString("%1: %2").arg( path, file.errorString() ).toStdString() );
+    }
+    return file.readAll();
+}
+
+// as the editor: the builtin models first, then the palette, then the file
+NodeModels mergeModels(const NodeModels& palette, const NodeModels& file_models)
+{
+    NodeModels models = BuiltinNodeModels();
+    for (const auto& it: palette)
+    {
+        models.insert( it );
+    }
+    for (const auto& it: file_models)
+    {
+        models.insert( it );
+    }
+    return models;
+}
+
+// The node "index" of a tree read from a log, and its children, appended to
+// "to". The children of a SubTree become the tree of its ID, once.
+void splitSubtrees(const AbsBehaviorTree& from, int index,
+                   AbsBehaviorTree& to, AbstractTreeNode* parent,
+                   std::map<QString, AbsBehaviorTree>& trees)
+{
+    const AbstractTreeNode& node = *from.node( index );
+    AbstractTreeNode copy;
+    copy.model = node.model;
+    copy.instance_name = node.instance_name;
+    copy.ports_mapping = node.ports_mapping;
+    AbstractTreeNode* added = to.addNode( parent, std::move(copy) );
+
+    if( node.model.type == NodeType::SUBTREE )
+    {
+        const QString& ID = node.model.registration_ID;
+        if( !node.children_index.empty() && trees.count( ID ) == 0 )
+        {
+            // added before its children: a recursive subtree stops here
+            AbsBehaviorTree& subtree = trees[ID];
+            splitSubtrees( from, node.children_index.front(), subtree, nullptr, trees );
+        }
+        return;
+    }
+    for (int child_index: node.children_index)
+    {
+        splitSubtrees( from, child_index, to, added, trees );
+    }
+}
+
+TreeFileContent readXMLFile(const QString& path, const NodeModels& palette)
+{
+    QByteArray data = readFile( path );
+    QTextStream in( &data );
+    XMLDocumentContent document = ReadXMLProject( in.readAll(), QFileInfo( path ).absolutePath() );
+
+    const NodeModels models = mergeModels( palette, document.models );
+    TreeFileContent content;
+    for (const auto& it: document.models)
+    {
+        content.models.insert( *models.find( it.first ) );
+    }
+
+    content.main_tree = document.main_tree;
+    for (auto& xml_tree: document.trees)
+    {
+        ResolveTreeModels( xml_tree, models );
+        if( xml_tree.has_ID && content.main_tree.isEmpty() )
+        {
+            content.main_tree = xml_tree.name;
+        }
+        // a tree defined twice replaces the first one, as in a tab
+        content.trees[ xml_tree.name ] = std::move( xml_tree.tree );
+    }
+    return content;
+}
+
+TreeFileContent readLogFile(const QString& path, const NodeModels& palette)
+{
+    const QByteArray data = readFile( path );
+    size_t tree_offset = 0;
+    size_t tree_size = 0;
+    if( !logTreeLocation( data.constData(), size_t( data.size() ), tree_offset, tree_size ) )
+    {
+        throw std::runtime_error( "the log is corrupted or truncated" );
+    }
+    const uint8_t* tree_buffer = reinterpret_cast<const uint8_t*>( data.constData() + tree_offset );
+    flatbuffers::Verifier verifier( tree_buffer, tree_size );
+    if( !Serialization::VerifyBehaviorTreeBuffer( verifier ) )
+    {
+        throw std::runtime_error( "the tree of the log is not valid" );
+    }
+    const AbsBehaviorTree log_tree =
+            BuildTreeFromFlatbuffers( Serialization::GetBehaviorTree( tree_buffer ) ).first;
+
+    TreeFileContent content;
+    content.main_tree = QFileInfo( path ).completeBaseName();
+    if( log_tree.nodesCount() > 1 )
+    {
+        // the node 0 is the Root added by BuildTreeFromFlatbuffers()
+        AbsBehaviorTree& main_tree = content.trees[ content.main_tree ];
+        splitSubtrees( log_tree, log_tree.rootNode()->children_index.front(),
+                       main_tree, nullptr, content.trees );
+    }
+
+    NodeModels log_models;
+    for (const auto& node: log_tree.nodes())
+    {
+        if( BuiltinNodeModels().count( node.model.registration_ID ) == 0 )
+        {
+            log_models.insert( { node.model.registration_ID, node.model } );
+        }
+    }
+    const NodeModels models = mergeModels( palette, log_models );
+    for (const auto& it: log_models)
+    {
+        content.models.insert( *models.find( it.first ) );
+    }
+    for (auto& tree_it: content.trees)
+    {
+        for (auto& node: tree_it.second.nodes())
+        {
+            node.model = models.at( node.model.registration_ID );
+        }
+    }
+    return content;
+}
+
+}
+
+size_t TreeFileContent::nodesCount() const
+{
+    size_t count = 0;
+    for (const auto& it: trees)
+    {
+        count += it.second.nodesCount();
+    }
+    return count;
+}
+
+TreeFileContent ReadTreeFile(const QString &path, const NodeModels &palette)
+{
+    try {
+        if( QFileInfo( path ).suffix() == "fbl" )
+        {
+            return readLogFile( path, palette );
+        }
+        return readXMLFile( path, palette );
+    }
+    catch( std::exception& err )
+    {
+        throw std::runtime_error( QString("%1: %2").arg( path ).arg( err.what() ).toStdString() );
+    }
+}
+
+NodeModels ReadPaletteFile(const QString &path)
+{
+    QByteArray data = readFile( path );
+    try {
+        if( QFileInfo( path ).completeSuffix().endsWith( "skills.json" ) )
+        {
+            return ReadSkillsModels( data );
+        }
+        QTextStream in( &data );
+        return ReadTreeNodesModel( in.readAll() );
+    }
+    catch( std::exception& err )
+    {
+        throw std::runtime_error( QString("%1: %2").arg( path ).arg( err.what() ).toStdString() );
+    }
+}
+
+QByteArray WriteTreeFileXML(const TreeFileContent &content)
+{
+    std::map<QString, const AbsBehaviorTree*> trees;
+    for (const auto& it: content.trees)
+    {
+        trees.insert( { it.first, &it.second } );
+    }
+    // the main tree of a single tree is the one saved by the editor
+    QString main_tree = content.main_tree;
+    if( content.trees.size() == 1 )
+    {
+        main_tree = content.trees.begin()->first;
+    }
+
+    QByteArray document;
+    QXmlStreamWriter stream( &document );
+    WriteXMLDocument( stream, main_tree, trees, content.models );
+
+    // as MainWindow::on_actionSave_triggered()
+    return QByteArray( "<?xml version=\"1.0\"?>" ) + document;
+}
+
+QByteArray WriteTreeFileLog(const TreeFileContent &content)
+{
+    auto main_it = content.trees.find( content.main_tree );
+    if( main_it == content.trees.end() && content.trees.size() == 1 )
+    {
+        main_it = content.trees.begin();
+    }
+    if( main_it == content.trees.end() )
+    {
+        throw std::runtime_error( "the main tree is not defined" );
+    }
+    std::map<QString, const AbsBehaviorTree*> subtrees;
+    for (const auto& it: content.trees)
+    {
+        subtrees.insert( { it.first, &it.second } );
+    }
+    const std::vector<uint8_t> tree_buffer = BuildFlatbuffersFromTree( main_it->second, subtrees );
+
+    // version 1: u32 tree_size | tree flatbuffer, see log_format.h
+    QByteArray output( 4, '\0' );
+    qToLittleEndian<quint32>( quint32( tree_buffer.size() ), reinterpret_cast<uchar*>( output.data() ) );
+    output.append( reinterpret_cast<const char*>( tree_buffer.data() ), int( tree_buffer.size() ) );
+    return output;
+}
@@ -0,0 +1,39 @@
+#ifndef TREE_FILES_H
+#define TREE_FILES_H
+
+#include <QByteArray>
+#include <QString>
+#include <map>
+#include "bt_editor_base.h"
+
+// Reading, checking and writing the tree files as the editor does, without
+// any widget: for groot_cli, and whatever has no display.
+
+struct TreeFileContent
+{
+    QString main_tree;
+    // the models of the file, as written back; not the builtin ones
+    NodeModels models;
+    // by name; each node has its model
+    std::map<QString, AbsBehaviorTree> trees;
+
+    size_t nodesCount() const;
+};
+
+// A .xml file with its <include>, or the tree of a .fbl log, whose expanded
+// subtrees become trees again. Every node must have a model in the file,
+// in "palette" or among the builtin ones. Throws std::runtime_error.
+TreeFileContent ReadTreeFile(const QString& path, const NodeModels& palette = NodeModels());
+
+// The models of a palette file: the <TreeNodesModel> of an XML, or a
+// .skills.json catalogue. Throws std::runtime_error.
+NodeModels ReadPaletteFile(const QString& path);
+
+// The canonical XML saved by Groot, with its declaration.
+QByteArray WriteTreeFileXML(const TreeFileContent& content);
+
+// A version 1 .fbl log without transitions: its main tree, with the
+// subtrees expanded. Throws std::runtime_error.
+QByteArray WriteTreeFileLog(const TreeFileContent& content);
+
+#endif // TREE_FILES_H
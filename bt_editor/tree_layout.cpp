@@ -0,0 +1,423 @@
+#include "tree_layout.h"
+#include <nodes/Trace>
+#include <algorithm>
+#include <list>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QHash>
+
+using QtNodes::PortLayout;
+
+namespace
+{
+
+const qreal LEVEL_SPACING = 80;
+const qreal NODE_SPACING  = 40;
+
+const size_t LAYOUT_CACHE_SIZE = 64;
+
+class TidyTree
+{
+public:
+    explicit TidyTree(const LayoutSnapshot& tree):
+        _tree(tree)
+    {
+        const size_t N = tree.sizes.size();
+        _parent.assign( N, -1 );
+        _number.assign( N, 0 );
+        _prelim.assign( N, 0 );
+        _mod.assign( N, 0 );
+        _shift.assign( N, 0 );
+        _change.assign( N, 0 );
+        _thread.assign( N, -1 );
+        _ancestor.resize( N );
+        _center.assign( N, 0 );
+
+        for(size_t i=0; i<N; i++)
+        {
+            _ancestor[i] = int(i);
+            const auto& children = tree.children[i];
+            for(size_t c=0; c<children.size(); c++)
+            {
+                _parent[ children[c] ] = int(i);
+                _number[ children[c] ] = int(c);
+            }
+        }
+    }
+
+    // center of each node along the breadth of the tree
+    const std::vector<qreal>& run(int root)
+    {
+        firstWalk( root );
+        secondWalk( root, -_prelim[root] );
+        return _center;
+    }
+
+private:
+    const LayoutSnapshot& _tree;
+
+    std::vector<int> _parent;
+    std::vector<int> _number;   // index among the siblings
+    std::vector<qreal> _prelim;
+    std::vector<qreal> _mod;
+    std::vector<qreal> _shift;
+    std::vector<qreal> _change;
+    std::vector<int> _thread;
+    std::vector<int> _ancestor;
+    std::vector<qreal> _center;
+
+    const std::vector<int>& children(int v) const
+    {
+        return _tree.children[v];
+    }
+
+    qreal breadth(int v) const
+    {
+        const QSizeF& size = _tree.sizes[v];
+        return (_tree.layout == PortLayout::Vertical) ? size.width() : size.height();
+    }
+
+    // minimum distance between the centers of two neighbours
+    qreal separation(int left, int right) const
+    {
+        return (breadth(left) + breadth(right)) * 0.5 + NODE_SPACING;
+    }
+
+    int leftSibling(int v) const
+    {
+        return (_number[v] > 0) ? children( _parent[v] )[ _number[v] - 1 ] : -1;
+    }
+
+    int leftmostSibling(int v) const
+    {
+        return (_parent[v] >= 0) ? children( _parent[v] ).front() : v;
+    }
+
+    int nextLeft(int v) const
+    {
+        return children(v).empty() ? _thread[v] : children(v).front();
+    }
+
+    int nextRight(int v) const
+    {
+        return children(v).empty() ? _thread[v] : children(v).back();
+    }
+
+    void firstWalk(int v)
+    {
+        const int w = leftSibling(v);
+        if( children(v).empty() )
+        {
+            _prelim[v] = (w >= 0) ? _prelim[w] + separation(w, v) : 0;
+            return;
+        }
+
+        int default_ancestor = children(v).front();
+        for(int child: children(v))
+        {
+            firstWalk( child );
+            apportion( child, default_ancestor );
+        }
+        executeShifts( v );
+
+        const qreal midpoint = ( _prelim[ children(v).front() ] +
+                                 _prelim[ children(v).back() ] ) * 0.5;
+        if( w >= 0 )
+        {
+            _prelim[v] = _prelim[w] + separation(w, v);
+            _mod[v] = _prelim[v] - midpoint;
+        }
+        else{
+            _prelim[v] = midpoint;
+        }
+    }
+
+    // pushes the subtree of v to the right of its left siblings
+    void apportion(int v, int& default_ancestor)
+    {
+        const int w = leftSibling(v);
+        if( w < 0 )
+        {
+            return;
+        }
+        int vir = v;
+        int vor = v;
+        int vil = w;
+        int vol = leftmostSibling(v);
+        qreal sir = _mod[vir];
+        qreal sor = _mod[vor];
+        qreal sil = _mod[vil];
+        qreal sol = _mod[vol];
+
+        while( nextRight(vil) >= 0 && nextLeft(vir) >= 0 )
+        {
+            vil = nextRight(vil);
+            vir = nextLeft(vir);
+            vol = nextLeft(vol);
+            vor = nextRight(vor);
+            _ancestor[vor] = v;
+
+            const qreal shift = (_prelim[vil] + sil) - (_prelim[vir] + sir) + separation(vil, vir);
+            if( shift > 0 )
+            {
+                const int a = ( _parent[ _ancestor[vil] ] == _parent[v] ) ? _ancestor[vil] : default_ancestor;
+                moveSubtree( a, v, shift );
+                sir += shift;
+                sor += shift;
+            }
+            sil += _mod[vil];
+            sir += _mod[vir];
+            sol += _mod[vol];
+            sor += _mod[vor];
+        }
+
+        if( nextRight(vil) >= 0 && nextRight(vor) < 0 )
+        {
+            _thread[vor] = nextRight(vil);
+            _mod[vor] += sil - sor;
+        }
+        if( nextLeft(vir) >= 0 && nextLeft(vol) < 0 )
+        {
+            _thread[vol] = nextLeft(vir);
+            _mod[vol] += sir - sol;
+            default_ancestor = v;
+        }
+    }
+
+    void moveSubtree(int wl, int wr, qreal shift)
+    {
+        const qreal subtrees = _number[wr] - _number[wl];
+        _change[wr] -= shift / subtrees;
+        _shift[wr]  += shift;
+        _change[wl] += shift / subtrees;
+        _prelim[wr] += shift;
+        _mod[wr]    += shift;
+    }
+
+    void executeShifts(int v)
+    {
+        qreal shift = 0;
+        qreal change = 0;
+        const auto& c = children(v);
+        for(auto it = c.rbegin(); it != c.rend(); ++it)
+        {
+            const int w = *it;
+            _prelim[w] += shift;
+            _mod[w] += shift;
+            change += _change[w];
+            shift += _shift[w] + change;
+        }
+    }
+
+    void secondWalk(int v, qreal m)
+    {
+        _center[v] = _prelim[v] + m;
+        for(int child: children(v))
+        {
+            secondWalk( child, m + _mod[v] );
+        }
+    }
+};
+
+}
+
+LayoutSnapshot LayoutSnapshot::fromTree(const AbsBehaviorTree &tree, QtNodes::PortLayout layout)
+{
+    LayoutSnapshot snapshot;
+    snapshot.layout = layout;
+    snapshot.root = tree.nodesCount() > 0 ? tree.rootNode()->index : -1;
+    snapshot.sizes.reserve( tree.nodesCount() );
+    snapshot.children.reserve( tree.nodesCount() );
+    for(const auto& node: tree.nodes())
+    {
+        snapshot.sizes.push_back( node.size );
+        snapshot.children.push_back( node.children_index );
+    }
+    return snapshot;
+}
+
+uint LayoutSnapshot::hash() const
+{
+    uint h = qHash( int(layout) ) ^ qHash( root );
+    for(size_t i=0; i<sizes.size(); i++)
+    {
+        h = 31*h + qHash( sizes[i].width() ) + 7*qHash( sizes[i].height() );
+        for(int child: children[i])
+        {
+            h = 31*h + qHash( child );
+        }
+    }
+    return h;
+}
+
+bool LayoutSnapshot::operator ==(const LayoutSnapshot &other) const
+{
+    return layout == other.layout && root == other.root &&
+           sizes == other.sizes && children == other.children;
+}
+
+std::vector<QPointF> ComputeTreeLayout(const LayoutSnapshot &tree)
+{
+    NODE_TRACE_SCOPE("ComputeTreeLayout");
+
+    const size_t N = tree.sizes.size();
+    std::vector<QPointF> pos( N );
+    if( N == 0 || tree.root < 0 )
+    {
+        return pos;
+    }
+    const int root = tree.root;
+    const PortLayout layout = tree.layout;
+    const std::vector<qreal> center = TidyTree( tree ).run( root );
+
+    // depth of each node, and the largest node of each level
+    std::vector<int> level( N, 0 );
+    std::vector<qreal> level_depth( 1, 0 );
+    std::vector<int> stack = { root };
+    while( !stack.empty() )
+    {
+        const int v = stack.back();
+        stack.pop_back();
+        const QSizeF& size = tree.sizes[v];
+        const qreal depth = (layout == PortLayout::Vertical) ? size.height() : size.width();
+        if( level_depth.size() <= size_t(level[v]) )
+        {
+            level_depth.push_back( 0 );
+        }
+        level_depth[ level[v] ] = std::max( level_depth[ level[v] ], depth );
+
+        for(int child: tree.children[v])
+        {
+            level[child] = level[v] + 1;
+            stack.push_back( child );
+        }
+    }
+
+    // the root is centered at the origin, the other levels start after it
+    std::vector<qreal> level_offset( level_depth.size(), 0 );
+    const QSizeF& root_size = tree.sizes[root];
+    qreal offset = (layout == PortLayout::Vertical) ? root_size.height() : root_size.width();
+    for(size_t i=1; i<level_depth.size(); i++)
+    {
+        offset += LEVEL_SPACING;
+        level_offset[i] = offset;
+        offset += level_depth[i];
+    }
+
+    for(size_t v=0; v<N; v++)
+    {
+        const QSizeF& size = tree.sizes[v];
+        if( layout == PortLayout::Vertical )
+        {
+            const qreal y = (int(v) == root) ? -size.height()*0.5 : level_offset[ level[v] ];
+            pos[v] = QPointF( center[v] - size.width()*0.5, y );
+        }
+        else{
+            const qreal x = (int(v) == root) ? -size.width()*0.5 : level_offset[ level[v] ];
+            pos[v] = QPointF( x, center[v] - size.height()*0.5 );
+        }
+    }
+    return pos;
+}
+
+namespace
+{
+
+struct CacheEntry
+{
+    uint hash;
+    CachedLayout layout;
+};
+
+QMutex layout_cache_mutex;
+// most recently used first
+std::list<CacheEntry> layout_cache;
+
+// with the mutex locked
+void insertLayout(uint hash, CachedLayout layout)
+{
+    for(auto it = layout_cache.begin(); it != layout_cache.end(); ++it)
+    {
+        if( it->hash == hash && it->layout.snapshot == layout.snapshot )
+        {
+            layout_cache.erase( it );
+            break;
+        }
+    }
+    layout_cache.push_front( { hash, std::move(layout) } );
+    if( layout_cache.size() > LAYOUT_CACHE_SIZE )
+    {
+        layout_cache.pop_back();
+    }
+}
+
+}
+
+std::vector<QPointF> CachedTreeLayout(const LayoutSnapshot &tree)
+{
+    const uint hash = tree.hash();
+    {
+        QMutexLocker lock( &layout_cache_mutex );
+        for(auto it = layout_cache.begin(); it != layout_cache.end(); ++it)
+        {
+            if( it->hash == hash && it->layout.snapshot == tree )
+            {
+                layout_cache.splice( layout_cache.begin(), layout_cache, it );
+                return layout_cache.front().layout.positions;
+            }
+        }
+    }
+
+    std::vector<QPointF> positions = ComputeTreeLayout( tree );
+
+    QMutexLocker lock( &layout_cache_mutex );
+    insertLayout( hash, { tree, positions } );
+    return positions;
+}
+
+std::vector<CachedLayout> CachedTreeLayouts()
+{
+    QMutexLocker lock( &layout_cache_mutex );
+    std::vector<CachedLayout> layouts;
+    layouts.reserve( layout_cache.size() );
+    for(const auto& entry: layout_cache)
+    {
+        layouts.push_back( entry.layout );
+    }
+    return layouts;
+}
+
+void AddCachedTreeLayout(CachedLayout layout)
+{
+    if( layout.positions.size() != layout.snapshot.sizes.size() )
+    {
+        return;
+    }
+    const uint hash = layout.snapshot.hash();
+    QMutexLocker lock( &layout_cache_mutex );
+    insertLayout( hash, std::move(layout) );
+}
+
+void ComputeTreeLayout(AbsBehaviorTree &tree, QtNodes::PortLayout layout)
+{
+    if( tree.nodesCount() == 0 )
+    {
+        return;
+    }
+    const std::vector<QPointF> pos = CachedTreeLayout( LayoutSnapshot::fromTree( tree, layout ) );
+    for(auto& node: tree.nodes())
+    {
+        node.pos = pos[ node.index ];
+    }
+}
+
+LayoutWorker::LayoutWorker(LayoutSnapshot snapshot, QObject *parent):
+    QThread(parent),
+    _snapshot( std::move(snapshot) )
+{
+}
+
+void LayoutWorker::run()
+{
+    _positions = CachedTreeLayout( _snapshot );
+}
@@ -0,0 +1,72 @@
+#ifndef TREE_LAYOUT_H
+#define TREE_LAYOUT_H
+
+#include <QThread>
+#include <vector>
+#include <nodes/NodeStyle>
+#include "bt_editor_base.h"
+
+// What the layout depends on: a copy that can be used on another thread.
+struct LayoutSnapshot
+{
+    QtNodes::PortLayout layout = QtNodes::PortLayout::Vertical;
+    int root = -1;
+    // by node index, as in AbsBehaviorTree
+    std::vector<QSizeF> sizes;
+    std::vector<std::vector<int>> children;
+
+    static LayoutSnapshot fromTree(const AbsBehaviorTree& tree, QtNodes::PortLayout layout);
+
+    uint hash() const;
+
+    bool operator ==(const LayoutSnapshot& other) const;
+};
+
+// Tidy tree layout (Walker's algorithm, in the linear time version of
+// Buchheim, Juenger and Leipert): every parent is centered on its children,
+// the subtrees are as close as their contours allow and identical subtrees
+// look the same. Breadth follows the size of each node, depth the largest
+// node of each level.
+//
+// Returns the top left corner of each node; the root is centered at (0,0).
+std::vector<QPointF> ComputeTreeLayout(const LayoutSnapshot& tree);
+
+// Same result, kept for the last few trees laid out (switching PortLayout
+// back and forth is free). Thread safe.
+std::vector<QPointF> CachedTreeLayout(const LayoutSnapshot& tree);
+
+struct CachedLayout
+{
+    LayoutSnapshot snapshot;
+    std::vector<QPointF> positions;
+};
+
+// What CachedTreeLayout() keeps, most recently used first.
+std::vector<CachedLayout> CachedTreeLayouts();
+
+// A layout computed before, as by a previous session.
+void AddCachedTreeLayout(CachedLayout layout);
+
+// Changes only the "pos" of the nodes.
+void ComputeTreeLayout(AbsBehaviorTree& tree, QtNodes::PortLayout layout);
+
+// Computes the layout of a large tree without blocking the GUI; the result
+// is available when the thread has finished.
+class LayoutWorker : public QThread
+{
+    Q_OBJECT
+
+public:
+    LayoutWorker(LayoutSnapshot snapshot, QObject* parent = nullptr);
+
+    const std::vector<QPointF>& positions() const { return _positions; }
+
+protected:
+    void run() override;
+
+private:
+    LayoutSnapshot _snapshot;
+    std::vector<QPointF> _positions;
+};
+
+#endif // TREE_LAYOUT_H
@@ -0,0 +1,129 @@
+#include "tree_topology.h"
+#include <algorithm>
+
+using QtNodes::Node;
+using QtNodes::PortType;
+
+QtNodes::Node *TreeTopology::root() const
+{
+    if( _orphans.size() != 1 )
+    {
+        return nullptr;
+    }
+    return *_orphans.begin();
+}
+
+QtNodes::Node *TreeTopology::parent(const QtNodes::Node &node) const
+{
+    auto it = _entries.find( &node );
+    return ( it == _entries.end() ) ? nullptr : it->second.parent;
+}
+
+const std::vector<QtNodes::Node *> &TreeTopology::children(const QtNodes::Node &node) const
+{
+    static const std::vector<QtNodes::Node*> no_children;
+    auto it = _entries.find( &node );
+    return ( it == _entries.end() ) ? no_children : it->second.children;
+}
+
+void TreeTopology::nodeCreated(QtNodes::Node &node)
+{
+    _entries[ &node ];
+    refresh( node );
+}
+
+void TreeTopology::nodeDeleted(QtNodes::Node &node)
+{
+    auto it = _entries.find( &node );
+    if( it == _entries.end() )
+    {
+        return;
+    }
+    // the connections are removed after the node; detach them now
+    if( Node* parent = it->second.parent )
+    {
+        auto& siblings = _entries[parent].children;
+        siblings.erase( std::remove( siblings.begin(), siblings.end(), &node ),
+                        siblings.end() );
+    }
+    for(Node* child: it->second.children)
+    {
+        _entries[child].parent = nullptr;
+    }
+    _orphans.erase( &node );
+    _incomplete.erase( &node );
+    _entries.erase( it );
+}
+
+void TreeTopology::connectionsChanged(QtNodes::Node &node)
+{
+    if( _entries.count( &node ) )
+    {
+        refresh( node );
+    }
+}
+
+void TreeTopology::rebuild(const std::vector<QtNodes::Node *> &nodes)
+{
+    for(Node* node: nodes)
+    {
+        _entries[ node ];
+    }
+    for(Node* node: nodes)
+    {
+        refresh( *node );
+    }
+}
+
+void TreeTopology::refresh(QtNodes::Node &node)
+{
+    Entry& entry = _entries[ &node ];
+    Node* parent = nullptr;
+    bool has_input = false;
+
+    if( node.nodeDataModel()->nPorts( PortType::In ) > 0 )
+    {
+        const auto& conn_in = node.nodeState().connections( PortType::In, 0 );
+        has_input = !conn_in.empty();
+        if( has_input )
+        {
+            parent = conn_in.begin()->second->getNode( PortType::Out );
+        }
+    }
+
+    if( has_input ) _orphans.erase( &node );
+    else            _orphans.insert( &node );
+
+    bool has_output = false;
+    const auto& out_entries = node.nodeState().getEntries( PortType::Out );
+    if( !out_entries.empty() )
+    {
+        has_output = !out_entries.front().empty();
+    }
+
+    const auto model = node.nodeDataModel();
+    if( ( model->nPorts( PortType::In ) == 1 && !has_input ) ||
+        ( model->nPorts( PortType::Out ) == 1 && !has_output ) )
+    {
+        _incomplete.insert( &node );
+    }
+    else{
+        _incomplete.erase( &node );
+    }
+
+    if( parent == entry.parent )
+    {
+        return;
+    }
+    if( entry.parent )
+    {
+        auto& siblings = _entries[entry.parent].children;
+        siblings.erase( std::remove( siblings.begin(), siblings.end(), &node ),
+                        siblings.end() );
+    }
+    entry.parent = parent;
+    if( parent && _entries.count( parent ) )
+    {
+        _entries[parent].children.push_back( &node );
+    }
+}
@@ -0,0 +1,54 @@
+#ifndef TREE_TOPOLOGY_H
+#define TREE_TOPOLOGY_H
+
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <nodes/Node>
+
+// The parent, the children and the root of the nodes of a scene, updated
+// by the scene when a node or a connection is created or removed, instead
+// of searching all the nodes and the connections at each query.
+class TreeTopology
+{
+public:
+    // the only node without parent; nullptr if there are none or many
+    QtNodes::Node* root() const;
+
+    QtNodes::Node* parent(const QtNodes::Node& node) const;
+
+    // in no particular order; see getChildren() to sort them by position
+    const std::vector<QtNodes::Node*>& children(const QtNodes::Node& node) const;
+
+    // every port of every node is connected, see GraphicContainer::containsValidTree()
+    bool isComplete() const { return _incomplete.empty(); }
+
+    void nodeCreated(QtNodes::Node& node);
+
+    void nodeDeleted(QtNodes::Node& node);
+
+    // a connection of the node was created, removed or detached, or the
+    // number of its ports changed (an expanded SubTree)
+    void connectionsChanged(QtNodes::Node& node);
+
+    // after the nodes were created without notification
+    void rebuild(const std::vector<QtNodes::Node*>& nodes);
+
+private:
+    struct Entry
+    {
+        QtNodes::Node* parent = nullptr;
+        std::vector<QtNodes::Node*> children;
+    };
+
+    std::unordered_map<const QtNodes::Node*, Entry> _entries;
+    // the nodes without input, as in findRoot()
+    std::unordered_set<QtNodes::Node*> _orphans;
+    // the nodes with a port not connected
+    std::unordered_set<const QtNodes::Node*> _incomplete;
+
+    void refresh(QtNodes::Node& node);
+};
+
+#endif // TREE_TOPOLOGY_H
@@ -0,0 +1,149 @@
+#ifndef TRIGRAM_INDEX_H
+#define TRIGRAM_INDEX_H
+
+#include <QString>
+#include <QHash>
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Substring search over the text of many keys, ignoring the case. Every
+// text is split in trigrams: a query looks up the keys that contain all its
+// trigrams, then checks only those. Queries shorter than a trigram check
+// all the keys, which is still a comparison per key.
+//
+// "Key" must be usable in a std::unordered_map.
+template <typename Key, typename Hash = std::hash<Key>>
+class TrigramIndex
+{
+public:
+    void update(const Key& key, const QString& text)
+    {
+        QString lower = text.toLower();
+        auto it = _entries.find( key );
+        if( it != _entries.end() )
+        {
+            if( it->second == lower )
+            {
+                return;
+            }
+            remove( key );
+        }
+        for (quint64 t: trigramsOf( lower ))
+        {
+            _trigrams[t].insert( key );
+        }
+        _entries.insert( { key, std::move(lower) } );
+    }
+
+    void remove(const Key& key)
+    {
+        auto it = _entries.find( key );
+        if( it == _entries.end() )
+        {
+            return;
+        }
+        for (quint64 t: trigramsOf( it->second ))
+        {
+            auto posting = _trigrams.find( t );
+            if( posting != _trigrams.end() )
+            {
+                posting->second.erase( key );
+                if( posting->second.empty() )
+                {
+                    _trigrams.erase( posting );
+                }
+            }
+        }
+        _entries.erase( it );
+    }
+
+    void clear()
+    {
+        _entries.clear();
+        _trigrams.clear();
+    }
+
+    size_t size() const { return _entries.size(); }
+
+    // the keys whose text contains "query", in no particular order
+    std::vector<Key> find(const QString& query) const
+    {
+        std::vector<Key> out;
+        const QString needle = query.toLower();
+        if( needle.isEmpty() )
+        {
+            return out;
+        }
+
+        const auto trigrams = trigramsOf( needle );
+        if( trigrams.empty() )
+        {
+            for (const auto& it: _entries)
+            {
+                if( it.second.contains( needle ) )
+                {
+                    out.push_back( it.first );
+                }
+            }
+            return out;
+        }
+
+        // start from the rarest trigram
+        const std::unordered_set<Key, Hash>* smallest = nullptr;
+        for (quint64 t: trigrams)
+        {
+            auto posting = _trigrams.find( t );
+            if( posting == _trigrams.end() )
+            {
+                return out;
+            }
+            if( !smallest || posting->second.size() < smallest->size() )
+            {
+                smallest = &posting->second;
+            }
+        }
+        for (const Key& key: *smallest)
+        {
+            if( _entries.at( key ).contains( needle ) )
+            {
+                out.push_back( key );
+            }
+        }
+        return out;
+    }
+
+private:
+    // lower case
+    std::unordered_map<Key, QString, Hash> _entries;
+    std::unordered_map<quint64, std::unordered_set<Key, Hash>> _trigrams;
+
+    static std::vector<quint64> trigramsOf(const QString& text)
+    {
+        std::vector<quint64> out;
+        if( text.size() < 3 )
+        {
+            return out;
+        }
+        out.reserve( text.size() - 2 );
+        for (int i = 0; i + 2 < text.size(); i++)
+        {
+            const QChar* c = text.constData() + i;
+            out.push_back( ( quint64(c[0].unicode()) << 32 ) |
+                           ( quint64(c[1].unicode()) << 16 ) |
+                             quint64(c[2].unicode()) );
+        }
+        std::sort( out.begin(), out.end() );
+        out.erase( std::unique( out.begin(), out.end() ), out.end() );
+        return out;
+    }
+};
+
+// QString has a qHash(), not a std::hash
+struct QStringHash
+{
+    size_t operator()(const QString& str) const { return qHash( str ); }
+};
+
+#endif // TRIGRAM_INDEX_H
@@ -0,0 +1,533 @@
+#include "undo_history.h"
+#include <QDataStream>
+#include <QJsonDocument>
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+
+#include <nodes/Node>
+#include <nodes/Connection>
+
+#include "tree_clipboard.h"
+
+using namespace QtNodes;
+
+bool ConnectionKey::operator <(const ConnectionKey &other) const
+{
+    if( out_id != other.out_id )       return out_id < other.out_id;
+    if( out_index != other.out_index ) return out_index < other.out_index;
+    if( in_id != other.in_id )         return in_id < other.in_id;
+    return in_index < other.in_index;
+}
+
+bool ConnectionKey::operator ==(const ConnectionKey &other) const
+{
+    return out_id == other.out_id && out_index == other.out_index &&
+           in_id == other.in_id && in_index == other.in_index;
+}
+
+bool TabChange::empty() const
+{
+    return !created && !removed && renamed_from.isEmpty() && nodes.empty() &&
+           connections_created.empty() && connections_removed.empty() &&
+           layout_before == layout_after;
+}
+
+TabChange TabChange::reversed() const
+{
+    TabChange change;
+    change.name = renamed_from.isEmpty() ? name : renamed_from;
+    change.renamed_from = renamed_from.isEmpty() ? QString() : name;
+    change.created = removed;
+    change.removed = created;
+    change.layout_before = layout_after;
+    change.layout_after  = layout_before;
+    change.nodes.reserve( nodes.size() );
+    for(const NodeChange& node: nodes)
+    {
+        change.nodes.push_back( { node.id, node.after, node.before } );
+    }
+    change.connections_created = connections_removed;
+    change.connections_removed = connections_created;
+    change.deferred_tree = deferred_tree;
+    return change;
+}
+
+UndoStep UndoStep::reversed() const
+{
+    UndoStep step;
+    // a tab is created before the changes that use it, and removed after
+    for(auto it = tabs.rbegin(); it != tabs.rend(); it++)
+    {
+        step.tabs.push_back( it->reversed() );
+    }
+    step.main_tree_before   = main_tree_after;
+    step.main_tree_after    = main_tree_before;
+    step.current_tab_before = current_tab_after;
+    step.current_tab_after  = current_tab_before;
+    step.layout_before      = layout_after;
+    step.layout_after       = layout_before;
+    return step;
+}
+
+namespace {
+
+QByteArray toBytes(const QJsonObject& json)
+{
+    return json.isEmpty() ? QByteArray() : QJsonDocument( json ).toJson( QJsonDocument::Compact );
+}
+
+QByteArray toBytes(const std::shared_ptr<const AbsBehaviorTree>& tree)
+{
+    if( !tree )
+    {
+        return QByteArray();
+    }
+    ClipboardContent content;
+    content.trees.push_back( *tree );
+    for (const auto& abs_node: tree->nodes())
+    {
+        content.models.insert( { abs_node.model.registration_ID, abs_node.model } );
+    }
+    return EncodeClipboard( content );
+}
+
+std::shared_ptr<const AbsBehaviorTree> treeFromBytes(const QByteArray& data)
+{
+    ClipboardContent content;
+    if( data.isEmpty() || !DecodeClipboard( data, content ) || content.trees.size() != 1 )
+    {
+        return nullptr;
+    }
+    return std::make_shared<const AbsBehaviorTree>( std::move( content.trees.front() ) );
+}
+
+QJsonObject fromBytes(const QByteArray& data)
+{
+    return data.isEmpty() ? QJsonObject() : QJsonDocument::fromJson( data ).object();
+}
+
+void writeConnections(QDataStream& stream, const std::vector<ConnectionKey>& connections)
+{
+    stream << quint32( connections.size() );
+    for(const ConnectionKey& key: connections)
+    {
+        stream << key.out_id << qint32( key.out_index ) << key.in_id << qint32( key.in_index );
+    }
+}
+
+void readConnections(QDataStream& stream, std::vector<ConnectionKey>& connections)
+{
+    quint32 count = 0;
+    stream >> count;
+    connections.resize( count );
+    for(ConnectionKey& key: connections)
+    {
+        qint32 out_index = 0;
+        qint32 in_index = 0;
+        stream >> key.out_id >> out_index >> key.in_id >> in_index;
+        key.out_index = out_index;
+        key.in_index  = in_index;
+    }
+}
+
+} // end anonymous namespace
+
+size_t TabChange::memoryUsage() const
+{
+    size_t bytes = sizeof(TabChange) + StringMemoryUsage( name ) + StringMemoryUsage( renamed_from ) +
+                   nodes.capacity() * sizeof(NodeChange) +
+                   ( connections_created.capacity() + connections_removed.capacity() ) * sizeof(ConnectionKey);
+    for(const NodeChange& node: nodes)
+    {
+        bytes += size_t( toBytes( node.before ).size() + toBytes( node.after ).size() );
+    }
+    if( deferred_tree )
+    {
+        bytes += deferred_tree->nodesCount() * sizeof(AbstractTreeNode);
+    }
+    return bytes;
+}
+
+size_t UndoStep::memoryUsage() const
+{
+    size_t bytes = sizeof(UndoStep) + size_t( packed.capacity() );
+    for(const TabChange& tab: tabs)
+    {
+        bytes += tab.memoryUsage();
+    }
+    return bytes;
+}
+
+size_t TabSnapshot::memoryUsage() const
+{
+    size_t bytes = sizeof(TabSnapshot) +
+                   _positions.size() * ( MAP_NODE_OVERHEAD + sizeof(std::pair<QUuid, QPointF>) ) +
+                   _connections.size() * ( MAP_NODE_OVERHEAD + sizeof(ConnectionKey) );
+    for(const auto& it: _nodes)
+    {
+        bytes += MAP_NODE_OVERHEAD + sizeof(it) + size_t( toBytes( it.second ).size() );
+    }
+    return bytes;
+}
+
+void UndoStep::pack()
+{
+    if( isPacked() || tabs.empty() )
+    {
+        return;
+    }
+    QByteArray data;
+    {
+        QDataStream stream( &data, QIODevice::WriteOnly );
+        stream << quint32( tabs.size() );
+        for(const TabChange& tab: tabs)
+        {
+            stream << tab.name << tab.renamed_from << tab.created << tab.removed
+                   << qint32( tab.layout_before ) << qint32( tab.layout_after );
+            stream << quint32( tab.nodes.size() );
+            for(const NodeChange& node: tab.nodes)
+            {
+                stream << node.id << toBytes( node.before ) << toBytes( node.after );
+            }
+            writeConnections( stream, tab.connections_created );
+            writeConnections( stream, tab.connections_removed );
+            stream << toBytes( tab.deferred_tree );
+        }
+    }
+    packed = qCompress( data );
+    std::vector<TabChange>().swap( tabs );
+}
+
+void UndoStep::unpack()
+{
+    if( !isPacked() )
+    {
+        return;
+    }
+    const QByteArray data = qUncompress( packed );
+    packed.clear();
+
+    QDataStream stream( data );
+    quint32 tabs_count = 0;
+    stream >> tabs_count;
+    tabs.resize( tabs_count );
+    for(TabChange& tab: tabs)
+    {
+        qint32 layout_before = 0;
+        qint32 layout_after = 0;
+        stream >> tab.name >> tab.renamed_from >> tab.created >> tab.removed
+               >> layout_before >> layout_after;
+        tab.layout_before = static_cast<QtNodes::PortLayout>( layout_before );
+        tab.layout_after  = static_cast<QtNodes::PortLayout>( layout_after );
+
+        quint32 nodes_count = 0;
+        stream >> nodes_count;
+        tab.nodes.resize( nodes_count );
+        for(NodeChange& node: tab.nodes)
+        {
+            QByteArray before, after;
+            stream >> node.id >> before >> after;
+            node.before = fromBytes( before );
+            node.after  = fromBytes( after );
+        }
+        readConnections( stream, tab.connections_created );
+        readConnections( stream, tab.connections_removed );
+        QByteArray deferred_tree;
+        stream >> deferred_tree;
+        tab.deferred_tree = treeFromBytes( deferred_tree );
+    }
+}
+
+TabChange TabSnapshot::update(const QString &name, EditorFlowScene &scene,
+                              const std::set<QUuid> &changed_nodes,
+                              bool connections_changed, bool compare_all)
+{
+    TabChange change;
+    change.name = name;
+    change.layout_before = _layout;
+    change.layout_after  = scene.layout();
+    _layout = scene.layout();
+    _scene = &scene;
+    _deferred = false;
+    _deferred_tree.reset();
+
+    const auto& nodes = scene.nodes();
+
+    auto compare = [&](const QUuid& id)
+    {
+        auto node_it  = nodes.find( id );
+        auto saved_it = _nodes.find( id );
+        if( node_it == nodes.end() || !node_it->second )
+        {
+            if( saved_it != _nodes.end() )
+            {
+                change.nodes.push_back( { id, saved_it->second, QJsonObject() } );
+                _nodes.erase( saved_it );
+                _positions.erase( id );
+            }
+            return;
+        }
+        const Node& node = *node_it->second;
+        QJsonObject json = node.saveContent();
+        _positions[id] = node.nodeGraphicsObject().pos();
+
+        if( saved_it == _nodes.end() )
+        {
+            change.nodes.push_back( { id, QJsonObject(), json } );
+            _nodes.insert( { id, json } );
+        }
+        else if( saved_it->second != json )
+        {
+            change.nodes.push_back( { id, saved_it->second, json } );
+            saved_it->second = json;
+        }
+    };
+
+    if( compare_all )
+    {
+        std::set<QUuid> ids;
+        for(const auto& it: _nodes) ids.insert( it.first );
+        for(const auto& it: nodes)  ids.insert( it.first );
+        for(const QUuid& id: ids)
+        {
+            compare( id );
+        }
+    }
+    else{
+        for(const QUuid& id: changed_nodes)
+        {
+            compare( id );
+        }
+        // moving a node does not notify anything else than a drag of the
+        // mouse: the positions are cheap to compare, the JSON is not
+        for(const auto& it: nodes)
+        {
+            if( !it.second || changed_nodes.count( it.first ) ) continue;
+
+            auto pos_it = _positions.find( it.first );
+            if( pos_it == _positions.end() ||
+                pos_it->second != it.second->nodeGraphicsObject().pos() )
+            {
+                compare( it.first );
+            }
+        }
+        // a node removed while it was reported as changed
+        if( _nodes.size() != nodes.size() )
+        {
+            std::vector<QUuid> removed;
+            for(const auto& it: _nodes)
+            {
+                if( nodes.count( it.first ) == 0 ) removed.push_back( it.first );
+            }
+            for(const QUuid& id: removed)
+            {
+                compare( id );
+            }
+        }
+    }
+
+    if( connections_changed || compare_all )
+    {
+        std::set<ConnectionKey> connections;
+        for(const auto& it: scene.connections())
+        {
+            const Connection* connection = it.second.get();
+            const Node* node_out = connection ? connection->getNode(PortType::Out) : nullptr;
+            const Node* node_in  = connection ? connection->getNode(PortType::In)  : nullptr;
+            if( node_out && node_in )
+            {
+                connections.insert( { node_out->id(), connection->getPortIndex(PortType::Out),
+                                      node_in->id(),  connection->getPortIndex(PortType::In) } );
+            }
+        }
+        std::set_difference( connections.begin(), connections.end(),
+                             _connections.begin(), _connections.end(),
+                             std::back_inserter( change.connections_created ) );
+        std::set_difference( _connections.begin(), _connections.end(),
+                             connections.begin(), connections.end(),
+                             std::back_inserter( change.connections_removed ) );
+        _connections.swap( connections );
+    }
+    return change;
+}
+
+TabChange TabSnapshot::removal(const QString &name) const
+{
+    TabChange change;
+    change.name = name;
+    change.removed = true;
+    change.layout_before = _layout;
+    change.layout_after  = _layout;
+    if( _deferred )
+    {
+        change.deferred_tree = _deferred_tree;
+        return change;
+    }
+    change.nodes.reserve( _nodes.size() );
+    for(const auto& it: _nodes)
+    {
+        change.nodes.push_back( { it.first, it.second, QJsonObject() } );
+    }
+    change.connections_removed.assign( _connections.begin(), _connections.end() );
+    return change;
+}
+
+namespace {
+
+Node* findNode(EditorFlowScene& scene, const QUuid& id)
+{
+    auto it = scene.nodes().find( id );
+    return ( it == scene.nodes().end() ) ? nullptr : it->second.get();
+}
+
+bool hasPort(const Node& node, PortType type, int index)
+{
+    return index >= 0 && size_t(index) < node.nodeState().getEntries(type).size();
+}
+
+Connection* findConnection(EditorFlowScene& scene, const ConnectionKey& key)
+{
+    Node* node_out = findNode( scene, key.out_id );
+    if( !node_out || !hasPort( *node_out, PortType::Out, key.out_index ) )
+    {
+        return nullptr;
+    }
+    for(const auto& it: node_out->nodeState().connections( PortType::Out, key.out_index ))
+    {
+        Connection* connection = it.second;
+        const Node* node_in = connection->getNode(PortType::In);
+        if( node_in && node_in->id() == key.in_id &&
+            connection->getPortIndex(PortType::In) == key.in_index )
+        {
+            return connection;
+        }
+    }
+    return nullptr;
+}
+
+void createConnection(EditorFlowScene& scene, const ConnectionKey& key)
+{
+    Node* node_out = findNode( scene, key.out_id );
+    Node* node_in  = findNode( scene, key.in_id );
+    if( node_out && node_in &&
+        key.out_index >= 0 && unsigned(key.out_index) < node_out->nodeDataModel()->nPorts(PortType::Out) &&
+        key.in_index >= 0 && unsigned(key.in_index) < node_in->nodeDataModel()->nPorts(PortType::In) &&
+        !findConnection( scene, key ) )
+    {
+        scene.createConnection( *node_in, key.in_index, *node_out, key.out_index );
+    }
+}
+
+// false if the model is not registered anymore
+bool restoreNode(EditorFlowScene& scene, const QJsonObject& node_json, const QUuid& id)
+{
+    try{
+        scene.restoreNode( node_json, id );
+        return true;
+    }
+    catch( std::exception& )
+    {
+        return false;
+    }
+}
+
+QString modelName(const QJsonObject& node_json)
+{
+    return node_json["model"].toObject()["name"].toString();
+}
+
+} // end anonymous namespace
+
+void ApplyTabChange(EditorFlowScene &scene, const TabChange &change)
+{
+    if( scene.layout() != change.layout_after )
+    {
+        scene.setLayout( change.layout_after );
+    }
+
+    for(const ConnectionKey& key: change.connections_removed)
+    {
+        if( Connection* connection = findConnection( scene, key ) )
+        {
+            scene.deleteConnection( *connection );
+        }
+    }
+
+    for(const NodeChange& node_change: change.nodes)
+    {
+        if( node_change.after.isEmpty() )
+        {
+            if( Node* node = findNode( scene, node_change.id ) )
+            {
+                scene.removeNode( *node );
+            }
+        }
+    }
+
+    for(const NodeChange& node_change: change.nodes)
+    {
+        if( node_change.after.isEmpty() )
+        {
+            continue;
+        }
+        Node* node = findNode( scene, node_change.id );
+        if( !node )
+        {
+            restoreNode( scene, node_change.after, node_change.id );
+        }
+        else if( node->nodeDataModel()->name() == modelName( node_change.after ) )
+        {
+            // modified in place: moved, renamed or with different ports
+            node->restore( node_change.after, node_change.id );
+            node->nodeState().getEntries(PortType::In).resize( node->nodeDataModel()->nPorts(PortType::In) );
+            node->nodeState().getEntries(PortType::Out).resize( node->nodeDataModel()->nPorts(PortType::Out) );
+            node->nodeGeometry().recalculateSize();
+            node->nodeGraphicsObject().setGeometryChanged();
+            node->nodeGraphicsObject().moveConnections();
+            scene.portsChanged( *node );
+            scene.nodeChanged( *node );
+        }
+        else{
+            // a different model: created again, with the same connections
+            std::vector<ConnectionKey> connections;
+            for(const auto& entries: node->nodeState().getEntries(PortType::Out))
+            {
+                for(const auto& it: entries)
+                {
+                    const Connection* c = it.second;
+                    if( c->getNode(PortType::In) )
+                    {
+                        connections.push_back( { node->id(), c->getPortIndex(PortType::Out),
+                                                 c->getNode(PortType::In)->id(), c->getPortIndex(PortType::In) } );
+                    }
+                }
+            }
+            for(const auto& entries: node->nodeState().getEntries(PortType::In))
+            {
+                for(const auto& it: entries)
+                {
+                    const Connection* c = it.second;
+                    if( c->getNode(PortType::Out) )
+                    {
+                        connections.push_back( { c->getNode(PortType::Out)->id(), c->getPortIndex(PortType::Out),
+                                                 node->id(), c->getPortIndex(PortType::In) } );
+                    }
+                }
+            }
+            scene.removeNode( *node );
+            if( restoreNode( scene, node_change.after, node_change.id ) )
+            {
+                for(const ConnectionKey& key: connections)
+                {
+                    createConnection( scene, key );
+                }
+            }
+        }
+    }
+
+    for(const ConnectionKey& key: change.connections_created)
+    {
+        createConnection( scene, key );
+    }
+}
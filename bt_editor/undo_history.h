@@ -0,0 +1,142 @@
+#ifndef UNDO_HISTORY_H
+#define UNDO_HISTORY_H
+
+#include <QByteArray>
+#include <QJsonObject>
+#include <QPointF>
+#include <QString>
+#include <QUuid>
+#include <map>
+#include <memory>
+#include <set>
+#include <vector>
+
+#include "editor_flowscene.h"
+
+// The undo history records the differences between two states of the tabs,
+// instead of a copy of all of them: the nodes created, removed or modified
+// (moved, renamed, ports edited) and the connections created or removed.
+// Applying a step costs as much as the change it contains.
+
+struct ConnectionKey
+{
+    QUuid out_id;
+    int out_index;
+    QUuid in_id;
+    int in_index;
+
+    bool operator <(const ConnectionKey& other) const;
+    bool operator ==(const ConnectionKey& other) const;
+};
+
+struct NodeChange
+{
+    QUuid id;
+    // as saved by QtNodes::Node::saveContent(), without the id; empty if the node does not exist
+    QJsonObject before;
+    QJsonObject after;
+};
+
+struct TabChange
+{
+    QString name;
+    // the tab itself was created or removed
+    bool created = false;
+    bool removed = false;
+    // the previous name of the tab, if renamed
+    QString renamed_from;
+    QtNodes::PortLayout layout_before = QtNodes::PortLayout::Vertical;
+    QtNodes::PortLayout layout_after  = QtNodes::PortLayout::Vertical;
+    std::vector<NodeChange> nodes;
+    std::vector<ConnectionKey> connections_created;
+    std::vector<ConnectionKey> connections_removed;
+    // a tab never built is created or removed with its tree, instead of
+    // "nodes" and "connections"
+    std::shared_ptr<const AbsBehaviorTree> deferred_tree;
+
+    bool empty() const;
+
+    TabChange reversed() const;
+
+    // an estimate, the nodes as their JSON text
+    size_t memoryUsage() const;
+};
+
+struct UndoStep
+{
+    std::vector<TabChange> tabs;
+    QString main_tree_before;
+    QString main_tree_after;
+    QString current_tab_before;
+    QString current_tab_after;
+    // of the whole project: the tabs not shown keep the previous one until they are
+    QtNodes::PortLayout layout_before = QtNodes::PortLayout::Vertical;
+    QtNodes::PortLayout layout_after  = QtNodes::PortLayout::Vertical;
+    // "tabs", serialized and compressed by pack()
+    QByteArray packed;
+
+    bool empty() const
+    {
+        return tabs.empty() && packed.isEmpty() && main_tree_before == main_tree_after &&
+               layout_before == layout_after;
+    }
+
+    // must not be packed
+    UndoStep reversed() const;
+
+    // The old steps are kept in this compact form, expanded again only
+    // when they are applied.
+    void pack();
+
+    void unpack();
+
+    bool isPacked() const { return !packed.isEmpty(); }
+
+    size_t memoryUsage() const;
+};
+
+// What the undo history knows of a tab: its state at the last step recorded.
+class TabSnapshot
+{
+public:
+    // The changes of the scene since the last call, that become the state of
+    // the snapshot. Only "changed_nodes" is saved and compared, together with
+    // the nodes that moved; the whole scene is compared if "compare_all".
+    TabChange update(const QString& name, EditorFlowScene& scene,
+                     const std::set<QUuid>& changed_nodes,
+                     bool connections_changed, bool compare_all);
+
+    // removes all the nodes and the connections
+    TabChange removal(const QString& name) const;
+
+    // the scene of the last update; it stays the same when a tab is renamed
+    const EditorFlowScene* scene() const { return _scene; }
+
+    // the tab is not built yet: its first update is its initial state
+    void setDeferred(const EditorFlowScene* scene, std::shared_ptr<const AbsBehaviorTree> tree)
+    {
+        _deferred = true;
+        _scene = scene;
+        _deferred_tree = std::move(tree);
+    }
+
+    bool isDeferred() const { return _deferred; }
+
+    // an estimate, the nodes as their JSON text
+    size_t memoryUsage() const;
+
+private:
+    const EditorFlowScene* _scene = nullptr;
+    bool _deferred = false;
+    std::shared_ptr<const AbsBehaviorTree> _deferred_tree;
+    std::map<QUuid, QJsonObject> _nodes;
+    std::map<QUuid, QPointF> _positions;
+    std::set<ConnectionKey> _connections;
+    QtNodes::PortLayout _layout = QtNodes::PortLayout::Vertical;
+};
+
+// Applies the nodes and the connections of a change to the scene. The tab
+// must be in the "before" state of the change.
+void ApplyTabChange(EditorFlowScene& scene, const TabChange& change);
+
+#endif // UNDO_HISTORY_H
@@ -1,13 +1,20 @@
 #include "utils.h"
 #include <set>
+#include <algorithm>
+#include <cmath>
+#include <limits>
 #include <QDebug>
+#include <QHash>
 #include <QDomDocument>
 #include <QMessageBox>
 #include "nodes/Node"
 #include "nodes/DataModelRegistry"
+#include "nodes/Trace"
 #include "nodes/internal/memory.hpp"
 #include "models/SubtreeNodeModel.hpp"
 #include "models/RootNodeModel.hpp"
+#include "editor_flowscene.h"
+#include "tree_layout.h"
 
 using QtNodes::PortLayout;
 using QtNodes::DataModelRegistry;
@@ -16,6 +23,11 @@ using QtNodes::FlowScene;
 
 QtNodes::Node* findRoot(const QtNodes::FlowScene &scene)
 {
+    if( auto editor_scene = dynamic_cast<const EditorFlowScene*>( &scene ) )
+    {
+        return editor_scene->topology().root();
+    }
+
     Node* root = nullptr;
 
     for (auto& it: scene.nodes() )
@@ -46,15 +58,21 @@ std::vector<Node*> getChildren(const QtNodes::FlowScene &scene,
         return children;
     }
 
-    const auto& conn_out = parent_node.nodeState().connections(PortType::Out, 0);
-    children.reserve( conn_out.size() );
-
-    for( auto& it: conn_out)
+    if( auto editor_scene = dynamic_cast<const EditorFlowScene*>( &scene ) )
     {
-        auto child_node = it.second->getNode(PortType::In);
-        if( child_node )
+        children = editor_scene->topology().children( parent_node );
+    }
+    else{
+        const auto& conn_out = parent_node.nodeState().connections(PortType::Out, 0);
+        children.reserve( conn_out.size() );
+
+        for( auto& it: conn_out)
         {
-            children.push_back( child_node );
+            auto child_node = it.second->getNode(PortType::In);
+            if( child_node )
+            {
+                children.push_back( child_node );
+            }
         }
     }
 
@@ -86,156 +104,6 @@ std::vector<Node*> getChildren(const QtNodes::FlowScene &scene,
 
 //---------------------------------------------------
 
-void RecursiveNodeReorder(AbsBehaviorTree& tree, PortLayout layout)
-{
-    std::function<void(unsigned, AbstractTreeNode*)> recursiveStep;
-
-    std::vector<QPointF> layer_cursor;
-    std::vector< std::vector<AbstractTreeNode*> > nodes_by_level(1);
-
-    const qreal LEVEL_SPACING = 80;
-    const qreal NODE_SPACING  = 40;
-
-    recursiveStep = [&](unsigned current_layer, AbstractTreeNode* node)
-    {
-        node->pos = layer_cursor[current_layer];
-        nodes_by_level[current_layer].push_back( node );
-
-        //------------------------------------
-        if( node->children_index.size() == 0 )
-        {
-            return;
-        }
-        qreal recommended_pos = NODE_SPACING * 0.5;
-
-        current_layer++;
-
-        if( layout == PortLayout::Vertical)
-        {
-            recommended_pos += (node->pos.x() + node->size.width()*0.5)  ;
-            for(int index: node->children_index)
-            {
-                const auto& child_node = tree.nodes()[index];
-                recommended_pos -=  (child_node.size.width() + NODE_SPACING) * 0.5;
-            }
-
-            if( current_layer >= layer_cursor.size())
-            {
-                QPointF new_cursor( recommended_pos,
-                                    node->pos.y() + LEVEL_SPACING );
-                layer_cursor.push_back( new_cursor );
-                nodes_by_level.push_back( std::vector<AbstractTreeNode*>() );
-            }
-            else{
-                recommended_pos = std::max( recommended_pos, layer_cursor[current_layer].x() );
-                layer_cursor[current_layer].setX(recommended_pos);
-            }
-        }//------------------------------------
-        else
-        {
-            recommended_pos += node->pos.y() + node->size.height()*0.5;
-            for(int index: node->children_index)
-            {
-                const auto& child_node = tree.nodes()[index];
-                recommended_pos -=  (child_node.size.height() + NODE_SPACING) * 0.5;
-            }
-
-            if( current_layer >= layer_cursor.size())
-            {
-                QPointF new_cursor( node->pos.x() + LEVEL_SPACING,
-                                    recommended_pos);
-                layer_cursor.push_back( new_cursor );
-                nodes_by_level.push_back( std::vector<AbstractTreeNode*>() );
-            }
-            else{
-                recommended_pos = std::max( recommended_pos, layer_cursor[current_layer].y() );
-                layer_cursor[current_layer].setY(recommended_pos);
-            }
-        }
-        //------------------------------------
-
-        auto initial_pos = layer_cursor[current_layer];
-
-        for(int index: node->children_index)
-        {
-            AbstractTreeNode* child_node = tree.node(index);
-
-            recursiveStep(current_layer, child_node);
-            if( layout == PortLayout::Vertical)
-            {
-                layer_cursor[current_layer]+= QPointF( child_node->size.width() + NODE_SPACING, 0 );
-            }
-            else{
-                layer_cursor[current_layer]+= QPointF( 0, child_node->size.height() + NODE_SPACING );
-            }
-        }
-
-        auto final_pos = layer_cursor[current_layer];
-
-        if( node->children_index.size() > 0)
-        {
-            auto first_child = tree.node( node->children_index.front() );
-            auto last_child = tree.node( node->children_index.back() );
-
-            initial_pos = QPointF( first_child->pos.x() + first_child->size.width()*0.5,
-                                   first_child->pos.y() + first_child->size.height()*0.5);
-
-            final_pos   = QPointF( last_child->pos.x() + last_child->size.width()*0.5,
-                                   last_child->pos.y() + last_child->size.height()*0.5);
-        }
-
-        // rebalance father
-        QPointF pos_offset(0,0);
-        if( layout == PortLayout::Vertical)
-        {
-            double new_x = (final_pos.x() + initial_pos.x()) * 0.5 - node->size.width()*0.5;
-            double diff = node->pos.x() - new_x;
-            pos_offset = QPointF( - diff, 0 );
-        }
-        else{
-            double new_y = (final_pos.y() + initial_pos.y()) * 0.5 - node->size.height()*0.5;
-            double diff = node->pos.y() - new_y;
-            pos_offset = QPointF( 0, - diff );
-        }
-
-        node->pos += pos_offset;
-        layer_cursor[current_layer -1 ] += pos_offset;
-    };
-
-    auto root_node = tree.rootNode();
-    layer_cursor.push_back(QPointF( -root_node->size.width()*0.5,
-                                    -root_node->size.height()*0.5));
-    recursiveStep(0, root_node);
-
-    if( layout == PortLayout::Vertical)
-    {
-        qreal offset = root_node->size.height() + LEVEL_SPACING;
-        for(unsigned i=1; i< nodes_by_level.size(); i++ )
-        {
-            qreal max_height = 0;
-            for(auto node: nodes_by_level[i])
-            {
-                max_height = std::max( max_height, node->size.height() );
-                node->pos.setY( offset );
-            }
-            offset += max_height + LEVEL_SPACING;
-        }
-    }
-    else{
-        qreal offset = root_node->size.width() + LEVEL_SPACING;
-        for(unsigned i=1; i< nodes_by_level.size(); i++ )
-        {
-            qreal max_width = 0;
-            for(auto node: nodes_by_level[i])
-            {
-                max_width = std::max( max_width, node->size.width() );
-                node->pos.setX( offset );
-            }
-            offset += max_width + LEVEL_SPACING;
-        }
-    }
-}
-
 void NodeReorder(QtNodes::FlowScene &scene, AbsBehaviorTree & tree)
 {
 
@@ -253,19 +121,26 @@ void NodeReorder(QtNodes::FlowScene &scene, AbsBehaviorTree & tree)
         return;
     }
 
-    RecursiveNodeReorder(tree, scene.layout() );
+    ComputeTreeLayout(tree, scene.layout() );
 
     for (const auto& abs_node: tree.nodes())
     {
         Node* node =  abs_node.graphic_node;
-        scene.setNodePosition( *node, abs_node.pos );
+        // most of the nodes did not move after a small edit
+        if( scene.getNodePosition( *node ) != abs_node.pos )
+        {
+            scene.setNodePosition( *node, abs_node.pos );
+        }
     }
 }
 
 
 AbsBehaviorTree BuildTreeFromScene(const QtNodes::FlowScene *scene,
-                                   QtNodes::Node* root_node)
+                                   QtNodes::Node* root_node,
+                                   bool collapsed)
 {
+    NODE_TRACE_SCOPE("BuildTreeFromScene");
+
     if(!root_node )
     {
         root_node = findRoot( *scene );
@@ -298,6 +173,12 @@ AbsBehaviorTree BuildTreeFromScene(const QtNodes::FlowScene *scene,
 
         auto added_node = tree.addNode( parent, std::move(abs_node) );
 
+        auto branch = bt_model->collapsedBranch();
+        if( collapsed && branch )
+        {
+            AppendBranch( tree, added_node, *branch, *branch->rootNode(), added_node->pos );
+        }
+
         auto children = getChildren( *scene, *node, true );
 
         for(auto& child_node: children )
@@ -311,6 +192,26 @@ AbsBehaviorTree BuildTreeFromScene(const QtNodes::FlowScene *scene,
     return tree;
 }
 
+void AppendBranch(AbsBehaviorTree& tree, AbstractTreeNode *parent,
+                  const AbsBehaviorTree& branch, const AbstractTreeNode& branch_node,
+                  QPointF offset)
+{
+    for (int child_index: branch_node.children_index)
+    {
+        const AbstractTreeNode* child = branch.node( size_t(child_index) );
+        AbstractTreeNode abs_node;
+        abs_node.model = child->model;
+        abs_node.instance_name = child->instance_name;
+        abs_node.ports_mapping = child->ports_mapping;
+        abs_node.size = child->size;
+        abs_node.pos = child->pos + offset;
+
+        // the deque keeps the address of "parent"
+        auto added_node = tree.addNode( parent, std::move(abs_node) );
+        AppendBranch( tree, added_node, branch, *child, offset );
+    }
+}
+
 AbsBehaviorTree BuildTreeFromXML(const QDomElement& bt_root, const NodeModels& models )
 {
     AbsBehaviorTree tree;
@@ -385,56 +286,95 @@ AbsBehaviorTree BuildTreeFromXML(const QDomElement& bt_root, const NodeModels& m
 }
 
 
+namespace
+{
+
+// Each distinct string of a flatbuffer converted once: the names of the
+// models, of the ports and of the instances repeat through the tree, their
+// copies share the same data.
+class FlatbufferStrings
+{
+public:
+    QString get(const flatbuffers::String* str)
+    {
+        // no copy of the buffer for the lookup
+        const QByteArray key = QByteArray::fromRawData( str->c_str(), int( str->size() ) );
+        auto it = _strings.find( key );
+        if( it == _strings.end() )
+        {
+            it = _strings.insert( key, QString::fromUtf8( str->c_str(), int( str->size() ) ) );
+        }
+        return it.value();
+    }
+
+private:
+    // the keys point into the flatbuffer
+    QHash<QByteArray, QString> _strings;
+};
+
+}
+
 std::pair<AbsBehaviorTree, std::unordered_map<int, int>>
 BuildTreeFromFlatbuffers(const Serialization::BehaviorTree *fb_behavior_tree)
 {
-    AbsBehaviorTree tree;
-    std::unordered_map<int, int> uid_to_index;
+    NODE_TRACE_SCOPE("BuildTreeFromFlatbuffers");
+
+    std::pair<AbsBehaviorTree, std::unordered_map<int, int>> result;
+    AbsBehaviorTree& tree = result.first;
+    std::unordered_map<int, int>& uid_to_index = result.second;
+    uid_to_index.reserve( fb_behavior_tree->nodes()->size() );
+
+    FlatbufferStrings strings;
 
     AbstractTreeNode abs_root;
     abs_root.instance_name = "Root";
     abs_root.model.registration_ID = "Root";
-    abs_root.model.registration_ID = "Root";
     abs_root.children_index.push_back( 1 );
 
     tree.addNode( nullptr, std::move(abs_root) );
 
     //-----------------------------------------
-    NodeModels models;
+    // once per model: the nodes share its ports
+    QHash<QString, NodeModel> models;
 
     for( const Serialization::NodeModel* model_node: *(fb_behavior_tree->node_models()) )
     {
         NodeModel model;
-        model.registration_ID = model_node->registration_name()->c_str();
+        model.registration_ID = strings.get( model_node->registration_name() );
         model.type = convert( model_node->type() );
 
         for( const Serialization::PortModel* port: *(model_node->ports()) )
         {
             PortModel port_model;
-            QString port_name = port->port_name()->c_str();
+            QString port_name = strings.get( port->port_name() );
             port_model.direction = convert( port->direction() );
-            port_model.type_name = port->type_info()->c_str();
-            port_model.description = port->description()->c_str();
+            port_model.type_name = strings.get( port->type_info() );
+            port_model.description = strings.get( port->description() );
 
             model.ports.insert( { port_name, std::move(port_model) } );
         }
 
-        models.insert( { model.registration_ID, std::move(model)} );
+        models.insert( model.registration_ID, std::move(model) );
     }
 
     //-----------------------------------------
     for( const Serialization::TreeNode* fb_node: *(fb_behavior_tree->nodes()) )
     {
         AbstractTreeNode abs_node;
-        abs_node.instance_name = fb_node->instance_name()->c_str();
-        const char* registration_ID = fb_node->registration_name()->c_str();
+        abs_node.instance_name = strings.get( fb_node->instance_name() );
         abs_node.status = convert( fb_node->status() );
-        abs_node.model = (models.at(registration_ID));
+
+        auto model_it = models.constFind( strings.get( fb_node->registration_name() ) );
+        if( model_it == models.constEnd() )
+        {
+            throw std::out_of_range( "node without model" );
+        }
+        abs_node.model = model_it.value();
 
         for( const Serialization::PortConfig* pair: *(fb_node->port_remaps()) )
         {
-            abs_node.ports_mapping.insert( { QString(pair->port_name()->c_str()),
-                                             QString(pair->remap()->c_str()) } );
+            abs_node.ports_mapping.insert( { strings.get( pair->port_name() ),
+                                             strings.get( pair->remap() ) } );
         }
         int index = tree.nodesCount();
         abs_node.index = index;
@@ -446,17 +386,200 @@ BuildTreeFromFlatbuffers(const Serialization::BehaviorTree *fb_behavior_tree)
     {
         const Serialization::TreeNode* fb_node = fb_behavior_tree->nodes()->Get(index);
         AbstractTreeNode* abs_node = tree.node( index + 1);
+        abs_node->children_index.reserve( fb_node->children_uid()->size() );
         for( const auto child_uid: *(fb_node->children_uid()) )
         {
             int child_index = uid_to_index[ child_uid ];
             abs_node->children_index.push_back(child_index);
         }
     }
-    return { tree, uid_to_index };
+    return result;
 }
 
-std::pair<QtNodes::NodeStyle, QtNodes::ConnectionStyle>
-getStyleFromStatus(NodeStatus status, NodeStatus prev_status)
+namespace
+{
+
+class FlatbuffersTreeWriter
+{
+public:
+    FlatbuffersTreeWriter(const std::map<QString, const AbsBehaviorTree*>& subtrees):
+        _subtrees(subtrees)
+    {}
+
+    std::vector<uint8_t> write(const AbsBehaviorTree& tree)
+    {
+        const uint16_t root_uid = addNode( tree, *firstNode( tree ) );
+
+        // by uid, as created by BehaviorTree.CPP
+        std::sort( _nodes.begin(), _nodes.end(),
+                   [](const UidNode& a, const UidNode& b) { return a.first < b.first; } );
+        std::vector<flatbuffers::Offset<Serialization::TreeNode>> nodes;
+        for (const auto& it: _nodes)
+        {
+            nodes.push_back( it.second );
+        }
+
+        std::vector<flatbuffers::Offset<Serialization::NodeModel>> models;
+        for (const auto& it: _models)
+        {
+            const NodeModel& model = *it.second;
+            std::vector<flatbuffers::Offset<Serialization::PortModel>> ports;
+            for (const auto& port_it: model.ports)
+            {
+                ports.push_back( Serialization::CreatePortModelDirect(
+                                     _fbb, port_it.first.toUtf8().constData(),
+                                     BT::convertToFlatbuffers( port_it.second.direction ),
+                                     port_it.second.type_name.toUtf8().constData(),
+                                     port_it.second.description.toUtf8().constData() ) );
+            }
+            models.push_back( Serialization::CreateNodeModelDirect(
+                                  _fbb, it.first.toUtf8().constData(),
+                                  BT::convertToFlatbuffers( model.type ), &ports ) );
+        }
+
+        _fbb.Finish( Serialization::CreateBehaviorTreeDirect( _fbb, root_uid, &nodes, &models ) );
+        return std::vector<uint8_t>( _fbb.GetBufferPointer(), _fbb.GetBufferPointer() + _fbb.GetSize() );
+    }
+
+private:
+    typedef std::pair<uint16_t, flatbuffers::Offset<Serialization::TreeNode>> UidNode;
+
+    const std::map<QString, const AbsBehaviorTree*>& _subtrees;
+    flatbuffers::FlatBufferBuilder _fbb;
+    std::vector<UidNode> _nodes;
+    std::map<QString, const NodeModel*> _models;
+    // a subtree including itself is not expanded again
+    std::set<QString> _expanding;
+    int _next_uid = 1;
+
+    static const AbstractTreeNode* firstNode(const AbsBehaviorTree& tree)
+    {
+        const AbstractTreeNode* root = tree.rootNode();
+        if( root->model.registration_ID == "Root" && root->children_index.size() == 1 )
+        {
+            return tree.node( root->children_index.front() );
+        }
+        return root;
+    }
+
+    // the children are created before their parent, as flatbuffers requires
+    uint16_t addNode(const AbsBehaviorTree& tree, const AbstractTreeNode& node)
+    {
+        if( _next_uid > std::numeric_limits<uint16_t>::max() )
+        {
+            throw std::runtime_error( "The tree has too many nodes to be serialized" );
+        }
+        const uint16_t uid = uint16_t( _next_uid++ );
+        const QString& ID = node.model.registration_ID;
+        _models.insert( { ID, &node.model } );
+
+        std::vector<uint16_t> children;
+        auto subtree_it = _subtrees.find( ID );
+        if( node.model.type == NodeType::SUBTREE && node.children_index.empty() &&
+            subtree_it != _subtrees.end() && subtree_it->second->nodesCount() > 0 &&
+            _expanding.count( ID ) == 0 )
+        {
+            _expanding.insert( ID );
+            const AbsBehaviorTree& subtree = *subtree_it->second;
+            children.push_back( addNode( subtree, *firstNode( subtree ) ) );
+            _expanding.erase( ID );
+        }
+        else{
+            for (int child_index: node.children_index)
+            {
+                children.push_back( addNode( tree, *tree.node( child_index ) ) );
+            }
+        }
+
+        std::vector<flatbuffers::Offset<Serialization::PortConfig>> remaps;
+        for (const auto& port_it: node.ports_mapping)
+        {
+            remaps.push_back( Serialization::CreatePortConfigDirect(
+                                  _fbb, port_it.first.toUtf8().constData(),
+                                  port_it.second.toUtf8().constData() ) );
+        }
+        _nodes.push_back( { uid, Serialization::CreateTreeNodeDirect(
+                                _fbb, uid, &children, Serialization::NodeStatus::IDLE,
+                                node.instance_name.toUtf8().constData(),
+                                ID.toUtf8().constData(), &remaps ) } );
+        return uid;
+    }
+};
+
+}
+
+std::vector<uint8_t>
+BuildFlatbuffersFromTree(const AbsBehaviorTree &tree,
+                         const std::map<QString, const AbsBehaviorTree *> &subtrees)
+{
+    if( tree.nodesCount() == 0 )
+    {
+        throw std::runtime_error( "The tree is empty" );
+    }
+    return FlatbuffersTreeWriter( subtrees ).write( tree );
+}
+
+static void mapSubtreeBranch(const AbsBehaviorTree& tree, int index,
+                             const AbsBehaviorTree& subtree, int subtree_index, int subtree_id,
+                             std::vector<SubtreeNodeIndex>& result)
+{
+    const AbstractTreeNode* node = tree.node( index );
+    const AbstractTreeNode* subtree_node = subtree.node( subtree_index );
+    if( node->model.registration_ID != subtree_node->model.registration_ID ||
+        result[index].subtree >= 0 )
+    {
+        return;
+    }
+    result[index] = { subtree_id, subtree_index };
+
+    const size_t count = std::min( node->children_index.size(), subtree_node->children_index.size() );
+    for (size_t i = 0; i < count; i++)
+    {
+        mapSubtreeBranch( tree, node->children_index[i],
+                          subtree, subtree_node->children_index[i], subtree_id, result );
+    }
+}
+
+std::vector<SubtreeNodeIndex>
+MapSubtreeNodes(const AbsBehaviorTree &tree,
+                const std::vector<std::pair<QString, const AbsBehaviorTree *> > &subtrees)
+{
+    NODE_TRACE_SCOPE("MapSubtreeNodes");
+
+    std::vector<SubtreeNodeIndex> result( tree.nodesCount() );
+
+    std::map<QString, int> subtree_ids;
+    for (size_t id = 0; id < subtrees.size(); id++)
+    {
+        const AbsBehaviorTree* subtree = subtrees[id].second;
+        if( subtree->nodesCount() > 1 && subtree->rootNode()->children_index.size() == 1 )
+        {
+            subtree_ids.insert( { subtrees[id].first, int(id) } );
+        }
+    }
+
+    for (const auto& node: tree.nodes())
+    {
+        if( node.model.type != NodeType::SUBTREE || node.children_index.size() != 1 )
+        {
+            continue;
+        }
+        auto id_it = subtree_ids.find( node.model.registration_ID );
+        if( id_it == subtree_ids.end() )
+        {
+            continue;
+        }
+        const AbsBehaviorTree& subtree = *subtrees[ size_t(id_it->second) ].second;
+        mapSubtreeBranch( tree, node.children_index.front(),
+                          subtree, subtree.rootNode()->children_index.front(), id_it->second, result );
+        // a single instance
+        subtree_ids.erase( id_it );
+    }
+    return result;
+}
+
+static std::pair<QtNodes::NodeStyle, QtNodes::ConnectionStyle>
+buildStyleFromStatus(NodeStatus status, NodeStatus prev_status)
 {
     QtNodes::NodeStyle  node_style;
     QtNodes::ConnectionStyle conn_style;
@@ -522,6 +645,94 @@ getStyleFromStatus(NodeStatus status, NodeStatus prev_status)
     return {node_style, conn_style};
 }
 
+const SharedStyle& getStyleFromStatus(NodeStatus status, NodeStatus prev_status)
+{
+    static const size_t NUM_STATUS = 4;
+
+    static const std::vector<SharedStyle> style_table = []()
+    {
+        const NodeStatus all_status[NUM_STATUS] = { NodeStatus::IDLE,
+                                                    NodeStatus::RUNNING,
+                                                    NodeStatus::SUCCESS,
+                                                    NodeStatus::FAILURE };
+        std::vector<SharedStyle> table( NUM_STATUS*NUM_STATUS );
+        for (NodeStatus curr: all_status)
+        {
+            for (NodeStatus prev: all_status)
+            {
+                auto style = buildStyleFromStatus( curr, prev );
+                table[ size_t(curr)*NUM_STATUS + size_t(prev) ] =
+                    { std::make_shared<const QtNodes::NodeStyle>( style.first ),
+                      std::make_shared<const QtNodes::ConnectionStyle>( style.second ) };
+            }
+        }
+        return table;
+    }();
+
+    const size_t curr_index = std::min( size_t(status), NUM_STATUS-1 );
+    const size_t prev_index = std::min( size_t(prev_status), NUM_STATUS-1 );
+    return style_table[ curr_index*NUM_STATUS + prev_index ];
+}
+
+const SharedStyle& getDefaultStyle()
+{
+    static const SharedStyle default_style =
+        { std::make_shared<const QtNodes::NodeStyle>(),
+          std::make_shared<const QtNodes::ConnectionStyle>() };
+    return default_style;
+}
+
+const SharedStyle& getHeatmapStyle(double value)
+{
+    static const std::vector<SharedStyle> style_table = []()
+    {
+        std::vector<SharedStyle> table;
+        for (int level = 0; level < HEATMAP_LEVELS; level++)
+        {
+            QtNodes::NodeStyle  node_style;
+            QtNodes::ConnectionStyle conn_style;
+            conn_style.HoveredColor = Qt::transparent;
+
+            // hue from blue (240) to red (0)
+            const qreal hue = 0.66 * (1.0 - qreal(level) / (HEATMAP_LEVELS - 1));
+            node_style.PenWidth *= 3.0;
+            node_style.HoveredPenWidth = node_style.PenWidth;
+            node_style.NormalBoundaryColor =
+                    node_style.ShadowColor = QColor::fromHsvF( hue, 0.9, 0.95 );
+            conn_style.NormalColor = node_style.NormalBoundaryColor;
+
+            table.push_back( { std::make_shared<const QtNodes::NodeStyle>( node_style ),
+                               std::make_shared<const QtNodes::ConnectionStyle>( conn_style ) } );
+        }
+        return table;
+    }();
+
+    const int level = int( std::round( std::max(0.0, std::min(1.0, value)) * (HEATMAP_LEVELS - 1) ) );
+    return style_table[ size_t(level) ];
+}
+
+std::vector<std::pair<int, NodeStatus>> encodeNodesStatus(const std::vector<NodeStatus>& status,
+                                                          const std::vector<NodeStatus>& prev_status)
+{
+    std::vector<std::pair<int, NodeStatus>> node_status;
+    node_status.reserve( status.size() + 8 );
+
+    // the first child of the Root is applied first: if RUNNING, it resets
+    // the style of the whole tree.
+    for(size_t index = 0; index < status.size(); index++)
+    {
+        const size_t i = (index == 0 && status.size() > 1) ? 1 :
+                         (index == 1) ? 0 : index;
+        // the previous status is needed only to dim the nodes back to IDLE
+        if( status[i] == NodeStatus::IDLE && prev_status[i] != NodeStatus::IDLE && i != 1 )
+        {
+            node_status.push_back( { int(i), prev_status[i] } );
+        }
+        node_status.push_back( { int(i), status[i] } );
+    }
+    return node_status;
+}
+
 QtNodes::Node *GetParentNode(QtNodes::Node *node)
 {
     using namespace QtNodes;
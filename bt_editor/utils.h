@@ -16,18 +16,65 @@ std::vector<QtNodes::Node *> getChildren(const QtNodes::FlowScene &scene,
                                          const QtNodes::Node &parent_node,
                                          bool ordered);
 
+// With "collapsed", the hidden nodes of the collapsed branches are added,
+// without graphic_node: the tree that is saved.
 AbsBehaviorTree BuildTreeFromScene(const QtNodes::FlowScene *scene,
-                                   QtNodes::Node *root_node = nullptr);
+                                   QtNodes::Node *root_node = nullptr,
+                                   bool collapsed = false);
+
+// Copies the descendants of "branch_node" under "parent", moved by "offset".
+void AppendBranch(AbsBehaviorTree& tree, AbstractTreeNode *parent,
+                  const AbsBehaviorTree& branch, const AbstractTreeNode& branch_node,
+                  QPointF offset);
 
 std::pair<AbsBehaviorTree, std::unordered_map<int, int> >
 BuildTreeFromFlatbuffers(const Serialization::BehaviorTree* bt );
 
+// The reverse, as in the header of a log: the SubTree nodes without children
+// are expanded with the trees of "subtrees", as BehaviorTree.CPP creates them.
+// Throws if the tree has more nodes than a uid can number.
+std::vector<uint8_t>
+BuildFlatbuffersFromTree(const AbsBehaviorTree& tree,
+                         const std::map<QString, const AbsBehaviorTree*>& subtrees);
+
+struct SubtreeNodeIndex
+{
+    // in the "subtrees" of MapSubtreeNodes(), -1 if in none of them
+    int subtree = -1;
+    int index = -1;
+};
+
+// For each node of "tree", where the SubTrees are expanded as BehaviorTree.CPP
+// creates them, the same node in the tree of its SubTree, as returned by
+// BuildTreeFromScene(). A SubTree used more than once is mapped from one of its
+// instances only; the mapping of a branch stops where the trees differ.
+std::vector<SubtreeNodeIndex>
+MapSubtreeNodes(const AbsBehaviorTree& tree,
+                const std::vector<std::pair<QString, const AbsBehaviorTree*>>& subtrees);
+
 AbsBehaviorTree BuildTreeFromXML(const QDomElement &bt_root, const NodeModels &models);
 
 void NodeReorder(QtNodes::FlowScene &scene, AbsBehaviorTree &abstract_tree );
 
-std::pair<QtNodes::NodeStyle, QtNodes::ConnectionStyle>
-getStyleFromStatus(NodeStatus status, NodeStatus prev_status);
+typedef std::pair<std::shared_ptr<const QtNodes::NodeStyle>,
+                  std::shared_ptr<const QtNodes::ConnectionStyle>> SharedStyle;
+
+// Styles are precomputed once for all the status/prev_status combinations
+// and shared by all the nodes: changing status does not copy anything.
+const SharedStyle& getStyleFromStatus(NodeStatus status, NodeStatus prev_status);
+
+// Style of a node that was never visited.
+const SharedStyle& getDefaultStyle();
+
+// Heatmap color, from blue (0.0) to red (1.0), in HEATMAP_LEVELS steps.
+const SharedStyle& getHeatmapStyle(double value);
+
+static const int HEATMAP_LEVELS = 16;
+
+// Status of all the nodes of a tree, encoded as expected by
+// MainWindow::onChangeNodesStatus. prev_status is used to dim the IDLE nodes.
+std::vector<std::pair<int, NodeStatus>> encodeNodesStatus(const std::vector<NodeStatus>& status,
+                                                          const std::vector<NodeStatus>& prev_status);
 
 QtNodes::Node* GetParentNode(QtNodes::Node* node);
 
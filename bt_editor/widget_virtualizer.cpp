@@ -0,0 +1,110 @@
+#include "widget_virtualizer.h"
+#include <QEvent>
+#include <nodes/Node>
+
+#include "models/BehaviorTreeNodeModel.hpp"
+
+namespace
+{
+// the widgets are attached a bit before the nodes are visible, and
+// released well after, not to rebuild them at every small scroll
+const qreal ATTACH_MARGIN = 0.5;
+const qreal KEEP_MARGIN = 1.0;
+
+QRectF enlarged(const QRectF& rect, qreal margin)
+{
+    const qreal dx = rect.width() * margin;
+    const qreal dy = rect.height() * margin;
+    return rect.adjusted( -dx, -dy, dx, dy );
+}
+}
+
+WidgetVirtualizer::WidgetVirtualizer(QtNodes::FlowScene *scene, QtNodes::FlowView *view,
+                                     QObject *parent):
+    QObject(parent),
+    _scene(scene),
+    _view(view),
+    _attached(0),
+    _released(0)
+{
+    _timer.setSingleShot(true);
+    _timer.setInterval( DELAY_MS );
+    connect( &_timer, &QTimer::timeout, this, &WidgetVirtualizer::update );
+
+    // the viewport is replaced by FlowView::setOpenGLViewport()
+    _view->installEventFilter( this );
+    _view->viewport()->installEventFilter( this );
+}
+
+bool WidgetVirtualizer::isActive() const
+{
+    return _scene && isActive( _scene->nodes().size() );
+}
+
+void WidgetVirtualizer::schedule()
+{
+    if( isActive() )
+    {
+        _timer.start();
+    }
+}
+
+bool WidgetVirtualizer::eventFilter(QObject *watched, QEvent *event)
+{
+    if( _view && watched == _view && event->type() == QEvent::ChildAdded )
+    {
+        _view->viewport()->installEventFilter( this );
+    }
+    else if( _view && watched == _view->viewport() && event->type() == QEvent::Paint &&
+             !_timer.isActive() && _view->visibleSceneRect() != _visible_rect )
+    {
+        schedule();
+    }
+    return QObject::eventFilter(watched, event);
+}
+
+void WidgetVirtualizer::update()
+{
+    _attached = 0;
+    _released = 0;
+    if( !isActive() || !_view )
+    {
+        return;
+    }
+    _visible_rect = _view->visibleSceneRect();
+    const QRectF attach_rect = enlarged( _visible_rect, ATTACH_MARGIN );
+    const QRectF keep_rect = enlarged( _visible_rect, KEEP_MARGIN );
+    // the widgets are hidden anyway below LevelOfDetail::Full
+    const bool full_detail = _scene->levelOfDetail() == QtNodes::LevelOfDetail::Full;
+
+    for (const auto& it: _scene->nodes())
+    {
+        QtNodes::Node* node = it.second.get();
+        auto bt_model = dynamic_cast<BehaviorTreeDataModel*>( node->nodeDataModel() );
+        if( !bt_model )
+        {
+            continue;
+        }
+        auto& graphic_node = node->nodeGraphicsObject();
+        const QRectF node_rect = graphic_node.sceneBoundingRect();
+
+        if( !bt_model->hasWidgets() )
+        {
+            // the locked nodes, as the copies of the subtrees, stay painted
+            if( full_detail && !bt_model->isLocked() && attach_rect.intersects( node_rect ) )
+            {
+                bt_model->createWidgets();
+                graphic_node.updateEmbeddedQWidget();
+                _attached++;
+            }
+        }
+        else if( !full_detail || !keep_rect.intersects( node_rect ) )
+        {
+            if( bt_model->releaseWidgets() )
+            {
+                graphic_node.updateEmbeddedQWidget();
+                _released++;
+            }
+        }
+    }
+}
@@ -0,0 +1,56 @@
+#ifndef WIDGET_VIRTUALIZER_H
+#define WIDGET_VIRTUALIZER_H
+
+#include <QObject>
+#include <QPointer>
+#include <QRectF>
+#include <QTimer>
+
+#include <nodes/FlowScene>
+#include <nodes/FlowView>
+
+// In the large trees, only the nodes around the visible part of the scene
+// have their widgets: the others are painted by their model (see
+// BehaviorTreeDataModel::paintContent()) and their widgets go back to the
+// pool of BehaviorTreeDataModel::releaseWidgets(). Updated a short while
+// after the view is panned or zoomed, and after schedule().
+class WidgetVirtualizer : public QObject
+{
+    Q_OBJECT
+
+public:
+    WidgetVirtualizer(QtNodes::FlowScene* scene, QtNodes::FlowView* view,
+                      QObject* parent = nullptr);
+
+    // below it, every node keeps its widgets
+    static const size_t MIN_NODES = 200;
+
+    static bool isActive(size_t nodes_count) { return nodes_count >= MIN_NODES; }
+
+    bool isActive() const;
+
+    // after the scene is rebuilt or (un)locked
+    void schedule();
+
+    // the widgets attached and released by the last update()
+    int attachedCount() const { return _attached; }
+    int releasedCount() const { return _released; }
+
+public slots:
+    void update();
+
+protected:
+    bool eventFilter(QObject* watched, QEvent* event) override;
+
+private:
+    QPointer<QtNodes::FlowScene> _scene;
+    QPointer<QtNodes::FlowView> _view;
+    QTimer _timer;
+    QRectF _visible_rect;
+    int _attached;
+    int _released;
+
+    static const int DELAY_MS = 50;
+};
+
+#endif // WIDGET_VIRTUALIZER_H
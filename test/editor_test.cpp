@@ -2,6 +2,7 @@
 #include "bt_editor/sidepanel_editor.h"
 #include <QAction>
 #include <QLineEdit>
+#include <QTreeView>
 
 class EditorTest : public GrootTestBase
 {
@@ -17,6 +18,7 @@ private slots:
     void renameTabs();
     void loadFile();
     void loadFailed();
+    void loadInclude();
     void savedFileSameAsOriginal();
     void undoRedo();
     void testSubtree();
@@ -27,6 +29,10 @@ private slots:
     void longNames();
     void clearModels();
     void undoWithSubtreeExpanded();
+    void copyPasteNodes();
+    void collapseBranch();
+    void mapSubtreeNodes();
+    void repaintCounters();
 };
 
 
@@ -131,6 +137,27 @@ void EditorTest::loadFile()
     sleepAndRefresh( 500 );
 }
 
+void EditorTest::loadInclude()
+{
+    QString file_xml = readFile(":/include_main.xml");
+    main_win->on_actionClear_triggered();
+    main_win->loadFromXML( file_xml, ":/" );
+
+    auto main_tree = getAbstractTree("MainTree");
+    auto included_tree = getAbstractTree("PassDoor");
+    QCOMPARE( main_tree.nodesCount(), size_t(4) );
+    QCOMPARE( included_tree.nodesCount(), size_t(4) );
+
+    auto window_node = included_tree.findFirstNode("PassThroughWindow");
+    QVERIFY( window_node != nullptr );
+    QCOMPARE( window_node->ports_mapping.at("speed"), QString("{fast}") );
+
+    // read from the cache
+    main_win->loadFromXML( file_xml, ":/" );
+    QCOMPARE( getAbstractTree("PassDoor"), included_tree );
+    sleepAndRefresh( 500 );
+}
+
 void EditorTest::savedFileSameAsOriginal()
 {
     QString file_xml = readFile(":/test_xml_key_reordering_issue.xml");
@@ -373,10 +400,12 @@ void EditorTest::testSubtree()
 
     button_lock->setChecked(false);
 
-    QTreeWidget* treeWidget = main_win->findChild<QTreeWidget*>("paletteTreeWidget");
-    QVERIFY2(treeWidget != nullptr, "Can't find the object [paletteTreeWidget]");
+    QTreeView* treeView = main_win->findChild<QTreeView*>("paletteTreeView");
+    QVERIFY2(treeView != nullptr, "Can't find the object [paletteTreeView]");
 
-    auto subtree_items = treeWidget->findItems("DoorClosed", Qt::MatchExactly | Qt::MatchRecursive);
+    auto palette = treeView->model();
+    auto subtree_items = palette->match( palette->index(0,0), Qt::DisplayRole, "DoorClosed", -1,
+                                         Qt::MatchExactly | Qt::MatchRecursive);
     sleepAndRefresh( 500 );
 
     QCOMPARE(subtree_items.size(), 1);
@@ -438,7 +467,8 @@ void EditorTest::modifyCustomModel()
     button_lock->setChecked(false);
 
     auto sidepanel_editor = main_win->findChild<SidepanelEditor*>("SidepanelEditor");
-    auto treeWidget = sidepanel_editor->findChild<QTreeWidget*>("paletteTreeWidget");
+    auto treeView = sidepanel_editor->findChild<QTreeView*>("paletteTreeView");
+    auto palette = treeView->model();
 
     NodeModel jump_model = { NodeType::ACTION,
                              "JumpOutWindow",
@@ -447,12 +477,12 @@ void EditorTest::modifyCustomModel()
 
     sidepanel_editor->onReplaceModel("PassThroughWindow", jump_model);
 
-    auto pass_window_items = treeWidget->findItems("PassThroughWindow",
-                                                   Qt::MatchExactly | Qt::MatchRecursive);
+    auto pass_window_items = palette->match( palette->index(0,0), Qt::DisplayRole, "PassThroughWindow", -1,
+                                             Qt::MatchExactly | Qt::MatchRecursive);
     QCOMPARE( pass_window_items.empty(), true);
 
-    auto jump_window_items = treeWidget->findItems( jump_model.registration_ID,
-                                                    Qt::MatchExactly | Qt::MatchRecursive);
+    auto jump_window_items = palette->match( palette->index(0,0), Qt::DisplayRole, jump_model.registration_ID, -1,
+                                             Qt::MatchExactly | Qt::MatchRecursive);
     QCOMPARE( jump_window_items.size(), 1);
 
     auto abs_tree = getAbstractTree();
@@ -633,6 +663,135 @@ void EditorTest::undoWithSubtreeExpanded()
      sleepAndRefresh( 500 );
 }
 
+void EditorTest::copyPasteNodes()
+{
+    QString file_xml = readFile(":/crossdoor_with_subtree.xml");
+    main_win->on_actionClear_triggered();
+    main_win->loadFromXML( file_xml );
+
+    auto scene = main_win->getTabByName("MainTree")->scene();
+    const int node_count_A = scene->nodes().size();
+    const int connection_count_A = scene->connections().size();
+
+    for (const auto& it: scene->nodes())
+    {
+        it.second->nodeGraphicsObject().setSelected( true );
+    }
+    scene->copySelection();
+    QVERIFY( scene->pasteNodes( QPointF( 0, 2000 ) ) );
+
+    // Root is not copied, its connection neither
+    QCOMPARE( int( scene->nodes().size() ), 2 * node_count_A - 1 );
+    QCOMPARE( int( scene->connections().size() ), 2 * connection_count_A - 1 );
+
+    // a single step
+    main_win->onUndoInvoked();
+    scene = main_win->getTabByName("MainTree")->scene();
+    QCOMPARE( int( scene->nodes().size() ), node_count_A );
+
+    sleepAndRefresh( 500 );
+}
+
+void EditorTest::collapseBranch()
+{
+    QString file_xml = readFile(":/crossdoor_with_subtree.xml");
+    main_win->on_actionClear_triggered();
+    main_win->loadFromXML( file_xml );
+
+    auto scene = main_win->getTabByName("MainTree")->scene();
+    const int node_count = scene->nodes().size();
+
+    QtNodes::Node* root = findRoot( *scene );
+    QtNodes::Node* branch = getChildren( *scene, *root, true ).front();
+    QVERIFY( scene->collapseBranch( *branch ) );
+    QCOMPARE( int( scene->nodes().size() ), 2 );
+
+    // the hidden nodes are usages of their model
+    auto bt_model = dynamic_cast<BehaviorTreeDataModel*>( branch->nodeDataModel() );
+    const QString hidden_ID = bt_model->collapsedBranch()->nodes().back().model.registration_ID;
+    QVERIFY( scene->nodesOfModel( hidden_ID ).empty() );
+    QCOMPARE( int( scene->collapsedUsages( hidden_ID ).size() ), 1 );
+    QVERIFY( main_win->getTabByName("MainTree")->usesModel( hidden_ID ) );
+
+    // the hidden nodes are saved
+    QVERIFY2( file_xml.simplified() == main_win->saveToXML().simplified(),
+              "Collapsed branch not saved" );
+
+    QVERIFY( scene->expandBranch( *branch ) );
+    QCOMPARE( int( scene->nodes().size() ), node_count );
+    QVERIFY( file_xml.simplified() == main_win->saveToXML().simplified() );
+
+    sleepAndRefresh( 500 );
+}
+
+void EditorTest::mapSubtreeNodes()
+{
+    QString file_xml = readFile(":/crossdoor_with_subtree.xml");
+    main_win->on_actionClear_triggered();
+    main_win->loadFromXML( file_xml );
+
+    const AbsBehaviorTree main_tree = BuildTreeFromScene( main_win->getTabByName("MainTree")->scene() );
+    const AbsBehaviorTree subtree   = BuildTreeFromScene( main_win->getTabByName("DoorClosed")->scene() );
+
+    // as received by the monitor, with the SubTrees expanded
+    const std::vector<uint8_t> buffer = BuildFlatbuffersFromTree( main_tree, { {"DoorClosed", &subtree} } );
+    const AbsBehaviorTree tree = BuildTreeFromFlatbuffers( Serialization::GetBehaviorTree( buffer.data() ) ).first;
+
+    const auto mapping = MapSubtreeNodes( tree, { {"DoorClosed", &subtree} } );
+    QCOMPARE( mapping.size(), tree.nodesCount() );
+
+    size_t mapped = 0;
+    for (size_t index = 0; index < mapping.size(); index++)
+    {
+        if( mapping[index].subtree < 0 )
+        {
+            continue;
+        }
+        QCOMPARE( mapping[index].subtree, 0 );
+        QCOMPARE( tree.node(index)->model.registration_ID,
+                  subtree.node( size_t(mapping[index].index) )->model.registration_ID );
+        mapped++;
+    }
+    // used twice, mapped once, without its Root
+    QCOMPARE( mapped, subtree.nodesCount() - 1 );
+}
+
+void EditorTest::repaintCounters()
+{
+    main_win->on_actionClear_triggered();
+    main_win->loadFromXML( readFile(":/crossdoor_with_subtree.xml") );
+    sleepAndRefresh( 100 );
+
+    auto container = main_win->currentTabInfo();
+    auto view = container->view();
+    auto scene = container->scene();
+
+    for( bool static_layer: {false, true} )
+    {
+        scene->setStaticLayer( static_layer );
+        if( static_layer )
+        {
+            // the tiles are rendered by the first frame only
+            view->viewport()->repaint();
+            QVERIFY( view->frameStats().tilesRendered > 0 );
+        }
+        // the counters of the performance overlay: every node in view is
+        // painted again, none comes from a cache
+        for(auto& node_it: scene->nodes())
+        {
+            node_it.second->nodeGraphicsObject().update();
+        }
+        view->viewport()->repaint();
+        const QtNodes::FrameStats stats = view->frameStats();
+        QVERIFY( stats.nodesRepainted > 0 );
+        if( static_layer )
+        {
+            QCOMPARE( stats.tilesRendered, 0 );
+        }
+    }
+    scene->setStaticLayer( false );
+}
+
 QTEST_MAIN(EditorTest)
 
 #include "editor_test.moc"
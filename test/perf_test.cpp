@@ -0,0 +1,498 @@
+#include "groot_test_base.h"
+#include "bt_editor/sidepanel_replay.h"
+#include "bt_editor/synthetic_trees.h"
+#include "bt_editor/log_format.h"
+#include <QSlider>
+#include <QtEndian>
+
+#ifdef ZMQ_FOUND
+#include "bt_editor/monitor_receiver.h"
+#endif
+
+// Time of the operations that grow with the size of the trees and of the
+// logs, on synthetic ones. Not run by ctest: "make run_perf_test" writes
+// the results to perf_test.csv, to be compared release over release.
+class PerfTest : public GrootTestBase
+{
+    Q_OBJECT
+
+public:
+    PerfTest() {}
+    ~PerfTest() {}
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void xmlLoad_data();
+    void xmlLoad();
+    void xmlSave_data();
+    void xmlSave();
+    void sceneBuild_data();
+    void sceneBuild();
+    void modelCreate();
+    void nodeReorder_data();
+    void nodeReorder();
+    void undoPush_data();
+    void undoPush();
+    void undoRestore_data();
+    void undoRestore();
+    void groupMove_data();
+    void groupMove();
+    void nodeLocate_data();
+    void nodeLocate();
+    void statusStorm_data();
+    void statusStorm();
+    void widgetScroll_data();
+    void widgetScroll();
+    void logLoad_data();
+    void logLoad();
+    void logSeek_data();
+    void logSeek();
+#ifdef ZMQ_FOUND
+    void monitorDecode_data();
+    void monitorDecode();
+#endif
+
+private:
+    MainWindow* replay_win;
+    SidepanelReplay* sidepanel_replay;
+
+    void addTreeSizes();
+
+    void addLogSizes();
+
+    // the nodes of the tree loaded, without the Root
+    int loadSyntheticTree(int depth);
+};
+
+namespace
+{
+
+// depth 4, 6 and 8: about 90, 1500 and 24000 nodes
+TreeFileContent syntheticTrees(int depth)
+{
+    SyntheticTreeOptions options;
+    options.depth = depth;
+    options.branching = 4;
+    return GenerateSyntheticTrees( options );
+}
+
+QString syntheticTreeXML(int depth)
+{
+    return QString::fromUtf8( WriteTreeFileXML( syntheticTrees( depth ) ) );
+}
+
+QByteArray syntheticLog(int depth, size_t transitions)
+{
+    SyntheticLogOptions options;
+    options.transitions = transitions;
+    return GenerateSyntheticLog( syntheticTrees( depth ), options );
+}
+
+}
+
+void PerfTest::initTestCase()
+{
+    main_win = new MainWindow(GraphicMode::EDITOR, nullptr);
+    main_win->resize(1200, 800);
+    main_win->show();
+
+    replay_win = new MainWindow(GraphicMode::REPLAY, nullptr);
+    replay_win->resize(1200, 800);
+    sidepanel_replay = replay_win->findChild<SidepanelReplay*>("SidepanelReplay");
+    QVERIFY2( sidepanel_replay, "Can't get pointer to SidepanelReplay" );
+}
+
+void PerfTest::cleanupTestCase()
+{
+    QApplication::processEvents();
+    main_win->on_actionClear_triggered();
+    main_win->close();
+    replay_win->on_actionClear_triggered();
+    replay_win->close();
+}
+
+void PerfTest::addTreeSizes()
+{
+    QTest::addColumn<int>("depth");
+    for (int depth: { 4, 6, 8 })
+    {
+        const size_t nodes = syntheticTrees( depth ).nodesCount();
+        QTest::newRow( QString("%1 nodes").arg(nodes).toLocal8Bit() ) << depth;
+    }
+}
+
+void PerfTest::addLogSizes()
+{
+    QTest::addColumn<int>("transitions");
+    for (int transitions: { 10000, 1000000 })
+    {
+        QTest::newRow( QString("%1 transitions").arg(transitions).toLocal8Bit() ) << transitions;
+    }
+}
+
+int PerfTest::loadSyntheticTree(int depth)
+{
+    main_win->on_actionClear_triggered();
+    main_win->loadFromXML( syntheticTreeXML( depth ) );
+    QApplication::processEvents();
+    return int( getAbstractTree().nodesCount() ) - 1;
+}
+
+void PerfTest::xmlLoad_data()
+{
+    addTreeSizes();
+}
+
+void PerfTest::xmlLoad()
+{
+    QFETCH(int, depth);
+    const TreeFileContent content = syntheticTrees( depth );
+    const QString xml = QString::fromUtf8( WriteTreeFileXML( content ) );
+
+    QBENCHMARK
+    {
+        main_win->loadFromXML( xml );
+    }
+    QCOMPARE( getAbstractTree().nodesCount(), content.nodesCount() + 1 );
+}
+
+void PerfTest::xmlSave_data()
+{
+    addTreeSizes();
+}
+
+void PerfTest::xmlSave()
+{
+    QFETCH(int, depth);
+    loadSyntheticTree( depth );
+
+    QString xml;
+    QBENCHMARK
+    {
+        xml = main_win->saveToXML();
+    }
+    QVERIFY( xml.contains( "Action_0" ) );
+}
+
+void PerfTest::sceneBuild_data()
+{
+    addTreeSizes();
+}
+
+void PerfTest::sceneBuild()
+{
+    QFETCH(int, depth);
+    loadSyntheticTree( depth );
+    const AbsBehaviorTree tree = getAbstractTree();
+
+    QBENCHMARK
+    {
+        main_win->onCreateAbsBehaviorTree( tree, "BehaviorTree", false );
+        // the build of the large trees is completed
+        main_win->currentTabInfo()->scene();
+    }
+}
+
+void PerfTest::modelCreate()
+{
+    NodeModel model;
+    model.type = NodeType::ACTION;
+    model.registration_ID = "PerfAction";
+    for (int i = 0; i < 4; i++)
+    {
+        PortModel port;
+        port.direction = ( i % 2 ) ? PortDirection::OUTPUT : PortDirection::INPUT;
+        model.ports.insert( { QString("port_%1").arg(i), port } );
+    }
+    const bool painted = BehaviorTreeDataModel::paintedMode();
+    BehaviorTreeDataModel::setPaintedMode( false );
+
+    // the first node of the model is not measured
+    BehaviorTreeDataModel first( model );
+    delete first.embeddedWidget();
+
+    QBENCHMARK
+    {
+        BehaviorTreeDataModel node_model( model );
+        // owned by the proxy of the node, usually
+        delete node_model.embeddedWidget();
+    }
+    BehaviorTreeDataModel::setPaintedMode( painted );
+}
+
+void PerfTest::nodeReorder_data()
+{
+    addTreeSizes();
+}
+
+void PerfTest::nodeReorder()
+{
+    QFETCH(int, depth);
+    loadSyntheticTree( depth );
+    AbsBehaviorTree tree = getAbstractTree();
+    auto scene = main_win->currentTabInfo()->scene();
+
+    QBENCHMARK
+    {
+        NodeReorder( *scene, tree );
+    }
+}
+
+void PerfTest::undoPush_data()
+{
+    addTreeSizes();
+}
+
+void PerfTest::undoPush()
+{
+    QFETCH(int, depth);
+    loadSyntheticTree( depth );
+    auto scene = main_win->currentTabInfo()->scene();
+    QtNodes::Node* node = scene->nodes().begin()->second.get();
+
+    // a step per move of a node
+    QBENCHMARK
+    {
+        node->nodeGraphicsObject().moveBy( 10, 0 );
+        main_win->onPushUndo();
+    }
+}
+
+void PerfTest::undoRestore_data()
+{
+    addTreeSizes();
+}
+
+void PerfTest::undoRestore()
+{
+    QFETCH(int, depth);
+    loadSyntheticTree( depth );
+    auto scene = main_win->currentTabInfo()->scene();
+    QtNodes::Node* node = scene->nodes().begin()->second.get();
+    node->nodeGraphicsObject().moveBy( 10, 0 );
+    main_win->onPushUndo();
+
+    QBENCHMARK
+    {
+        main_win->onUndoInvoked();
+        main_win->onRedoInvoked();
+    }
+}
+
+void PerfTest::groupMove_data()
+{
+    addTreeSizes();
+}
+
+void PerfTest::groupMove()
+{
+    QFETCH(int, depth);
+    loadSyntheticTree( depth );
+    auto scene = main_win->currentTabInfo()->scene();
+    for (const auto& it: scene->nodes())
+    {
+        it.second->nodeGraphicsObject().setSelected( true );
+    }
+    QtNodes::Node* grabbed = scene->selectedNodes().front();
+
+    // a mouse move of a drag of the whole tree
+    int step = 0;
+    QBENCHMARK
+    {
+        step++;
+        scene->moveNodes( *grabbed, QPointF( ( step % 2 ) ? 10 : -10, 0 ) );
+    }
+    QCOMPARE( scene->takeMovedNodes().size(), scene->selectedNodes().size() );
+}
+
+void PerfTest::nodeLocate_data()
+{
+    addTreeSizes();
+}
+
+void PerfTest::nodeLocate()
+{
+    QFETCH(int, depth);
+    loadSyntheticTree( depth );
+    auto scene = main_win->currentTabInfo()->scene();
+    QtNodes::Node* node = scene->nodes().begin()->second.get();
+    const QPointF center = node->nodeGraphicsObject().sceneBoundingRect().center();
+
+    // as the connections dragged over the nodes
+    QtNodes::Node* found = nullptr;
+    QBENCHMARK
+    {
+        found = QtNodes::locateNodeAt( center, *scene, QTransform() );
+    }
+    QCOMPARE( found, node );
+}
+
+void PerfTest::statusStorm_data()
+{
+    addTreeSizes();
+}
+
+void PerfTest::statusStorm()
+{
+    QFETCH(int, depth);
+    const int nodes = loadSyntheticTree( depth );
+
+    // every node changes at every message, and the frame is painted
+    std::vector<std::pair<int, NodeStatus>> running, idle;
+    for (int index = 1; index <= nodes; index++)
+    {
+        running.push_back( { index, NodeStatus::RUNNING } );
+        idle.push_back( { index, NodeStatus::IDLE } );
+    }
+    QBENCHMARK
+    {
+        main_win->onChangeNodesStatus( "BehaviorTree", running );
+        QApplication::processEvents();
+        main_win->onChangeNodesStatus( "BehaviorTree", idle );
+        QApplication::processEvents();
+    }
+}
+
+void PerfTest::widgetScroll_data()
+{
+    addTreeSizes();
+}
+
+void PerfTest::widgetScroll()
+{
+    QFETCH(int, depth);
+    const int nodes = loadSyntheticTree( depth );
+    auto container = main_win->currentTabInfo();
+    auto scene = container->scene();
+    auto view = container->view();
+    container->zoomHomeView();
+    view->scale( 4, 4 );
+
+    // the widgets follow the view, in the large trees only
+    auto countWidgets = [scene]()
+    {
+        int count = 0;
+        for (const auto& it: scene->nodes())
+        {
+            auto bt_model = dynamic_cast<BehaviorTreeDataModel*>( it.second->nodeDataModel() );
+            count += ( bt_model && bt_model->hasWidgets() ) ? 1 : 0;
+        }
+        return count;
+    };
+    const QRectF bounds = scene->itemsBoundingRect();
+    int step = 0;
+    QBENCHMARK
+    {
+        step = ( step + 1 ) % 8;
+        view->centerScene( QPointF( bounds.left() + bounds.width() * step / 8.0,
+                                    bounds.center().y() ) );
+        container->widgetVirtualizer()->update();
+    }
+    if( WidgetVirtualizer::isActive( size_t(nodes) ) )
+    {
+        QVERIFY( countWidgets() < nodes / 2 );
+    }
+    else{
+        QVERIFY( countWidgets() >= nodes );
+    }
+}
+
+void PerfTest::logLoad_data()
+{
+    addLogSizes();
+}
+
+void PerfTest::logLoad()
+{
+    QFETCH(int, transitions);
+    const QByteArray log = syntheticLog( 6, size_t(transitions) );
+
+    QBENCHMARK
+    {
+        sidepanel_replay->loadLog( log );
+        while( sidepanel_replay->isLoading() )
+        {
+            QTest::qWait( 1 );
+        }
+    }
+    QCOMPARE( sidepanel_replay->transitionsCount(), size_t(transitions) );
+}
+
+void PerfTest::logSeek_data()
+{
+    addLogSizes();
+}
+
+void PerfTest::logSeek()
+{
+    QFETCH(int, transitions);
+    sidepanel_replay->loadLog( syntheticLog( 6, size_t(transitions) ) );
+    while( sidepanel_replay->isLoading() )
+    {
+        QTest::qWait( 1 );
+    }
+    auto slider = sidepanel_replay->findChild<QSlider*>("timeSlider");
+    QVERIFY( slider && slider->maximum() > 0 );
+
+    // jumps all over the log, as with the slider
+    int seek = 0;
+    QBENCHMARK
+    {
+        seek = ( seek + 7919 ) % slider->maximum();
+        slider->setValue( seek );
+    }
+}
+
+#ifdef ZMQ_FOUND
+void PerfTest::monitorDecode_data()
+{
+    addTreeSizes();
+}
+
+void PerfTest::monitorDecode()
+{
+    QFETCH(int, depth);
+    const TreeFileContent content = syntheticTrees( depth );
+    const int nodes = int( content.nodesCount() );
+
+    // the transitions of a log, in the same layout
+    SyntheticLogOptions log_options;
+    log_options.transitions = size_t( std::min( nodes, 1000 ) );
+    const QByteArray log = GenerateSyntheticLog( content, log_options );
+    size_t tree_offset = 0;
+    size_t tree_size = 0;
+    QVERIFY( logTreeLocation( log.constData(), size_t( log.size() ), tree_offset, tree_size ) );
+    const QByteArray transitions = log.mid( int( tree_offset + tree_size ) );
+
+    // the layout of BT::PublisherZMQ: the status of every node, then the
+    // transitions since the previous message
+    QByteArray buffer( 4, '\0' );
+    qToLittleEndian<quint32>( quint32( nodes * 3 ), reinterpret_cast<uchar*>( buffer.data() ) );
+    for (int uid = 1; uid <= nodes; uid++)
+    {
+        uchar node_status[3];
+        qToLittleEndian<quint16>( quint16( uid ), node_status );
+        node_status[2] = uchar( uid % 3 );
+        buffer.append( reinterpret_cast<const char*>( node_status ), 3 );
+    }
+    QByteArray count( 4, '\0' );
+    qToLittleEndian<quint32>( quint32( transitions.size() / 12 ), reinterpret_cast<uchar*>( count.data() ) );
+    buffer.append( count );
+    buffer.append( transitions );
+
+    const zmq::message_t msg( buffer.constData(), size_t( buffer.size() ) );
+    MonitorMessage decoded;
+    QBENCHMARK
+    {
+        MonitorReceiver::decode( msg, decoded );
+    }
+    QCOMPARE( int( decoded.header.size() ), nodes );
+    QCOMPARE( decoded.transitions.size(), log_options.transitions );
+}
+#endif
+
+QTEST_MAIN(PerfTest)
+
+#include "perf_test.moc"
@@ -1,6 +1,12 @@
 #include "groot_test_base.h"
 #include "bt_editor/sidepanel_replay.h"
+#include "bt_editor/log_recorder.h"
+#include "bt_editor/log_format.h"
+#include "bt_editor/replay_query.h"
 #include <QAction>
+#include <QTemporaryDir>
+#include <QtEndian>
+#include <limits>
 
 class ReplyTest : public GrootTestBase
 {
@@ -14,8 +20,31 @@ private slots:
     void initTestCase();
     void cleanupTestCase();
     void basicLoad();
+    void recordedLogLoad();
+    void corruptLogIndex();
+    void queryParse();
+    void queryRun();
 };
 
+namespace {
+
+AbsBehaviorTree queryTree()
+{
+    AbsBehaviorTree tree;
+    AbstractTreeNode root;
+    root.instance_name = "Root";
+    AbstractTreeNode* root_node = tree.addNode( nullptr, std::move(root) );
+    for(const char* name: { "Approach", "Wait", "Open door" })
+    {
+        AbstractTreeNode node;
+        node.instance_name = name;
+        tree.addNode( root_node, std::move(node) );
+    }
+    return tree;
+}
+
+} // end anonymous namespace
+
 
 void ReplyTest::initTestCase()
 {
@@ -43,6 +72,167 @@ void ReplyTest::basicLoad()
     QCOMPARE( sidepanel_replay->transitionsCount(), size_t(27) );
 }
 
+void ReplyTest::recordedLogLoad()
+{
+    auto sidepanel_replay = main_win->findChild<SidepanelReplay*>("SidepanelReplay");
+    QVERIFY2( sidepanel_replay, "Can't get pointer to SidepanelReplay" );
+
+    // convert the version 1 log to the formats written by LogRecorder
+    QByteArray log = readFile("://crossdoor_trace.fbl");
+    const int tree_size = int( qFromLittleEndian<quint32>(
+                                   reinterpret_cast<const uchar*>(log.constData()) ) );
+    const QByteArray tree_buffer = log.mid( 4, tree_size );
+    const QByteArray transitions = log.mid( 4 + tree_size );
+
+    QTemporaryDir dir;
+    QVERIFY( dir.isValid() );
+
+    for( bool compressed: {false, true} )
+    {
+        const QString filename = dir.filePath( compressed ? "v3.fbl" : "v2.fbl" );
+        {
+            LogRecorder recorder( filename );
+            QVERIFY2( recorder.open( tree_buffer, compressed ), qPrintable(recorder.errorString()) );
+            recorder.start();
+            recorder.append( transitions );
+        }
+        QFile file( filename );
+        QVERIFY( file.open( QIODevice::ReadOnly ) );
+        sidepanel_replay->loadLog( file.readAll() );
+
+        QCOMPARE( sidepanel_replay->transitionsCount(), size_t(27) );
+    }
+}
+
+void ReplyTest::corruptLogIndex()
+{
+    QByteArray log = readFile("://crossdoor_trace.fbl");
+    const int tree_size = int( qFromLittleEndian<quint32>(
+                                   reinterpret_cast<const uchar*>(log.constData()) ) );
+    QTemporaryDir dir;
+    QVERIFY( dir.isValid() );
+    const QString filename = dir.filePath( "v2.fbl" );
+    {
+        LogRecorder recorder( filename );
+        QVERIFY2( recorder.open( log.mid( 4, tree_size ), false ), qPrintable(recorder.errorString()) );
+        recorder.start();
+        recorder.append( log.mid( 4 + tree_size ) );
+    }
+    QFile file( filename );
+    QVERIFY( file.open( QIODevice::ReadOnly ) );
+    const QByteArray recorded = file.readAll();
+
+    LogIndex index;
+    QVERIFY( readLogIndex( recorded.constData(), size_t( recorded.size() ), index ) );
+    QVERIFY( !index.blocks.empty() );
+
+    const QByteArray without_trailer = recorded.left( recorded.size() - int(LOG_TRAILER_SIZE) );
+
+    // truncated
+    const QByteArray truncated = recorded.left( recorded.size() - 5 );
+    QVERIFY( !readLogIndex( truncated.constData(), size_t( truncated.size() ), index ) );
+
+    // a footer offset past the end, that wraps around with the size of the index
+    const uint32_t block_count = uint32_t( recorded.size() );
+    const uint64_t wrapping_offset = uint64_t( recorded.size() ) - LOG_TRAILER_SIZE -
+                                     uint64_t( block_count ) * LOG_BLOCK_INFO_SIZE;
+    QByteArray corrupt = without_trailer + logTrailer( wrapping_offset, block_count );
+    QVERIFY( !readLogIndex( corrupt.constData(), size_t( corrupt.size() ), index ) );
+    QVERIFY( index.blocks.empty() );
+
+    // the offset of the first block, past the footer
+    QVERIFY( readLogIndex( recorded.constData(), size_t( recorded.size() ), index ) );
+    corrupt = recorded;
+    qToLittleEndian<quint64>( std::numeric_limits<quint64>::max() - 2,
+                              reinterpret_cast<uchar*>( corrupt.data() + index.footer_offset ) );
+    QVERIFY( !readLogIndex( corrupt.constData(), size_t( corrupt.size() ), index ) );
+}
+
+void ReplyTest::queryParse()
+{
+    const AbsBehaviorTree tree = queryTree();
+    ReplayQuery query;
+    QString error;
+
+    QVERIFY2( query.parse( "Wait FAILURE after Approach RUNNING within 50ms", tree, error ),
+              qPrintable(error) );
+    QVERIFY2( query.parse( "node wait failure after APPROACH running within 50 ms", tree, error ),
+              qPrintable(error) );
+    QVERIFY2( query.parse( "\"Open door\" SUCCESS from RUNNING in 10..20", tree, error ),
+              qPrintable(error) );
+    QVERIFY2( query.parse( "* FAILURE in 10 .. 20", tree, error ), qPrintable(error) );
+
+    const char* invalid[] = {
+        "Unknown SUCCESS",
+        "\"Open door SUCCESS",
+        "Wait FAILURE after",
+        "Wait from",
+        "Wait after Approach within fast",
+        "Wait in 10",
+        "Wait FAILURE extra"
+    };
+    for(const char* text: invalid)
+    {
+        QVERIFY2( !query.parse( text, tree, error ), text );
+        QVERIFY2( !error.isEmpty(), text );
+    }
+}
+
+void ReplyTest::queryRun()
+{
+    const AbsBehaviorTree tree = queryTree();
+    const int nodes_count = int( tree.nodesCount() );
+    const int approach = 1;
+    const int wait = 2;
+    const int door = 3;
+
+    std::vector<Transition> transitions = {
+        { approach, 0.00, NodeStatus::IDLE,    NodeStatus::RUNNING, false, 0 },
+        { wait,     0.01, NodeStatus::IDLE,    NodeStatus::FAILURE, false, 0 },
+        { wait,     0.20, NodeStatus::IDLE,    NodeStatus::FAILURE, false, 0 },
+        { approach, 0.30, NodeStatus::IDLE,    NodeStatus::RUNNING, false, 0 },
+        { wait,     0.32, NodeStatus::IDLE,    NodeStatus::FAILURE, false, 0 },
+        { door,     1.00, NodeStatus::RUNNING, NodeStatus::SUCCESS, false, 0 }
+    };
+    TransitionStore store;
+    store.append( transitions );
+    ReplayQueryIndex index;
+    index.update( store, nodes_count );
+
+    auto run = [&](const char* text) -> std::vector<int>
+    {
+        ReplayQuery query;
+        QString error;
+        if( !query.parse( text, tree, error ) )
+        {
+            qWarning() << text << error;
+            return { -1 };
+        }
+        return query.run( store, index );
+    };
+
+    QCOMPARE( run("Wait FAILURE"), std::vector<int>({ 1, 2, 4 }) );
+    QCOMPARE( run("Wait FAILURE after Approach RUNNING"), std::vector<int>({ 1, 2, 4 }) );
+    QCOMPARE( run("Wait FAILURE after Approach RUNNING within 50ms"), std::vector<int>({ 1, 4 }) );
+    QCOMPARE( run("Approach after Wait"), std::vector<int>({ 3 }) );
+    // each "after" applies to the event just before it
+    QCOMPARE( run("* FAILURE after Approach RUNNING within 50ms after Wait FAILURE within 200ms"),
+              std::vector<int>({ 4 }) );
+    QCOMPARE( run("* FAILURE after Approach RUNNING within 50ms after Wait FAILURE within 50ms"),
+              std::vector<int>() );
+    QCOMPARE( run("\"Open door\" SUCCESS from RUNNING"), std::vector<int>({ 5 }) );
+    QCOMPARE( run("\"Open door\" SUCCESS from IDLE"), std::vector<int>() );
+    QCOMPARE( run("Wait FAILURE in 0.1..0.25"), std::vector<int>({ 2 }) );
+    QCOMPARE( run("* after Approach in 0.25 .. 2"), std::vector<int>({ 3, 4, 5 }) );
+
+    // a query cancelled before it runs finds nothing
+    ReplayQuery query;
+    QString error;
+    QVERIFY( query.parse( "Wait FAILURE", tree, error ) );
+    std::atomic<bool> cancelled( true );
+    QVERIFY( query.run( store, index, &cancelled ).empty() );
+}
+
 QTEST_MAIN(ReplyTest)
 
 #include "replay_test.moc"
@@ -0,0 +1,100 @@
+#include "groot_test_base.h"
+#include <QOpenGLWidget>
+#include <QOpenGLContext>
+
+// Time of a frame with the raster and the OpenGL viewports, when every
+// node changes status (its cached pixmap must be painted again), and with
+// the static layer of the locked scenes. Not run by ctest: the counters of
+// the frames are checked by editor_test.
+class ViewportBenchmark : public GrootTestBase
+{
+    Q_OBJECT
+
+public:
+    ViewportBenchmark() {}
+    ~ViewportBenchmark() {}
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void paintFrame_data();
+    void paintFrame();
+};
+
+
+void ViewportBenchmark::initTestCase()
+{
+    main_win = new MainWindow(GraphicMode::EDITOR, nullptr);
+    main_win->resize(1200, 800);
+    main_win->show();
+}
+
+void ViewportBenchmark::cleanupTestCase()
+{
+    QApplication::processEvents();
+    main_win->on_actionClear_triggered();
+    main_win->close();
+}
+
+void ViewportBenchmark::paintFrame_data()
+{
+    QTest::addColumn<QString>("file");
+    QTest::addColumn<bool>("opengl");
+    QTest::addColumn<bool>("static_layer");
+
+    for(const char* file: { ":/crossdoor_with_subtree.xml",
+                            ":/show_all.xml",
+                            ":/test_subtrees_issue_8.xml" } )
+    {
+        QTest::newRow( QString("%1 raster").arg(file).toLocal8Bit() ) << QString(file) << false << false;
+        QTest::newRow( QString("%1 opengl").arg(file).toLocal8Bit() ) << QString(file) << true << false;
+        QTest::newRow( QString("%1 static layer").arg(file).toLocal8Bit() ) << QString(file) << false << true;
+    }
+}
+
+void ViewportBenchmark::paintFrame()
+{
+    QFETCH(QString, file);
+    QFETCH(bool, opengl);
+    QFETCH(bool, static_layer);
+
+    main_win->on_actionClear_triggered();
+    main_win->loadFromXML( readFile( file.toLocal8Bit().constData() ) );
+
+    auto container = main_win->currentTabInfo();
+    auto view = container->view();
+    view->setOpenGLViewport( opengl );
+    sleepAndRefresh( 100 );
+
+    if( opengl )
+    {
+        auto gl_widget = qobject_cast<QOpenGLWidget*>( view->viewport() );
+        if( !gl_widget || !gl_widget->context() || !gl_widget->context()->isValid() )
+        {
+            QSKIP("OpenGL is not available");
+        }
+    }
+
+    auto scene = container->scene();
+    scene->setStaticLayer( static_layer );
+    if( static_layer )
+    {
+        // the tiles are rendered by the first frame only
+        view->viewport()->repaint();
+    }
+
+    QBENCHMARK
+    {
+        for(auto& node_it: scene->nodes())
+        {
+            node_it.second->nodeGraphicsObject().update();
+        }
+        view->viewport()->repaint();
+    }
+    scene->setStaticLayer( false );
+    view->setOpenGLViewport( false );
+}
+
+QTEST_MAIN(ViewportBenchmark)
+
+#include "viewport_benchmark.moc"